@@ -0,0 +1,204 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StressTest.h"
+
+#include <kddockwidgets/LayoutSaver.h>
+
+#include <QApplication>
+#include <QDebug>
+#include <QEvent>
+#include <QLabel>
+#include <QMenu>
+#include <QMenuBar>
+#include <QScreen>
+#include <QStatusBar>
+
+#include <stdlib.h>
+#include <time.h>
+
+using namespace KDDockWidgets;
+
+// How many times the script is repeated, and the delay between its steps
+static const int s_numRounds = 3;
+static const int s_stepInterval = 300;
+
+StressTest::StressTest(int numDockWidgets, QWidget *parent)
+    : MainWindow(QStringLiteral("StressTest"), MainWindowOption_None, parent)
+    , m_fpsLabel(new QLabel(this))
+    , m_timingsLabel(new QLabel(this))
+{
+    qsrand(time(nullptr));
+    setWindowTitle(QStringLiteral("Stress test (%1 dock widgets)").arg(numDockWidgets));
+
+    auto menu = menuBar()->addMenu(QStringLiteral("Stress"));
+    connect(menu->addAction(QStringLiteral("Run script")), &QAction::triggered, this, &StressTest::runScript);
+    connect(menu->addAction(QStringLiteral("Quit")), &QAction::triggered, qApp, &QApplication::quit);
+
+    statusBar()->addWidget(m_fpsLabel);
+    statusBar()->addWidget(m_timingsLabel, 1);
+
+    // Each repaint of the window ends with an UpdateRequest, count them for the FPS
+    installEventFilter(this);
+    m_fpsTimer.setInterval(1000);
+    connect(&m_fpsTimer, &QTimer::timeout, this, &StressTest::updateFpsLabel);
+    m_fpsTimer.start();
+
+    m_stepTimer.setInterval(s_stepInterval);
+    connect(&m_stepTimer, &QTimer::timeout, this, &StressTest::runNextStep);
+
+    QElapsedTimer timer;
+    timer.start();
+    createDockWidgets(numDockWidgets);
+    reportStep(QStringLiteral("create"), timer.elapsed());
+
+    QTimer::singleShot(1000, this, &StressTest::runScript);
+}
+
+bool StressTest::eventFilter(QObject *o, QEvent *e)
+{
+    if (o == this && e->type() == QEvent::UpdateRequest)
+        m_frames++;
+
+    return MainWindow::eventFilter(o, e);
+}
+
+void StressTest::createDockWidgets(int count)
+{
+    const QList<QScreen*> screens = QGuiApplication::screens();
+    DockWidget::List docked;
+    DockWidget::List floating;
+
+    for (int i = 0; i < count; ++i) {
+        auto dock = new DockWidget(QStringLiteral("stress-%1").arg(i));
+        dock->setWidget(new QLabel(QStringLiteral("Dock widget #%1").arg(i)));
+        dock->setTitle(QStringLiteral("#%1").arg(i));
+        m_dockWidgets << dock;
+
+        const int random = qrand() % 100;
+        if (docked.isEmpty() || random < 45) {
+            // Nested next to a random dock widget, or at the window edges
+            const auto location = Location(qrand() % 4 + Location_OnLeft);
+            DockWidgetBase *relativeTo = docked.isEmpty() || random % 3 == 0 ? nullptr
+                                                                             : docked.at(qrand() % docked.size());
+            addDockWidget(dock, location, relativeTo);
+            docked << dock;
+        } else if (random < 85) {
+            docked.at(qrand() % docked.size())->addDockWidgetAsTab(dock);
+        } else if (floating.isEmpty() || random < 90) {
+            // A new floating window, on a random screen
+            QScreen *screen = screens.at(qrand() % screens.size());
+            const QRect available = screen->availableGeometry();
+            dock->resize(400, 300);
+            dock->show();
+            dock->window()->move(available.topLeft() + QPoint(qrand() % qMax(1, available.width() - 400),
+                                                              qrand() % qMax(1, available.height() - 300)));
+            floating << dock;
+        } else {
+            floating.at(qrand() % floating.size())->addDockWidgetAsTab(dock);
+        }
+    }
+}
+
+void StressTest::runScript()
+{
+    if (m_stepTimer.isActive())
+        return;
+
+    m_step = 0;
+    m_stepTimer.start();
+}
+
+void StressTest::runNextStep()
+{
+    static const int numSteps = 5;
+    if (m_step >= numSteps * s_numRounds) {
+        m_stepTimer.stop();
+        qDebug() << "StressTest: Finished." << m_timings;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const int step = m_step % numSteps;
+    m_step++;
+
+    switch (step) {
+    case 0: {
+        LayoutSaver saver;
+        m_savedLayout = saver.serializeLayout();
+        reportStep(QStringLiteral("save"), timer.elapsed());
+        break;
+    }
+    case 1: {
+        resize(size() + QSize(150, 100));
+        reportStep(QStringLiteral("grow"), timer.elapsed());
+        break;
+    }
+    case 2: {
+        // Like a user dragging a dock widget out and then back in
+        DockWidgetBase *dock = randomDockWidget();
+        dock->setFloating(!dock->isFloating());
+        dock->setFloating(!dock->isFloating());
+        reportStep(QStringLiteral("float+dock"), timer.elapsed());
+        break;
+    }
+    case 3: {
+        resize(size() - QSize(150, 100));
+        reportStep(QStringLiteral("shrink"), timer.elapsed());
+        break;
+    }
+    case 4: {
+        LayoutSaver saver;
+        saver.restoreLayout(m_savedLayout);
+        reportStep(QStringLiteral("restore"), saver.restoreReport().totalUSecs / 1000);
+        break;
+    }
+    }
+}
+
+void StressTest::reportStep(const QString &name, qint64 msecs)
+{
+    const QString timing = QStringLiteral("%1: %2 ms").arg(name).arg(msecs);
+    qDebug() << "StressTest:" << timing;
+
+    // The last of each step
+    for (int i = 0; i < m_timings.size(); ++i) {
+        if (m_timings.at(i).startsWith(name + QLatin1Char(':'))) {
+            m_timings.removeAt(i);
+            break;
+        }
+    }
+
+    m_timings << timing;
+    m_timingsLabel->setText(m_timings.join(QStringLiteral(" | ")));
+}
+
+void StressTest::updateFpsLabel()
+{
+    m_fpsLabel->setText(QStringLiteral("%1 FPS").arg(m_frames));
+    m_frames = 0;
+}
+
+DockWidgetBase *StressTest::randomDockWidget() const
+{
+    return m_dockWidgets.at(qrand() % m_dockWidgets.size());
+}
@@ -0,0 +1,64 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <kddockwidgets/DockWidget.h>
+#include <kddockwidgets/MainWindow.h>
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QLabel;
+QT_END_NAMESPACE
+
+/**
+ * Creates many dock widgets in random nested, tabbed and floating arrangements, then runs a scripted
+ * sequence of save, restore, resize and float/dock operations while showing the FPS and how long each step took.
+ * Run the example with --stress <count>. Useful to reproduce performance problems in bug reports.
+ */
+class StressTest : public KDDockWidgets::MainWindow
+{
+    Q_OBJECT
+public:
+    explicit StressTest(int numDockWidgets, QWidget *parent = nullptr);
+
+protected:
+    bool eventFilter(QObject *, QEvent *) override;
+
+private:
+    void createDockWidgets(int count);
+    void runScript();
+    void runNextStep();
+    void reportStep(const QString &name, qint64 msecs);
+    void updateFpsLabel();
+    KDDockWidgets::DockWidgetBase *randomDockWidget() const;
+
+    KDDockWidgets::DockWidget::List m_dockWidgets;
+    QLabel *m_fpsLabel = nullptr;
+    QLabel *m_timingsLabel = nullptr;
+    QTimer m_fpsTimer;
+    QTimer m_stepTimer;
+    QByteArray m_savedLayout;
+    QStringList m_timings;
+    int m_frames = 0;
+    int m_step = 0;
+};
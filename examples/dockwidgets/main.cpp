@@ -21,6 +21,7 @@
 #include "MyWidget.h"
 #include "MyMainWindow.h"
 #include "MyFrameworkWidgetFactory.h"
+#include "StressTest.h"
 
 #include <kddockwidgets/Config.h>
 
@@ -58,6 +59,15 @@ int main(int argc, char **argv)
     QCommandLineOption lazyResizeOption("l", QCoreApplication::translate("main", "Use lazy resize"));
     parser.addOption(lazyResizeOption);
 
+    QCommandLineOption lazyResizePreviewOption("v", QCoreApplication::translate("main", "Use lazy resize, with a live preview of the dock widgets being resized"));
+    parser.addOption(lazyResizePreviewOption);
+
+    QCommandLineOption systemMoveOption("w", QCoreApplication::translate("main", "Let the window manager move the window being dragged (Qt >= 5.15)"));
+    parser.addOption(systemMoveOption);
+
+    QCommandLineOption overlayIndicatorsOption("o", QCoreApplication::translate("main", "Paint the drop indicators in a single window"));
+    parser.addOption(overlayIndicatorsOption);
+
     QCommandLineOption multipleMainWindows("m", QCoreApplication::translate("main", "Shows two multiple main windows"));
     parser.addOption(multipleMainWindows);
 
@@ -82,6 +92,9 @@ int main(int argc, char **argv)
     QCommandLineOption maximizeButton("b", QCoreApplication::translate("main", "DockWidgets have maximize/restore buttons instead of float/dock button"));
     parser.addOption(maximizeButton);
 
+    QCommandLineOption stressOption("stress", QCoreApplication::translate("main", "Instead of the usual main window, shows <count> dock widgets in random arrangements and runs a scripted sequence of save/restore/resize operations, with timings"), QStringLiteral("count"));
+    parser.addOption(stressOption);
+
 #if defined(DOCKS_DEVELOPER_MODE)
     QCommandLineOption noCentralFrame("f", QCoreApplication::translate("main", "No central frame"));
     parser.addOption(noCentralFrame);
@@ -96,6 +109,9 @@ int main(int argc, char **argv)
         Config::self().setSeparatorThickness(10, /*static=*/ false);
     }
 
+    if (parser.isSet(overlayIndicatorsOption))
+        DefaultWidgetFactory::s_dropIndicatorType = DefaultWidgetFactory::DropIndicatorType::Overlay;
+
     MainWindowOptions options = MainWindowOption_None;
 #if defined(DOCKS_DEVELOPER_MODE)
     options = parser.isSet(noCentralFrame) ? MainWindowOption_None
@@ -115,6 +131,12 @@ int main(int argc, char **argv)
     if (parser.isSet(lazyResizeOption))
         flags |= KDDockWidgets::Config::Flag_LazyResize;
 
+    if (parser.isSet(lazyResizePreviewOption))
+        flags |= KDDockWidgets::Config::Flag_LazyResizeLivePreview;
+
+    if (parser.isSet(systemMoveOption))
+        flags |= KDDockWidgets::Config::Flag_SystemMove;
+
     if (parser.isSet(tabsHaveCloseButton))
         flags |= KDDockWidgets::Config::Flag_TabsHaveCloseButton;
 
@@ -129,6 +151,19 @@ int main(int argc, char **argv)
 
     KDDockWidgets::Config::self().setFlags(flags);
 
+    if (parser.isSet(stressOption)) {
+        const int count = parser.value(stressOption).toInt();
+        if (count <= 0) {
+            qWarning() << "Error: --stress requires a positive number of dock widgets";
+            return 1;
+        }
+
+        StressTest stressTest(count);
+        stressTest.resize(1200, 1200);
+        stressTest.show();
+        return app.exec();
+    }
+
     const bool nonClosableDockWidget0 = parser.isSet(nonClosableDockWidget);
     const bool restoreIsRelative = parser.isSet(relativeRestore);
     const bool nonDockableDockWidget9 = parser.isSet(nonDockable);
@@ -0,0 +1,172 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+ * @file
+ * @brief Class to restore big dockwidget layouts without blocking the GUI thread for the whole restore.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "AsyncLayoutRestorer.h"
+#include "Tracing_p.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTimer>
+
+using namespace KDDockWidgets;
+
+class AsyncLayoutRestorer::Private
+{
+public:
+    explicit Private(RestoreOptions options)
+        : m_saver(options)
+    {
+        m_timer.setSingleShot(true);
+        m_timer.setInterval(0);
+    }
+
+    LayoutSaver m_saver;
+    QTimer m_timer;
+    int m_timeSlice = 5;
+    bool m_hideWindowsUntilFinished = false;
+    bool m_isRestoring = false;
+    int m_stepCount = 0;
+};
+
+AsyncLayoutRestorer::AsyncLayoutRestorer(RestoreOptions options, QObject *parent)
+    : QObject(parent)
+    , d(new Private(options))
+{
+    connect(&d->m_timer, &QTimer::timeout, this, &AsyncLayoutRestorer::runSlice);
+}
+
+AsyncLayoutRestorer::~AsyncLayoutRestorer()
+{
+    // Not cancel(), no signals from the destructor
+    d->m_saver.cancelRestore();
+    delete d;
+}
+
+void AsyncLayoutRestorer::setAffinityNames(const QStringList &affinityNames)
+{
+    d->m_saver.setAffinityNames(affinityNames);
+}
+
+void AsyncLayoutRestorer::setTimeSlice(int msecs)
+{
+    d->m_timeSlice = qMax(0, msecs);
+}
+
+int AsyncLayoutRestorer::timeSlice() const
+{
+    return d->m_timeSlice;
+}
+
+void AsyncLayoutRestorer::setHideWindowsUntilFinished(bool hide)
+{
+    d->m_hideWindowsUntilFinished = hide;
+}
+
+bool AsyncLayoutRestorer::hideWindowsUntilFinished() const
+{
+    return d->m_hideWindowsUntilFinished;
+}
+
+bool AsyncLayoutRestorer::restoreLayout(const QByteArray &data)
+{
+    KDDW_TRACE_SCOPE("AsyncLayoutRestorer::restoreLayout");
+    if (d->m_isRestoring) {
+        qWarning() << Q_FUNC_INFO << "Already restoring a layout";
+        return false;
+    }
+
+    if (!d->m_saver.beginRestore(data, d->m_hideWindowsUntilFinished))
+        return false;
+
+    d->m_isRestoring = true;
+    d->m_stepCount = d->m_saver.restoreStepCount();
+    d->m_timer.start();
+    return true;
+}
+
+bool AsyncLayoutRestorer::restoreFromFile(const QString &filename)
+{
+    QFile f(filename);
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << filename << f.errorString();
+        return false;
+    }
+
+    // The layout is parsed right away, so the data isn't needed afterwards
+    return restoreLayout(f.readAll());
+}
+
+bool AsyncLayoutRestorer::isRestoring() const
+{
+    return d->m_isRestoring;
+}
+
+void AsyncLayoutRestorer::cancel()
+{
+    if (!d->m_isRestoring)
+        return;
+
+    d->m_saver.cancelRestore();
+    finish(false);
+}
+
+const LayoutSaver::RestoreReport &AsyncLayoutRestorer::restoreReport() const
+{
+    return d->m_saver.restoreReport();
+}
+
+void AsyncLayoutRestorer::runSlice()
+{
+    KDDW_TRACE_SCOPE("AsyncLayoutRestorer::runSlice");
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    bool hasMoreSteps = true;
+    while (hasMoreSteps) {
+        hasMoreSteps = d->m_saver.restoreStep();
+        if (elapsed.elapsed() >= d->m_timeSlice)
+            break;
+    }
+
+    if (hasMoreSteps) {
+        Q_EMIT progress(d->m_saver.restoreStepsDone(), d->m_stepCount);
+        d->m_timer.start();
+    } else {
+        finish(d->m_saver.restoreReport().success);
+    }
+}
+
+void AsyncLayoutRestorer::finish(bool success)
+{
+    d->m_timer.stop();
+    d->m_isRestoring = false;
+    Q_EMIT progress(d->m_stepCount, d->m_stepCount);
+    Q_EMIT finished(success);
+}
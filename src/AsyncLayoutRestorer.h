@@ -0,0 +1,117 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_ASYNC_LAYOUTRESTORER_H
+#define KD_ASYNC_LAYOUTRESTORER_H
+
+/**
+ * @file
+ * @brief Class to restore big dockwidget layouts without blocking the GUI thread for the whole restore.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "docks_export.h"
+
+#include "KDDockWidgets.h"
+#include "LayoutSaver.h"
+
+#include <QObject>
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Restores a layout in slices, so the event loop keeps running while big layouts are restored.
+ *
+ * Parsing the layout and clearing the current one happen when restoreLayout() is called. The rest is
+ * split into steps: each main window, floating window and dock widget is one. Steps run for up to
+ * timeSlice() milliseconds per event loop iteration.
+ *
+ * While it's running LayoutSaver::restoreInProgress() returns true. Between slices the layout is
+ * only partially restored but consistent: each window got its complete layout or wasn't touched yet.
+ * Floating windows are only shown at the end. With setHideWindowsUntilFinished() the main windows
+ * are hidden too, so the user never sees the partial layout.
+ */
+class DOCKS_EXPORT AsyncLayoutRestorer : public QObject
+{
+    Q_OBJECT
+public:
+    ///@brief Constructor. @p options are the same as for LayoutSaver.
+    explicit AsyncLayoutRestorer(RestoreOptions options = RestoreOption_None, QObject *parent = nullptr);
+
+    ///@brief Destructor. Cancels the restore in progress, if any.
+    ~AsyncLayoutRestorer() override;
+
+    ///@brief Sets the affinity names of the windows to restore. See LayoutSaver::setAffinityNames().
+    void setAffinityNames(const QStringList &affinityNames);
+
+    ///@brief Sets for how many milliseconds each event loop iteration restores. 5 by default.
+    void setTimeSlice(int msecs);
+    int timeSlice() const;
+
+    ///@brief Sets whether the main windows being restored are hidden until the restore finishes. false by default.
+    void setHideWindowsUntilFinished(bool hide);
+    bool hideWindowsUntilFinished() const;
+
+    /**
+     * @brief Starts restoring the layout from a byte array. See LayoutSaver::restoreLayout().
+     *
+     * The layout is parsed right away, the windows are restored from the event loop.
+     * finished() is emitted when it's done.
+     *
+     * @return false if the layout couldn't be parsed or another restore is in progress.
+     * finished() isn't emitted in that case.
+     */
+    bool restoreLayout(const QByteArray &data);
+
+    ///@brief Like restoreLayout(), but reads the layout from @p filename.
+    bool restoreFromFile(const QString &filename);
+
+    ///@brief returns whether a restore was started and didn't finish yet
+    bool isRestoring() const;
+
+    /**
+     * @brief Stops the restore in progress. finished() is emitted with false.
+     *
+     * What was restored so far stays as it is. The remaining dock widgets stay closed.
+     */
+    void cancel();
+
+    ///@brief returns the timings of the last restore. Valid once finished() is emitted.
+    const LayoutSaver::RestoreReport &restoreReport() const;
+
+Q_SIGNALS:
+    ///@brief emitted after each slice. @p stepsDone goes up to @p stepCount.
+    void progress(int stepsDone, int stepCount);
+
+    ///@brief emitted when the restore finished, or was cancelled
+    void finished(bool success);
+
+private:
+    void runSlice();
+    void finish(bool success);
+
+    class Private;
+    Private *const d;
+};
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**
+ * @file
+ * @brief Class to save dockwidget layouts to disk without blocking the GUI thread.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "AsyncLayoutSaver.h"
+#include "LayoutSaver.h"
+#include "LayoutSaver_p.h"
+#include "Tracing_p.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+
+#include <memory>
+
+using namespace KDDockWidgets;
+
+namespace KDDockWidgets {
+
+///@brief Serializes a layout snapshot and writes it to disk, runs on the worker thread.
+class LayoutWriter : public QRunnable
+{
+public:
+    LayoutWriter(QObject *receiver, int id, const QString &filename, SerializationFormat format,
+                 const std::shared_ptr<const LayoutSaver::Layout> &layout, QAtomicInt *result)
+        : m_receiver(receiver)
+        , m_id(id)
+        , m_filename(filename)
+        , m_format(format)
+        , m_layout(layout)
+        , m_result(result)
+    {
+    }
+
+    void run() override
+    {
+        const QByteArray data = m_layout->serialize(m_format);
+
+        // Drop our reference before notifying, so the layout is destroyed on the GUI thread
+        m_layout.reset();
+
+        bool success = false;
+        QSaveFile f(m_filename);
+        if (!f.open(QIODevice::WriteOnly)) {
+            qWarning() << Q_FUNC_INFO << "Failed to open" << m_filename << f.errorString();
+        } else if (f.write(data) != data.size() || !f.commit()) {
+            qWarning() << Q_FUNC_INFO << "Failed to write" << m_filename << f.errorString();
+        } else {
+            success = true;
+        }
+
+        m_result->storeRelease(success ? 1 : 0);
+        QMetaObject::invokeMethod(m_receiver, "onWriteFinished", Qt::QueuedConnection,
+                                  Q_ARG(int, m_id), Q_ARG(bool, success));
+    }
+
+private:
+    QObject *const m_receiver;
+    const int m_id;
+    const QString m_filename;
+    const SerializationFormat m_format;
+    std::shared_ptr<const LayoutSaver::Layout> m_layout;
+    QAtomicInt *const m_result;
+};
+
+}
+
+class AsyncLayoutSaver::Private
+{
+public:
+    Private()
+    {
+        m_threadPool.setMaxThreadCount(1);
+    }
+
+    QThreadPool m_threadPool;
+    QStringList m_affinityNames;
+
+    int m_nextId = 1;
+
+    // The save currently being written, if m_inFlightId isn't 0
+    int m_inFlightId = 0;
+    QString m_inFlightFilename;
+    quint64 m_inFlightGeneration = 0;
+    std::shared_ptr<const LayoutSaver::Layout> m_inFlightLayout;
+    QAtomicInt m_inFlightResult;
+
+    // The latest request that arrived while a save was in progress
+    bool m_hasPendingRequest = false;
+    QString m_pendingFilename;
+    SerializationFormat m_pendingFormat = SerializationFormat_Json;
+
+    // What the last successful save wrote
+    quint64 m_savedGeneration = 0;
+    QString m_savedFilename;
+};
+
+void AsyncLayoutSaver::startWrite(const QString &filename, SerializationFormat format)
+{
+    KDDW_TRACE_SCOPE("AsyncLayoutSaver::startWrite");
+
+    // Capture the state now, on the GUI thread. Only the serialization and I/O happen on the worker.
+    LayoutSaver saver;
+    saver.setAffinityNames(d->m_affinityNames);
+    auto layout = std::make_shared<LayoutSaver::Layout>();
+    if (!saver.snapshotLayout(*layout)) {
+        // snapshotLayout() already warned
+        Q_EMIT saved(filename, false);
+        return;
+    }
+
+    // Don't share DockWidget instances with LayoutSaver's registry, the worker thread reads them
+    layout->detachDockWidgets();
+
+    d->m_inFlightId = d->m_nextId++;
+    d->m_inFlightFilename = filename;
+    d->m_inFlightGeneration = LayoutSaver::layoutGeneration();
+    d->m_inFlightLayout = layout;
+    d->m_inFlightResult.storeRelease(-1);
+
+    d->m_threadPool.start(new LayoutWriter(this, d->m_inFlightId, filename, format, layout, &d->m_inFlightResult));
+}
+
+void AsyncLayoutSaver::finishWrite(bool success)
+{
+    const QString filename = d->m_inFlightFilename;
+    if (success) {
+        d->m_savedGeneration = d->m_inFlightGeneration;
+        d->m_savedFilename = filename;
+    }
+
+    d->m_inFlightId = 0;
+    d->m_inFlightFilename.clear();
+    d->m_inFlightLayout.reset();
+
+    if (d->m_hasPendingRequest) {
+        d->m_hasPendingRequest = false;
+        startWrite(d->m_pendingFilename, d->m_pendingFormat);
+    }
+
+    Q_EMIT saved(filename, success);
+}
+
+AsyncLayoutSaver::AsyncLayoutSaver(QObject *parent)
+    : QObject(parent)
+    , d(new Private())
+{
+}
+
+AsyncLayoutSaver::~AsyncLayoutSaver()
+{
+    // Pending requests are dropped, but the one being written is allowed to finish
+    d->m_threadPool.waitForDone();
+    delete d;
+}
+
+void AsyncLayoutSaver::setAffinityNames(const QStringList &affinityNames)
+{
+    d->m_affinityNames = affinityNames;
+}
+
+void AsyncLayoutSaver::saveToFile(const QString &filename, SerializationFormat format)
+{
+    if (d->m_inFlightId != 0) {
+        // Coalesce, only the latest request matters
+        d->m_hasPendingRequest = true;
+        d->m_pendingFilename = filename;
+        d->m_pendingFormat = format;
+        return;
+    }
+
+    startWrite(filename, format);
+}
+
+bool AsyncLayoutSaver::saveToFileIfChanged(const QString &filename, SerializationFormat format)
+{
+    const quint64 generation = LayoutSaver::layoutGeneration();
+
+    bool upToDate = false;
+    if (d->m_inFlightId == 0) {
+        upToDate = d->m_savedGeneration == generation && d->m_savedFilename == filename;
+    } else if (!d->m_hasPendingRequest) {
+        // Assume the in-flight save will succeed, if it doesn't then the next call will retry
+        upToDate = d->m_inFlightGeneration == generation && d->m_inFlightFilename == filename;
+    }
+
+    if (upToDate)
+        return false;
+
+    saveToFile(filename, format);
+    return true;
+}
+
+quint64 AsyncLayoutSaver::savedLayoutGeneration() const
+{
+    return d->m_savedGeneration;
+}
+
+bool AsyncLayoutSaver::isSaving() const
+{
+    return d->m_inFlightId != 0 || d->m_hasPendingRequest;
+}
+
+void AsyncLayoutSaver::waitForFinished()
+{
+    while (d->m_inFlightId != 0) {
+        d->m_threadPool.waitForDone();
+        // The queued onWriteFinished() for this id will be ignored
+        finishWrite(d->m_inFlightResult.loadAcquire() == 1);
+    }
+}
+
+void AsyncLayoutSaver::onWriteFinished(int id, bool success)
+{
+    if (id != d->m_inFlightId) {
+        // Already handled by waitForFinished()
+        return;
+    }
+
+    finishWrite(success);
+}
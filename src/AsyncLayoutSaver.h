@@ -0,0 +1,103 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef KD_ASYNC_LAYOUTSAVER_H
+#define KD_ASYNC_LAYOUTSAVER_H
+
+/**
+ * @file
+ * @brief Class to save dockwidget layouts to disk without blocking the GUI thread.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "docks_export.h"
+
+#include "KDDockWidgets.h"
+
+#include <QObject>
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Saves the layout to a file asynchronously, which is suitable for frequent autosaves.
+ *
+ * The state of the windows and dock widgets is captured on the GUI thread, when saveToFile() is called,
+ * but serializing it and writing it to disk happens on a worker thread. The file is written atomically,
+ * so a crash while saving won't leave a truncated layout behind.
+ *
+ * Requests made while a save is still in progress are coalesced: only the last one is honoured,
+ * and its state is captured once the current save finishes.
+ */
+class DOCKS_EXPORT AsyncLayoutSaver : public QObject
+{
+    Q_OBJECT
+public:
+    ///@brief Constructor.
+    explicit AsyncLayoutSaver(QObject *parent = nullptr);
+
+    ///@brief Destructor. Blocks until any save in progress has finished.
+    ~AsyncLayoutSaver() override;
+
+    ///@brief Sets the affinity names of the windows to save. See LayoutSaver::setAffinityNames().
+    void setAffinityNames(const QStringList &affinityNames);
+
+    /**
+     * @brief Starts saving the layout to @p filename. Returns immediately.
+     * @param filename the filename where the layout will be saved to
+     * @param format the format to save in. JSON by default.
+     *
+     * The saved() signal is emitted when it's done.
+     */
+    void saveToFile(const QString &filename, SerializationFormat format = SerializationFormat_Json);
+
+    /**
+     * @brief Like saveToFile(), but does nothing if @p filename already has, or is about to have,
+     * the current layout. i.e. if LayoutSaver::layoutGeneration() didn't change since.
+     * Returns whether a save was requested.
+     */
+    bool saveToFileIfChanged(const QString &filename, SerializationFormat format = SerializationFormat_Json);
+
+    ///@brief returns the LayoutSaver::layoutGeneration() of the last successful save, 0 if none
+    quint64 savedLayoutGeneration() const;
+
+    ///@brief returns whether a save is in progress or pending
+    bool isSaving() const;
+
+    ///@brief Blocks until all requested saves have been written. Mostly useful before quitting.
+    void waitForFinished();
+
+Q_SIGNALS:
+    ///@brief emitted when a save finished. @p success is false if the file couldn't be written.
+    void saved(const QString &filename, bool success);
+
+private:
+    Q_INVOKABLE void onWriteFinished(int id, bool success);
+    void startWrite(const QString &filename, SerializationFormat format);
+    void finishWrite(bool success);
+
+    class Private;
+    Private *const d;
+};
+
+}
+
+#endif
@@ -32,6 +32,7 @@
 #include <QApplication>
 #include <QDebug>
 #include <QOperatingSystemVersion>
+#include <QUrl>
 
 using namespace KDDockWidgets;
 
@@ -51,9 +52,16 @@ public:
     void fixFlags();
 
     QQmlEngine *m_qmlEngine = nullptr;
+    QUrl m_separatorQmlUrl;
     DockWidgetFactoryFunc m_dockWidgetFactoryFunc = nullptr;
     FrameworkWidgetFactory *m_frameworkWidgetFactory;
     Flags m_flags = Flag_Default;
+    int m_floatingWindowPoolSize = 0;
+    int m_dragMouseMoveInterval = 0;
+    int m_lazyResizeIdleInterval = 0;
+    int m_windowResizeThrottleInterval = 0;
+    int m_maxPlaceholdersPerLayout = 0;
+    int m_collapseThreshold = 10;
     int m_separatorThickness = 5;
 #if defined(Q_OS_WIN)
     int m_staticSeparatorThickness = 1; // FIXME: Broken on Windows still.
@@ -94,6 +102,9 @@ void Config::setFlags(Flags f)
 
     d->m_flags = f;
     d->fixFlags();
+
+    // Flag_WarmUpWindows needs QEvent::Quit
+    DockRegistry::self()->updateAppEventFilter();
 }
 
 void Config::setDockWidgetFactoryFunc(DockWidgetFactoryFunc func)
@@ -142,6 +153,99 @@ void Config::setSeparatorThickness(int value, bool staticSeparator)
         d->m_separatorThickness = value;
 }
 
+void Config::setFloatingWindowPoolSize(int size)
+{
+    if (size < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << size;
+        return;
+    }
+
+    d->m_floatingWindowPoolSize = size;
+
+    // The pool needs QEvent::Quit
+    DockRegistry::self()->updateAppEventFilter();
+}
+
+int Config::floatingWindowPoolSize() const
+{
+    return d->m_floatingWindowPoolSize;
+}
+
+void Config::setDragMouseMoveInterval(int msecs)
+{
+    if (msecs < -1) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << msecs;
+        return;
+    }
+
+    d->m_dragMouseMoveInterval = msecs;
+}
+
+int Config::dragMouseMoveInterval() const
+{
+    return d->m_dragMouseMoveInterval;
+}
+
+void Config::setLazyResizeIdleInterval(int msecs)
+{
+    if (msecs < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << msecs;
+        return;
+    }
+
+    d->m_lazyResizeIdleInterval = msecs;
+}
+
+int Config::lazyResizeIdleInterval() const
+{
+    return d->m_lazyResizeIdleInterval;
+}
+
+void Config::setWindowResizeThrottleInterval(int msecs)
+{
+    if (msecs < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << msecs;
+        return;
+    }
+
+    d->m_windowResizeThrottleInterval = msecs;
+}
+
+int Config::windowResizeThrottleInterval() const
+{
+    return d->m_windowResizeThrottleInterval;
+}
+
+void Config::setMaxPlaceholdersPerLayout(int count)
+{
+    if (count < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << count;
+        return;
+    }
+
+    d->m_maxPlaceholdersPerLayout = count;
+}
+
+int Config::maxPlaceholdersPerLayout() const
+{
+    return d->m_maxPlaceholdersPerLayout;
+}
+
+void Config::setCollapseThreshold(int pixels)
+{
+    if (pixels < 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << pixels;
+        return;
+    }
+
+    d->m_collapseThreshold = pixels;
+}
+
+int Config::collapseThreshold() const
+{
+    return d->m_collapseThreshold;
+}
+
 void Config::setQmlEngine(QQmlEngine *qmlEngine)
 {
     if (d->m_qmlEngine) {
@@ -157,6 +261,16 @@ QQmlEngine *Config::qmlEngine() const
     return d->m_qmlEngine;
 }
 
+void Config::setSeparatorQmlUrl(const QUrl &url)
+{
+    d->m_separatorQmlUrl = url;
+}
+
+QUrl Config::separatorQmlUrl() const
+{
+    return d->m_separatorQmlUrl;
+}
+
 void Config::Private::fixFlags()
 {
 #if defined(Q_OS_WIN)
@@ -32,6 +32,7 @@
 
 QT_BEGIN_NAMESPACE
 class QQmlEngine;
+class QUrl;
 QT_END_NAMESPACE
 
 namespace KDDockWidgets
@@ -66,10 +67,18 @@ public:
         Flag_HideTitleBarWhenTabsVisible = 8, ///> Hides the title bar if there's tabs visible. The empty space in the tab bar becomes draggable.
         Flag_AlwaysShowTabs = 16, ///> Always show tabs, even if there's only one,
         Flag_AllowReorderTabs = 32, /// Allows user to re-order tabs by dragging them
-        Flag_LazyResize = 32, /// The dock widgets are resized in a lazy manner. The actual resize only happens when you release the mouse button.
         Flag_TabsHaveCloseButton = 64, /// Tabs will have a close button. Equivalent to QTabWidget::setTabsClosable(true).
         Flag_DoubleClickMaximizes = 128, /// Double clicking the titlebar will maximize a floating window instead of re-docking it
         Flag_TitleBarHasMaximizeButton = 256, /// The title bar will have a maximize/restore button when floating. This is mutually-exclusive with the floating button (since many apps behave that way).
+        Flag_LinearLayoutSolver = 512, /// When inserting a widget, the space is taken from the neighbours by solving the anchor constraints in a single pass, instead of enumerating every resize path. Resizing the window redistributes the space in a single pass too. Recommended for layouts with many frames.
+        Flag_WarmUpWindows = 1024, /// Once a main window is shown, creates the native windows needed by the first drag (drop indicators and a hidden floating window) while idle, instead of during the drag.
+        Flag_LazyResizeLivePreview = 2048, /// Like Flag_LazyResize, but instead of a rubber band it shows a scaled snapshot of the frames next to the separator being dragged. See setLazyResizeIdleInterval().
+        Flag_LazyResize = 4096, /// The dock widgets are resized in a lazy manner. The actual resize only happens when you release the mouse button. Used to be 32, which clashed with Flag_AllowReorderTabs. See also MultiSplitterLayout::setResizePolicy().
+        Flag_SystemMove = 8192, /// The window manager moves the window being dragged, via QWindow::startSystemMove(). Recommended on Wayland and over remote desktop. Requires Qt >= 5.15, the usual drag is used if the platform doesn't support it.
+        Flag_TabOverflowMenu = 16384, /// For frames with many tabs. Tab titles are elided, the tab bar scrolls, and a button in the corner lists every tab in a menu. Combine with DockWidgetBase::setWidgetCreator() so only the current tab creates its widget.
+        Flag_GhostTabDrag = 32768, /// Dragging a tab out only moves a translucent snapshot of its frame. The tab stays where it is until the drop, the floating window is only created if it's not dropped onto a drop area. QtWidgets only.
+        Flag_SystemResize = 65536, /// The window manager resizes floating windows, via QWindow::startSystemResize(). Like Flag_SystemMove, for remote desktop. Requires Qt >= 5.15, ignored on Windows, where resizing is already native. The usual resize is used if the platform doesn't support it.
+        Flag_SeparatorOverlay = 131072, /// A single transparent child per layout paints and hit-tests all its separators, instead of a child widget per separator, so resizing doesn't move any widget. QtWidgets only, with the DefaultWidgetFactory.
         Flag_Default = Flag_AeroSnapWithClientDecos ///> The defaults
     };
     Q_DECLARE_FLAGS(Flags, Flag)
@@ -132,10 +141,102 @@ public:
     ///Note: Only use this function at startup before creating any DockWidget or MainWindow.
     void setSeparatorThickness(int value, bool staticSeparator);
 
+    /**
+     * @brief Sets how many empty FloatingWindows are kept hidden for reuse, instead of being deleted.
+     *
+     * Creating a native window is expensive on some platforms, so recycling them makes
+     * dragging out dock widgets faster. The default is 0, which disables the pool.
+     *
+     * If you override FrameworkWidgetFactory::createFloatingWindow() then call
+     * FloatingWindow::takeRecycled() from it, otherwise the pool won't be used.
+     */
+    void setFloatingWindowPoolSize(int size);
+
+    ///@brief getter for @ref setFloatingWindowPoolSize
+    int floatingWindowPoolSize() const;
+
+    /**
+     * @brief Coalesces the mouse moves of a drag, so they're processed at most once every @p msecs.
+     *
+     * Each processed mouse move finds the drop area under the cursor and updates the drop indicators,
+     * which is wasteful with high polling rate mice. The latest position is always processed, including
+     * on release. Pass -1 to process once per display refresh of the primary screen.
+     * The default is 0, which processes every mouse move.
+     */
+    void setDragMouseMoveInterval(int msecs);
+
+    ///@brief getter for @ref setDragMouseMoveInterval
+    int dragMouseMoveInterval() const;
+
+    /**
+     * @brief With Flag_LazyResizeLivePreview, applies the real separator position once the mouse
+     * rests for @p msecs during a resize, instead of only on release.
+     *
+     * The default is 0, which only resizes the dock widgets on release.
+     */
+    void setLazyResizeIdleInterval(int msecs);
+
+    ///@brief getter for @ref setLazyResizeIdleInterval
+    int lazyResizeIdleInterval() const;
+
+    /**
+     * @brief Relayouts the dock widgets at most once every @p msecs while a window is being resized.
+     *
+     * Each resize event of a main window or floating window repositions every separator, which
+     * can saturate the GUI thread during a live resize. With an interval, resize events arriving
+     * faster than that are coalesced, and the latest size is applied when the interval elapses
+     * or when the resize ends, whichever comes first.
+     * The default is 0, which relayouts on every resize event.
+     */
+    void setWindowResizeThrottleInterval(int msecs);
+
+    ///@brief getter for @ref setWindowResizeThrottleInterval
+    int windowResizeThrottleInterval() const;
+
+    /**
+     * @brief Limits how many placeholders each layout keeps.
+     *
+     * Closing or floating a dock widget leaves a placeholder in the layout, so it can be restored
+     * to the same place later. When a layout has more than @p count placeholders, the oldest ones
+     * are dropped the next time a dock widget is added to it. Their dock widgets forget that
+     * position, as if they had never been there.
+     *
+     * The default is 0, which means no limit.
+     */
+    void setMaxPlaceholdersPerLayout(int count);
+
+    ///@brief getter for @ref setMaxPlaceholdersPerLayout
+    int maxPlaceholdersPerLayout() const;
+
+    /**
+     * @brief Sets the size, in pixels, below which a dock widget is considered collapsed.
+     *
+     * A dock widget whose width or height is smaller than @p pixels isn't effectively visible,
+     * see DockWidgetBase::isEffectivelyVisible().
+     * The default is 10.
+     */
+    void setCollapseThreshold(int pixels);
+
+    ///@brief getter for @ref setCollapseThreshold
+    int collapseThreshold() const;
+
     ///@brief Sets the QQmlEngine to use. Applicable only when using QtQuick.
     void setQmlEngine(QQmlEngine *);
     QQmlEngine* qmlEngine() const;
 
+    /**
+     * @brief Sets a QML component to instantiate for each separator. Applicable only when using QtQuick.
+     *
+     * By default no QML is instantiated for separators, all separators of a layout are painted
+     * by a single scene graph node, which is much cheaper to create when there are many of them.
+     * Only set this if you need custom styling. The component fills the separator and
+     * can access it through the "separatorCpp" property.
+     */
+    void setSeparatorQmlUrl(const QUrl &);
+
+    ///@brief getter for @ref setSeparatorQmlUrl
+    QUrl separatorQmlUrl() const;
+
 private:
     Q_DISABLE_COPY(Config)
     Config();
@@ -23,6 +23,8 @@
 #include "Frame_p.h"
 #include "FloatingWindow_p.h"
 #include "Logging_p.h"
+#include "Tracing_p.h"
+#include "EventLog_p.h"
 #include "TabWidget_p.h"
 #include "Utils_p.h"
 #include "DockRegistry_p.h"
@@ -30,6 +32,7 @@
 #include "DropArea_p.h"
 #include "LastPosition_p.h"
 #include "multisplitter/Item_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
 
@@ -37,8 +40,11 @@
 #include <QEvent>
 #include <QCloseEvent>
 #include <QTimer>
+#include <QWindow>
 #include <QScopedValueRollback>
 
+#include <algorithm>
+
 /**
  * @file
  * @brief The DockWidget base-class that's shared between QtWidgets and QtQuick stack.
@@ -56,28 +62,49 @@ public:
         , title(dockName)
         , q(qq)
         , options(options_)
-        , toggleAction(new QAction(q))
-        , floatAction(new QAction(q))
     {
-        q->connect(q, &DockWidgetBase::shown, q, [this] { onDockWidgetShown(); } );
-        q->connect(q, &DockWidgetBase::hidden, q, [this] { onDockWidgetHidden(); } );
+    }
+
+    ///@brief Creates the toggle action on first use. Most dock widgets never get theirs put in a menu.
+    QAction *ensureToggleAction()
+    {
+        if (toggleAction)
+            return toggleAction;
+
+        toggleAction = new QAction(q);
+        toggleAction->setCheckable(true);
+        toggleAction->setChecked(isOpen);
+        toggleAction->setText(title);
 
         q->connect(toggleAction, &QAction::toggled, q, [this] (bool enabled) {
             if (!m_updatingToggleAction) { // guard against recursiveness
+                isOpen = enabled;
                 toggleAction->blockSignals(true); // and don't emit spurious toggle. Like when a dock widget is inserted into a tab widget it might get hide events, ignore those. The Dock Widget is open.
                 toggle(enabled);
                 toggleAction->blockSignals(false);
             }
         });
 
+        return toggleAction;
+    }
+
+    ///@brief Creates the float action on first use, see ensureToggleAction()
+    QAction *ensureFloatAction()
+    {
+        if (floatAction)
+            return floatAction;
+
+        floatAction = new QAction(q);
+        floatAction->setCheckable(true);
+        updateFloatAction();
+
         q->connect(floatAction, &QAction::toggled, q, [this] (bool enabled) {
             if (!m_updatingFloatAction) { // guard against recursiveness
                 q->setFloating(enabled);
             }
         });
 
-        toggleAction->setCheckable(true);
-        floatAction->setCheckable(true);
+        return floatAction;
     }
 
     void init()
@@ -92,6 +119,7 @@ public:
     void toggle(bool enabled);
     void updateToggleAction();
     void updateFloatAction();
+    void updateHibernationTimer();
     void onDockWidgetShown();
     void onDockWidgetHidden();
     TabWidget *parentTabWidget() const;
@@ -109,17 +137,25 @@ public:
 
     const QString name;
     QString affinityName;
+    int affinityId = 0; // See DockRegistry::affinityId()
+    QSize layoutMinimumSize;
     QString title;
     QIcon icon;
     QWidget *widget = nullptr;
+    DockWidgetBase::WidgetCreatorFunc widgetCreator = nullptr;
+    DockWidgetBase::WidgetCreatorFunc recreator = nullptr; // The creator of the current guest, for hibernate()
+    QTimer *hibernationTimer = nullptr; // Created by setHibernationTimeout()
     DockWidgetBase *const q;
     DockWidgetBase::Options options;
-    QAction *const toggleAction;
-    QAction *const floatAction;
+    QAction *toggleAction = nullptr; // See ensureToggleAction()
+    QAction *floatAction = nullptr;
+    bool isOpen = false; // What toggleAction is checked with, kept even while it doesn't exist
     LastPosition m_lastPosition;
     bool m_updatingToggleAction = false;
     bool m_updatingFloatAction = false;
     bool m_isForceClosing = false;
+    int interactiveOperationDepth = 0; // See InteractiveOperation
+    bool isEffectivelyVisible = false; // See updateEffectiveVisibility()
 };
 
 DockWidgetBase::DockWidgetBase(const QString &name, Options options)
@@ -155,7 +191,7 @@ void DockWidgetBase::addDockWidgetAsTab(DockWidgetBase *other, AddingOption addi
         return;
     }
 
-    if (other->affinityName() != affinityName()) {
+    if (other->affinityId() != affinityId()) {
         qWarning() << Q_FUNC_INFO << "Refusing to dock widget with incompatible affinity."
                    << other->affinityName() << affinityName();
         return;
@@ -195,7 +231,7 @@ void DockWidgetBase::addDockWidgetToContainingWindow(DockWidgetBase *other, Loca
         return;
     }
 
-    if (other->affinityName() != affinityName()) {
+    if (other->affinityId() != affinityId()) {
         qWarning() << Q_FUNC_INFO << "Refusing to dock widget with incompatible affinity."
                    << other->affinityName() << affinityName();
         return;
@@ -223,6 +259,8 @@ void DockWidgetBase::setWidget(QWidget *w)
     qCDebug(addwidget) << Q_FUNC_INFO << w;
 
     d->widget = w;
+    d->widgetCreator = nullptr;
+    d->recreator = nullptr;
     Q_EMIT widgetChanged(w);
     setWindowTitle(uniqueName());
 }
@@ -232,6 +270,74 @@ QWidget *DockWidgetBase::widget() const
     return d->widget;
 }
 
+void DockWidgetBase::setWidgetCreator(WidgetCreatorFunc creator)
+{
+    if (d->widget) {
+        qWarning() << Q_FUNC_INFO << "Widget already set" << uniqueName();
+        return;
+    }
+
+    d->widgetCreator = creator;
+    if (creator && isVisible()) {
+        // Too late to be lazy
+        ensureWidgetCreated();
+    }
+}
+
+void DockWidgetBase::ensureWidgetCreated()
+{
+    if (d->widget || !d->widgetCreator)
+        return;
+
+    KDDW_TRACE_SCOPE("DockWidgetBase::ensureWidgetCreated");
+    WidgetCreatorFunc creator = d->widgetCreator;
+    d->widgetCreator = nullptr; // So a creator calling show() doesn't recurse
+
+    if (QWidget *w = creator(this)) {
+        setWidget(w);
+        d->recreator = creator;
+    } else {
+        qWarning() << Q_FUNC_INFO << "WidgetCreatorFunc returned nullptr for" << uniqueName();
+    }
+}
+
+void DockWidgetBase::setHibernationTimeout(int msecs)
+{
+    if (msecs > 0 && !d->hibernationTimer) {
+        d->hibernationTimer = new QTimer(this);
+        d->hibernationTimer->setSingleShot(true);
+        connect(d->hibernationTimer, &QTimer::timeout, this, &DockWidgetBase::hibernate);
+    }
+
+    if (d->hibernationTimer) {
+        d->hibernationTimer->setInterval(qMax(0, msecs));
+        d->updateHibernationTimer();
+    }
+}
+
+int DockWidgetBase::hibernationTimeout() const
+{
+    return d->hibernationTimer ? d->hibernationTimer->interval() : 0;
+}
+
+bool DockWidgetBase::hibernate()
+{
+    if (!d->widget || !d->recreator || isOpen())
+        return false;
+
+    KDDW_TRACE_SCOPE("DockWidgetBase::hibernate");
+    QWidget *guest = d->widget;
+    Q_EMIT aboutToHibernate(guest);
+
+    d->widget = nullptr;
+    d->widgetCreator = d->recreator;
+    d->recreator = nullptr;
+    delete guest;
+    Q_EMIT widgetChanged(nullptr);
+
+    return true;
+}
+
 bool DockWidgetBase::isFloating() const
 {
     if (isWindow())
@@ -251,6 +357,8 @@ void DockWidgetBase::setFloating(bool floats)
     if ((floats && alreadyFloating) || (!floats && !alreadyFloating))
         return; // Nothing to do
 
+    KDDW_LOG_EVENT(LogEvent::DockWidgetFloated, this, floats);
+
     if (floats) {
         d->saveTabIndex();
         if (isTabbed()) {
@@ -273,16 +381,18 @@ void DockWidgetBase::setFloating(bool floats)
             // TODO: Restore to preferred place ?
         }
     }
+
+    DockRegistry::self()->notifyLayoutEdited();
 }
 
 QAction *DockWidgetBase::toggleAction() const
 {
-    return d->toggleAction;
+    return d->ensureToggleAction();
 }
 
 QAction *DockWidgetBase::floatAction() const
 {
-    return d->floatAction;
+    return d->ensureFloatAction();
 }
 
 QString DockWidgetBase::uniqueName() const
@@ -378,7 +488,7 @@ TitleBar *DockWidgetBase::titleBar() const
 
 bool DockWidgetBase::isOpen() const
 {
-    return d->toggleAction->isChecked();
+    return d->isOpen;
 }
 
 QString DockWidgetBase::affinityName() const
@@ -386,6 +496,26 @@ QString DockWidgetBase::affinityName() const
     return d->affinityName;
 }
 
+int DockWidgetBase::affinityId() const
+{
+    return d->affinityId;
+}
+
+void DockWidgetBase::setLayoutMinimumSize(QSize sz)
+{
+    if (sz == d->layoutMinimumSize)
+        return;
+
+    d->layoutMinimumSize = sz;
+    if (Frame *f = frame())
+        f->invalidateMinSize();
+}
+
+QSize DockWidgetBase::layoutMinimumSize() const
+{
+    return d->layoutMinimumSize;
+}
+
 void DockWidgetBase::show()
 {
     if (isWindow() && (lastPosition()->m_wasFloating || !lastPosition()->isValid())) {
@@ -397,6 +527,151 @@ void DockWidgetBase::show()
     }
 }
 
+void DockWidgetBase::showDockWidgets(const DockWidgetBase::List &dockWidgets)
+{
+    KDDW_TRACE_SCOPE("DockWidgetBase::showDockWidgets");
+
+    // One transaction per layout that will get a placeholder restored
+    QVector<QPointer<MultiSplitterLayout>> layouts;
+    for (DockWidgetBase *dw : dockWidgets) {
+        if (dw->isOpen())
+            continue;
+
+        Item *item = dw->lastPosition()->layoutItem();
+        MultiSplitterLayout *layout = item ? item->layout() : nullptr;
+        if (layout && !layouts.contains(layout)) {
+            layout->beginTransaction();
+            layouts.push_back(layout);
+        }
+    }
+
+    for (DockWidgetBase *dw : dockWidgets)
+        dw->show();
+
+    for (const QPointer<MultiSplitterLayout> &layout : qAsConst(layouts)) {
+        if (layout)
+            layout->endTransaction();
+    }
+}
+
+namespace {
+///@brief The dock widgets of one of the frames being floated, see DockWidgetBase::floatDockWidgets()
+struct FloatingGroup
+{
+    Frame *sourceFrame;
+    QRect globalGeometry; // Null if the source frame wasn't visible
+    DockWidgetBase::List dockWidgets;
+    Frame *frame; // The frame created in the new floating window
+};
+
+///@brief Returns where @p geo is in relation to @p relativeTo
+Location locationRelativeTo(QRect geo, QRect relativeTo)
+{
+    if (geo.left() > relativeTo.right())
+        return Location_OnRight;
+    if (geo.right() < relativeTo.left())
+        return Location_OnLeft;
+    if (geo.top() > relativeTo.bottom())
+        return Location_OnBottom;
+
+    return Location_OnTop;
+}
+}
+
+QWidgetOrQuick *DockWidgetBase::floatDockWidgets(const DockWidgetBase::List &dockWidgets)
+{
+    KDDW_TRACE_SCOPE("DockWidgetBase::floatDockWidgets");
+    if (dockWidgets.isEmpty())
+        return nullptr;
+
+    const int affinityId = dockWidgets.constFirst()->affinityId();
+    for (DockWidgetBase *dw : dockWidgets) {
+        if (dw->affinityId() != affinityId) {
+            qWarning() << Q_FUNC_INFO << "Refusing to float dock widgets with different affinities together" << dw;
+            return nullptr;
+        }
+
+        if (dw->options() & DockWidgetBase::Option_NotDockable) {
+            qWarning() << Q_FUNC_INFO << "Refusing to nest non-dockable widget" << dw;
+            return nullptr;
+        }
+    }
+
+    // Record the arrangement before anything moves. Dock widgets sharing a frame stay tabbed.
+    QVector<FloatingGroup> groups;
+    for (DockWidgetBase *dw : dockWidgets) {
+        Frame *sourceFrame = dw->frame();
+        auto it = std::find_if(groups.begin(), groups.end(), [sourceFrame] (const FloatingGroup &group) {
+            return sourceFrame && group.sourceFrame == sourceFrame;
+        });
+
+        if (it == groups.end()) {
+            const QRect geo = sourceFrame && sourceFrame->isVisible() ? QRect(sourceFrame->mapToGlobal(QPoint(0, 0)), sourceFrame->size())
+                                                                       : QRect();
+            groups.push_back({ sourceFrame, geo, { dw }, nullptr });
+        } else {
+            it->dockWidgets.push_back(dw);
+        }
+
+        dw->d->saveTabIndex();
+    }
+
+    // Reading order, so each frame is docked next to one that's already there
+    std::stable_sort(groups.begin(), groups.end(), [] (const FloatingGroup &g1, const FloatingGroup &g2) {
+        return g1.globalGeometry.top() < g2.globalGeometry.top()
+               || (g1.globalGeometry.top() == g2.globalGeometry.top() && g1.globalGeometry.left() < g2.globalGeometry.left());
+    });
+
+    FrameworkWidgetFactory *factory = Config::self().frameworkWidgetFactory();
+    FloatingGroup &first = groups.first();
+    first.frame = factory->createFrame();
+    for (DockWidgetBase *dw : qAsConst(first.dockWidgets))
+        first.frame->addWidget(dw);
+
+    FloatingWindow *floatingWindow = factory->createFloatingWindow(first.frame);
+    DropArea *dropArea = floatingWindow->dropArea();
+    MultiSplitterLayout *layout = dropArea->multiSplitterLayout();
+
+    QRect windowGeometry = first.globalGeometry;
+    layout->beginTransaction();
+    for (int i = 1; i < groups.size(); ++i) {
+        FloatingGroup &group = groups[i];
+        group.frame = factory->createFrame(dropArea);
+        for (DockWidgetBase *dw : qAsConst(group.dockWidgets))
+            group.frame->addWidget(dw);
+
+        // Dock it next to the closest frame that's already in
+        const FloatingGroup *closest = nullptr;
+        int closestDistance = 0;
+        if (group.globalGeometry.isValid()) {
+            for (int j = 0; j < i; ++j) {
+                if (!groups.at(j).globalGeometry.isValid())
+                    continue;
+                const int distance = (groups.at(j).globalGeometry.center() - group.globalGeometry.center()).manhattanLength();
+                if (!closest || distance < closestDistance) {
+                    closest = &groups.at(j);
+                    closestDistance = distance;
+                }
+            }
+        }
+
+        if (closest) {
+            layout->addWidget(group.frame, locationRelativeTo(group.globalGeometry, closest->globalGeometry), closest->frame);
+            windowGeometry = windowGeometry.united(group.globalGeometry);
+        } else {
+            layout->addWidget(group.frame, Location_OnRight);
+        }
+    }
+    layout->endTransaction();
+
+    if (windowGeometry.isValid())
+        floatingWindow->setGeometry(windowGeometry);
+    floatingWindow->show();
+
+    DockRegistry::self()->notifyLayoutEdited();
+    return floatingWindow;
+}
+
 void DockWidgetBase::raise()
 {
     if (!isOpen())
@@ -404,10 +679,8 @@ void DockWidgetBase::raise()
 
     setAsCurrentTab();
 
-    if (auto fw = qobject_cast<FloatingWindow*>(window())) {
-        fw->raise();
-        fw->activateWindow();
-    }
+    if (auto fw = qobject_cast<FloatingWindow*>(window()))
+        DockRegistry::self()->raiseAndActivateLater(fw);
 }
 
 void DockWidgetBase::setAffinityName(const QString &name)
@@ -423,6 +696,7 @@ void DockWidgetBase::setAffinityName(const QString &name)
     }
 
     d->affinityName = name;
+    d->affinityId = DockRegistry::self()->affinityId(name);
 }
 
 FloatingWindow *DockWidgetBase::morphIntoFloatingWindow()
@@ -488,6 +762,53 @@ LastPosition *DockWidgetBase::lastPosition() const
     return &d->m_lastPosition;
 }
 
+bool DockWidgetBase::isEffectivelyVisible() const
+{
+    return d->isEffectivelyVisible;
+}
+
+static bool isInMinimizedWindow(const DockWidgetBase *dw)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    return dw->window()->isMinimized();
+#else
+    QWindow *window = dw->windowHandle();
+    return window && window->windowState() == Qt::WindowMinimized;
+#endif
+}
+
+void DockWidgetBase::updateEffectiveVisibility()
+{
+    Frame *f = frame();
+    const int threshold = Config::self().collapseThreshold();
+    const bool isEffectivelyVisible = isVisible() && (!f || f->currentDockWidget() == this)
+                                      && width() >= threshold && height() >= threshold
+                                      && !isInMinimizedWindow(this);
+    if (isEffectivelyVisible == d->isEffectivelyVisible)
+        return;
+
+    d->isEffectivelyVisible = isEffectivelyVisible;
+    Q_EMIT effectiveVisibilityChanged(isEffectivelyVisible);
+}
+
+bool DockWidgetBase::isInInteractiveOperation() const
+{
+    return d->interactiveOperationDepth > 0;
+}
+
+void DockWidgetBase::beginInteractiveOperation()
+{
+    if (d->interactiveOperationDepth++ == 0)
+        Q_EMIT interactiveOperationStarted();
+}
+
+void DockWidgetBase::endInteractiveOperation()
+{
+    Q_ASSERT(d->interactiveOperationDepth > 0);
+    if (--d->interactiveOperationDepth == 0)
+        Q_EMIT interactiveOperationFinished(size());
+}
+
 QPoint DockWidgetBase::Private::defaultCenterPosForFloating()
 {
     MainWindowBase::List mainWindows = DockRegistry::self()->mainwindows();
@@ -505,7 +826,8 @@ void DockWidgetBase::Private::updateTitle()
         q->window()->setWindowTitle(title);
 
 
-    toggleAction->setText(title);
+    if (toggleAction)
+        toggleAction->setText(title);
 }
 
 void DockWidgetBase::Private::updateIcon()
@@ -526,15 +848,29 @@ void DockWidgetBase::Private::updateToggleAction()
 {
     QScopedValueRollback<bool> recursionGuard(m_updatingToggleAction, true); // Guard against recursiveness
     m_updatingToggleAction = true;
-    if ((q->isVisible() || parentTabWidget()) && !toggleAction->isChecked()) {
-        toggleAction->setChecked(true);
-    } else if ((!q->isVisible() && !parentTabWidget()) && toggleAction->isChecked()) {
-        toggleAction->setChecked(false);
-    }
+    isOpen = q->isVisible() || parentTabWidget();
+    if (toggleAction && toggleAction->isChecked() != isOpen)
+        toggleAction->setChecked(isOpen);
+
+    updateHibernationTimer();
+}
+
+void DockWidgetBase::Private::updateHibernationTimer()
+{
+    if (!hibernationTimer)
+        return;
+
+    if (isOpen || !recreator || hibernationTimer->interval() <= 0)
+        hibernationTimer->stop();
+    else if (!hibernationTimer->isActive())
+        hibernationTimer->start();
 }
 
 void DockWidgetBase::Private::updateFloatAction()
 {
+    if (!floatAction)
+        return; // Computed when created instead
+
     QScopedValueRollback<bool> recursionGuard(m_updatingFloatAction, true); // Guard against recursiveness
 
     if (q->isFloating()) {
@@ -652,11 +988,22 @@ void DockWidgetBase::onParentChanged()
     Q_EMIT parentChanged();
     d->updateToggleAction();
     d->updateFloatAction();
+    DockRegistry::self()->invalidateDockWidgetStates();
 }
 
 void DockWidgetBase::onShown(bool spontaneous)
 {
-    Q_EMIT shown();
+    KDDW_LOG_EVENT(LogEvent::DockWidgetShown, this);
+    ensureWidgetCreated();
+    // The actions follow right away, only the public signal is deferred during a batch
+    d->onDockWidgetShown();
+    if (!DockRegistry::self()->deferVisibilityNotification(this, /*visible=*/true))
+        Q_EMIT shown();
+    DockRegistry::self()->invalidateDockWidgetStates();
+    updateEffectiveVisibility();
+
+    if (!spontaneous)
+        DockRegistry::bumpLayoutGeneration();
 
     if (Frame *f = frame()) {
         if (!spontaneous) {
@@ -672,7 +1019,15 @@ void DockWidgetBase::onShown(bool spontaneous)
 
 void DockWidgetBase::onHidden(bool spontaneous)
 {
-    Q_EMIT hidden();
+    KDDW_LOG_EVENT(LogEvent::DockWidgetHidden, this);
+    d->onDockWidgetHidden();
+    if (!DockRegistry::self()->deferVisibilityNotification(this, /*visible=*/false))
+        Q_EMIT hidden();
+    DockRegistry::self()->invalidateDockWidgetStates();
+    updateEffectiveVisibility();
+
+    if (!spontaneous)
+        DockRegistry::bumpLayoutGeneration();
 
     if (Frame *f = frame()) {
         if (!spontaneous) {
@@ -687,8 +1042,10 @@ void DockWidgetBase::onClosed(QCloseEvent *e)
     if (d->widget)
         qApp->sendEvent(d->widget, e); // Give a change for the widget to ignore
 
-    if (e->isAccepted())
+    if (e->isAccepted()) {
         d->close();
+        DockRegistry::self()->notifyLayoutEdited();
+    }
 }
 
 DockWidgetBase *DockWidgetBase::deserialize(const LayoutSaver::DockWidget::Ptr &saved)
@@ -710,6 +1067,7 @@ DockWidgetBase *DockWidgetBase::deserialize(const LayoutSaver::DockWidget::Ptr &
             qWarning() << Q_FUNC_INFO << "Affinity name changed from" << dw->affinityName()
                        << "; to" << saved->affinityName;
             dw->d->affinityName = saved->affinityName;
+            dw->d->affinityId = DockRegistry::self()->affinityId(saved->affinityName);
         }
 
     } else {
@@ -52,6 +52,7 @@ class LayoutSaver;
 class TabWidget;
 class TitleBar;
 class MainWindowBase;
+class InteractiveOperation;
 
 /**
  * @brief The DockWidget base-class. DockWidget and DockWidgetBase are only
@@ -66,11 +67,21 @@ class DOCKS_EXPORT DockWidgetBase : public QWidgetOrQuick
 public:
     typedef QVector<DockWidgetBase *> List;
 
+    ///@brief A function that creates the guest widget of @p dockWidget. See setWidgetCreator().
+    typedef QWidget* (*WidgetCreatorFunc)(DockWidgetBase *dockWidget);
+
     ///@brief DockWidget options to pass at construction time
     enum Option {
         Option_None = 0, ///< No option, the default
         Option_NotClosable = 1, /// The DockWidget can't be closed on the [x], only programatically
-        Option_NotDockable = 2 ///< The DockWidget can't be docked, it's always floating
+        Option_NotDockable = 2, ///< The DockWidget can't be docked, it's always floating
+        /**
+         * Hosts the guest widget inside a persistent native window, which is embedded in the dock widget.
+         * When floating or docking only the embedding container changes window, so guests using
+         * QOpenGLWidget or native child windows keep their context instead of having it recreated.
+         * QtWidgets only. Focus chain and styling don't cross the native window boundary.
+         */
+        Option_PersistentNativeContainer = 4
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -130,9 +141,48 @@ public:
 
     /**
      * @brief returns the widget which this dock widget hosts
+     * nullptr if a WidgetCreatorFunc was set and the widget wasn't needed yet.
      */
     QWidget *widget() const;
 
+    /**
+     * @brief Sets a function which creates the guest widget the first time this dock widget is shown,
+     * or becomes the current tab. Use it instead of setWidget() for heavy widgets which might never be looked at,
+     * like the hidden tabs of a big restored layout.
+     *
+     * Can only be called if setWidget() wasn't called.
+     */
+    void setWidgetCreator(WidgetCreatorFunc creator);
+
+    /**
+     * @brief Creates the guest widget now, via the function passed to setWidgetCreator(),
+     * if it wasn't created yet. Does nothing otherwise.
+     */
+    void ensureWidgetCreated();
+
+    /**
+     * @brief Sets after how long being closed the guest widget is destroyed, to save memory.
+     *
+     * The guest is recreated by the function passed to setWidgetCreator() the next time this dock widget
+     * is shown, so hibernation only applies to guests created by one. aboutToHibernate() is emitted
+     * before the guest is deleted, so the application can save its state.
+     *
+     * @param msecs How long the dock widget needs to stay closed. 0, the default, disables hibernation.
+     * @sa hibernate()
+     */
+    void setHibernationTimeout(int msecs);
+
+    ///@brief returns the timeout set with setHibernationTimeout()
+    int hibernationTimeout() const;
+
+    /**
+     * @brief Destroys the guest widget now, instead of waiting for the hibernation timeout.
+     *
+     * Does nothing if the dock widget is open, or if its guest wasn't created by a WidgetCreatorFunc.
+     * @return whether the guest was destroyed
+     */
+    bool hibernate();
+
     /**
      * @brief Returns whether the dock widget is floating.
      * Floating means it's not docked and has a window of its own.
@@ -249,6 +299,16 @@ public:
      */
     bool isOpen() const;
 
+    /**
+     * @brief Returns whether the user can actually see this dock widget.
+     *
+     * An open dock widget isn't effectively visible while it's not the current tab of its frame,
+     * while it's collapsed below Config::collapseThreshold(), or while its window is minimized.
+     * Guests can use it to throttle background work, like rendering or streaming data.
+     * @sa effectiveVisibilityChanged()
+     */
+    bool isEffectivelyVisible() const;
+
     /**
      * @brief Sets the affinity name. Dock widgets can only dock into dock widgets of the same affinity.
      *
@@ -273,18 +333,72 @@ public:
      */
     QString affinityName() const;
 
+    ///@internal
+    ///@brief Returns the id DockRegistry interned affinityName() as. 0 for the empty affinity.
+    int affinityId() const;
+
+    /**
+     * @brief Declares the minimum size of the frame holding this dock widget.
+     *
+     * By default the layout asks the frame's widgets for their minimumSizeHint(), which can be
+     * expensive for deep widget trees. If the min size is known upfront then declaring it saves
+     * that query. The size is the frame's, so it should account for the title bar and tab bar.
+     *
+     * When tabbed, the declared size is only used if all dock widgets of the frame declared one.
+     * Pass an invalid QSize, the default, to go back to querying the widgets.
+     */
+    void setLayoutMinimumSize(QSize);
+
+    ///@brief getter for @ref setLayoutMinimumSize
+    QSize layoutMinimumSize() const;
+
     /// @brief Equivalent to QWidget::show(), but it's optimized to reduce flickering on some platforms
     void show();
 
+    /**
+     * @brief Shows all of @p dockWidgets, like calling show() on each of them.
+     *
+     * The layouts they're restored into are changed inside a single transaction, so each
+     * layout is solved and its frames are resized only once, at the end.
+     * Useful for opening a set of dock widgets, like a perspective, all at once.
+     * @sa MainWindowBase::LayoutTransaction
+     */
+    static void showDockWidgets(const DockWidgetBase::List &dockWidgets);
+
+    /**
+     * @brief Floats all of @p dockWidgets into a single new floating window.
+     *
+     * Dock widgets that were tabbed together stay tabbed, and the frames keep their relative
+     * arrangement, as far as it can be expressed by docking them next to each other.
+     * The new window's layout is built in a single transaction.
+     * The dock widgets must have the same affinity and can't have Option_NotDockable.
+     *
+     * @return the created window, which is also what window() returns for each of them,
+     * or nullptr if @p dockWidgets can't be floated together
+     */
+    static QWidgetOrQuick *floatDockWidgets(const DockWidgetBase::List &dockWidgets);
+
     /// @brief Brings the dock widget to the front.
     ///
     /// This means:
     /// - If the dock widget is tabbed with other dock widgets but its tab is not current, it's made current.
-    /// - If the dock widget is floating, QWindow::raise() is called.
+    /// - If the dock widget is floating, its window is raised and activated.
     ///
     /// This only applies if the dock widget is already open. If closed, does nothing.
+    ///
+    /// The tab is made current right away, but raising and activating the window is deferred to the
+    /// next event loop iteration. If several windows are raised meanwhile, only the last one is.
     void raise();
 
+    /**
+     * @brief Returns whether the user is interactively resizing this dock widget.
+     *
+     * That's the case while dragging a separator of its layout, dragging its window, or resizing
+     * its floating window with the mouse.
+     * @sa interactiveOperationStarted(), interactiveOperationFinished()
+     */
+    bool isInInteractiveOperation() const;
+
 Q_SIGNALS:
     ///@brief signal emitted when the parent changed
     void parentChanged();
@@ -304,10 +418,26 @@ Q_SIGNALS:
     ///@brief emitted when the hosted widget changed
     void widgetChanged(QWidget*);
 
+    ///@brief emitted before @p guest is deleted by hibernate(), so its state can be saved. See setHibernationTimeout().
+    void aboutToHibernate(QWidget *guest);
+
     ///@brief emitted when the options change
     ///@sa setOptions(), options()
     void optionsChanged(Options);
 
+    /**
+     * @brief emitted when an interactive operation which might resize this dock widget on every
+     * mouse move starts. Guests with expensive rendering can skip it until interactiveOperationFinished().
+     * @sa isInInteractiveOperation()
+     */
+    void interactiveOperationStarted();
+
+    ///@brief emitted when the interactive operation ends, with the dock widget's final @p size
+    void interactiveOperationFinished(QSize size);
+
+    ///@brief emitted when isEffectivelyVisible() changes
+    void effectiveVisibilityChanged(bool visible);
+
 protected:
     void onParentChanged();
     void onShown(bool spontaneous);
@@ -346,6 +476,8 @@ private:
     friend class KDDockWidgets::Item;
     friend class KDDockWidgets::DockRegistry;
     friend class KDDockWidgets::LayoutSaver;
+    friend class KDDockWidgets::InteractiveOperation;
+    friend class KDDockWidgets::FloatingWindow;
 
     /**
      * @brief the Frame which contains this dock widgets.
@@ -371,6 +503,13 @@ private:
     ///@brief returns the last position, just for tests. TODO Make tests just use the d-pointer.
     LastPosition *lastPosition() const;
 
+    ///@brief Called by InteractiveOperation. Operations can be nested, only the outermost one emits.
+    void beginInteractiveOperation();
+    void endInteractiveOperation();
+
+    ///@brief Recomputes isEffectivelyVisible(), and emits effectiveVisibilityChanged() if it changed
+    void updateEffectiveVisibility();
+
     class Private;
     Private *const d;
 };
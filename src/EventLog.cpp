@@ -0,0 +1,244 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief A ring buffer of compact layout events that can be dumped to disk, for example on crash.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "EventLog.h"
+#include "EventLog_p.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVector>
+
+#include <cstdio>
+
+using namespace KDDockWidgets;
+
+bool KDDockWidgets::g_eventLogRecording = false;
+
+namespace {
+
+struct LoggedEvent
+{
+    qint64 timestampNs;
+    quint64 object;
+    qint32 arg1;
+    qint32 arg2;
+    quint16 id;
+    quint16 padding[3];
+};
+
+struct EventRing
+{
+    QElapsedTimer timer;
+    QVector<LoggedEvent> events; // Allocated by start(), never resized while recording
+    quint64 written = 0; // Total since start(), the next slot is written % capacity
+    QString crashDumpFile;
+    QtMessageHandler previousHandler = nullptr;
+    bool handlerInstalled = false;
+};
+
+}
+
+Q_DECLARE_TYPEINFO(LoggedEvent, Q_PRIMITIVE_TYPE);
+static_assert(sizeof(LoggedEvent) == 32, "The dump format relies on events being 32 bytes");
+
+static EventRing &ring()
+{
+    static EventRing r;
+    return r;
+}
+
+static const char *eventName(LogEvent event)
+{
+    switch (event) {
+    case LogEvent::DockWidgetShown:
+        return "DockWidgetShown";
+    case LogEvent::DockWidgetHidden:
+        return "DockWidgetHidden";
+    case LogEvent::DockWidgetFloated:
+        return "DockWidgetFloated";
+    case LogEvent::FloatingWindowCreated:
+        return "FloatingWindowCreated";
+    case LogEvent::FloatingWindowDestroyed:
+        return "FloatingWindowDestroyed";
+    case LogEvent::WidgetAdded:
+        return "WidgetAdded";
+    case LogEvent::WindowDropped:
+        return "WindowDropped";
+    case LogEvent::DockWidgetDropped:
+        return "DockWidgetDropped";
+    case LogEvent::LayoutResized:
+        return "LayoutResized";
+    case LogEvent::AnchorCreated:
+        return "AnchorCreated";
+    case LogEvent::AnchorDestroyed:
+        return "AnchorDestroyed";
+    case LogEvent::AnchorMoved:
+        return "AnchorMoved";
+    case LogEvent::PlaceholderAdded:
+        return "PlaceholderAdded";
+    case LogEvent::PlaceholderRemoved:
+        return "PlaceholderRemoved";
+    case LogEvent::PlaceholderRestored:
+        return "PlaceholderRestored";
+    case LogEvent::PlaceholdersDropped:
+        return "PlaceholdersDropped";
+    case LogEvent::DragStateEntered:
+        return "DragStateEntered";
+    case LogEvent::RestoreStarted:
+        return "RestoreStarted";
+    case LogEvent::RestoreFinished:
+        return "RestoreFinished";
+    case LogEvent::Count:
+        break;
+    }
+
+    return nullptr;
+}
+
+void KDDockWidgets::recordEvent(LogEvent event, const void *object, qint32 arg1, qint32 arg2)
+{
+    EventRing &r = ring();
+    LoggedEvent &ev = r.events[int(r.written % quint64(r.events.size()))];
+    ev.timestampNs = r.timer.nsecsElapsed();
+    ev.object = quint64(quintptr(object));
+    ev.arg1 = arg1;
+    ev.arg2 = arg2;
+    ev.id = quint16(event);
+    ++r.written;
+}
+
+template <typename T>
+static void appendRaw(QByteArray &data, T value)
+{
+    data.append(reinterpret_cast<const char *>(&value), int(sizeof(value)));
+}
+
+static void dumpOnFatal(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    EventRing &r = ring();
+    if (type == QtFatalMsg && !r.crashDumpFile.isEmpty()) {
+        // Don't record whatever the dumping itself triggers, and don't dump twice
+        g_eventLogRecording = false;
+        const QString filename = r.crashDumpFile;
+        r.crashDumpFile.clear();
+        EventLog::dump(filename);
+    }
+
+    if (r.previousHandler)
+        r.previousHandler(type, context, message);
+    else
+        std::fprintf(stderr, "%s\n", qPrintable(qFormatLogMessage(type, context, message)));
+}
+
+static void startFromEnvironment()
+{
+    if (qEnvironmentVariableIsEmpty("KDDOCKWIDGETS_EVENT_LOG_FILE"))
+        return;
+
+    EventLog::start();
+    EventLog::setCrashDumpFile(QString::fromLocal8Bit(qgetenv("KDDOCKWIDGETS_EVENT_LOG_FILE")));
+}
+Q_COREAPP_STARTUP_FUNCTION(startFromEnvironment)
+
+void EventLog::start(int capacity)
+{
+    if (capacity <= 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid capacity" << capacity;
+        return;
+    }
+
+    EventRing &r = ring();
+    r.events = QVector<LoggedEvent>(capacity);
+    r.written = 0;
+    r.timer.start();
+    g_eventLogRecording = true;
+}
+
+void EventLog::stop()
+{
+    g_eventLogRecording = false;
+}
+
+bool EventLog::isRecording()
+{
+    return g_eventLogRecording;
+}
+
+int EventLog::eventCount()
+{
+    const EventRing &r = ring();
+    return int(qMin(r.written, quint64(r.events.size())));
+}
+
+bool EventLog::dump(const QString &filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << filename << file.errorString();
+        return false;
+    }
+
+    const EventRing &r = ring();
+    const int count = eventCount();
+
+    QByteArray data = "KDDWELOG";
+    appendRaw(data, quint32(1));
+    appendRaw(data, quint32(LogEvent::Count) - 1);
+    for (quint16 id = 1; id < quint16(LogEvent::Count); ++id) {
+        const char *name = eventName(LogEvent(id));
+        const quint16 length = quint16(qstrlen(name));
+        appendRaw(data, id);
+        appendRaw(data, length);
+        data.append(name, length);
+    }
+
+    appendRaw(data, quint32(count));
+    if (count > 0) {
+        // Oldest first. When the ring has wrapped around, the oldest one is the next to be overwritten
+        const int capacity = r.events.size();
+        const int oldest = r.written > quint64(capacity) ? int(r.written % quint64(capacity)) : 0;
+        const auto bytes = reinterpret_cast<const char *>(r.events.constData());
+        const int eventSize = int(sizeof(LoggedEvent));
+        const int tailCount = qMin(count, capacity - oldest);
+        data.append(bytes + oldest * eventSize, tailCount * eventSize);
+        data.append(bytes, (count - tailCount) * eventSize);
+    }
+
+    return file.write(data) == data.size();
+}
+
+void EventLog::setCrashDumpFile(const QString &filename)
+{
+    EventRing &r = ring();
+    r.crashDumpFile = filename;
+    if (!filename.isEmpty() && !r.handlerInstalled) {
+        r.previousHandler = qInstallMessageHandler(dumpOnFatal);
+        r.handlerInstalled = true;
+    }
+}
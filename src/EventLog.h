@@ -0,0 +1,88 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief A ring buffer of compact layout events that can be dumped to disk, for example on crash.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_EVENTLOG_H
+#define KD_DOCKWIDGETS_EVENTLOG_H
+
+#include "docks_export.h"
+
+#include <QString>
+
+namespace KDDockWidgets
+{
+
+/**
+ * @brief Records the last few thousand docking, sizing, anchor, placeholder and top-level events
+ * in a fixed-size binary ring buffer, so layout corruption and slowness can be investigated on
+ * machines where the logging categories can't be enabled.
+ *
+ * Unlike Stats and Tracing this is always compiled in. While not recording, each call site costs
+ * a single branch. While recording, each event is 32 bytes, written into preallocated memory.
+ *
+ * Alternatively to calling start(), set the KDDOCKWIDGETS_EVENT_LOG_FILE environment variable to
+ * a file name: recording then starts with the application and the buffer is dumped to that file
+ * if a Q_ASSERT fails or qFatal() is called.
+ *
+ * The dump starts with the "KDDWELOG" magic, followed, in host byte order, by a quint32 format
+ * version, a quint32 number of event names, each one as a quint16 id, a quint16 length and that
+ * many Latin-1 bytes, and a quint32 number of events, oldest first. Each event is a qint64
+ * timestamp in nanoseconds since start(), a quint64 object address, two qint32 arguments,
+ * a quint16 event id and 6 bytes of padding.
+ */
+class DOCKS_EXPORT EventLog
+{
+public:
+    ///@brief Discards anything recorded so far and starts recording. Only the last @p capacity events are kept
+    static void start(int capacity = 4096);
+
+    ///@brief Stops recording. What was recorded is kept until the next start(), so it can still be dumped
+    static void stop();
+
+    ///@brief Returns whether we're recording, i.e. start() was called but stop() wasn't
+    static bool isRecording();
+
+    ///@brief Returns how many events are in the buffer, at most the capacity passed to start()
+    static int eventCount();
+
+    /**
+     * @brief Writes the buffer to @p filename, in the binary format described above
+     * @return false if the file couldn't be written
+     */
+    static bool dump(const QString &filename);
+
+    /**
+     * @brief Dumps the buffer to @p filename when a Q_ASSERT fails or qFatal() is called
+     *
+     * Installs a message handler which forwards to the previously installed one.
+     * Pass an empty string to stop dumping on crash.
+     */
+    static void setCrashDumpFile(const QString &filename);
+};
+
+}
+
+#endif
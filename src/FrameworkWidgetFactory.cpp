@@ -28,11 +28,13 @@
 
 #ifdef KDDOCKWIDGETS_QTWIDGETS
 # include "indicators/ClassicIndicators_p.h"
+# include "indicators/OverlayIndicators_p.h"
 # include "widgets/FrameWidget_p.h"
 # include "widgets/TitleBarWidget_p.h"
 # include "widgets/TabBarWidget_p.h"
 # include "widgets/TabWidgetWidget_p.h"
 # include "widgets/SeparatorWidget_p.h"
+# include "widgets/SeparatorOverlay_p.h"
 # include "widgets/FloatingWindowWidget_p.h"
 #else
 # include "quick/FrameQuick_p.h"
@@ -42,10 +44,15 @@
 # include "quick/TabWidgetQuick_p.h"
 # include "quick/FloatingWindowQuick_p.h"
 # include "quick/SeparatorQuick_p.h"
+
+# include <QQmlComponent>
+# include <QDebug>
 #endif
 
 using namespace KDDockWidgets;
 
+DefaultWidgetFactory::DropIndicatorType DefaultWidgetFactory::s_dropIndicatorType = DefaultWidgetFactory::DropIndicatorType::Classic;
+
 FrameworkWidgetFactory::~FrameworkWidgetFactory()
 {
 }
@@ -78,21 +85,37 @@ TabWidget *DefaultWidgetFactory::createTabWidget(Frame *parent) const
 
 Separator *DefaultWidgetFactory::createSeparator(Anchor *anchor, QWidgetAdapter *parent) const
 {
+    if (Config::self().flags() & Config::Flag_SeparatorOverlay)
+        return new OverlaidSeparatorWidget(anchor, parent);
+
     return new SeparatorWidget(anchor, parent);
 }
 
 FloatingWindow *DefaultWidgetFactory::createFloatingWindow(MainWindowBase *parent) const
 {
+    if (auto fw = FloatingWindow::takeRecycled(parent))
+        return fw;
+
     return new FloatingWindowWidget(parent);
 }
 
 FloatingWindow *DefaultWidgetFactory::createFloatingWindow(Frame *frame, MainWindowBase *parent) const
 {
+    if (auto fw = FloatingWindow::takeRecycled(frame, parent))
+        return fw;
+
     return new FloatingWindowWidget(frame, parent);
 }
 
 DropIndicatorOverlayInterface *DefaultWidgetFactory::createDropIndicatorOverlay(DropArea *dropArea) const
 {
+    switch (s_dropIndicatorType) {
+    case DropIndicatorType::Classic:
+        break;
+    case DropIndicatorType::Overlay:
+        return new OverlayIndicators(dropArea);
+    }
+
     return new ClassicIndicators(dropArea);
 }
 #else
@@ -141,4 +164,33 @@ DropIndicatorOverlayInterface *DefaultWidgetFactory::createDropIndicatorOverlay(
 {
     return nullptr;
 }
+
+QQmlComponent *FrameworkWidgetFactory::qmlComponent(const QUrl &url) const
+{
+    QQmlEngine *engine = Config::self().qmlEngine();
+    if (!engine) {
+        qWarning() << Q_FUNC_INFO << "No QML engine set, see Config::setQmlEngine()";
+        return nullptr;
+    }
+
+    QPointer<QQmlComponent> &component = m_qmlComponents[engine][url];
+    if (!component) {
+        // Also covers a deleted engine whose address got reused, the QPointer is null then
+        component = new QQmlComponent(engine, url, engine);
+        if (component->isError())
+            qWarning() << Q_FUNC_INFO << "Failed to load" << url << component->errors();
+    }
+
+    return component;
+}
+
+void FrameworkWidgetFactory::precompileQmlComponents() const
+{
+    // TitleBar.qml and TitleBarBase.qml are compiled as dependencies of Frame.qml
+    qmlComponent(QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Frame.qml")));
+
+    const QUrl separatorUrl = Config::self().separatorQmlUrl();
+    if (!separatorUrl.isEmpty())
+        qmlComponent(separatorUrl);
+}
 #endif
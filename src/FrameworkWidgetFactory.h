@@ -25,6 +25,17 @@
 #include "KDDockWidgets.h"
 #include "QWidgetAdapter.h"
 
+#ifdef KDDOCKWIDGETS_QTQUICK
+# include <QHash>
+# include <QPointer>
+# include <QUrl>
+
+QT_BEGIN_NAMESPACE
+class QQmlComponent;
+class QQmlEngine;
+QT_END_NAMESPACE
+#endif
+
 /**
  * @file
  * @brief A factory class for allowing the user to customize some internal widgets.
@@ -122,6 +133,27 @@ public:
     ///       Override to provide your own DropIndicatorOverlayInterface sub-class.
     ///@param dropArea Just forward to DropIndicatorOverlayInterface's constructor.
     virtual DropIndicatorOverlayInterface *createDropIndicatorOverlay(DropArea *dropArea) const = 0;
+
+#ifdef KDDOCKWIDGETS_QTQUICK
+    /**
+     * @brief Returns the component for @p url, for Config::qmlEngine()
+     *
+     * Components are compiled once per engine and shared by every frame, titlebar and separator,
+     * instead of going through the component loader each time one is created.
+     * The components are owned by the engine they were created for.
+     */
+    QQmlComponent *qmlComponent(const QUrl &url) const;
+
+    /**
+     * @brief Compiles the framework's QML components now, so creating the first frame doesn't pay for it.
+     *
+     * Optional. Call it at startup, after Config::setQmlEngine().
+     */
+    void precompileQmlComponents() const;
+
+private:
+    mutable QHash<QQmlEngine *, QHash<QUrl, QPointer<QQmlComponent>>> m_qmlComponents;
+#endif
 };
 
 /**
@@ -130,6 +162,12 @@ public:
 class DOCKS_EXPORT DefaultWidgetFactory : public FrameworkWidgetFactory
 {
 public:
+    ///@brief The drop indicators created by @ref createDropIndicatorOverlay()
+    enum class DropIndicatorType {
+        Classic = 0, ///< The default. A top-level with a child widget per indicator, and a QRubberBand
+        Overlay ///< Looks the same, but everything is painted by a single top-level, so hovering doesn't move any widget
+    };
+
     Frame *createFrame(QWidgetOrQuick *parent, FrameOptions) const override;
     TitleBar *createTitleBar(Frame *) const override;
     TitleBar *createTitleBar(FloatingWindow *) const override;
@@ -139,6 +177,9 @@ public:
     FloatingWindow *createFloatingWindow(MainWindowBase *parent = nullptr) const override;
     FloatingWindow *createFloatingWindow(Frame *frame, MainWindowBase *parent = nullptr) const override;
     DropIndicatorOverlayInterface *createDropIndicatorOverlay(DropArea*) const override;
+
+    ///@brief Which drop indicators to create. Set it at startup, before creating any MainWindow
+    static DropIndicatorType s_dropIndicatorType;
 };
 
 }
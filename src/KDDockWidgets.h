@@ -63,9 +63,22 @@ namespace KDDockWidgets
         RestoreOption_None = 0,
         RestoreOption_RelativeToMainWindow = 1, ///< Skips restoring the main window geometry and the restored dock widgets will use relative sizing.
                                                 ///< Loading layouts won't change the main window geometry and just use whatever the user has at the moment.
+        RestoreOption_Incremental = 2, ///< Main windows whose layout is the same as the saved one are left untouched, instead of being rebuilt.
+                                       ///< If only the sizes differ, as with a "reset to saved sizes" action, just the separators are moved.
+                                       ///< Makes switching between similar layouts faster and flicker free. FloatingWindows are still recreated.
+        RestoreOption_LazyClosedDockWidgets = 4, ///< Closed dock widgets which don't exist yet aren't created. Only their last position is restored,
+                                                 ///< they're created when requested via LayoutSaver::dockWidgetByName(), or when the application creates them.
+        RestoreOption_StateOnly = 8, ///< Only restores which dock widgets are open, whether they're floating, and the current tabs. The existing layouts
+                                     ///< aren't rebuilt, opened dock widgets go to their last position. Other options are ignored.
     };
     Q_DECLARE_FLAGS(RestoreOptions, RestoreOption)
 
+    enum SerializationFormat {
+        SerializationFormat_Json = 0, ///< Human readable JSON. The default, and the format to use for interchange and debugging.
+        SerializationFormat_Binary, ///< Compact binary format, faster to save and restore. Not meant to be edited by hand.
+        SerializationFormat_CompressedBinary ///< The binary format compressed with zlib. For many layouts stored or synced over slow links.
+    };
+
    ///@internal
    inline Location oppositeLocation(Location loc)
    {
@@ -0,0 +1,200 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Class to undo and redo docking operations.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "LayoutHistory.h"
+#include "LayoutSaver.h"
+#include "LayoutSaver_p.h"
+#include "Tracing_p.h"
+#include "private/DockRegistry_p.h"
+
+#include <QDebug>
+#include <QScopedValueRollback>
+#include <QTimer>
+
+using namespace KDDockWidgets;
+
+typedef LayoutSaver::Layout::BinarySections Snapshot;
+
+///@brief Makes @p section share its data with an equal section of @p previous, if there's one
+static void shareWith(QByteArray &section, const QVector<QByteArray> &previous)
+{
+    for (const QByteArray &candidate : previous) {
+        if (candidate == section) {
+            section = candidate;
+            return;
+        }
+    }
+}
+
+class LayoutHistory::Private
+{
+public:
+    explicit Private(int max)
+        : m_maxSnapshots(qMax(1, max))
+    {
+        m_captureTimer.setSingleShot(true);
+        m_captureTimer.setInterval(0);
+    }
+
+    const int m_maxSnapshots;
+    QStringList m_affinityNames;
+    QVector<Snapshot> m_snapshots;
+    int m_current = -1;
+    bool m_isRestoring = false;
+
+    // Coalesces the layoutEdited() signals emitted during a single docking operation
+    QTimer m_captureTimer;
+};
+
+LayoutHistory::LayoutHistory(int maxSnapshots, QObject *parent)
+    : QObject(parent)
+    , d(new Private(maxSnapshots))
+{
+    connect(&d->m_captureTimer, &QTimer::timeout, this, &LayoutHistory::capture);
+    connect(DockRegistry::self(), &DockRegistry::layoutEdited, this, [this] {
+        if (!d->m_isRestoring)
+            d->m_captureTimer.start();
+    });
+
+    capture();
+}
+
+LayoutHistory::~LayoutHistory()
+{
+    delete d;
+}
+
+void LayoutHistory::setAffinityNames(const QStringList &affinityNames)
+{
+    d->m_affinityNames = affinityNames;
+}
+
+void LayoutHistory::capture()
+{
+    KDDW_TRACE_SCOPE("LayoutHistory::capture");
+    d->m_captureTimer.stop();
+
+    LayoutSaver saver;
+    saver.setAffinityNames(d->m_affinityNames);
+    Snapshot snapshot;
+    {
+        LayoutSaver::Layout layout;
+        if (!saver.snapshotLayout(layout)) {
+            // snapshotLayout() already warned
+            return;
+        }
+        snapshot = layout.toBinarySections();
+    }
+
+    if (d->m_current != -1) {
+        const Snapshot &previous = d->m_snapshots.at(d->m_current);
+        if (snapshot.join() == previous.join())
+            return; // Nothing changed, for example a close that was ignored
+
+        // Only the top-levels that changed take extra memory
+        if (snapshot.dockWidgets == previous.dockWidgets)
+            snapshot.dockWidgets = previous.dockWidgets;
+        if (snapshot.screenInfo == previous.screenInfo)
+            snapshot.screenInfo = previous.screenInfo;
+        for (QByteArray &section : snapshot.mainWindows)
+            shareWith(section, previous.mainWindows);
+        for (QByteArray &section : snapshot.floatingWindows)
+            shareWith(section, previous.floatingWindows);
+    }
+
+    // A new operation makes the undone snapshots unreachable
+    d->m_snapshots.resize(d->m_current + 1);
+    d->m_snapshots.push_back(snapshot);
+    if (d->m_snapshots.size() > d->m_maxSnapshots)
+        d->m_snapshots.removeFirst();
+
+    d->m_current = d->m_snapshots.size() - 1;
+    Q_EMIT changed();
+}
+
+bool LayoutHistory::undo()
+{
+    if (!canUndo())
+        return false;
+
+    return restoreSnapshot(d->m_current - 1);
+}
+
+bool LayoutHistory::redo()
+{
+    if (!canRedo())
+        return false;
+
+    return restoreSnapshot(d->m_current + 1);
+}
+
+bool LayoutHistory::canUndo() const
+{
+    return d->m_current > 0;
+}
+
+bool LayoutHistory::canRedo() const
+{
+    return d->m_current != -1 && d->m_current < d->m_snapshots.size() - 1;
+}
+
+int LayoutHistory::count() const
+{
+    return d->m_snapshots.size();
+}
+
+void LayoutHistory::clear()
+{
+    d->m_snapshots.clear();
+    d->m_current = -1;
+    capture();
+}
+
+bool LayoutHistory::restoreSnapshot(int index)
+{
+    KDDW_TRACE_SCOPE("LayoutHistory::restoreSnapshot");
+
+    // If an edit is still pending capture then it's lost, as undo/redo go to a recorded state
+    d->m_captureTimer.stop();
+
+    bool success = false;
+    {
+        QScopedValueRollback<bool> restoring(d->m_isRestoring, true);
+        LayoutSaver saver(RestoreOption_Incremental);
+        saver.setAffinityNames(d->m_affinityNames);
+        success = saver.restoreLayout(d->m_snapshots.at(index).join());
+    }
+
+    if (!success) {
+        qWarning() << Q_FUNC_INFO << "Failed to restore snapshot" << index;
+        return false;
+    }
+
+    d->m_current = index;
+    Q_EMIT changed();
+    return true;
+}
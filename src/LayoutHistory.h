@@ -0,0 +1,103 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_LAYOUT_HISTORY_H
+#define KD_LAYOUT_HISTORY_H
+
+/**
+ * @file
+ * @brief Class to undo and redo docking operations.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "docks_export.h"
+
+#include "KDDockWidgets.h"
+
+#include <QObject>
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Keeps a bounded history of the layout, so docking mistakes can be undone.
+ *
+ * A snapshot is captured after each drop, after a dock widget is floated or docked, and after it is closed.
+ * Several of those in the same event loop iteration result in a single snapshot.
+ * Separator moves alone aren't recorded.
+ *
+ * Snapshots share the sections of the main windows and floating windows which didn't change
+ * since the previous snapshot, so keeping many of them costs little more than keeping one.
+ * Undoing uses @ref RestoreOption_Incremental, so main windows which didn't change aren't rebuilt.
+ */
+class DOCKS_EXPORT LayoutHistory : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief Constructor. Captures the current layout, which is what undo() eventually goes back to.
+     * @param maxSnapshots How many snapshots are kept, including the current one. The oldest are dropped first.
+     */
+    explicit LayoutHistory(int maxSnapshots = 50, QObject *parent = nullptr);
+
+    ///@brief Destructor.
+    ~LayoutHistory() override;
+
+    ///@brief Sets the affinity names of the windows to record. See LayoutSaver::setAffinityNames().
+    void setAffinityNames(const QStringList &affinityNames);
+
+    /**
+     * @brief Captures the current layout as a new snapshot, discarding any snapshots which could be redone.
+     * Called automatically after docking operations, call it after changing the layout programmatically.
+     */
+    void capture();
+
+    ///@brief Restores the previous snapshot. Returns false if there's nothing to undo or restoring failed.
+    bool undo();
+
+    ///@brief Restores the snapshot which was undone last. Returns false if there's nothing to redo or restoring failed.
+    bool redo();
+
+    ///@brief returns whether undo() would do something
+    bool canUndo() const;
+
+    ///@brief returns whether redo() would do something
+    bool canRedo() const;
+
+    ///@brief returns the number of snapshots, including the current one
+    int count() const;
+
+    ///@brief Discards all snapshots and captures the current layout again
+    void clear();
+
+Q_SIGNALS:
+    ///@brief emitted when canUndo() or canRedo() might have changed
+    void changed();
+
+private:
+    bool restoreSnapshot(int index);
+
+    class Private;
+    Private *const d;
+};
+
+}
+
+#endif
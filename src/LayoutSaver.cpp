@@ -32,57 +32,325 @@
 #include "DockWidgetBase.h"
 #include "DropArea_p.h"
 #include "Logging_p.h"
+#include "Tracing_p.h"
+#include "EventLog_p.h"
+#include "Stats_p.h"
 #include "Frame_p.h"
 #include "LastPosition_p.h"
 #include "multisplitter/Anchor_p.h"
 #include "multisplitter/Item_p.h"
 #include "FrameworkWidgetFactory.h"
+#include "JsonStreamReader_p.h"
+#include "JsonStreamWriter_p.h"
 
 #include <qmath.h>
 #include <QDebug>
 #include <QSettings>
 #include <QApplication>
 #include <QFile>
-
+#include <QDir>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include <functional>
+#include <limits>
 #include <memory>
+#include <vector>
 
 using namespace KDDockWidgets;
 
 QHash<QString, LayoutSaver::DockWidget::Ptr> LayoutSaver::DockWidget::s_dockWidgets;
 LayoutSaver::Layout* LayoutSaver::Layout::s_currentLayoutBeingRestored = nullptr;
 
-static QVariantMap sizeToMap(QSize sz)
+// Below this many items and dock widgets, scaling isn't worth the trip to another thread
+static const int s_minItemsForParallelScaling = 100;
+
+namespace {
+
+class FunctionRunnable : public QRunnable
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("width"), sz.width());
-    map.insert(QStringLiteral("height"), sz.height());
+public:
+    FunctionRunnable(const std::function<void()> &func, QSemaphore *done)
+        : m_func(func)
+        , m_done(done)
+    {
+    }
+
+    void run() override
+    {
+        m_func();
+        m_done->release();
+    }
+
+private:
+    const std::function<void()> m_func;
+    QSemaphore *const m_done;
+};
 
-    return map;
 }
 
-static QVariantMap rectToMap(QRect rect)
+///@brief Runs all @p jobs, in the global thread pool if @p parallel is true. Returns when all finished.
+static void runJobs(const std::vector<std::function<void()>> &jobs, bool parallel)
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("x"), rect.x());
-    map.insert(QStringLiteral("y"), rect.y());
-    map.insert(QStringLiteral("width"), rect.width());
-    map.insert(QStringLiteral("height"), rect.height());
+    if (!parallel || jobs.size() < 2) {
+        for (const auto &job : jobs)
+            job();
+        return;
+    }
 
-    return map;
+    QSemaphore done;
+    for (size_t i = 1; i < jobs.size(); ++i)
+        QThreadPool::globalInstance()->start(new FunctionRunnable(jobs.at(i), &done));
+
+    // Instead of just waiting, do the first one ourselves
+    jobs.front()();
+    done.acquire(int(jobs.size() - 1));
+}
+
+static void writeDockWidgetNames(QDataStream &ds, const LayoutSaver::DockWidget::List &list)
+{
+    ds << qint32(list.size());
+    for (const auto &dw : list)
+        ds << dw->uniqueName;
+}
+
+static LayoutSaver::DockWidget::List readDockWidgetNames(QDataStream &ds)
+{
+    LayoutSaver::DockWidget::List result;
+    qint32 count = 0;
+    ds >> count;
+    for (qint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        QString name;
+        ds >> name;
+        result.push_back(LayoutSaver::DockWidget::dockWidgetForName(name));
+    }
+
+    return result;
+}
+
+static QSize readJsonSize(JsonStreamReader &reader)
+{
+    int width = 0;
+    int height = 0;
+    if (reader.beginObject()) {
+        QString key;
+        while (reader.nextMember(key)) {
+            if (key == QLatin1String("width"))
+                width = reader.readInt();
+            else if (key == QLatin1String("height"))
+                height = reader.readInt();
+            else
+                reader.skipValue();
+        }
+    }
+
+    return { width, height };
+}
+
+static QRect readJsonRect(JsonStreamReader &reader)
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    if (reader.beginObject()) {
+        QString key;
+        while (reader.nextMember(key)) {
+            if (key == QLatin1String("x"))
+                x = reader.readInt();
+            else if (key == QLatin1String("y"))
+                y = reader.readInt();
+            else if (key == QLatin1String("width"))
+                width = reader.readInt();
+            else if (key == QLatin1String("height"))
+                height = reader.readInt();
+            else
+                reader.skipValue();
+        }
+    }
+
+    return QRect(x, y, width, height);
+}
+
+static QVector<int> readJsonIntList(JsonStreamReader &reader)
+{
+    QVector<int> result;
+    if (reader.beginArray()) {
+        while (reader.nextElement())
+            result.push_back(reader.readInt());
+    }
+
+    return result;
+}
+
+static QStringList readJsonStringList(JsonStreamReader &reader)
+{
+    QStringList result;
+    if (reader.beginArray()) {
+        while (reader.nextElement())
+            result.push_back(reader.readString());
+    }
+
+    return result;
+}
+
+static LayoutSaver::DockWidget::List readJsonDockWidgetNames(JsonStreamReader &reader)
+{
+    LayoutSaver::DockWidget::List result;
+    if (reader.beginArray()) {
+        while (reader.nextElement())
+            result.push_back(LayoutSaver::DockWidget::dockWidgetForName(reader.readString()));
+    }
+
+    return result;
+}
+
+// Reads the full DockWidget objects, as opposed to readJsonDockWidgetNames()
+static LayoutSaver::DockWidget::List readJsonDockWidgets(JsonStreamReader &reader)
+{
+    LayoutSaver::DockWidget::List result;
+    if (!reader.beginArray())
+        return result;
+
+    while (reader.nextElement()) {
+        // The shared instance can only be looked up once we know the name, which isn't necessarily the first key
+        QString uniqueName;
+        QString affinityName;
+        LayoutSaver::LastPosition lastPosition = LayoutSaver::LastPosition();
+        if (reader.beginObject()) {
+            QString key;
+            while (reader.nextMember(key)) {
+                if (key == QLatin1String("uniqueName"))
+                    uniqueName = reader.readString();
+                else if (key == QLatin1String("affinityName"))
+                    affinityName = reader.readString();
+                else if (key == QLatin1String("lastPosition"))
+                    lastPosition.readJson(reader);
+                else
+                    reader.skipValue();
+            }
+        }
+
+        auto dw = LayoutSaver::DockWidget::dockWidgetForName(uniqueName);
+        dw->affinityName = affinityName;
+        dw->lastPosition = lastPosition;
+        result.push_back(dw);
+    }
+
+    return result;
+}
+
+// Returns whether the window with @p affinityName won't be restored, so the rest of it needn't be parsed
+static bool isSkippedByAffinity(const QString &affinityName)
+{
+    auto layout = LayoutSaver::Layout::s_currentLayoutBeingRestored;
+    return layout && !layout->matchesAffinity(affinityName);
+}
+
+// Skips the remaining members of the object being read
+static void skipRemainingMembers(JsonStreamReader &reader)
+{
+    QString key;
+    while (reader.nextMember(key))
+        reader.skipValue();
+}
+
+template <typename T>
+static typename T::List readJsonList(JsonStreamReader &reader)
+{
+    typename T::List result;
+    if (reader.beginArray()) {
+        while (reader.nextElement()) {
+            T t = T(); // value-initialized, so absent keys read as 0
+            t.readJson(reader);
+            result.push_back(t);
+        }
+    }
+
+    return result;
+}
+
+static void writeJsonSize(JsonStreamWriter &writer, const char *key, QSize sz)
+{
+    writer.writeKey(key);
+    writer.beginObject();
+    writer.writeKey("height");
+    writer.writeInt(sz.height());
+    writer.writeKey("width");
+    writer.writeInt(sz.width());
+    writer.endObject();
+}
+
+static void writeJsonRect(JsonStreamWriter &writer, const char *key, QRect rect)
+{
+    writer.writeKey(key);
+    writer.beginObject();
+    writer.writeKey("height");
+    writer.writeInt(rect.height());
+    writer.writeKey("width");
+    writer.writeInt(rect.width());
+    writer.writeKey("x");
+    writer.writeInt(rect.x());
+    writer.writeKey("y");
+    writer.writeInt(rect.y());
+    writer.endObject();
+}
+
+static void writeJsonIntList(JsonStreamWriter &writer, const char *key, const QVector<int> &list)
+{
+    writer.writeKey(key);
+    writer.beginArray();
+    for (int value : list)
+        writer.writeInt(value);
+    writer.endArray();
+}
+
+static void writeJsonDockWidgetNames(JsonStreamWriter &writer, const char *key, const LayoutSaver::DockWidget::List &list)
+{
+    writer.writeKey(key);
+    writer.beginArray();
+    for (const auto &dw : list)
+        writer.writeString(dw->uniqueName);
+    writer.endArray();
 }
 
-static QSize mapToSize(const QVariantMap &map)
+// Writes the full DockWidget objects, as opposed to writeJsonDockWidgetNames()
+static void writeJsonDockWidgets(JsonStreamWriter &writer, const char *key, const LayoutSaver::DockWidget::List &list)
 {
-    return { map.value(QStringLiteral("width")).toInt(),
-             map.value(QStringLiteral("height")).toInt() };
+    writer.writeKey(key);
+    writer.beginArray();
+    for (const auto &dw : list)
+        dw->writeJson(writer);
+    writer.endArray();
 }
 
-static QRect mapToRect(const QVariantMap &map)
+template <typename T>
+static void writeJsonList(JsonStreamWriter &writer, const char *key, const typename T::List &list)
+{
+    writer.writeKey(key);
+    writer.beginArray();
+    for (const T &t : list)
+        t.writeJson(writer);
+    writer.endArray();
+}
+
+// Returns whether @p a and @p b only differ in sizes. Same anchors, items, frames, dock widgets and current tabs.
+static bool haveSameTopology(const LayoutSaver::MultiSplitterLayout &a, const LayoutSaver::MultiSplitterLayout &b)
 {
-    return QRect(map.value(QStringLiteral("x")).toInt(),
-                 map.value(QStringLiteral("y")).toInt(),
-                 map.value(QStringLiteral("width")).toInt(),
-                 map.value(QStringLiteral("height")).toInt());
+    if (a.anchors.size() != b.anchors.size() || a.items.size() != b.items.size())
+        return false;
+
+    LayoutHasher hasherA;
+    a.addToHash(hasherA, /*includeGeometry=*/false);
+    LayoutHasher hasherB;
+    b.addToHash(hasherB, /*includeGeometry=*/false);
+
+    return hasherA.result() == hasherB.result();
 }
 
 class KDDockWidgets::LayoutSaver::Private
@@ -118,10 +386,76 @@ public:
     void deleteEmptyFrames();
     void clearRestoredProperty();
 
+    ///@brief Parses @p data, JSON or binary, into @p layout. Only the windows of our affinities are parsed
+    bool parseLayout(LayoutSaver::Layout &layout, const QByteArray &data) const;
+
+    ///@brief Applies only the dock widget open/floating state and current tabs of @p layout. See RestoreOption_StateOnly
+    void restoreStateOnly(const LayoutSaver::Layout &layout);
+
+    ///@brief returns the layouts of the main windows that are already as in @p layout, except for sizes. Only for RestoreOption_Incremental
+    QVector<KDDockWidgets::MultiSplitterLayout*> unchangedLayouts(const LayoutSaver::Layout &layout) const;
+
+    /**
+     * @brief The state of a restore that's in progress, so it can be run in steps. See AsyncLayoutRestorer.
+     * Each step restores a main window, a floating window, a closed dock widget or a dock widget's
+     * placeholders. The last one finalizes the restore.
+     */
+    struct RestoreJob
+    {
+        enum Phase {
+            Phase_MainWindows = 0,
+            Phase_FloatingWindows,
+            Phase_ClosedDockWidgets,
+            Phase_Placeholders,
+            Phase_Finalize
+        };
+
+        qint64 lap()
+        {
+            const qint64 now = timer.nsecsElapsed() / 1000;
+            const qint64 elapsed = now - lastLapUSecs;
+            lastLapUSecs = now;
+            return elapsed;
+        }
+
+        // Applications only see each dock widget's final visibility. First, so it's destroyed last
+        DockRegistry::VisibilityNotificationBatch visibilityBatch;
+        std::unique_ptr<RAIIIsRestoring> isRestoring;
+        LayoutSaver::Layout layout;
+        QVector<KDDockWidgets::MultiSplitterLayout*> untouchedLayouts;
+        QStringList staleLazyDockWidgets;
+        QVector<QPair<QPointer<KDDockWidgets::FloatingWindow>, bool>> floatingWindowsToShow;
+        QVector<QPair<QPointer<QWidgetOrQuick>, bool>> mainWindowsToShow; // Only with hideMainWindows
+        QElapsedTimer timer;
+        qint64 lastLapUSecs = 0;
+        bool hideMainWindows = false;
+        Phase phase = Phase_MainWindows;
+        int index = 0; // In the current phase
+        int stepsDone = 0;
+    };
+
+    /**
+     * @brief Parses @p data, clears the current layout and prepares m_restoreJob. Returns false on failure.
+     * If there's nothing else to do, like with RestoreOption_StateOnly, there's no m_restoreJob afterwards.
+     * @param hideMainWindows whether to hide the main windows being restored until the restore finishes
+     */
+    bool beginRestore(const QByteArray &data, bool hideMainWindows);
+
+    ///@brief Runs the next step of m_restoreJob. Returns whether there are more steps.
+    bool runRestoreStep();
+
+    ///@brief Runs a step of the current phase. Returns false if the restore failed
+    bool runRestorePhaseStep(RestoreJob &job);
+
+    ///@brief Ends m_restoreJob. The layout stays as far as it got, if it didn't finish
+    void finishRestore(bool success);
+
     std::unique_ptr<QSettings> settings() const;
     DockRegistry *const m_dockRegistry;
     const RestoreOptions m_restoreOptions;
     QStringList m_affinityNames;
+    LayoutSaver::RestoreReport m_restoreReport;
+    std::unique_ptr<RestoreJob> m_restoreJob;
     static bool s_restoreInProgress;
 };
 
@@ -134,12 +468,19 @@ LayoutSaver::LayoutSaver(RestoreOptions options)
 
 LayoutSaver::~LayoutSaver()
 {
+    if (d->m_restoreJob)
+        d->finishRestore(false);
     delete d;
 }
 
-bool LayoutSaver::saveToFile(const QString &jsonFilename)
+quint64 LayoutSaver::layoutGeneration()
 {
-    const QByteArray data = serializeLayout();
+    return DockRegistry::layoutGeneration();
+}
+
+bool LayoutSaver::saveToFile(const QString &jsonFilename, SerializationFormat format)
+{
+    const QByteArray data = serializeLayout(format);
 
     QFile f(jsonFilename);
     if (!f.open(QIODevice::WriteOnly)) {
@@ -159,20 +500,134 @@ bool LayoutSaver::restoreFromFile(const QString &jsonFilename)
         return false;
     }
 
+    // Parse straight from the mapped file, instead of copying it into memory first.
+    // Nothing keeps a reference to the data after restoreLayout() returns, parsing copies what it needs.
+    const qint64 size = f.size();
+    if (size > 0 && size <= std::numeric_limits<int>::max()) {
+        if (uchar *mapped = f.map(0, size)) {
+            const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), int(size));
+            const bool result = restoreLayout(data);
+            f.unmap(mapped);
+            return result;
+        }
+    }
+
+    // Mapping isn't supported for every file, like pipes or some resources
     const QByteArray data = f.readAll();
     const bool result = restoreLayout(data);
 
     return result;
 }
 
-QByteArray LayoutSaver::serializeLayout() const
+QString LayoutSaver::screenConfigurationKey()
 {
-    if (!d->m_dockRegistry->isSane()) {
-        qWarning() << Q_FUNC_INFO << "Refusing to serialize this layout. Check previous warnings.";
+    QByteArray description;
+    for (const ScreenInfo &info : ScreenInfo::currentScreens()) {
+        description += QByteArray::number(info.index) + ':' + info.name.toUtf8() + ':'
+                       + QByteArray::number(info.geometry.x()) + ',' + QByteArray::number(info.geometry.y()) + ','
+                       + QByteArray::number(info.geometry.width()) + 'x' + QByteArray::number(info.geometry.height()) + '@'
+                       + QByteArray::number(info.devicePixelRatio) + ';';
+    }
+
+    // Short, but stable across runs, unlike qHash()
+    return QString::fromLatin1(QCryptographicHash::hash(description, QCryptographicHash::Sha1).toHex().left(16));
+}
+
+static QString layoutFileNameForScreenConfiguration(const QString &key)
+{
+    return key + QStringLiteral(".layout");
+}
+
+bool LayoutSaver::saveToDirectory(const QString &directory, SerializationFormat format)
+{
+    QDir dir(directory);
+    if (!dir.mkpath(QStringLiteral("."))) {
+        qWarning() << Q_FUNC_INFO << "Failed to create" << directory;
+        return false;
+    }
+
+    return saveToFile(dir.filePath(layoutFileNameForScreenConfiguration(screenConfigurationKey())), format);
+}
+
+bool LayoutSaver::restoreFromDirectory(const QString &directory)
+{
+    const QDir dir(directory);
+    const QString exactMatch = dir.filePath(layoutFileNameForScreenConfiguration(screenConfigurationKey()));
+    if (QFile::exists(exactMatch))
+        return restoreFromFile(exactMatch);
+
+    // Unknown screen configuration, use the layout saved last
+    const QFileInfoList candidates = dir.entryInfoList({ layoutFileNameForScreenConfiguration(QStringLiteral("*")) },
+                                                       QDir::Files, QDir::Time);
+    if (candidates.isEmpty()) {
+        qWarning() << Q_FUNC_INFO << "No saved layout in" << directory;
+        return false;
+    }
+
+    qCDebug(restoring) << Q_FUNC_INFO << "Unknown screen configuration, restoring" << candidates.constFirst().fileName();
+    return restoreFromFile(candidates.constFirst().filePath());
+}
+
+QByteArray LayoutSaver::serializeLayout(SerializationFormat format) const
+{
+    KDDW_TRACE_SCOPE("LayoutSaver::serializeLayout");
+    LayoutSaver::Layout layout;
+    if (!snapshotLayout(layout))
         return {};
+
+    return layout.serialize(format);
+}
+
+QByteArray LayoutSaver::serializeLayoutDelta(const QByteArray &base) const
+{
+    KDDW_TRACE_SCOPE("LayoutSaver::serializeLayoutDelta");
+    LayoutSaver::Layout::BinarySections baseSections;
+    {
+        LayoutSaver::Layout baseLayout;
+        if (!baseLayout.fromSerialized(base)) {
+            qWarning() << Q_FUNC_INFO << "Failed to parse the base layout";
+            return {};
+        }
+
+        // Before snapshotting, as both share the LayoutSaver::DockWidget instances
+        baseSections = baseLayout.toBinarySections();
     }
 
     LayoutSaver::Layout layout;
+    if (!snapshotLayout(layout))
+        return {};
+
+    return layout.toBinarySections().deltaAgainst(baseSections);
+}
+
+QByteArray LayoutSaver::resolveLayoutDelta(const QByteArray &base, const QByteArray &delta)
+{
+    if (!LayoutSaver::Layout::isDelta(delta)) {
+        qWarning() << Q_FUNC_INFO << "Not a layout delta";
+        return {};
+    }
+
+    LayoutSaver::Layout baseLayout;
+    if (!baseLayout.fromSerialized(base)) {
+        qWarning() << Q_FUNC_INFO << "Failed to parse the base layout";
+        return {};
+    }
+
+    LayoutSaver::Layout::BinarySections sections;
+    if (!sections.resolve(baseLayout.toBinarySections(), delta)) {
+        qWarning() << Q_FUNC_INFO << "Delta doesn't match the base layout";
+        return {};
+    }
+
+    return sections.join();
+}
+
+bool LayoutSaver::snapshotLayout(LayoutSaver::Layout &layout) const
+{
+    if (!d->m_dockRegistry->isSane()) {
+        qWarning() << Q_FUNC_INFO << "Refusing to serialize this layout. Check previous warnings.";
+        return false;
+    }
 
     // Just a simplification. One less type of windows to handle.
     d->m_dockRegistry->ensureAllFloatingWidgetsAreMorphed();
@@ -199,6 +654,19 @@ QByteArray LayoutSaver::serializeLayout() const
             layout.closedDockWidgets.push_back(dockWidget->serialize());
     }
 
+    // Closed dock widgets which were restored lazily and weren't created yet
+    QVector<LayoutSaver::DockWidget::Ptr> lazyDockWidgets;
+    for (const QString &name : d->m_dockRegistry->lazyDockWidgetNames()) {
+        const DockRegistry::LazyDockWidget *lazy = d->m_dockRegistry->lazyDockWidget(name);
+        if (d->matchesAffinity(lazy->affinityName)) {
+            auto dw = LayoutSaver::DockWidget::dockWidgetForName(name);
+            dw->affinityName = lazy->affinityName;
+            dw->lastPosition = lazy->lastPosition.serialize();
+            layout.closedDockWidgets.push_back(dw);
+            lazyDockWidgets.push_back(dw);
+        }
+    }
+
     // Save the placeholder info. We do it last, as we also restore it last, since we need all items to be created
     // before restoring the placeholders
 
@@ -212,127 +680,378 @@ QByteArray LayoutSaver::serializeLayout() const
         }
     }
 
-    return layout.toJson();
+    for (const auto &dw : qAsConst(lazyDockWidgets))
+        layout.allDockWidgets.push_back(dw);
+
+    return true;
 }
 
 bool LayoutSaver::restoreLayout(const QByteArray &data)
 {
-    d->clearRestoredProperty();
-    if (data.isEmpty())
-        return true;
+    KDDW_TRACE_SCOPE("LayoutSaver::restoreLayout");
+    KDDW_STATS_TIME_SCOPE(lastRestoreUSecs);
+    if (!d->beginRestore(data, /*hideMainWindows=*/false))
+        return false;
 
-    struct EnsureItemsAtCorrectPlace {
+    while (d->runRestoreStep()) {}
 
-        EnsureItemsAtCorrectPlace(LayoutSaver *ls)
-            : layoutSaver(ls)
-        {
-        }
+    return d->m_restoreReport.success;
+}
 
-        ~EnsureItemsAtCorrectPlace()
-        {
-            // When using RestoreOption_RelativeToMainWindow we'll have many rounding errors so the layout won't be exact.
-            // Make sure to run a relayout at the end
-            // (Using RAII to make sure it runs after Private::RAIIIsRestoring went out of scope, since "isRestoring= true" inhibits relayout
-            if (ensure) {
-                for (auto layout : DockRegistry::self()->layouts()) {
-                    if (layoutSaver->d->matchesAffinity(layout->affinityName()))
-                        layout->redistributeSpace();
-                }
-            }
-        }
+bool LayoutSaver::beginRestore(const QByteArray &data, bool hideMainWindows)
+{
+    return d->beginRestore(data, hideMainWindows);
+}
 
-        bool ensure = false;
-        LayoutSaver *const layoutSaver;
-    };
+bool LayoutSaver::restoreStep()
+{
+    return d->runRestoreStep();
+}
 
-    EnsureItemsAtCorrectPlace ensureItemsAtCorrectPlace(this);
-    Private::RAIIIsRestoring isRestoring;
+void LayoutSaver::cancelRestore()
+{
+    if (d->m_restoreJob)
+        d->finishRestore(false);
+}
 
-    struct FrameCleanup {
-        FrameCleanup(LayoutSaver *saver)
-            : m_saver(saver)
-        {
-        }
+int LayoutSaver::restoreStepsDone() const
+{
+    return d->m_restoreJob ? d->m_restoreJob->stepsDone : 0;
+}
 
-        ~FrameCleanup()
-        {
-            m_saver->d->deleteEmptyFrames();
+int LayoutSaver::restoreStepCount() const
+{
+    if (!d->m_restoreJob)
+        return 0;
+
+    const LayoutSaver::Layout &layout = d->m_restoreJob->layout;
+    return layout.mainWindows.size() + layout.floatingWindows.size()
+        + layout.closedDockWidgets.size() + layout.allDockWidgets.size() + 1;
+}
+
+bool LayoutSaver::Private::beginRestore(const QByteArray &data, bool hideMainWindows)
+{
+    // Before touching anything, the restore in progress might be ours and still need its report
+    if (m_restoreJob || s_restoreInProgress) {
+        qWarning() << Q_FUNC_INFO << "Another restore is in progress";
+        return false;
+    }
+
+    m_restoreReport = RestoreReport();
+    clearRestoredProperty();
+
+    if (data.isEmpty()) {
+        m_restoreReport.success = true;
+        return true;
+    }
+
+    KDDW_LOG_EVENT(LogEvent::RestoreStarted, nullptr);
+    QElapsedTimer timer;
+    timer.start();
+
+    if (m_restoreOptions & RestoreOption_StateOnly) {
+        // Nothing is torn down or rebuilt, so none of the restore machinery below is needed
+        DockRegistry::VisibilityNotificationBatch visibilityBatch;
+        LayoutSaver::Layout layout;
+        const bool ok = parseLayout(layout, data);
+        m_restoreReport.parseUSecs = timer.nsecsElapsed() / 1000;
+        if (ok) {
+            restoreStateOnly(layout);
+            m_restoreReport.success = true;
         }
+        m_restoreReport.totalUSecs = timer.nsecsElapsed() / 1000;
+        m_restoreReport.finalizeUSecs = m_restoreReport.totalUSecs - m_restoreReport.parseUSecs;
+        KDDW_LOG_EVENT(LogEvent::RestoreFinished, nullptr, ok);
+        return ok;
+    }
 
-        LayoutSaver *const m_saver;
-    };
+    m_restoreJob.reset(new RestoreJob());
+    RestoreJob &job = *m_restoreJob;
+    job.isRestoring.reset(new RAIIIsRestoring());
+    job.timer = timer;
+    job.hideMainWindows = hideMainWindows;
 
-    FrameCleanup cleanup(this);
-    LayoutSaver::Layout layout;
-    if (!layout.fromJson(data)) {
-        qWarning() << Q_FUNC_INFO << "Failed to parse json data";
+    if (!parseLayout(job.layout, data)) {
+        finishRestore(false);
         return false;
     }
 
-    if (d->m_restoreOptions & RestoreOption_RelativeToMainWindow)
-        layout.scaleSizes();
+    if (m_restoreOptions & RestoreOption_RelativeToMainWindow)
+        job.layout.scaleSizes();
+
+    m_restoreReport.parseUSecs = job.lap();
+
+    job.untouchedLayouts = unchangedLayouts(job.layout);
+
+    // Lazy dock widgets from a previous restore. Those not in this layout are forgotten at the end,
+    // not now, as they might be keeping placeholders alive in untouched layouts.
+    for (const QString &name : m_dockRegistry->lazyDockWidgetNames()) {
+        if (matchesAffinity(m_dockRegistry->lazyDockWidget(name)->affinityName))
+            job.staleLazyDockWidgets << name;
+    }
+
+    if (hideMainWindows) {
+        for (const LayoutSaver::MainWindow &mw : qAsConst(job.layout.mainWindows)) {
+            MainWindowBase *mainWindow = mw.skippedByAffinity ? nullptr : m_dockRegistry->mainWindowByName(mw.uniqueName);
+            if (!mainWindow || !matchesAffinity(mainWindow->affinityName()))
+                continue;
+
+            // window(), as the MainWindow can be embedded
+            QWidgetOrQuick *window = mainWindow->window();
+            const bool visible = (m_restoreOptions & RestoreOption_RelativeToMainWindow) ? window->isVisible()
+                                                                                       : mw.isVisible;
+            job.mainWindowsToShow.push_back({ window, visible });
+            window->setVisible(false);
+        }
+    }
 
     // Hide all dockwidgets and unparent them from any layout before starting restore
-    d->m_dockRegistry->clear(d->m_affinityNames, /*deleteStaticAnchors=*/true);
+    m_dockRegistry->clear(m_affinityNames, job.untouchedLayouts, /*deleteStaticAnchors=*/true);
+    m_restoreReport.clearUSecs = job.lap();
+
+    return true;
+}
+
+bool LayoutSaver::Private::runRestoreStep()
+{
+    if (!m_restoreJob)
+        return false;
+
+    RestoreJob &job = *m_restoreJob;
+    const LayoutSaver::Layout &layout = job.layout;
+    const int phaseSizes[] = { layout.mainWindows.size(), layout.floatingWindows.size(),
+                               layout.closedDockWidgets.size(), layout.allDockWidgets.size(), 1 };
 
-    // 1. Restore main windows
-    for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows)) {
-        MainWindowBase *mainWindow = d->m_dockRegistry->mainWindowByName(mw.uniqueName);
+    // Skip the empty phases
+    while (job.index >= phaseSizes[job.phase]) {
+        job.phase = RestoreJob::Phase(job.phase + 1);
+        job.index = 0;
+    }
+
+    if (!runRestorePhaseStep(job)) {
+        finishRestore(false);
+        return false;
+    }
+
+    if (job.phase == RestoreJob::Phase_Finalize) {
+        finishRestore(true);
+        return false;
+    }
+
+    job.index++;
+    job.stepsDone++;
+    return true;
+}
+
+bool LayoutSaver::Private::runRestorePhaseStep(RestoreJob &job)
+{
+    const LayoutSaver::Layout &layout = job.layout;
+    RestoreReport &report = m_restoreReport;
+
+    auto recordWindowTiming = [&job] (QVector<RestoreReport::WindowTiming> &timings, const QString &name) {
+        RestoreReport::WindowTiming timing;
+        timing.name = name;
+        timing.usecs = job.lap();
+        timings.push_back(timing);
+    };
+
+    auto countCreated = [&report] (const LayoutSaver::MultiSplitterLayout &l) {
+        report.numAnchors += l.anchors.size();
+        report.numItems += l.items.size();
+        for (const LayoutSaver::Item &item : l.items) {
+            if (!item.frame.isNull)
+                report.numFrames++;
+        }
+    };
+
+    switch (job.phase) {
+    case RestoreJob::Phase_MainWindows: {
+        // 1. Restore main windows
+        const LayoutSaver::MainWindow &mw = layout.mainWindows.at(job.index);
+        if (mw.skippedByAffinity)
+            return true;
+
+        KDDW_TRACE_SCOPE("LayoutSaver::restoreLayout: MainWindow");
+        MainWindowBase *mainWindow = m_dockRegistry->mainWindowByName(mw.uniqueName);
         if (!mainWindow) {
             qWarning() << "Failed to restore layout create MainWindow with name" << mw.uniqueName << "first";
             return false;
         }
 
-        if (!d->matchesAffinity(mainWindow->affinityName()))
-            continue;
+        if (!matchesAffinity(mainWindow->affinityName()))
+            return true;
 
-        if (!(d->m_restoreOptions & RestoreOption_RelativeToMainWindow))
-            d->deserializeWindowGeometry(mw, mainWindow->window()); // window(), as the MainWindow can be embedded
+        if (!(m_restoreOptions & RestoreOption_RelativeToMainWindow)) {
+            if (job.hideMainWindows)
+                mainWindow->window()->setGeometry(mw.geometry); // Shown by finishRestore()
+            else
+                deserializeWindowGeometry(mw, mainWindow->window()); // window(), as the MainWindow can be embedded
+        }
+
+        if (job.untouchedLayouts.contains(mainWindow->multiSplitterLayout())) {
+            // Nothing to rebuild, at most the separators moved. Just mark its dock widgets as restored
+            mainWindow->multiSplitterLayout()->restoreAnchorPositions(mw.multiSplitterLayout);
+            for (const LayoutSaver::Item &item : mw.multiSplitterLayout.items) {
+                for (const auto &dw : item.frame.dockWidgets)
+                    DockWidgetBase::deserialize(dw);
+            }
+
+            recordWindowTiming(report.mainWindows, mw.uniqueName);
+            return true;
+        }
 
         if (!mainWindow->deserialize(mw))
             return false;
+
+        countCreated(mw.multiSplitterLayout);
+        recordWindowTiming(report.mainWindows, mw.uniqueName);
+        return true;
     }
+    case RestoreJob::Phase_FloatingWindows: {
+        // 2. Restore FloatingWindows. They're only shown at the end, once each has its final geometry
+        // and layout, so they don't get exposed and configured by the window manager several times
+        const LayoutSaver::FloatingWindow &fw = layout.floatingWindows.at(job.index);
+        if (fw.skippedByAffinity || !matchesAffinity(fw.affinityName))
+            return true;
 
-    // 2. Restore FloatingWindows
-    for (const LayoutSaver::FloatingWindow &fw : qAsConst(layout.floatingWindows)) {
-        if (!d->matchesAffinity(fw.affinityName))
-            continue;
+        KDDW_TRACE_SCOPE("LayoutSaver::restoreLayout: FloatingWindow");
 
         MainWindowBase *parent = fw.parentIndex == -1 ? nullptr
                                                       : DockRegistry::self()->mainwindows().at(fw.parentIndex);
 
         auto floatingWindow = Config::self().frameworkWidgetFactory()->createFloatingWindow(parent);
-        d->deserializeWindowGeometry(fw, floatingWindow);
-        if (!floatingWindow->deserialize(fw)) {
+        floatingWindow->setGeometry(fw.geometry);
+        job.floatingWindowsToShow.push_back({ floatingWindow, fw.isVisible });
+        if (!floatingWindow->deserialize(fw))
             return false;
-        }
-    }
 
-    // 3. Restore closed dock widgets. They remain closed but acquire geometry and placeholder properties
-    for (const auto &dw : qAsConst(layout.closedDockWidgets)) {
-        if (d->matchesAffinity(dw->affinityName)) {
-            DockWidgetBase::deserialize(dw);
+        countCreated(fw.multiSplitterLayout);
+        recordWindowTiming(report.floatingWindows, QString::number(report.floatingWindows.size()));
+        return true;
+    }
+    case RestoreJob::Phase_ClosedDockWidgets: {
+        // 3. Restore closed dock widgets. They remain closed but acquire geometry and placeholder properties
+        const auto &dw = layout.closedDockWidgets.at(job.index);
+        if (matchesAffinity(dw->affinityName)) {
+            const bool lazyClosedDockWidgets = m_restoreOptions & RestoreOption_LazyClosedDockWidgets;
+            if (lazyClosedDockWidgets && !m_dockRegistry->dockByName(dw->uniqueName)) {
+                // Don't create it, just keep its position. See dockWidgetByName().
+                m_dockRegistry->registerLazyDockWidget(dw->uniqueName, dw->affinityName);
+                job.staleLazyDockWidgets.removeOne(dw->uniqueName);
+            } else {
+                DockWidgetBase::deserialize(dw);
+            }
         }
+        return true;
     }
+    case RestoreJob::Phase_Placeholders: {
+        // 4. Restore the placeholder info, now that the Items have been created
+        const auto &dw = layout.allDockWidgets.at(job.index);
+        if (!matchesAffinity(dw->affinityName))
+            return true;
 
-    // 4. Restore the placeholder info, now that the Items have been created
-    for (const auto &dw : qAsConst(layout.allDockWidgets)) {
-        if (!d->matchesAffinity(dw->affinityName))
-            continue;
-
-        if (DockWidgetBase *dockWidget = d->m_dockRegistry->dockByName(dw->uniqueName)) {
+        if (DockWidgetBase *dockWidget = m_dockRegistry->dockByName(dw->uniqueName)) {
             dockWidget->lastPosition()->deserialize(dw->lastPosition);
-        } else {
+        } else if (!m_dockRegistry->deserializeLazyDockWidgetPosition(dw->uniqueName, dw->lastPosition)) {
             qWarning() << Q_FUNC_INFO << "Couldn't find dock widget" << dw->uniqueName;
         }
+        return true;
     }
+    case RestoreJob::Phase_Finalize:
+        for (const QString &name : qAsConst(job.staleLazyDockWidgets))
+            m_dockRegistry->unregisterLazyDockWidget(name);
+
+        report.placeholdersUSecs = job.lap();
 
-    // our raii class will run when
-    ensureItemsAtCorrectPlace.ensure = d->m_restoreOptions & RestoreOption_RelativeToMainWindow;
+        for (const auto &pair : qAsConst(job.floatingWindowsToShow)) {
+            if (pair.first)
+                pair.first->setVisible(pair.second);
+        }
+        return true;
+    }
 
     return true;
 }
 
+void LayoutSaver::Private::finishRestore(bool success)
+{
+    std::unique_ptr<RestoreJob> job = std::move(m_restoreJob);
+    m_restoreReport.success = success;
+    KDDW_LOG_EVENT(LogEvent::RestoreFinished, nullptr, success);
+
+    // After a restore it can happen that some DockWidgets didn't exist, so weren't restored
+    deleteEmptyFrames();
+
+    // "isRestoring = true" inhibits relayout, so it must be over before the final relayout
+    job->isRestoring.reset();
+
+    // When using RestoreOption_RelativeToMainWindow we'll have many rounding errors so the layout won't be exact.
+    // Make sure to run a relayout at the end
+    if (success && (m_restoreOptions & RestoreOption_RelativeToMainWindow)) {
+        // Solve every window first, only then push the frame geometries, in one sweep
+        QVector<QPointer<KDDockWidgets::MultiSplitterLayout>> layouts;
+        for (auto layout : DockRegistry::self()->layouts()) {
+            if (matchesAffinity(layout->affinityName())) {
+                layout->beginTransaction();
+                layouts.push_back(layout);
+            }
+        }
+
+        for (auto layout : qAsConst(layouts)) {
+            if (layout)
+                layout->redistributeSpace();
+        }
+
+        for (auto layout : qAsConst(layouts)) {
+            if (layout)
+                layout->endTransaction();
+        }
+    }
+
+    for (const auto &pair : qAsConst(job->mainWindowsToShow)) {
+        if (pair.first)
+            pair.first->setVisible(pair.second);
+    }
+
+    m_restoreReport.totalUSecs = job->timer.nsecsElapsed() / 1000;
+    m_restoreReport.finalizeUSecs = m_restoreReport.totalUSecs - job->lastLapUSecs;
+}
+
+const LayoutSaver::RestoreReport &LayoutSaver::restoreReport() const
+{
+    return d->m_restoreReport;
+}
+
+QVariantMap LayoutSaver::RestoreReport::toVariantMap() const
+{
+    auto timingsToList = [] (const QVector<WindowTiming> &timings) {
+        QVariantList list;
+        list.reserve(timings.size());
+        for (const WindowTiming &timing : timings) {
+            QVariantMap map;
+            map.insert(QStringLiteral("name"), timing.name);
+            map.insert(QStringLiteral("usecs"), timing.usecs);
+            list.push_back(map);
+        }
+        return list;
+    };
+
+    QVariantMap map;
+    map.insert(QStringLiteral("success"), success);
+    map.insert(QStringLiteral("totalUSecs"), totalUSecs);
+    map.insert(QStringLiteral("parseUSecs"), parseUSecs);
+    map.insert(QStringLiteral("clearUSecs"), clearUSecs);
+    map.insert(QStringLiteral("mainWindows"), timingsToList(mainWindows));
+    map.insert(QStringLiteral("floatingWindows"), timingsToList(floatingWindows));
+    map.insert(QStringLiteral("placeholdersUSecs"), placeholdersUSecs);
+    map.insert(QStringLiteral("finalizeUSecs"), finalizeUSecs);
+    map.insert(QStringLiteral("numFrames"), numFrames);
+    map.insert(QStringLiteral("numAnchors"), numAnchors);
+    map.insert(QStringLiteral("numItems"), numItems);
+
+    return map;
+}
+
 void LayoutSaver::setAffinityNames(const QStringList &affinityNames)
 {
     d->m_affinityNames = affinityNames;
@@ -342,6 +1061,16 @@ void LayoutSaver::setAffinityNames(const QStringList &affinityNames)
     }
 }
 
+QStringList LayoutSaver::lazyDockWidgetNames()
+{
+    return DockRegistry::self()->lazyDockWidgetNames();
+}
+
+DockWidgetBase *LayoutSaver::dockWidgetByName(const QString &uniqueName)
+{
+    return DockRegistry::self()->createLazyDockWidget(uniqueName);
+}
+
 DockWidgetBase::List LayoutSaver::restoredDockWidgets() const
 {
     const DockWidgetBase::List &allDockWidgets = DockRegistry::self()->dockwidgets();
@@ -356,6 +1085,86 @@ DockWidgetBase::List LayoutSaver::restoredDockWidgets() const
 
 }
 
+bool LayoutSaver::Private::parseLayout(LayoutSaver::Layout &layout, const QByteArray &data) const
+{
+    layout.affinityNames = m_affinityNames;
+    if (LayoutSaver::Layout::isDelta(data)) {
+        qWarning() << Q_FUNC_INFO << "Can't restore a layout delta without its base, see LayoutSaver::resolveLayoutDelta()";
+        return false;
+    }
+
+    if (!layout.fromSerialized(data)) {
+        qWarning() << Q_FUNC_INFO << "Failed to parse"
+                   << (LayoutSaver::Layout::isCompressed(data) ? "compressed"
+                                                               : LayoutSaver::Layout::isBinary(data) ? "binary" : "json")
+                   << "data";
+        return false;
+    }
+
+    // Reject corrupt layouts now, DockRegistry::clear() hasn't touched the current layout yet.
+    // hasValidReferences() already warned about what's wrong.
+    return layout.hasValidReferences();
+}
+
+void LayoutSaver::Private::restoreStateOnly(const LayoutSaver::Layout &layout)
+{
+    KDDW_TRACE_SCOPE("LayoutSaver::restoreStateOnly");
+
+    // Every dock widget in a saved frame was open. The value says whether it was floating
+    QHash<QString, bool> openDockWidgets;
+    QVector<const LayoutSaver::Frame *> frames;
+    auto collect = [&openDockWidgets, &frames] (const LayoutSaver::MultiSplitterLayout &l, bool floating) {
+        for (const LayoutSaver::Item &item : l.items) {
+            if (item.frame.isNull)
+                continue;
+
+            frames.push_back(&item.frame);
+            for (const auto &dw : item.frame.dockWidgets)
+                openDockWidgets.insert(dw->uniqueName, floating);
+        }
+    };
+
+    for (const LayoutSaver::MainWindow &mw : layout.mainWindows) {
+        if (!mw.skippedByAffinity)
+            collect(mw.multiSplitterLayout, /*floating=*/false);
+    }
+
+    for (const LayoutSaver::FloatingWindow &fw : layout.floatingWindows) {
+        if (!fw.skippedByAffinity)
+            collect(fw.multiSplitterLayout, /*floating=*/true);
+    }
+
+    for (DockWidgetBase *dw : m_dockRegistry->dockwidgets()) {
+        if (!matchesAffinity(dw->affinityName()))
+            continue;
+
+        auto it = openDockWidgets.constFind(dw->uniqueName());
+        if (it == openDockWidgets.cend()) {
+            if (dw->isOpen())
+                dw->forceClose();
+            continue;
+        }
+
+        if (!dw->isOpen())
+            dw->show(); // Goes to its last position
+
+        const bool floating = it.value();
+        if (dw->isFloating() != floating && (floating || dw->lastPosition()->isValid()))
+            dw->setFloating(floating);
+
+        dw->setProperty("kddockwidget_was_restored", true);
+    }
+
+    // Last, so the dock widgets opened above are already in their frames
+    for (const LayoutSaver::Frame *frame : qAsConst(frames)) {
+        if (frame->currentTabIndex < 0 || frame->currentTabIndex >= frame->dockWidgets.size())
+            continue;
+
+        if (DockWidgetBase *dw = m_dockRegistry->dockByName(frame->dockWidgets.at(frame->currentTabIndex)->uniqueName))
+            dw->setAsCurrentTab();
+    }
+}
+
 void LayoutSaver::Private::clearRestoredProperty()
 {
     const DockWidgetBase::List &allDockWidgets = DockRegistry::self()->dockwidgets();
@@ -364,6 +1173,34 @@ void LayoutSaver::Private::clearRestoredProperty()
     }
 }
 
+QVector<KDDockWidgets::MultiSplitterLayout*> LayoutSaver::Private::unchangedLayouts(const LayoutSaver::Layout &layout) const
+{
+    QVector<KDDockWidgets::MultiSplitterLayout*> result;
+    if (!(m_restoreOptions & RestoreOption_Incremental))
+        return result;
+
+    for (const LayoutSaver::MainWindow &mw : layout.mainWindows) {
+        if (mw.skippedByAffinity)
+            continue;
+
+        MainWindowBase *mainWindow = m_dockRegistry->mainWindowByName(mw.uniqueName);
+        if (!mainWindow || !matchesAffinity(mainWindow->affinityName()))
+            continue;
+
+        if (mw.options != mainWindow->options() || mw.affinityName != mainWindow->affinityName())
+            continue;
+
+        KDDockWidgets::MultiSplitterLayout *msl = mainWindow->multiSplitterLayout();
+
+        // Compares the whole tree: anchors, items, frames, and their dock widgets and current tabs.
+        // If only sizes differ the separators are just moved, see restoreAnchorPositions()
+        if (haveSameTopology(msl->serialize(), mw.multiSplitterLayout))
+            result.push_back(msl);
+    }
+
+    return result;
+}
+
 template <typename T>
 void LayoutSaver::Private::deserializeWindowGeometry(const T &saved, QWidgetOrQuick *topLevel)
 {
@@ -376,138 +1213,544 @@ void LayoutSaver::Private::deleteEmptyFrames()
     // After a restore it can happen that some DockWidgets didn't exist, so weren't restored.
     // Delete their frame now.
 
-    for (auto frame : m_dockRegistry->frames()) {
-        if (!frame->beingDeletedLater() && frame->isEmpty() && !frame->isCentralFrame())
-            delete frame;
+    for (auto frame : m_dockRegistry->frames()) {
+        if (!frame->beingDeletedLater() && frame->isEmpty() && !frame->isCentralFrame())
+            delete frame;
+    }
+}
+
+std::unique_ptr<QSettings> LayoutSaver::Private::settings() const
+{
+    auto settings = std::unique_ptr<QSettings>(new QSettings(qApp->organizationName(),
+                                                             qApp->applicationName()));
+    settings->beginGroup(QStringLiteral("KDDockWidgets::LayoutSaver"));
+
+    return settings;
+}
+
+bool LayoutSaver::restoreInProgress()
+{
+    return Private::s_restoreInProgress;
+}
+
+bool LayoutSaver::Layout::isValid() const
+{
+    for (auto &m : mainWindows) {
+        if (!m.isValid())
+            return false;
+    }
+
+    for (auto &m : floatingWindows) {
+        if (!m.isValid())
+            return false;
+    }
+
+    for (auto &m : allDockWidgets) {
+        if (!m->isValid())
+            return false;
+    }
+
+    return true;
+}
+
+bool LayoutSaver::Layout::hasValidReferences() const
+{
+    QSet<QString> dockNames;
+    QSet<QString> mainWindowNames;
+    for (const LayoutSaver::MainWindow &mw : mainWindows) {
+        mainWindowNames.insert(mw.uniqueName);
+        if (!mw.skippedByAffinity && !mw.multiSplitterLayout.hasValidReferences(dockNames))
+            return false;
+    }
+
+    for (const LayoutSaver::FloatingWindow &fw : floatingWindows) {
+        if (!fw.skippedByAffinity && !fw.multiSplitterLayout.hasValidReferences(dockNames))
+            return false;
+    }
+
+    for (const auto &dw : allDockWidgets) {
+        if (!dw->isValid()) {
+            qWarning() << Q_FUNC_INFO << "Dock widget without name";
+            return false;
+        }
+
+        for (const LayoutSaver::Placeholder &placeholder : dw->lastPosition.placeholders) {
+            // LastPosition::deserialize() looks these up without checking
+            const bool validWindow = placeholder.isFloatingWindow
+                    ? placeholder.indexOfFloatingWindow >= -1 && placeholder.indexOfFloatingWindow < floatingWindows.size()
+                    : mainWindowNames.contains(placeholder.mainWindowUniqueName);
+            if (placeholder.itemIndex < 0 || !validWindow) {
+                qWarning() << Q_FUNC_INFO << "Invalid placeholder for" << dw->uniqueName
+                           << placeholder.itemIndex << placeholder.indexOfFloatingWindow << placeholder.mainWindowUniqueName;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+quint64 LayoutSaver::Layout::structuralHash(bool includeGeometry) const
+{
+    LayoutHasher hasher;
+    hasher.addInt(mainWindows.size());
+    for (const LayoutSaver::MainWindow &mw : mainWindows)
+        mw.addToHash(hasher, includeGeometry);
+
+    hasher.addInt(floatingWindows.size());
+    for (const LayoutSaver::FloatingWindow &fw : floatingWindows)
+        fw.addToHash(hasher, includeGeometry);
+
+    hasher.addInt(closedDockWidgets.size());
+    for (const auto &dw : closedDockWidgets)
+        hasher.addString(dw->uniqueName);
+
+    return hasher.result();
+}
+
+bool LayoutSaver::Layout::fillFrom(const QByteArray &serialized)
+{
+    QDataStream ds(serialized);
+    ds >> this;
+
+    if (serializationVersion > KDDOCKWIDGETS_SERIALIZATION_VERSION) {
+        qWarning() << "Unsupported serialization version. Got=" << serializationVersion
+                   << "; expected equal or less than" << KDDOCKWIDGETS_SERIALIZATION_VERSION;
+        return false;
+    }
+
+    return true;
+}
+
+QByteArray LayoutSaver::Layout::toJson() const
+{
+    KDDW_TRACE_SCOPE("LayoutSaver::Layout::toJson");
+    // Written straight into the buffer, instead of building a QVariantMap tree and converting it
+    JsonStreamWriter writer;
+    writeJson(writer);
+
+    return writer.data();
+}
+
+bool LayoutSaver::Layout::fromJson(const QByteArray &jsonData)
+{
+    KDDW_TRACE_SCOPE("LayoutSaver::Layout::fromJson");
+    // Fill the structs while tokenizing. Going through QJsonDocument and QVariantMap
+    // would hold a few copies of the whole layout in memory.
+    JsonStreamReader reader(jsonData);
+    readJson(reader);
+
+    return !reader.hasError() && reader.atEnd();
+}
+
+QByteArray LayoutSaver::Layout::toBinary() const
+{
+    QByteArray data;
+    QDataStream ds(&data, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_9);
+    ds.writeRawData(LAYOUT_BINARY_MAGIC_MARKER, int(qstrlen(LAYOUT_BINARY_MAGIC_MARKER)));
+    writeBinary(ds);
+
+    return data;
+}
+
+template <typename T>
+static QByteArray binarySection(const T &value)
+{
+    QByteArray data;
+    QDataStream ds(&data, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_9);
+    value.writeBinary(ds);
+
+    return data;
+}
+
+LayoutSaver::Layout::BinarySections LayoutSaver::Layout::toBinarySections() const
+{
+    // Same as writeBinary(), but each top-level goes into its own byte array
+    BinarySections sections;
+    {
+        QDataStream ds(&sections.dockWidgets, QIODevice::WriteOnly);
+        ds.setVersion(QDataStream::Qt_5_9);
+        ds << qint32(serializationVersion);
+        ds << qint32(allDockWidgets.size());
+        for (const auto &dw : allDockWidgets) {
+            ds << dw->uniqueName;
+            dw->writeBinary(ds);
+        }
+        writeDockWidgetNames(ds, closedDockWidgets);
+    }
+
+    sections.mainWindows.reserve(mainWindows.size());
+    for (const LayoutSaver::MainWindow &mw : mainWindows)
+        sections.mainWindows.push_back(binarySection(mw));
+
+    sections.floatingWindows.reserve(floatingWindows.size());
+    for (const LayoutSaver::FloatingWindow &fw : floatingWindows)
+        sections.floatingWindows.push_back(binarySection(fw));
+
+    {
+        QDataStream ds(&sections.screenInfo, QIODevice::WriteOnly);
+        ds.setVersion(QDataStream::Qt_5_9);
+        writeBinaryList<LayoutSaver::ScreenInfo>(ds, screenInfo);
+    }
+
+    return sections;
+}
+
+QByteArray LayoutSaver::Layout::BinarySections::join() const
+{
+    QByteArray data;
+    QDataStream ds(&data, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_5_9);
+    ds.writeRawData(LAYOUT_BINARY_MAGIC_MARKER, int(qstrlen(LAYOUT_BINARY_MAGIC_MARKER)));
+    ds.writeRawData(dockWidgets.constData(), dockWidgets.size());
+
+    // The counts are what writeBinaryList() writes before the items
+    ds << qint32(mainWindows.size());
+    for (const QByteArray &section : mainWindows)
+        ds.writeRawData(section.constData(), section.size());
+
+    ds << qint32(floatingWindows.size());
+    for (const QByteArray &section : floatingWindows)
+        ds.writeRawData(section.constData(), section.size());
+
+    ds.writeRawData(screenInfo.constData(), screenInfo.size());
+
+    return data;
+}
+
+QByteArray LayoutSaver::Layout::BinarySections::deltaAgainst(const BinarySections &base) const
+{
+    // Top-levels are referenced by their index in base, so reordering them is cheap too.
+    // The digest of base lets resolve() refuse a different base, instead of restoring garbage.
+    auto writeSections = [] (QDataStream &ds, const QVector<QByteArray> &sections, const QVector<QByteArray> &baseSections) {
+        ds << qint32(sections.size());
+        for (const QByteArray &section : sections) {
+            const int baseIndex = baseSections.indexOf(section);
+            ds << qint32(baseIndex);
+            if (baseIndex == -1)
+                ds << section;
+        }
+    };
+
+    QByteArray payload;
+    {
+        QDataStream ds(&payload, QIODevice::WriteOnly);
+        ds.setVersion(QDataStream::Qt_5_9);
+        ds << QCryptographicHash::hash(base.join(), QCryptographicHash::Sha1);
+        ds << dockWidgets;
+        writeSections(ds, mainWindows, base.mainWindows);
+        writeSections(ds, floatingWindows, base.floatingWindows);
+        ds << screenInfo;
+    }
+
+    return QByteArray(LAYOUT_DELTA_MAGIC_MARKER) + qCompress(payload);
+}
+
+bool LayoutSaver::Layout::BinarySections::resolve(const BinarySections &base, const QByteArray &delta)
+{
+    if (!isDelta(delta))
+        return false;
+
+    const int markerSize = int(qstrlen(LAYOUT_DELTA_MAGIC_MARKER));
+    const QByteArray payload = qUncompress(reinterpret_cast<const uchar *>(delta.constData()) + markerSize,
+                                           delta.size() - markerSize);
+    if (payload.isEmpty())
+        return false;
+
+    auto readSections = [] (QDataStream &ds, QVector<QByteArray> &sections, const QVector<QByteArray> &baseSections) {
+        qint32 count = 0;
+        ds >> count;
+        for (qint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+            qint32 baseIndex = -1;
+            ds >> baseIndex;
+            if (baseIndex == -1) {
+                QByteArray section;
+                ds >> section;
+                sections.push_back(section);
+            } else if (baseIndex >= 0 && baseIndex < baseSections.size()) {
+                sections.push_back(baseSections.at(baseIndex));
+            } else {
+                return false;
+            }
+        }
+
+        return ds.status() == QDataStream::Ok;
+    };
+
+    QDataStream ds(payload);
+    ds.setVersion(QDataStream::Qt_5_9);
+    QByteArray baseDigest;
+    ds >> baseDigest;
+    if (baseDigest != QCryptographicHash::hash(base.join(), QCryptographicHash::Sha1))
+        return false;
+
+    ds >> dockWidgets;
+    if (!readSections(ds, mainWindows, base.mainWindows) || !readSections(ds, floatingWindows, base.floatingWindows))
+        return false;
+    ds >> screenInfo;
+
+    return ds.status() == QDataStream::Ok;
+}
+
+bool LayoutSaver::Layout::fromBinary(const QByteArray &data)
+{
+    KDDW_TRACE_SCOPE("LayoutSaver::Layout::fromBinary");
+    if (!isBinary(data))
+        return false;
+
+    QDataStream ds(data);
+    ds.setVersion(QDataStream::Qt_5_9);
+    ds.skipRawData(int(qstrlen(LAYOUT_BINARY_MAGIC_MARKER)));
+    readBinary(ds);
+
+    if (serializationVersion > KDDOCKWIDGETS_SERIALIZATION_VERSION) {
+        qWarning() << "Unsupported serialization version. Got=" << serializationVersion
+                   << "; expected equal or less than" << KDDOCKWIDGETS_SERIALIZATION_VERSION;
+        return false;
+    }
+
+    return ds.status() == QDataStream::Ok;
+}
+
+void LayoutSaver::Layout::detachDockWidgets()
+{
+    // The same frame can reference a dock widget that's also in allDockWidgets, keep them shared between themselves
+    QHash<const LayoutSaver::DockWidget*, LayoutSaver::DockWidget::Ptr> copies;
+    auto detach = [&copies] (LayoutSaver::DockWidget::List &list) {
+        for (LayoutSaver::DockWidget::Ptr &dw : list) {
+            LayoutSaver::DockWidget::Ptr &copy = copies[dw.get()];
+            if (!copy)
+                copy = std::make_shared<LayoutSaver::DockWidget>(*dw);
+            dw = copy;
+        }
+    };
+
+    detach(allDockWidgets);
+    detach(closedDockWidgets);
+
+    for (LayoutSaver::MainWindow &mw : mainWindows) {
+        for (LayoutSaver::Item &item : mw.multiSplitterLayout.items)
+            detach(item.frame.dockWidgets);
+    }
+
+    for (LayoutSaver::FloatingWindow &fw : floatingWindows) {
+        for (LayoutSaver::Item &item : fw.multiSplitterLayout.items)
+            detach(item.frame.dockWidgets);
     }
 }
 
-std::unique_ptr<QSettings> LayoutSaver::Private::settings() const
+bool LayoutSaver::Layout::isBinary(const QByteArray &data)
 {
-    auto settings = std::unique_ptr<QSettings>(new QSettings(qApp->organizationName(),
-                                                             qApp->applicationName()));
-    settings->beginGroup(QStringLiteral("KDDockWidgets::LayoutSaver"));
-
-    return settings;
+    return data.startsWith(LAYOUT_BINARY_MAGIC_MARKER);
 }
 
-bool LayoutSaver::restoreInProgress()
+bool LayoutSaver::Layout::isCompressed(const QByteArray &data)
 {
-    return Private::s_restoreInProgress;
+    return data.startsWith(LAYOUT_COMPRESSED_MAGIC_MARKER);
 }
 
-bool LayoutSaver::Layout::isValid() const
+bool LayoutSaver::Layout::isDelta(const QByteArray &data)
 {
-    for (auto &m : mainWindows) {
-        if (!m.isValid())
-            return false;
-    }
-
-    for (auto &m : floatingWindows) {
-        if (!m.isValid())
-            return false;
-    }
+    return data.startsWith(LAYOUT_DELTA_MAGIC_MARKER);
+}
 
-    for (auto &m : allDockWidgets) {
-        if (!m->isValid())
-            return false;
+QByteArray LayoutSaver::Layout::serialize(SerializationFormat format) const
+{
+    switch (format) {
+    case SerializationFormat_Binary:
+        return toBinary();
+    case SerializationFormat_CompressedBinary:
+        return QByteArray(LAYOUT_COMPRESSED_MAGIC_MARKER) + qCompress(toBinary());
+    case SerializationFormat_Json:
+        break;
     }
 
-    return true;
+    return toJson();
 }
 
-bool LayoutSaver::Layout::fillFrom(const QByteArray &serialized)
+bool LayoutSaver::Layout::fromSerialized(const QByteArray &data)
 {
-    QDataStream ds(serialized);
-    ds >> this;
-
-    if (serializationVersion > KDDOCKWIDGETS_SERIALIZATION_VERSION) {
-        qWarning() << "Unsupported serialization version. Got=" << serializationVersion
-                   << "; expected equal or less than" << KDDOCKWIDGETS_SERIALIZATION_VERSION;
-        return false;
+    if (isCompressed(data)) {
+        const int markerSize = int(qstrlen(LAYOUT_COMPRESSED_MAGIC_MARKER));
+        const QByteArray binary = qUncompress(reinterpret_cast<const uchar *>(data.constData()) + markerSize,
+                                              data.size() - markerSize);
+        return fromBinary(binary);
     }
 
-    return true;
+    return isBinary(data) ? fromBinary(data) : fromJson(data);
 }
 
-QByteArray LayoutSaver::Layout::toJson() const
+void LayoutSaver::Layout::writeJson(JsonStreamWriter &writer) const
 {
-    QJsonDocument doc = QJsonDocument::fromVariant(toVariantMap());
-    return doc.toJson();
+    // Keys in alphabetical order, like QJsonDocument used to write them
+    writer.beginObject();
+    writeJsonDockWidgets(writer, "allDockWidgets", allDockWidgets);
+    writeJsonDockWidgetNames(writer, "closedDockWidgets", closedDockWidgets);
+    writeJsonList<LayoutSaver::FloatingWindow>(writer, "floatingWindows", floatingWindows);
+    writeJsonList<LayoutSaver::MainWindow>(writer, "mainWindows", mainWindows);
+    writeJsonList<LayoutSaver::ScreenInfo>(writer, "screenInfo", screenInfo);
+    writer.writeKey("serializationVersion");
+    writer.writeInt(serializationVersion);
+    writer.endObject();
 }
 
-bool LayoutSaver::Layout::fromJson(const QByteArray &jsonData)
+void LayoutSaver::Layout::writeBinary(QDataStream &ds) const
 {
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData, &error);
-    if (error.error == QJsonParseError::NoError)  {
-        fromVariantMap(doc.toVariant().toMap());
-        return true;
+    ds << qint32(serializationVersion);
+
+    // Written first, so the shared instances referenced by name below are already filled
+    ds << qint32(allDockWidgets.size());
+    for (const auto &dw : allDockWidgets) {
+        ds << dw->uniqueName;
+        dw->writeBinary(ds);
     }
 
-    return false;
+    writeDockWidgetNames(ds, closedDockWidgets);
+    writeBinaryList<LayoutSaver::MainWindow>(ds, mainWindows);
+    writeBinaryList<LayoutSaver::FloatingWindow>(ds, floatingWindows);
+    writeBinaryList<LayoutSaver::ScreenInfo>(ds, screenInfo);
 }
 
-QVariantMap LayoutSaver::Layout::toVariantMap() const
+void LayoutSaver::Layout::readBinary(QDataStream &ds)
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("serializationVersion"), serializationVersion);
-    map.insert(QStringLiteral("mainWindows"), toVariantList<LayoutSaver::MainWindow>(mainWindows));
-    map.insert(QStringLiteral("floatingWindows"), toVariantList<LayoutSaver::FloatingWindow>(floatingWindows));
-    map.insert(QStringLiteral("closedDockWidgets"), dockWidgetNames(closedDockWidgets));
-    map.insert(QStringLiteral("allDockWidgets"), toVariantList(allDockWidgets));
-    map.insert(QStringLiteral("screenInfo"), toVariantList<LayoutSaver::ScreenInfo>(screenInfo));
-
-    return map;
-}
+    qint32 version = 0;
+    ds >> version;
+    serializationVersion = version;
+    if (serializationVersion > KDDOCKWIDGETS_SERIALIZATION_VERSION)
+        return;
 
-void LayoutSaver::Layout::fromVariantMap(const QVariantMap &map)
-{
     allDockWidgets.clear();
-    const QVariantList dockWidgetsV = map.value(QStringLiteral("allDockWidgets")).toList();
-    for (const QVariant &v : dockWidgetsV) {
-        const QVariantMap dwV = v.toMap();
-        const QString name = dwV.value(QStringLiteral("uniqueName")).toString();
+    qint32 numDockWidgets = 0;
+    ds >> numDockWidgets;
+    for (qint32 i = 0; i < numDockWidgets && ds.status() == QDataStream::Ok; ++i) {
+        QString name;
+        ds >> name;
         auto dw = LayoutSaver::DockWidget::dockWidgetForName(name);
-        dw->fromVariantMap(dwV);
+        dw->readBinary(ds);
         allDockWidgets.push_back(dw);
     }
 
+    closedDockWidgets = readDockWidgetNames(ds);
+    mainWindows = readBinaryList<LayoutSaver::MainWindow>(ds);
+    floatingWindows = readBinaryList<LayoutSaver::FloatingWindow>(ds);
+    screenInfo = readBinaryList<LayoutSaver::ScreenInfo>(ds);
+}
+
+void LayoutSaver::Layout::readJson(JsonStreamReader &reader)
+{
+    // Absent keys read as empty
+    serializationVersion = 0;
+    mainWindows.clear();
+    floatingWindows.clear();
     closedDockWidgets.clear();
-    const QVariantList closedDockWidgetsV = map.value(QStringLiteral("closedDockWidgets")).toList();
-    closedDockWidgets.reserve(closedDockWidgetsV.size());
-    for (const QVariant &v : closedDockWidgetsV) {
-        closedDockWidgets.push_back(LayoutSaver::DockWidget::dockWidgetForName(v.toString()));
-    }
+    allDockWidgets.clear();
+    screenInfo.clear();
 
-    serializationVersion = map.value(QStringLiteral("serializationVersion")).toInt();
-    mainWindows = fromVariantList<LayoutSaver::MainWindow>(map.value(QStringLiteral("mainWindows")).toList());
-    floatingWindows = fromVariantList<LayoutSaver::FloatingWindow>(map.value(QStringLiteral("floatingWindows")).toList());
-    screenInfo = fromVariantList<LayoutSaver::ScreenInfo>(map.value(QStringLiteral("screenInfo")).toList());
+    if (!reader.beginObject())
+        return;
+
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("serializationVersion")) {
+            serializationVersion = reader.readInt();
+        } else if (key == QLatin1String("mainWindows")) {
+            mainWindows = readJsonList<LayoutSaver::MainWindow>(reader);
+        } else if (key == QLatin1String("floatingWindows")) {
+            floatingWindows = readJsonList<LayoutSaver::FloatingWindow>(reader);
+        } else if (key == QLatin1String("closedDockWidgets")) {
+            closedDockWidgets = readJsonDockWidgetNames(reader);
+        } else if (key == QLatin1String("screenInfo")) {
+            screenInfo = readJsonList<LayoutSaver::ScreenInfo>(reader);
+        } else if (key == QLatin1String("allDockWidgets")) {
+            allDockWidgets = readJsonDockWidgets(reader);
+        } else {
+            reader.skipValue();
+        }
+    }
 }
 
 void LayoutSaver::Layout::scaleSizes()
 {
+    KDDW_TRACE_SCOPE("LayoutSaver::Layout::scaleSizes");
     if (mainWindows.isEmpty())
         return;
 
-    for (auto &mw : mainWindows)
-        mw.scaleSizes();
+    // ScalingInfo looks at the real main windows, so compute it here, on the GUI thread.
+    // What's left is pure data, and each window's subtree is independent from the others.
+    for (auto &mw : mainWindows) {
+        if (!mw.skippedByAffinity)
+            mw.initScalingInfo();
+    }
+
+    std::vector<std::function<void()>> jobs;
+    int numItems = 0;
+
+    for (auto &mw : mainWindows) {
+        jobs.push_back([&mw] { mw.scaleSizes(); });
+        numItems += mw.multiSplitterLayout.items.size();
+    }
+
+    // Computed once per screen, many floating windows share the same one
+    QHash<int, ScalingInfo> screenScalingInfos;
 
     for (auto &fw : floatingWindows) {
-        LayoutSaver::MainWindow mw = mainWindowForIndex(fw.parentIndex);
-        if (mw.scalingInfo.isValid())
-            fw.scaleSizes(mw.scalingInfo);
+        if (fw.skippedByAffinity)
+            continue;
+
+        const bool hasParent = fw.parentIndex >= 0 && fw.parentIndex < mainWindows.size();
+        ScalingInfo scalingInfo = hasParent ? mainWindows.at(fw.parentIndex).scalingInfo : ScalingInfo();
+        if (!scalingInfo.isValid()) {
+            // No main window to be relative to, but the screen it was on might have changed
+            auto it = screenScalingInfos.find(fw.screenIndex);
+            if (it == screenScalingInfos.end())
+                it = screenScalingInfos.insert(fw.screenIndex, screenScalingInfo(fw.screenIndex));
+            scalingInfo = it.value();
+        }
+
+        if (scalingInfo.isValid()) {
+            jobs.push_back([&fw, scalingInfo] { fw.scaleSizes(scalingInfo); });
+            numItems += fw.multiSplitterLayout.items.size();
+        }
     }
 
     const ScalingInfo firstScalingInfo = mainWindows.constFirst().scalingInfo;
     if (firstScalingInfo.isValid()) {
-        for (auto &dw : allDockWidgets) {
-            // TODO: Determine the best main window. This only interesting for closed dock widget geometry
-            // which was previously floating. But they still have some other main window as parent.
-            dw->scaleSizes(firstScalingInfo);
-        }
+        // The DockWidget structs are shared with the frames, but Frame::scaleSizes() doesn't touch them
+        jobs.push_back([this, firstScalingInfo] {
+            for (const auto &dw : qAsConst(allDockWidgets)) {
+                // TODO: Determine the best main window. This only interesting for closed dock widget geometry
+                // which was previously floating. But they still have some other main window as parent.
+                dw->scaleSizes(firstScalingInfo);
+            }
+        });
+        numItems += allDockWidgets.size();
     }
+
+    runJobs(jobs, /*parallel=*/numItems >= s_minItemsForParallelScaling);
+}
+
+LayoutSaver::ScalingInfo LayoutSaver::Layout::screenScalingInfo(int screenIndex) const
+{
+    auto findScreen = [screenIndex] (const ScreenInfo::List &screens) -> const ScreenInfo * {
+        for (const ScreenInfo &info : screens) {
+            if (info.index == screenIndex)
+                return &info;
+        }
+        return nullptr;
+    };
+
+    const ScreenInfo *saved = findScreen(screenInfo);
+    if (!saved || currentScreenInfo.isEmpty())
+        return {};
+
+    // If that screen is gone, Qt puts the window on the primary screen, which is the first one
+    const ScreenInfo *current = findScreen(currentScreenInfo);
+    if (!current)
+        current = &currentScreenInfo.constFirst();
+
+    return ScalingInfo(saved->geometry, current->geometry);
 }
 
 LayoutSaver::MainWindow LayoutSaver::Layout::mainWindowForIndex(int index) const
@@ -545,34 +1788,113 @@ void LayoutSaver::Item::scaleSizes(const ScalingInfo &scalingInfo)
         frame.scaleSizes(scalingInfo);
 }
 
-QVariantMap LayoutSaver::Item::toVariantMap() const
+void LayoutSaver::Item::writeJson(JsonStreamWriter &writer) const
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("objectName"), objectName);
-    map.insert(QStringLiteral("isPlaceholder"), isPlaceholder);
-    map.insert(QStringLiteral("geometry"), rectToMap(geometry));
-    map.insert(QStringLiteral("minSize"), sizeToMap(minSize));
-    map.insert(QStringLiteral("indexOfLeftAnchor"), indexOfLeftAnchor);
-    map.insert(QStringLiteral("indexOfTopAnchor"), indexOfTopAnchor);
-    map.insert(QStringLiteral("indexOfRightAnchor"), indexOfRightAnchor);
-    map.insert(QStringLiteral("indexOfBottomAnchor"), indexOfBottomAnchor);
+    writer.beginObject();
+    if (!frame.isNull) {
+        writer.writeKey("frame");
+        frame.writeJson(writer);
+    }
+    writeJsonRect(writer, "geometry", geometry);
+    writer.writeKey("indexOfBottomAnchor");
+    writer.writeInt(indexOfBottomAnchor);
+    writer.writeKey("indexOfLeftAnchor");
+    writer.writeInt(indexOfLeftAnchor);
+    writer.writeKey("indexOfRightAnchor");
+    writer.writeInt(indexOfRightAnchor);
+    writer.writeKey("indexOfTopAnchor");
+    writer.writeInt(indexOfTopAnchor);
+    writer.writeKey("isPlaceholder");
+    writer.writeBool(isPlaceholder);
+    writeJsonSize(writer, "minSize", minSize);
+    writer.writeKey("objectName");
+    writer.writeString(objectName);
+    writer.endObject();
+}
+
+void LayoutSaver::Item::writeBinary(QDataStream &ds) const
+{
+    ds << objectName;
+    ds << isPlaceholder;
+    ds << geometry;
+    ds << minSize;
+    ds << indexOfLeftAnchor;
+    ds << indexOfTopAnchor;
+    ds << indexOfRightAnchor;
+    ds << indexOfBottomAnchor;
+    ds << !frame.isNull;
     if (!frame.isNull)
-        map.insert(QStringLiteral("frame"), frame.toVariantMap());
+        frame.writeBinary(ds);
+}
 
-    return map;
+void LayoutSaver::Item::addToHash(LayoutHasher &hasher, bool includeGeometry) const
+{
+    hasher.addString(objectName);
+    hasher.addBool(isPlaceholder);
+    if (includeGeometry) {
+        hasher.addRect(geometry);
+        hasher.addSize(minSize);
+    }
+    hasher.addInt(indexOfLeftAnchor);
+    hasher.addInt(indexOfTopAnchor);
+    hasher.addInt(indexOfRightAnchor);
+    hasher.addInt(indexOfBottomAnchor);
+    frame.addToHash(hasher, includeGeometry);
+}
+
+void LayoutSaver::Item::readBinary(QDataStream &ds)
+{
+    ds >> objectName;
+    ds >> isPlaceholder;
+    ds >> geometry;
+    ds >> minSize;
+    ds >> indexOfLeftAnchor;
+    ds >> indexOfTopAnchor;
+    ds >> indexOfRightAnchor;
+    ds >> indexOfBottomAnchor;
+
+    bool hasFrame = false;
+    ds >> hasFrame;
+    if (hasFrame) {
+        frame.readBinary(ds);
+    } else {
+        frame.isNull = true;
+        frame.dockWidgets.clear();
+    }
 }
 
-void LayoutSaver::Item::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::Item::readJson(JsonStreamReader &reader)
 {
-    objectName = map.value(QStringLiteral("objectName")).toString();
-    isPlaceholder = map.value(QStringLiteral("isPlaceholder")).toBool();
-    geometry = mapToRect(map.value(QStringLiteral("geometry")).toMap());
-    minSize = mapToSize(map.value(QStringLiteral("minSize")).toMap());
-    indexOfLeftAnchor = map.value(QStringLiteral("indexOfLeftAnchor")).toInt();
-    indexOfTopAnchor = map.value(QStringLiteral("indexOfTopAnchor")).toInt();
-    indexOfRightAnchor = map.value(QStringLiteral("indexOfRightAnchor")).toInt();
-    indexOfBottomAnchor = map.value(QStringLiteral("indexOfBottomAnchor")).toInt();
-    frame.fromVariantMap(map.value(QStringLiteral("frame"), QVariantMap()).toMap());
+    // No "frame" key means a null frame
+    frame.isNull = true;
+    frame.dockWidgets.clear();
+
+    if (!reader.beginObject())
+        return;
+
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("objectName"))
+            objectName = reader.readString();
+        else if (key == QLatin1String("isPlaceholder"))
+            isPlaceholder = reader.readBool();
+        else if (key == QLatin1String("geometry"))
+            geometry = readJsonRect(reader);
+        else if (key == QLatin1String("minSize"))
+            minSize = readJsonSize(reader);
+        else if (key == QLatin1String("indexOfLeftAnchor"))
+            indexOfLeftAnchor = reader.readInt();
+        else if (key == QLatin1String("indexOfTopAnchor"))
+            indexOfTopAnchor = reader.readInt();
+        else if (key == QLatin1String("indexOfRightAnchor"))
+            indexOfRightAnchor = reader.readInt();
+        else if (key == QLatin1String("indexOfBottomAnchor"))
+            indexOfBottomAnchor = reader.readInt();
+        else if (key == QLatin1String("frame"))
+            frame.readJson(reader);
+        else
+            reader.skipValue();
+    }
 }
 
 bool LayoutSaver::Frame::isValid() const
@@ -608,42 +1930,92 @@ void LayoutSaver::Frame::scaleSizes(const ScalingInfo &scalingInfo)
     scalingInfo.applyFactorsTo(geometry);
 }
 
-QVariantMap LayoutSaver::Frame::toVariantMap() const
+void LayoutSaver::Frame::writeJson(JsonStreamWriter &writer) const
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("isNull"), isNull);
-    map.insert(QStringLiteral("objectName"), objectName);
-    map.insert(QStringLiteral("geometry"), rectToMap(geometry));
-    map.insert(QStringLiteral("options"), options);
-    map.insert(QStringLiteral("currentTabIndex"), currentTabIndex);
-
-    map.insert(QStringLiteral("dockWidgets"), dockWidgetNames(dockWidgets));
+    writer.beginObject();
+    writer.writeKey("currentTabIndex");
+    writer.writeInt(currentTabIndex);
+    writeJsonDockWidgetNames(writer, "dockWidgets", dockWidgets);
+    writeJsonRect(writer, "geometry", geometry);
+    writer.writeKey("isNull");
+    writer.writeBool(isNull);
+    writer.writeKey("objectName");
+    writer.writeString(objectName);
+    writer.writeKey("options");
+    writer.writeInt(int(options));
+    writer.endObject();
+}
 
-    return map;
+void LayoutSaver::Frame::writeBinary(QDataStream &ds) const
+{
+    ds << isNull;
+    ds << objectName;
+    ds << geometry;
+    ds << quint32(options);
+    ds << currentTabIndex;
+    writeDockWidgetNames(ds, dockWidgets);
 }
 
-void LayoutSaver::Frame::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::Frame::addToHash(LayoutHasher &hasher, bool includeGeometry) const
 {
-    if (map.isEmpty()) {
-        isNull = true;
-        dockWidgets.clear();
+    hasher.addBool(isNull);
+    if (isNull)
         return;
-    }
 
-    isNull = map.value(QStringLiteral("isNull")).toBool();
-    objectName = map.value(QStringLiteral("objectName")).toString();
-    geometry = mapToRect(map.value(QStringLiteral("geometry")).toMap());
-    options = map.value(QStringLiteral("options")).toUInt();
-    currentTabIndex = map.value(QStringLiteral("currentTabIndex")).toInt();
+    hasher.addString(objectName);
+    if (includeGeometry)
+        hasher.addRect(geometry);
+    hasher.addInt(options);
+    hasher.addInt(currentTabIndex);
+    hasher.addInt(dockWidgets.size());
+    for (const auto &dw : dockWidgets)
+        hasher.addString(dw->uniqueName);
+}
 
-    QVariantList dockWidgetsV = map.value(QStringLiteral("dockWidgets")).toList();
+void LayoutSaver::Frame::readBinary(QDataStream &ds)
+{
+    quint32 opts = 0;
+    ds >> isNull;
+    ds >> objectName;
+    ds >> geometry;
+    ds >> opts;
+    options = opts;
+    ds >> currentTabIndex;
+    dockWidgets = readDockWidgetNames(ds);
+}
 
+void LayoutSaver::Frame::readJson(JsonStreamReader &reader)
+{
+    isNull = true;
     dockWidgets.clear();
-    dockWidgets.reserve(dockWidgetsV.size());
-    for (const auto &variant : dockWidgetsV) {
-        DockWidget::Ptr dw = DockWidget::dockWidgetForName(variant.toString());
-        dockWidgets.push_back(dw);
+
+    if (!reader.beginObject())
+        return;
+
+    // An empty object means a null frame
+    bool isEmpty = true;
+    isNull = false;
+    QString key;
+    while (reader.nextMember(key)) {
+        isEmpty = false;
+        if (key == QLatin1String("isNull"))
+            isNull = reader.readBool();
+        else if (key == QLatin1String("objectName"))
+            objectName = reader.readString();
+        else if (key == QLatin1String("geometry"))
+            geometry = readJsonRect(reader);
+        else if (key == QLatin1String("options"))
+            options = static_cast<unsigned int>(reader.readInt());
+        else if (key == QLatin1String("currentTabIndex"))
+            currentTabIndex = reader.readInt();
+        else if (key == QLatin1String("dockWidgets"))
+            dockWidgets = readJsonDockWidgetNames(reader);
+        else
+            reader.skipValue();
     }
+
+    if (isEmpty)
+        isNull = true;
 }
 
 bool LayoutSaver::DockWidget::isValid() const
@@ -656,22 +2028,31 @@ void LayoutSaver::DockWidget::scaleSizes(const ScalingInfo &scalingInfo)
     lastPosition.scaleSizes(scalingInfo);
 }
 
-QVariantMap LayoutSaver::DockWidget::toVariantMap() const
+void LayoutSaver::DockWidget::writeJson(JsonStreamWriter &writer) const
 {
-    QVariantMap map;
-    if (!affinityName.isEmpty())
-        map.insert(QStringLiteral("affinityName"), affinityName);
-    map.insert(QStringLiteral("uniqueName"), uniqueName);
-    map.insert(QStringLiteral("lastPosition"), lastPosition.toVariantMap());
+    writer.beginObject();
+    if (!affinityName.isEmpty()) {
+        writer.writeKey("affinityName");
+        writer.writeString(affinityName);
+    }
+    writer.writeKey("lastPosition");
+    lastPosition.writeJson(writer);
+    writer.writeKey("uniqueName");
+    writer.writeString(uniqueName);
+    writer.endObject();
+}
 
-    return map;
+void LayoutSaver::DockWidget::writeBinary(QDataStream &ds) const
+{
+    // uniqueName is written by the caller, which needs it to find the shared instance when reading
+    ds << affinityName;
+    lastPosition.writeBinary(ds);
 }
 
-void LayoutSaver::DockWidget::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::DockWidget::readBinary(QDataStream &ds)
 {
-    affinityName = map.value(QStringLiteral("affinityName")).toString();
-    uniqueName = map.value(QStringLiteral("uniqueName")).toString();
-    lastPosition.fromVariantMap(map.value(QStringLiteral("lastPosition")).toMap());
+    ds >> affinityName;
+    lastPosition.readBinary(ds);
 }
 
 bool LayoutSaver::Anchor::isValid(const LayoutSaver::MultiSplitterLayout &layout) const
@@ -721,55 +2102,106 @@ bool LayoutSaver::Anchor::isValid(const LayoutSaver::MultiSplitterLayout &layout
     return true;
 }
 
-QVariantMap LayoutSaver::Anchor::toVariantMap() const
-{
-    QVariantMap map;
-    map.insert(QStringLiteral("objectName"), objectName);
-    map.insert(QStringLiteral("geometry"), rectToMap(geometry));
-    map.insert(QStringLiteral("orientation"), orientation);
-    map.insert(QStringLiteral("type"), type);
-    map.insert(QStringLiteral("indexOfFrom"), indexOfFrom);
-    map.insert(QStringLiteral("indexOfTo"), indexOfTo);
-    map.insert(QStringLiteral("indexOfFollowee"), indexOfFollowee);
-    map.insert(QStringLiteral("positionPercentage"), positionPercentage);
-
-    QVariantList side1ItemsV;
-    QVariantList side2ItemsV;
-    side1ItemsV.reserve(side1Items.size());
-    side2ItemsV.reserve(side2Items.size());
-    for (int index : qAsConst(side1Items))
-        side1ItemsV.push_back(index);
-    for (int index : qAsConst(side2Items))
-        side2ItemsV.push_back(index);
-
-    map.insert(QStringLiteral("side1Items"), side1ItemsV);
-    map.insert(QStringLiteral("side2Items"), side2ItemsV);
-
-    return map;
+void LayoutSaver::Anchor::writeJson(JsonStreamWriter &writer) const
+{
+    writer.beginObject();
+    writeJsonRect(writer, "geometry", geometry);
+    writer.writeKey("indexOfFollowee");
+    writer.writeInt(indexOfFollowee);
+    writer.writeKey("indexOfFrom");
+    writer.writeInt(indexOfFrom);
+    writer.writeKey("indexOfTo");
+    writer.writeInt(indexOfTo);
+    writer.writeKey("objectName");
+    writer.writeString(objectName);
+    writer.writeKey("orientation");
+    writer.writeInt(orientation);
+    writer.writeKey("positionPercentage");
+    writer.writeDouble(positionPercentage);
+    writeJsonIntList(writer, "side1Items", side1Items);
+    writeJsonIntList(writer, "side2Items", side2Items);
+    writer.writeKey("type");
+    writer.writeInt(type);
+    writer.endObject();
+}
+
+void LayoutSaver::Anchor::writeBinary(QDataStream &ds) const
+{
+    ds << objectName;
+    ds << geometry;
+    ds << orientation;
+    ds << type;
+    ds << indexOfFrom;
+    ds << indexOfTo;
+    ds << indexOfFollowee;
+    ds << positionPercentage;
+    ds << side1Items;
+    ds << side2Items;
+}
+
+void LayoutSaver::Anchor::addToHash(LayoutHasher &hasher, bool includeGeometry) const
+{
+    hasher.addString(objectName);
+    if (includeGeometry) {
+        hasher.addRect(geometry);
+        hasher.addDouble(positionPercentage);
+    }
+    hasher.addInt(orientation);
+    hasher.addInt(type);
+    hasher.addInt(indexOfFrom);
+    hasher.addInt(indexOfTo);
+    hasher.addInt(indexOfFollowee);
+    for (const QVector<int> *sideItems : { &side1Items, &side2Items }) {
+        hasher.addInt(sideItems->size());
+        for (int index : *sideItems)
+            hasher.addInt(index);
+    }
 }
 
-void LayoutSaver::Anchor::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::Anchor::readBinary(QDataStream &ds)
 {
-    objectName = map.value(QStringLiteral("objectName")).toString();
-    geometry = mapToRect(map.value(QStringLiteral("geometry")).toMap());
+    ds >> objectName;
+    ds >> geometry;
+    ds >> orientation;
+    ds >> type;
+    ds >> indexOfFrom;
+    ds >> indexOfTo;
+    ds >> indexOfFollowee;
+    ds >> positionPercentage;
+    ds >> side1Items;
+    ds >> side2Items;
+}
 
-    orientation = map.value(QStringLiteral("orientation")).toInt();
-    type = map.value(QStringLiteral("type")).toInt();
-    indexOfFrom = map.value(QStringLiteral("indexOfFrom")).toInt();
-    indexOfTo = map.value(QStringLiteral("indexOfTo")).toInt();
-    indexOfFollowee = map.value(QStringLiteral("indexOfFollowee")).toInt();
-    positionPercentage = map.value(QStringLiteral("positionPercentage")).toDouble();
+void LayoutSaver::Anchor::readJson(JsonStreamReader &reader)
+{
+    if (!reader.beginObject())
+        return;
 
-    side1Items.clear();
-    side2Items.clear();
-    const QVariantList side1ItemsV = map.value(QStringLiteral("side1Items")).toList();
-    const QVariantList side2ItemsV = map.value(QStringLiteral("side2Items")).toList();
-    side1Items.reserve(side1ItemsV.size());
-    side2Items.reserve(side2ItemsV.size());
-    for (const QVariant &v : side1ItemsV)
-        side1Items.push_back(v.toInt());
-    for (const QVariant &v : side2ItemsV)
-        side2Items.push_back(v.toInt());
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("objectName"))
+            objectName = reader.readString();
+        else if (key == QLatin1String("geometry"))
+            geometry = readJsonRect(reader);
+        else if (key == QLatin1String("orientation"))
+            orientation = reader.readInt();
+        else if (key == QLatin1String("type"))
+            type = reader.readInt();
+        else if (key == QLatin1String("indexOfFrom"))
+            indexOfFrom = reader.readInt();
+        else if (key == QLatin1String("indexOfTo"))
+            indexOfTo = reader.readInt();
+        else if (key == QLatin1String("indexOfFollowee"))
+            indexOfFollowee = reader.readInt();
+        else if (key == QLatin1String("positionPercentage"))
+            positionPercentage = reader.readDouble();
+        else if (key == QLatin1String("side1Items"))
+            side1Items = readJsonIntList(reader);
+        else if (key == QLatin1String("side2Items"))
+            side2Items = readJsonIntList(reader);
+        else
+            reader.skipValue();
+    }
 }
 
 void LayoutSaver::Anchor::scaleSizes(const ScalingInfo &scalingInfo)
@@ -803,35 +2235,102 @@ bool LayoutSaver::FloatingWindow::isValid() const
 
 void LayoutSaver::FloatingWindow::scaleSizes(const ScalingInfo &scalingInfo)
 {
-    scalingInfo.applyFactorsTo(/*by-ref*/geometry);
+    scalingInfo.applyFactorsToTopLevel(/*by-ref*/geometry);
     multiSplitterLayout.scaleSizes(scalingInfo);
 }
 
-QVariantMap LayoutSaver::FloatingWindow::toVariantMap() const
+void LayoutSaver::FloatingWindow::writeJson(JsonStreamWriter &writer) const
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("multiSplitterLayout"), multiSplitterLayout.toVariantMap());
-    map.insert(QStringLiteral("parentIndex"), parentIndex);
-    map.insert(QStringLiteral("geometry"), rectToMap(geometry));
-    map.insert(QStringLiteral("screenIndex"), screenIndex);
-    map.insert(QStringLiteral("screenSize"), sizeToMap(screenSize));
-    map.insert(QStringLiteral("isVisible"), isVisible);
+    writer.beginObject();
+    if (!affinityName.isEmpty()) {
+        writer.writeKey("affinityName");
+        writer.writeString(affinityName);
+    }
+    writeJsonRect(writer, "geometry", geometry);
+    writer.writeKey("isVisible");
+    writer.writeBool(isVisible);
+    writer.writeKey("multiSplitterLayout");
+    multiSplitterLayout.writeJson(writer);
+    writer.writeKey("parentIndex");
+    writer.writeInt(parentIndex);
+    writer.writeKey("screenIndex");
+    writer.writeInt(screenIndex);
+    writeJsonSize(writer, "screenSize", screenSize);
+    writer.endObject();
+}
+
+void LayoutSaver::FloatingWindow::writeBinary(QDataStream &ds) const
+{
+    multiSplitterLayout.writeBinary(ds);
+    ds << parentIndex;
+    ds << geometry;
+    ds << screenIndex;
+    ds << screenSize;
+    ds << isVisible;
+    ds << affinityName;
+}
+
+void LayoutSaver::FloatingWindow::addToHash(LayoutHasher &hasher, bool includeGeometry) const
+{
+    multiSplitterLayout.addToHash(hasher, includeGeometry);
+    hasher.addInt(parentIndex);
+    if (includeGeometry) {
+        hasher.addRect(geometry);
+        hasher.addInt(screenIndex);
+        hasher.addSize(screenSize);
+    }
+    hasher.addBool(isVisible);
+    hasher.addString(affinityName);
+}
 
-    if (!affinityName.isEmpty())
-        map.insert(QStringLiteral("affinityName"), affinityName);
+void LayoutSaver::FloatingWindow::readBinary(QDataStream &ds)
+{
+    multiSplitterLayout.readBinary(ds);
+    ds >> parentIndex;
+    ds >> geometry;
+    ds >> screenIndex;
+    ds >> screenSize;
+    ds >> isVisible;
+    ds >> affinityName;
 
-    return map;
+    if (isSkippedByAffinity(affinityName)) {
+        // The binary format has no lengths to skip with, so it was parsed anyway. At least don't scale it.
+        skippedByAffinity = true;
+        multiSplitterLayout = {};
+    }
 }
 
-void LayoutSaver::FloatingWindow::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::FloatingWindow::readJson(JsonStreamReader &reader)
 {
-    multiSplitterLayout.fromVariantMap(map.value(QStringLiteral("multiSplitterLayout")).toMap());
-    parentIndex = map.value(QStringLiteral("parentIndex")).toInt();
-    geometry = mapToRect(map.value(QStringLiteral("geometry")).toMap());
-    screenIndex = map.value(QStringLiteral("screenIndex")).toInt();
-    screenSize = mapToSize(map.value(QStringLiteral("screenSize")).toMap());
-    isVisible = map.value(QStringLiteral("isVisible")).toBool();
-    affinityName = map.value(QStringLiteral("affinityName")).toString();
+    if (!reader.beginObject())
+        return;
+
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("multiSplitterLayout"))
+            multiSplitterLayout.readJson(reader);
+        else if (key == QLatin1String("parentIndex"))
+            parentIndex = reader.readInt();
+        else if (key == QLatin1String("geometry"))
+            geometry = readJsonRect(reader);
+        else if (key == QLatin1String("screenIndex"))
+            screenIndex = reader.readInt();
+        else if (key == QLatin1String("screenSize"))
+            screenSize = readJsonSize(reader);
+        else if (key == QLatin1String("isVisible"))
+            isVisible = reader.readBool();
+        else if (key == QLatin1String("affinityName")) {
+            affinityName = reader.readString();
+            if (isSkippedByAffinity(affinityName)) {
+                // Keys are sorted, so affinityName comes first and the whole subtree is skipped
+                skippedByAffinity = true;
+                multiSplitterLayout = {};
+                skipRemainingMembers(reader);
+                return;
+            }
+        } else
+            reader.skipValue();
+    }
 }
 
 bool LayoutSaver::MainWindow::isValid() const
@@ -847,7 +2346,7 @@ bool LayoutSaver::MainWindow::isValid() const
     return true;
 }
 
-void LayoutSaver::MainWindow::scaleSizes()
+void LayoutSaver::MainWindow::initScalingInfo()
 {
     if (scalingInfo.isValid()) {
         // Doesn't happen, it's called only once
@@ -856,39 +2355,115 @@ void LayoutSaver::MainWindow::scaleSizes()
     }
 
     scalingInfo = ScalingInfo(uniqueName, geometry);
+}
 
+void LayoutSaver::MainWindow::scaleSizes()
+{
     if (scalingInfo.isValid())
         multiSplitterLayout.scaleSizes(scalingInfo);
 }
 
-QVariantMap LayoutSaver::MainWindow::toVariantMap() const
+void LayoutSaver::MainWindow::writeJson(JsonStreamWriter &writer) const
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("options"), int(options));
-    map.insert(QStringLiteral("multiSplitterLayout"), multiSplitterLayout.toVariantMap());
-    map.insert(QStringLiteral("uniqueName"), uniqueName);
-    map.insert(QStringLiteral("geometry"), rectToMap(geometry));
-    map.insert(QStringLiteral("screenIndex"), screenIndex);
-    map.insert(QStringLiteral("screenSize"), sizeToMap(screenSize));
-    map.insert(QStringLiteral("isVisible"), isVisible);
-
-    if (!affinityName.isEmpty())
-        map.insert(QStringLiteral("affinityName"), affinityName);
-
-    return map;
+    writer.beginObject();
+    if (!affinityName.isEmpty()) {
+        writer.writeKey("affinityName");
+        writer.writeString(affinityName);
+    }
+    writeJsonRect(writer, "geometry", geometry);
+    writer.writeKey("isVisible");
+    writer.writeBool(isVisible);
+    writer.writeKey("multiSplitterLayout");
+    multiSplitterLayout.writeJson(writer);
+    writer.writeKey("options");
+    writer.writeInt(int(options));
+    writer.writeKey("screenIndex");
+    writer.writeInt(screenIndex);
+    writeJsonSize(writer, "screenSize", screenSize);
+    writer.writeKey("uniqueName");
+    writer.writeString(uniqueName);
+    writer.endObject();
+}
+
+void LayoutSaver::MainWindow::writeBinary(QDataStream &ds) const
+{
+    ds << int(options);
+    multiSplitterLayout.writeBinary(ds);
+    ds << uniqueName;
+    ds << affinityName;
+    ds << geometry;
+    ds << screenIndex;
+    ds << screenSize;
+    ds << isVisible;
+}
+
+void LayoutSaver::MainWindow::addToHash(LayoutHasher &hasher, bool includeGeometry) const
+{
+    hasher.addInt(int(options));
+    multiSplitterLayout.addToHash(hasher, includeGeometry);
+    hasher.addString(uniqueName);
+    hasher.addString(affinityName);
+    if (includeGeometry) {
+        hasher.addRect(geometry);
+        hasher.addInt(screenIndex);
+        hasher.addSize(screenSize);
+    }
+    hasher.addBool(isVisible);
+}
+
+void LayoutSaver::MainWindow::readBinary(QDataStream &ds)
+{
+    int opts = 0;
+    ds >> opts;
+    options = KDDockWidgets::MainWindowOptions(opts);
+    multiSplitterLayout.readBinary(ds);
+    ds >> uniqueName;
+    ds >> affinityName;
+    ds >> geometry;
+    ds >> screenIndex;
+    ds >> screenSize;
+    ds >> isVisible;
+
+    if (isSkippedByAffinity(affinityName)) {
+        // See FloatingWindow::readBinary()
+        skippedByAffinity = true;
+        multiSplitterLayout = {};
+    }
 }
 
-void LayoutSaver::MainWindow::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::MainWindow::readJson(JsonStreamReader &reader)
 {
-    options = KDDockWidgets::MainWindowOptions(map.value(QStringLiteral("options")).toInt());
-    multiSplitterLayout.fromVariantMap(map.value(QStringLiteral("multiSplitterLayout")).toMap());
-    uniqueName = map.value(QStringLiteral("uniqueName")).toString();
-    affinityName = map.value(QStringLiteral("affinityName")).toString();
-    geometry = mapToRect(map.value(QStringLiteral("geometry")).toMap());
-    screenIndex = map.value(QStringLiteral("screenIndex")).toInt();
-    screenSize = mapToSize(map.value(QStringLiteral("screenSize")).toMap());
+    if (!reader.beginObject())
+        return;
 
-    isVisible = map.value(QStringLiteral("isVisible")).toBool();
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("options"))
+            options = KDDockWidgets::MainWindowOptions(reader.readInt());
+        else if (key == QLatin1String("multiSplitterLayout"))
+            multiSplitterLayout.readJson(reader);
+        else if (key == QLatin1String("uniqueName"))
+            uniqueName = reader.readString();
+        else if (key == QLatin1String("affinityName")) {
+            affinityName = reader.readString();
+            if (isSkippedByAffinity(affinityName)) {
+                // See FloatingWindow::readJson()
+                skippedByAffinity = true;
+                multiSplitterLayout = {};
+                skipRemainingMembers(reader);
+                return;
+            }
+        } else if (key == QLatin1String("geometry"))
+            geometry = readJsonRect(reader);
+        else if (key == QLatin1String("screenIndex"))
+            screenIndex = reader.readInt();
+        else if (key == QLatin1String("screenSize"))
+            screenSize = readJsonSize(reader);
+        else if (key == QLatin1String("isVisible"))
+            isVisible = reader.readBool();
+        else
+            reader.skipValue();
+    }
 }
 
 bool LayoutSaver::MultiSplitterLayout::isValid() const
@@ -911,6 +2486,85 @@ bool LayoutSaver::MultiSplitterLayout::isValid() const
     return true;
 }
 
+bool LayoutSaver::MultiSplitterLayout::hasValidReferences(QSet<QString> &dockNames) const
+{
+    const int numAnchors = anchors.size();
+    const int numItems = items.size();
+    auto isAnchorIndex = [numAnchors] (int index) {
+        return index >= 0 && index < numAnchors;
+    };
+
+    // MultiSplitterLayout::deserialize() expects exactly one of each static anchor
+    QHash<int, int> numStaticAnchors;
+    for (const LayoutSaver::Anchor &anchor : anchors) {
+        if (!isAnchorIndex(anchor.indexOfFrom) || !isAnchorIndex(anchor.indexOfTo) || anchor.indexOfFrom == anchor.indexOfTo
+            || (anchor.indexOfFollowee != -1 && !isAnchorIndex(anchor.indexOfFollowee))) {
+            qWarning() << Q_FUNC_INFO << "Invalid anchor indexes" << anchor.indexOfFrom
+                       << anchor.indexOfTo << anchor.indexOfFollowee;
+            return false;
+        }
+
+        for (const QVector<int> *side : { &anchor.side1Items, &anchor.side2Items }) {
+            for (int index : *side) {
+                if (index < 0 || index >= numItems) {
+                    qWarning() << Q_FUNC_INFO << "Invalid item index" << index << numItems;
+                    return false;
+                }
+            }
+        }
+
+        switch (anchor.type) {
+        case KDDockWidgets::Anchor::Type_None:
+            break;
+        case KDDockWidgets::Anchor::Type_LeftStatic:
+        case KDDockWidgets::Anchor::Type_RightStatic:
+        case KDDockWidgets::Anchor::Type_TopStatic:
+        case KDDockWidgets::Anchor::Type_BottomStatic:
+            if (++numStaticAnchors[anchor.type] > 1) {
+                qWarning() << Q_FUNC_INFO << "Duplicate static anchor" << anchor.type;
+                return false;
+            }
+            break;
+        default:
+            qWarning() << Q_FUNC_INFO << "Invalid anchor type" << anchor.type;
+            return false;
+        }
+    }
+
+    if (numStaticAnchors.size() != 4) {
+        qWarning() << Q_FUNC_INFO << "Missing static anchors" << numStaticAnchors.keys();
+        return false;
+    }
+
+    for (const LayoutSaver::Item &item : items) {
+        if (!isAnchorIndex(item.indexOfLeftAnchor) || !isAnchorIndex(item.indexOfTopAnchor)
+            || !isAnchorIndex(item.indexOfRightAnchor) || !isAnchorIndex(item.indexOfBottomAnchor)) {
+            qWarning() << Q_FUNC_INFO << "Invalid anchor indexes" << item.indexOfLeftAnchor << item.indexOfTopAnchor
+                       << item.indexOfRightAnchor << item.indexOfBottomAnchor;
+            return false;
+        }
+
+        const LayoutSaver::Frame &frame = item.frame;
+        if (frame.isNull)
+            continue;
+
+        if (!frame.dockWidgets.isEmpty() && (frame.currentTabIndex < 0 || frame.currentTabIndex >= frame.dockWidgets.size())) {
+            qWarning() << Q_FUNC_INFO << "Invalid tab index" << frame.currentTabIndex << frame.dockWidgets.size();
+            return false;
+        }
+
+        for (const auto &dw : frame.dockWidgets) {
+            if (!dw->isValid() || dockNames.contains(dw->uniqueName)) {
+                qWarning() << Q_FUNC_INFO << "Invalid or duplicate dock widget" << dw->uniqueName;
+                return false;
+            }
+            dockNames.insert(dw->uniqueName);
+        }
+    }
+
+    return true;
+}
+
 void LayoutSaver::MultiSplitterLayout::scaleSizes(const ScalingInfo &scalingInfo)
 {
     scalingInfo.applyFactorsTo(/*by-ref*/size);
@@ -920,24 +2574,66 @@ void LayoutSaver::MultiSplitterLayout::scaleSizes(const ScalingInfo &scalingInfo
         item.scaleSizes(scalingInfo);
 }
 
-QVariantMap LayoutSaver::MultiSplitterLayout::toVariantMap() const
+void LayoutSaver::MultiSplitterLayout::writeJson(JsonStreamWriter &writer) const
 {
-    QVariantMap map;
+    writer.beginObject();
+    writeJsonList<LayoutSaver::Anchor>(writer, "anchors", anchors);
+    writeJsonList<LayoutSaver::Item>(writer, "items", items);
+    writeJsonSize(writer, "minSize", minSize);
+    writeJsonSize(writer, "size", size);
+    writer.endObject();
+}
+
+void LayoutSaver::MultiSplitterLayout::writeBinary(QDataStream &ds) const
+{
+    writeBinaryList<LayoutSaver::Anchor>(ds, anchors);
+    writeBinaryList<LayoutSaver::Item>(ds, items);
+    ds << minSize;
+    ds << size;
+}
+
+void LayoutSaver::MultiSplitterLayout::addToHash(LayoutHasher &hasher, bool includeGeometry) const
+{
+    hasher.addInt(anchors.size());
+    for (const LayoutSaver::Anchor &anchor : anchors)
+        anchor.addToHash(hasher, includeGeometry);
 
-    map.insert(QStringLiteral("anchors"), toVariantList<LayoutSaver::Anchor>(anchors));
-    map.insert(QStringLiteral("items"), toVariantList<LayoutSaver::Item>(items));
-    map.insert(QStringLiteral("minSize"), sizeToMap(minSize));
-    map.insert(QStringLiteral("size"), sizeToMap(size));
+    hasher.addInt(items.size());
+    for (const LayoutSaver::Item &item : items)
+        item.addToHash(hasher, includeGeometry);
 
-    return map;
+    if (includeGeometry) {
+        hasher.addSize(minSize);
+        hasher.addSize(size);
+    }
+}
+
+void LayoutSaver::MultiSplitterLayout::readBinary(QDataStream &ds)
+{
+    anchors = readBinaryList<LayoutSaver::Anchor>(ds);
+    items = readBinaryList<LayoutSaver::Item>(ds);
+    ds >> minSize;
+    ds >> size;
 }
 
-void LayoutSaver::MultiSplitterLayout::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::MultiSplitterLayout::readJson(JsonStreamReader &reader)
 {
-    anchors = fromVariantList<LayoutSaver::Anchor>(map.value(QStringLiteral("anchors")).toList());
-    items = fromVariantList<LayoutSaver::Item>(map.value(QStringLiteral("items")).toList());
-    minSize = mapToSize(map.value(QStringLiteral("minSize")).toMap());
-    size = mapToSize(map.value(QStringLiteral("size")).toMap());
+    if (!reader.beginObject())
+        return;
+
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("anchors"))
+            anchors = readJsonList<LayoutSaver::Anchor>(reader);
+        else if (key == QLatin1String("items"))
+            items = readJsonList<LayoutSaver::Item>(reader);
+        else if (key == QLatin1String("minSize"))
+            minSize = readJsonSize(reader);
+        else if (key == QLatin1String("size"))
+            size = readJsonSize(reader);
+        else
+            reader.skipValue();
+    }
 }
 
 void LayoutSaver::LastPosition::scaleSizes(const ScalingInfo &scalingInfo)
@@ -945,64 +2641,219 @@ void LayoutSaver::LastPosition::scaleSizes(const ScalingInfo &scalingInfo)
     scalingInfo.applyFactorsTo(/*by-ref*/lastFloatingGeometry);
 }
 
-QVariantMap LayoutSaver::LastPosition::toVariantMap() const
+void LayoutSaver::LastPosition::writeJson(JsonStreamWriter &writer) const
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("lastFloatingGeometry"), rectToMap(lastFloatingGeometry));
-    map.insert(QStringLiteral("tabIndex"), tabIndex);
-    map.insert(QStringLiteral("wasFloating"), wasFloating);
-    map.insert(QStringLiteral("placeholders"), toVariantList<LayoutSaver::Placeholder>(placeholders));
+    writer.beginObject();
+    writeJsonRect(writer, "lastFloatingGeometry", lastFloatingGeometry);
 
-    return map;
+    // A few arrays instead of an object per placeholder, closed dock widgets can have many of them.
+    // Main window names are only written for placeholders whose floating window index is -1.
+    QVector<int> floatingWindowIndexes;
+    QVector<int> itemIndexes;
+    floatingWindowIndexes.reserve(placeholders.size());
+    itemIndexes.reserve(placeholders.size());
+    for (const LayoutSaver::Placeholder &placeholder : placeholders) {
+        floatingWindowIndexes.push_back(placeholder.isFloatingWindow ? placeholder.indexOfFloatingWindow : -1);
+        itemIndexes.push_back(placeholder.itemIndex);
+    }
+
+    writeJsonIntList(writer, "placeholderFloatingWindows", floatingWindowIndexes);
+    writeJsonIntList(writer, "placeholderItemIndexes", itemIndexes);
+    writer.writeKey("placeholderMainWindows");
+    writer.beginArray();
+    for (const LayoutSaver::Placeholder &placeholder : placeholders) {
+        if (!placeholder.isFloatingWindow)
+            writer.writeString(placeholder.mainWindowUniqueName);
+    }
+    writer.endArray();
+
+    writer.writeKey("tabIndex");
+    writer.writeInt(tabIndex);
+    writer.writeKey("wasFloating");
+    writer.writeBool(wasFloating);
+    writer.endObject();
 }
 
-void LayoutSaver::LastPosition::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::LastPosition::writeBinary(QDataStream &ds) const
 {
-    lastFloatingGeometry = mapToRect(map.value(QStringLiteral("lastFloatingGeometry")).toMap());
-    tabIndex = map.value(QStringLiteral("tabIndex")).toInt();
-    wasFloating = map.value(QStringLiteral("wasFloating")).toBool();
-    placeholders = fromVariantList<LayoutSaver::Placeholder>(map.value(QStringLiteral("placeholders")).toList());
+    ds << lastFloatingGeometry;
+    ds << tabIndex;
+    ds << wasFloating;
+    writeBinaryList<LayoutSaver::Placeholder>(ds, placeholders);
 }
 
-QVariantMap LayoutSaver::ScreenInfo::toVariantMap() const
+void LayoutSaver::LastPosition::readBinary(QDataStream &ds)
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("index"), index);
-    map.insert(QStringLiteral("geometry"), rectToMap(geometry));
-    map.insert(QStringLiteral("name"), name);
-    map.insert(QStringLiteral("devicePixelRatio"), devicePixelRatio);
+    ds >> lastFloatingGeometry;
+    ds >> tabIndex;
+    ds >> wasFloating;
+    placeholders = readBinaryList<LayoutSaver::Placeholder>(ds);
+}
 
-    return map;
+void LayoutSaver::LastPosition::readJson(JsonStreamReader &reader)
+{
+    if (!reader.beginObject())
+        return;
+
+    QVector<int> floatingWindowIndexes;
+    QVector<int> itemIndexes;
+    QStringList mainWindowNames;
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("lastFloatingGeometry"))
+            lastFloatingGeometry = readJsonRect(reader);
+        else if (key == QLatin1String("tabIndex"))
+            tabIndex = reader.readInt();
+        else if (key == QLatin1String("wasFloating"))
+            wasFloating = reader.readBool();
+        else if (key == QLatin1String("placeholders")) // Before serialization version 3
+            placeholders = readJsonList<LayoutSaver::Placeholder>(reader);
+        else if (key == QLatin1String("placeholderFloatingWindows"))
+            floatingWindowIndexes = readJsonIntList(reader);
+        else if (key == QLatin1String("placeholderItemIndexes"))
+            itemIndexes = readJsonIntList(reader);
+        else if (key == QLatin1String("placeholderMainWindows"))
+            mainWindowNames = readJsonStringList(reader);
+        else
+            reader.skipValue();
+    }
+
+    if (itemIndexes.isEmpty())
+        return;
+
+    if (floatingWindowIndexes.size() != itemIndexes.size()) {
+        qWarning() << Q_FUNC_INFO << "Inconsistent placeholder arrays" << floatingWindowIndexes.size() << itemIndexes.size();
+        return;
+    }
+
+    placeholders.clear();
+    placeholders.reserve(itemIndexes.size());
+    int mainWindowNameIndex = 0;
+    for (int i = 0, end = itemIndexes.size(); i < end; ++i) {
+        LayoutSaver::Placeholder placeholder;
+        placeholder.isFloatingWindow = floatingWindowIndexes.at(i) != -1;
+        placeholder.indexOfFloatingWindow = floatingWindowIndexes.at(i);
+        placeholder.itemIndex = itemIndexes.at(i);
+        if (!placeholder.isFloatingWindow) {
+            if (mainWindowNameIndex >= mainWindowNames.size()) {
+                qWarning() << Q_FUNC_INFO << "Missing placeholder main window name";
+                placeholders.clear();
+                return;
+            }
+            placeholder.mainWindowUniqueName = mainWindowNames.at(mainWindowNameIndex++);
+        }
+        placeholders.push_back(placeholder);
+    }
+}
+
+LayoutSaver::ScreenInfo::List LayoutSaver::ScreenInfo::currentScreens()
+{
+    List result;
+    const QList<QScreen*> screens = qApp->screens();
+    result.reserve(screens.size());
+    for (int i = 0; i < screens.size(); ++i) {
+        ScreenInfo info;
+        info.index = i;
+        info.geometry = screens[i]->geometry();
+        info.name = screens[i]->name();
+        info.devicePixelRatio = screens[i]->devicePixelRatio();
+        result.push_back(info);
+    }
+
+    return result;
 }
 
-void LayoutSaver::ScreenInfo::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::ScreenInfo::writeJson(JsonStreamWriter &writer) const
 {
-    index = map.value(QStringLiteral("index")).toInt();
-    geometry = mapToRect(map.value(QStringLiteral("geometry")).toMap());
-    name = map.value(QStringLiteral("name")).toString();
-    devicePixelRatio = map.value(QStringLiteral("devicePixelRatio")).toDouble();
+    writer.beginObject();
+    writer.writeKey("devicePixelRatio");
+    writer.writeDouble(devicePixelRatio);
+    writeJsonRect(writer, "geometry", geometry);
+    writer.writeKey("index");
+    writer.writeInt(index);
+    writer.writeKey("name");
+    writer.writeString(name);
+    writer.endObject();
 }
 
-QVariantMap LayoutSaver::Placeholder::toVariantMap() const
+void LayoutSaver::ScreenInfo::writeBinary(QDataStream &ds) const
 {
-    QVariantMap map;
-    map.insert(QStringLiteral("isFloatingWindow"), isFloatingWindow);
-    map.insert(QStringLiteral("itemIndex"), itemIndex);
+    ds << index;
+    ds << geometry;
+    ds << name;
+    ds << devicePixelRatio;
+}
+
+void LayoutSaver::ScreenInfo::readBinary(QDataStream &ds)
+{
+    ds >> index;
+    ds >> geometry;
+    ds >> name;
+    ds >> devicePixelRatio;
+}
+
+void LayoutSaver::ScreenInfo::readJson(JsonStreamReader &reader)
+{
+    if (!reader.beginObject())
+        return;
+
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("index"))
+            index = reader.readInt();
+        else if (key == QLatin1String("geometry"))
+            geometry = readJsonRect(reader);
+        else if (key == QLatin1String("name"))
+            name = reader.readString();
+        else if (key == QLatin1String("devicePixelRatio"))
+            devicePixelRatio = reader.readDouble();
+        else
+            reader.skipValue();
+    }
+}
 
+void LayoutSaver::Placeholder::writeBinary(QDataStream &ds) const
+{
+    ds << isFloatingWindow;
+    ds << itemIndex;
     if (isFloatingWindow)
-        map.insert(QStringLiteral("indexOfFloatingWindow"), indexOfFloatingWindow);
+        ds << indexOfFloatingWindow;
     else
-        map.insert(QStringLiteral("mainWindowUniqueName"), mainWindowUniqueName);
+        ds << mainWindowUniqueName;
+}
 
-    return map;
+void LayoutSaver::Placeholder::readBinary(QDataStream &ds)
+{
+    ds >> isFloatingWindow;
+    ds >> itemIndex;
+    indexOfFloatingWindow = -1;
+    mainWindowUniqueName.clear();
+    if (isFloatingWindow)
+        ds >> indexOfFloatingWindow;
+    else
+        ds >> mainWindowUniqueName;
 }
 
-void LayoutSaver::Placeholder::fromVariantMap(const QVariantMap &map)
+void LayoutSaver::Placeholder::readJson(JsonStreamReader &reader)
 {
-    isFloatingWindow = map.value(QStringLiteral("isFloatingWindow")).toBool();
-    indexOfFloatingWindow = map.value(QStringLiteral("indexOfFloatingWindow"), -1).toInt();
-    itemIndex = map.value(QStringLiteral("itemIndex")).toInt();
-    mainWindowUniqueName = map.value(QStringLiteral("mainWindowUniqueName")).toString();
+    indexOfFloatingWindow = -1;
+
+    if (!reader.beginObject())
+        return;
+
+    QString key;
+    while (reader.nextMember(key)) {
+        if (key == QLatin1String("isFloatingWindow"))
+            isFloatingWindow = reader.readBool();
+        else if (key == QLatin1String("indexOfFloatingWindow"))
+            indexOfFloatingWindow = reader.readInt();
+        else if (key == QLatin1String("itemIndex"))
+            itemIndex = reader.readInt();
+        else if (key == QLatin1String("mainWindowUniqueName"))
+            mainWindowUniqueName = reader.readString();
+        else
+            reader.skipValue();
+    }
 }
 
 LayoutSaver::ScalingInfo::ScalingInfo(const QString &mainWindowId, QRect savedMainWindowGeo)
@@ -1030,6 +2881,20 @@ LayoutSaver::ScalingInfo::ScalingInfo(const QString &mainWindowId, QRect savedMa
     heightFactor = double(realMainWindowGeometry.height()) / savedMainWindowGeo.height();
 }
 
+LayoutSaver::ScalingInfo::ScalingInfo(QRect savedScreenGeo, QRect currentScreenGeo)
+{
+    if (!savedScreenGeo.isValid() || !currentScreenGeo.isValid())
+        return;
+
+    if (savedScreenGeo == currentScreenGeo)
+        return; // Nothing to do, leave it invalid
+
+    savedScreenOrigin = savedScreenGeo.topLeft();
+    currentScreenOrigin = currentScreenGeo.topLeft();
+    widthFactor = double(currentScreenGeo.width()) / savedScreenGeo.width();
+    heightFactor = double(currentScreenGeo.height()) / savedScreenGeo.height();
+}
+
 void LayoutSaver::ScalingInfo::translatePos(QPoint &pt) const
 {
     const int deltaX = pt.x() - savedMainWindowGeometry.x();
@@ -1068,3 +2933,14 @@ void LayoutSaver::ScalingInfo::applyFactorsTo(QRect &rect) const
     rect.moveTopLeft(pos);
     rect.setSize(size);
 }
+
+void LayoutSaver::ScalingInfo::applyFactorsToTopLevel(QRect &rect) const
+{
+    if (rect.isEmpty())
+        return;
+
+    // Without a screen origin this is the same as applyFactorsTo()
+    rect.translate(-savedScreenOrigin);
+    applyFactorsTo(/*by-ref*/rect);
+    rect.translate(currentScreenOrigin);
+}
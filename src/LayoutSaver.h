@@ -32,6 +32,10 @@
 
 #include "KDDockWidgets.h"
 
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
 QT_BEGIN_NAMESPACE
 class QByteArray;
 QT_END_NAMESPACE
@@ -52,24 +56,83 @@ public:
     ///@brief returns whether a restore (@ref restoreLayout) is in progress
     static bool restoreInProgress();
 
+    /**
+     * @brief returns a counter that's incremented whenever something that would be saved has changed.
+     *
+     * Separator moves, dock widgets being added, removed, opened or closed, and floating windows being
+     * moved or resized all increment it. Autosave code can compare it against the value at the last
+     * save and skip serializing the layout when it's the same.
+     */
+    static quint64 layoutGeneration();
+
     /**
      * @brief saves the layout to JSON file
      * @brief jsonFilename the filename where the layout will be saved to
+     * @brief format the format to save in. JSON by default.
      * @return true on success
      */
-    bool saveToFile(const QString &jsonFilename);
+    bool saveToFile(const QString &jsonFilename, SerializationFormat format = SerializationFormat_Json);
 
     /**
      * @brief restores the layout from a JSON file
      * @brief jsonFilename the filename containing a saved layout
+     * The file can also be in the binary format, see @ref SerializationFormat_Binary
      * @return true on success
      */
     bool restoreFromFile(const QString &jsonFilename);
 
+    /**
+     * @brief returns a fingerprint of the current screen configuration
+     *
+     * Derived from the geometry, name and devicePixelRatio of each screen. It's the same for as long as
+     * the monitors don't change. See saveToDirectory().
+     */
+    static QString screenConfigurationKey();
+
+    /**
+     * @brief saves the layout into @p directory, in a file specific to the current screen configuration
+     *
+     * Each screen configuration, like the office's three monitors and the laptop's single one, gets
+     * its own file, overwriting only the previous layout saved under the same configuration.
+     * The directory is created if needed.
+     * @sa restoreFromDirectory(), screenConfigurationKey()
+     * @return true on success
+     */
+    bool saveToDirectory(const QString &directory, SerializationFormat format = SerializationFormat_Json);
+
+    /**
+     * @brief restores the layout which was saved into @p directory for the current screen configuration
+     *
+     * If the current configuration was never saved then the most recently saved layout is restored instead.
+     * Use @ref RestoreOption_RelativeToMainWindow to have it scaled to the new screens.
+     * @sa saveToDirectory()
+     * @return true on success
+     */
+    bool restoreFromDirectory(const QString &directory);
+
     /**
      * @brief saves the layout into a byte array
+     * @param format JSON by default. SerializationFormat_Binary is faster and more compact,
+     * which is interesting for frequent autosaves of big layouts.
      */
-    QByteArray serializeLayout() const;
+    QByteArray serializeLayout(SerializationFormat format = SerializationFormat_Json) const;
+
+    /**
+     * @brief saves the layout as the difference against @p base, a layout previously returned by serializeLayout()
+     *
+     * Main windows and floating windows which are the same as in @p base are only referenced, and the
+     * result is compressed, so many similar layouts cost little more than one.
+     * It can't be passed to restoreLayout() directly, see resolveLayoutDelta().
+     * @return the delta, or an empty byte array if @p base can't be parsed
+     */
+    QByteArray serializeLayoutDelta(const QByteArray &base) const;
+
+    /**
+     * @brief returns the layout which @p delta was computed from, in the binary format, ready for restoreLayout()
+     * @param base the same layout that was passed to serializeLayoutDelta()
+     * @return an empty byte array if @p delta isn't a delta, or if it was computed against a different base
+     */
+    static QByteArray resolveLayoutDelta(const QByteArray &base, const QByteArray &delta);
 
     /**
      * @brief restores the layout from a byte array
@@ -79,6 +142,8 @@ public:
      * If not all DockWidgets can be created beforehand then make sure to set
      * a DockWidget factory via Config::setDockWidgetFactoryFunc()
      *
+     * The format (JSON, binary or compressed binary) is detected automatically.
+     *
      * @sa Config::setDockWidgetFactoryFunc()
      *
      * @return true on success
@@ -93,6 +158,23 @@ public:
      */
     QVector<DockWidgetBase *> restoredDockWidgets() const;
 
+    /**
+     * @brief returns the names of the closed dock widgets which were restored with
+     * @ref RestoreOption_LazyClosedDockWidgets and weren't created yet
+     */
+    static QStringList lazyDockWidgetNames();
+
+    /**
+     * @brief returns the dock widget named @p uniqueName.
+     *
+     * If it was deferred by @ref RestoreOption_LazyClosedDockWidgets then it's created now, via the
+     * DockWidgetFactoryFunc, and will open at its saved position when shown.
+     * Returns nullptr if there's no such dock widget.
+     *
+     * @sa Config::setDockWidgetFactoryFunc()
+     */
+    static DockWidgetBase *dockWidgetByName(const QString &uniqueName);
+
 
     /**
      * @brief Sets the list of affinity names for which restore and save will be applied on.
@@ -102,6 +184,38 @@ public:
      */
     void setAffinityNames(const QStringList &affinityNames);
 
+    /**
+     * @brief Timings and counters of a restoreLayout() call. Useful to find out why a specific layout is slow to restore.
+     * Times are in microseconds. @sa restoreReport()
+     */
+    struct RestoreReport
+    {
+        struct WindowTiming
+        {
+            QString name; ///< The MainWindow's unique name, or the FloatingWindow's index
+            qint64 usecs = 0;
+        };
+
+        bool success = false;
+        qint64 totalUSecs = 0;
+        qint64 parseUSecs = 0; ///< Parsing, validating, and scaling with RestoreOption_RelativeToMainWindow
+        qint64 clearUSecs = 0; ///< Closing the dock widgets and clearing the previous layouts
+        QVector<WindowTiming> mainWindows; ///< Rebuilding each MainWindow's layout
+        QVector<WindowTiming> floatingWindows; ///< Creating each FloatingWindow
+        qint64 placeholdersUSecs = 0; ///< Restoring the closed dock widgets and the placeholders
+        qint64 finalizeUSecs = 0; ///< Deleting unused frames and the final relayout
+
+        int numFrames = 0; ///< Number of frames created
+        int numAnchors = 0; ///< Number of anchors created
+        int numItems = 0; ///< Number of items created, including placeholders
+
+        ///@brief returns this report as a QVariantMap, for QJsonDocument::fromVariant() or telemetry
+        QVariantMap toVariantMap() const;
+    };
+
+    ///@brief returns the timings and counters of the last restoreLayout() or restoreFromFile() call
+    const RestoreReport &restoreReport() const;
+
     struct Layout;
     struct MainWindow;
     struct FloatingWindow;
@@ -117,6 +231,19 @@ public:
 
 private:
     friend class TestDocks;
+    friend class AsyncLayoutSaver;
+    friend class AsyncLayoutRestorer;
+    friend class LayoutHistory;
+
+    ///@brief Fills @p layout with the current state of the windows and dock widgets. Used by serializeLayout().
+    bool snapshotLayout(Layout &layout) const;
+
+    // restoreLayout() in steps, for AsyncLayoutRestorer. See LayoutSaver::Private::beginRestore()
+    bool beginRestore(const QByteArray &data, bool hideMainWindows);
+    bool restoreStep();
+    void cancelRestore();
+    int restoreStepsDone() const;
+    int restoreStepCount() const;
 
     class Private;
     Private *const d;
@@ -30,44 +30,111 @@
 #include <QScreen>
 #include <QApplication>
 #include <QJsonDocument>
+#include <QSet>
 
 #include <memory>
 
 #define ANCHOR_MAGIC_MARKER "e520c60e-cf5d-4a30-b1a7-588d2c569851"
 #define MULTISPLITTER_LAYOUT_MAGIC_MARKER "bac9948e-5f1b-4271-acc5-07f1708e2611"
 
+// Prefix of layouts saved with SerializationFormat_Binary. Never valid JSON, so we can auto-detect the format.
+#define LAYOUT_BINARY_MAGIC_MARKER "KDDWbin"
+
+// Prefixes of SerializationFormat_CompressedBinary layouts and of LayoutSaver::serializeLayoutDelta() results
+#define LAYOUT_COMPRESSED_MAGIC_MARKER "KDDWzip"
+#define LAYOUT_DELTA_MAGIC_MARKER "KDDWdelta"
+
 /**
   * Bump whenever the format changes, so we can still load old layouts.
   * version 1: Initial version
   * version 2: Introduced MainWindow::screenSize and FloatingWindow::screenSize
+  * version 3: LastPosition placeholders are written to JSON as one array per field, instead of one object each
   */
-#define KDDOCKWIDGETS_SERIALIZATION_VERSION 2
+#define KDDOCKWIDGETS_SERIALIZATION_VERSION 3
 
 
 namespace KDDockWidgets {
 
-template <typename T>
-typename T::List fromVariantList(const QVariantList &listV)
+class JsonStreamReader;
+class JsonStreamWriter;
+
+/**
+ * @brief Accumulates a 64-bit FNV-1a hash of the values added to it.
+ *
+ * Used for LayoutSaver::Layout::structuralHash(). Unlike qHash() the result doesn't depend on the
+ * process, so it can be compared against hashes computed in earlier runs.
+ */
+class LayoutHasher
 {
-    typename T::List result;
+public:
+    void addInt(qint64 value)
+    {
+        for (int i = 0; i < 8; ++i)
+            addByte(uchar(quint64(value) >> (8 * i)));
+    }
 
-    result.reserve(listV.size());
-    for (const QVariant &v : listV) {
-        T t;
-        t.fromVariantMap(v.toMap());
-        result.push_back(t);
+    void addBool(bool value) { addByte(value ? 1 : 0); }
+
+    void addDouble(double value)
+    {
+        // Rounded, so the same layout doesn't hash differently due to floating point noise
+        addInt(qRound64(value * 1e6));
     }
 
-    return result;
-}
+    void addString(const QString &str)
+    {
+        addInt(str.size());
+        for (const QChar c : str) {
+            addByte(uchar(c.unicode()));
+            addByte(uchar(c.unicode() >> 8));
+        }
+    }
+
+    void addSize(QSize sz)
+    {
+        addInt(sz.width());
+        addInt(sz.height());
+    }
+
+    void addRect(QRect r)
+    {
+        addInt(r.x());
+        addInt(r.y());
+        addSize(r.size());
+    }
+
+    quint64 result() const { return m_hash; }
+
+private:
+    void addByte(uchar b)
+    {
+        m_hash = (m_hash ^ b) * Q_UINT64_C(1099511628211);
+    }
+
+    quint64 m_hash = Q_UINT64_C(14695981039346656037);
+};
 
 template <typename T>
-QVariantList toVariantList(const typename T::List &list)
+void writeBinaryList(QDataStream &ds, const typename T::List &list)
 {
-    QVariantList result;
-    result.reserve(list.size());
+    ds << qint32(list.size());
     for (const T &v : list)
-        result.push_back(v.toVariantMap());
+        v.writeBinary(ds);
+}
+
+template <typename T>
+typename T::List readBinaryList(QDataStream &ds)
+{
+    typename T::List result;
+    qint32 count = 0;
+    ds >> count;
+
+    // Don't reserve(count), a corrupt stream could make us allocate a lot
+    for (qint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        T t;
+        t.readBinary(ds);
+        result.push_back(t);
+    }
 
     return result;
 }
@@ -76,8 +143,10 @@ struct LayoutSaver::Placeholder
 {
     typedef QVector<LayoutSaver::Placeholder> List;
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    ///@brief reads the format used before serialization version 3, now LastPosition writes placeholders in columns
+    void readJson(JsonStreamReader &);
 
     bool isFloatingWindow;
     int indexOfFloatingWindow;
@@ -92,6 +161,13 @@ struct LayoutSaver::ScalingInfo
     ScalingInfo() = default;
     explicit ScalingInfo(const QString &mainWindowId, QRect savedMainWindowGeo);
 
+    /**
+     * @brief Scales top-levels relative to a screen whose geometry changed since the layout was saved.
+     * Both geometries are in device independent pixels, so a devicePixelRatio change alone doesn't scale anything,
+     * while a change of logical resolution, as when swapping a 4K monitor for a 1080p one, does.
+     */
+    explicit ScalingInfo(QRect savedScreenGeo, QRect currentScreenGeo);
+
     bool isValid() const {
         return heightFactor > 0 && widthFactor > 0 && !((qFuzzyCompare(widthFactor, 1) && qFuzzyCompare(heightFactor, 1)));
     }
@@ -101,11 +177,18 @@ struct LayoutSaver::ScalingInfo
     void applyFactorsTo(QSize &) const;
     void applyFactorsTo(QRect &) const;
 
+    ///@brief Like applyFactorsTo(), but for the geometry of a top-level, which also moves to the current screen
+    void applyFactorsToTopLevel(QRect &) const;
+
     QString mainWindowName;
     QRect savedMainWindowGeometry;
     QRect realMainWindowGeometry;
     double heightFactor = -1;
     double widthFactor = -1;
+
+    // Only set when scaling relative to a screen
+    QPoint savedScreenOrigin;
+    QPoint currentScreenOrigin;
 };
 
 struct LayoutSaver::LastPosition
@@ -118,8 +201,10 @@ struct LayoutSaver::LastPosition
     /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
     void scaleSizes(const ScalingInfo &scalingInfo);
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
 };
 
 struct DOCKS_EXPORT LayoutSaver::DockWidget
@@ -147,8 +232,9 @@ struct DOCKS_EXPORT LayoutSaver::DockWidget
         return dw;
     }
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
 
     QString uniqueName;
     QString affinityName;
@@ -158,27 +244,6 @@ private:
     DockWidget() {}
 };
 
-
-inline QVariantList toVariantList(const LayoutSaver::DockWidget::List &list)
-{
-    QVariantList result;
-    result.reserve(list.size());
-    for (const auto &dw : list)
-        result.push_back(dw->toVariantMap());
-
-    return result;
-}
-
-inline QVariantList dockWidgetNames(const LayoutSaver::DockWidget::List &list)
-{
-    QVariantList result;
-    result.reserve(list.size());
-    for (auto &dw : list)
-        result.push_back(dw->uniqueName);
-
-    return result;
-}
-
 struct LayoutSaver::Frame
 {
     bool isValid() const;
@@ -186,8 +251,11 @@ struct LayoutSaver::Frame
     /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
     void scaleSizes(const ScalingInfo &scalingInfo);
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
+    void addToHash(LayoutHasher &, bool includeGeometry) const;
 
     bool isNull = true;
     QString objectName;
@@ -206,8 +274,11 @@ struct LayoutSaver::Item
     /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
     void scaleSizes(const ScalingInfo &scalingInfo);
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
+    void addToHash(LayoutHasher &, bool includeGeometry) const;
 
     QString objectName;
     bool isPlaceholder;
@@ -226,9 +297,12 @@ struct LayoutSaver::Anchor
 
     bool isValid(const LayoutSaver::MultiSplitterLayout &layout) const;
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
     void scaleSizes(const ScalingInfo &);
+    void addToHash(LayoutHasher &, bool includeGeometry) const;
 
     bool isVertical() const;
 
@@ -247,11 +321,17 @@ struct LayoutSaver::Anchor
 struct LayoutSaver::MultiSplitterLayout
 {
     bool isValid() const;
+
+    ///@brief See Layout::hasValidReferences(). Adds the names of the docked dock widgets to @p dockNames
+    bool hasValidReferences(QSet<QString> &dockNames) const;
     /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
     void scaleSizes(const ScalingInfo &scalingInfo);
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
+    void addToHash(LayoutHasher &, bool includeGeometry) const;
 
     LayoutSaver::Anchor::List anchors;
     LayoutSaver::Item::List items;
@@ -268,8 +348,11 @@ struct LayoutSaver::FloatingWindow
     /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
     void scaleSizes(const ScalingInfo &);
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
+    void addToHash(LayoutHasher &, bool includeGeometry) const;
 
     LayoutSaver::MultiSplitterLayout multiSplitterLayout;
     QString affinityName;
@@ -278,6 +361,9 @@ struct LayoutSaver::FloatingWindow
     int screenIndex;
     QSize screenSize;  // for relative-size restoring
     bool isVisible = true;
+
+    // The affinity isn't being restored, so only affinityName was parsed. See Layout::affinityNames
+    bool skippedByAffinity = false;
 };
 
 struct LayoutSaver::MainWindow
@@ -287,11 +373,18 @@ public:
 
     bool isValid() const;
 
-    /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
+    ///@brief Computes scalingInfo, which needs the real main window, so only from the GUI thread
+    void initScalingInfo();
+
+    /// Iterates throught the layout and patches all absolute sizes, according to scalingInfo.
+    /// Only touches this struct, so it can run on a worker thread. See RestoreOption_RelativeToMainWindow.
     void scaleSizes();
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
+    void addToHash(LayoutHasher &, bool includeGeometry) const;
 
     KDDockWidgets::MainWindowOptions options;
     LayoutSaver::MultiSplitterLayout multiSplitterLayout;
@@ -302,17 +395,25 @@ public:
     QSize screenSize;  // for relative-size restoring
     bool isVisible;
 
+    // The affinity isn't being restored, so only affinityName was parsed. See Layout::affinityNames
+    bool skippedByAffinity = false;
+
     ScalingInfo scalingInfo;
 };
 
-///@brief we serialize some info about screens, so eventually we can make restore smarter when switching screens
-///Not used currently, but nice to have in the json already
+///@brief we serialize some info about screens, so restore can be smarter when switching screens
+///With RestoreOption_RelativeToMainWindow, floating windows without a parent main window are scaled to their screen's new geometry
 struct LayoutSaver::ScreenInfo
 {
     typedef QVector<LayoutSaver::ScreenInfo> List;
 
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
+
+    ///@brief returns the info about the screens we have now
+    static List currentScreens();
 
     int index;
     QRect geometry;
@@ -324,35 +425,99 @@ struct LayoutSaver::Layout
 {
 public:
 
-    Layout() {
+    Layout()
+        : screenInfo(ScreenInfo::currentScreens())
+        , currentScreenInfo(screenInfo)
+    {
         s_currentLayoutBeingRestored = this;
-
-        const QList<QScreen*> screens = qApp->screens();
-        for (int i = 0; i < screens.size(); ++i) {
-            ScreenInfo info;
-            info.index = i;
-            info.geometry = screens[i]->geometry();
-            info.name = screens[i]->name();
-            info.devicePixelRatio = screens[i]->devicePixelRatio();
-            screenInfo.push_back(info);
-        }
     }
 
     ~Layout() {
-        s_currentLayoutBeingRestored = nullptr;
+        if (s_currentLayoutBeingRestored == this)
+            s_currentLayoutBeingRestored = nullptr;
     }
 
     bool isValid() const;
 
+    /**
+     * @brief Returns whether every index and name that restoring follows is consistent.
+     *
+     * That's the anchor and item indexes, the static anchors, the current tabs, dock widgets
+     * only being docked once, and the placeholders' floating window indexes and main window names. Unlike isValid() geometry isn't looked at.
+     * It's cheap, restoreLayout() rejects layouts failing it before tearing down the current one.
+     * Dock widgets which don't exist are fine, they're skipped or created by the factory.
+     */
+    bool hasValidReferences() const;
+
     bool fillFrom(const QByteArray &serialized);
     QByteArray toJson() const;
     bool fromJson(const QByteArray &jsonData);
-    QVariantMap toVariantMap() const;
-    void fromVariantMap(const QVariantMap &map);
+    QByteArray toBinary() const;
+    bool fromBinary(const QByteArray &data);
+
+    ///@brief returns whether @p data was produced by toBinary(), as opposed to toJson()
+    static bool isBinary(const QByteArray &data);
+
+    ///@brief returns whether @p data is in the SerializationFormat_CompressedBinary format
+    static bool isCompressed(const QByteArray &data);
+
+    ///@brief returns whether @p data was produced by LayoutSaver::serializeLayoutDelta()
+    static bool isDelta(const QByteArray &data);
+
+    ///@brief returns this layout in the specified format
+    QByteArray serialize(SerializationFormat format) const;
+
+    ///@brief parses @p data, detecting its format. Deltas aren't supported, see LayoutSaver::resolveLayoutDelta()
+    bool fromSerialized(const QByteArray &data);
+
+    ///@brief The output of toBinary(), split into one section per top-level. See LayoutHistory.
+    struct BinarySections
+    {
+        QByteArray dockWidgets; // The version, and all dock widgets and the closed ones
+        QVector<QByteArray> mainWindows;
+        QVector<QByteArray> floatingWindows;
+        QByteArray screenInfo;
+
+        ///@brief returns the same as toBinary()
+        QByteArray join() const;
+
+        ///@brief returns these sections, omitting those which are the same as in @p base. See resolve().
+        QByteArray deltaAgainst(const BinarySections &base) const;
+
+        ///@brief the opposite of deltaAgainst(). Returns false if @p delta wasn't computed against @p base.
+        bool resolve(const BinarySections &base, const QByteArray &delta);
+    };
+
+    BinarySections toBinarySections() const;
+
+    ///@brief Replaces the DockWidget instances shared with LayoutSaver with private copies,
+    /// so this layout can be serialized from another thread. See AsyncLayoutSaver.
+    void detachDockWidgets();
+    void writeJson(JsonStreamWriter &) const;
+    void writeBinary(QDataStream &) const;
+    void readBinary(QDataStream &);
+    void readJson(JsonStreamReader &);
 
     /// Iterates throught the layout and patches all absolute sizes. See RestoreOption_RelativeToMainWindow.
     void scaleSizes();
 
+    /**
+     * @brief returns a hash of the windows, their anchors, items, frames and dock widget names
+     *
+     * Two layouts with the same hash have the same structure, so they can be compared without
+     * serializing them. Sizes and positions are only covered if @p includeGeometry is true.
+     * The hash is stable across runs, but not across serialization versions.
+     */
+    quint64 structuralHash(bool includeGeometry = false) const;
+
+    ///@brief returns whether windows with @p affinityName are parsed, see affinityNames
+    bool matchesAffinity(const QString &affinityName) const {
+        return affinityNames.isEmpty() || affinityName.isEmpty() || affinityNames.contains(affinityName);
+    }
+
+    ///@brief returns how to scale top-levels which were on screen @p screenIndex, invalid if the screen didn't change
+    ScalingInfo screenScalingInfo(int screenIndex) const;
+
     friend QDataStream &operator>>(QDataStream &ds, LayoutSaver::Frame *frame);
     static LayoutSaver::Layout* s_currentLayoutBeingRestored;
 
@@ -364,6 +529,13 @@ public:
     LayoutSaver::DockWidget::List closedDockWidgets;
     LayoutSaver::DockWidget::List allDockWidgets;
     ScreenInfo::List screenInfo;
+
+    // When restoring a subset of the affinities, the windows of the other ones aren't parsed. They're kept in
+    // the lists, with skippedByAffinity set, so indexes into them remain valid. Empty means all affinities.
+    QStringList affinityNames;
+
+    // The screens we have now, queried once per Layout. screenInfo is replaced by the saved ones when restoring.
+    const ScreenInfo::List currentScreenInfo;
 };
 
 inline QDataStream &operator>>(QDataStream &ds, LayoutSaver::ScreenInfo *info)
@@ -0,0 +1,110 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief An immutable copy of the dock widgets' geometry and state, readable from any thread.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "LayoutSnapshot.h"
+#include "DockWidgetBase.h"
+#include "private/DockRegistry_p.h"
+
+#include <algorithm>
+
+using namespace KDDockWidgets;
+
+// Only accessed through std::atomic_load() and std::atomic_store(), as it's read from other threads
+static std::shared_ptr<const LayoutSnapshot> s_currentSnapshot;
+
+// These are only used in the GUI thread
+static bool s_publishingEnabled = false;
+static quint64 s_numPublished = 0;
+
+const LayoutSnapshot::DockWidget *LayoutSnapshot::dockWidget(const QString &uniqueName) const
+{
+    auto it = std::lower_bound(m_dockWidgets.cbegin(), m_dockWidgets.cend(), uniqueName,
+                               [] (const DockWidget &dw, const QString &name) {
+        return dw.uniqueName < name;
+    });
+
+    if (it == m_dockWidgets.cend() || it->uniqueName != uniqueName)
+        return nullptr;
+
+    return &(*it);
+}
+
+LayoutSnapshot::Ptr LayoutSnapshot::current()
+{
+    return std::atomic_load(&s_currentSnapshot);
+}
+
+void LayoutSnapshot::setPublishingEnabled(bool enabled)
+{
+    if (enabled == s_publishingEnabled)
+        return;
+
+    s_publishingEnabled = enabled;
+    DockRegistry::self()->updateObservingLayoutChanges();
+    if (enabled)
+        publish(DockRegistry::self()->dockwidgets());
+}
+
+bool LayoutSnapshot::isPublishingEnabled()
+{
+    return s_publishingEnabled;
+}
+
+LayoutSnapshot::Ptr LayoutSnapshot::capture()
+{
+    return capture(0, DockRegistry::self()->dockwidgets());
+}
+
+LayoutSnapshot::Ptr LayoutSnapshot::capture(quint64 version, const QVector<DockWidgetBase *> &dockWidgets)
+{
+    auto snapshot = new LayoutSnapshot();
+    snapshot->m_version = version;
+    snapshot->m_dockWidgets.reserve(dockWidgets.size());
+
+    for (DockWidgetBase *dw : dockWidgets) {
+        DockWidget entry;
+        entry.uniqueName = dw->uniqueName();
+        entry.frameId = quintptr(dw->frame());
+        entry.isVisible = dw->isVisible();
+        entry.isFloating = dw->isFloating();
+        if (entry.isVisible)
+            entry.globalGeometry = QRect(dw->mapToGlobal(QPoint(0, 0)), dw->size());
+        snapshot->m_dockWidgets.push_back(entry);
+    }
+
+    std::sort(snapshot->m_dockWidgets.begin(), snapshot->m_dockWidgets.end(), [] (const DockWidget &a, const DockWidget &b) {
+        return a.uniqueName < b.uniqueName;
+    });
+
+    return Ptr(snapshot);
+}
+
+void LayoutSnapshot::publish(const QVector<DockWidgetBase *> &dockWidgets)
+{
+    // Other threads only see it once it's complete
+    std::atomic_store(&s_currentSnapshot, capture(++s_numPublished, dockWidgets));
+}
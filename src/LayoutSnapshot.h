@@ -0,0 +1,109 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief An immutable copy of the dock widgets' geometry and state, readable from any thread.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_LAYOUTSNAPSHOT_H
+#define KD_DOCKWIDGETS_LAYOUTSNAPSHOT_H
+
+#include "docks_export.h"
+
+#include <QString>
+#include <QRect>
+#include <QVector>
+
+#include <memory>
+
+namespace KDDockWidgets
+{
+
+class DockWidgetBase;
+
+/**
+ * @brief An immutable, versioned copy of where each dock widget is and whether it's visible.
+ *
+ * Querying DockWidgetBase or the layouts is only allowed in the GUI thread. Threads that only
+ * need to know the geometry, like UI test automation or telemetry, can read current() instead.
+ *
+ * While publishing is enabled, a new snapshot is published after each event loop iteration in which
+ * the layout changed or a window moved, see DockRegistry::layoutChanged(). Snapshots are never
+ * modified after being published, so a reader can keep using one while newer ones are published.
+ */
+class DOCKS_EXPORT LayoutSnapshot
+{
+public:
+    typedef std::shared_ptr<const LayoutSnapshot> Ptr;
+
+    struct DockWidget
+    {
+        QString uniqueName;
+        quintptr frameId = 0; ///< Identifies the frame, shared by dock widgets tabbed together. 0 if not in a frame
+        QRect globalGeometry; ///< In screen coordinates. Only meaningful if visible
+        bool isVisible = false; ///< Tabs which aren't current aren't visible
+        bool isFloating = false;
+    };
+
+    ///@brief Returns the number of snapshots published before this one, plus one. 0 if it was only captured
+    quint64 version() const { return m_version; }
+
+    ///@brief Returns all dock widgets, sorted by uniqueName
+    const QVector<DockWidget> &dockWidgets() const { return m_dockWidgets; }
+
+    ///@brief Returns the dock widget named @p uniqueName, nullptr if there's none
+    const DockWidget *dockWidget(const QString &uniqueName) const;
+
+    /**
+     * @brief Returns the last published snapshot. Can be called from any thread.
+     * Returns nullptr if publishing was never enabled.
+     */
+    static Ptr current();
+
+    /**
+     * @brief Enables or disables publishing. Disabled by default, as each snapshot costs a pass over all dock widgets.
+     * Enabling publishes a snapshot right away. Must be called from the GUI thread.
+     */
+    static void setPublishingEnabled(bool);
+
+    ///@brief Returns whether snapshots are being published
+    static bool isPublishingEnabled();
+
+    ///@brief Returns a snapshot of the current state, without publishing it. Must be called from the GUI thread.
+    static Ptr capture();
+
+private:
+    friend class DockRegistry;
+    LayoutSnapshot() = default;
+
+    ///@brief Captures and publishes a snapshot of @p dockWidgets. Called by DockRegistry after the layout changed
+    static void publish(const QVector<DockWidgetBase *> &dockWidgets);
+    static Ptr capture(quint64 version, const QVector<DockWidgetBase *> &dockWidgets);
+
+    quint64 m_version = 0;
+    QVector<DockWidget> m_dockWidgets;
+};
+
+}
+
+#endif
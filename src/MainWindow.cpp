@@ -29,13 +29,19 @@
 #include "DropArea_p.h"
 #include "Frame_p.h"
 #include "Logging_p.h"
+#include "Config.h"
+#include "DockWidgetBase.h"
+#include "DockRegistry_p.h"
 #include "DropAreaWithCentralFrame_p.h"
 #include "multisplitter/MultiSplitterLayout_p.h"
 #include "multisplitter/MultiSplitter_p.h"
 
 #include <QApplication>
 #include <QVBoxLayout>
+#include <QHBoxLayout>
 #include <QPainter>
+#include <QTimer>
+#include <QToolButton>
 
 using namespace KDDockWidgets;
 
@@ -48,6 +54,7 @@ public:
     }
 
     DropAreaWithCentralFrame *const m_dropArea;
+    bool m_warmedUp = false;
 };
 
 
@@ -74,6 +81,61 @@ public:
 
 MyCentralWidget::~MyCentralWidget() {}
 
+namespace KDDockWidgets {
+///@brief The column of buttons on the left edge listing the dock widgets minimized with moveToSideBar()
+class SideBar : public QWidget
+{
+public:
+    explicit SideBar(MainWindowBase *mainWindow)
+        : QWidget(mainWindow)
+        , m_mainWindow(mainWindow)
+        , m_layout(new QVBoxLayout(this))
+    {
+        setObjectName(QStringLiteral("SideBar"));
+        m_layout->setContentsMargins(0, 0, 0, 0);
+        m_layout->setSpacing(1);
+        m_layout->addStretch();
+        connect(mainWindow, &MainWindowBase::sideBarChanged, this, &SideBar::updateButtons);
+        setVisible(false);
+    }
+
+    ~SideBar() override;
+
+    void updateButtons()
+    {
+        // Remove all but the trailing stretch. deleteLater() as we might be inside a button's clicked()
+        while (m_layout->count() > 1) {
+            QLayoutItem *item = m_layout->takeAt(0);
+            item->widget()->hide();
+            item->widget()->deleteLater();
+            delete item;
+        }
+
+        const QVector<DockWidgetBase*> dockWidgets = m_mainWindow->sideBarDockWidgets();
+        int index = 0;
+        for (DockWidgetBase *dw : dockWidgets) {
+            auto button = new QToolButton(this);
+            button->setText(dw->title());
+            button->setIcon(dw->icon());
+            button->setToolButtonStyle(Qt::ToolButtonTextBesideIcon);
+            button->setAutoRaise(true);
+            connect(button, &QToolButton::clicked, this, [this, dw] {
+                m_mainWindow->restoreFromSideBar(dw);
+            });
+            m_layout->insertWidget(index++, button);
+        }
+
+        setVisible(!dockWidgets.isEmpty());
+    }
+
+private:
+    MainWindowBase *const m_mainWindow;
+    QVBoxLayout *const m_layout;
+};
+}
+
+SideBar::~SideBar() {}
+
 
 MainWindow::MainWindow(const QString &name, MainWindowOptions options,
                        QWidget *parent, Qt::WindowFlags flags)
@@ -81,8 +143,9 @@ MainWindow::MainWindow(const QString &name, MainWindowOptions options,
     , d(new Private(options, this))
 {
     auto centralWidget = new MyCentralWidget(this);
-    auto layout = new QVBoxLayout(centralWidget);
+    auto layout = new QHBoxLayout(centralWidget);
     layout->setContentsMargins(1, 5, 1, 1);
+    layout->addWidget(new SideBar(this));
     layout->addWidget(dropArea()); // 1 level of indirection so we can add some margins
     setCentralWidget(centralWidget);
 
@@ -98,3 +161,21 @@ DropAreaWithCentralFrame *MainWindow::dropArea() const
 {
     return d->m_dropArea;
 }
+
+void MainWindow::showEvent(QShowEvent *ev)
+{
+    MainWindowBase::showEvent(ev);
+
+    if (d->m_warmedUp || !(Config::self().flags() & Config::Flag_WarmUpWindows))
+        return;
+
+    d->m_warmedUp = true;
+
+    // Create the native windows the first drag would need once the event loop is idle,
+    // instead of while the user is tearing off a tab
+    QTimer::singleShot(0, this, [this] {
+        if (auto overlay = dropArea()->dropIndicatorOverlay())
+            overlay->warmUp();
+        DockRegistry::self()->warmUpFloatingWindow(this);
+    });
+}
@@ -57,6 +57,9 @@ public:
     ///@internal
     DropAreaWithCentralFrame *dropArea() const override;
 
+protected:
+    void showEvent(QShowEvent *) override;
+
 private:
     class Private;
     Private *const d;
@@ -33,6 +33,7 @@
 #include "Utils_p.h"
 #include "Logging_p.h"
 #include "DropAreaWithCentralFrame_p.h"
+#include "DockWidgetBase.h"
 #include "multisplitter/MultiSplitterLayout_p.h"
 #include "multisplitter/MultiSplitter_p.h"
 
@@ -53,9 +54,23 @@ public:
 
     QString name;
     QString affinityName;
+    int affinityId = 0; // See DockRegistry::affinityId()
     const MainWindowOptions m_options;
+    QVector<DockWidgetBase*> m_sideBarDockWidgets;
 };
 
+MainWindowBase::LayoutTransaction::LayoutTransaction(MainWindowBase *mainWindow)
+    : m_layout(mainWindow->multiSplitterLayout())
+{
+    m_layout->beginTransaction();
+}
+
+MainWindowBase::LayoutTransaction::~LayoutTransaction()
+{
+    if (m_layout)
+        m_layout->endTransaction();
+}
+
 MainWindowBase::MainWindowBase(const QString &uniqueName, KDDockWidgets::MainWindowOptions options,
                                QWidgetOrQuick *parent, Qt::WindowFlags flags)
     : QMainWindowOrQuick(parent, flags)
@@ -70,12 +85,26 @@ MainWindowBase::~MainWindowBase()
     delete d;
 }
 
+void MainWindowBase::addDockWidgetsAsTab(const QVector<DockWidgetBase *> &dockwidgets)
+{
+    if (!d->supportsCentralFrame()) {
+        qWarning() << Q_FUNC_INFO << "Not supported without MainWindowOption_HasCentralFrame";
+        return;
+    }
+
+    Frame *centralFrame = dropArea()->m_centralFrame;
+    centralFrame->beginBatchInsert();
+    for (DockWidgetBase *dw : dockwidgets)
+        addDockWidgetAsTab(dw);
+    centralFrame->endBatchInsert();
+}
+
 void MainWindowBase::addDockWidgetAsTab(DockWidgetBase *widget)
 {
     Q_ASSERT(widget);
     qCDebug(addwidget) << Q_FUNC_INFO << widget;
 
-    if (widget->affinityName() != affinityName()) {
+    if (widget->affinityId() != affinityId()) {
         qWarning() << Q_FUNC_INFO << "Refusing to dock widget with incompatible affinity."
                    << widget->affinityName() << affinityName();
         return;
@@ -131,6 +160,7 @@ void MainWindowBase::setAffinityName(const QString &name)
     }
 
     d->affinityName = name;
+    d->affinityId = DockRegistry::self()->affinityId(name);
 }
 
 QString MainWindowBase::affinityName() const
@@ -138,6 +168,85 @@ QString MainWindowBase::affinityName() const
     return d->affinityName;
 }
 
+int MainWindowBase::affinityId() const
+{
+    return d->affinityId;
+}
+
+bool MainWindowBase::resizeDockWidget(DockWidgetBase *dw, QSize size)
+{
+    Frame *frame = dw ? dw->frame() : nullptr;
+    MultiSplitterLayout *layout = multiSplitterLayout();
+    if (!frame || !layout->itemForFrame(frame)) {
+        qWarning() << Q_FUNC_INFO << "Dock widget isn't docked in this main window" << dw;
+        return false;
+    }
+
+    // The frame has margins and maybe a tab bar, resize it by the same amount as the dock widget
+    const QSize decorations = frame->size() - dw->size();
+    bool ok = true;
+    if (size.width() > 0)
+        ok = layout->resizeItem(frame, size.width() + decorations.width(), Qt::Vertical) && ok;
+    if (size.height() > 0)
+        ok = layout->resizeItem(frame, size.height() + decorations.height(), Qt::Horizontal) && ok;
+
+    return ok;
+}
+
+bool MainWindowBase::moveToSideBar(DockWidgetBase *dw)
+{
+    Frame *frame = dw ? dw->frame() : nullptr;
+    if (!frame || !multiSplitterLayout()->itemForFrame(frame)) {
+        qWarning() << Q_FUNC_INFO << "Dock widget isn't docked in this main window" << dw;
+        return false;
+    }
+
+    // A plain close leaves a placeholder behind, which is where restoreFromSideBar() will put it back
+    dw->close();
+    if (dw->isOpen())
+        return false; // The guest refused to close
+
+    if (d->m_sideBarDockWidgets.contains(dw))
+        return true;
+
+    d->m_sideBarDockWidgets.push_back(dw);
+
+    // Shown by some other means, for example its toggle action
+    connect(dw, &DockWidgetBase::shown, this, [this, dw] { removeFromSideBar(dw); });
+    connect(dw, &QObject::destroyed, this, [this, dw] { removeFromSideBar(dw); });
+
+    Q_EMIT sideBarChanged();
+    return true;
+}
+
+bool MainWindowBase::restoreFromSideBar(DockWidgetBase *dw)
+{
+    if (!dw || !d->m_sideBarDockWidgets.contains(dw)) {
+        qWarning() << Q_FUNC_INFO << "Dock widget isn't in the side bar" << dw;
+        return false;
+    }
+
+    removeFromSideBar(dw);
+    dw->show();
+    return true;
+}
+
+QVector<DockWidgetBase*> MainWindowBase::sideBarDockWidgets() const
+{
+    return d->m_sideBarDockWidgets;
+}
+
+void MainWindowBase::removeFromSideBar(DockWidgetBase *dw)
+{
+    if (d->m_sideBarDockWidgets.removeAll(dw) == 0)
+        return;
+
+    // Only the connections made by moveToSideBar()
+    disconnect(dw, &DockWidgetBase::shown, this, nullptr);
+    disconnect(dw, &QObject::destroyed, this, nullptr);
+    Q_EMIT sideBarChanged();
+}
+
 void MainWindowBase::setUniqueName(const QString &uniqueName)
 {
     if (uniqueName.isEmpty())
@@ -165,6 +274,7 @@ bool MainWindowBase::deserialize(const LayoutSaver::MainWindow &mw)
                    << "; to" << mw.affinityName;
 
         d->affinityName = mw.affinityName;
+        d->affinityId = DockRegistry::self()->affinityId(mw.affinityName);
     }
 
     return dropArea()->multiSplitterLayout()->deserialize(mw.multiSplitterLayout);
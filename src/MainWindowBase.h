@@ -35,6 +35,7 @@
 #include "LayoutSaver_p.h"
 
 #include <QVector>
+#include <QPointer>
 
 namespace KDDockWidgets {
 
@@ -56,6 +57,28 @@ class DOCKS_EXPORT MainWindowBase : public QMainWindowOrQuick
     Q_OBJECT
 public:
     typedef QVector<MainWindowBase*> List;
+
+    /**
+     * @brief RAII class to batch several layout changes into a single geometry update.
+     *
+     * While an instance is alive, docking into this main window will still update the layout
+     * structure, but the geometry of the frames isn't touched and min-size propagation is deferred.
+     * When the last instance goes out of scope the layout is solved once and the resulting
+     * geometry is applied to all frames.
+     *
+     * Useful when calling @ref addDockWidget() many times in a row, for example when building
+     * a perspective. Transactions can be nested.
+     */
+    class DOCKS_EXPORT LayoutTransaction
+    {
+    public:
+        explicit LayoutTransaction(MainWindowBase *mainWindow);
+        ~LayoutTransaction();
+    private:
+        Q_DISABLE_COPY(LayoutTransaction)
+        QPointer<MultiSplitterLayout> m_layout;
+    };
+
     explicit MainWindowBase(const QString &uniqueName, MainWindowOptions options = MainWindowOption_HasCentralFrame,
                             QWidgetOrQuick *parent = nullptr, Qt::WindowFlags flags = {});
 
@@ -70,6 +93,16 @@ public:
      */
     void addDockWidgetAsTab(DockWidgetBase *dockwidget);
 
+    /**
+     * @brief Docks many DockWidgets into the central frame, tabbed. For document-style applications.
+     *
+     * Equivalent to calling @ref addDockWidgetAsTab() for each of them, but the central frame's title,
+     * title bar and min-size updates happen once, and only the last dock widget becomes the current tab,
+     * so the others' widgets aren't shown until their tab is clicked.
+     * @warning Requires that the MainWindow was constructed with MainWindowOption_HasCentralFrame option.
+     */
+    void addDockWidgetsAsTab(const QVector<DockWidgetBase *> &dockwidgets);
+
     /**
      * @brief Docks a DockWidget into this main window.
      * @param dockWidget The dock widget to add into this MainWindow
@@ -123,12 +156,65 @@ public:
      */
     QString affinityName() const;
 
+    ///@internal
+    ///@brief Returns the id DockRegistry interned affinityName() as. 0 for the empty affinity.
+    int affinityId() const;
+
+    /**
+     * @brief Resizes a docked dock widget to an exact size, by moving the separators around it.
+     *
+     * Use it to adjust a layout from a script, or to implement keyboard resizing. The needed
+     * separator positions are computed up-front and the layout is updated once, instead of
+     * once per pixel as when dragging a separator with the mouse.
+     *
+     * The separators can't violate the minimum size of the neighbouring dock widgets, in which
+     * case the dock widget only gets as close as possible to @p size.
+     *
+     * @param dockWidget A dock widget docked in this main window. Floating ones aren't supported.
+     * @param size The new size. Pass 0 or a negative value for the width or the height to keep it unchanged.
+     * @return true if the dock widget now has the requested size
+     */
+    bool resizeDockWidget(DockWidgetBase *dockWidget, QSize size);
+
+    /**
+     * @brief Minimizes a docked dock widget into this main window's side bar.
+     *
+     * The dock widget is closed, so its frame leaves the layout and the remaining dock widgets
+     * get its space, but a placeholder remembers where it was. It's then listed in
+     * @ref sideBarDockWidgets(), which the side bar shows as buttons.
+     *
+     * While minimized the dock widget is just a closed dock widget, so if it had a
+     * widget creator and a hibernation timeout its guest widget gets unloaded like any other's.
+     * See DockWidgetBase::setHibernationTimeout().
+     *
+     * @param dockWidget A dock widget docked in this main window
+     * @return false if @p dockWidget isn't docked in this main window
+     * @sa restoreFromSideBar()
+     */
+    bool moveToSideBar(DockWidgetBase *dockWidget);
+
+    /**
+     * @brief Brings a dock widget minimized with @ref moveToSideBar() back into its previous place.
+     *
+     * Showing the dock widget by other means, for example with its toggle action, also removes it
+     * from the side bar.
+     *
+     * @return false if @p dockWidget isn't in the side bar
+     */
+    bool restoreFromSideBar(DockWidgetBase *dockWidget);
+
+    ///@brief Returns the dock widgets minimized into the side bar, in the order they were added.
+    QVector<DockWidgetBase*> sideBarDockWidgets() const;
+
 protected:
     void setUniqueName(const QString &uniqueName);
 
 Q_SIGNALS:
     void uniqueNameChanged();
 
+    ///@brief emitted when a dock widget is added to or removed from the side bar
+    void sideBarChanged();
+
 private:
     class Private;
     Private *const d;
@@ -136,6 +222,7 @@ private:
     friend class LayoutSaver;
     bool deserialize(const LayoutSaver::MainWindow &);
     LayoutSaver::MainWindow serialize() const;
+    void removeFromSideBar(DockWidgetBase *);
 };
 
 }
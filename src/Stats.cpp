@@ -0,0 +1,61 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Counters for the layout engine's hot paths, to diagnose slow resizes.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "Stats.h"
+#include "Stats_p.h"
+
+using namespace KDDockWidgets;
+
+static Stats s_stats;
+
+#ifdef KDDOCKWIDGETS_STATS
+int StatsDepthGuard::s_depth = 0;
+#endif
+
+Stats &KDDockWidgets::mutableStats()
+{
+    return s_stats;
+}
+
+bool Stats::isEnabled()
+{
+#ifdef KDDOCKWIDGETS_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+Stats Stats::snapshot()
+{
+    return s_stats;
+}
+
+void Stats::reset()
+{
+    s_stats = Stats();
+}
@@ -0,0 +1,93 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Counters for the layout engine's hot paths, to diagnose slow resizes.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_STATS_H
+#define KD_DOCKWIDGETS_STATS_H
+
+#include "docks_export.h"
+
+#include <QtGlobal>
+
+namespace KDDockWidgets
+{
+
+/**
+ * @brief A snapshot of how many times the layout engine ran its most expensive operations.
+ *
+ * Counting is only done when KDDockWidgets is built with -DOPTION_STATS=ON, otherwise
+ * it costs nothing and snapshot() always returns zeros. Counters are only incremented from the GUI thread.
+ *
+ * Typical usage is to call reset(), perform the operation that is slow, then inspect snapshot().
+ */
+struct DOCKS_EXPORT Stats
+{
+    ///@brief Number of calls to Anchor::setPosition(), i.e. separators being moved
+    quint64 anchorSetPositionCalls = 0;
+
+    ///@brief Number of calls to Item::setGeometry()
+    quint64 itemSetGeometryCalls = 0;
+
+    ///@brief Number of times a layout item pushed its geometry to its Frame widget
+    quint64 frameGeometryPushes = 0;
+
+    ///@brief Number of times a title bar rendered its background with QStyle, instead of reusing its cached pixmap
+    quint64 titleBarChromeRenders = 0;
+
+    ///@brief Number of calls to MultiSplitterLayout::checkSanity()
+    quint64 checkSanityCalls = 0;
+
+    ///@brief How many paths were enumerated by MultiSplitterLayout::collectPaths(), accumulated
+    quint64 collectedPaths = 0;
+
+    ///@brief The deepest recursion reached by MultiSplitterLayout::redistributeSpace_recursive()
+    int maxRedistributeSpaceDepth = 0;
+
+    ///@brief How long the last MultiSplitterLayout::addWidget() took, in microseconds
+    qint64 lastAddWidgetUSecs = 0;
+
+    ///@brief How long the last LayoutSaver::restoreLayout() took, in microseconds
+    qint64 lastRestoreUSecs = 0;
+
+    ///@brief How long the last MultiSplitterLayout::setSize() took, in microseconds. i.e. a window resize
+    qint64 lastResizeUSecs = 0;
+
+    ///@brief How long handling the last mouse move of a drag took, hovering included, in microseconds
+    qint64 lastDragHoverUSecs = 0;
+
+    ///@brief Returns whether the library was built with OPTION_STATS, i.e. whether counting is done at all
+    static bool isEnabled();
+
+    ///@brief Returns a copy of the current counters
+    static Stats snapshot();
+
+    ///@brief Sets all counters back to 0
+    static void reset();
+};
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Records where time is spent, in Chrome's trace-event format.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "Tracing.h"
+#include "Tracing_p.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVector>
+
+using namespace KDDockWidgets;
+
+#ifdef KDDOCKWIDGETS_TRACING
+
+namespace {
+
+struct TraceEvent
+{
+    const char *name;
+    qint64 timestampNs;
+    qint64 durationNs; // -1 for instant events
+};
+
+struct Recorder
+{
+    bool recording = false;
+    QElapsedTimer timer;
+    QVector<TraceEvent> events;
+};
+
+}
+
+Q_DECLARE_TYPEINFO(TraceEvent, Q_PRIMITIVE_TYPE);
+
+static Recorder &recorder()
+{
+    static Recorder r;
+    return r;
+}
+
+TraceSpan::TraceSpan(const char *name)
+    : m_name(name)
+    , m_start(recorder().recording ? recorder().timer.nsecsElapsed() : -1)
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+    Recorder &r = recorder();
+    if (m_start == -1 || !r.recording)
+        return;
+
+    r.events.push_back({ m_name, m_start, r.timer.nsecsElapsed() - m_start });
+}
+
+void KDDockWidgets::traceInstant(const char *name)
+{
+    Recorder &r = recorder();
+    if (r.recording)
+        r.events.push_back({ name, r.timer.nsecsElapsed(), -1 });
+}
+
+static void writeTraceFromEnvironment()
+{
+    Tracing::stop(QString::fromLocal8Bit(qgetenv("KDDOCKWIDGETS_TRACE_FILE")));
+}
+
+static void startTracingFromEnvironment()
+{
+    if (qEnvironmentVariableIsEmpty("KDDOCKWIDGETS_TRACE_FILE"))
+        return;
+
+    Tracing::start();
+    qAddPostRoutine(writeTraceFromEnvironment);
+}
+Q_COREAPP_STARTUP_FUNCTION(startTracingFromEnvironment)
+
+#endif
+
+bool Tracing::isEnabled()
+{
+#ifdef KDDOCKWIDGETS_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Tracing::start()
+{
+#ifdef KDDOCKWIDGETS_TRACING
+    Recorder &r = recorder();
+    r.events.clear();
+    r.timer.start();
+    r.recording = true;
+#else
+    qWarning() << Q_FUNC_INFO << "KDDockWidgets was built without OPTION_TRACING";
+#endif
+}
+
+bool Tracing::isRecording()
+{
+#ifdef KDDOCKWIDGETS_TRACING
+    return recorder().recording;
+#else
+    return false;
+#endif
+}
+
+bool Tracing::stop(const QString &filename)
+{
+#ifdef KDDOCKWIDGETS_TRACING
+    Recorder &r = recorder();
+    if (!r.recording)
+        return false;
+
+    r.recording = false;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << filename << file.errorString();
+        return false;
+    }
+
+    // Timestamps are in microseconds. Written by hand as this can have a lot of events.
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (int i = 0; i < r.events.size(); ++i) {
+        const TraceEvent &ev = r.events.at(i);
+        if (i > 0)
+            json += ',';
+
+        json += "\n{\"name\":\"";
+        json += ev.name;
+        json += "\",\"cat\":\"kddockwidgets\",\"pid\":";
+        json += pid;
+        json += ",\"tid\":1,\"ts\":";
+        json += QByteArray::number(double(ev.timestampNs) / 1000.0, 'f', 3);
+        if (ev.durationNs == -1) {
+            json += ",\"ph\":\"i\",\"s\":\"p\"}";
+        } else {
+            json += ",\"ph\":\"X\",\"dur\":";
+            json += QByteArray::number(double(ev.durationNs) / 1000.0, 'f', 3);
+            json += '}';
+        }
+    }
+    json += "\n]}\n";
+
+    r.events.clear();
+    return file.write(json) == json.size();
+#else
+    Q_UNUSED(filename);
+    return false;
+#endif
+}
@@ -0,0 +1,69 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Records where time is spent, in Chrome's trace-event format, loadable in Perfetto or chrome://tracing.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_TRACING_H
+#define KD_DOCKWIDGETS_TRACING_H
+
+#include "docks_export.h"
+
+#include <QString>
+
+namespace KDDockWidgets
+{
+
+/**
+ * @brief Records begin/end spans around expensive operations, such as adding widgets, restoring
+ * layouts and dropping, and writes them as Chrome trace-event JSON.
+ *
+ * Only available when KDDockWidgets is built with -DOPTION_TRACING=ON, otherwise the spans cost
+ * nothing and nothing is recorded.
+ *
+ * Alternatively to calling start() and stop(), set the KDDOCKWIDGETS_TRACE_FILE environment variable
+ * to a file name: recording then starts with the application and the trace is written at exit.
+ */
+class DOCKS_EXPORT Tracing
+{
+public:
+    ///@brief Returns whether the library was built with OPTION_TRACING
+    static bool isEnabled();
+
+    ///@brief Discards anything recorded so far and starts recording
+    static void start();
+
+    ///@brief Returns whether we're recording, i.e. start() was called but stop() wasn't
+    static bool isRecording();
+
+    /**
+     * @brief Stops recording and writes the trace to @p filename
+     * @return false if recording wasn't started or the file couldn't be written
+     */
+    static bool stop(const QString &filename);
+};
+
+}
+
+#endif
@@ -0,0 +1 @@
+#include "../../AsyncLayoutRestorer.h"
@@ -0,0 +1 @@
+#include "../../AsyncLayoutSaver.h"
@@ -0,0 +1 @@
+#include "../../EventLog.h"
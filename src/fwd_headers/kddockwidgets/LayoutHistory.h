@@ -0,0 +1 @@
+#include "../../LayoutHistory.h"
@@ -0,0 +1 @@
+#include "../../Stats.h"
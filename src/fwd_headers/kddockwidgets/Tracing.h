@@ -0,0 +1 @@
+#include "../../Tracing.h"
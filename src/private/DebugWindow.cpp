@@ -27,17 +27,20 @@
 
 #include "DebugWindow_p.h"
 #include "ObjectViewer_p.h"
+#include "PerformancePanel_p.h"
 #include "DockRegistry_p.h"
 #include "FloatingWindow_p.h"
 #include "DropArea_p.h"
 #include "MainWindow.h"
 #include "LayoutSaver.h"
+#include "EventLog.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QPushButton>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QTabWidget>
 #include <QMessageBox>
 #include <QApplication>
 #include <QMouseEvent>
@@ -86,7 +89,15 @@ DebugWindow::DebugWindow(QWidget *parent)
     , m_objectViewer(this)
 {
     // qApp->installNativeEventFilter(new DebugAppEventFilter());
-    auto layout = new QVBoxLayout(this);
+    auto tabWidget = new QTabWidget(this);
+    auto topLayout = new QVBoxLayout(this);
+    topLayout->addWidget(tabWidget);
+
+    auto toolsPage = new QWidget(tabWidget);
+    tabWidget->addTab(toolsPage, QStringLiteral("Tools"));
+    tabWidget->addTab(new PerformancePanel(tabWidget), QStringLiteral("Performance"));
+
+    auto layout = new QVBoxLayout(toolsPage);
     layout->addWidget(&m_objectViewer);
 
     auto button = new QPushButton(this);
@@ -166,6 +177,47 @@ DebugWindow::DebugWindow(QWidget *parent)
         qDebug() << message;
     });
 
+    button = new QPushButton(this);
+    button->setText(EventLog::isRecording() ? QStringLiteral("Dump event log") : QStringLiteral("Record event log"));
+    layout->addWidget(button);
+    connect(button, &QPushButton::clicked, this, [button] {
+        if (!EventLog::isRecording()) {
+            EventLog::start();
+            button->setText(QStringLiteral("Dump event log"));
+            return;
+        }
+
+        QString message = EventLog::dump(QStringLiteral("kddockwidgets-events.bin")) ? QStringLiteral("Dumped!")
+                                                                                     : QStringLiteral("Error!");
+        qDebug() << message << EventLog::eventCount() << "events";
+    });
+
+    button = new QPushButton(this);
+    button->setText(QStringLiteral("Dump memory report"));
+    layout->addWidget(button);
+    connect(button, &QPushButton::clicked, this, [] {
+        const DockRegistry::MemoryReport report = DockRegistry::self()->memoryReport();
+        auto dumpEntry = [] (const char *name, const DockRegistry::MemoryReport::Entry &entry) {
+            qDebug().nospace() << "    " << name << ": " << entry.count << " (" << entry.bytes << " bytes)";
+        };
+
+        qDebug() << "Memory report, at least" << report.totalBytes() << "bytes:";
+        dumpEntry("DockWidgets", report.dockWidgets);
+        dumpEntry("Lazy DockWidgets", report.lazyDockWidgets);
+        dumpEntry("Frames", report.frames);
+        dumpEntry("TitleBars", report.titleBars);
+        dumpEntry("TabWidgets", report.tabWidgets);
+        dumpEntry("FloatingWindows", report.floatingWindows);
+        dumpEntry("LastPosition placeholder refs", report.placeholderRefs);
+        qDebug() << "    Guest widgets:" << report.guestWidgets;
+        for (const DockRegistry::MemoryReport::Layout &layout : report.layouts) {
+            qDebug() << "    Layout" << layout.layout << (layout.isInMainWindow ? "(main window)" : "(floating)");
+            dumpEntry("    Items", layout.items);
+            dumpEntry("    Placeholders", layout.placeholders);
+            dumpEntry("    Anchors", layout.anchors);
+        }
+    });
+
     button = new QPushButton(this);
     button->setText(QStringLiteral("Pick Widget"));
     layout->addWidget(button);
@@ -21,15 +21,35 @@
 #include "DockRegistry_p.h"
 #include "DockWidgetBase.h"
 #include "Logging_p.h"
+#include "Tracing_p.h"
 #include "DebugWindow_p.h"
 #include "LastPosition_p.h"
+#include "Config.h"
+#include "LayoutSnapshot.h"
+#include "DropArea_p.h"
+#include "FrameworkWidgetFactory.h"
 #include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/MultiSplitter_p.h"
+#include "multisplitter/Anchor_p.h"
+#include "multisplitter/Item_p.h"
+#include "TitleBar_p.h"
+#include "TabWidget_p.h"
 #include "quick/QmlTypes.h"
 
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+# include "widgets/TitleBarWidget_p.h"
+#endif
+
 #include <QPointer>
 #include <QDebug>
 #include <QApplication>
 #include <QWindow>
+#include <QTimer>
+#include <QKeyEvent>
+#include <QMetaMethod>
+#include <QScreen>
+
+#include <algorithm>
 
 using namespace KDDockWidgets;
 
@@ -37,8 +57,6 @@ DockRegistry::DockRegistry(QObject *parent)
     : QObject(parent)
 {
 #ifdef KDDOCKWIDGETS_QTWIDGETS
-    qApp->installEventFilter(this);
-
 # ifdef DOCKS_DEVELOPER_MODE
     if (qEnvironmentVariableIntValue("KDDOCKWIDGETS_SHOW_DEBUG_WINDOW") == 1) {
         auto dv = new Debug::DebugWindow();
@@ -46,18 +64,160 @@ DockRegistry::DockRegistry(QObject *parent)
     }
 # endif
 
+    // So slowness can be diagnosed on machines without developer builds or profilers
+    m_debugShortcutEnabled = qEnvironmentVariableIntValue("KDDOCKWIDGETS_DEBUG_SHORTCUT") == 1;
+    updateAppEventFilter();
+
 #else
     KDDockWidgets::registerQmlTypes();
 #endif
+
+    if (qApp) {
+        m_screens = LayoutSaver::ScreenInfo::currentScreens();
+        for (QScreen *screen : qApp->screens())
+            watchScreen(screen);
+
+        connect(qApp, &QGuiApplication::screenAdded, this, [this] (QScreen *screen) {
+            watchScreen(screen);
+            m_screens = LayoutSaver::ScreenInfo::currentScreens();
+        });
+
+        // Qt moves the windows of a removed screen itself
+        connect(qApp, &QGuiApplication::screenRemoved, this, [this] {
+            m_screens = LayoutSaver::ScreenInfo::currentScreens();
+        });
+    }
+
+    // LayoutSnapshot's publishing outlives the registry, which is deleted when empty
+    updateObservingLayoutChanges();
+}
+
+void DockRegistry::watchScreen(QScreen *screen)
+{
+    // A devicePixelRatio change comes with a logical DPI change
+    connect(screen, &QScreen::geometryChanged, this, [this, screen] {
+        onScreenChanged(screen);
+    });
+    connect(screen, &QScreen::logicalDotsPerInchChanged, this, [this, screen] {
+        onScreenChanged(screen);
+    });
+}
+
+void DockRegistry::onScreenChanged(QScreen *screen)
+{
+    const LayoutSaver::ScreenInfo::List screens = LayoutSaver::ScreenInfo::currentScreens();
+    auto findScreen = [screen] (const LayoutSaver::ScreenInfo::List &list) -> const LayoutSaver::ScreenInfo * {
+        for (const LayoutSaver::ScreenInfo &info : list) {
+            if (info.name == screen->name())
+                return &info;
+        }
+        return nullptr;
+    };
+
+    const LayoutSaver::ScreenInfo *old = findScreen(m_screens);
+    const LayoutSaver::ScreenInfo *current = findScreen(screens);
+    if (!old || !current) {
+        m_screens = screens;
+        return;
+    }
+
+    // Geometries are in device independent pixels, a DPR change alone doesn't scale anything
+    const LayoutSaver::ScalingInfo scalingInfo(old->geometry, current->geometry);
+    const bool dprChanged = !qFuzzyCompare(old->devicePixelRatio, current->devicePixelRatio);
+    m_screens = screens;
+
+    if (!scalingInfo.isValid() && !dprChanged)
+        return;
+
+    auto isOnScreen = [screen] (QWidgetOrQuick *w) {
+        QWindow *window = w->windowHandle();
+        return window && window->screen() == screen;
+    };
+
+    QVector<QWidgetOrQuick*> affectedWindows;
+    QVector<MultiSplitterLayout*> affectedLayouts;
+    for (MainWindowBase *mw : qAsConst(m_mainWindows)) {
+        if (mw->isWindow() && isOnScreen(mw)) {
+            affectedWindows.push_back(mw);
+            affectedLayouts.push_back(mw->multiSplitterLayout());
+        }
+    }
+
+    for (FloatingWindow *fw : qAsConst(m_nestedWindows)) {
+        if (isOnScreen(fw)) {
+            affectedWindows.push_back(fw);
+            affectedLayouts.push_back(fw->multiSplitterLayout());
+        }
+    }
+
+    qCDebug(restoring) << Q_FUNC_INFO << screen->name() << old->geometry << current->geometry
+                       << old->devicePixelRatio << current->devicePixelRatio << affectedWindows.size();
+
+    if (scalingInfo.isValid()) {
+        // Each layout is solved once, after all windows got their new geometry
+        for (MultiSplitterLayout *layout : qAsConst(affectedLayouts))
+            layout->beginTransaction();
+
+        for (QWidgetOrQuick *window : qAsConst(affectedWindows)) {
+            const Qt::WindowState state = window->windowHandle()->windowState();
+            if (state == Qt::WindowMaximized || state == Qt::WindowFullScreen)
+                continue; // The window manager sizes those
+
+            QRect geometry = window->geometry();
+            scalingInfo.applyFactorsToTopLevel(/*by-ref*/geometry);
+            window->setGeometry(geometry);
+        }
+
+        for (MultiSplitterLayout *layout : qAsConst(affectedLayouts))
+            layout->endTransaction();
+    }
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (dprChanged) {
+        // The indicators check their pixmap's DPR when painting, only the title bar icons are rendered ahead of time
+        auto updateTitleBar = [] (TitleBar *titleBar) {
+            if (auto tbw = qobject_cast<TitleBarWidget*>(titleBar))
+                tbw->updateIconPixmap();
+        };
+
+        for (Frame *frame : qAsConst(m_frames)) {
+            if (frame->hasTitleBar() && affectedWindows.contains(frame->window()))
+                updateTitleBar(frame->titleBar());
+        }
+
+        for (QWidgetOrQuick *window : qAsConst(affectedWindows)) {
+            if (auto fw = qobject_cast<FloatingWindow*>(window))
+                updateTitleBar(fw->titleBar());
+        }
+    }
+#endif
 }
 
 DockRegistry::~DockRegistry()
 {
+    m_isBeingDestroyed = true;
+    delete m_debugWindow;
+
+    // Deleted right away, there might not be another event loop iteration to run a deleteLater()
+    const QVector<QPointer<FloatingWindow>> pool = m_floatingWindowPool;
+    m_floatingWindowPool.clear();
+    for (const QPointer<FloatingWindow> &fw : pool)
+        delete fw.data();
+
+    for (const QPointer<QObject> &obj : qAsConst(m_pendingDeletes)) {
+        if (obj)
+            obj->deleteLater();
+    }
+
+    // The pending flush won't happen, and readers mustn't see dock widgets which don't exist anymore
+    if (LayoutSnapshot::isPublishingEnabled())
+        LayoutSnapshot::publish(m_dockWidgets);
 }
 
 void DockRegistry::maybeDelete()
 {
-    if (isEmpty())
+    // ~DockRegistry() deletes the pooled floating windows, which unregister themselves from us
+    if (isEmpty() && !m_isBeingDestroyed)
         delete this;
 }
 
@@ -77,6 +237,54 @@ bool DockRegistry::isProcessingAppQuitEvent() const
     return m_isProcessingAppQuitEvent;
 }
 
+int DockRegistry::affinityId(const QString &affinityName)
+{
+    if (affinityName.isEmpty())
+        return 0;
+
+    auto it = m_affinityIds.constFind(affinityName);
+    if (it == m_affinityIds.cend())
+        it = m_affinityIds.insert(affinityName, m_affinityIds.size() + 1);
+
+    return it.value();
+}
+
+QBitArray DockRegistry::affinityMask(const QStringList &affinityNames)
+{
+    QBitArray mask(m_affinityIds.size() + 1);
+    for (const QString &name : affinityNames) {
+        const int id = affinityId(name);
+        if (id >= mask.size())
+            mask.resize(id + 1);
+        mask.setBit(id);
+    }
+
+    return mask;
+}
+
+bool DockRegistry::matchesAffinityMask(const QBitArray &mask, int affinityId)
+{
+    return affinityId < mask.size() && mask.testBit(affinityId);
+}
+
+static quint64 s_layoutGeneration = 0;
+
+quint64 DockRegistry::layoutGeneration()
+{
+    return s_layoutGeneration;
+}
+
+void DockRegistry::bumpLayoutGeneration()
+{
+    s_layoutGeneration++;
+}
+
+void DockRegistry::notifyLayoutEdited()
+{
+    if (!LayoutSaver::restoreInProgress())
+        Q_EMIT layoutEdited();
+}
+
 DockRegistry *DockRegistry::self()
 {
     static QPointer<DockRegistry> s_dockRegistry;
@@ -94,14 +302,78 @@ void DockRegistry::registerDockWidget(DockWidgetBase *dock)
         qWarning() << Q_FUNC_INFO << "DockWidget" << dock << " doesn't have an ID";
     } else if (auto other = dockByName(dock->uniqueName())) {
         qWarning() << Q_FUNC_INFO << "Another DockWidget" << other << "with name" << dock->uniqueName() << " already exists." << dock;
+    } else {
+        m_dockWidgetsByName.insert(dock->uniqueName(), dock);
     }
 
     m_dockWidgets << dock;
+
+    auto it = m_lazyDockWidgets.find(dock->uniqueName());
+    if (it != m_lazyDockWidgets.end()) {
+        // It was restored lazily, so it inherits the saved position.
+        // Release the lazy placeholders only after the dock widget referenced them, or they could be deleted.
+        std::unique_ptr<LazyDockWidget> lazy = std::move(it->second);
+        m_lazyDockWidgets.erase(it);
+        dock->lastPosition()->deserialize(lazy->lastPosition.serialize());
+    }
+
+    if (QWidget *guest = dock->widget())
+        m_dockWidgetsByGuest.insert(guest, dock);
+
+    // The guest is usually set after construction, so keep the guest index up to date
+    connect(dock, &DockWidgetBase::widgetChanged, this, [this, dock] (QWidget *guest) {
+        if (guest) {
+            m_dockWidgetsByGuest.insert(guest, dock);
+        } else {
+            // Hibernated, see DockWidgetBase::hibernate()
+            for (auto it = m_dockWidgetsByGuest.begin(); it != m_dockWidgetsByGuest.end();) {
+                if (it.value() == dock)
+                    it = m_dockWidgetsByGuest.erase(it);
+                else
+                    ++it;
+            }
+        }
+    });
+
+    connect(dock, &DockWidgetBase::optionsChanged, this, &DockRegistry::updateAppEventFilter);
+    updateAppEventFilter();
+
+    indexDockWidget(dock);
+    connect(dock, &DockWidgetBase::titleChanged, this, [this, dock] { indexDockWidget(dock); });
 }
 
 void DockRegistry::unregisterDockWidget(DockWidgetBase *dock)
 {
+    disconnect(dock, &DockWidgetBase::widgetChanged, this, nullptr);
+    disconnect(dock, &DockWidgetBase::optionsChanged, this, nullptr);
+    disconnect(dock, &DockWidgetBase::titleChanged, this, nullptr);
+    unindexDockWidget(dock);
     m_dockWidgets.removeOne(dock);
+    m_deferredVisibilitySet.remove(dock); // Its QPointer in m_deferredVisibility nulls itself
+    updateAppEventFilter();
+
+    const QString name = dock->uniqueName();
+    if (m_observingLayoutChanges && (m_reportedDockWidgetStates.take(dock) & ReportedDockWidgetState_Open))
+        recordLayoutChange(makeLayoutChange(LayoutChange::DockWidgetClosed, 0, name));
+
+    if (m_dockWidgetsByName.value(name) == dock) {
+        m_dockWidgetsByName.remove(name);
+        // If there was a duplicate, it now becomes the one found by name
+        for (auto other : qAsConst(m_dockWidgets)) {
+            if (other->uniqueName() == name) {
+                m_dockWidgetsByName.insert(name, other);
+                break;
+            }
+        }
+    }
+
+    for (auto it = m_dockWidgetsByGuest.begin(); it != m_dockWidgetsByGuest.end();) {
+        if (it.value() == dock)
+            it = m_dockWidgetsByGuest.erase(it);
+        else
+            ++it;
+    }
+
     maybeDelete();
 }
 
@@ -111,25 +383,66 @@ void DockRegistry::registerMainWindow(MainWindowBase *mainWindow)
         qWarning() << Q_FUNC_INFO << "MainWindow" << mainWindow << " doesn't have an ID";
     } else if (auto other = mainWindowByName(mainWindow->uniqueName())) {
         qWarning() << Q_FUNC_INFO << "Another MainWindow" << other << "with name" << mainWindow->uniqueName() << " already exists." << mainWindow;
+    } else {
+        m_mainWindowsByName.insert(mainWindow->uniqueName(), mainWindow);
     }
 
     m_mainWindows << mainWindow;
+
+    // To catch it being shown, hidden or reparented, as that changes topLevels(). See eventFilter().
+    mainWindow->installEventFilter(this);
+
+    bumpLayoutGeneration();
+    invalidateTopLevels();
+    Q_EMIT topLevelsChanged();
 }
 
 void DockRegistry::unregisterMainWindow(MainWindowBase *mainWindow)
 {
     m_mainWindows.removeOne(mainWindow);
+    mainWindow->removeEventFilter(this);
+
+    const QString name = mainWindow->uniqueName();
+    if (m_mainWindowsByName.value(name) == mainWindow) {
+        m_mainWindowsByName.remove(name);
+        for (auto other : qAsConst(m_mainWindows)) {
+            if (other->uniqueName() == name) {
+                m_mainWindowsByName.insert(name, other);
+                break;
+            }
+        }
+    }
+
+    bumpLayoutGeneration();
+    invalidateTopLevels();
+    Q_EMIT topLevelsChanged();
     maybeDelete();
 }
 
 void DockRegistry::registerNestedWindow(FloatingWindow *window)
 {
     m_nestedWindows << window;
+
+    // To catch its QWindow being exposed, which changes the z-order. See eventFilter().
+    window->installEventFilter(this);
+    if (QWindow *windowHandle = window->windowHandle())
+        windowHandle->installEventFilter(this);
+
+    bumpLayoutGeneration();
+    invalidateTopLevels();
+    Q_EMIT topLevelsChanged();
 }
 
 void DockRegistry::unregisterNestedWindow(FloatingWindow *window)
 {
     m_nestedWindows.removeOne(window);
+    window->removeEventFilter(this);
+    if (QWindow *windowHandle = window->windowHandle())
+        windowHandle->removeEventFilter(this);
+
+    bumpLayoutGeneration();
+    invalidateTopLevels();
+    Q_EMIT topLevelsChanged();
     maybeDelete();
 }
 
@@ -143,34 +456,186 @@ void DockRegistry::unregisterLayout(MultiSplitterLayout *layout)
     m_layouts.removeOne(layout);
 }
 
+static DockRegistry::LayoutChange makeLayoutChange(DockRegistry::LayoutChange::Type type, quintptr objectId,
+                                                  const QString &dockWidgetName = QString())
+{
+    DockRegistry::LayoutChange change;
+    change.type = type;
+    change.objectId = objectId;
+    change.dockWidgetName = dockWidgetName;
+    return change;
+}
+
 void DockRegistry::registerFrame(Frame *frame)
 {
     m_frames << frame;
+
+    connect(frame, &Frame::currentDockWidgetChanged, this, [this, frame] (DockWidgetBase *dw) {
+        if (!m_observingLayoutChanges || !dw)
+            return;
+
+        const quintptr id = quintptr(frame);
+        auto it = m_pendingTabChanges.constFind(id);
+        if (it != m_pendingTabChanges.cend()) {
+            m_pendingLayoutChanges[*it].dockWidgetName = dw->uniqueName();
+        } else {
+            m_pendingTabChanges.insert(id, m_pendingLayoutChanges.size());
+            recordLayoutChange(makeLayoutChange(LayoutChange::CurrentTabChanged, id, dw->uniqueName()));
+        }
+    });
+    connect(frame, &Frame::numDockWidgetsChanged, this, &DockRegistry::invalidateDockWidgetStates);
+
+    if (m_observingLayoutChanges) {
+        m_pendingFrameAdds.insert(quintptr(frame), m_pendingLayoutChanges.size());
+        recordLayoutChange(makeLayoutChange(LayoutChange::FrameAdded, quintptr(frame)));
+    }
 }
 
 void DockRegistry::unregisterFrame(Frame *frame)
 {
+    disconnect(frame, &Frame::currentDockWidgetChanged, this, nullptr);
+    disconnect(frame, &Frame::numDockWidgetsChanged, this, nullptr);
     m_frames.removeOne(frame);
+
+    if (m_observingLayoutChanges) {
+        const quintptr id = quintptr(frame);
+        auto tabChange = m_pendingTabChanges.find(id);
+        if (tabChange != m_pendingTabChanges.end()) {
+            m_cancelledLayoutChanges.insert(*tabChange);
+            m_pendingTabChanges.erase(tabChange);
+        }
+
+        auto frameAdd = m_pendingFrameAdds.find(id);
+        if (frameAdd != m_pendingFrameAdds.end()) {
+            // Observers never saw it
+            m_cancelledLayoutChanges.insert(*frameAdd);
+            m_pendingFrameAdds.erase(frameAdd);
+        } else {
+            recordLayoutChange(makeLayoutChange(LayoutChange::FrameRemoved, id));
+        }
+
+        invalidateDockWidgetStates();
+    }
 }
 
 DockWidgetBase *DockRegistry::dockByName(const QString &name) const
 {
-    for (auto dock : qAsConst(m_dockWidgets)) {
-        if (dock->uniqueName() == name)
-            return dock;
+    return m_dockWidgetsByName.value(name);
+}
+
+namespace {
+// The 3 UTF-16 code units of a trigram, packed
+quint64 trigramAt(const QString &s, int i)
+{
+    return (quint64(s.at(i).unicode()) << 32) | (quint64(s.at(i + 1).unicode()) << 16) | s.at(i + 2).unicode();
+}
+
+QVector<quint64> trigrams(const QString &s)
+{
+    QVector<quint64> result;
+    result.reserve(qMax(0, s.size() - 2));
+    for (int i = 0; i + 2 < s.size(); ++i)
+        result.push_back(trigramAt(s, i));
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+}
+
+void DockRegistry::indexDockWidget(DockWidgetBase *dw)
+{
+    unindexDockWidget(dw);
+
+    SearchEntry entry;
+    entry.key = dw->uniqueName().toCaseFolded() + QLatin1Char('\n') + dw->title().toCaseFolded();
+    entry.trigrams = trigrams(entry.key);
+    for (quint64 trigram : qAsConst(entry.trigrams))
+        m_trigramPostings[trigram].push_back(dw);
+
+    m_searchEntries.insert(dw, entry);
+}
+
+void DockRegistry::unindexDockWidget(DockWidgetBase *dw)
+{
+    auto it = m_searchEntries.find(dw);
+    if (it == m_searchEntries.end())
+        return;
+
+    for (quint64 trigram : qAsConst(it->trigrams)) {
+        auto postings = m_trigramPostings.find(trigram);
+        postings->removeOne(dw);
+        if (postings->isEmpty())
+            m_trigramPostings.erase(postings);
     }
 
-    return nullptr;
+    m_searchEntries.erase(it);
 }
 
-MainWindowBase *DockRegistry::mainWindowByName(const QString &name) const
+DockWidgetBase::List DockRegistry::findDockWidgets(const QString &text, int maxResults) const
 {
-    for (auto mainWindow : qAsConst(m_mainWindows)) {
-        if (mainWindow->uniqueName() == name)
-            return mainWindow;
+    DockWidgetBase::List matches;
+    if (text.isEmpty() || maxResults == 0)
+        return matches;
+
+    const QString needle = text.toCaseFolded();
+    auto keyFor = [this] (DockWidgetBase *dw) -> const QString & {
+        return m_searchEntries.constFind(dw)->key;
+    };
+
+    if (needle.size() < 3) {
+        // Too short for the index, but the folded keys still spare us folding every title
+        for (auto it = m_searchEntries.cbegin(), end = m_searchEntries.cend(); it != end; ++it) {
+            if (it->key.contains(needle))
+                matches.push_back(it.key());
+        }
+    } else {
+        // Only the dock widgets having the query's rarest trigram can match
+        const DockWidgetBase::List *candidates = nullptr;
+        for (quint64 trigram : trigrams(needle)) {
+            auto it = m_trigramPostings.constFind(trigram);
+            if (it == m_trigramPostings.cend())
+                return matches;
+            if (!candidates || it->size() < candidates->size())
+                candidates = &it.value();
+        }
+
+        for (DockWidgetBase *dw : *candidates) {
+            if (keyFor(dw).contains(needle))
+                matches.push_back(dw);
+        }
     }
 
-    return nullptr;
+    // Prefix matches of the name or the title first
+    auto isPrefixMatch = [&keyFor, &needle] (DockWidgetBase *dw) {
+        const QString &key = keyFor(dw);
+        return key.startsWith(needle) || key.contains(QLatin1Char('\n') + needle);
+    };
+
+    QVector<QPair<bool, DockWidgetBase*>> ranked;
+    ranked.reserve(matches.size());
+    for (DockWidgetBase *dw : qAsConst(matches))
+        ranked.push_back({ !isPrefixMatch(dw), dw });
+
+    std::sort(ranked.begin(), ranked.end(), [] (const QPair<bool, DockWidgetBase*> &a,
+                                                const QPair<bool, DockWidgetBase*> &b) {
+        if (a.first != b.first)
+            return a.first < b.first;
+        return a.second->uniqueName() < b.second->uniqueName();
+    });
+
+    const int count = maxResults < 0 ? ranked.size() : qMin(maxResults, ranked.size());
+    matches.clear();
+    matches.reserve(count);
+    for (int i = 0; i < count; ++i)
+        matches.push_back(ranked.at(i).second);
+
+    return matches;
+}
+
+MainWindowBase *DockRegistry::mainWindowByName(const QString &name) const
+{
+    return m_mainWindowsByName.value(name);
 }
 
 DockWidgetBase *DockRegistry::dockWidgetForGuest(QWidget *guest) const
@@ -178,12 +643,185 @@ DockWidgetBase *DockRegistry::dockWidgetForGuest(QWidget *guest) const
     if (!guest)
         return nullptr;
 
-    for (DockWidgetBase *dw : m_dockWidgets) {
-        if (dw->widget() == guest)
-            return dw;
+    DockWidgetBase *dw = m_dockWidgetsByGuest.value(guest);
+    // Verify the hit, in case the guest was deleted and its address reused
+    return (dw && dw->widget() == guest) ? dw : nullptr;
+}
+
+void DockRegistry::registerLazyDockWidget(const QString &uniqueName, const QString &affinityName)
+{
+    std::unique_ptr<LazyDockWidget> &lazy = m_lazyDockWidgets[uniqueName];
+    if (!lazy) {
+        lazy.reset(new LazyDockWidget());
     }
 
-    return nullptr;
+    // If it already existed the old position is kept until deserializeLazyDockWidgetPosition() replaces it,
+    // as it might be referencing placeholders in layouts that aren't being rebuilt
+    lazy->affinityName = affinityName;
+}
+
+void DockRegistry::unregisterLazyDockWidget(const QString &uniqueName)
+{
+    m_lazyDockWidgets.erase(uniqueName);
+}
+
+bool DockRegistry::deserializeLazyDockWidgetPosition(const QString &uniqueName, const LayoutSaver::LastPosition &lastPosition)
+{
+    auto it = m_lazyDockWidgets.find(uniqueName);
+    if (it == m_lazyDockWidgets.end())
+        return false;
+
+    // Swap only after the new one referenced its placeholders, the old one might share them
+    std::unique_ptr<LazyDockWidget> lazy(new LazyDockWidget());
+    lazy->affinityName = it->second->affinityName;
+    lazy->lastPosition.deserialize(lastPosition);
+    it->second.swap(lazy);
+
+    return true;
+}
+
+const DockRegistry::LazyDockWidget *DockRegistry::lazyDockWidget(const QString &uniqueName) const
+{
+    auto it = m_lazyDockWidgets.find(uniqueName);
+    return it == m_lazyDockWidgets.cend() ? nullptr : it->second.get();
+}
+
+QStringList DockRegistry::lazyDockWidgetNames() const
+{
+    QStringList names;
+    names.reserve(int(m_lazyDockWidgets.size()));
+    for (const auto &it : m_lazyDockWidgets)
+        names << it.first;
+
+    return names;
+}
+
+void DockRegistry::releasePlaceholder(Item *item)
+{
+    // The item is deleted when its last reference goes away, so stop there
+    QPointer<Item> guard = item;
+
+    for (DockWidgetBase *dw : qAsConst(m_dockWidgets)) {
+        if (!guard)
+            return;
+        dw->lastPosition()->removePlaceholder(item);
+    }
+
+    for (auto &it : m_lazyDockWidgets) {
+        if (!guard)
+            return;
+        it.second->lastPosition.removePlaceholder(item);
+    }
+}
+
+DockWidgetBase *DockRegistry::createLazyDockWidget(const QString &uniqueName)
+{
+    auto it = m_lazyDockWidgets.find(uniqueName);
+    if (it == m_lazyDockWidgets.end())
+        return dockByName(uniqueName);
+
+    const QString affinityName = it->second->affinityName;
+
+    auto factoryFunc = Config::self().dockWidgetFactoryFunc();
+    if (!factoryFunc) {
+        qWarning() << Q_FUNC_INFO << "A DockWidgetFactoryFunc is required to create" << uniqueName;
+        return nullptr;
+    }
+
+    // registerDockWidget() will handle the saved position
+    DockWidgetBase *dw = factoryFunc(uniqueName);
+    if (!dw || dw->uniqueName() != uniqueName) {
+        qWarning() << Q_FUNC_INFO << "DockWidgetFactoryFunc didn't create" << uniqueName << dw;
+        return nullptr;
+    }
+
+    dw->setAffinityName(affinityName); // Like DockWidgetBase::deserialize() would do
+    dw->setProperty("kddockwidget_was_restored", true);
+    return dw;
+}
+
+qint64 DockRegistry::MemoryReport::totalBytes() const
+{
+    qint64 total = dockWidgets.bytes + lazyDockWidgets.bytes + frames.bytes + titleBars.bytes
+                   + tabWidgets.bytes + floatingWindows.bytes + placeholderRefs.bytes;
+    for (const Layout &layout : layouts)
+        total += layout.items.bytes + layout.anchors.bytes; // Placeholders are already in items
+
+    return total;
+}
+
+static void addPlaceholderRefs(DockRegistry::MemoryReport::Entry &entry, const LastPosition &lastPosition)
+{
+    const auto &refs = lastPosition.placeholders();
+    entry.count += int(refs.size());
+    entry.bytes += qint64(refs.size() * sizeof(ItemRef) + refs.capacity() * sizeof(std::unique_ptr<ItemRef>));
+}
+
+DockRegistry::MemoryReport DockRegistry::memoryReport() const
+{
+    MemoryReport report;
+
+    report.dockWidgets.count = m_dockWidgets.size();
+    report.dockWidgets.bytes = m_dockWidgets.size() * qint64(sizeof(DockWidgetBase) + sizeof(LastPosition));
+    for (DockWidgetBase *dw : qAsConst(m_dockWidgets)) {
+        if (dw->widget())
+            report.guestWidgets++;
+        addPlaceholderRefs(report.placeholderRefs, *dw->lastPosition());
+    }
+
+    report.lazyDockWidgets.count = int(m_lazyDockWidgets.size());
+    for (const auto &it : m_lazyDockWidgets) {
+        report.lazyDockWidgets.bytes += qint64(sizeof(LazyDockWidget)) + it.first.capacity() * qint64(sizeof(QChar));
+        addPlaceholderRefs(report.placeholderRefs, it.second->lastPosition);
+    }
+
+    // Each Frame has a TabWidget, and a TitleBar once something asked for it
+    report.frames.count = m_frames.size();
+    report.frames.bytes = m_frames.size() * qint64(sizeof(Frame));
+    report.tabWidgets.count = m_frames.size();
+    report.tabWidgets.bytes = m_frames.size() * qint64(sizeof(TabWidget));
+    for (Frame *frame : qAsConst(m_frames)) {
+        if (frame->hasTitleBar())
+            report.titleBars.count++;
+    }
+
+    // Each FloatingWindow always has its own TitleBar
+    report.floatingWindows.count = m_nestedWindows.size();
+    report.floatingWindows.bytes = m_nestedWindows.size() * qint64(sizeof(FloatingWindow));
+    report.titleBars.count += m_nestedWindows.size();
+    report.titleBars.bytes = report.titleBars.count * qint64(sizeof(TitleBar));
+
+    report.layouts.reserve(m_layouts.size());
+    for (MultiSplitterLayout *layout : qAsConst(m_layouts)) {
+        MemoryReport::Layout entry;
+        entry.layout = layout;
+        entry.isInMainWindow = layout->multiSplitter()->isInMainWindow();
+
+        const ItemList &items = layout->items();
+        entry.items.count = items.size();
+        entry.items.bytes = items.size() * qint64(sizeof(Item)) + items.capacity() * qint64(sizeof(Item*));
+        for (Item *item : items) {
+            if (item->isPlaceholder()) {
+                entry.placeholders.count++;
+                entry.placeholders.bytes += qint64(sizeof(Item));
+            }
+        }
+
+        const Anchor::List &anchors = layout->anchors();
+        entry.anchors.count = anchors.size();
+        entry.anchors.bytes = anchors.size() * qint64(sizeof(Anchor)) + anchors.capacity() * qint64(sizeof(Anchor*));
+        for (Anchor *anchor : anchors) {
+            // AnchorItems only allocate once they outgrow their inline storage
+            for (const AnchorItems *sideItems : { &anchor->side1Items(), &anchor->side2Items() }) {
+                if (sideItems->capacity() > s_anchorItemsPrealloc)
+                    entry.anchors.bytes += sideItems->capacity() * qint64(sizeof(Item*));
+            }
+        }
+
+        report.layouts.push_back(entry);
+    }
+
+    return report;
 }
 
 bool DockRegistry::isSane() const
@@ -258,13 +896,352 @@ const QVector<FloatingWindow *> DockRegistry::nestedwindows() const
     QVector<FloatingWindow *> result;
     result.reserve(m_nestedWindows.size());
     for (FloatingWindow *fw : m_nestedWindows) {
-        if (!fw->beingDeleted())
+        if (!isPendingDelete(fw) && !fw->beingDeleted())
             result.push_back(fw);
     }
 
     return result;
 }
 
+void DockRegistry::scheduleDelete(QObject *obj)
+{
+    if (!obj || m_pendingDeleteSet.contains(obj))
+        return;
+
+    if (m_pendingDeletes.isEmpty()) {
+        // Can't use deleteLater() here due to QTBUG-83030 (deleteLater() never delivered if triggered by a sendEvent() before event loop starts)
+        QTimer::singleShot(0, this, &DockRegistry::deletePendingObjects);
+    }
+
+    m_pendingDeletes.push_back(obj);
+    m_pendingDeleteSet.insert(obj);
+
+    // Someone else might delete it first, don't let a new object at the same address look pending
+    connect(obj, &QObject::destroyed, this, [this, obj] {
+        m_pendingDeleteSet.remove(obj);
+    });
+}
+
+bool DockRegistry::isPendingDelete(const QObject *obj) const
+{
+    return m_pendingDeleteSet.contains(obj);
+}
+
+void DockRegistry::deletePendingObjects()
+{
+    KDDW_TRACE_SCOPE("DockRegistry::deletePendingObjects");
+
+    // Objects scheduled while deleting go to the next pass
+    const QVector<QPointer<QObject>> pending = std::move(m_pendingDeletes);
+    m_pendingDeletes.clear();
+    m_pendingDeleteSet.clear();
+
+    // A FloatingWindow deletes its frames, the QPointer takes care of those
+    for (const QPointer<QObject> &obj : pending)
+        delete obj.data();
+}
+
+DockRegistry::VisibilityNotificationBatch::VisibilityNotificationBatch()
+{
+    DockRegistry::self()->m_visibilityBatchDepth++;
+}
+
+DockRegistry::VisibilityNotificationBatch::~VisibilityNotificationBatch()
+{
+    DockRegistry *dr = DockRegistry::self();
+    Q_ASSERT(dr->m_visibilityBatchDepth > 0);
+    if (--dr->m_visibilityBatchDepth == 0)
+        dr->flushVisibilityNotifications();
+}
+
+InteractiveOperation::InteractiveOperation(const QVector<DockWidgetBase*> &dockWidgets)
+{
+    m_dockWidgets.reserve(dockWidgets.size());
+    for (DockWidgetBase *dw : dockWidgets) {
+        m_dockWidgets.push_back(dw);
+        dw->beginInteractiveOperation();
+    }
+}
+
+InteractiveOperation::~InteractiveOperation()
+{
+    for (DockWidgetBase *dw : qAsConst(m_dockWidgets)) {
+        if (dw) // It might have been deleted meanwhile
+            dw->endInteractiveOperation();
+    }
+}
+
+bool DockRegistry::deferVisibilityNotification(DockWidgetBase *dw, bool visible)
+{
+    if (m_visibilityBatchDepth == 0)
+        return false;
+
+    if (!m_deferredVisibilitySet.contains(dw)) {
+        m_deferredVisibilitySet.insert(dw);
+        m_deferredVisibility.push_back({ dw, !visible });
+    }
+
+    return true;
+}
+
+void DockRegistry::flushVisibilityNotifications()
+{
+    const QVector<DeferredVisibility> deferred = std::move(m_deferredVisibility);
+    m_deferredVisibility.clear();
+    m_deferredVisibilitySet.clear();
+
+    for (const DeferredVisibility &entry : deferred) {
+        DockWidgetBase *dw = entry.dockWidget.data();
+        if (!dw)
+            continue;
+
+        const bool visible = dw->isVisible();
+        if (visible == entry.wasVisible)
+            continue; // It only flip-flopped
+
+        if (visible)
+            Q_EMIT dw->shown();
+        else
+            Q_EMIT dw->hidden();
+    }
+}
+
+void DockRegistry::recordAnchorMoved(const Anchor *anchor, int position)
+{
+    if (!m_observingLayoutChanges)
+        return;
+
+    const quintptr id = quintptr(anchor);
+    auto it = m_pendingAnchorMoves.constFind(id);
+    if (it != m_pendingAnchorMoves.cend()) {
+        LayoutChange &change = m_pendingLayoutChanges[*it];
+        change.position = position;
+        change.orientation = anchor->orientation();
+        return;
+    }
+
+    LayoutChange change = makeLayoutChange(LayoutChange::AnchorMoved, id);
+    change.position = position;
+    change.orientation = anchor->orientation();
+    m_pendingAnchorMoves.insert(id, m_pendingLayoutChanges.size());
+    recordLayoutChange(change);
+}
+
+void DockRegistry::cancelAnchorMoved(const Anchor *anchor)
+{
+    if (!m_observingLayoutChanges)
+        return;
+
+    auto it = m_pendingAnchorMoves.find(quintptr(anchor));
+    if (it != m_pendingAnchorMoves.end()) {
+        m_cancelledLayoutChanges.insert(*it);
+        m_pendingAnchorMoves.erase(it);
+    }
+}
+
+void DockRegistry::invalidateDockWidgetStates()
+{
+    if (!m_observingLayoutChanges)
+        return;
+
+    m_dockWidgetStatesDirty = true;
+    scheduleLayoutChangesFlush();
+}
+
+void DockRegistry::recordLayoutChange(const LayoutChange &change)
+{
+    m_pendingLayoutChanges.push_back(change);
+    scheduleLayoutChangesFlush();
+}
+
+void DockRegistry::scheduleLayoutChangesFlush()
+{
+    if (!m_layoutChangesPending) {
+        m_layoutChangesPending = true;
+        QTimer::singleShot(0, this, &DockRegistry::flushLayoutChanges);
+    }
+}
+
+int DockRegistry::dockWidgetState(const DockWidgetBase *dw)
+{
+    if (!dw->isOpen())
+        return 0;
+
+    return dw->isFloating() ? (ReportedDockWidgetState_Open | ReportedDockWidgetState_Floating)
+                            : ReportedDockWidgetState_Open;
+}
+
+void DockRegistry::flushLayoutChanges()
+{
+    m_layoutChangesPending = false;
+    if (!m_observingLayoutChanges)
+        return;
+
+    LayoutChange::List changes;
+    changes.reserve(m_pendingLayoutChanges.size());
+    for (int i = 0, num = m_pendingLayoutChanges.size(); i < num; ++i) {
+        if (!m_cancelledLayoutChanges.contains(i))
+            changes.push_back(m_pendingLayoutChanges.at(i));
+    }
+
+    m_pendingLayoutChanges.clear();
+    m_pendingAnchorMoves.clear();
+    m_pendingTabChanges.clear();
+    m_pendingFrameAdds.clear();
+    m_cancelledLayoutChanges.clear();
+
+    if (m_dockWidgetStatesDirty) {
+        // Compared against what was last reported, so a dock widget closed and reopened meanwhile produces nothing
+        m_dockWidgetStatesDirty = false;
+        for (DockWidgetBase *dw : qAsConst(m_dockWidgets)) {
+            const int state = dockWidgetState(dw);
+            int &reported = m_reportedDockWidgetStates[dw];
+            if (state == reported)
+                continue;
+
+            const bool isOpen = state & ReportedDockWidgetState_Open;
+            if (isOpen != bool(reported & ReportedDockWidgetState_Open))
+                changes.push_back(makeLayoutChange(isOpen ? LayoutChange::DockWidgetOpened : LayoutChange::DockWidgetClosed,
+                                                   0, dw->uniqueName()));
+
+            if (isOpen && ((state ^ reported) & ReportedDockWidgetState_Floating))
+                changes.push_back(makeLayoutChange((state & ReportedDockWidgetState_Floating) ? LayoutChange::DockWidgetFloated
+                                                                                             : LayoutChange::DockWidgetDocked,
+                                                   0, dw->uniqueName()));
+            reported = state;
+        }
+    }
+
+    if (!changes.isEmpty())
+        Q_EMIT layoutChanged(changes);
+
+    if ((!changes.isEmpty() || m_layoutSnapshotDirty) && LayoutSnapshot::isPublishingEnabled())
+        LayoutSnapshot::publish(m_dockWidgets);
+    m_layoutSnapshotDirty = false;
+}
+
+void DockRegistry::updateObservingLayoutChanges()
+{
+    const bool observing = LayoutSnapshot::isPublishingEnabled()
+                           || isSignalConnected(QMetaMethod::fromSignal(&DockRegistry::layoutChanged));
+    if (observing == m_observingLayoutChanges)
+        return;
+
+    m_observingLayoutChanges = observing;
+    m_dockWidgetStatesDirty = false;
+    m_layoutSnapshotDirty = false;
+    m_pendingLayoutChanges.clear();
+    m_pendingAnchorMoves.clear();
+    m_pendingTabChanges.clear();
+    m_pendingFrameAdds.clear();
+    m_cancelledLayoutChanges.clear();
+    m_reportedDockWidgetStates.clear();
+
+    if (observing) {
+        // Observers start from the current state, for example after a LayoutSaver::serializeLayout()
+        for (DockWidgetBase *dw : qAsConst(m_dockWidgets))
+            m_reportedDockWidgetStates.insert(dw, dockWidgetState(dw));
+    }
+}
+
+void DockRegistry::connectNotify(const QMetaMethod &signal)
+{
+    QObject::connectNotify(signal);
+    if (signal == QMetaMethod::fromSignal(&DockRegistry::layoutChanged))
+        updateObservingLayoutChanges();
+}
+
+void DockRegistry::disconnectNotify(const QMetaMethod &signal)
+{
+    QObject::disconnectNotify(signal);
+    // An invalid signal means several were disconnected at once
+    if (!signal.isValid() || signal == QMetaMethod::fromSignal(&DockRegistry::layoutChanged))
+        updateObservingLayoutChanges();
+}
+
+void DockRegistry::raiseAndActivateLater(QWidgetOrQuick *window)
+{
+    if (!window)
+        return;
+
+    m_windowToActivate = window;
+    if (!m_activationPending) {
+        m_activationPending = true;
+        QTimer::singleShot(0, this, &DockRegistry::raiseAndActivatePendingWindow);
+    }
+}
+
+void DockRegistry::raiseAndActivatePendingWindow()
+{
+    m_activationPending = false;
+    QWidgetOrQuick *window = m_windowToActivate.data();
+    m_windowToActivate = nullptr;
+    if (!window || isPendingDelete(window))
+        return;
+
+    window->raise();
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    window->activateWindow();
+#endif
+}
+
+bool DockRegistry::recycleFloatingWindow(FloatingWindow *fw)
+{
+    // Drop the ones that got deleted with their parent main window meanwhile
+    m_floatingWindowPool.erase(std::remove_if(m_floatingWindowPool.begin(), m_floatingWindowPool.end(),
+                                              [] (const QPointer<FloatingWindow> &pooled) { return pooled.isNull(); }),
+                               m_floatingWindowPool.end());
+
+    // Only pristine windows are reused. A layout with placeholders or frames isn't.
+    // Warming up needs room for at least the window it creates
+    const int poolSize = (Config::self().flags() & Config::Flag_WarmUpWindows) ? qMax(1, Config::self().floatingWindowPoolSize())
+                                                                               : Config::self().floatingWindowPoolSize();
+
+    if (m_isProcessingAppQuitEvent || fw->isMaximized() || !fw->multiSplitterLayout()->items().isEmpty() ||
+        m_floatingWindowPool.size() >= poolSize)
+        return false;
+
+    if (!m_floatingWindowPool.contains(fw)) {
+        fw->hide();
+        m_floatingWindowPool.push_back(fw);
+    }
+
+    return true;
+}
+
+FloatingWindow *DockRegistry::takeRecycledFloatingWindow(MainWindowBase *parent)
+{
+    for (int i = 0; i < m_floatingWindowPool.size(); ++i) {
+        FloatingWindow *fw = m_floatingWindowPool.at(i);
+        if (fw && fw->parentWidget() == parent) {
+            m_floatingWindowPool.removeAt(i);
+            return fw;
+        }
+    }
+
+    return nullptr;
+}
+
+void DockRegistry::warmUpFloatingWindow(MainWindowBase *parent)
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    for (const QPointer<FloatingWindow> &fw : qAsConst(m_floatingWindowPool)) {
+        if (fw && fw->parentWidget() == parent)
+            return; // Already have one
+    }
+
+    FloatingWindow *fw = Config::self().frameworkWidgetFactory()->createFloatingWindow(parent);
+    fw->winId();
+    if (auto overlay = fw->dropArea()->dropIndicatorOverlay())
+        overlay->warmUp();
+
+    // It's empty, so this just puts it into the pool
+    fw->scheduleDeleteLater();
+#else
+    Q_UNUSED(parent);
+#endif
+}
+
 FloatingWindow *DockRegistry::floatingWindowForHandle(QWindow *windowHandle) const
 {
     for (FloatingWindow *fw : m_nestedWindows) {
@@ -277,36 +1254,97 @@ FloatingWindow *DockRegistry::floatingWindowForHandle(QWindow *windowHandle) con
 
 QVector<QWidget *> DockRegistry::topLevels(bool excludeFloatingDocks) const
 {
-    QVector<QWidget *> windows;
-    windows.reserve(m_nestedWindows.size() + m_mainWindows.size());
+    if (!m_topLevelsCacheValid) {
+        m_topLevelsCache.clear();
+        m_mainWindowTopLevelsCache.clear();
+        m_topLevelsCache.reserve(m_nestedWindows.size() + m_mainWindows.size());
 
-    if (!excludeFloatingDocks) {
         for (FloatingWindow *fw : m_nestedWindows) {
             if (fw->isVisible())
-                windows << fw;
+                m_topLevelsCache << fw;
         }
+
+        for (MainWindowBase *m : m_mainWindows) {
+            if (m->isVisible())
+                m_mainWindowTopLevelsCache << m->topLevelWidget();
+        }
+
+        m_topLevelsCache << m_mainWindowTopLevelsCache;
+        m_topLevelsCacheValid = true;
     }
 
-    for (MainWindowBase *m : m_mainWindows) {
-        if (m->isVisible())
-            windows << m->topLevelWidget();
+    return excludeFloatingDocks ? m_mainWindowTopLevelsCache : m_topLevelsCache;
+}
+
+void DockRegistry::invalidateTopLevels()
+{
+    m_topLevelsCacheValid = false;
+}
+
+namespace {
+/**
+ * Puts layouts in bulk-clear mode while the dock widgets are being closed, and clears them all
+ * when going out of scope. Closing doesn't re-propagate layouts which are about to be cleared.
+ * @sa MultiSplitterLayout::beginBulkClear()
+ */
+class BulkClear
+{
+public:
+    explicit BulkClear(bool deleteStaticAnchors)
+        : m_deleteStaticAnchors(deleteStaticAnchors)
+    {
     }
 
-    return windows;
+    ~BulkClear()
+    {
+        for (MultiSplitterLayout *layout : qAsConst(m_mainWindowLayouts)) {
+            if (layout)
+                layout->endBulkClear(m_deleteStaticAnchors);
+        }
+
+        // Emits the frame count change once, which makes the FloatingWindow delete itself
+        for (MultiSplitterLayout *layout : qAsConst(m_floatingWindowLayouts)) {
+            if (layout)
+                layout->endBulkClear(false);
+        }
+    }
+
+    void addMainWindowLayout(MultiSplitterLayout *layout)
+    {
+        layout->beginBulkClear();
+        m_mainWindowLayouts.push_back(layout);
+    }
+
+    void addFloatingWindowLayout(MultiSplitterLayout *layout)
+    {
+        layout->beginBulkClear();
+        m_floatingWindowLayouts.push_back(layout);
+    }
+
+private:
+    Q_DISABLE_COPY(BulkClear)
+    const bool m_deleteStaticAnchors;
+    QVector<QPointer<MultiSplitterLayout>> m_mainWindowLayouts;
+    QVector<QPointer<MultiSplitterLayout>> m_floatingWindowLayouts;
+};
 }
 
 void DockRegistry::clear(bool deleteStaticAnchors)
 {
+    qCDebug(restoring) << Q_FUNC_INFO << "; dockwidgets=" << m_dockWidgets.size()
+                       << "; nestedwindows=" << m_nestedWindows.size();
+
+    VisibilityNotificationBatch visibilityBatch;
+    BulkClear bulkClear(deleteStaticAnchors);
+    for (auto mw : qAsConst(m_mainWindows))
+        bulkClear.addMainWindowLayout(mw->multiSplitterLayout());
+    for (auto fw : qAsConst(m_nestedWindows))
+        bulkClear.addFloatingWindowLayout(fw->multiSplitterLayout());
+
     for (auto dw : qAsConst(m_dockWidgets)) {
         dw->forceClose();
         dw->lastPosition()->removePlaceholders();
     }
-
-    for (auto mw : qAsConst(m_mainWindows))
-        mw->multiSplitterLayout()->clear(deleteStaticAnchors);
-
-    qCDebug(restoring) << Q_FUNC_INFO << "; dockwidgets=" << m_dockWidgets.size()
-                       << "; nestedwindows=" << m_nestedWindows.size();
 }
 
 void DockRegistry::clear(QStringList affinities, bool deleteStaticAnchors)
@@ -319,17 +1357,74 @@ void DockRegistry::clear(QStringList affinities, bool deleteStaticAnchors)
 
      // empty affinity also matches and will be closed
     affinities << QString();
+    const QBitArray mask = affinityMask(affinities);
+
+    VisibilityNotificationBatch visibilityBatch;
+    BulkClear bulkClear(deleteStaticAnchors);
+    for (auto mw : qAsConst(m_mainWindows)) {
+        if (matchesAffinityMask(mask, mw->affinityId()))
+            bulkClear.addMainWindowLayout(mw->multiSplitterLayout());
+    }
+
+    for (auto fw : qAsConst(m_nestedWindows)) {
+        if (matchesAffinityMask(mask, fw->affinityId()))
+            bulkClear.addFloatingWindowLayout(fw->multiSplitterLayout());
+    }
 
     for (auto dw : qAsConst(m_dockWidgets)) {
-        if (affinities.contains(dw->affinityName())) {
+        if (matchesAffinityMask(mask, dw->affinityId())) {
             dw->forceClose();
             dw->lastPosition()->removePlaceholders();
         }
     }
+}
+
+void DockRegistry::clear(const QStringList &affinities, const QVector<MultiSplitterLayout*> &untouchedLayouts,
+                         bool deleteStaticAnchors)
+{
+    KDDW_TRACE_SCOPE("DockRegistry::clear");
+    if (untouchedLayouts.isEmpty()) {
+        clear(affinities, deleteStaticAnchors);
+        return;
+    }
 
+    QSet<DockWidgetBase*> untouchedDockWidgets;
+    for (MultiSplitterLayout *layout : untouchedLayouts) {
+        layout->forEachDockWidget([&untouchedDockWidgets] (DockWidgetBase *dw) {
+            untouchedDockWidgets.insert(dw);
+        });
+    }
+
+    // empty affinity also matches and will be closed
+    const bool matchesAll = affinities.isEmpty();
+    QStringList affinitiesToClear = affinities;
+    affinitiesToClear << QString();
+    const QBitArray mask = affinityMask(affinitiesToClear);
+
+    VisibilityNotificationBatch visibilityBatch;
+    BulkClear bulkClear(deleteStaticAnchors);
     for (auto mw : qAsConst(m_mainWindows)) {
-        if (affinities.contains(mw->affinityName())) {
-            mw->multiSplitterLayout()->clear(deleteStaticAnchors);
+        MultiSplitterLayout *layout = mw->multiSplitterLayout();
+        if ((matchesAll || matchesAffinityMask(mask, mw->affinityId())) && !untouchedLayouts.contains(layout))
+            bulkClear.addMainWindowLayout(layout);
+    }
+
+    for (auto fw : qAsConst(m_nestedWindows)) {
+        MultiSplitterLayout *layout = fw->multiSplitterLayout();
+        if ((matchesAll || matchesAffinityMask(mask, fw->affinityId())) && !untouchedLayouts.contains(layout))
+            bulkClear.addFloatingWindowLayout(layout);
+    }
+
+    for (auto dw : qAsConst(m_dockWidgets)) {
+        if ((!matchesAll && !matchesAffinityMask(mask, dw->affinityId())) || untouchedDockWidgets.contains(dw))
+            continue;
+
+        dw->forceClose();
+
+        // Placeholders in the untouched layouts are kept, removing them could delete their items
+        for (MultiSplitterLayout *layout : qAsConst(m_layouts)) {
+            if (!untouchedLayouts.contains(layout))
+                dw->lastPosition()->removePlaceholders(layout);
         }
     }
 }
@@ -342,22 +1437,115 @@ void DockRegistry::ensureAllFloatingWidgetsAreMorphed()
     }
 }
 
+bool DockRegistry::isTopLevelCandidate(QObject *o) const
+{
+    // The qApp event filter also sends us every other widget's events, only ours matter
+    if (!o->isWidgetType())
+        return false;
+
+    if (auto fw = qobject_cast<FloatingWindow*>(o))
+        return m_nestedWindows.contains(fw);
+
+    if (auto mw = qobject_cast<MainWindowBase*>(o))
+        return m_mainWindows.contains(mw);
+
+    return false;
+}
+
 bool DockRegistry::eventFilter(QObject *watched, QEvent *event)
 {
-    if (event->type() == QEvent::Quit && !m_isProcessingAppQuitEvent) {
-        m_isProcessingAppQuitEvent = true;
-        qApp->sendEvent(qApp, event);
-        m_isProcessingAppQuitEvent = false;
-        return true;
-    } else if (event->type() == QEvent::Expose) {
+    switch (event->type()) {
+    case QEvent::Quit:
+        if (!m_isProcessingAppQuitEvent) {
+            m_isProcessingAppQuitEvent = true;
+            qApp->sendEvent(qApp, event);
+            m_isProcessingAppQuitEvent = false;
+            return true;
+        }
+        break;
+    case QEvent::Expose:
         if (auto windowHandle = qobject_cast<QWindow*>(watched)) {
             if (FloatingWindow *fw = floatingWindowForHandle(windowHandle)) {
                 // This floating window was exposed
-                m_nestedWindows.removeOne(fw);
-                m_nestedWindows.append(fw);
+                if (m_nestedWindows.last() != fw) {
+                    m_nestedWindows.removeOne(fw);
+                    m_nestedWindows.append(fw);
+                    invalidateTopLevels();
+                    Q_EMIT topLevelsChanged();
+                }
             }
         }
+        break;
+    case QEvent::Show:
+    case QEvent::WinIdChange:
+        // A floating window's QWindow only exists once it's shown, and is recreated when reparented
+        if (auto fw = qobject_cast<FloatingWindow*>(watched)) {
+            if (QWindow *windowHandle = fw->windowHandle())
+                windowHandle->installEventFilter(this);
+        }
+        if (event->type() == QEvent::Show && isTopLevelCandidate(watched))
+            invalidateTopLevels();
+        break;
+    case QEvent::Hide:
+    case QEvent::ParentChange:
+        // topLevels() depends on visibility and, for embedded main windows, on the parent
+        if (isTopLevelCandidate(watched))
+            invalidateTopLevels();
+        break;
+    case QEvent::WindowStateChange:
+        // Like FloatingWindow does for its own dock widgets, see DockWidgetBase::isEffectivelyVisible()
+        if (auto mw = qobject_cast<MainWindowBase*>(watched)) {
+            for (DockWidgetBase *dw : mw->multiSplitterLayout()->dockWidgets())
+                dw->updateEffectiveVisibility();
+        }
+        break;
+    case QEvent::Move:
+        // Moving a window doesn't change the layout, but it changes the dock widgets' global geometry
+        if (LayoutSnapshot::isPublishingEnabled() && isTopLevelCandidate(watched)) {
+            m_layoutSnapshotDirty = true;
+            scheduleLayoutChangesFlush();
+        }
+        break;
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    case QEvent::KeyPress:
+        if (m_debugShortcutEnabled) {
+            auto ev = static_cast<QKeyEvent*>(event);
+            if (ev->key() == Qt::Key_D && ev->modifiers() == (Qt::ControlModifier | Qt::ShiftModifier | Qt::AltModifier)) {
+                if (!m_debugWindow)
+                    m_debugWindow = new Debug::DebugWindow();
+                m_debugWindow->show();
+                m_debugWindow->raise();
+                return true;
+            }
+        }
+        break;
+#endif
+    default:
+        break;
     }
 
     return false;
 }
+
+void DockRegistry::updateAppEventFilter()
+{
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    // An application wide filter sees every event of the application, so only install it while needed.
+    // QEvent::Quit is only delivered to qApp, we need it to let Qt close Option_NotClosable dock widgets,
+    // and to not recycle the floating windows that are closed at shutdown.
+    bool needed = m_debugShortcutEnabled || Config::self().floatingWindowPoolSize() > 0
+                  || (Config::self().flags() & Config::Flag_WarmUpWindows);
+
+    for (auto it = m_dockWidgets.cbegin(), end = m_dockWidgets.cend(); it != end && !needed; ++it)
+        needed = (*it)->options() & DockWidgetBase::Option_NotClosable;
+
+    if (needed == m_hasAppEventFilter)
+        return;
+
+    m_hasAppEventFilter = needed;
+    if (needed)
+        qApp->installEventFilter(this);
+    else
+        qApp->removeEventFilter(this);
+#endif
+}
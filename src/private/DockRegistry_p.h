@@ -24,10 +24,22 @@
 #include "DockWidgetBase.h"
 #include "MainWindowBase.h"
 #include "FloatingWindow_p.h"
+#include "LastPosition_p.h"
 
 #include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QPointer>
+#include <QBitArray>
 #include <QObject>
 
+#include <map>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+class QScreen;
+QT_END_NAMESPACE
+
 /**
  * DockRegistry is a singleton that knows about all DockWidgets.
  * It's used so we can restore layouts.
@@ -36,6 +48,26 @@
 namespace KDDockWidgets
 {
 
+class Anchor;
+
+/**
+ * @brief RAII class for an interactive operation which resizes dock widgets on every mouse move,
+ * like dragging a separator or a window.
+ *
+ * Each dock widget emits DockWidgetBase::interactiveOperationStarted() when it's constructed and
+ * DockWidgetBase::interactiveOperationFinished() when it's destroyed, so guests can pause expensive
+ * rendering meanwhile. Operations can overlap, a dock widget only emits for the outermost one.
+ */
+class DOCKS_EXPORT_FOR_UNIT_TESTS InteractiveOperation
+{
+public:
+    explicit InteractiveOperation(const QVector<DockWidgetBase*> &dockWidgets);
+    ~InteractiveOperation();
+private:
+    Q_DISABLE_COPY(InteractiveOperation)
+    QVector<QPointer<DockWidgetBase>> m_dockWidgets;
+};
+
 class DOCKS_EXPORT DockRegistry : public QObject
 {
     Q_OBJECT
@@ -57,14 +89,116 @@ public:
     void registerFrame(Frame *);
     void unregisterFrame(Frame *);
 
+    ///@brief A closed dock widget which was restored without being created. See RestoreOption_LazyClosedDockWidgets.
+    struct LazyDockWidget
+    {
+        QString affinityName;
+        LastPosition lastPosition;
+    };
+
+    /**
+     * @brief Approximate memory used by the docking framework, by object type. See memoryReport().
+     *
+     * Bytes are estimated from the size of our own classes and the containers they own, so they're
+     * a lower bound: what Qt allocates for each QObject and QWidget, and the guest widgets, isn't counted.
+     */
+    struct MemoryReport
+    {
+        struct Entry
+        {
+            int count = 0;
+            qint64 bytes = 0;
+        };
+
+        ///@brief The items, placeholders and anchors of one MultiSplitterLayout
+        struct Layout
+        {
+            const MultiSplitterLayout *layout = nullptr;
+            bool isInMainWindow = false;
+            Entry items; // Includes the placeholders
+            Entry placeholders;
+            Entry anchors;
+        };
+
+        Entry dockWidgets;
+        Entry lazyDockWidgets;
+        Entry frames;
+        Entry titleBars;
+        Entry tabWidgets;
+        Entry floatingWindows;
+        Entry placeholderRefs; // Held by the LastPosition of every dock widget, lazy ones included
+        int guestWidgets = 0;
+        QVector<Layout> layouts;
+
+        ///@brief Returns the sum of every entry, layouts included
+        qint64 totalBytes() const;
+    };
+
+    ///@brief Returns how many objects of each type exist, and how much memory they use. For budgets and leak hunting.
+    MemoryReport memoryReport() const;
+
     DockWidgetBase *dockByName(const QString &) const;
     MainWindowBase *mainWindowByName(const QString &) const;
 
     /// @brief returns the dock widget that hosts @p guest widget. Nullptr if there's none.
     DockWidgetBase *dockWidgetForGuest(QWidget *guest) const;
 
+    /**
+     * @brief Returns the dock widgets whose uniqueName() or title() contains @p text, case insensitively.
+     *
+     * Meant for "quick open" UIs which search on every keystroke. Queries of 3 or more characters are
+     * answered from a trigram index, which is kept up to date as dock widgets are created, destroyed
+     * or change title. Dock widgets with a name or title starting with @p text come first, then
+     * the rest, each group sorted by uniqueName().
+     *
+     * @param maxResults The maximum number of dock widgets to return, -1 for all.
+     */
+    DockWidgetBase::List findDockWidgets(const QString &text, int maxResults = -1) const;
+
     bool isSane() const;
 
+    /**
+     * @brief Remembers that the closed dock widget @p uniqueName is in the layout being restored, but isn't created.
+     * Its position is restored later, by deserializeLazyDockWidgetPosition(), once all items exist.
+     */
+    void registerLazyDockWidget(const QString &uniqueName, const QString &affinityName);
+
+    ///@brief Forgets the lazy dock widget @p uniqueName, and releases its placeholders
+    void unregisterLazyDockWidget(const QString &uniqueName);
+
+    ///@brief Restores the placeholders of lazy dock widget @p uniqueName. Returns false if there's no such lazy dock widget.
+    bool deserializeLazyDockWidgetPosition(const QString &uniqueName, const LayoutSaver::LastPosition &);
+
+    ///@brief returns the lazy dock widget named @p uniqueName, nullptr if there's none
+    const LazyDockWidget *lazyDockWidget(const QString &uniqueName) const;
+
+    ///@brief returns the names of the lazy dock widgets, sorted
+    QStringList lazyDockWidgetNames() const;
+
+    /**
+     * @brief Makes all dock widgets, including the lazy ones, forget the placeholder @p item.
+     * Once nothing references it anymore the placeholder is deleted.
+     */
+    void releasePlaceholder(Item *item);
+
+    /**
+     * @brief returns the dock widget named @p uniqueName. If it's a lazy dock widget it's created via
+     * Config::dockWidgetFactoryFunc(), and gets the saved position.
+     */
+    DockWidgetBase *createLazyDockWidget(const QString &uniqueName);
+
+    /**
+     * @brief returns a counter that's incremented whenever something LayoutSaver saves has changed.
+     * It's static so it doesn't restart when the registry is deleted. See LayoutSaver::layoutGeneration().
+     */
+    static quint64 layoutGeneration();
+
+    ///@brief increments layoutGeneration(). Called when windows, separators or dock widgets change.
+    static void bumpLayoutGeneration();
+
+    ///@brief emits layoutEdited(), unless a layout is being restored
+    void notifyLayoutEdited();
+
     ///@brief returns all DockWidget instances
     const DockWidgetBase::List dockwidgets() const;
 
@@ -84,6 +218,73 @@ public:
     /// As there might be DockWidgets which weren't morphed yet.
     const QVector<FloatingWindow*> nestedwindows() const;
 
+    /**
+     * @brief Deletes @p obj in the next event loop iteration, together with everything else scheduled meanwhile.
+     *
+     * Used for Frame and FloatingWindow teardown, so closing a window with many frames results
+     * in a single deletion pass, instead of a DeferredDelete event per object.
+     * Objects deleted by someone else meanwhile are skipped.
+     */
+    void scheduleDelete(QObject *obj);
+
+    ///@brief returns whether @p obj was passed to scheduleDelete() and wasn't deleted yet
+    bool isPendingDelete(const QObject *obj) const;
+
+    /**
+     * @brief Raises and activates @p window in the next event loop iteration.
+     *
+     * Only the last window requested meanwhile is raised, so restoring or dropping into many
+     * floating windows results in one activation change, instead of a window manager request
+     * and a title bar repaint per window.
+     */
+    void raiseAndActivateLater(QWidgetOrQuick *window);
+
+    /**
+     * @brief RAII class which coalesces DockWidgetBase::shown() and hidden() while alive.
+     *
+     * Restoring a layout or clearing the registry shows and hides dock widgets several times.
+     * Inside a batch those signals aren't emitted. When the last batch ends, each dock widget whose
+     * visibility differs from what it was before the batch emits shown() or hidden() once.
+     * Batches can be nested.
+     */
+    class VisibilityNotificationBatch
+    {
+    public:
+        VisibilityNotificationBatch();
+        ~VisibilityNotificationBatch();
+    private:
+        Q_DISABLE_COPY(VisibilityNotificationBatch)
+    };
+
+    /**
+     * @brief Called by DockWidgetBase before emitting shown() or hidden().
+     * Returns true if there's a VisibilityNotificationBatch, in which case the signal mustn't be emitted now.
+     */
+    bool deferVisibilityNotification(DockWidgetBase *dw, bool visible);
+
+    /**
+     * @brief Keeps the empty FloatingWindow @p fw hidden for reuse, if the pool isn't full.
+     * Returns false if it can't be recycled, in which case it should be deleted.
+     * @sa Config::setFloatingWindowPoolSize()
+     */
+    bool recycleFloatingWindow(FloatingWindow *fw);
+
+    ///@brief Returns a recycled FloatingWindow with parent @p parent, and removes it from the pool. nullptr if there's none.
+    FloatingWindow *takeRecycledFloatingWindow(MainWindowBase *parent);
+
+    /**
+     * @brief Creates a hidden FloatingWindow for @p parent, with its native window, and keeps it
+     * in the pool so the first tear-off doesn't have to create one. See Config::Flag_WarmUpWindows.
+     */
+    void warmUpFloatingWindow(MainWindowBase *parent);
+
+    ///@brief Installs the qApp event filter if something needs it, removes it otherwise.
+    ///Config calls it when the pool size or the flags change.
+    void updateAppEventFilter();
+
+    ///@brief returns whether the qApp event filter is installed. For unit-tests.
+    bool hasAppEventFilter() const { return m_hasAppEventFilter; }
+
     ///@brief returns the FloatingWindow with handle @p windowHandle
     FloatingWindow *floatingWindowForHandle(QWindow *windowHandle) const;
 
@@ -109,6 +310,13 @@ public:
      */
     void clear(QStringList affinities, bool deleteStaticAnchors = false);
 
+    /**
+     * @brief Like clear(affinities), but leaves the layouts in @p untouchedLayouts, and the dock widgets they contain, alone.
+     * Used by RestoreOption_Incremental, for main windows which didn't change.
+     */
+    void clear(const QStringList &affinities, const QVector<MultiSplitterLayout*> &untouchedLayouts,
+               bool deleteStaticAnchors);
+
     /**
      * @brief Ensures that all floating DockWidgets have a FloatingWindow as a window.
      *
@@ -137,17 +345,204 @@ public:
      */
     bool isProcessingAppQuitEvent() const;
 
+    /**
+     * @brief Returns a small integer identifying @p affinityName, so affinities can be compared without comparing strings.
+     *
+     * Names are interned the first time they're seen. The empty affinity is always 0, and ids
+     * aren't reused, so they can be stored.
+     */
+    int affinityId(const QString &affinityName);
+
+    ///@brief Returns a bit mask with the bits of @p affinityNames' ids set. See matchesAffinityMask()
+    QBitArray affinityMask(const QStringList &affinityNames);
+
+    ///@brief Returns whether the bit for @p affinityId is set in @p mask
+    static bool matchesAffinityMask(const QBitArray &mask, int affinityId);
+
+    /**
+     * @brief A change to the layout, as reported by layoutChanged()
+     *
+     * Frames and anchors are identified by @ref objectId, which is only unique among live objects
+     * and is meant for matching records with each other, not for dereferencing.
+     */
+    struct LayoutChange
+    {
+        typedef QVector<LayoutChange> List;
+        enum Type {
+            DockWidgetOpened = 0, ///< A dock widget was shown. Followed by DockWidgetFloated if it's floating
+            DockWidgetClosed, ///< A dock widget was closed or deleted
+            DockWidgetFloated, ///< An open dock widget became floating
+            DockWidgetDocked, ///< An open dock widget stopped being floating
+            FrameAdded, ///< A frame was created
+            FrameRemoved, ///< A frame was deleted
+            AnchorMoved, ///< An anchor moved to @ref position
+            CurrentTabChanged ///< The frame's current dock widget is now the one named @ref dockWidgetName
+        };
+
+        Type type;
+        quintptr objectId = 0; ///< The frame or anchor. 0 for dock widget records
+        QString dockWidgetName; ///< For dock widget records and CurrentTabChanged
+        int position = -1; ///< For AnchorMoved, the anchor's new position
+        Qt::Orientation orientation = Qt::Vertical; ///< For AnchorMoved
+    };
+
+    ///@brief Returns whether something is connected to layoutChanged(), so changes need to be recorded
+    bool isObservingLayoutChanges() const { return m_observingLayoutChanges; }
+
+    ///@brief Called by Anchor::setPosition(). Several moves of the same anchor result in a single record
+    void recordAnchorMoved(const Anchor *anchor, int position);
+
+    ///@brief Called by ~Anchor(). Drops its pending AnchorMoved record, as its address can be reused by a new anchor
+    void cancelAnchorMoved(const Anchor *anchor);
+
+    ///@brief Called when dock widgets might have been opened, closed, floated or docked. See layoutChanged()
+    void invalidateDockWidgetStates();
+
+Q_SIGNALS:
+    ///@brief emitted when a MainWindow or FloatingWindow is registered or unregistered, or when
+    /// the floating windows z-order changes
+    void topLevelsChanged();
+
+    ///@brief emitted after a docking operation: a drop, a dock widget being floated, docked or closed.
+    /// Not emitted for separator moves or while restoring a layout. See LayoutHistory.
+    void layoutEdited();
+
+    /**
+     * @brief Emitted once per event loop iteration in which the layout changed, with what changed.
+     *
+     * Allows tracking the layout incrementally, instead of serializing it to find out what changed.
+     * Changes are only recorded while something is connected to this signal. Repeated changes
+     * within the same iteration are coalesced: an anchor moved many times produces one AnchorMoved
+     * with its last position, and a frame added and removed meanwhile produces nothing.
+     * The dock widget records come last, as they describe each dock widget's state at the end of
+     * the iteration. Connecting takes a snapshot of that state, so only later changes are reported.
+     */
+    void layoutChanged(const KDDockWidgets::DockRegistry::LayoutChange::List &changes);
+
 protected:
     bool eventFilter(QObject *watched, QEvent *event) override;
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
 private:
+    friend class LayoutSnapshot;
     explicit DockRegistry(QObject *parent = nullptr);
     void maybeDelete();
+    void deletePendingObjects();
+    void raiseAndActivatePendingWindow();
+    void flushVisibilityNotifications();
+
+    ///@brief Starts or stops recording layout changes, depending on whether layoutChanged() is connected
+    /// or LayoutSnapshot is publishing
+    void updateObservingLayoutChanges();
+
+    ///@brief Queues @p change, and schedules flushLayoutChanges()
+    void recordLayoutChange(const LayoutChange &change);
+    void scheduleLayoutChangesFlush();
+
+    ///@brief Returns the ReportedDockWidgetState flags @p dw currently has
+    static int dockWidgetState(const DockWidgetBase *dw);
+
+    ///@brief Emits layoutChanged() with what was recorded since the last call
+    void flushLayoutChanges();
+
+    ///@brief Called when a FloatingWindow or MainWindow is added, removed, shown, hidden, reparented or raised
+    void invalidateTopLevels();
+
+    ///@brief Returns whether @p o is one of our FloatingWindow or MainWindow instances
+    bool isTopLevelCandidate(QObject *o) const;
+
+    ///@brief Adds @p dw to the search index, or updates it after its title changed. See findDockWidgets()
+    void indexDockWidget(DockWidgetBase *dw);
+    void unindexDockWidget(DockWidgetBase *dw);
+
+    ///@brief Watches @p screen for geometry and DPI changes. See onScreenChanged()
+    void watchScreen(QScreen *screen);
+
+    /**
+     * @brief Called when @p screen's geometry or DPI changed, for example after docking a laptop or an RDP reconnect.
+     *
+     * Compares it against m_screens. The main windows and floating windows on that screen are scaled
+     * to the new geometry in one pass, each layout solved once, and only their DPR-dependent caches
+     * are invalidated. Windows on other screens aren't touched.
+     */
+    void onScreenChanged(QScreen *screen);
+
     bool m_isProcessingAppQuitEvent = false;
+    bool m_hasAppEventFilter = false;
+    bool m_isBeingDestroyed = false; // See maybeDelete()
+
+    // Ctrl+Shift+Alt+D shows the DebugWindow, if KDDOCKWIDGETS_DEBUG_SHORTCUT=1
+    bool m_debugShortcutEnabled = false;
+    QPointer<QWidget> m_debugWindow;
     DockWidgetBase::List m_dockWidgets;
     MainWindowBase::List m_mainWindows;
     Frame::List m_frames;
     QVector<FloatingWindow*> m_nestedWindows;
     QVector<MultiSplitterLayout*> m_layouts;
+    QVector<QPointer<FloatingWindow>> m_floatingWindowPool;
+
+    // See topLevels(). The main windows' entries are also cached alone, for excludeFloatingDocks
+    mutable QVector<QWidget*> m_topLevelsCache;
+    mutable QVector<QWidget*> m_mainWindowTopLevelsCache;
+    mutable bool m_topLevelsCacheValid = false;
+
+    // See scheduleDelete(). The vector keeps the scheduling order, the set is for isPendingDelete()
+    QVector<QPointer<QObject>> m_pendingDeletes;
+    QSet<const QObject*> m_pendingDeleteSet;
+
+    // See raiseAndActivateLater()
+    QPointer<QWidgetOrQuick> m_windowToActivate;
+    bool m_activationPending = false;
+
+    // See VisibilityNotificationBatch. The visibility each dock widget had before the batch, in order of first change
+    struct DeferredVisibility
+    {
+        QPointer<DockWidgetBase> dockWidget;
+        bool wasVisible;
+    };
+    int m_visibilityBatchDepth = 0;
+    QVector<DeferredVisibility> m_deferredVisibility;
+    QSet<const DockWidgetBase*> m_deferredVisibilitySet;
+
+    // Indexes for the lookup functions. The lists above are kept for iteration order.
+    QHash<QString, DockWidgetBase*> m_dockWidgetsByName;
+    QHash<QString, MainWindowBase*> m_mainWindowsByName;
+    QHash<QWidget*, DockWidgetBase*> m_dockWidgetsByGuest;
+
+    // See findDockWidgets(). The key is the case folded "name\ntitle", the postings are per trigram
+    struct SearchEntry {
+        QString key;
+        QVector<quint64> trigrams;
+    };
+    QHash<DockWidgetBase*, SearchEntry> m_searchEntries;
+    QHash<quint64, DockWidgetBase::List> m_trigramPostings;
+
+    // See affinityId(). The empty affinity isn't stored, it's always 0
+    QHash<QString, int> m_affinityIds;
+
+    // The screens as of the last onScreenChanged(), to know what changed
+    LayoutSaver::ScreenInfo::List m_screens;
+
+    // See layoutChanged(). The hashes index the records still pending, for coalescing
+    bool m_observingLayoutChanges = false;
+    bool m_layoutChangesPending = false;
+    bool m_dockWidgetStatesDirty = false;
+    bool m_layoutSnapshotDirty = false; // A window moved, see LayoutSnapshot
+    LayoutChange::List m_pendingLayoutChanges;
+    QHash<quintptr, int> m_pendingAnchorMoves;
+    QHash<quintptr, int> m_pendingTabChanges;
+    QHash<quintptr, int> m_pendingFrameAdds;
+    QSet<int> m_cancelledLayoutChanges; // Indexes of records made obsolete by a later one, skipped when flushing
+
+    // What layoutChanged() last reported for each dock widget
+    enum ReportedDockWidgetState {
+        ReportedDockWidgetState_Open = 1,
+        ReportedDockWidgetState_Floating = 2
+    };
+    QHash<const DockWidgetBase*, int> m_reportedDockWidgetStates;
+
+    // Not a QHash, as LazyDockWidget isn't copyable
+    std::map<QString, std::unique_ptr<LazyDockWidget>> m_lazyDockWidgets;
 };
 
 }
@@ -21,16 +21,24 @@
 #include "DragController_p.h"
 #include "Frame_p.h"
 #include "Logging_p.h"
+#include "Tracing_p.h"
+#include "EventLog_p.h"
+#include "Stats_p.h"
 #include "DropArea_p.h"
+#include "DropAreaWithCentralFrame_p.h"
 #include "FloatingWindow_p.h"
 #include "WidgetResizeHandler_p.h"
 #include "Utils_p.h"
 #include "DockRegistry_p.h"
+#include "Config.h"
 
 #include <QMouseEvent>
 #include <QApplication>
 #include <QCursor>
 #include <QWindow>
+#include <QScreen>
+
+#include <algorithm>
 
 #if defined(Q_OS_WIN)
 # include <QWindow>
@@ -92,7 +100,7 @@ FallbackMouseGrabber::~FallbackMouseGrabber() {}
 }
 
 StateBase::StateBase(DragController *parent)
-    : QState(parent)
+    : QObject(parent)
     , q(parent)
 {
 }
@@ -104,8 +112,10 @@ StateNone::StateNone(DragController *parent)
 {
 }
 
-void StateNone::onEntry(QEvent *)
+void StateNone::onEntry()
 {
+    KDDW_TRACE_INSTANT("DragController: StateNone");
+    KDDW_LOG_EVENT(LogEvent::DragStateEntered, q, 0);
     qCDebug(state) << "StateNone entered";
     q->m_pressPos = QPoint();
     q->m_offset = QPoint();
@@ -114,6 +124,13 @@ void StateNone::onEntry(QEvent *)
     WidgetResizeHandler::s_disableAllHandlers = false; // Re-enable resize handlers
 
     q->m_nonClientDrag = false;
+    if (q->m_systemMoveWindow) {
+        q->m_systemMoveWindow->removeEventFilter(q);
+        q->m_systemMoveWindow = nullptr;
+    }
+    q->clearPendingMouseMove();
+    q->m_topLevelsSnapshot.clear();
+    q->m_topLevelsSnapshotDirty = true;
     if (q->m_currentDropArea) {
         q->m_currentDropArea->removeHover();
         q->m_currentDropArea = nullptr;
@@ -145,8 +162,10 @@ StatePreDrag::StatePreDrag(DragController *parent)
 
 StatePreDrag::~StatePreDrag() = default;
 
-void StatePreDrag::onEntry(QEvent *)
+void StatePreDrag::onEntry()
 {
+    KDDW_TRACE_INSTANT("DragController: StatePreDrag");
+    KDDW_LOG_EVENT(LogEvent::DragStateEntered, q, 1);
     qCDebug(state) << "StatePreDrag entered";
     WidgetResizeHandler::s_disableAllHandlers = true; // Disable the resize handler during dragging
 }
@@ -173,11 +192,17 @@ StateDragging::StateDragging(DragController *parent)
 
 StateDragging::~StateDragging() = default;
 
-void StateDragging::onEntry(QEvent *)
+void StateDragging::onEntry()
 {
+    KDDW_TRACE_INSTANT("DragController: StateDragging");
+    KDDW_LOG_EVENT(LogEvent::DragStateEntered, q, 2);
+    KDDW_TRACE_SCOPE("DragController: makeWindow");
     q->m_windowBeingDragged = q->m_draggable->makeWindow();
     if (q->m_windowBeingDragged) {
-        qCDebug(state) << "StateDragging entered. m_draggable=" << q->m_draggable << "; m_windowBeingDragged=" << q->m_windowBeingDragged->floatingWindow();
+        q->snapshotTopLevels();
+        if (!q->m_nonClientDrag && !q->m_isSimulatingDrag)
+            q->startSystemMove();
+        qCDebug(state) << "StateDragging entered. m_draggable=" << q->m_draggable << "; m_windowBeingDragged=" << q->m_windowBeingDragged->draggedWidget();
     } else {
         // Shouldn't happen
         qWarning() << Q_FUNC_INFO << "No window being dragged for " << q->m_draggable->asWidget();
@@ -187,8 +212,24 @@ void StateDragging::onEntry(QEvent *)
 
 bool StateDragging::handleMouseButtonRelease(QPoint globalPos)
 {
+    KDDW_TRACE_SCOPE("DragController: release");
+
+    // The drop must see the latest position
+    q->flushPendingMouseMove();
     qCDebug(state) << "StateDragging: handleMouseButtonRelease";
 
+    if (q->activeState() != this || !q->m_windowBeingDragged) {
+        // The pending move canceled the drag, for example because the window being dragged was deleted
+        qCDebug(state) << "StateDragging: Bailling out, drag was canceled by the pending move";
+        return true;
+    }
+
+    if (q->m_windowBeingDragged->isGhost())
+        return handleGhostRelease(globalPos);
+
+    // The drop needs the real frame geometries
+    q->m_windowBeingDragged->endDeferredRelayout();
+
     FloatingWindow *floatingWindow = q->m_windowBeingDragged->floatingWindow();
     if (!floatingWindow) {
         // It was deleted externally
@@ -217,25 +258,61 @@ bool StateDragging::handleMouseButtonRelease(QPoint globalPos)
     return true;
 }
 
+bool StateDragging::handleGhostRelease(QPoint globalPos)
+{
+    DockWidgetBase *dockWidget = q->m_windowBeingDragged->dockWidget();
+    if (!dockWidget) {
+        qCDebug(state) << "StateDragging: Bailling out, deleted externally";
+        Q_EMIT q->dragCanceled();
+        return true;
+    }
+
+    if (q->m_currentDropArea && q->m_currentDropArea->drop(dockWidget, globalPos)) {
+        Q_EMIT q->dropped();
+        return true;
+    }
+
+    // Not dropped onto anything, only now it becomes a floating window
+    qCDebug(state) << "StateDragging: Materializing the ghost";
+    if (q->m_currentDropArea) {
+        q->m_currentDropArea->removeHover();
+        q->m_currentDropArea = nullptr;
+    }
+
+    q->m_windowBeingDragged->materialize(globalPos - q->m_offset);
+    Q_EMIT q->dragCanceled();
+    return true;
+}
+
 bool StateDragging::handleMouseMove(QPoint globalPos)
 {
-    FloatingWindow *fw = q->m_windowBeingDragged->floatingWindow();
-    if (!fw) {
+    if (q->coalesceMouseMove(globalPos))
+        return true;
+
+    return processMouseMove(globalPos);
+}
+
+bool StateDragging::processMouseMove(QPoint globalPos)
+{
+    KDDW_TRACE_SCOPE("DragController: mouse move");
+    KDDW_STATS_TIME_SCOPE(lastDragHoverUSecs);
+    QWidgetOrQuick *dragged = q->m_windowBeingDragged->draggedWidget();
+    if (!dragged) {
         qCDebug(state) << "Canceling drag, window was deleted";
         Q_EMIT q->dragCanceled();
         return true;
     }
 
-    if (!q->m_nonClientDrag)
-        fw->windowHandle()->setPosition(globalPos - q->m_offset);
+    if (!q->m_nonClientDrag && !q->m_systemMoveWindow)
+        q->m_windowBeingDragged->moveTo(globalPos - q->m_offset);
 
-
-    if (fw->anyNonDockable()) {
+    FloatingWindow *fw = q->m_windowBeingDragged->floatingWindow();
+    if (fw && fw->anyNonDockable()) {
         qCDebug(state) << "StateDragging: Ignoring non dockable floating window";
         return true;
     }
 
-    DropArea *dropArea = q->dropAreaUnderCursor();
+    DropArea *dropArea = q->dropAreaUnderCursor(globalPos);
     if (q->m_currentDropArea && dropArea != q->m_currentDropArea)
         q->m_currentDropArea->removeHover();
 
@@ -247,7 +324,10 @@ bool StateDragging::handleMouseMove(QPoint globalPos)
             }
         }
 
-        dropArea->hover(fw, globalPos);
+        if (fw)
+            dropArea->hover(fw, globalPos);
+        else
+            dropArea->hover(q->m_windowBeingDragged->dockWidget(), globalPos);
     }
 
     q->m_currentDropArea = dropArea;
@@ -268,14 +348,24 @@ DragController::DragController(QObject *)
     auto statepreDrag = new StatePreDrag(this);
     auto stateDragging = new StateDragging(this);
 
-    stateNone->addTransition(this, &DragController::mousePressed, statepreDrag);
-    statepreDrag->addTransition(this, &DragController::dragCanceled, stateNone);
-    statepreDrag->addTransition(this, &DragController::manhattanLengthMove, stateDragging);
-    stateDragging->addTransition(this, &DragController::dragCanceled, stateNone);
-    stateDragging->addTransition(this, &DragController::dropped, stateNone);
+    // The transitions happen synchronously, as the signal is emitted
+    auto addTransition = [this] (StateBase *from, void (DragController::*signal)(), StateBase *to) {
+        connect(this, signal, this, [this, from, to] {
+            if (m_activeState == from)
+                setActiveState(to);
+        });
+    };
+
+    addTransition(stateNone, &DragController::mousePressed, statepreDrag);
+    addTransition(statepreDrag, &DragController::dragCanceled, stateNone);
+    addTransition(statepreDrag, &DragController::manhattanLengthMove, stateDragging);
+    addTransition(stateDragging, &DragController::dragCanceled, stateNone);
+    addTransition(stateDragging, &DragController::dropped, stateNone);
 
-    setInitialState(stateNone);
-    start();
+    setActiveState(stateNone);
+
+    m_pendingMouseMoveTimer.setSingleShot(true);
+    connect(&m_pendingMouseMoveTimer, &QTimer::timeout, this, &DragController::flushPendingMouseMove);
 }
 
 DragController *DragController::instance()
@@ -329,6 +419,78 @@ void DragController::releaseMouse(QWidgetOrQuick *target)
     }
 }
 
+bool DragController::simulateDrag(Draggable *draggable, QPoint pressPos, const QVector<QPoint> &globalPath)
+{
+    if (globalPath.isEmpty()) {
+        qWarning() << Q_FUNC_INFO << "Empty path";
+        return false;
+    }
+
+    if (!beginSimulatedDrag(draggable, pressPos))
+        return false;
+
+    for (QPoint globalPos : globalPath)
+        simulateMouseMove(globalPos);
+
+    return endSimulatedDrag(globalPath.last());
+}
+
+bool DragController::beginSimulatedDrag(Draggable *draggable, QPoint pressPos)
+{
+    if (!draggable) {
+        qWarning() << Q_FUNC_INFO << "Null draggable";
+        return false;
+    }
+
+    if (m_isSimulatingDrag || !qobject_cast<StateNone*>(activeState())) {
+        qWarning() << Q_FUNC_INFO << "A drag is already in progress";
+        return false;
+    }
+
+    const QPoint globalPos = draggable->asWidget()->mapToGlobal(pressPos);
+    m_isSimulatingDrag = true;
+
+    activeState()->handleMouseButtonPress(draggable, globalPos, pressPos);
+    if (qobject_cast<StateNone*>(activeState())) {
+        // Not a draggable position
+        m_isSimulatingDrag = false;
+        return false;
+    }
+
+    return true;
+}
+
+void DragController::simulateMouseMove(QPoint globalPos)
+{
+    if (!m_isSimulatingDrag) {
+        qWarning() << Q_FUNC_INFO << "No simulated drag in progress";
+        return;
+    }
+
+    if (auto dragging = qobject_cast<StateDragging*>(activeState()))
+        dragging->processMouseMove(globalPos);
+    else
+        activeState()->handleMouseMove(globalPos);
+}
+
+bool DragController::endSimulatedDrag(QPoint globalPos)
+{
+    if (!m_isSimulatingDrag) {
+        qWarning() << Q_FUNC_INFO << "No simulated drag in progress";
+        return false;
+    }
+
+    bool wasDropped = false;
+    const QMetaObject::Connection connection = connect(this, &DragController::dropped, this, [&wasDropped] {
+        wasDropped = true;
+    });
+    activeState()->handleMouseButtonRelease(globalPos);
+    disconnect(connection);
+
+    m_isSimulatingDrag = false;
+    return wasDropped;
+}
+
 static QMouseEvent *mouseEvent(QEvent *e)
 {
     switch (e->type()) {
@@ -352,16 +514,23 @@ bool DragController::eventFilter(QObject *o, QEvent *e)
         // On Windows, non-client mouse moves are only sent at the end, so we must fake it:
         qCDebug(mouseevents) << "DragController::eventFilter e=" << e->type() << "; o=" << o;
         activeState()->handleMouseMove(QCursor::pos());
-        return QStateMachine::eventFilter(o, e);
+        return QObject::eventFilter(o, e);
+    }
+
+    if (m_systemMoveWindow && o == m_systemMoveWindow.data() && e->type() == QEvent::Move) {
+        // The window manager has the pointer, derive the cursor position from where it put the window.
+        // Cheaper than QCursor::pos(), which is a round-trip on X11.
+        activeState()->handleMouseMove(m_systemMoveWindow->windowHandle()->position() + m_offset);
+        return QObject::eventFilter(o, e);
     }
 
     QMouseEvent *me = mouseEvent(e);
-    if (!me)
-        return QStateMachine::eventFilter(o, e);
+    if (!me || m_isSimulatingDrag) // Real mouse events would disturb a simulated drag
+        return QObject::eventFilter(o, e);
 
     auto w = qobject_cast<QWidget*>(o);
     if (!w)
-        return QStateMachine::eventFilter(o, e);
+        return QObject::eventFilter(o, e);
 
     qCDebug(mouseevents) << "DragController::eventFilter e=" << e->type() << "; o=" << o;
 
@@ -373,7 +542,7 @@ bool DragController::eventFilter(QObject *o, QEvent *e)
                 return activeState()->handleMouseButtonPress(draggableForQObject(o), me->globalPos(), me->pos());
             }
         }
-        return QStateMachine::eventFilter(o, e);
+        return QObject::eventFilter(o, e);
     }
     case QEvent::MouseButtonPress:
         // For top-level windows that support native dragging all goes through the NonClient* events.
@@ -391,15 +560,192 @@ bool DragController::eventFilter(QObject *o, QEvent *e)
         break;
     }
 
-    return QStateMachine::eventFilter(o, e);
+    return QObject::eventFilter(o, e);
+}
+
+bool DragController::startSystemMove()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    if (!(Config::self().flags() & Config::Flag_SystemMove))
+        return false;
+
+    FloatingWindow *fw = m_windowBeingDragged->floatingWindow();
+    QWindow *window = fw ? fw->windowHandle() : nullptr;
+    if (!window)
+        return false;
+
+    // The window was just created, put it under the cursor before handing it over
+    window->setPosition(QCursor::pos() - m_offset);
+
+    // Returns false if the platform doesn't support it, we'll move it ourselves then
+    if (!window->startSystemMove())
+        return false;
+
+    // We won't get mouse moves anymore, only the window's move events.
+    // The release is still delivered to the draggable, as it has the grab.
+    m_systemMoveWindow = fw;
+    fw->installEventFilter(this);
+    return true;
+#else
+    return false;
+#endif
+}
+
+static int dragMouseMoveInterval()
+{
+    const int interval = Config::self().dragMouseMoveInterval();
+    if (interval != -1)
+        return interval;
+
+    // Once per display refresh
+    QScreen *screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen ? screen->refreshRate() : 0;
+    return refreshRate > 0 ? qMax(1, int(1000 / refreshRate)) : 16;
+}
+
+bool DragController::coalesceMouseMove(QPoint globalPos)
+{
+    const int interval = dragMouseMoveInterval();
+    if (interval <= 0)
+        return false;
+
+    if (!m_lastMouseMoveTimer.isValid() || m_lastMouseMoveTimer.elapsed() >= interval) {
+        // Enough time passed since the last one, process it right away
+        m_hasPendingMouseMove = false;
+        m_pendingMouseMoveTimer.stop();
+        m_lastMouseMoveTimer.start();
+        return false;
+    }
+
+    // Only the latest position matters
+    m_pendingMouseMovePos = globalPos;
+    m_hasPendingMouseMove = true;
+    if (!m_pendingMouseMoveTimer.isActive())
+        m_pendingMouseMoveTimer.start(qMax(0, interval - int(m_lastMouseMoveTimer.elapsed())));
+
+    return true;
+}
+
+void DragController::flushPendingMouseMove()
+{
+    if (!m_hasPendingMouseMove)
+        return;
+
+    m_hasPendingMouseMove = false;
+    m_pendingMouseMoveTimer.stop();
+    m_lastMouseMoveTimer.start();
+
+    if (auto dragging = qobject_cast<StateDragging*>(activeState()))
+        dragging->processMouseMove(m_pendingMouseMovePos);
+}
+
+void DragController::clearPendingMouseMove()
+{
+    m_hasPendingMouseMove = false;
+    m_pendingMouseMoveTimer.stop();
+    m_lastMouseMoveTimer.invalidate();
+}
+
+void DragController::snapshotTopLevels() const
+{
+    m_topLevelsSnapshot.clear();
+    m_topLevelsSnapshotDirty = false;
+
+    // The registry tells us when windows come and go, or when the floating windows z-order changes
+    connect(DockRegistry::self(), &DockRegistry::topLevelsChanged,
+            this, &DragController::invalidateTopLevelsSnapshot, Qt::UniqueConnection);
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    FloatingWindow *draggedWindow = m_windowBeingDragged ? m_windowBeingDragged->floatingWindow() : nullptr;
+    const int affinityId = m_windowBeingDragged ? m_windowBeingDragged->affinityId() : 0;
+
+    // On Linux we don't have API to check the z-order of top-levels. So first check the floating windows
+    // and check the MainWindow last, as the MainWindow will have lower z-order as it's a parent (TODO: How will it work with multiple MainWindows ?)
+    // The floating window list is sorted by z-order, as we catch QEvent::Expose and move it to last of the list
+    const auto floatingWindows = DockRegistry::self()->nestedwindows();
+    const auto mainWindows = DockRegistry::self()->mainwindows();
+    m_topLevelsSnapshot.reserve(floatingWindows.size() + mainWindows.size());
+
+    for (int i = floatingWindows.size() - 1; i >= 0; --i) {
+        FloatingWindow *fw = floatingWindows.at(i);
+        if (fw == draggedWindow || !fw->isVisible())
+            continue;
+        m_topLevelsSnapshot.push_back({ fw, fw->geometry(), fw->affinityId() == affinityId, {} });
+    }
+
+    for (int i = mainWindows.size() - 1; i >= 0; --i) {
+        MainWindowBase *mw = mainWindows.at(i);
+        if (!mw->isVisible())
+            continue;
+        QWidget *tl = mw->topLevelWidget();
+        m_topLevelsSnapshot.push_back({ tl, tl->geometry(), mw->affinityId() == affinityId, {} });
+    }
+
+    // Now that all top-levels are known, give each one its drop areas. A main window can be nested
+    // inside another one or inside a floating window.
+    for (MainWindowBase *mw : mainWindows) {
+        DropArea *dropArea = mw->dropArea();
+        if (!mw->isVisible() || !dropArea)
+            continue;
+
+        QWidget *tl = mw->topLevelWidget();
+        for (TopLevelCandidate &candidate : m_topLevelsSnapshot) {
+            if (candidate.window == tl) {
+                candidate.dropTargets.push_back({ dropArea, QRect(dropArea->mapToGlobal(QPoint(0, 0)), dropArea->size()) });
+                break;
+            }
+        }
+    }
+
+    for (TopLevelCandidate &candidate : m_topLevelsSnapshot) {
+        // A nested drop area is inside the outer one, so sorting by area puts the inner-most first
+        std::sort(candidate.dropTargets.begin(), candidate.dropTargets.end(), [] (const DropTarget &t1, const DropTarget &t2) {
+            return t1.globalGeometry.width() * t1.globalGeometry.height() < t2.globalGeometry.width() * t2.globalGeometry.height();
+        });
+    }
+#endif
+}
+
+bool DragController::dropAreaFromSnapshot(QWidgetOrQuick *topLevel, QPoint globalPos, DropArea *&dropArea) const
+{
+    if (m_topLevelsSnapshotDirty)
+        return false;
+
+    for (const TopLevelCandidate &candidate : m_topLevelsSnapshot) {
+        if (candidate.window != topLevel)
+            continue;
+
+        if (candidate.dropTargets.isEmpty())
+            return false; // Not a main window, let the caller handle it
+
+        dropArea = nullptr;
+        for (const DropTarget &target : candidate.dropTargets) {
+            if (target.dropArea && target.globalGeometry.contains(globalPos) && target.dropArea->isVisible()) {
+                dropArea = target.dropArea;
+                break;
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void DragController::invalidateTopLevelsSnapshot()
+{
+    m_topLevelsSnapshotDirty = true;
 }
 
 StateBase *DragController::activeState() const
 {
-    auto set = configuration();
-    if (set.isEmpty())
-        return nullptr;
-    return static_cast<StateBase *>(*(set.begin()));
+    return m_activeState;
+}
+
+void DragController::setActiveState(StateBase *state)
+{
+    // Set before onEntry(), as it might already transition to another state
+    m_activeState = state;
+    state->onEntry();
 }
 
 #if defined(Q_OS_WIN)
@@ -415,38 +761,22 @@ static QWidget *qtTopLevelForHWND(HWND hwnd)
     return nullptr;
 }
 #endif
-template <typename T>
-static QWidget* qtTopLevelUnderCursor_impl(QPoint globalPos, const QVector<T> &topLevels, T windowBeingDragged)
-{
-    for (int i = topLevels.size() -1; i >= 0; --i) {
-        auto tl = topLevels.at(i);
-        if (!tl->isVisible() || tl == windowBeingDragged || tl->isMinimized())
-            continue;
-        if (tl->geometry().contains(globalPos)) {
-            qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << tl;
-            return tl;
-        }
-    }
-
-    return nullptr;
-}
 
-QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
+QWidgetOrQuick *DragController::qtTopLevelUnderCursor(QPoint globalPos) const
 {
 #ifdef KDDOCKWIDGETS_QTWIDGETS
 
-    QPoint globalPos = QCursor::pos();
-    auto topLevels = qApp->topLevelWidgets();
-
-    if (qApp->platformName() == QLatin1String("windows")) { // So -platform offscreen on Windows doesn't use this
+    // So -platform offscreen on Windows doesn't use this. Neither do simulated drags, as they don't move the native cursor.
+    if (qApp->platformName() == QLatin1String("windows") && !m_isSimulatingDrag) {
 # if defined(Q_OS_WIN)
+        auto topLevels = qApp->topLevelWidgets();
         POINT globalNativePos;
         if (!GetCursorPos(&globalNativePos))
             return nullptr;
 
         // There might be windows that don't belong to our app in between, so use win32 to travel by z-order.
         // Another solution is to set a parent on all top-levels. But this code is orthogonal.
-        HWND hwnd = HWND(m_windowBeingDragged->floatingWindow()->winId());
+        HWND hwnd = HWND(m_windowBeingDragged->topLevel()->winId());
         while (hwnd) {
             hwnd = GetWindow(hwnd, GW_HWNDNEXT);
             RECT r;
@@ -482,15 +812,22 @@ QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
 # endif
     } else {
         // !Windows: Linux, macOS, offscreen (offscreen on Windows too), etc.
+        if (m_topLevelsSnapshotDirty)
+            snapshotTopLevels();
 
-        // On Linux we don't have API to check the z-order of top-levels. So first check the floating windows
-        // and check the MainWindow last, as the MainWindow will have lower z-order as it's a parent (TODO: How will it work with multiple MainWindows ?)
-        // The floating window list is sorted by z-order, as we catch QEvent::Expose and move it to last of the list
+        for (const TopLevelCandidate &candidate : m_topLevelsSnapshot) {
+            QWidget *tl = candidate.window;
+            if (!tl || !tl->isVisible() || tl->isMinimized() || !candidate.globalGeometry.contains(globalPos))
+                continue;
 
-        if (auto tl = qtTopLevelUnderCursor_impl(globalPos, DockRegistry::self()->nestedwindows(), m_windowBeingDragged->floatingWindow()))
-            return tl;
+            if (!candidate.acceptsDrop) {
+                qCDebug(toplevels) << Q_FUNC_INFO << "Top-level with incompatible affinity is under cursor" << tl;
+                return nullptr;
+            }
 
-        return qtTopLevelUnderCursor_impl(globalPos, DockRegistry::self()->topLevels(/*excludeFloating=*/true), static_cast<QWidget*>(nullptr));
+            qCDebug(toplevels) << Q_FUNC_INFO << "Found top-level" << tl;
+            return tl;
+        }
     }
 #else
     // QtQuick:
@@ -501,9 +838,9 @@ QWidgetOrQuick *DragController::qtTopLevelUnderCursor() const
     return nullptr;
 }
 
-DropArea *DragController::dropAreaUnderCursor() const
+DropArea *DragController::dropAreaUnderCursor(QPoint globalPos) const
 {
-    auto topLevel = qtTopLevelUnderCursor();
+    auto topLevel = qtTopLevelUnderCursor(globalPos);
     if (!topLevel) {
         //qCDebug(state) << "DragController::dropAreaUnderCursor: null";
         return nullptr;
@@ -524,11 +861,15 @@ DropArea *DragController::dropAreaUnderCursor() const
 
     if (auto dock = qobject_cast<DockWidgetBase *>(topLevel)) {
         FloatingWindow *fw = dock->morphIntoFloatingWindow();
-        m_windowBeingDragged->floatingWindow()->raise();
+        m_windowBeingDragged->topLevel()->raise();
         return fw->dropArea();
     }
 
-    auto *w = topLevel->childAt(topLevel->mapFromGlobal(QCursor::pos()));
+    DropArea *snapshotDropArea = nullptr;
+    if (dropAreaFromSnapshot(topLevel, globalPos, snapshotDropArea))
+        return snapshotDropArea;
+
+    auto *w = topLevel->childAt(topLevel->mapFromGlobal(globalPos));
     while (w) {
         if (auto dt = qobject_cast<DropArea *>(w)) {
             return dt;
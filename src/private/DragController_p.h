@@ -21,12 +21,18 @@
 #ifndef KD_DRAGCONTROLLER_P_H
 #define KD_DRAGCONTROLLER_P_H
 
+#include "docks_export.h"
 #include "TitleBar_p.h"
 #include "TabWidget_p.h"
 #include "WindowBeingDragged_p.h"
 
-#include <QStateMachine>
+#include <QObject>
 #include <QPoint>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QRect>
+#include <QVector>
 #include <memory>
 
 namespace KDDockWidgets {
@@ -36,7 +42,7 @@ class DropArea;
 class Draggable;
 class FallbackMouseGrabber;
 
-class DragController : public QStateMachine
+class DOCKS_EXPORT DragController : public QObject
 {
     Q_OBJECT
 public:
@@ -60,6 +66,24 @@ public:
     void grabMouseFor(QWidgetOrQuick *);
     void releaseMouse(QWidgetOrQuick *);
 
+    /**
+     * @brief Drags @p draggable programmatically, without mouse events. For tests and benchmarks.
+     *
+     * Presses at @p pressPos, in @p draggable's coordinates, moves through each point of @p globalPath
+     * and releases at the last one. The states are fed synchronously, no event loop is needed.
+     * The points are used as the cursor position instead of QCursor::pos(), and mouse move coalescing
+     * (Config::setDragMouseMoveInterval()) and Config::Flag_SystemMove are bypassed, so it's repeatable.
+     *
+     * @return true if it was dropped onto a drop area
+     */
+    bool simulateDrag(Draggable *draggable, QPoint pressPos, const QVector<QPoint> &globalPath);
+
+    ///@brief The steps of simulateDrag(). For when the path depends on the drag itself, like on where the drop indicators show.
+    ///Returns false if a drag can't start at @p pressPos
+    bool beginSimulatedDrag(Draggable *draggable, QPoint pressPos);
+    void simulateMouseMove(QPoint globalPos);
+    bool endSimulatedDrag(QPoint globalPos);
+
 Q_SIGNALS:
     void mousePressed();
     void manhattanLengthMove();
@@ -78,27 +102,81 @@ private:
 
     DragController(QObject * = nullptr);
     StateBase *activeState() const;
-    QWidgetOrQuick *qtTopLevelUnderCursor() const;
-    DropArea *dropAreaUnderCursor() const;
+    void setActiveState(StateBase *);
+    ///@brief Returns the top-level at @p globalPos, the position of the mouse event being handled.
+    /// Not re-read from the cursor, so the drop target is picked where the window was dragged to.
+    QWidgetOrQuick *qtTopLevelUnderCursor(QPoint globalPos) const;
+    DropArea *dropAreaUnderCursor(QPoint globalPos) const;
+
     Draggable *draggableForQObject(QObject *o) const;
+
+    ///@brief Returns true if the mouse move was deferred. See Config::setDragMouseMoveInterval()
+    bool coalesceMouseMove(QPoint globalPos);
+
+    ///@brief Processes the deferred mouse move, if any
+    void flushPendingMouseMove();
+    void clearPendingMouseMove();
+
+    ///@brief Caches the candidate drop targets, so we don't query all top-levels at every mouse move
+    void snapshotTopLevels() const;
+    void invalidateTopLevelsSnapshot();
+
+    ///@brief Hands the move of the window being dragged to the window manager. See Config::Flag_SystemMove
+    bool startSystemMove();
+
     QPoint m_pressPos;
     QPoint m_offset;
 
     Draggable::List m_draggables;
     Draggable *m_draggable = nullptr;
+    StateBase *m_activeState = nullptr;
     std::unique_ptr<WindowBeingDragged> m_windowBeingDragged;
     DropArea *m_currentDropArea = nullptr;
     bool m_nonClientDrag = false;
+    bool m_isSimulatingDrag = false;
+
+    // Set while the window manager is moving the window, see startSystemMove()
+    QPointer<FloatingWindow> m_systemMoveWindow;
     FallbackMouseGrabber *m_fallbackMouseGrabber = nullptr;
+
+    QTimer m_pendingMouseMoveTimer;
+    QElapsedTimer m_lastMouseMoveTimer;
+    QPoint m_pendingMouseMovePos;
+    bool m_hasPendingMouseMove = false;
+
+    struct DropTarget {
+        QPointer<DropArea> dropArea;
+        QRect globalGeometry;
+    };
+
+    struct TopLevelCandidate {
+        QPointer<QWidgetOrQuick> window;
+        QRect globalGeometry;
+        bool acceptsDrop; // false if its affinity doesn't match, it still occludes the windows below
+
+        // The main window drop areas in this top-level, inner-most first, so dropAreaUnderCursor()
+        // doesn't need to map the cursor and walk the widget hierarchy at every mouse move.
+        QVector<DropTarget> dropTargets;
+    };
+
+    ///@brief Returns the snapshot's drop area containing @p globalPos, in @p topLevel. Returns false if the snapshot doesn't know @p topLevel
+    bool dropAreaFromSnapshot(QWidgetOrQuick *topLevel, QPoint globalPos, DropArea *&dropArea) const;
+
+    // The top-levels which can be under the cursor, in the order they should be tested (top-most first)
+    mutable QVector<TopLevelCandidate> m_topLevelsSnapshot;
+    mutable bool m_topLevelsSnapshotDirty = true;
 };
 
-class StateBase : public QState
+class StateBase : public QObject
 {
     Q_OBJECT
 public:
     explicit StateBase(DragController *parent);
     ~StateBase();
 
+    ///@brief Called when DragController transitions into this state
+    virtual void onEntry() = 0;
+
     // Not using QEvent here, to abstract platform differences regarding production of such events
     virtual bool handleMouseButtonPress(Draggable * /*receiver*/, QPoint /*globalPos*/, QPoint /*pos*/) { return false; }
     virtual bool handleMouseMove(QPoint /*globalPos*/) { return false; }
@@ -113,7 +191,7 @@ class StateNone : public StateBase
 public:
     explicit StateNone(DragController *parent);
     ~StateNone() override;
-    void onEntry(QEvent *) override;
+    void onEntry() override;
     bool handleMouseButtonPress(Draggable *draggable, QPoint globalPos, QPoint pos) override;
 };
 
@@ -123,7 +201,7 @@ class StatePreDrag : public StateBase
 public:
     explicit StatePreDrag(DragController *parent);
     ~StatePreDrag() override;
-    void onEntry(QEvent *) override;
+    void onEntry() override;
     bool handleMouseMove(QPoint globalPos) override;
     bool handleMouseButtonRelease(QPoint) override;
 };
@@ -134,9 +212,16 @@ class StateDragging : public StateBase
 public:
     explicit StateDragging(DragController *parent);
     ~StateDragging() override;
-    void onEntry(QEvent *) override;
+    void onEntry() override;
     bool handleMouseButtonRelease(QPoint globalPos) override;
     bool handleMouseMove(QPoint globalPos) override;
+
+    ///@brief handleMouseMove() without the coalescing
+    bool processMouseMove(QPoint globalPos);
+
+private:
+    ///@brief The release of a Config::Flag_GhostTabDrag drag, which docks the dock widget or makes it float
+    bool handleGhostRelease(QPoint globalPos);
 };
 
 }
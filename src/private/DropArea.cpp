@@ -20,6 +20,8 @@
 
 #include "DropArea_p.h"
 #include "Logging_p.h"
+#include "Tracing_p.h"
+#include "EventLog_p.h"
 #include "DockWidgetBase.h"
 #include "Draggable_p.h"
 #include "FloatingWindow_p.h"
@@ -27,6 +29,7 @@
 #include "DropIndicatorOverlayInterface_p.h"
 #include "FrameworkWidgetFactory.h"
 #include "MainWindowBase.h"
+#include "DockRegistry_p.h"
 
 // #include "indicators/AnimatedIndicators_p.h"
 #include "WindowBeingDragged_p.h"
@@ -46,6 +49,11 @@ DropArea::DropArea(QWidgetOrQuick *parent)
     qCDebug(creation) << "DropArea";
     connect(m_layout, &MultiSplitterLayout::aboutToDumpDebug,
             this, &DropArea::debug_updateItemNamesForGammaray);
+
+    // A single pass over the frames, instead of each frame reacting on its own.
+    // FloatingWindow updates its own title bar when the count changes too.
+    connect(m_layout, &MultiSplitterLayout::visibleWidgetCountChanged,
+            this, &DropArea::updateTitleBarVisibilities);
 }
 
 DropArea::~DropArea()
@@ -54,6 +62,16 @@ DropArea::~DropArea()
     qCDebug(creation) << "~DropArea";
 }
 
+void DropArea::updateTitleBarVisibilities()
+{
+    if (m_inDestructor)
+        return;
+
+    m_layout->forEachFrame([] (Frame *frame) {
+        frame->updateOwnTitleBarVisibility();
+    });
+}
+
 int DropArea::numFrames() const
 {
     return m_layout->count();
@@ -73,17 +91,13 @@ Anchor::List DropArea::nonStaticAnchors(bool includePlaceholders) const
 
 Frame *DropArea::frameContainingPos(QPoint globalPos) const
 {
-    const ItemList &items = m_layout->items();
-    for (Item *item : items) {
-        auto frame = item->frame();
-        if (!frame || !frame->isVisible()) {
-            continue;
-        }
+    // Item geometry is in our coordinate space, and is the same as the frame's geometry
+    Item *item = m_layout->itemAt(mapFromGlobal(globalPos));
+    auto frame = item ? item->frame() : nullptr;
+    if (!frame || !frame->isVisible())
+        return nullptr;
 
-        if (frame->containsMouse(globalPos))
-            return frame;
-    }
-    return nullptr;
+    return frame;
 }
 
 Item *DropArea::centralFrame() const
@@ -116,6 +130,9 @@ void DropArea::addDockWidget(DockWidgetBase *dw, Location location, DockWidgetBa
     Frame *frame = nullptr;
     Frame *relativeToFrame = relativeTo ? relativeTo->frame() : nullptr;
 
+    // New frames are created inside us, instead of as a top-level, so the dock widget changes
+    // window only once. Each window change recreates native and OpenGL children.
+
     // Check if the dock widget already exists in the layout
     if (contains(dw)) {
         Frame *oldFrame = dw->frame();
@@ -124,11 +141,11 @@ void DropArea::addDockWidget(DockWidgetBase *dw, Location location, DockWidgetBa
             // The frame only has this dock widget, and the frame is already in the layout. So move the frame instead
             frame = oldFrame;
         } else {
-            frame = Config::self().frameworkWidgetFactory()->createFrame();
+            frame = Config::self().frameworkWidgetFactory()->createFrame(this);
             frame->addWidget(dw);
         }
     } else {
-        frame = Config::self().frameworkWidgetFactory()->createFrame();
+        frame = Config::self().frameworkWidgetFactory()->createFrame(this);
         frame->addWidget(dw);
     }
 
@@ -173,6 +190,17 @@ QString DropArea::affinityName() const
     return QString();
 }
 
+int DropArea::affinityId() const
+{
+    if (auto mw = mainWindow()) {
+        return mw->affinityId();
+    } else if (auto fw = floatingWindow()) {
+        return fw->affinityId();
+    }
+
+    return 0;
+}
+
 void DropArea::hover(FloatingWindow *floatingWindow, QPoint globalPos)
 {
     if (!validateAffinity(floatingWindow))
@@ -184,6 +212,17 @@ void DropArea::hover(FloatingWindow *floatingWindow, QPoint globalPos)
     m_dropIndicatorOverlay->hover(globalPos);
 }
 
+void DropArea::hover(DockWidgetBase *dockWidget, QPoint globalPos)
+{
+    if (!validateAffinity(dockWidget))
+        return;
+
+    Frame *frame = frameContainingPos(globalPos);
+    m_dropIndicatorOverlay->setWindowBeingDragged(dockWidget);
+    m_dropIndicatorOverlay->setHoveredFrame(frame);
+    m_dropIndicatorOverlay->hover(globalPos);
+}
+
 static bool isOutterLocation(DropIndicatorOverlayInterface::DropLocation location)
 {
     switch (location) {
@@ -199,6 +238,7 @@ static bool isOutterLocation(DropIndicatorOverlayInterface::DropLocation locatio
 
 bool DropArea::drop(FloatingWindow *droppedWindow, QPoint globalPos)
 {
+    KDDW_TRACE_SCOPE("DropArea::drop");
     if (droppedWindow == window()) {
         qWarning() << "Refusing to drop onto itself"; // Doesn't happen
         Q_ASSERT(false);
@@ -223,6 +263,7 @@ bool DropArea::drop(FloatingWindow *droppedWindow, QPoint globalPos)
     bool result = true;
 
     auto droploc = m_dropIndicatorOverlay->currentDropLocation();
+    KDDW_LOG_EVENT(LogEvent::WindowDropped, this, droploc);
     switch (droploc) {
     case DropIndicatorOverlayInterface::DropLocation_Left:
     case DropIndicatorOverlayInterface::DropLocation_Top:
@@ -250,8 +291,76 @@ bool DropArea::drop(FloatingWindow *droppedWindow, QPoint globalPos)
         break;
     }
 
-    if (result)
+    if (result) {
         raiseAndActivate();
+        DockRegistry::self()->notifyLayoutEdited();
+    }
+
+    return result;
+}
+
+bool DropArea::drop(DockWidgetBase *dockWidget, QPoint globalPos)
+{
+    KDDW_TRACE_SCOPE("DropArea::drop");
+    if (m_dropIndicatorOverlay->currentDropLocation() == DropIndicatorOverlayInterface::DropLocation_None) {
+        qCDebug(hovering) << "DropArea::drop: bailing out, drop location = none";
+        return false;
+    }
+
+    qCDebug(dropping) << "DropArea::drop:" << dockWidget;
+
+    hover(dockWidget, globalPos);
+    Frame *acceptingFrame = m_dropIndicatorOverlay->hoveredFrame();
+    const auto droploc = m_dropIndicatorOverlay->currentDropLocation();
+    if (!(acceptingFrame || isOutterLocation(droploc)))
+        return false;
+
+    // Its tab is the only one left, for example if the others were closed during the drag. Docking it next to
+    // its own frame, or onto the edges of a layout with only that frame, changes nothing. And it would
+    // empty the frame it's docked relative to, or the floating window it's docked into.
+    Frame *ownFrame = dockWidget->frame();
+    if (ownFrame && ownFrame->dockWidgetCount() == 1 && m_layout->contains(ownFrame)) {
+        const bool nextToItself = acceptingFrame == ownFrame && !isOutterLocation(droploc);
+        const bool aloneInLayout = isOutterLocation(droploc) && m_layout->visibleCount() == 1;
+        if (nextToItself || aloneInLayout) {
+            qCDebug(dropping) << "DropArea::drop: Dropped next to itself, nothing to do";
+            return true;
+        }
+    }
+
+    KDDW_LOG_EVENT(LogEvent::DockWidgetDropped, this, droploc);
+    bool result = true;
+    switch (droploc) {
+    case DropIndicatorOverlayInterface::DropLocation_Left:
+    case DropIndicatorOverlayInterface::DropLocation_Top:
+    case DropIndicatorOverlayInterface::DropLocation_Bottom:
+    case DropIndicatorOverlayInterface::DropLocation_Right:
+        result = drop(dockWidget, DropIndicatorOverlayInterface::multisplitterLocationFor(droploc), acceptingFrame);
+        break;
+    case DropIndicatorOverlayInterface::DropLocation_OutterLeft:
+    case DropIndicatorOverlayInterface::DropLocation_OutterTop:
+    case DropIndicatorOverlayInterface::DropLocation_OutterRight:
+    case DropIndicatorOverlayInterface::DropLocation_OutterBottom:
+        result = drop(dockWidget, DropIndicatorOverlayInterface::multisplitterLocationFor(droploc), nullptr);
+        break;
+    case DropIndicatorOverlayInterface::DropLocation_Center:
+        if (acceptingFrame->contains(dockWidget)) {
+            // Dropped back into its own tab widget, nothing to do
+            return true;
+        }
+
+        qCDebug(hovering) << "Tabbing" << dockWidget << "into" << acceptingFrame;
+        acceptingFrame->addWidget(dockWidget);
+        break;
+    default:
+        result = false;
+        break;
+    }
+
+    if (result) {
+        raiseAndActivate();
+        DockRegistry::self()->notifyLayoutEdited();
+    }
 
     return result;
 }
@@ -264,7 +373,7 @@ bool DropArea::drop(QWidgetOrQuick *droppedWindow, KDDockWidgets::Location locat
         if (!validateAffinity(dock))
             return false;
 
-        auto frame = Config::self().frameworkWidgetFactory()->createFrame();
+        auto frame = Config::self().frameworkWidgetFactory()->createFrame(this); // See addDockWidget()
         frame->addWidget(dock);
         m_layout->addWidget(frame, location, relativeTo);
     } else if (auto floatingWindow = qobject_cast<FloatingWindow *>(droppedWindow)) {
@@ -272,7 +381,8 @@ bool DropArea::drop(QWidgetOrQuick *droppedWindow, KDDockWidgets::Location locat
             return false;
 
         m_layout->addMultiSplitter(floatingWindow->dropArea(), location, relativeTo);
-        floatingWindow->scheduleDeleteLater();
+        // Its layout was merged into ours, it's not in a reusable state
+        floatingWindow->scheduleDeleteLater(/*allowRecycling=*/false);
         return true;
     } else {
         qWarning() << "Unknown dropped widget" << droppedWindow;
@@ -291,7 +401,7 @@ void DropArea::removeHover()
 template<typename T>
 bool DropArea::validateAffinity(T *window) const
 {
-    if (window->affinityName() != affinityName()) {
+    if (window->affinityId() != affinityId()) {
         // Commented the warning, so we don't warn when hovering over
         //qWarning() << Q_FUNC_INFO << "Refusing to dock widget with incompatible affinity."
                    //<< window->affinityName() << affinityName();
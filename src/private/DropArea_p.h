@@ -55,6 +55,10 @@ public:
     void removeHover();
     void hover(FloatingWindow *floatingWindow, QPoint globalPos);
     bool drop(FloatingWindow *droppedWindow, QPoint globalPos);
+
+    ///@brief Overloads for when only a ghost of @p dockWidget was dragged, it's still in its tab. See Config::Flag_GhostTabDrag
+    void hover(DockWidgetBase *dockWidget, QPoint globalPos);
+    bool drop(DockWidgetBase *dockWidget, QPoint globalPos);
     bool drop(QWidgetOrQuick *droppedwindow, KDDockWidgets::Location location, Frame *relativeTo);
     int numFrames() const;
 
@@ -70,6 +74,7 @@ public:
     bool contains(DockWidgetBase *) const;
 
     QString affinityName() const;
+    int affinityId() const;
 private:
     Q_DISABLE_COPY(DropArea)
     friend class Frame;
@@ -78,6 +83,9 @@ private:
     friend class AnimatedIndicators;
     template <typename T>
     bool validateAffinity(T *) const;
+
+    ///@brief Updates the title bar visibility of all our frames when the number of visible ones changes
+    void updateTitleBarVisibilities();
     bool m_inDestructor = false;
     QString m_affinityName;
     DropIndicatorOverlayInterface *m_dropIndicatorOverlay = nullptr;
@@ -23,6 +23,9 @@
 #include "Frame_p.h"
 #include "DropArea_p.h"
 #include "FloatingWindow_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+
+#include <QTimer>
 
 using namespace KDDockWidgets;
 
@@ -34,13 +37,15 @@ DropIndicatorOverlayInterface::DropIndicatorOverlayInterface(DropArea *dropArea)
     setObjectName(QStringLiteral("DropIndicatorOverlayInterface"));
 }
 
-void DropIndicatorOverlayInterface::setWindowBeingDragged(const FloatingWindow *window)
+void DropIndicatorOverlayInterface::setWindowBeingDragged(const QWidgetOrQuick *window)
 {
     if (window != m_windowBeingDragged) {
+        clearDropRectCache();
         m_windowBeingDragged = window;
         if (m_windowBeingDragged) {
             setGeometry(m_dropArea->rect());
             raise();
+            schedulePrecomputeDropRects();
         } else {
             setHoveredFrame(nullptr);
         }
@@ -62,6 +67,40 @@ void DropIndicatorOverlayInterface::setHoveredFrame(Frame *frame)
         updateVisibility();
         Q_EMIT hoveredFrameChanged(m_hoveredFrame);
         onHoveredFrameChanged(m_hoveredFrame);
+        schedulePrecomputeDropRects();
+    }
+}
+
+void DropIndicatorOverlayInterface::schedulePrecomputeDropRects()
+{
+    if (m_precomputeDropRectsPending)
+        return;
+
+    // Not right away, the first hover over a new frame shouldn't wait for the locations it isn't over
+    m_precomputeDropRectsPending = true;
+    QTimer::singleShot(0, this, [this] {
+        m_precomputeDropRectsPending = false;
+        precomputeDropRects();
+    });
+}
+
+void DropIndicatorOverlayInterface::precomputeDropRects()
+{
+    if (!m_windowBeingDragged)
+        return;
+
+    static const KDDockWidgets::Location locations[] = { Location_OnLeft, Location_OnTop,
+                                                         Location_OnRight, Location_OnBottom };
+
+    // rectForDrop() memoizes, hovering between indicators then never touches the layout engine
+    if (m_hoveredFrame) {
+        for (KDDockWidgets::Location location : locations)
+            rectForDrop(location, m_hoveredFrame);
+    }
+
+    if (!(m_hoveredFrame && m_hoveredFrame->isTheOnlyFrame())) {
+        for (KDDockWidgets::Location location : locations)
+            rectForDrop(location, nullptr);
     }
 }
 
@@ -96,9 +135,47 @@ KDDockWidgets::Location DropIndicatorOverlayInterface::multisplitterLocationFor(
 
 void DropIndicatorOverlayInterface::onFrameDestroyed()
 {
+    // Don't keep entries for a dangling pointer, which could be reused by a new frame
+    clearDropRectCache();
     setHoveredFrame(nullptr);
 }
 
+void DropIndicatorOverlayInterface::clearDropRectCache()
+{
+    m_dropRectCache.clear();
+    m_dropRectCacheGeneration = -1;
+}
+
+QRect DropIndicatorOverlayInterface::rectForDrop(KDDockWidgets::Location location, const Frame *relativeTo)
+{
+    MultiSplitterLayout *layout = m_dropArea->multiSplitterLayout();
+    if (!m_windowBeingDragged)
+        return {};
+
+    // Items don't move during a drag, unless the layout itself changes. Resizing the layout, moving a separator,
+    // or changing its topology or min-sizes invalidates everything.
+    // Not keyed on DockRegistry::layoutGeneration(), which is bumped by each move of the window being dragged.
+    const QSize windowSize = m_windowBeingDragged->size();
+    if (m_dropRectCacheGeneration != layout->sizeConstraintsGeneration() ||
+        m_dropRectCacheAnchorPositionsGeneration != layout->anchorPositionsGeneration() ||
+        m_dropRectCacheLayoutSize != layout->size() || m_dropRectCacheWindowSize != windowSize) {
+        m_dropRectCache.clear();
+        m_dropRectCacheGeneration = layout->sizeConstraintsGeneration();
+        m_dropRectCacheAnchorPositionsGeneration = layout->anchorPositionsGeneration();
+        m_dropRectCacheLayoutSize = layout->size();
+        m_dropRectCacheWindowSize = windowSize;
+    }
+
+    const QPair<const Frame*, int> key(relativeTo, location);
+    auto it = m_dropRectCache.constFind(key);
+    if (it != m_dropRectCache.cend())
+        return *it;
+
+    const QRect rect = layout->rectForDrop(m_windowBeingDragged, location, layout->itemForFrame(relativeTo));
+    m_dropRectCache.insert(key, rect);
+    return rect;
+}
+
 void DropIndicatorOverlayInterface::onHoveredFrameChanged(Frame *)
 {
 
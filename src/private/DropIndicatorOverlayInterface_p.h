@@ -26,6 +26,9 @@
 #include "Frame_p.h"
 #include "KDDockWidgets.h"
 
+#include <QHash>
+#include <QPair>
+
 namespace KDDockWidgets {
 
 class FloatingWindow;
@@ -38,7 +41,8 @@ public:
     enum Type {
         TypeNone = 0,
         TypeClassic = 1,
-        TypeAnimated = 2
+        TypeAnimated = 2,
+        TypeOverlay = 3
     };
     Q_ENUM(Type)
 
@@ -58,7 +62,8 @@ public:
 
     explicit DropIndicatorOverlayInterface(DropArea *dropArea);
     void setHoveredFrame(Frame *);
-    void setWindowBeingDragged(const FloatingWindow *);
+    ///@brief Sets the window being dragged. Or the dock widget, when only a ghost of it is being dragged. See Config::Flag_GhostTabDrag
+    void setWindowBeingDragged(const QWidgetOrQuick *);
     bool isHovered() const;
     DropLocation currentDropLocation() const { return m_currentDropLocation; }
     Frame *hoveredFrame() const { return m_hoveredFrame; }
@@ -69,6 +74,9 @@ public:
 
     virtual QPoint posForIndicator(DropLocation) const = 0; // Used by unit-tests only
 
+    ///@brief Creates any native windows the indicators need, so the first hover doesn't pay for it
+    virtual void warmUp() {}
+
     static KDDockWidgets::Location multisplitterLocationFor(DropLocation);
 
 Q_SIGNALS:
@@ -76,13 +84,39 @@ Q_SIGNALS:
 
 private:
     void onFrameDestroyed();
+    void clearDropRectCache();
+
+    ///@brief Schedules precomputeDropRects() for when the event loop is idle. Called when a drag enters us or hovers another frame
+    void schedulePrecomputeDropRects();
+
+    ///@brief Fills the rectForDrop() memo for every location of the hovered frame and the outter ones, in one pass
+    void precomputeDropRects();
+    bool m_precomputeDropRectsPending = false;
+
+    // Memo for rectForDrop(), only valid during the current drag.
+    // Keyed by relativeTo frame (nullptr for outter locations) and location.
+    QHash<QPair<const Frame*, int>, QRect> m_dropRectCache;
+    QSize m_dropRectCacheWindowSize;
+    QSize m_dropRectCacheLayoutSize;
+    int m_dropRectCacheGeneration = -1;
+    int m_dropRectCacheAnchorPositionsGeneration = -1;
+
+public:
+    /**
+     * @brief Returns MultiSplitterLayout::rectForDrop() for the window being dragged.
+     *
+     * The result only depends on the hovered frame, the location and the size of the dragged window,
+     * so it's memoized until the drag ends or the layout changes. Public for unit-tests.
+     */
+    QRect rectForDrop(KDDockWidgets::Location location, const Frame *relativeTo);
 
 protected:
+
     virtual void onHoveredFrameChanged(Frame *);
     virtual void updateVisibility() = 0;
     Frame *m_hoveredFrame = nullptr;
     DropLocation m_currentDropLocation = DropLocation_None;
-    QPointer<const FloatingWindow> m_windowBeingDragged;
+    QPointer<const QWidgetOrQuick> m_windowBeingDragged;
     DropArea *const m_dropArea;
 };
 }
@@ -0,0 +1,74 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief The events KDDockWidgets::EventLog records, and the macro to record them.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_EVENTLOG_P_H
+#define KD_DOCKWIDGETS_EVENTLOG_P_H
+
+#include "EventLog.h"
+
+#include <QtGlobal>
+
+namespace KDDockWidgets {
+
+/**
+ * @brief The ids written to the event log. Only append, as the ids are what the dumps contain.
+ * The comments say what the object and the two arguments are.
+ */
+enum class LogEvent : quint16 {
+    DockWidgetShown = 1, ///< DockWidgetBase
+    DockWidgetHidden, ///< DockWidgetBase
+    DockWidgetFloated, ///< DockWidgetBase, whether it's floating now
+    FloatingWindowCreated, ///< FloatingWindow
+    FloatingWindowDestroyed, ///< FloatingWindow
+    WidgetAdded, ///< MultiSplitterLayout, the Location, the AddingOption
+    WindowDropped, ///< DropArea, the DropIndicatorOverlayInterface::DropLocation
+    DockWidgetDropped, ///< DropArea, the DropIndicatorOverlayInterface::DropLocation
+    LayoutResized, ///< MultiSplitterLayout, the new width and height
+    AnchorCreated, ///< Anchor, the orientation
+    AnchorDestroyed, ///< Anchor
+    AnchorMoved, ///< Anchor, the old and new position
+    PlaceholderAdded, ///< Item, i.e. the placeholder a LastPosition now references
+    PlaceholderRemoved, ///< Item, i.e. the placeholder a LastPosition no longer references
+    PlaceholderRestored, ///< Item
+    PlaceholdersDropped, ///< MultiSplitterLayout, how many were dropped
+    DragStateEntered, ///< DragController, the state: 0 none, 1 pre-drag, 2 dragging
+    RestoreStarted, ///< nullptr
+    RestoreFinished, ///< nullptr, whether it succeeded
+    Count ///< Not an event, just the number of them
+};
+
+///@brief Whether EventLog is recording. Read inline by KDDW_LOG_EVENT() so not recording costs a branch
+extern bool g_eventLogRecording;
+
+///@brief Appends an event to the ring buffer, overwriting the oldest one if it's full
+void recordEvent(LogEvent event, const void *object, qint32 arg1 = 0, qint32 arg2 = 0);
+
+}
+
+#define KDDW_LOG_EVENT(...) do { if (Q_UNLIKELY(KDDockWidgets::g_eventLogRecording)) KDDockWidgets::recordEvent(__VA_ARGS__); } while (false)
+
+#endif
@@ -21,6 +21,7 @@
 #include "FloatingWindow_p.h"
 #include "MainWindowBase.h"
 #include "Logging_p.h"
+#include "EventLog_p.h"
 #include "Frame_p.h"
 #include "DragController_p.h"
 #include "multisplitter/MultiSplitterLayout_p.h"
@@ -37,6 +38,7 @@
 #include <QPainter>
 #include <QAbstractNativeEventFilter>
 #include <QWindow>
+#include <QScopedValueRollback>
 
 #ifdef Q_OS_WIN
 # include <Windows.h>
@@ -104,6 +106,7 @@ FloatingWindow::FloatingWindow(MainWindowBase *parent)
 
     DockRegistry::self()->registerNestedWindow(this);
     qCDebug(creation) << "FloatingWindow()" << this;
+    KDDW_LOG_EVENT(LogEvent::FloatingWindowCreated, this);
 
 #ifdef Q_OS_WIN
 # if QT_VERSION < 0x051000
@@ -119,7 +122,15 @@ FloatingWindow::FloatingWindow(MainWindowBase *parent)
     connect(ms, &MultiSplitterLayout::visibleWidgetCountChanged, this, &FloatingWindow::onFrameCountChanged);
     connect(ms, &MultiSplitterLayout::visibleWidgetCountChanged, this, &FloatingWindow::numFramesChanged);
     connect(ms, &MultiSplitterLayout::visibleWidgetCountChanged, this, &FloatingWindow::onVisibleFrameCountChanged);
-    m_layoutDestroyedConnection = connect(ms, &MultiSplitterLayout::destroyed, this, &FloatingWindow::scheduleDeleteLater);
+    m_layoutDestroyedConnection = connect(ms, &MultiSplitterLayout::destroyed, this, [this] {
+        scheduleDeleteLater(/*allowRecycling=*/false);
+    });
+
+    // Minimizing doesn't hide the dock widgets, but nobody sees them anymore
+    connect(this, &FloatingWindow::windowStateChanged, this, [this] {
+        for (DockWidgetBase *dw : multiSplitterLayout()->dockWidgets())
+            dw->updateEffectiveVisibility();
+    });
 }
 
 static MainWindowBase* hackFindParentHarder(Frame *frame, MainWindowBase *candidateParent)
@@ -171,6 +182,11 @@ static MainWindowBase* hackFindParentHarder(Frame *frame, MainWindowBase *candid
 
 FloatingWindow::FloatingWindow(Frame *frame, MainWindowBase *parent)
     : FloatingWindow(hackFindParentHarder(frame, parent))
+{
+    addInitialFrame(frame);
+}
+
+void FloatingWindow::addInitialFrame(Frame *frame)
 {
     m_disableSetVisible = true;
     // Adding a widget will trigger onFrameCountChanged, which triggers a setVisible(true).
@@ -180,6 +196,43 @@ FloatingWindow::FloatingWindow(Frame *frame, MainWindowBase *parent)
     m_disableSetVisible = false;
 }
 
+FloatingWindow *FloatingWindow::takeRecycled(MainWindowBase *parent)
+{
+    FloatingWindow *fw = DockRegistry::self()->takeRecycledFloatingWindow(parent);
+    if (fw) {
+        qCDebug(creation) << "FloatingWindow: reusing" << fw;
+        fw->m_beingDeleted = false;
+        fw->resetForReuse();
+        DockRegistry::self()->registerNestedWindow(fw);
+    }
+
+    return fw;
+}
+
+FloatingWindow *FloatingWindow::takeRecycled(Frame *frame, MainWindowBase *parent)
+{
+    FloatingWindow *fw = takeRecycled(hackFindParentHarder(frame, parent));
+    if (fw)
+        fw->addInitialFrame(frame);
+
+    return fw;
+}
+
+void FloatingWindow::resetForReuse()
+{
+    // Don't show up where, and with the size, the previous user left it. The affinity
+    // isn't stored, it comes from the frames, and takeRecycled() already matched the parent.
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    setWindowState(Qt::WindowNoState);
+    setAttribute(Qt::WA_Moved, false);
+    setAttribute(Qt::WA_Resized, false);
+    setWindowTitle(QString());
+    setWindowIcon(QIcon());
+#endif
+    m_titleBar->setTitle(QString());
+    m_titleBar->setIcon(QIcon());
+}
+
 FloatingWindow::~FloatingWindow()
 {
     disconnect(m_layoutDestroyedConnection);
@@ -187,6 +240,7 @@ FloatingWindow::~FloatingWindow()
 
     DockRegistry::self()->unregisterNestedWindow(this);
     qCDebug(creation) << "~FloatingWindow";
+    KDDW_LOG_EVENT(LogEvent::FloatingWindowDestroyed, this);
 }
 
 #if defined(Q_OS_WIN)
@@ -200,6 +254,20 @@ bool FloatingWindow::nativeEvent(const QByteArray &eventType, void *message, lon
 
     return QWidget::nativeEvent(eventType, message, result);
 }
+
+QRect FloatingWindow::titleBarRectForHitTest() const
+{
+    const QSize windowSize = size();
+    const bool titleBarVisible = m_titleBar->isVisible();
+    if (windowSize != m_hitTestCache.windowSize || titleBarVisible != m_hitTestCache.titleBarVisible) {
+        m_hitTestCache.windowSize = windowSize;
+        m_hitTestCache.titleBarVisible = titleBarVisible;
+        m_hitTestCache.titleBarRect = titleBarVisible ? QRect(m_titleBar->mapTo(this, QPoint(0, 0)), m_titleBar->size())
+                                                      : QRect();
+    }
+
+    return m_hitTestCache.titleBarRect;
+}
 #endif
 
 void FloatingWindow::maybeCreateResizeHandler()
@@ -222,11 +290,15 @@ const Frame::List FloatingWindow::frames() const
     return findChildren<Frame *>(QString(), Qt::FindChildrenRecursively);
 }
 
-void FloatingWindow::scheduleDeleteLater()
+void FloatingWindow::scheduleDeleteLater(bool allowRecycling)
 {
     m_beingDeleted = true;
     DockRegistry::self()->unregisterNestedWindow(this);
-    deleteLater();
+
+    if (allowRecycling && DockRegistry::self()->recycleFloatingWindow(this))
+        return; // Hidden and kept for reuse. See Config::setFloatingWindowPoolSize()
+
+    DockRegistry::self()->scheduleDelete(this);
 }
 
 MultiSplitterLayout *FloatingWindow::multiSplitterLayout() const
@@ -345,6 +417,12 @@ QString FloatingWindow::affinityName() const
     return frames.isEmpty() ? QString() : frames.constFirst()->affinityName();
 }
 
+int FloatingWindow::affinityId() const
+{
+    auto frames = this->frames();
+    return frames.isEmpty() ? 0 : frames.constFirst()->affinityId();
+}
+
 void FloatingWindow::updateTitleAndIcon()
 {
     QString title;
@@ -387,12 +465,9 @@ void FloatingWindow::onCloseEvent(QCloseEvent *e)
 
 bool FloatingWindow::deserialize(const LayoutSaver::FloatingWindow &fw)
 {
-    if (dropArea()->multiSplitterLayout()->deserialize(fw.multiSplitterLayout)) {
-        show();
-        return true;
-    } else {
-        return false;
-    }
+    // Adding the frames would show us, see onVisibleFrameCountChanged()
+    QScopedValueRollback<bool> disableSetVisible(m_disableSetVisible, true);
+    return dropArea()->multiSplitterLayout()->deserialize(fw.multiSplitterLayout);
 }
 
 LayoutSaver::FloatingWindow FloatingWindow::serialize() const
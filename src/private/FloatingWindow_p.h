@@ -48,6 +48,7 @@ public:
     explicit FloatingWindow(Frame *frame, MainWindowBase *parent = nullptr);
     ~FloatingWindow() override;
 
+    ///@brief Restores the nested layout. The window is left hidden, the caller shows it once everything is restored
     bool deserialize(const LayoutSaver::FloatingWindow &);
     LayoutSaver::FloatingWindow serialize() const;
 
@@ -90,8 +91,21 @@ public:
 
     /**
      * @brief Equivalent to deleteLater() but sets beingDeleted() to true
+     *
+     * If @p allowRecycling is true and the pool isn't full, the window is hidden and kept
+     * for reuse instead. See Config::setFloatingWindowPoolSize().
      */
-    void scheduleDeleteLater();
+    void scheduleDeleteLater(bool allowRecycling = true);
+
+    /**
+     * @brief Returns a hidden FloatingWindow from the recycling pool, or nullptr if there's none for @p parent.
+     * The returned window is as if it was just constructed with the same arguments.
+     * @sa Config::setFloatingWindowPoolSize()
+     */
+    static FloatingWindow *takeRecycled(MainWindowBase *parent);
+
+    ///@overload
+    static FloatingWindow *takeRecycled(Frame *frame, MainWindowBase *parent);
 
     /**
      * @brief Returns the MultiSplitterLayout
@@ -112,6 +126,17 @@ public:
     void updateTitleBarVisibility();
 
     QString affinityName() const;
+    int affinityId() const;
+
+#ifdef Q_OS_WIN
+    /**
+     * @brief Returns the title bar's rect in window coordinates, or an empty rect if it's hidden.
+     *
+     * Windows sends WM_NCHITTEST continuously while the mouse moves, so this is cached until the
+     * window is resized or the title bar is shown or hidden. See WidgetResizeHandler::handleWindowsNativeEvent()
+     */
+    QRect titleBarRectForHitTest() const;
+#endif
 
 Q_SIGNALS:
     void numFramesChanged();
@@ -128,12 +153,24 @@ protected:
 private:
     Q_DISABLE_COPY(FloatingWindow)
     void maybeCreateResizeHandler();
+    void addInitialFrame(Frame *frame);
+    void resetForReuse();
     void onFrameCountChanged(int count);
     void onVisibleFrameCountChanged(int count);
     bool m_disableSetVisible = false;
     bool m_beingDeleted = false;
     QMetaObject::Connection m_layoutDestroyedConnection;
     QAbstractNativeEventFilter *m_nchittestFilter = nullptr;
+
+#ifdef Q_OS_WIN
+    // See titleBarRectForHitTest()
+    struct HitTestCache {
+        QSize windowSize;
+        bool titleBarVisible = false;
+        QRect titleBarRect;
+    };
+    mutable HitTestCache m_hitTestCache;
+#endif
 };
 
 }
@@ -60,7 +60,6 @@ static FrameOptions actualOptions(FrameOptions options)
 Frame::Frame(QWidgetOrQuick *parent, FrameOptions options)
     : QWidgetAdapter(parent)
     , m_tabWidget(Config::self().frameworkWidgetFactory()->createTabWidget(this))
-    , m_titleBar(Config::self().frameworkWidgetFactory()->createTitleBar(this))
     , m_options(actualOptions(options))
 {
     s_dbg_numFrames++;
@@ -85,11 +84,79 @@ Frame::~Frame()
     setDropArea(nullptr);
 }
 
+QRect Frame::geometry() const
+{
+    return QWidgetAdapter::geometry();
+}
+
+void Frame::setGeometry(QRect geo)
+{
+    QWidgetAdapter::setGeometry(geo);
+
+    // The layout might have collapsed us, or given us room again
+    for (int i = 0, count = dockWidgetCount(); i < count; ++i)
+        dockWidgetAt(i)->updateEffectiveVisibility();
+}
+
+QSize Frame::minSize() const
+{
+    if (m_minSize.isValid())
+        return m_minSize;
+
+    // If every dock widget declared its size there's no need to ask the widgets
+    QSize declaredMinSize(0, 0);
+    const QVector<DockWidgetBase *> docks = dockWidgets();
+    for (DockWidgetBase *dw : docks) {
+        const QSize sz = dw->layoutMinimumSize();
+        if (!sz.isValid()) {
+            declaredMinSize = QSize();
+            break;
+        }
+        declaredMinSize = declaredMinSize.expandedTo(sz);
+    }
+
+    if (!docks.isEmpty() && declaredMinSize.isValid()) {
+        m_minSize = declaredMinSize.expandedTo(MultiSplitterLayout::hardcodedMinimumSize());
+    } else {
+        m_minSize = QSize(widgetMinLength(this, Qt::Vertical),
+                          widgetMinLength(this, Qt::Horizontal));
+    }
+
+    return m_minSize;
+}
+
+void Frame::invalidateMinSize()
+{
+    m_minSize = QSize();
+
+    // Coalesced, so inserting many tabs in a row only updates the layout's constraints once
+    if (m_layoutInvalidatedPending)
+        return;
+
+    m_layoutInvalidatedPending = true;
+    QTimer::singleShot(0, this, [this] {
+        m_layoutInvalidatedPending = false;
+        Q_EMIT layoutInvalidated();
+    });
+}
+
+bool Frame::isVisible() const
+{
+    return QWidgetAdapter::isVisible();
+}
+
+void Frame::setVisible(bool is)
+{
+    QWidgetAdapter::setVisible(is);
+}
+
 void Frame::updateTitleAndIcon()
 {
     if (DockWidgetBase *dw = currentDockWidget()) {
-        m_titleBar->setTitle(dw->title());
-        m_titleBar->setIcon(dw->icon());
+        if (m_titleBar) {
+            m_titleBar->setTitle(dw->title());
+            m_titleBar->setIcon(dw->icon());
+        }
 
         if (auto fw = floatingWindow()) {
             if (fw->hasSingleFrame()) {
@@ -144,6 +211,9 @@ void Frame::insertWidget(DockWidgetBase *dockWidget, int index, AddingOption add
 
     m_tabWidget->insertDockWidget(dockWidget, index);
 
+    if (isInBatchInsert() && addingOption != AddingOption_StartHidden)
+        m_batchLastInserted = dockWidget;
+
     if (addingOption == AddingOption_StartHidden) {
         dockWidget->close(); // Ensure closed
     } else {
@@ -164,6 +234,32 @@ void Frame::insertWidget(DockWidgetBase *dockWidget, int index, AddingOption add
     connect(dockWidget, &DockWidgetBase::iconChanged, this, &Frame::updateTitleAndIcon);
 }
 
+void Frame::beginBatchInsert()
+{
+    ++m_batchInsertDepth;
+}
+
+void Frame::endBatchInsert()
+{
+    Q_ASSERT(m_batchInsertDepth > 0);
+    if (--m_batchInsertDepth > 0)
+        return;
+
+    if (m_batchLastInserted) {
+        const int index = m_tabWidget->indexOfDockWidget(m_batchLastInserted);
+        m_batchLastInserted = nullptr;
+        if (index != currentTabIndex())
+            setCurrentTabIndex(index);
+        else
+            onCurrentTabChanged(index); // Was skipped during the batch
+    }
+
+    if (m_batchCountChanged) {
+        m_batchCountChanged = false;
+        onDockWidgetCountChanged();
+    }
+}
+
 void Frame::removeWidget(DockWidgetBase *dw)
 {
     disconnect(dw, &DockWidgetBase::titleChanged, this, &Frame::updateTitleAndIcon);
@@ -173,7 +269,13 @@ void Frame::removeWidget(DockWidgetBase *dw)
 
 void Frame::onDockWidgetCountChanged()
 {
+    if (isInBatchInsert()) {
+        m_batchCountChanged = true;
+        return;
+    }
+
     qCDebug(docking) << "Frame::onDockWidgetCountChanged:" << this << "; widgetCount=" << dockWidgetCount();
+    invalidateMinSize();
     if (isEmpty() && !isCentralFrame()) {
         scheduleDeleteLater();
     } else {
@@ -189,16 +291,43 @@ void Frame::onDockWidgetCountChanged()
 
 void Frame::onCurrentTabChanged(int index)
 {
+    if (isInBatchInsert())
+        return; // endBatchInsert() makes the last inserted dock widget current
+
+    invalidateMinSize();
     if (index != -1) {
         if (auto dock = dockWidgetAt(index)) {
+            // For dock widgets with a WidgetCreatorFunc only the visible tab gets its widget.
+            // If we're hidden, like while restoring, it's created in DockWidgetBase::onShown() instead.
+            if (isVisible())
+                dock->ensureWidgetCreated();
             Q_EMIT currentDockWidgetChanged(dock);
         } else {
             qWarning() << "dockWidgetAt" << index << "returned nullptr" << this;
         }
     }
+
+    for (int i = 0, count = dockWidgetCount(); i < count; ++i)
+        dockWidgetAt(i)->updateEffectiveVisibility();
 }
 
 void Frame::updateTitleBarVisibility()
+{
+    updateOwnTitleBarVisibility();
+    if (auto fw = floatingWindow())
+        fw->updateTitleBarVisibility();
+}
+
+void Frame::updateOwnTitleBarVisibility()
+{
+    const bool visible = titleBarShouldBeVisible();
+
+    // Don't create a title bar just to hide it
+    if (visible || m_titleBar)
+        titleBar()->setVisible(visible);
+}
+
+bool Frame::titleBarShouldBeVisible() const
 {
     bool visible = false;
     if (isCentralFrame()) {
@@ -206,15 +335,14 @@ void Frame::updateTitleBarVisibility()
     } else if ((Config::self().flags() & Config::Flag_HideTitleBarWhenTabsVisible) && hasTabsVisible()) {
         visible = false;
     } else if (FloatingWindow *fw = floatingWindow()) {
-        // If there's nested frames then show each Frame's title bar
-        visible = !fw->hasSingleFrame();
+        // If there's nested frames then show each Frame's title bar.
+        // Not using hasSingleFrame(), as we might not be in the layout yet, we'll be the single one then.
+        visible = fw->frames().size() > 1;
     } else {
         visible = true;
     }
 
-    m_titleBar->setVisible(visible);
-    if (auto fw = floatingWindow())
-        fw->updateTitleBarVisibility();
+    return visible;
 }
 
 bool Frame::containsMouse(QPoint globalPos) const
@@ -224,6 +352,20 @@ bool Frame::containsMouse(QPoint globalPos) const
 
 TitleBar *Frame::titleBar() const
 {
+    if (!m_titleBar) {
+        auto that = const_cast<Frame*>(this);
+        m_titleBar = Config::self().frameworkWidgetFactory()->createTitleBar(that);
+        if (DockWidgetBase *dw = currentDockWidget()) {
+            m_titleBar->setTitle(dw->title());
+            m_titleBar->setIcon(dw->icon());
+        }
+
+        that->onTitleBarCreated(m_titleBar);
+
+        // Explicit, otherwise it would just follow the frame's visibility
+        m_titleBar->setVisible(titleBarShouldBeVisible());
+    }
+
     return m_titleBar;
 }
 
@@ -240,12 +382,20 @@ TitleBar *Frame::actualTitleBar() const
 
 QString Frame::title() const
 {
-    return m_titleBar->title();
+    if (m_titleBar)
+        return m_titleBar->title();
+
+    DockWidgetBase *dw = currentDockWidget();
+    return dw ? dw->title() : QString();
 }
 
 QIcon Frame::icon() const
 {
-    return m_titleBar->icon();
+    if (m_titleBar)
+        return m_titleBar->icon();
+
+    DockWidgetBase *dw = currentDockWidget();
+    return dw ? dw->icon() : QIcon();
 }
 
 const DockWidgetBase::List Frame::dockWidgets() const
@@ -430,6 +580,11 @@ QString Frame::affinityName() const
     }
 }
 
+int Frame::affinityId() const
+{
+    return isEmpty() ? 0 : dockWidgetAt(0)->affinityId();
+}
+
 DockWidgetBase *Frame::dockWidgetAt(int index) const
 {
     return qobject_cast<DockWidgetBase *>(m_tabWidget->dockwidgetAt(index));
@@ -440,15 +595,10 @@ void Frame::setDropArea(DropArea *dt)
     if (dt != m_dropArea) {
         qCDebug(docking) << "Frame::setDropArea dt=" << dt;
         const bool wasInMainWindow = dt && isInMainWindow();
-        if (m_dropArea)
-            disconnect(m_visibleWidgetCountChangedConnection);
-
         m_dropArea = dt;
 
         if (m_dropArea) {
-            // We keep the connect result so we don't dereference m_dropArea at shutdown
-            m_visibleWidgetCountChangedConnection = connect(m_dropArea->multiSplitterLayout(), &MultiSplitterLayout::visibleWidgetCountChanged,
-                                                            this, &Frame::updateTitleBarVisibility);
+            // Later visible count changes are handled by DropArea::updateTitleBarVisibilities(), for all frames at once
             updateTitleBarVisibility();
             if (wasInMainWindow != isInMainWindow())
                 Q_EMIT isInMainWindowChanged();
@@ -490,6 +640,7 @@ bool Frame::event(QEvent *e)
 {
     if (e->type() == QEvent::ParentChange) {
         qCDebug(docking) << "Frame: parent changed to =" << parentWidget();
+        Q_EMIT reparented();
         if (auto dropArea = qobject_cast<DropArea *>(parentWidget())) {
             setDropArea(dropArea);
         } else {
@@ -540,9 +691,6 @@ void Frame::scheduleDeleteLater()
 {
     qCDebug(creation) << Q_FUNC_INFO << this;
     m_beingDeleted = true;
-    QTimer::singleShot(0, this, [this] {
-        // Can't use deleteLater() here due to QTBUG-83030 (deleteLater() never delivered if triggered by a sendEvent() before event loop starts)
-        delete this;
-    });
+    DockRegistry::self()->scheduleDelete(this);
 }
 
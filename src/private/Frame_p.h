@@ -31,6 +31,7 @@
 #include "docks_export.h"
 #include "QWidgetAdapter.h"
 #include "LayoutSaver_p.h"
+#include "multisplitter/Sizable_p.h"
 
 #include <QWidget>
 #include <QVector>
@@ -56,7 +57,7 @@ class FloatingWindow;
  * inside a MultiSplitter (DropArea). Be it a MultiSplitter belonging to a MainWindow or belonging
  * to a FloatingWindow.
  */
-class DOCKS_EXPORT Frame : public QWidgetAdapter
+class DOCKS_EXPORT Frame : public QWidgetAdapter, public Sizable
 {
     Q_OBJECT
 
@@ -67,6 +68,22 @@ public:
     explicit Frame(QWidgetOrQuick *parent = nullptr, FrameOptions = FrameOption_None);
     ~Frame() override;
 
+    // Sizable
+    QRect geometry() const override;
+    void setGeometry(QRect) override;
+    QSize minSize() const override;
+
+    /**
+     * @brief Forgets the cached minSize(), so it's queried again next time.
+     * Emits layoutInvalidated() on the next event loop iteration, once per burst of invalidations.
+     *
+     * Until then the Item, and the layout's constraints, still have the previous min size.
+     * Code that needs the new value right away must read minSize(), or call Item::onLayoutRequest().
+     */
+    void invalidateMinSize();
+    bool isVisible() const override;
+    void setVisible(bool) override;
+
     static Frame *deserialize(const LayoutSaver::Frame &);
     LayoutSaver::Frame serialize() const;
 
@@ -83,10 +100,29 @@ public:
     ///@brief removes a dockwidget from the frame
     void removeWidget(DockWidgetBase *);
 
+    /**
+     * @brief Starts inserting many dock widgets in a row. See MainWindowBase::addDockWidgetsAsTab()
+     *
+     * Until the matching @ref endBatchInsert() inserted tabs don't become current, so their guest widget
+     * isn't shown or created, and the title, title bar and min-size updates are skipped.
+     * They're done once, when the batch ends, and the last inserted dock widget becomes current then.
+     * Batches can be nested.
+     */
+    void beginBatchInsert();
+    void endBatchInsert();
+
+    ///@brief returns whether we're inside a @ref beginBatchInsert() / @ref endBatchInsert() pair
+    bool isInBatchInsert() const { return m_batchInsertDepth > 0; }
+
     void updateTitleAndIcon();
+
+    ///@brief Updates the visibility of this frame's title bar, and of its floating window's title bar
     void updateTitleBarVisibility();
     bool containsMouse(QPoint globalPos) const;
+    ///@brief Returns the title bar, creating it if needed. Frames whose title bar is never shown don't have one.
     TitleBar *titleBar() const;
+    ///@brief Returns whether titleBar() was called already, without creating it
+    bool hasTitleBar() const { return m_titleBar != nullptr; }
     TitleBar *actualTitleBar() const;
     TabWidget *tabWidget() const;
     QString title() const;
@@ -203,6 +239,7 @@ public:
     bool hasTabsVisible() const;
 
     QString affinityName() const;
+    int affinityId() const;
 
 Q_SIGNALS:
     void currentDockWidgetChanged(KDDockWidgets::DockWidgetBase *);
@@ -211,21 +248,45 @@ Q_SIGNALS:
     void layoutInvalidated();
     void isInMainWindowChanged();
 
+    ///@brief emitted when the frame's parent changed. The layout Item uses it instead of an event filter.
+    void reparented();
+
+    ///@brief emitted when the user reordered a tab. No dock widget was removed, inserted, shown or hidden
+    void tabMoved(int from, int to);
+
+protected:
+    ///@brief Called when the lazily created title bar is created, so the GUI can lay it out
+    virtual void onTitleBarCreated(TitleBar *) {}
+
 private:
     Q_DISABLE_COPY(Frame)
     friend class TestDocks;
     friend class TabWidget;
+    friend class DropArea;
+
+    ///@brief Like updateTitleBarVisibility() but doesn't update the floating window
+    void updateOwnTitleBarVisibility();
+    bool titleBarShouldBeVisible() const;
     void onDockWidgetCountChanged();
     void onCurrentTabChanged(int index);
     void scheduleDeleteLater();
     bool event(QEvent *) override;
     TabWidget *const m_tabWidget;
-    TitleBar *const m_titleBar;
+    mutable TitleBar *m_titleBar = nullptr; // See titleBar()
     DropArea *m_dropArea = nullptr;
     const FrameOptions m_options;
     QPointer<Item> m_layoutItem;
     bool m_beingDeleted = false;
-    QMetaObject::Connection m_visibleWidgetCountChangedConnection;
+
+    // Cache for minSize(), invalid when it needs to be queried again.
+    // Querying goes through minimumSizeHint() of the whole guest widget tree.
+    mutable QSize m_minSize;
+    bool m_layoutInvalidatedPending = false;
+
+    // See beginBatchInsert()
+    int m_batchInsertDepth = 0;
+    bool m_batchCountChanged = false;
+    QPointer<DockWidgetBase> m_batchLastInserted;
 };
 
 }
@@ -0,0 +1,317 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "JsonStreamReader_p.h"
+
+#include <cstring>
+
+using namespace KDDockWidgets;
+
+static bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+JsonStreamReader::JsonStreamReader(const QByteArray &data)
+    : m_data(data)
+{
+}
+
+bool JsonStreamReader::hasError() const
+{
+    return m_error;
+}
+
+bool JsonStreamReader::atEnd()
+{
+    skipWhitespace();
+    return m_pos >= m_data.size();
+}
+
+bool JsonStreamReader::beginObject()
+{
+    return beginContainer('{');
+}
+
+bool JsonStreamReader::nextMember(QString &key)
+{
+    if (!nextInContainer('}'))
+        return false;
+
+    if (peek() != '"') {
+        setError();
+        return false;
+    }
+
+    key = readString();
+    if (!consume(':')) {
+        setError();
+        return false;
+    }
+
+    return !m_error;
+}
+
+bool JsonStreamReader::beginArray()
+{
+    return beginContainer('[');
+}
+
+bool JsonStreamReader::nextElement()
+{
+    return nextInContainer(']');
+}
+
+int JsonStreamReader::readInt()
+{
+    return int(readDouble());
+}
+
+double JsonStreamReader::readDouble()
+{
+    const char c = peek();
+    if (!isNumberChar(c)) {
+        skipValue(); // null, or some unexpected type
+        return 0;
+    }
+
+    const int start = m_pos;
+    while (m_pos < m_data.size() && isNumberChar(m_data.at(m_pos)))
+        ++m_pos;
+
+    bool ok = false;
+    const double value = QByteArray::fromRawData(m_data.constData() + start, m_pos - start).toDouble(&ok);
+    if (!ok) {
+        setError();
+        return 0;
+    }
+
+    return value;
+}
+
+bool JsonStreamReader::readBool()
+{
+    const char c = peek();
+    if (c == 't')
+        return consumeLiteral("true");
+
+    if (c == 'f')
+        consumeLiteral("false");
+    else
+        skipValue();
+
+    return false;
+}
+
+QString JsonStreamReader::readString()
+{
+    if (peek() != '"') {
+        skipValue(); // null, or some unexpected type
+        return {};
+    }
+
+    ++m_pos;
+
+    const char *data = m_data.constData();
+    const int size = m_data.size();
+    QString result;
+    int runStart = m_pos;
+
+    while (m_pos < size) {
+        const char c = data[m_pos];
+        if (c == '"') {
+            result += QString::fromUtf8(data + runStart, m_pos - runStart);
+            ++m_pos;
+            return result;
+        }
+
+        if (c != '\\') {
+            ++m_pos;
+            continue;
+        }
+
+        // An escape sequence. Flush what we have so far.
+        result += QString::fromUtf8(data + runStart, m_pos - runStart);
+        ++m_pos;
+        if (m_pos >= size)
+            break;
+
+        const char escaped = data[m_pos++];
+        switch (escaped) {
+        case '"':
+        case '\\':
+        case '/':
+            result += QLatin1Char(escaped);
+            break;
+        case 'b':
+            result += QLatin1Char('\b');
+            break;
+        case 'f':
+            result += QLatin1Char('\f');
+            break;
+        case 'n':
+            result += QLatin1Char('\n');
+            break;
+        case 'r':
+            result += QLatin1Char('\r');
+            break;
+        case 't':
+            result += QLatin1Char('\t');
+            break;
+        case 'u': {
+            // Surrogate pairs come as two consecutive escapes, which QString will combine
+            bool ok = false;
+            const ushort code = m_pos + 4 <= size ? QByteArray::fromRawData(data + m_pos, 4).toUShort(&ok, 16)
+                                                  : 0;
+            if (!ok) {
+                setError();
+                return {};
+            }
+            result += QChar(code);
+            m_pos += 4;
+            break;
+        }
+        default:
+            setError();
+            return {};
+        }
+
+        runStart = m_pos;
+    }
+
+    // Unterminated string
+    setError();
+    return {};
+}
+
+void JsonStreamReader::skipValue()
+{
+    QString key;
+    switch (peek()) {
+    case '{':
+        beginObject();
+        while (nextMember(key))
+            skipValue();
+        break;
+    case '[':
+        beginArray();
+        while (nextElement())
+            skipValue();
+        break;
+    case '"':
+        readString();
+        break;
+    case 't':
+        consumeLiteral("true");
+        break;
+    case 'f':
+        consumeLiteral("false");
+        break;
+    case 'n':
+        consumeLiteral("null");
+        break;
+    default:
+        if (isNumberChar(peek()))
+            readDouble();
+        else
+            setError();
+        break;
+    }
+}
+
+void JsonStreamReader::skipWhitespace()
+{
+    while (m_pos < m_data.size()) {
+        const char c = m_data.at(m_pos);
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+            return;
+        ++m_pos;
+    }
+}
+
+char JsonStreamReader::peek()
+{
+    skipWhitespace();
+    return m_pos < m_data.size() ? m_data.at(m_pos) : '\0';
+}
+
+bool JsonStreamReader::consume(char c)
+{
+    if (peek() != c)
+        return false;
+
+    ++m_pos;
+    return true;
+}
+
+bool JsonStreamReader::consumeLiteral(const char *literal)
+{
+    const int len = int(strlen(literal));
+    if (m_pos + len > m_data.size() || strncmp(m_data.constData() + m_pos, literal, size_t(len)) != 0) {
+        setError();
+        return false;
+    }
+
+    m_pos += len;
+    return true;
+}
+
+bool JsonStreamReader::beginContainer(char open)
+{
+    if (peek() != open) {
+        skipValue();
+        return false;
+    }
+
+    if (m_firstInContainer.size() >= MaxDepth) {
+        setError();
+        return false;
+    }
+
+    ++m_pos;
+    m_firstInContainer.push_back(true);
+    return true;
+}
+
+bool JsonStreamReader::nextInContainer(char close)
+{
+    if (m_error || m_firstInContainer.isEmpty())
+        return false;
+
+    if (consume(close)) {
+        m_firstInContainer.removeLast();
+        return false;
+    }
+
+    if (m_firstInContainer.last()) {
+        m_firstInContainer.last() = false;
+    } else if (!consume(',')) {
+        setError();
+        return false;
+    }
+
+    return true;
+}
+
+void JsonStreamReader::setError()
+{
+    m_error = true;
+    m_pos = m_data.size();
+}
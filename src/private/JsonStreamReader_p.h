@@ -0,0 +1,110 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief A minimal pull-parser for JSON, so layouts can be restored without building a QJsonDocument.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_JSON_STREAM_READER_P_H
+#define KD_JSON_STREAM_READER_P_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Tokenizes JSON on demand, the caller pulls the values it's interested in.
+ *
+ * Typical usage:
+ *
+ *     if (reader.beginObject()) {
+ *         QString key;
+ *         while (reader.nextMember(key)) {
+ *             if (key == QLatin1String("width"))
+ *                 width = reader.readInt();
+ *             else
+ *                 reader.skipValue();
+ *         }
+ *     }
+ *
+ * On malformed input, or containers nested deeper than MaxDepth, hasError() becomes true and all
+ * subsequent reads return default values.
+ */
+class JsonStreamReader
+{
+public:
+    explicit JsonStreamReader(const QByteArray &data);
+
+    ///@brief returns true if the input was malformed
+    bool hasError() const;
+
+    ///@brief returns true if there's nothing but whitespace left to read
+    bool atEnd();
+
+    ///@brief consumes an '{'. Returns false if the next value isn't an object, in which case it's skipped.
+    bool beginObject();
+
+    ///@brief Reads the next key of the current object, with the reader positioned at its value.
+    /// Returns false, and consumes the closing '}', when there are no more members.
+    bool nextMember(QString &key);
+
+    ///@brief consumes an '['. Returns false if the next value isn't an array, in which case it's skipped.
+    bool beginArray();
+
+    ///@brief Returns true if the current array has another element, with the reader positioned at it.
+    /// Returns false, and consumes the closing ']', when there are no more elements.
+    bool nextElement();
+
+    int readInt();
+    double readDouble();
+    bool readBool();
+    QString readString();
+
+    ///@brief skips the next value, whatever its type
+    void skipValue();
+
+private:
+    void skipWhitespace();
+    char peek();
+    bool consume(char c);
+    bool consumeLiteral(const char *literal);
+    bool beginContainer(char open);
+    bool nextInContainer(char close);
+    void setError();
+
+    const QByteArray m_data;
+    int m_pos = 0;
+    bool m_error = false;
+
+    // Deeper input is refused, as skipValue() recurses once per level
+    static const int MaxDepth = 512;
+
+    // Whether the container at each nesting level didn't have any member yet, so we know when to expect a comma
+    QVector<bool> m_firstInContainer;
+};
+
+}
+
+#endif
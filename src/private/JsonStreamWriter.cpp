@@ -0,0 +1,171 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "JsonStreamWriter_p.h"
+
+#include <QLocale>
+#include <QtNumeric>
+
+using namespace KDDockWidgets;
+
+void JsonStreamWriter::beginObject()
+{
+    beginContainer('{');
+}
+
+void JsonStreamWriter::endObject()
+{
+    endContainer('}');
+}
+
+void JsonStreamWriter::beginArray()
+{
+    beginContainer('[');
+}
+
+void JsonStreamWriter::endArray()
+{
+    endContainer(']');
+}
+
+void JsonStreamWriter::writeKey(const char *key)
+{
+    beginValue();
+    m_data += '"';
+    m_data += key;
+    m_data += "\": ";
+    m_afterKey = true;
+}
+
+void JsonStreamWriter::writeInt(int value)
+{
+    beginValue();
+    m_data += QByteArray::number(value);
+}
+
+void JsonStreamWriter::writeDouble(double value)
+{
+    beginValue();
+
+    // Same as QJsonDocument, JSON can't represent inf and nan
+    if (qIsFinite(value))
+        m_data += QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+    else
+        m_data += "null";
+}
+
+void JsonStreamWriter::writeBool(bool value)
+{
+    beginValue();
+    m_data += value ? "true" : "false";
+}
+
+void JsonStreamWriter::writeString(const QString &value)
+{
+    beginValue();
+
+    static const char hexDigits[] = "0123456789abcdef";
+    const QByteArray utf8 = value.toUtf8();
+    m_data.reserve(m_data.size() + utf8.size() + 2);
+    m_data += '"';
+    for (const char c : utf8) {
+        switch (c) {
+        case '"':
+            m_data += "\\\"";
+            break;
+        case '\\':
+            m_data += "\\\\";
+            break;
+        case '\n':
+            m_data += "\\n";
+            break;
+        case '\r':
+            m_data += "\\r";
+            break;
+        case '\t':
+            m_data += "\\t";
+            break;
+        default:
+            if (uchar(c) < 0x20) {
+                m_data += "\\u00";
+                m_data += hexDigits[uchar(c) >> 4];
+                m_data += hexDigits[uchar(c) & 0xf];
+            } else {
+                // Multi-byte UTF-8 sequences are valid JSON as they are
+                m_data += c;
+            }
+            break;
+        }
+    }
+    m_data += '"';
+}
+
+QByteArray JsonStreamWriter::data() const
+{
+    return m_data;
+}
+
+void JsonStreamWriter::beginValue()
+{
+    if (m_afterKey) {
+        // The key already took care of the separator and indentation
+        m_afterKey = false;
+        return;
+    }
+
+    if (m_firstInContainer.isEmpty())
+        return; // The root value
+
+    if (m_firstInContainer.last())
+        m_firstInContainer.last() = false;
+    else
+        m_data += ',';
+
+    m_data += '\n';
+    writeIndentation();
+}
+
+void JsonStreamWriter::beginContainer(char open)
+{
+    beginValue();
+    m_data += open;
+    m_firstInContainer.push_back(true);
+}
+
+void JsonStreamWriter::endContainer(char close)
+{
+    if (m_firstInContainer.isEmpty())
+        return;
+
+    // Even empty containers get a line break, QJsonDocument writes "[\n    ]"
+    m_firstInContainer.removeLast();
+    m_data += '\n';
+    writeIndentation();
+
+    m_data += close;
+
+    if (m_firstInContainer.isEmpty())
+        m_data += '\n'; // Like QJsonDocument, end the document with a newline
+}
+
+void JsonStreamWriter::writeIndentation()
+{
+    m_data += QByteArray(4 * m_firstInContainer.size(), ' ');
+}
@@ -0,0 +1,85 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief A minimal JSON writer, so layouts can be saved without building a QVariantMap tree.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_JSON_STREAM_WRITER_P_H
+#define KD_JSON_STREAM_WRITER_P_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+namespace KDDockWidgets {
+
+/**
+ * @brief Appends indented JSON to a buffer as the caller walks its data. The counterpart of JsonStreamReader.
+ *
+ * Typical usage:
+ *
+ *     writer.beginObject();
+ *     writer.writeKey("width");
+ *     writer.writeInt(width);
+ *     writer.endObject();
+ *
+ * Keys are expected to be ASCII string literals, they're appended as-is, without escaping or allocating.
+ */
+class JsonStreamWriter
+{
+public:
+    JsonStreamWriter() = default;
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    ///@brief writes the key of the next member of the current object. Must be followed by a value.
+    void writeKey(const char *key);
+
+    void writeInt(int);
+    void writeDouble(double);
+    void writeBool(bool);
+    void writeString(const QString &);
+
+    ///@brief returns the JSON written so far
+    QByteArray data() const;
+
+private:
+    void beginValue();
+    void beginContainer(char open);
+    void endContainer(char close);
+    void writeIndentation();
+
+    QByteArray m_data;
+    bool m_afterKey = false;
+
+    // Whether the container at each nesting level didn't have any member yet, so we know when to write a comma
+    QVector<bool> m_firstInContainer;
+};
+
+}
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "LastPosition_p.h"
 #include "DockRegistry_p.h"
+#include "EventLog_p.h"
 #include "multisplitter/MultiSplitterLayout_p.h"
 #include "multisplitter/MultiSplitter_p.h"
 
@@ -33,6 +34,22 @@
 
 using namespace KDDockWidgets;
 
+ItemRef::ItemRef(LastPosition *owner_, Item *it)
+    : item(it)
+    , owner(owner_)
+{
+    item->addItemRef(this);
+    item->ref();
+}
+
+ItemRef::~ItemRef()
+{
+    if (!itemDestroyed) {
+        item->removeItemRef(this);
+        item->unref();
+    }
+}
+
 LastPosition::~LastPosition()
 {
     m_placeholders.clear();
@@ -55,12 +72,10 @@ void LastPosition::addPlaceholderItem(Item *placeholder)
         removeNonMainWindowPlaceholders();
     }
 
-    // Make sure our list only contains valid placeholders. We save the result so we can disconnect from the lambda, since the Item might outlive LastPosition
-    QMetaObject::Connection connection = QObject::connect(placeholder, &QObject::destroyed, placeholder, [this, placeholder] {
-        removePlaceholder(placeholder);
-    });
+    KDDW_LOG_EVENT(LogEvent::PlaceholderAdded, placeholder);
 
-    m_placeholders.push_back(std::unique_ptr<ItemRef>(new ItemRef(connection, placeholder)));
+    // The placeholder calls removePlaceholder() if it's destroyed, so our list only contains valid placeholders
+    m_placeholders.push_back(std::unique_ptr<ItemRef>(new ItemRef(this, placeholder)));
 
     // NOTE: We use a list instead of simply two variables to keep the placeholders, because
     // a placeholder from a FloatingWindow might become a MainWindow one without we knowing,
@@ -122,6 +137,7 @@ void LastPosition::removePlaceholder(Item *placeholder)
     if (m_clearing) // reentrancy guard
         return;
 
+    KDDW_LOG_EVENT(LogEvent::PlaceholderRemoved, placeholder);
     m_placeholders.erase(std::remove_if(m_placeholders.begin(), m_placeholders.end(), [placeholder] (const std::unique_ptr<ItemRef> &itemref) {
                              return itemref->item == placeholder;
     }), m_placeholders.end());
@@ -37,28 +37,23 @@
 
 namespace KDDockWidgets {
 
-// Just a RAII class so we don't forget to unref
+class LastPosition;
+
+// Just a RAII class so we don't forget to unref.
+// The Item keeps its refs in an intrusive list and tells their LastPosition when it's destroyed,
+// so referencing a placeholder doesn't need a QPointer and a destroyed() connection.
 struct ItemRef
 {
-    ItemRef(const QMetaObject::Connection &conn, Item *it)
-        : item(it)
-        , guard(it)
-        , connection(conn)
-    {
-        item->ref();
-    }
-
-    ~ItemRef()
-    {
-        if (guard) {
-            QObject::disconnect(connection);
-            item->unref();
-        }
-    }
+    ItemRef(LastPosition *owner, Item *it);
+    ~ItemRef();
 
     Item *const item;
-    const QPointer<Item> guard;
-    const QMetaObject::Connection connection;
+    LastPosition *const owner;
+    bool itemDestroyed = false;
+
+    // See Item::addItemRef()
+    ItemRef *prevRef = nullptr;
+    ItemRef *nextRef = nullptr;
 private:
     Q_DISABLE_COPY(ItemRef)
 };
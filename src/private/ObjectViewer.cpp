@@ -40,6 +40,7 @@
 #include <QToolBar>
 #include <QShortcut>
 #include <QDir>
+#include <QChildEvent>
 
 #ifdef Q_OS_WIN
 # include <Windows.h>
@@ -62,6 +63,12 @@ ObjectViewer::ObjectViewer(QWidget *parent)
     m_treeView.setModel(&m_model);
     connect(m_treeView.selectionModel(), &QItemSelectionModel::selectionChanged,
             this, &ObjectViewer::onSelectionChanged);
+    connect(&m_treeView, &QTreeView::expanded, this, &ObjectViewer::onExpanded);
+
+    // Children are added with a delay, as ChildAdded is received while they're still being constructed
+    m_pendingChildrenTimer.setSingleShot(true);
+    m_pendingChildrenTimer.setInterval(0);
+    connect(&m_pendingChildrenTimer, &QTimer::timeout, this, &ObjectViewer::addPendingChildren);
 
     QAction *action = m_menu.addAction(QStringLiteral("Refresh"));
     connect(action, &QAction::triggered, this, &ObjectViewer::refresh);
@@ -88,10 +95,11 @@ ObjectViewer::ObjectViewer(QWidget *parent)
 
 void ObjectViewer::refresh()
 {
-    const auto hashCopy = m_itemMap;
-    for (auto it = hashCopy.cbegin(), e = hashCopy.cend(); it != e; ++it)
-        remove(it.key());
+    QStandardItem *root = m_model.invisibleRootItem();
+    for (int i = 0, count = root->rowCount(); i < count; ++i)
+        forgetItem(root->child(i));
 
+    m_pendingChildren.clear();
     m_model.clear();
 
     const auto &topLevelWidgets = qApp->topLevelWidgets();
@@ -182,6 +190,9 @@ void ObjectViewer::add(QObject *obj, QStandardItem *parent)
     if (m_ignoreToolBars && qobject_cast<QToolBar*>(obj))
         return;
 
+    if (m_itemMap.contains(obj))
+        return;
+
     connect(obj, &QObject::destroyed, this, &ObjectViewer::remove);
     obj->installEventFilter(this);
     auto item = new QStandardItem(nameForObj(obj));
@@ -190,15 +201,75 @@ void ObjectViewer::add(QObject *obj, QStandardItem *parent)
     parent->appendRow(item);
     updateItemAppearence(item);
 
-    for (auto child : obj->children())
-        add(child, item);
+    // Children are only added once the item is expanded. Until then a placeholder gives it an expand arrow.
+    if (!obj->children().isEmpty())
+        item->appendRow(new QStandardItem());
 }
 
 void ObjectViewer::remove(QObject *obj)
 {
     Q_ASSERT(obj);
-    obj->removeEventFilter(this);
-    m_itemMap.remove(obj);
+    QStandardItem *item = m_itemMap.value(obj);
+    if (!item)
+        return;
+
+    forgetItem(item);
+    QStandardItem *parentItem = item->parent() ? item->parent() : m_model.invisibleRootItem();
+    parentItem->removeRow(item->row());
+}
+
+void ObjectViewer::forgetItem(QStandardItem *item)
+{
+    if (QObject *obj = objectForItem(item)) {
+        obj->removeEventFilter(this);
+        disconnect(obj, &QObject::destroyed, this, &ObjectViewer::remove);
+        m_itemMap.remove(obj);
+    }
+
+    for (int i = 0, count = item->rowCount(); i < count; ++i)
+        forgetItem(item->child(i));
+}
+
+bool ObjectViewer::hasPlaceholder(QStandardItem *item) const
+{
+    return item->rowCount() == 1 && !objectForItem(item->child(0));
+}
+
+void ObjectViewer::onExpanded(const QModelIndex &index)
+{
+    QStandardItem *item = m_model.itemFromIndex(index);
+    if (!item || !hasPlaceholder(item))
+        return;
+
+    item->removeRow(0);
+    const QObjectList children = objectForItem(item)->children();
+    for (QObject *child : children)
+        add(child, item);
+}
+
+void ObjectViewer::addPendingChildren()
+{
+    const auto pending = m_pendingChildren;
+    m_pendingChildren.clear();
+
+    for (const QPointer<QObject> &child : pending) {
+        if (!child || m_itemMap.contains(child))
+            continue;
+
+        QStandardItem *parentItem = m_itemMap.value(child->parent());
+        if (!parentItem)
+            continue; // Parent not shown, nothing to update
+
+        if (hasPlaceholder(parentItem))
+            continue; // Not expanded yet, will be fetched on demand
+
+        if (parentItem->rowCount() == 0 && !m_treeView.isExpanded(parentItem->index())) {
+            // Wasn't populated because it had no children. Just give it an expand arrow.
+            parentItem->appendRow(new QStandardItem());
+        } else {
+            add(child, parentItem);
+        }
+    }
 }
 
 void ObjectViewer::onSelectionChanged()
@@ -292,7 +363,26 @@ bool ObjectViewer::eventFilter(QObject *watched, QEvent *event)
 {
     auto widget = static_cast<QWidget*>(watched);
     if (event->type() == QEvent::Show || event->type() == QEvent::Hide) {
-        updateItemAppearence(m_itemMap.value(watched));
+        if (QStandardItem *item = m_itemMap.value(watched))
+            updateItemAppearence(item);
+        return false;
+    }
+
+    if (event->type() == QEvent::ChildAdded) {
+        if (m_itemMap.contains(watched)) {
+            m_pendingChildren.push_back(static_cast<QChildEvent*>(event)->child());
+            m_pendingChildrenTimer.start();
+        }
+        return false;
+    }
+
+    if (event->type() == QEvent::ChildRemoved) {
+        // The child might be half-destroyed already, only use it as a key
+        QObject *child = static_cast<QChildEvent*>(event)->child();
+        if (QStandardItem *item = m_itemMap.value(child)) {
+            if (item->parent() && objectForItem(item->parent()) == watched)
+                remove(child);
+        }
         return false;
     }
 
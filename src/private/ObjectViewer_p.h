@@ -34,6 +34,8 @@
 #include <QPointer>
 #include <QObject>
 #include <QMenu>
+#include <QTimer>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QStandardItem;
@@ -57,6 +59,10 @@ private:
     QString nameForObj(QObject *o) const;
     void add(QObject *obj, QStandardItem *parent);
     void remove(QObject *obj);
+    void forgetItem(QStandardItem *item);
+    bool hasPlaceholder(QStandardItem *item) const;
+    void onExpanded(const QModelIndex &index);
+    void addPendingChildren();
     void onSelectionChanged();
     void printProperties(QObject *) const;
     QObject* selectedObject() const;
@@ -78,6 +84,8 @@ private:
     bool m_ignoreShortcuts = true;
     bool m_ignoreToolBars = true;
     QHash<QObject*, QStandardItem*> m_itemMap;
+    QVector<QPointer<QObject>> m_pendingChildren;
+    QTimer m_pendingChildrenTimer;
 
 protected:
     void contextMenuEvent(QContextMenuEvent *event) override;
@@ -0,0 +1,159 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Widget to show live layout engine counters. Used for diagnosing slowness without a profiler.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "PerformancePanel_p.h"
+#include "DockRegistry_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/MultiSplitter_p.h"
+
+#include <QDateTime>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Debug;
+
+PerformancePanel::PerformancePanel(QWidget *parent)
+    : QWidget(parent)
+    , m_layoutsTable(new QTableWidget(this))
+    , m_statsLabel(new QLabel(this))
+{
+    auto layout = new QVBoxLayout(this);
+
+    m_layoutsTable->setColumnCount(4);
+    m_layoutsTable->setHorizontalHeaderLabels({ QStringLiteral("Layout"), QStringLiteral("Anchors"),
+                                                QStringLiteral("Items"), QStringLiteral("Placeholders") });
+    m_layoutsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_layoutsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(m_layoutsTable);
+
+    m_statsLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(m_statsLabel);
+
+    auto button = new QPushButton(QStringLiteral("Reset counters"), this);
+    layout->addWidget(button);
+    connect(button, &QPushButton::clicked, this, [this] {
+        Stats::reset();
+        m_previousStats = Stats();
+        refresh();
+    });
+
+    m_refreshTimer.setInterval(1000);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &PerformancePanel::refresh);
+}
+
+void PerformancePanel::showEvent(QShowEvent *e)
+{
+    QWidget::showEvent(e);
+    refresh();
+    m_refreshTimer.start();
+}
+
+void PerformancePanel::hideEvent(QHideEvent *e)
+{
+    QWidget::hideEvent(e);
+    m_refreshTimer.stop(); // Costs nothing when not looked at
+}
+
+void PerformancePanel::refresh()
+{
+    refreshLayouts();
+    refreshStats();
+}
+
+void PerformancePanel::refreshLayouts()
+{
+    const auto layouts = DockRegistry::self()->layouts();
+    m_layoutsTable->setRowCount(layouts.size());
+
+    int floatingIndex = 0;
+    for (int row = 0; row < layouts.size(); ++row) {
+        MultiSplitterLayout *l = layouts.at(row);
+        QString name;
+        if (MainWindowBase *mw = l->multiSplitter()->mainWindow())
+            name = mw->uniqueName();
+        else
+            name = QStringLiteral("FloatingWindow #%1").arg(floatingIndex++);
+
+        const int placeholders = l->placeholderCount();
+        const QStringList cells = { name, QString::number(l->anchors().size()),
+                                    QString::number(l->count() - placeholders), QString::number(placeholders) };
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *cell = m_layoutsTable->item(row, column);
+            if (!cell) {
+                cell = new QTableWidgetItem();
+                m_layoutsTable->setItem(row, column, cell);
+            }
+            cell->setText(cells.at(column));
+        }
+    }
+}
+
+void PerformancePanel::refreshStats()
+{
+    if (!Stats::isEnabled()) {
+        m_statsLabel->setText(QStringLiteral("Timings and counters require building KDDockWidgets with -DOPTION_STATS=ON"));
+        return;
+    }
+
+    const Stats stats = Stats::snapshot();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 elapsed = m_previousRefreshMSecs == 0 ? 0 : now - m_previousRefreshMSecs;
+    auto perSecond = [elapsed](quint64 current, quint64 previous) {
+        if (elapsed <= 0 || current < previous)
+            return QStringLiteral("-");
+        return QString::number(double(current - previous) * 1000 / double(elapsed), 'f', 1);
+    };
+
+    auto msecs = [](qint64 usecs) {
+        return QString::number(double(usecs) / 1000, 'f', 2);
+    };
+
+    QStringList lines;
+    lines << QStringLiteral("Last addWidget: %1 ms").arg(msecs(stats.lastAddWidgetUSecs))
+          << QStringLiteral("Last restore: %1 ms").arg(msecs(stats.lastRestoreUSecs))
+          << QStringLiteral("Last resize: %1 ms").arg(msecs(stats.lastResizeUSecs))
+          << QStringLiteral("Last drag hover: %1 ms").arg(msecs(stats.lastDragHoverUSecs))
+          << QStringLiteral("Frame setGeometry pushes: %1/s (%2 total)")
+                 .arg(perSecond(stats.frameGeometryPushes, m_previousStats.frameGeometryPushes))
+                 .arg(stats.frameGeometryPushes)
+          << QStringLiteral("Item setGeometry calls: %1/s (%2 total)")
+                 .arg(perSecond(stats.itemSetGeometryCalls, m_previousStats.itemSetGeometryCalls))
+                 .arg(stats.itemSetGeometryCalls)
+          << QStringLiteral("Anchor setPosition calls: %1/s (%2 total)")
+                 .arg(perSecond(stats.anchorSetPositionCalls, m_previousStats.anchorSetPositionCalls))
+                 .arg(stats.anchorSetPositionCalls)
+          << QStringLiteral("checkSanity calls: %1").arg(stats.checkSanityCalls)
+          << QStringLiteral("Deepest redistributeSpace: %1").arg(stats.maxRedistributeSpaceDepth);
+
+    m_statsLabel->setText(lines.join(QLatin1Char('\n')));
+    m_previousStats = stats;
+    m_previousRefreshMSecs = now;
+}
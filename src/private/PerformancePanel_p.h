@@ -0,0 +1,73 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Widget to show live layout engine counters. Used for diagnosing slowness without a profiler.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_PERFORMANCEPANEL_P_H
+#define KD_PERFORMANCEPANEL_P_H
+
+#include "Stats.h"
+
+#include <QWidget>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QLabel;
+class QTableWidget;
+QT_END_NAMESPACE
+
+namespace KDDockWidgets {
+namespace Debug {
+
+/**
+ * @brief A DebugWindow tab with the anchors, items and placeholders of each layout, and the
+ * timings and counters of KDDockWidgets::Stats. Refreshed every second while visible.
+ */
+class PerformancePanel : public QWidget //clazy:exclude=missing-qobject-macro
+{
+public:
+    explicit PerformancePanel(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *) override;
+    void hideEvent(QHideEvent *) override;
+
+private:
+    void refresh();
+    void refreshLayouts();
+    void refreshStats();
+
+    QTableWidget *const m_layoutsTable;
+    QLabel *const m_statsLabel;
+    QTimer m_refreshTimer;
+
+    // For the rates, which are the difference to the previous refresh
+    Stats m_previousStats;
+    qint64 m_previousRefreshMSecs = 0;
+};
+}
+}
+
+#endif
@@ -0,0 +1,98 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Macros to update KDDockWidgets::Stats. They compile to nothing unless KDDOCKWIDGETS_STATS is defined.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_STATS_P_H
+#define KD_DOCKWIDGETS_STATS_P_H
+
+#include "Stats.h"
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+
+namespace KDDockWidgets {
+
+///@brief Returns the counters that the KDDW_STATS_* macros update
+Stats &mutableStats();
+
+#ifdef KDDOCKWIDGETS_STATS
+///@brief Stores in @p usecs how long its scope took
+class StatsScopeTimer
+{
+public:
+    explicit StatsScopeTimer(qint64 &usecs)
+        : m_usecs(usecs)
+    {
+        m_timer.start();
+    }
+
+    ~StatsScopeTimer()
+    {
+        m_usecs = m_timer.nsecsElapsed() / 1000;
+    }
+
+private:
+    Q_DISABLE_COPY(StatsScopeTimer)
+    qint64 &m_usecs;
+    QElapsedTimer m_timer;
+};
+
+///@brief Tracks the current recursion depth and records the deepest one in @p maxDepth
+class StatsDepthGuard
+{
+public:
+    explicit StatsDepthGuard(int &maxDepth)
+    {
+        ++s_depth;
+        maxDepth = qMax(maxDepth, s_depth);
+    }
+
+    ~StatsDepthGuard()
+    {
+        --s_depth;
+    }
+
+private:
+    Q_DISABLE_COPY(StatsDepthGuard)
+    static int s_depth;
+};
+#endif
+
+}
+
+#ifdef KDDOCKWIDGETS_STATS
+# define KDDW_STATS_INCREMENT(counter) (++KDDockWidgets::mutableStats().counter)
+# define KDDW_STATS_ADD(counter, value) (KDDockWidgets::mutableStats().counter += quint64(value))
+# define KDDW_STATS_TRACK_DEPTH(counter) KDDockWidgets::StatsDepthGuard kddw_statsDepthGuard(KDDockWidgets::mutableStats().counter)
+# define KDDW_STATS_TIME_SCOPE(field) KDDockWidgets::StatsScopeTimer kddw_statsScopeTimer(KDDockWidgets::mutableStats().field)
+#else
+# define KDDW_STATS_INCREMENT(counter) do {} while (false)
+# define KDDW_STATS_ADD(counter, value) do {} while (false)
+# define KDDW_STATS_TRACK_DEPTH(counter) do {} while (false)
+# define KDDW_STATS_TIME_SCOPE(field) do {} while (false)
+#endif
+
+#endif
@@ -93,6 +93,16 @@ std::unique_ptr<WindowBeingDragged> TabBar::makeWindow()
     if (!dock)
         return {};
 
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if ((Config::self().flags() & Config::Flag_GhostTabDrag) && !KDDockWidgets::usesNativeTitleBar() &&
+        !(dock->options() & DockWidgetBase::Option_NotDockable)) {
+        // Only a snapshot follows the mouse, the tab is moved when dropped. See Flag_GhostTabDrag.
+        Frame *frame = m_tabWidget->frame();
+        const QPoint offsetInFrame = m_thisWidget->mapTo(frame, QPoint(0, 0));
+        return std::unique_ptr<WindowBeingDragged>(new WindowBeingDragged(dock, frame, offsetInFrame, this));
+    }
+#endif
+
     FloatingWindow *floatingWindow = detachTab(dock);
 
     auto draggable = KDDockWidgets::usesNativeTitleBar() ? static_cast<Draggable*>(floatingWindow)
@@ -177,7 +187,10 @@ void TabWidget::insertDockWidget(DockWidgetBase *dock, int index)
 
     QPointer<Frame> oldFrame = dock->frame();
     insertDockWidget(index, dock, dock->icon(), dock->title());
-    setCurrentDockWidget(index);
+
+    // In a batch only the last one becomes current, see Frame::beginBatchInsert()
+    if (!m_frame->isInBatchInsert())
+        setCurrentDockWidget(index);
 
     if (oldFrame && oldFrame->beingDeletedLater()) {
         // give it a push and delete it immediately.
@@ -242,3 +255,8 @@ void TabWidget::onTabRemoved()
 {
     m_frame->onDockWidgetCountChanged();
 }
+
+void TabWidget::onTabMoved(int from, int to)
+{
+    Q_EMIT m_frame->tabMoved(from, to);
+}
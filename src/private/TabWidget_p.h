@@ -180,6 +180,9 @@ protected:
     void onTabInserted();
     void onTabRemoved();
 
+    ///@brief Called after the user reordered a tab, see Config::Flag_AllowReorderTabs
+    void onTabMoved(int from, int to);
+
 private:
     Frame *const m_frame;
     QWidgetOrQuick *const m_thisWidget;
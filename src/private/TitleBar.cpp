@@ -107,6 +107,10 @@ void TitleBar::setTitle(const QString &title)
 
 void TitleBar::setIcon(const QIcon &icon)
 {
+    // Frame::updateTitleAndIcon() sets both on every title change, don't re-render the same icon
+    if (icon.cacheKey() == m_icon.cacheKey())
+        return;
+
     m_icon = icon;
     Q_EMIT iconChanged();
 }
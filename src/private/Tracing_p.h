@@ -0,0 +1,67 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Macros to record tracing spans. They compile to nothing unless KDDOCKWIDGETS_TRACING is defined.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_DOCKWIDGETS_TRACING_P_H
+#define KD_DOCKWIDGETS_TRACING_P_H
+
+#include "Tracing.h"
+
+namespace KDDockWidgets {
+
+#ifdef KDDOCKWIDGETS_TRACING
+///@brief RAII class that records a span from construction to destruction, if a trace is being recorded
+class TraceSpan
+{
+public:
+    ///@param name must be a string literal, it's not copied
+    explicit TraceSpan(const char *name);
+    ~TraceSpan();
+
+private:
+    Q_DISABLE_COPY(TraceSpan)
+    const char *const m_name;
+    const qint64 m_start; // -1 if not recording
+};
+
+///@brief Records an instantaneous event, for example a state transition
+void traceInstant(const char *name);
+#endif
+
+}
+
+#ifdef KDDOCKWIDGETS_TRACING
+// Nested spans get a different variable name each, so they don't trigger -Wshadow
+# define KDDW_TRACE_CONCAT_IMPL(a, b) a##b
+# define KDDW_TRACE_CONCAT(a, b) KDDW_TRACE_CONCAT_IMPL(a, b)
+# define KDDW_TRACE_SCOPE(name) KDDockWidgets::TraceSpan KDDW_TRACE_CONCAT(kddw_traceSpan, __LINE__)(name)
+# define KDDW_TRACE_INSTANT(name) KDDockWidgets::traceInstant(name)
+#else
+# define KDDW_TRACE_SCOPE(name) do {} while (false)
+# define KDDW_TRACE_INSTANT(name) do {} while (false)
+#endif
+
+#endif
@@ -22,6 +22,9 @@
 #include "FloatingWindow_p.h"
 #include "TitleBar_p.h"
 #include "DragController_p.h"
+#include "DropArea_p.h"
+#include "DockRegistry_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
 #include "Config.h"
 
 #include <QEvent>
@@ -80,7 +83,11 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
         if (!widgetRect.contains(cursorPoint))
             return false;
         if (mouseEvent->button() == Qt::LeftButton) {
+            if (startSystemResize(cursorPos))
+                return true; // We'll only get the resize events from now on
             mResizeWidget = true;
+            if (auto fw = qobject_cast<FloatingWindow*>(mTarget))
+                mInteractiveOperation.reset(new InteractiveOperation(fw->multiSplitterLayout()->dockWidgets()));
         }
 
         mNewPosition = mouseEvent->globalPos();
@@ -95,6 +102,11 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
             mResizeWidget = false;
             mTarget->releaseMouse();
             mTarget->releaseKeyboard();
+
+            // The resize is done, don't wait for the throttled relayout
+            if (auto fw = qobject_cast<FloatingWindow*>(mTarget))
+                fw->dropArea()->applyPendingResize();
+            mInteractiveOperation.reset();
             return true;
         }
         break;
@@ -104,6 +116,8 @@ bool WidgetResizeHandler::eventFilter(QObject *o, QEvent *e)
             break;
         auto mouseEvent = static_cast<QMouseEvent *>(e);
         mResizeWidget = mResizeWidget && (mouseEvent->buttons() & Qt::LeftButton);
+        if (!mResizeWidget)
+            mInteractiveOperation.reset(); // Someone ate our release event
         const bool state = mResizeWidget;
         mResizeWidget = ((o == mTarget) && mResizeWidget);
         mouseMoveEvent(mouseEvent);
@@ -120,7 +134,13 @@ void WidgetResizeHandler::mouseMoveEvent(QMouseEvent *e)
 {
     const QPoint globalPos = e->globalPos();
     if (!mResizeWidget) {
-        updateCursor(cursorPosition(globalPos));
+        // Hovering. Setting the cursors is a round-trip to the window system, only do it when the
+        // cursor moves into another zone. The cursors are per-widget already, not the global override cursor.
+        const CursorPosition cursorPos = cursorPosition(globalPos);
+        if (cursorPos != mHoverCursorPos) {
+            mHoverCursorPos = cursorPos;
+            updateCursor(cursorPos);
+        }
         return;
     }
 
@@ -210,9 +230,6 @@ bool WidgetResizeHandler::handleWindowsNativeEvent(FloatingWindow *w, const QByt
     if (eventType != "windows_generic_MSG")
         return false;
 
-    QRect titleBarRectGlobal = w->titleBar()->rect();
-    titleBarRectGlobal.moveTopLeft(w->titleBar()->mapToGlobal(QPoint(0, 0)));
-
     auto msg = static_cast<MSG *>(message);
     if (msg->message == WM_NCCALCSIZE) {
         *result = 0;
@@ -256,8 +273,12 @@ bool WidgetResizeHandler::handleWindowsNativeEvent(FloatingWindow *w, const QByt
         } else if (!hasFixedWidth && xPos <= rect.right && xPos >= rect.right - borderWidth) {
             *result = HTRIGHT;
         } else {
-            if (yPos >= titleBarRectGlobal.top() && yPos <= titleBarRectGlobal.bottom() && xPos >= titleBarRectGlobal.left() && xPos <= titleBarRectGlobal.right()) {
-                QWidget *hoveredWidget = qApp->widgetAt(QPoint(xPos, yPos));
+            // Our window has no native frame, so its geometry starts where the native window does
+            const QPoint localPos(xPos - rect.left, yPos - rect.top);
+            const QRect titleBarRect = w->titleBarRectForHitTest();
+            if (titleBarRect.contains(localPos)) {
+                // Only the title bar's children, no need for the app-wide QApplication::widgetAt()
+                QWidget *hoveredWidget = w->titleBar()->childAt(localPos - titleBarRect.topLeft());
                 if (!qobject_cast<QAbstractButton*>(hoveredWidget)) {
                     // User clicked on the title bar, let's allow it, so we get Aero-Snap.
                     *result = HTCAPTION;
@@ -284,6 +305,10 @@ bool WidgetResizeHandler::handleWindowsNativeEvent(FloatingWindow *w, const QByt
 
             return true;
         }
+    } else if (msg->message == WM_EXITSIZEMOVE) {
+        // The native resize is done, don't wait for the throttled relayout
+        w->dropArea()->applyPendingResize();
+        return false;
     } else if (msg->message == WM_GETMINMAXINFO) {
         // Qt doesn't work well with windows that don't have title bar but have native frames.
         // When maximized they go out of bounds and the title bar is clipped, so catch WM_GETMINMAXINFO
@@ -315,6 +340,56 @@ bool WidgetResizeHandler::handleWindowsNativeEvent(FloatingWindow *w, const QByt
 
 #endif
 
+bool WidgetResizeHandler::startSystemResize(CursorPosition cursorPos)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0) && !defined(Q_OS_WIN)
+    // Saves a round-trip through Qt for each mouse move, which is noticeable on remote X sessions.
+    // Windows doesn't need it, as handleWindowsNativeEvent() already makes the resize native.
+    if (!(Config::self().flags() & Config::Flag_SystemResize))
+        return false;
+
+    QWindow *window = mTarget->windowHandle();
+    if (!window)
+        return false;
+
+    Qt::Edges edges;
+    switch (cursorPos) {
+    case CursorPosition::Left:
+        edges = Qt::LeftEdge;
+        break;
+    case CursorPosition::Right:
+        edges = Qt::RightEdge;
+        break;
+    case CursorPosition::Top:
+        edges = Qt::TopEdge;
+        break;
+    case CursorPosition::Bottom:
+        edges = Qt::BottomEdge;
+        break;
+    case CursorPosition::TopLeft:
+        edges = Qt::TopEdge | Qt::LeftEdge;
+        break;
+    case CursorPosition::TopRight:
+        edges = Qt::TopEdge | Qt::RightEdge;
+        break;
+    case CursorPosition::BottomLeft:
+        edges = Qt::BottomEdge | Qt::LeftEdge;
+        break;
+    case CursorPosition::BottomRight:
+        edges = Qt::BottomEdge | Qt::RightEdge;
+        break;
+    case CursorPosition::Undefined:
+        return false;
+    }
+
+    // Returns false if the platform can't do it, for example with -platform offscreen
+    return window->startSystemResize(edges);
+#else
+    Q_UNUSED(cursorPos);
+    return false;
+#endif
+}
+
 void WidgetResizeHandler::setTarget(QWidget *w)
 {
     if (w) {
@@ -25,6 +25,8 @@
 #include <QPoint>
 #include <QDebug>
 
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 class QMouseEvent;
 QT_END_NAMESPACE
@@ -32,6 +34,7 @@ QT_END_NAMESPACE
 namespace KDDockWidgets {
 
 class FloatingWindow;
+class InteractiveOperation;
 
 class WidgetResizeHandler : public QObject
 {
@@ -63,11 +66,17 @@ private:
     };
     void mouseMoveEvent(QMouseEvent *e);
     void updateCursor(CursorPosition m);
+
+    ///@brief With Config::Flag_SystemResize, asks the window manager to do the interactive resize.
+    ///Returns false if the flag isn't set or the platform doesn't support it, then we resize it ourselves.
+    bool startSystemResize(CursorPosition);
     CursorPosition cursorPosition(QPoint) const;
     QWidget *mTarget = nullptr;
     CursorPosition mCursorPos = CursorPosition::Undefined;
+    CursorPosition mHoverCursorPos = CursorPosition::Undefined; // What updateCursor() was last called with while hovering
     QPoint mNewPosition;
     bool mResizeWidget = false;
+    std::unique_ptr<InteractiveOperation> mInteractiveOperation; // While mResizeWidget
 };
 
 }
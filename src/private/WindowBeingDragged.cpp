@@ -20,7 +20,22 @@
 
 #include "WindowBeingDragged_p.h"
 #include "DragController_p.h"
+#include "DockWidgetBase.h"
+#include "Frame_p.h"
 #include "Logging_p.h"
+#include "DockRegistry_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+
+#include <QScreen>
+#include <QTimer>
+#include <QWindow>
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+# include <QLabel>
+#endif
+
+// How long the dragged window must stay on a screen before the deferred relayout happens anyway
+#define DEFERRED_RELAYOUT_INTERVAL 300
 
 using namespace KDDockWidgets;
 
@@ -31,8 +46,34 @@ WindowBeingDragged::WindowBeingDragged(FloatingWindow *fw, Draggable *draggable)
     init();
 }
 
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+WindowBeingDragged::WindowBeingDragged(DockWidgetBase *dockWidget, Frame *frame, QPoint offsetInFrame, Draggable *draggable)
+    : m_draggable(draggable->asWidget())
+    , m_isGhost(true)
+    , m_dockWidget(dockWidget)
+    , m_offsetInFrame(offsetInFrame)
+{
+    // The frame is already laid out and painted, rendering it again is much cheaper than
+    // reparenting the dock widget into a new window, which would relayout and repaint it, and recreate native children.
+    auto ghost = new QLabel(nullptr, Qt::ToolTip | Qt::FramelessWindowHint | Qt::WindowTransparentForInput);
+    ghost->setObjectName(QStringLiteral("_docks_GhostDrag"));
+    ghost->setAttribute(Qt::WA_TransparentForMouseEvents);
+    ghost->setAttribute(Qt::WA_ShowWithoutActivating);
+    ghost->setPixmap(frame->grab());
+    ghost->setWindowOpacity(0.7);
+    ghost->resize(frame->size());
+    ghost->move(frame->mapToGlobal(QPoint(0, 0)));
+    m_ghost.reset(ghost);
+    ghost->show();
+
+    grabMouse(true);
+}
+#endif
+
 WindowBeingDragged::~WindowBeingDragged()
 {
+    QObject::disconnect(m_screenChangedConnection);
+    endDeferredRelayout();
     grabMouse(false);
 }
 
@@ -41,6 +82,123 @@ void WindowBeingDragged::init()
     Q_ASSERT(m_floatingWindow);
     grabMouse(true);
     m_floatingWindow->raise();
+    m_interactiveOperation.reset(new InteractiveOperation(m_floatingWindow->multiSplitterLayout()->dockWidgets()));
+
+    if (QWindow *window = m_floatingWindow->windowHandle()) {
+        m_devicePixelRatio = window->devicePixelRatio();
+        m_screenChangedConnection = QObject::connect(window, &QWindow::screenChanged, window, [this] (QScreen *screen) {
+            onScreenChanged(screen);
+        });
+    }
+}
+
+void WindowBeingDragged::onScreenChanged(QScreen *screen)
+{
+    if (!m_floatingWindow || !screen)
+        return;
+
+    const qreal dpr = screen->devicePixelRatio();
+    if (qFuzzyCompare(dpr, m_devicePixelRatio) && !m_deferredLayout)
+        return;
+
+    m_devicePixelRatio = dpr;
+    qCDebug(state) << Q_FUNC_INFO << "Deferring relayout, dragged to" << screen->name() << dpr;
+
+    if (!m_deferredLayout) {
+        m_deferredLayout = m_floatingWindow->multiSplitterLayout();
+        m_deferredLayout->beginTransaction();
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+        // The window keeps showing what it last painted until the drop
+        m_floatingWindow->setUpdatesEnabled(false);
+#endif
+    }
+
+    if (!m_deferredRelayoutTimer) {
+        m_deferredRelayoutTimer.reset(new QTimer());
+        m_deferredRelayoutTimer->setSingleShot(true);
+        m_deferredRelayoutTimer->setInterval(DEFERRED_RELAYOUT_INTERVAL);
+        QObject::connect(m_deferredRelayoutTimer.get(), &QTimer::timeout, m_deferredRelayoutTimer.get(), [this] {
+            endDeferredRelayout();
+        });
+    }
+
+    // Restarted on every crossing, only a window that settled on a screen is relaid out
+    m_deferredRelayoutTimer->start();
+}
+
+void WindowBeingDragged::endDeferredRelayout()
+{
+    if (m_deferredRelayoutTimer)
+        m_deferredRelayoutTimer->stop();
+
+    if (!m_deferredLayout)
+        return;
+
+    m_deferredLayout->endTransaction();
+    m_deferredLayout = nullptr;
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    if (m_floatingWindow)
+        m_floatingWindow->setUpdatesEnabled(true);
+#endif
+}
+
+QWidgetOrQuick *WindowBeingDragged::draggedWidget() const
+{
+    if (m_isGhost && !m_floatingWindow)
+        return m_dockWidget;
+
+    return m_floatingWindow;
+}
+
+QString WindowBeingDragged::affinityName() const
+{
+    if (m_floatingWindow)
+        return m_floatingWindow->affinityName();
+
+    return m_dockWidget ? m_dockWidget->affinityName() : QString();
+}
+
+int WindowBeingDragged::affinityId() const
+{
+    if (m_floatingWindow)
+        return m_floatingWindow->affinityId();
+
+    return m_dockWidget ? m_dockWidget->affinityId() : 0;
+}
+
+QWidgetOrQuick *WindowBeingDragged::topLevel() const
+{
+    if (m_floatingWindow)
+        return m_floatingWindow;
+
+    return m_ghost.get();
+}
+
+void WindowBeingDragged::moveTo(QPoint globalPos)
+{
+    if (m_floatingWindow) {
+        m_floatingWindow->windowHandle()->setPosition(globalPos);
+    } else if (m_ghost) {
+        m_ghost->move(globalPos - m_offsetInFrame);
+    }
+}
+
+FloatingWindow *WindowBeingDragged::materialize(QPoint globalPos)
+{
+    if (!m_isGhost || m_floatingWindow)
+        return m_floatingWindow;
+
+    m_ghost.reset();
+    if (!m_dockWidget)
+        return nullptr;
+
+    m_dockWidget->setFloating(true);
+    m_floatingWindow = m_dockWidget->floatingWindow();
+    if (m_floatingWindow)
+        m_floatingWindow->move(globalPos);
+
+    return m_floatingWindow;
 }
 
 void WindowBeingDragged::grabMouse(bool grab)
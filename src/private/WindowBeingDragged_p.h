@@ -26,27 +26,98 @@
 
 #include <QPointer>
 
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+class QScreen;
+class QTimer;
+QT_END_NAMESPACE
+
 namespace KDDockWidgets {
 
 class FloatingWindow;
+class MultiSplitterLayout;
 class Draggable;
+class DockWidgetBase;
+class Frame;
+class InteractiveOperation;
 
 struct DOCKS_EXPORT_FOR_UNIT_TESTS WindowBeingDragged
 {
 public:
     explicit WindowBeingDragged(FloatingWindow *fw, Draggable *draggable);
+
+#ifdef KDDOCKWIDGETS_QTWIDGETS
+    /**
+     * @brief Constructs a ghost drag, for Config::Flag_GhostTabDrag. QtWidgets only.
+     * Only a snapshot of @p frame is shown, @p dockWidget stays in it until the drop.
+     * @p offsetInFrame is where the draggable is inside @p frame, so the snapshot doesn't jump.
+     */
+    explicit WindowBeingDragged(DockWidgetBase *dockWidget, Frame *frame, QPoint offsetInFrame, Draggable *draggable);
+#endif
+
     ~WindowBeingDragged();
     void init();
 
+    ///@brief returns the window being dragged. nullptr if it's a ghost drag, until materialize() is called
     FloatingWindow *floatingWindow() const { return m_floatingWindow; }
 
+    ///@brief returns whether only a snapshot is being dragged. See Config::Flag_GhostTabDrag
+    bool isGhost() const { return m_isGhost; }
+
+    ///@brief returns the dock widget of a ghost drag
+    DockWidgetBase *dockWidget() const { return m_dockWidget; }
+
+    ///@brief returns what drop areas should be hovered with: The floating window, or the dock widget of a ghost drag
+    QWidgetOrQuick *draggedWidget() const;
+
+    ///@brief returns the affinity of what is being dragged
+    QString affinityName() const;
+    int affinityId() const;
+
+    ///@brief returns the top-level following the mouse: The floating window, or the ghost's snapshot
+    QWidgetOrQuick *topLevel() const;
+
+    ///@brief moves the top-level to @p globalPos, which is the position of the draggable
+    void moveTo(QPoint globalPos);
+
+    ///@brief For a ghost drag, detaches the dock widget into a real floating window placed at @p globalPos
+    FloatingWindow *materialize(QPoint globalPos);
+
     ///@brief grabs or releases the mouse
     void grabMouse(bool grab);
 
+    ///@brief returns whether the relayout of the dragged window is deferred, as it moved to a screen with another scale factor
+    bool isRelayoutDeferred() const { return m_deferredLayout != nullptr; }
+
+    ///@brief relayouts and repaints the dragged window now, if it was deferred. See onScreenChanged()
+    void endDeferredRelayout();
+
 private:
     Q_DISABLE_COPY(WindowBeingDragged)
+
+    /**
+     * @brief Called when the dragged window moves to a screen with a different devicePixelRatio.
+     * Freezes its layout and painting until the drop, or until it stays on a screen for a moment, so
+     * crossing screens mid-drag doesn't relayout and repaint every frame each time.
+     */
+    void onScreenChanged(QScreen *);
+
+    QMetaObject::Connection m_screenChangedConnection;
+    QPointer<MultiSplitterLayout> m_deferredLayout;
+    std::unique_ptr<QTimer> m_deferredRelayoutTimer;
+    qreal m_devicePixelRatio = 1;
+
     QPointer<FloatingWindow> m_floatingWindow;
     QPointer<QWidgetOrQuick> m_draggable;
+
+    // Its dock widgets are relaid out as it moves and crosses screens, until after the drop
+    std::unique_ptr<InteractiveOperation> m_interactiveOperation;
+
+    const bool m_isGhost = false;
+    QPointer<DockWidgetBase> m_dockWidget;
+    std::unique_ptr<QWidgetOrQuick> m_ghost;
+    QPoint m_offsetInFrame;
 };
 }
 
@@ -21,11 +21,14 @@
 #include "AnimatedIndicators_p.h"
 #include "DropArea_p.h"
 
+#include <QDebug>
 #include <QPainter>
 #include <QPainterPath>
 #include <QState>
 #include <QStateMachine>
 
+#include <algorithm>
+
 #define RUBBERBAND_LENGTH 11
 #define RUBBERBAND_SPACING 2
 #define INFLATED_RUBBERBAND_LENGTH 60
@@ -192,16 +195,112 @@ AnimationState_AnimateDeflate::~AnimationState_AnimateDeflate() {}
 
 }
 
+AnimationClock::AnimationClock(QObject *parent)
+    : QObject(parent)
+{
+    m_timer.setInterval(1000 / m_maxFps);
+    connect(&m_timer, &QTimer::timeout, this, &AnimationClock::tick);
+}
+
+void AnimationClock::start(AnimatedRubberBand *band, const QVariant &endValue)
+{
+    if (!m_time.isValid())
+        m_time.start();
+
+    const Animation animation = { band, band->length(), endValue, m_time.elapsed() };
+
+    auto it = std::find_if(m_animations.begin(), m_animations.end(), [band] (const Animation &a) {
+        return a.band == band;
+    });
+
+    // The previous one is outdated, the new one starts from wherever it got to
+    if (it == m_animations.end())
+        m_animations.push_back(animation);
+    else
+        *it = animation;
+
+    if (!m_timer.isActive())
+        m_timer.start();
+}
+
+void AnimationClock::finish(AnimatedRubberBand *band)
+{
+    auto it = std::find_if(m_animations.begin(), m_animations.end(), [band] (const Animation &a) {
+        return a.band == band;
+    });
+
+    if (it == m_animations.end())
+        return;
+
+    const QVariant endValue = it->endValue;
+    m_animations.erase(it);
+    if (m_animations.isEmpty())
+        m_timer.stop();
+
+    band->setLength(endValue);
+    Q_EMIT band->animationFinished();
+}
+
+bool AnimationClock::isAnimating(const AnimatedRubberBand *band) const
+{
+    return std::any_of(m_animations.cbegin(), m_animations.cend(), [band] (const Animation &a) {
+        return a.band == band;
+    });
+}
+
+void AnimationClock::setMaxFps(int fps)
+{
+    if (fps <= 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid value" << fps;
+        return;
+    }
+
+    m_maxFps = fps;
+    m_timer.setInterval(1000 / fps);
+}
+
+static QVariant interpolated(const QVariant &start, const QVariant &end, qreal progress)
+{
+    if (end.userType() == QMetaType::QSize) {
+        const QSize startSize = start.toSize();
+        const QSize endSize = end.toSize();
+        return QSize(startSize.width() + qRound((endSize.width() - startSize.width()) * progress),
+                     startSize.height() + qRound((endSize.height() - startSize.height()) * progress));
+    }
+
+    return start.toInt() + qRound((end.toInt() - start.toInt()) * progress);
+}
+
+void AnimationClock::tick()
+{
+    const qint64 now = m_time.elapsed();
+
+    // Emit the finished signals last, as they trigger state transitions which can start new animations
+    AnimatedRubberBand::List finished;
+    for (int i = 0; i < m_animations.size();) {
+        const Animation &animation = m_animations.at(i);
+        const qreal progress = qMin(qreal(1), qreal(now - animation.startTime) / m_duration);
+        animation.band->setLength(interpolated(animation.startValue, animation.endValue, m_easingCurve.valueForProgress(progress)));
+        if (progress >= 1) {
+            finished.push_back(animation.band);
+            m_animations.remove(i);
+        } else {
+            ++i;
+        }
+    }
+
+    if (m_animations.isEmpty())
+        m_timer.stop();
+
+    for (AnimatedRubberBand *band : qAsConst(finished))
+        Q_EMIT band->animationFinished();
+}
+
 AnimatedRubberBand::AnimatedRubberBand(DropIndicatorOverlayInterface::DropLocation location, AnimatedIndicators *qq)
     : QRubberBand(QRubberBand::Rectangle, qq)
     , dropLocation(location)
-    , animation(this)
     , q(qq)
 {
-    animation.setTargetObject(this);
-    animation.setDuration(500);
-    animation.setEasingCurve(QEasingCurve::OutBack);
-
     auto stateMachine = new QStateMachine(this);
     auto stateNone = new AnimationState_None(q, this, stateMachine);
     auto stateAnimatedShow = new AnimationState_AnimateShow(q, this, stateMachine);
@@ -218,8 +317,8 @@ AnimatedRubberBand::AnimatedRubberBand(DropIndicatorOverlayInterface::DropLocati
     stateAnimateHide->addTransition(q, &AnimatedIndicators::hovered, stateAnimatedShow);
 
     // -> showing rubber band
-    stateAnimatedShow->addTransition(&animation, &QPropertyAnimation::finished, stateShowingRubberBand);
-    stateAnimateDeflate->addTransition(&animation, &QPropertyAnimation::finished, stateShowingRubberBand);
+    stateAnimatedShow->addTransition(this, &AnimatedRubberBand::animationFinished, stateShowingRubberBand);
+    stateAnimateDeflate->addTransition(this, &AnimatedRubberBand::animationFinished, stateShowingRubberBand);
 
     // -> animate hide
     stateAnimatedShow->addTransition(q, &AnimatedIndicators::notHovered, stateAnimateHide);
@@ -229,7 +328,7 @@ AnimatedRubberBand::AnimatedRubberBand(DropIndicatorOverlayInterface::DropLocati
     stateAnimateInflated->addTransition(q, &AnimatedIndicators::notHovered, stateAnimateHide);
 
     // -> none
-    stateAnimateHide->addTransition(&animation, &QPropertyAnimation::finished, stateNone);
+    stateAnimateHide->addTransition(this, &AnimatedRubberBand::animationFinished, stateNone);
 
     // -> animate inflate
     stateAnimatedShow->addTransition(this, &AnimatedRubberBand::hovered, stateAnimateInflate);
@@ -238,7 +337,7 @@ AnimatedRubberBand::AnimatedRubberBand(DropIndicatorOverlayInterface::DropLocati
     stateNone->addTransition(this, &AnimatedRubberBand::hovered, stateAnimateInflate);
 
     // -> inflated
-    stateAnimateInflate->addTransition(&animation, &QPropertyAnimation::finished, stateAnimateInflated);
+    stateAnimateInflate->addTransition(this, &AnimatedRubberBand::animationFinished, stateAnimateInflated);
 
     // -> animate deflate
     stateAnimateInflate->addTransition(this, &AnimatedRubberBand::notHovered, stateAnimateDeflate);
@@ -263,13 +362,12 @@ bool AnimatedRubberBand::hover(QPoint globalPos)
 
 void AnimatedRubberBand::setLengthAnimated(const QVariant &value)
 {
-    animation.setStartValue(length());
-    animation.setEndValue(value);
-    animation.start();
+    q->animationClock()->start(this, value);
 }
 
 AnimatedIndicators::AnimatedIndicators(DropArea *dropArea)
     : DropIndicatorOverlayInterface(dropArea)
+    , m_animationClock(new AnimationClock(this))
     , m_outterLeftRubberBand(new AnimatedOutterRubberBand(Qt::Vertical, DropIndicatorOverlayInterface::DropLocation_OutterLeft, this))
     , m_outterRightRubberBand(new AnimatedOutterRubberBand(Qt::Vertical, DropIndicatorOverlayInterface::DropLocation_OutterRight, this))
     , m_outterTopRubberBand(new AnimatedOutterRubberBand(Qt::Horizontal, DropIndicatorOverlayInterface::DropLocation_OutterTop, this))
@@ -356,6 +454,12 @@ QPoint AnimatedIndicators::posForIndicator(DropIndicatorOverlayInterface::DropLo
 
 void AnimatedIndicators::onHoveredFrameChanged(Frame *frame)
 {
+    // Whatever the inner rubber bands were doing was relative to the previous frame, don't let it play out
+    const AnimatedRubberBand::List innerRubberBands = { m_centerRubberBand, m_innerLeftRubberBand, m_innerRightRubberBand,
+                                                        m_innerTopRubberBand, m_innerBottomRubberBand };
+    for (AnimatedRubberBand *rubberBand : innerRubberBands)
+        m_animationClock->finish(rubberBand);
+
     if (frame) {
         Item *item = m_dropArea->multiSplitterLayout()->itemForFrame(frame);
         AnchorGroup group = item->anchorGroup();
@@ -387,7 +491,6 @@ AnimatedCenterRubberBand::AnimatedCenterRubberBand(AnimatedIndicators *parent)
     connect(q, &AnimatedIndicators::hoveredFrameChanged, this, [this] (Frame *f) {
         hoveredFrame = f;
     });
-    animation.setPropertyName("length"); // delayed, since the getters are virtual
 }
 
 void AnimatedCenterRubberBand::animatedInitialShow()
@@ -456,7 +559,6 @@ AnimatedOutterRubberBand::AnimatedOutterRubberBand(Qt::Orientation orient,
     : AnimatedRubberBand(location, parent_)
     , orientation(orient)
 {
-    animation.setPropertyName("length"); // delayed, since the getters are virtual
 }
 
 void AnimatedOutterRubberBand::animatedInitialShow()
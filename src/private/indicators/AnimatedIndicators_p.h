@@ -25,14 +25,62 @@
 
 #include <QRubberBand>
 #include <QList>
-#include <QPropertyAnimation>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QEasingCurve>
 
 namespace KDDockWidgets {
 
 class Anchor;
 class AnimatedIndicators;
+class AnimatedRubberBand;
+
+/**
+ * @brief Drives the animations of all the rubber bands of an AnimatedIndicators with a single timer.
+ *
+ * Each rubber band has at most one animation, starting a new one replaces it. So moving quickly
+ * across many frames doesn't accumulate animations, and there's only one geometry change per
+ * rubber band per tick.
+ */
+class DOCKS_EXPORT_FOR_UNIT_TESTS AnimationClock : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AnimationClock(QObject *parent = nullptr);
+
+    ///@brief Animates the length of @p band from its current value to @p endValue
+    void start(AnimatedRubberBand *band, const QVariant &endValue);
+
+    ///@brief Jumps to the end of @p band's animation, if it's running. AnimatedRubberBand::animationFinished() is still emitted.
+    void finish(AnimatedRubberBand *band);
+
+    ///@brief Returns whether @p band's length is being animated
+    bool isAnimating(const AnimatedRubberBand *band) const;
+
+    ///@brief Caps how many times per second the rubber bands are updated. Defaults to 60.
+    void setMaxFps(int fps);
+    int maxFps() const { return m_maxFps; }
+
+private:
+    void tick();
+
+    struct Animation {
+        AnimatedRubberBand *band;
+        QVariant startValue;
+        QVariant endValue;
+        qint64 startTime;
+    };
+
+    QVector<Animation> m_animations;
+    QTimer m_timer;
+    QElapsedTimer m_time;
+    QEasingCurve m_easingCurve = QEasingCurve::OutBack;
+    int m_duration = 500;
+    int m_maxFps = 60;
+};
 
-class AnimatedRubberBand : public QRubberBand
+class DOCKS_EXPORT_FOR_UNIT_TESTS AnimatedRubberBand : public QRubberBand
 {
     Q_OBJECT
     Q_PROPERTY(QVariant length READ length WRITE setLength) // clazy:exclude=qproperty-without-notify
@@ -62,7 +110,6 @@ public:
     void setLengthAnimated(const QVariant &value);
     bool inflated = false;
     const DropIndicatorOverlayInterface::DropLocation dropLocation;
-    QPropertyAnimation animation;
     AnimatedIndicators *const q;
     QPointer<Frame> hoveredFrame;
 };
@@ -118,7 +165,7 @@ public:
     void updatePosition() override;
 };
 
-class AnimatedIndicators : public DropIndicatorOverlayInterface
+class DOCKS_EXPORT_FOR_UNIT_TESTS AnimatedIndicators : public DropIndicatorOverlayInterface
 {
     Q_OBJECT
 public:
@@ -130,6 +177,7 @@ public:
     void updateRubberBandPositions();
     bool allRubberBandsAreHidden() const;
     QPoint posForIndicator(DropLocation) const override;
+    AnimationClock *animationClock() const { return m_animationClock; }
 Q_SIGNALS:
     void hovered();
     void notHovered();
@@ -137,6 +185,7 @@ private:
     friend class AnimationState_None;
     friend class AnimationStateBase;
     void onHoveredFrameChanged(Frame *) override;
+    AnimationClock *const m_animationClock; // Before the rubber bands, as they use it
     AnimatedOutterRubberBand *const m_outterLeftRubberBand;
     AnimatedOutterRubberBand *const m_outterRightRubberBand;
     AnimatedOutterRubberBand *const m_outterTopRubberBand;
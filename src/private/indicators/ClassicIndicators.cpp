@@ -26,6 +26,7 @@
 #include "Utils_p.h"
 
 #include <QPainter>
+#include <QPixmapCache>
 #include <QRubberBand>
 
 #define INDICATOR_WIDTH 40
@@ -40,12 +41,13 @@ class IndicatorWindow;
 
 void Indicator::paintEvent(QPaintEvent *)
 {
-    QPainter p(this);
-    if (m_hovered)
-        p.drawImage(rect(), m_imageActive, rect());
-    else
-        p.drawImage(rect(), m_image, rect());
+    const qreal dpr = devicePixelRatioF();
+    QPixmap &pm = m_hovered ? m_pixmapActive : m_pixmap;
+    if (pm.isNull() || !qFuzzyCompare(pm.devicePixelRatio(), dpr))
+        pm = pixmap(m_dropLocation, /*active=*/ m_hovered, dpr);
 
+    QPainter p(this);
+    p.drawPixmap(0, 0, pm);
 }
 
 void Indicator::setHovered(bool hovered)
@@ -61,13 +63,13 @@ void Indicator::setHovered(bool hovered)
     }
 }
 
-QString Indicator::iconName(bool active) const
+QString Indicator::iconName(ClassicIndicators::DropLocation location, bool active)
 {
     QString suffix = active ? QStringLiteral("_active")
                             : QString();
 
     QString name;
-    switch (m_dropLocation) {
+    switch (location) {
     case DropIndicatorOverlayInterface::DropLocation_Center:
         name = QStringLiteral("center");
         break;
@@ -102,13 +104,29 @@ QString Indicator::iconName(bool active) const
     return name + suffix;
 }
 
-QString Indicator::iconFileName(bool active) const
+QString Indicator::iconFileName(ClassicIndicators::DropLocation location, bool active)
 {
-    const QString name = iconName(active);
+    const QString name = iconName(location, active);
     return KDDockWidgets::windowManagerHasTranslucency() ? QStringLiteral(":/img/classic_indicators/%1.png").arg(name)
                                                          : QStringLiteral(":/img/classic_indicators/opaque/%1.png").arg(name);
 }
 
+QPixmap Indicator::pixmap(ClassicIndicators::DropLocation location, bool active, qreal devicePixelRatio)
+{
+    const QString fileName = iconFileName(location, active);
+    const QString key = QStringLiteral("kddockwidgets_indicator_%1@%2").arg(fileName).arg(devicePixelRatio);
+
+    QPixmap pm;
+    if (!QPixmapCache::find(key, &pm)) {
+        const int size = qRound(INDICATOR_WIDTH * devicePixelRatio);
+        pm = QPixmap::fromImage(QImage(fileName).scaled(size, size));
+        pm.setDevicePixelRatio(devicePixelRatio);
+        QPixmapCache::insert(key, pm);
+    }
+
+    return pm;
+}
+
 IndicatorWindow::IndicatorWindow(ClassicIndicators *classicIndicators_, QWidget *)
     : QWidget(nullptr, Qt::Tool | Qt::BypassWindowManagerHint)
     , classicIndicators(classicIndicators_)
@@ -136,6 +154,8 @@ bool IndicatorWindow::event(QEvent *e)
 {
     if (e->type() == QEvent::Show) {
         updatePosition();
+    } else if (e->type() == QEvent::Move) {
+        invalidateHitRegions();
     }
 
     return QWidget::event(e);
@@ -180,7 +200,10 @@ void IndicatorWindow::updateMask()
         }
     }
 
-    setMask(region);
+    if (region != m_mask) {
+        m_mask = region;
+        setMask(region);
+    }
 }
 
 void IndicatorWindow::resizeEvent(QResizeEvent *ev)
@@ -203,15 +226,29 @@ void IndicatorWindow::updateIndicatorVisibility(bool visible)
     for (Indicator *indicator : { m_outterTop, m_outterLeft, m_outterRight, m_outterBottom })
         indicator->setVisible(outterShouldBeVisible);
 
+    invalidateHitRegions();
     updateMask();
 }
 
+void IndicatorWindow::invalidateHitRegions()
+{
+    m_hitRegionsDirty = true;
+}
+
 void IndicatorWindow::hover(QPoint globalPos)
 {
-    for (Indicator *indicator : qAsConst(m_indicators)) {
-        if (indicator->isVisible())
-            indicator->setHovered(indicator->rect().contains(indicator->mapFromGlobal(globalPos)));
+    if (m_hitRegionsDirty) {
+        m_hitRegionsDirty = false;
+        m_hitRegions.clear();
+        const QPoint windowPos = geometry().topLeft();
+        for (Indicator *indicator : qAsConst(m_indicators)) {
+            if (indicator->isVisible())
+                m_hitRegions.push_back({ indicator, indicator->geometry().translated(windowPos) });
+        }
     }
+
+    for (const HitRegion &region : qAsConst(m_hitRegions))
+        region.indicator->setHovered(region.globalRect.contains(globalPos));
 }
 
 void IndicatorWindow::updatePosition()
@@ -219,12 +256,27 @@ void IndicatorWindow::updatePosition()
     QRect rect = classicIndicators->rect();
     QPoint pos = classicIndicators->mapToGlobal(QPoint(0, 0));
     rect.moveTo(pos);
-    setGeometry(rect);
+    if (rect != geometry()) {
+        setGeometry(rect);
+        invalidateHitRegions();
+    }
 }
 
 void IndicatorWindow::updatePositions()
 {
     QRect r = rect();
+    Frame *hoveredFrame = classicIndicators->m_hoveredFrame;
+    const QRect hoveredRect = hoveredFrame ? hoveredFrame->geometry() : QRect();
+
+    // Hovering over the same frame again doesn't move anything
+    if (m_positionsValid && r == m_positionedRect && hoveredRect == m_positionedFrameRect)
+        return;
+
+    m_positionsValid = true;
+    m_positionedRect = r;
+    m_positionedFrameRect = hoveredRect;
+    invalidateHitRegions();
+
     const int indicatorWidth = m_outterBottom->width();
     const int halfIndicatorWidth = m_outterBottom->width() / 2;
 
@@ -232,9 +284,7 @@ void IndicatorWindow::updatePositions()
     m_outterBottom->move(r.center().x() - halfIndicatorWidth, r.y() + height() - indicatorWidth - OUTTER_INDICATOR_MARGIN);
     m_outterTop->move(r.center().x() - halfIndicatorWidth, r.y() + OUTTER_INDICATOR_MARGIN);
     m_outterRight->move(r.x() + width() - indicatorWidth - OUTTER_INDICATOR_MARGIN, r.center().y() - halfIndicatorWidth);
-    Frame *hoveredFrame = classicIndicators->m_hoveredFrame;
     if (hoveredFrame) {
-        QRect hoveredRect = hoveredFrame->geometry();
         m_center->move(r.topLeft() + hoveredRect.center() - QPoint(halfIndicatorWidth, halfIndicatorWidth));
         m_top->move(m_center->pos() - QPoint(0, indicatorWidth + OUTTER_INDICATOR_MARGIN));
         m_right->move(m_center->pos() + QPoint(indicatorWidth + OUTTER_INDICATOR_MARGIN, 0));
@@ -248,9 +298,8 @@ Indicator::Indicator(ClassicIndicators *classicIndicators, IndicatorWindow *pare
     , q(classicIndicators)
     , m_dropLocation(location)
 {
-    m_image = QImage(iconFileName(/*active=*/ false)).scaled(INDICATOR_WIDTH, INDICATOR_WIDTH);
-    m_imageActive = QImage(iconFileName(/*active=*/ true)).scaled(INDICATOR_WIDTH, INDICATOR_WIDTH);
-    setFixedSize(m_image.size());
+    // The icons are only loaded when first painted, and then shared through QPixmapCache
+    setFixedSize(INDICATOR_WIDTH, INDICATOR_WIDTH);
     setVisible(true);
 }
 
@@ -285,6 +334,14 @@ QPoint ClassicIndicators::posForIndicator(DropIndicatorOverlayInterface::DropLoc
     return indicator->mapToGlobal(indicator->rect().center());
 }
 
+void ClassicIndicators::warmUp()
+{
+    // winId() creates the native window without showing it
+    m_indicatorWindow->winId();
+    if (rubberBandIsTopLevel())
+        m_rubberBand->winId();
+}
+
 void ClassicIndicators::updateVisibility()
 {
     if (isHovered()) {
@@ -392,8 +449,7 @@ void ClassicIndicators::setDropLocation(ClassicIndicators::DropLocation location
         break;
     }
 
-    QRect rect = layout->rectForDrop(m_windowBeingDragged, multisplitterLocation,
-                                     layout->itemForFrame(relativeToFrame));
+    const QRect rect = rectForDrop(multisplitterLocation, relativeToFrame);
 
     m_rubberBand->setGeometry(geometryForRubberband(rect));
     m_rubberBand->setVisible(true);
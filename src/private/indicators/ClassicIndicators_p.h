@@ -41,6 +41,7 @@ public:
     Type indicatorType() const override;
     void hover(QPoint globalPos) override;
     QPoint posForIndicator(DropLocation) const override;
+    void warmUp() override;
 protected:
     void showEvent(QShowEvent *) override;
     void hideEvent(QHideEvent *) override;
@@ -78,6 +79,26 @@ public:
     void updateMask();
 
     ClassicIndicators *const classicIndicators;
+
+    // The region last passed to setMask(), setting the same mask again still costs a round-trip to the window system
+    QRegion m_mask;
+
+    ///@brief Marks the hit regions as stale. Called whenever an indicator or the window moves, or visibility changes
+    void invalidateHitRegions();
+
+    // The global rect of each visible indicator, so hover() doesn't map the cursor into every indicator
+    struct HitRegion {
+        Indicator *indicator;
+        QRect globalRect;
+    };
+    QVector<HitRegion> m_hitRegions;
+    bool m_hitRegionsDirty = true;
+
+    // What updatePositions() last laid out for, indicators only depend on the window rect and the hovered frame's geometry
+    QRect m_positionedRect;
+    QRect m_positionedFrameRect;
+    bool m_positionsValid = false;
+
     Indicator *const m_center;
     Indicator *const m_left;
     Indicator *const m_right;
@@ -99,11 +120,15 @@ public:
     void paintEvent(QPaintEvent *) override;
 
     void setHovered(bool hovered);
-    QString iconName(bool active) const;
-    QString iconFileName(bool active) const;
+    static QString iconName(ClassicIndicators::DropLocation, bool active);
+    static QString iconFileName(ClassicIndicators::DropLocation, bool active);
+
+    ///@brief returns the icon, scaled for @p devicePixelRatio. It's shared by all indicators of all drop areas
+    static QPixmap pixmap(ClassicIndicators::DropLocation, bool active, qreal devicePixelRatio);
 
-    QImage m_image;
-    QImage m_imageActive;
+    // What we painted last, so hovering only has to blit
+    QPixmap m_pixmap;
+    QPixmap m_pixmapActive;
     ClassicIndicators *const q;
     bool m_hovered = false;
     const ClassicIndicators::DropLocation m_dropLocation;
@@ -0,0 +1,263 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "OverlayIndicators_p.h"
+#include "ClassicIndicators_p.h"
+#include "DropArea_p.h"
+#include "Frame_p.h"
+#include "Logging_p.h"
+#include "Utils_p.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+
+#define INDICATOR_WIDTH 40
+#define OUTTER_INDICATOR_MARGIN 10
+
+using namespace KDDockWidgets;
+
+OverlayWindow::OverlayWindow(OverlayIndicators *overlayIndicators)
+    : QWidget(nullptr, Qt::Tool | Qt::BypassWindowManagerHint)
+    , q(overlayIndicators)
+{
+    setWindowFlag(Qt::FramelessWindowHint, true);
+    setAttribute(Qt::WA_TranslucentBackground);
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setObjectName(QStringLiteral("_docks_IndicatorWindow_Overlay")); // So DragController doesn't consider it a drop target
+}
+
+void OverlayWindow::paintEvent(QPaintEvent *ev)
+{
+    QPainter p(this);
+    p.setClipRegion(ev->region());
+
+    if (!q->m_rubberBandRect.isNull()) {
+        const QColor highlight = palette().color(QPalette::Highlight);
+        QColor fill = highlight;
+        fill.setAlpha(KDDockWidgets::windowManagerHasTranslucency() ? 100 : 255);
+        p.fillRect(q->m_rubberBandRect, fill);
+        p.setPen(highlight);
+        p.drawRect(q->m_rubberBandRect.adjusted(0, 0, -1, -1));
+    }
+
+    const qreal dpr = devicePixelRatioF();
+    for (DropIndicatorOverlayInterface::DropLocation location : q->visibleIndicators()) {
+        const QRect r = q->indicatorRect(location);
+        if (ev->region().intersects(r)) {
+            const bool hovered = location == q->currentDropLocation();
+            p.drawPixmap(r.topLeft(), Indicator::pixmap(location, hovered, dpr));
+        }
+    }
+}
+
+OverlayIndicators::OverlayIndicators(DropArea *dropArea)
+    : DropIndicatorOverlayInterface(dropArea) // Is parented on the drop-area, not a toplevel.
+    , m_window(new OverlayWindow(this)) // Top-level so the indicators can appear above the window being dragged.
+{
+    setVisible(false);
+}
+
+OverlayIndicators::~OverlayIndicators()
+{
+    delete m_window;
+}
+
+DropIndicatorOverlayInterface::Type OverlayIndicators::indicatorType() const
+{
+    return TypeOverlay;
+}
+
+void OverlayIndicators::hover(QPoint globalPos)
+{
+    const DropLocation location = indicatorAt(m_dropArea->mapFromGlobal(globalPos));
+    if (location != currentDropLocation())
+        setDropLocation(location);
+}
+
+QPoint OverlayIndicators::posForIndicator(DropIndicatorOverlayInterface::DropLocation loc) const
+{
+    return m_dropArea->mapToGlobal(indicatorRect(loc).center());
+}
+
+void OverlayIndicators::warmUp()
+{
+    // winId() creates the native window without showing it
+    m_window->winId();
+}
+
+void OverlayIndicators::updateVisibility()
+{
+    if (isHovered()) {
+        QRect rect = m_dropArea->rect();
+        rect.moveTo(m_dropArea->mapToGlobal(QPoint(0, 0)));
+        if (m_window->geometry() != rect)
+            m_window->setGeometry(rect);
+
+        updateMask();
+        m_window->update();
+        if (!m_window->isVisible())
+            m_window->show();
+        m_window->raise();
+    } else {
+        m_rubberBandRect = QRect();
+        m_window->hide();
+    }
+}
+
+void OverlayIndicators::onHoveredFrameChanged(Frame *)
+{
+    // The inner indicators follow the hovered frame, which updateVisibility() already repainted.
+    // Drop the drop location too, it might have been relative to the previous frame.
+    if (currentDropLocation() != DropLocation_None)
+        setDropLocation(DropLocation_None);
+}
+
+QVector<DropIndicatorOverlayInterface::DropLocation> OverlayIndicators::visibleIndicators() const
+{
+    QVector<DropLocation> result;
+    if (!isHovered())
+        return result;
+
+    if (m_hoveredFrame) {
+        result << DropLocation_Center << DropLocation_Left << DropLocation_Right
+               << DropLocation_Top << DropLocation_Bottom;
+    }
+
+    if (!(m_hoveredFrame && m_hoveredFrame->isTheOnlyFrame())) {
+        result << DropLocation_OutterLeft << DropLocation_OutterRight
+               << DropLocation_OutterTop << DropLocation_OutterBottom;
+    }
+
+    return result;
+}
+
+QRect OverlayIndicators::indicatorRect(DropLocation location) const
+{
+    // Same positions as ClassicIndicators
+    const QRect r = m_dropArea->rect();
+    const int halfIndicatorWidth = INDICATOR_WIDTH / 2;
+    const int distance = INDICATOR_WIDTH + OUTTER_INDICATOR_MARGIN;
+    const QPoint center = m_hoveredFrame ? m_hoveredFrame->geometry().center() - QPoint(halfIndicatorWidth, halfIndicatorWidth)
+                                         : QPoint();
+
+    QPoint topLeft;
+    switch (location) {
+    case DropLocation_OutterLeft:
+        topLeft = QPoint(r.x() + OUTTER_INDICATOR_MARGIN, r.center().y() - halfIndicatorWidth);
+        break;
+    case DropLocation_OutterBottom:
+        topLeft = QPoint(r.center().x() - halfIndicatorWidth, r.y() + r.height() - INDICATOR_WIDTH - OUTTER_INDICATOR_MARGIN);
+        break;
+    case DropLocation_OutterTop:
+        topLeft = QPoint(r.center().x() - halfIndicatorWidth, r.y() + OUTTER_INDICATOR_MARGIN);
+        break;
+    case DropLocation_OutterRight:
+        topLeft = QPoint(r.x() + r.width() - INDICATOR_WIDTH - OUTTER_INDICATOR_MARGIN, r.center().y() - halfIndicatorWidth);
+        break;
+    case DropLocation_Center:
+        topLeft = center;
+        break;
+    case DropLocation_Top:
+        topLeft = center - QPoint(0, distance);
+        break;
+    case DropLocation_Right:
+        topLeft = center + QPoint(distance, 0);
+        break;
+    case DropLocation_Bottom:
+        topLeft = center + QPoint(0, distance);
+        break;
+    case DropLocation_Left:
+        topLeft = center - QPoint(distance, 0);
+        break;
+    case DropLocation_None:
+        return QRect();
+    }
+
+    return QRect(topLeft, QSize(INDICATOR_WIDTH, INDICATOR_WIDTH));
+}
+
+DropIndicatorOverlayInterface::DropLocation OverlayIndicators::indicatorAt(QPoint localPos) const
+{
+    for (DropLocation location : visibleIndicators()) {
+        if (indicatorRect(location).contains(localPos))
+            return location;
+    }
+
+    return DropLocation_None;
+}
+
+void OverlayIndicators::setDropLocation(DropLocation location)
+{
+    qCDebug(overlay) << "OverlayIndicators::setDropLocation" << location;
+
+    // Only repaint the indicators whose hovered state changed and the old and new rubber band
+    QRegion dirty(m_rubberBandRect);
+    dirty += indicatorRect(currentDropLocation());
+
+    setCurrentDropLocation(location);
+
+    switch (location) {
+    case DropLocation_None:
+        m_rubberBandRect = QRect();
+        break;
+    case DropLocation_Center:
+        m_rubberBandRect = m_hoveredFrame ? m_hoveredFrame->geometry() : m_dropArea->rect();
+        break;
+    case DropLocation_Left:
+    case DropLocation_Top:
+    case DropLocation_Right:
+    case DropLocation_Bottom:
+        if (!m_hoveredFrame) {
+            qWarning() << Q_FUNC_INFO << "frame is null. location=" << location;
+            m_rubberBandRect = QRect();
+            break;
+        }
+        m_rubberBandRect = rectForDrop(multisplitterLocationFor(location), m_hoveredFrame);
+        break;
+    case DropLocation_OutterLeft:
+    case DropLocation_OutterTop:
+    case DropLocation_OutterRight:
+    case DropLocation_OutterBottom:
+        m_rubberBandRect = rectForDrop(multisplitterLocationFor(location), nullptr);
+        break;
+    }
+
+    dirty += m_rubberBandRect;
+    dirty += indicatorRect(location);
+
+    updateMask();
+    m_window->update(dirty);
+}
+
+void OverlayIndicators::updateMask()
+{
+    // When the compositor doesn't support translucency, we use a mask instead. Only happens on Linux.
+    QRegion region;
+    if (!KDDockWidgets::windowManagerHasTranslucency()) {
+        for (DropLocation location : visibleIndicators())
+            region += indicatorRect(location);
+        region += m_rubberBandRect;
+    }
+
+    if (region != m_window->m_mask) {
+        m_window->m_mask = region;
+        m_window->setMask(region);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Drop indicators painted into a single top-level window, rubber band included.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_INDICATORS_OVERLAYINDICATORS_P_H
+#define KD_INDICATORS_OVERLAYINDICATORS_P_H
+
+#include "DropIndicatorOverlayInterface_p.h"
+
+#include <QRegion>
+
+namespace KDDockWidgets {
+
+class OverlayWindow;
+
+/**
+ * @brief Looks like ClassicIndicators, but doesn't use a widget per indicator nor a QRubberBand.
+ *
+ * Everything is painted by one translucent top-level covering the drop area, so hovering only
+ * repaints the parts that changed and never moves or shows widgets. Select it with
+ * DefaultWidgetFactory::s_dropIndicatorType.
+ */
+class OverlayIndicators : public DropIndicatorOverlayInterface
+{
+    Q_OBJECT
+public:
+    explicit OverlayIndicators(DropArea *dropArea);
+    ~OverlayIndicators() override;
+    Type indicatorType() const override;
+    void hover(QPoint globalPos) override;
+    QPoint posForIndicator(DropLocation) const override;
+    void warmUp() override;
+protected:
+    void updateVisibility() override;
+    void onHoveredFrameChanged(Frame *) override;
+private:
+    friend class KDDockWidgets::OverlayWindow;
+
+    ///@brief returns the indicators which should be shown for the current hovered frame
+    QVector<DropLocation> visibleIndicators() const;
+
+    ///@brief returns where the indicator for @p location is, in drop area coordinates
+    QRect indicatorRect(DropLocation location) const;
+
+    DropLocation indicatorAt(QPoint localPos) const;
+    void setDropLocation(DropLocation);
+    void updateMask();
+
+    OverlayWindow *const m_window;
+    QRect m_rubberBandRect; // In drop area coordinates, null when there's no rubber band
+};
+
+class OverlayWindow : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit OverlayWindow(OverlayIndicators *overlayIndicators);
+protected:
+    void paintEvent(QPaintEvent *) override;
+private:
+    friend class KDDockWidgets::OverlayIndicators;
+    OverlayIndicators *const q;
+
+    // The region last passed to setMask(), see IndicatorWindow::m_mask
+    QRegion m_mask;
+};
+
+}
+
+#endif
@@ -22,14 +22,23 @@
 #include "MultiSplitterLayout_p.h"
 #include "MultiSplitter_p.h"
 #include "Logging_p.h"
+#include "Stats_p.h"
+#include "EventLog_p.h"
 #include "LayoutSaver.h"
 #include "Config.h"
 #include "Separator_p.h"
+#include "Frame_p.h"
+#include "DockRegistry_p.h"
 #include "FrameworkWidgetFactory.h"
 
 #include <QRubberBand>
 #include <QApplication>
 #include <QDebug>
+#include <QPainter>
+#include <QPixmap>
+#include <QTimer>
+
+#include <algorithm>
 
 #ifdef Q_OS_WIN
 # include <Windows.h>
@@ -37,6 +46,155 @@
 
 using namespace KDDockWidgets;
 
+namespace KDDockWidgets {
+/**
+ * @brief Used by Flag_LazyResizeLivePreview. Shows snapshots of the frames next to a separator
+ * being dragged, scaled to where they'd be, so we don't relayout them at every mouse move.
+ */
+class LazyResizePreview : public QWidget // clazy:exclude=missing-qobject-macro
+{
+public:
+    LazyResizePreview(Anchor *anchor, QWidget *parent)
+        : QWidget(parent)
+        , m_anchor(anchor)
+    {
+        setAttribute(Qt::WA_TransparentForMouseEvents);
+        setAutoFillBackground(true);
+        hide();
+
+        m_idleTimer.setSingleShot(true);
+        QObject::connect(&m_idleTimer, &QTimer::timeout, this, [this] {
+            // The mouse is resting, do the real resize and keep previewing from there
+            const int pos = m_position;
+            stop();
+            m_anchor->setPosition(pos);
+            start();
+        });
+    }
+
+    ///@brief grabs the frames on both sides of the anchor and covers them with their snapshots
+    void start()
+    {
+        m_snapshots.clear();
+        QRect area = m_anchor->separatorWidget()->geometry();
+        m_separatorPixmap = m_anchor->separatorWidget()->grab();
+
+        for (Anchor::Side side : { Anchor::Side1, Anchor::Side2 }) {
+            for (Item *item : m_anchor->items(side)) {
+                Frame *frame = item->frame();
+                if (item->isPlaceholder() || !frame)
+                    continue;
+
+                const QRect geo = item->geometry();
+                m_snapshots.push_back({ frame->grab(), geo, side });
+                area = area.united(geo);
+            }
+        }
+
+        setGeometry(area);
+        m_position = m_anchor->position();
+        raise();
+        show();
+    }
+
+    void stop()
+    {
+        m_idleTimer.stop();
+        hide();
+        m_snapshots.clear();
+        m_separatorPixmap = QPixmap();
+    }
+
+    void setPosition(int pos)
+    {
+        m_position = pos;
+        update();
+
+        const int idleInterval = Config::self().lazyResizeIdleInterval();
+        if (idleInterval > 0)
+            m_idleTimer.start(idleInterval);
+    }
+
+protected:
+    void paintEvent(QPaintEvent *) override
+    {
+        QPainter p(this);
+        p.translate(-pos());
+
+        const bool isVertical = m_anchor->isVertical();
+        const int thickness = m_anchor->thickness();
+        for (const Snapshot &snapshot : qAsConst(m_snapshots)) {
+            // The anchor only moves the edge that touches it
+            QRect target = snapshot.geometry;
+            if (snapshot.side == Anchor::Side1) {
+                if (isVertical)
+                    target.setRight(m_position - 1);
+                else
+                    target.setBottom(m_position - 1);
+            } else {
+                if (isVertical)
+                    target.setLeft(m_position + thickness);
+                else
+                    target.setTop(m_position + thickness);
+            }
+
+            if (target.isValid())
+                p.drawPixmap(target, snapshot.pixmap);
+        }
+
+        QRect separatorGeo = m_anchor->separatorWidget()->geometry();
+        if (isVertical)
+            separatorGeo.moveLeft(m_position);
+        else
+            separatorGeo.moveTop(m_position);
+        p.drawPixmap(separatorGeo.topLeft(), m_separatorPixmap);
+    }
+
+private:
+    struct Snapshot {
+        QPixmap pixmap;
+        QRect geometry;
+        Anchor::Side side;
+    };
+
+    Anchor *const m_anchor;
+    QVector<Snapshot> m_snapshots;
+    QPixmap m_separatorPixmap;
+    QTimer m_idleTimer;
+    int m_position = 0;
+};
+}
+
+namespace {
+/**
+ * @brief The geometry accessors an anchor of a given orientation uses.
+ *
+ * The per-item loops that run on every setPosition() are instantiated for each orientation,
+ * so they don't branch on it for every item.
+ * Vertical anchors are positioned along x and separate items laid out side by side.
+ */
+template <Qt::Orientation>
+struct OrientationTraits;
+
+template <>
+struct OrientationTraits<Qt::Vertical>
+{
+    static int length(const Item *item) { return item->width(); }
+    static int length(QSize sz) { return sz.width(); }
+    static void setSide1Edge(QRect &geo, int edge) { geo.setLeft(edge); }
+    static void setSide2Edge(QRect &geo, int edge) { geo.setRight(edge); }
+};
+
+template <>
+struct OrientationTraits<Qt::Horizontal>
+{
+    static int length(const Item *item) { return item->height(); }
+    static int length(QSize sz) { return sz.height(); }
+    static void setSide1Edge(QRect &geo, int edge) { geo.setTop(edge); }
+    static void setSide2Edge(QRect &geo, int edge) { geo.setBottom(edge); }
+};
+}
+
 bool Anchor::s_isResizing = false;
 const QString Anchor::s_magicMarker = QStringLiteral("e520c60e-cf5d-4a30-b1a7-588d2c569851");
 
@@ -46,18 +204,43 @@ Anchor::Anchor(Qt::Orientation orientation, MultiSplitterLayout *multiSplitter,
     , m_type(type)
     , m_layout(multiSplitter)
     , m_separatorWidget(Config::self().frameworkWidgetFactory()->createSeparator(this, multiSplitter->multiSplitter()))
-    , m_lazyResize(Config::self().flags() & Config::Flag_LazyResize)
-    , m_lazyResizeRubberBand(m_lazyResize ? new QRubberBand(QRubberBand::Line, multiSplitter->multiSplitter()) : nullptr)
 {
     multiSplitter->insertAnchor(this);
+    KDDW_LOG_EVENT(LogEvent::AnchorCreated, this, orientation);
     connect(this, &QObject::objectNameChanged, m_separatorWidget, &QObject::setObjectName);
 }
 
 Anchor::~Anchor()
 {
+    KDDW_LOG_EVENT(LogEvent::AnchorDestroyed, this);
+    delete m_lazyResizePreview;
+    delete m_lazyResizeRubberBand;
     m_separatorWidget->setEnabled(false);
+    m_separatorWidget->clearAnchor();
     m_separatorWidget->deleteLater();
     qCDebug(multisplittercreation) << "~Anchor; this=" << this << "; m_to=" << m_to << "; m_from=" << m_from;
+
+    if (m_from)
+        m_from->m_dependents.removeOne(this);
+    if (m_to)
+        m_to->m_dependents.removeOne(this);
+    for (Anchor *dependent : qAsConst(m_dependents)) {
+        if (dependent->m_from == this)
+            dependent->m_from = nullptr;
+        if (dependent->m_to == this)
+            dependent->m_to = nullptr;
+    }
+
+    if (m_followee)
+        m_followee->m_followers.removeOne(this);
+    const List followers = m_followers;
+    for (Anchor *follower : followers)
+        follower->setFollowee(nullptr);
+
+    DockRegistry *registry = DockRegistry::self();
+    if (registry->isObservingLayoutChanges())
+        registry->cancelAnchorMoved(this);
+
     m_layout->removeAnchor(this);
     for (Item *item : items(Side1))
         item->anchorGroup().setAnchor(nullptr, m_orientation, Side1);
@@ -73,11 +256,13 @@ void Anchor::setFrom(Anchor *from)
         return;
     }
 
-    if (m_from)
-        disconnect(m_from, &Anchor::positionChanged, this, &Anchor::updateSize);
+    if (m_from && m_from != m_to)
+        m_from->m_dependents.removeOne(this);
     m_from = from;
-    connect(from, &Anchor::positionChanged, this, &Anchor::updateSize);
+    if (!from->m_dependents.contains(this))
+        from->m_dependents.push_back(this);
     updateSize();
+    m_layout->markForSanityCheck(this);
 
     Q_EMIT fromChanged();
 }
@@ -91,11 +276,13 @@ void Anchor::setTo(Anchor *to)
         return;
     }
 
-    if (m_to)
-        disconnect(m_to, &Anchor::positionChanged, this, &Anchor::updateSize);
+    if (m_to && m_to != m_from)
+        m_to->m_dependents.removeOne(this);
     m_to = to;
-    connect(to, &Anchor::positionChanged, this, &Anchor::updateSize);
+    if (!to->m_dependents.contains(this))
+        to->m_dependents.push_back(this);
     updateSize();
+    m_layout->markForSanityCheck(this);
 
     Q_EMIT toChanged();
 }
@@ -140,57 +327,63 @@ void Anchor::updateItemSizes()
 
     qCDebug(anchors) << Q_FUNC_INFO << this << "; o=" << orientation();
 
-    int position = this->position() + m_positionOffset;
-    for (Item *item : qAsConst(m_side2Items)) {
-        QRect geo = item->geometry();
+    if (isVertical())
+        updateItemSizes_impl<Qt::Vertical>();
+    else
+        updateItemSizes_impl<Qt::Horizontal>();
+}
 
-        const QPoint topLeft = isVertical() ? QPoint(position + thickness(), item->y())
-                                            : QPoint(item->x(), position + thickness());
+template <Qt::Orientation o>
+void Anchor::updateItemSizes_impl()
+{
+    using Traits = OrientationTraits<o>;
 
-        geo.setTopLeft(topLeft);
-        if (!item->isPlaceholder())
-            item->setGeometry(geo);
-    }
+    const int side2Edge = position() + m_positionOffset + thickness();
+    for (Item *item : qAsConst(m_side2Items)) {
+        if (item->isPlaceholder())
+            continue;
 
-    position = this->position() - m_positionOffset;
+        QRect geo = item->geometry();
+        Traits::setSide1Edge(geo, side2Edge);
+        item->setGeometry(geo);
+    }
 
+    // -1 as the widget is right next to the anchor, and not on top
+    const int side1Edge = position() - m_positionOffset - 1;
     for (Item *item : qAsConst(m_side1Items)) {
-        QRect geo = item->geometry();
+        if (item->isPlaceholder())
+            continue;
 
-        // -1 as the widget is right next to the anchor, and not on top
-        const QPoint bottomRight = isVertical() ? QPoint(position - 1, geo.bottom())
-                                                : QPoint(geo.right(), position - 1);
-        geo.setBottomRight(bottomRight);
-        if (!item->isPlaceholder()) {
-            item->setGeometry(geo);
-        }
+        QRect geo = item->geometry();
+        Traits::setSide2Edge(geo, side1Edge);
+        item->setGeometry(geo);
     }
 }
 
 void Anchor::debug_updateItemNames()
 {
-    // I call this in the unit-tests, when running them on gammaray
-
-    m_debug_side1ItemNames.clear();
-    m_debug_side2ItemNames.clear();
-
-    for (Item *item : qAsConst(m_side1Items))
-        m_debug_side1ItemNames += item->objectName() + QStringLiteral("; ");
+    // I call this in the unit-tests, when running them on gammaray.
+    // The names are computed when queried, this only tells the debug tools to query them again.
+    Q_EMIT debug_itemNamesChanged();
+}
 
-    for (Item *item : qAsConst(m_side2Items))
-        m_debug_side2ItemNames += item->objectName() + QStringLiteral("; ");
+static QString debug_itemNames(const AnchorItems &items)
+{
+    QString names;
+    for (Item *item : items)
+        names += item->objectName() + QStringLiteral("; ");
 
-    Q_EMIT debug_itemNamesChanged();
+    return names;
 }
 
 QString Anchor::debug_side1ItemNames() const
 {
-    return m_debug_side1ItemNames;
+    return debug_itemNames(m_side1Items);
 }
 
 QString Anchor::debug_side2ItemNames() const
 {
-    return m_debug_side2ItemNames;
+    return debug_itemNames(m_side2Items);
 }
 
 Qt::Orientation Anchor::orientation() const
@@ -200,8 +393,11 @@ Qt::Orientation Anchor::orientation() const
 
 void Anchor::setPosition(int p, SetPositionOptions options)
 {
+    KDDW_STATS_INCREMENT(anchorSetPositionCalls);
+    // Moving an anchor can move others, make sure each affected frame is only resized once
+    MultiSplitterLayout::FrameGeometryBatch frameGeometryBatch(m_layout);
     qCDebug(anchors) << Q_FUNC_INFO << this << "; visible="
-                     << m_separatorWidget->isVisible() << "; p=" << p;
+                     << m_separatorWidget->isShown() << "; p=" << p;
 
     const int max = m_layout->length(orientation()) - Anchor::thickness(true);
     const bool outOfBounds = max != -1 && (p < 0  || p > max);
@@ -227,6 +423,7 @@ void Anchor::setPosition(int p, SetPositionOptions options)
         return;
     }
 
+    KDDW_LOG_EVENT(LogEvent::AnchorMoved, this, position(), p);
     if (isVertical()) {
         m_geometry.moveLeft(p);
     } else {
@@ -249,7 +446,23 @@ void Anchor::setPosition(int p, SetPositionOptions options)
     // In that case the window will be resized shortly after
     //Q_ASSERT(p >= 0); - commented out, as it's normal
 
-    Q_EMIT positionChanged(position());
+    m_layout->markForSanityCheck(this);
+    m_layout->invalidateAnchorPositions();
+    DockRegistry::bumpLayoutGeneration();
+    DockRegistry *registry = DockRegistry::self();
+    if (registry->isObservingLayoutChanges())
+        registry->recordAnchorMoved(this, p);
+
+    // The anchors starting or ending at this one, and the items next to it, are updated with
+    // direct calls. positionChanged() is only a notification for outsiders, emitted when the batch ends.
+    for (Anchor *dependent : qAsConst(m_dependents))
+        dependent->updateSize();
+    m_layout->queuePositionChanged(this);
+
+    // Followers are moved directly too. Each one then moves its own followers, so the whole chain is updated in one pass.
+    for (Anchor *follower : qAsConst(m_followers))
+        follower->setPosition(position());
+
     updateItemSizes();
 }
 
@@ -288,12 +501,19 @@ int Anchor::minPosition() const
 
 int Anchor::smallestAvailableItemSqueeze(Anchor::Side side) const
 {
+    return isVertical() ? smallestAvailableItemSqueeze_impl<Qt::Vertical>(side)
+                        : smallestAvailableItemSqueeze_impl<Qt::Horizontal>(side);
+}
+
+template <Qt::Orientation o>
+int Anchor::smallestAvailableItemSqueeze_impl(Anchor::Side side) const
+{
+    using Traits = OrientationTraits<o>;
+
     int smallest = 0;
     bool firstElement = true;
     for (Item *item : items(side)) {
-        const int length = item->length(m_orientation);
-        const int minLength = item->minLength(m_orientation);
-        const int availableSqueeze = length - minLength;
+        const int availableSqueeze = Traits::length(item) - Traits::length(item->minimumSize());
         if (availableSqueeze < smallest || firstElement) {
             smallest = availableSqueeze;
             firstElement = false;
@@ -317,8 +537,8 @@ void Anchor::ensureBounded()
         }
     }
 
-    for (Item *item : items(Side2)) {
-        item->anchorAtSide(Side2, orientation())->ensureBounded();
+    for (Anchor *a : oppositeAnchors(Side2)) {
+        a->ensureBounded();
     }
 }
 
@@ -355,28 +575,28 @@ bool Anchor::hasItems(Anchor::Side side) const
 
 bool Anchor::onlyHasPlaceholderItems(Anchor::Side side) const
 {
-    auto &items = side == Side1 ? m_side1Items
-                                : m_side2Items;
-
-    for (Item *item : items) {
-        if (!item->isPlaceholder())
-            return false;
-    }
-
-    return true;
+    return numNonPlaceholderItems(side) == 0;
 }
 
 bool Anchor::hasNonPlaceholderItems(Anchor::Side side) const
 {
-    auto &items = side == Side1 ? m_side1Items
-                                : m_side2Items;
+    return numNonPlaceholderItems(side) > 0;
+}
 
-    for (Item *item : items) {
-        if (!item->isPlaceholder())
-            return true;
+int Anchor::numNonPlaceholderItems(Anchor::Side side) const
+{
+    Q_ASSERT(side != Side_None);
+    NonPlaceholderCountCache &cache = m_nonPlaceholderCountCache[side == Side1 ? 0 : 1];
+    const int generation = m_layout->sizeConstraintsGeneration();
+    if (cache.generation != generation) {
+        const AnchorItems &items = side == Side1 ? m_side1Items : m_side2Items;
+        cache.count = int(std::count_if(items.cbegin(), items.cend(), [] (Item *item) {
+            return !item->isPlaceholder();
+        }));
+        cache.generation = generation;
     }
 
-    return false;
+    return cache.count;
 }
 
 bool Anchor::containsItem(const Item *item, Anchor::Side side) const
@@ -400,16 +620,18 @@ bool Anchor::isStaticOrFollowsStatic() const
     return m_followee && m_followee->isStaticOrFollowsStatic();
 }
 
-const ItemList Anchor::items(Anchor::Side side) const
+const AnchorItems &Anchor::items(Anchor::Side side) const
 {
     switch (side) {
     case Side1:
         return m_side1Items;
     case Side2:
         return m_side2Items;
-    default:
+    default: {
         Q_ASSERT(false);
-        return {};
+        static const AnchorItems s_empty;
+        return s_empty;
+    }
     }
 }
 
@@ -523,13 +745,38 @@ int Anchor::cumulativeMinLength(Anchor::Side side) const
     return r;
 }
 
+const Anchor::List &Anchor::oppositeAnchors(Anchor::Side side) const
+{
+    Q_ASSERT(side != Side_None);
+    OppositeAnchorsCache &cache = m_oppositeAnchorsCache[side == Side1 ? 0 : 1];
+    const int generation = m_layout->anchorGraphGeneration();
+    if (cache.generation != generation) {
+        const AnchorItems &items = side == Side1 ? m_side1Items : m_side2Items;
+        cache.anchors.clear();
+        cache.anchors.reserve(items.size());
+        for (Item *item : items)
+            cache.anchors.push_back(item->anchorAtSide(side, orientation()));
+        cache.generation = generation;
+    }
+
+    return cache.anchors;
+}
+
 Anchor::CumulativeMin Anchor::cumulativeMinLength_recursive(Anchor::Side side) const
 {
+    // Each anchor caches its own result, so the recursion stops at the first anchor that didn't change
+    CumulativeMinCache &cache = m_cumulativeMinCache[side == Side1 ? 0 : 1];
+    const int generation = m_layout->sizeConstraintsGeneration();
+    if (cache.generation == generation)
+        return cache.value;
+
     const auto items = this->items(side);
+    const Anchor::List &oppositeAnchors = this->oppositeAnchors(side);
     CumulativeMin result = { 0, 0 };
 
-    for (auto item : items) {
-        Anchor *oppositeAnchor = item->anchorAtSide(side, orientation());
+    for (int i = 0, end = items.size(); i < end; ++i) {
+        Item *item = items.at(i);
+        Anchor *oppositeAnchor = oppositeAnchors.at(i);
         if (!oppositeAnchor) {
             // Shouldn't happen. But don't assert as this might be being called from a dumpDebug()
             qWarning() << Q_FUNC_INFO << "Null opposite anchor";
@@ -549,6 +796,8 @@ Anchor::CumulativeMin Anchor::cumulativeMinLength_recursive(Anchor::Side side) c
         }
     }
 
+    cache.value = result;
+    cache.generation = generation;
     return result;
 }
 
@@ -562,24 +811,20 @@ void Anchor::setFollowee(Anchor *followee)
                          << this << "; followee=" << followee;
 
     if (m_followee) {
-        disconnect(m_followee, &Anchor::positionChanged, this, &Anchor::onFolloweePositionChanged);
+        m_followee->m_followers.removeOne(this);
         disconnect(m_followee, &Anchor::thicknessChanged, this, &Anchor::setThickness);
-        disconnect(m_followeeDestroyedConnection);
     }
 
     m_followee = followee;
+    m_layout->markForSanityCheck(this);
     setThickness();
     if (m_followee) {
         Q_ASSERT(orientation() == m_followee->orientation());
         setVisible(false);
         setPosition(m_followee->position());
-        connect(m_followee, &Anchor::positionChanged, this, &Anchor::onFolloweePositionChanged);
+        // The followee moves us from now on, see setPosition(). And detaches us in its destructor.
+        m_followee->m_followers.push_back(this);
         connect(m_followee, &Anchor::thicknessChanged, this, &Anchor::setThickness);
-        m_followeeDestroyedConnection = connect(m_followee, &QObject::destroyed, this, [this] {
-            setFollowee(nullptr);
-        });
-
-
     } else {
         setVisible(true);
     }
@@ -587,15 +832,9 @@ void Anchor::setFollowee(Anchor *followee)
     Q_EMIT followeeChanged();
 }
 
-const Anchor::List Anchor::followers() const
+const Anchor::List &Anchor::followers() const
 {
-    Anchor::List result;
-    for (Anchor *a : m_layout->anchors()) {
-        if (a->followee() == this)
-            result.push_back(a);
-    }
-
-    return result;
+    return m_followers;
 }
 
 Anchor *Anchor::endFollowee() const
@@ -619,8 +858,7 @@ bool Anchor::findAnchor(Anchor *anchor, Anchor::Side side) const
     Q_ASSERT(anchor != this);
     Q_ASSERT(anchor->orientation() == orientation());
 
-    for (Item *item : items(side)) {
-        Anchor *a = item->anchorAtSide(side, orientation());
+    for (Anchor *a : oppositeAnchors(side)) {
         if (anchor == a)
             return true;
 
@@ -634,8 +872,7 @@ bool Anchor::findAnchor(Anchor *anchor, Anchor::Side side) const
 Anchor *Anchor::findNearestAnchorWithItems(Anchor::Side side) const
 {
     Anchor *candidate = nullptr;
-    for (Item *item : items(side)) {
-        Anchor *a = item->anchorAtSide(side, orientation());
+    for (Anchor *a : oppositeAnchors(side)) {
         if (!a->hasNonPlaceholderItems(side))
             a = a->findNearestAnchorWithItems(side);
 
@@ -655,12 +892,10 @@ void Anchor::clear()
 {
     m_side1Items.clear();
     m_side2Items.clear();
-}
 
-void Anchor::onFolloweePositionChanged(int pos)
-{
-    Q_ASSERT(isFollowing());
-    setPosition(pos);
+    // Doesn't emit itemsChanged, so the layout's generation might not change
+    m_nonPlaceholderCountCache[0].generation = -1;
+    m_nonPlaceholderCountCache[1].generation = -1;
 }
 
 int Anchor::thickness(bool staticAnchor)
@@ -672,6 +907,10 @@ void Anchor::setLayout(MultiSplitterLayout *layout)
 {
     m_layout->removeAnchor(this);
     m_layout = layout;
+    m_oppositeAnchorsCache[0].generation = -1; // Generations are per layout
+    m_oppositeAnchorsCache[1].generation = -1;
+    m_nonPlaceholderCountCache[0].generation = -1;
+    m_nonPlaceholderCountCache[1].generation = -1;
     setParent(layout->multiSplitter());
     m_separatorWidget->setParent(layout->multiSplitter());
     m_layout->insertAnchor(this);
@@ -708,6 +947,11 @@ void Anchor::setLazyPosition(int pos)
     if (m_lazyPosition != pos) {
         m_lazyPosition = pos;
 
+        if (m_lazyResizePreview && m_lazyResizePreview->isVisible()) {
+            m_lazyResizePreview->setPosition(pos);
+            return;
+        }
+
         QRect geo = m_separatorWidget->geometry();
         if (isVertical()) {
             geo.moveLeft(pos);
@@ -719,6 +963,37 @@ void Anchor::setLazyPosition(int pos)
     }
 }
 
+void Anchor::setThrottledPosition(int pos)
+{
+    m_lazyPosition = pos;
+
+    const int interval = 1000 / m_layout->resizeThrottleRate();
+    const qint64 elapsed = m_lastThrottledResize.isValid() ? m_lastThrottledResize.elapsed() : interval;
+    if (elapsed >= interval) {
+        applyThrottledPosition();
+        return;
+    }
+
+    if (!m_throttledResizeTimer) {
+        m_throttledResizeTimer = new QTimer(this);
+        m_throttledResizeTimer->setSingleShot(true);
+        connect(m_throttledResizeTimer, &QTimer::timeout, this, &Anchor::applyThrottledPosition);
+    }
+
+    // Only the latest position matters
+    if (!m_throttledResizeTimer->isActive())
+        m_throttledResizeTimer->start(interval - int(elapsed));
+}
+
+void Anchor::applyThrottledPosition()
+{
+    if (m_throttledResizeTimer)
+        m_throttledResizeTimer->stop();
+
+    m_lastThrottledResize.start();
+    setPosition(m_lazyPosition);
+}
+
 int Anchor::position(QPoint p) const
 {
     return isVertical() ? p.x() : p.y();
@@ -731,24 +1006,49 @@ void Anchor::addItem(Item *item, Anchor::Side side)
     if (!items.contains(item)) {
         items << item;
         item->anchorGroup().setAnchor(this, orientation(), side);
+        m_layout->markForSanityCheck(this);
+        m_layout->markForSanityCheck(item);
         Q_EMIT itemsChanged(side);
         updateItemSizes();
     }
 }
 
-void Anchor::addItems(const ItemList &list, Side side)
+void Anchor::addItems(const AnchorItems &list, Side side)
 {
     for (Item *item : list)
         addItem(item, side);
 }
 
+static bool removeOne(AnchorItems &items, Item *item)
+{
+    const int index = items.indexOf(item);
+    if (index == -1)
+        return false;
+
+    items.remove(index);
+    return true;
+}
+
 void Anchor::removeItem(Item *item)
 {
-    if (m_side1Items.removeOne(item)) {
+    // The item's neighbours take its space, so they and the item's other anchors change too
+    m_layout->markForSanityCheck(this);
+    m_layout->markForSanityCheck(item);
+    for (Item *neighbour : qAsConst(m_side1Items))
+        m_layout->markForSanityCheck(neighbour);
+    for (Item *neighbour : qAsConst(m_side2Items))
+        m_layout->markForSanityCheck(neighbour);
+    const AnchorGroup &group = item->anchorGroup();
+    for (Anchor *anchor : { group.left, group.top, group.right, group.bottom }) {
+        if (anchor)
+            m_layout->markForSanityCheck(anchor);
+    }
+
+    if (removeOne(m_side1Items, item)) {
         item->anchorGroup().setAnchor(nullptr, orientation(), Side1);
         Q_EMIT itemsChanged(Side1);
     } else {
-        if (m_side2Items.removeOne(item)) {
+        if (removeOne(m_side2Items, item)) {
             item->anchorGroup().setAnchor(nullptr, orientation(), Side2);
             Q_EMIT itemsChanged(Side2);
         }
@@ -757,7 +1057,7 @@ void Anchor::removeItem(Item *item)
 
 void Anchor::removeItems(Side side)
 {
-    const auto &items = this->items(side);
+    const AnchorItems items = this->items(side); // Copy, removeItem() modifies it
     for (Item *item : items)
         removeItem(item);
 }
@@ -780,22 +1080,58 @@ void Anchor::onMousePress()
     s_isResizing = true;
     m_layout->setAnchorBeingDragged(this);
     qCDebug(anchors) << "Drag started";
-
-    if (m_lazyResize) {
+    m_interactiveOperation.reset(new InteractiveOperation(m_layout->dockWidgets()));
+
+    m_lazyResizeInProgress = false;
+    m_throttledResizeInProgress = false;
+
+    switch (m_layout->resizePolicy()) {
+    case MultiSplitterLayout::ResizePolicy_Immediate:
+        break;
+    case MultiSplitterLayout::ResizePolicy_Lazy:
+        if (!m_lazyResizeRubberBand)
+            m_lazyResizeRubberBand = new QRubberBand(QRubberBand::Line, m_layout->multiSplitter());
+        m_lazyResizeInProgress = true;
+        m_lazyPosition = -1; // So the rubber band is positioned
         setLazyPosition(position());
         m_lazyResizeRubberBand->show();
+        break;
+    case MultiSplitterLayout::ResizePolicy_LazyLivePreview:
+        if (!m_lazyResizePreview)
+            m_lazyResizePreview = new LazyResizePreview(this, m_layout->multiSplitter());
+        m_lazyResizeInProgress = true;
+        m_lazyPosition = position();
+        m_lazyResizePreview->start();
+        break;
+    case MultiSplitterLayout::ResizePolicy_Throttled:
+        m_throttledResizeInProgress = true;
+        m_lazyPosition = position();
+        m_lastThrottledResize.invalidate();
+        break;
     }
 }
 
 void Anchor::onMouseReleased()
 {
-    if (m_lazyResize) {
-        m_lazyResizeRubberBand->hide();
+    if (m_lazyResizeInProgress) {
+        if (m_lazyResizePreview && m_lazyResizePreview->isVisible())
+            m_lazyResizePreview->stop();
+        if (m_lazyResizeRubberBand)
+            m_lazyResizeRubberBand->hide();
         setPosition(m_lazyPosition);
+    } else if (m_throttledResizeInProgress) {
+        // Apply the last position we didn't get to
+        applyThrottledPosition();
     }
 
+    m_lazyResizeInProgress = false;
+    m_throttledResizeInProgress = false;
+
     s_isResizing = false;
     m_layout->setAnchorBeingDragged(nullptr);
+
+    // After the final position was applied, so guests get their final size
+    m_interactiveOperation.reset();
 }
 
 void Anchor::onMouseMoved(QPoint pt)
@@ -819,7 +1155,24 @@ void Anchor::onMouseMoved(QPoint pt)
     }
 #endif
 
-    const int positionToGoTo = position(pt);
+    dragTo(position(pt));
+}
+
+void Anchor::simulateDrag(const QVector<int> &positions)
+{
+    if (isStatic() || isFollowing()) {
+        qWarning() << Q_FUNC_INFO << "Can't drag this anchor" << isStatic() << isFollowing();
+        return;
+    }
+
+    onMousePress();
+    for (int p : positions)
+        dragTo(p);
+    onMouseReleased();
+}
+
+void Anchor::dragTo(int positionToGoTo)
+{
     auto bounds = m_layout->boundPositionsForAnchor(this);
 
     if (positionToGoTo < bounds.first || positionToGoTo > bounds.second) {
@@ -831,8 +1184,10 @@ void Anchor::onMouseMoved(QPoint pt)
                                                       : (positionToGoTo > position() ? Side2
                                                                                      : Side_None); // Side_None shouldn't happen though.
 
-    if (m_lazyResize)
+    if (m_lazyResizeInProgress)
         setLazyPosition(positionToGoTo);
+    else if (m_throttledResizeInProgress)
+        setThrottledPosition(positionToGoTo);
     else
         setPosition(positionToGoTo);
 }
@@ -863,20 +1218,15 @@ Anchor *Anchor::deserialize(const LayoutSaver::Anchor &a, MultiSplitterLayout *l
     anchor->setProperty("indexTo", a.indexOfTo);
     anchor->setProperty("indexFolowee", a.indexOfFollowee);
 
-    ItemList side1Items;
-    ItemList side2Items;
-    const ItemList allItems = layout->items();
-    side1Items.reserve(a.side1Items.size());
+    const ItemList &allItems = layout->items();
+    anchor->m_side1Items.reserve(a.side1Items.size());
     for (int index : qAsConst(a.side1Items)) {
-        side1Items.push_back(allItems.at(index));
+        anchor->m_side1Items.push_back(allItems.at(index));
     }
-    side2Items.reserve(a.side2Items.size());
+    anchor->m_side2Items.reserve(a.side2Items.size());
     for (int index : qAsConst(a.side2Items)) {
-        side2Items.push_back(allItems.at(index));
+        anchor->m_side2Items.push_back(allItems.at(index));
     }
-
-    anchor->m_side1Items = side1Items;
-    anchor->m_side2Items = side2Items;
     anchor->m_initialized = true;
 
     return anchor;
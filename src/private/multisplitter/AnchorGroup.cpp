@@ -250,9 +250,9 @@ QDebug AnchorGroup::debug(QDebug d) const
     return d;
 }
 
-const Anchor::List AnchorGroup::anchorsFollowingInwards() const
+AnchorGroup::AnchorArray AnchorGroup::anchorsFollowingInwards() const
 {
-    Anchor::List result;
+    AnchorArray result;
     if (anchorIsFollowingInwards(left))
         result.push_back(left);
 
@@ -273,18 +273,25 @@ const Anchor::List AnchorGroup::anchorsFollowingInwards() const
     return result;
 }
 
-const Anchor::List AnchorGroup::anchorsNotFollowingInwards() const
+AnchorGroup::AnchorArray AnchorGroup::anchorsNotFollowingInwards() const
 {
-    Anchor::List result = anchors();
-    for (Anchor *a : anchorsFollowingInwards())
-        result.removeOne(a);
+    AnchorArray result;
+    for (Anchor *a : anchors()) {
+        if (!anchorIsFollowingInwards(a))
+            result.append(a);
+    }
 
     return result;
 }
 
-const Anchor::List AnchorGroup::anchors() const
+AnchorGroup::AnchorArray AnchorGroup::anchors() const
 {
-    return { left, top, right, bottom };
+    AnchorArray result;
+    result.append(left);
+    result.append(top);
+    result.append(right);
+    result.append(bottom);
+    return result;
 }
 
 Anchor::Side AnchorGroup::sideForAnchor(Anchor *a) const
@@ -373,14 +380,16 @@ void AnchorGroup::addItem(MultiSplitterLayout *sourceMultiSplitter)
     // To prevent the source splitter from deleting the anchors once the widgets are reparented
     sourceMultiSplitter->m_beingMergedIntoAnotherMultiSplitter = true;
 
-    // Reparent the widgets:
-    for (Item *sourceItem : sourceMultiSplitter->items()) {
+    // Reparent the widgets. Copies, as setLayout() removes them from the source
+    const ItemList sourceItems = sourceMultiSplitter->items();
+    for (Item *sourceItem : sourceItems) {
         sourceItem->setLayout(layout);
         sourceItem->setVisible(true);
     }
 
     // Reparent the inner anchors, they're ours now
-    for (Anchor *anchor : sourceMultiSplitter->anchors()) {
+    const Anchor::List sourceAnchors = sourceMultiSplitter->anchors();
+    for (Anchor *anchor : sourceAnchors) {
         if (!anchor->isStatic()) {
             const qreal positionPercentage = anchor->positionPercentage();
             anchor->setLayout(layout);
@@ -434,6 +443,9 @@ void AnchorGroup::removeItem(Item *item)
     bottom->removeItem(item);
     top->removeItem(item);
 
+    if (layout->isBeingCleared()) // No point in consuming anchors that are about to be deleted
+        return;
+
     if (left->isUnneeded()) {
         layout->updateAnchorsFromTo(left, right);
         const int leftPosition = left->position();
@@ -26,6 +26,7 @@
 #include "Anchor_p.h"
 
 #include <QDebug>
+#include <QVarLengthArray>
 
 namespace KDDockWidgets {
 
@@ -35,6 +36,9 @@ class Item;
 
 struct DOCKS_EXPORT_FOR_UNIT_TESTS AnchorGroup
 {
+    ///@brief A group has at most 4 anchors, so lists of them live on the stack instead of the heap
+    typedef QVarLengthArray<Anchor *, 4> AnchorArray;
+
     ///@brief contructs an invalid group
     AnchorGroup() = default;
 
@@ -96,9 +100,9 @@ struct DOCKS_EXPORT_FOR_UNIT_TESTS AnchorGroup
     void setAnchor(Anchor *anchor, KDDockWidgets::Location);
 
     bool anchorIsFollowingInwards(Anchor*) const;
-    const Anchor::List anchorsFollowingInwards() const;
-    const Anchor::List anchorsNotFollowingInwards() const;
-    const Anchor::List anchors() const;
+    AnchorArray anchorsFollowingInwards() const;
+    AnchorArray anchorsNotFollowingInwards() const;
+    AnchorArray anchors() const;
 
     Anchor::Side sideForAnchor(Anchor*) const;
     bool isStatic() const;
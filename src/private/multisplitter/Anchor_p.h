@@ -28,9 +28,14 @@
 #include <QPointer>
 #include <QRect>
 #include <QVector>
+#include <QVarLengthArray>
+#include <QElapsedTimer>
+
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 class QRubberBand;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace KDDockWidgets {
@@ -38,9 +43,27 @@ namespace KDDockWidgets {
 class Item;
 class MultiSplitterLayout;
 class Separator;
+class LazyResizePreview;
+class InteractiveOperation;
 
 typedef QVector<Item*> ItemList;
 
+///@brief How many items AnchorItems stores inline
+static const int s_anchorItemsPrealloc = 3;
+
+///@brief The items on one side of an anchor. There's rarely more than 3, so they're stored inline, without a heap allocation
+typedef QVarLengthArray<Item*, s_anchorItemsPrealloc> AnchorItems;
+
+///@brief Converts @p items to an ItemList, for debug output and properties
+inline ItemList toItemList(const AnchorItems &items)
+{
+    ItemList result;
+    result.reserve(items.size());
+    for (Item *item : items)
+        result.push_back(item);
+    return result;
+}
+
 /**
  * @brief An anchor is the vertical or horizontal (@ref orientation()) line that has an handle
  * so you can resize widgets with your mouse.
@@ -86,8 +109,8 @@ class DOCKS_EXPORT_FOR_UNIT_TESTS Anchor : public QObject // clazy:exclude=ctor-
     Q_OBJECT
 
     // properties for GammaRay
-    Q_PROPERTY(KDDockWidgets::ItemList side1Items READ side1Items NOTIFY itemsChanged)
-    Q_PROPERTY(KDDockWidgets::ItemList side2Items READ side2Items NOTIFY itemsChanged)
+    Q_PROPERTY(KDDockWidgets::ItemList side1Items READ debug_side1Items NOTIFY itemsChanged)
+    Q_PROPERTY(KDDockWidgets::ItemList side2Items READ debug_side2Items NOTIFY itemsChanged)
 
     Q_PROPERTY(QString debug_side1ItemNames READ debug_side1ItemNames NOTIFY debug_itemNamesChanged)
     Q_PROPERTY(QString debug_side2ItemNames READ debug_side2ItemNames NOTIFY debug_itemNamesChanged)
@@ -131,13 +154,21 @@ public:
     static Anchor* deserialize(const LayoutSaver::Anchor &, MultiSplitterLayout *layout);
     LayoutSaver::Anchor serialize() const;
 
+    /**
+     * @brief Returns a small integer identifying this anchor in its layout, or -1 if it's not in one.
+     *
+     * Ids are dense, between 0 and MultiSplitterLayout::anchorIdBound(), and are reused once an
+     * anchor is removed. Layout algorithms use them to index flat arrays instead of hashing pointers.
+     */
+    int id() const { return m_id; }
+
     void setFrom(Anchor *);
     Anchor *from() const { return m_from; }
     Anchor *to() const { return m_to; }
     void setTo(Anchor *);
     Qt::Orientation orientation() const;
     void addItem(Item *, Side);
-    void addItems(const ItemList &list, Side);
+    void addItems(const AnchorItems &list, Side);
     void removeItem(Item *w);
     void removeItems(Side);
     bool isVertical() const { return m_orientation == Qt::Vertical; }
@@ -203,6 +234,14 @@ public:
     bool hasNonPlaceholderItems(Side) const;
     bool onlyHasPlaceholderItems(Anchor::Side side) const;
 
+    /**
+     * @brief Returns how many items at @p side aren't placeholders.
+     *
+     * Cached until the layout's size constraints change, which includes items turning into placeholders
+     * or back. So hasNonPlaceholderItems() and onlyHasPlaceholderItems() don't walk the items each time.
+     */
+    int numNonPlaceholderItems(Anchor::Side side) const;
+
     /**
      * @brief Returns whether this Anchor should follow another one. That happens if one of it's side is empty or only has placeholders
      * Also, it can't be a static anchor.
@@ -212,9 +251,12 @@ public:
     bool containsItem(const Item *w, Side side) const;
     bool isStaticOrFollowsStatic() const;
 
-    const ItemList items(Side side) const;
-    const ItemList side1Items() const { return m_side1Items; }
-    const ItemList side2Items() const { return m_side2Items; }
+    ///@brief The items on @p side. Returned by reference, copy them before iterating if the loop adds or removes items
+    const AnchorItems &items(Side side) const;
+    const AnchorItems &side1Items() const { return m_side1Items; }
+    const AnchorItems &side2Items() const { return m_side2Items; }
+    ItemList debug_side1Items() const { return toItemList(m_side1Items); }
+    ItemList debug_side2Items() const { return toItemList(m_side2Items); }
 
     void consume(Anchor *other);
     void consume(Anchor *other, Side);
@@ -227,8 +269,22 @@ public:
 
     Type type() const { return m_type; }
 
+    /**
+     * @brief Returns the minimum length that the items at @p side, and the ones after them, need.
+     *
+     * Cached until the layout's size constraints change, see MultiSplitterLayout::sizeConstraintsGeneration().
+     */
     int cumulativeMinLength(Anchor::Side side) const;
 
+    /**
+     * @brief Returns, for each item at side @p side, the anchor on the other end of that item.
+     *
+     * The result is parallel to @ref items(), and might contain duplicates, as several items
+     * can share the same opposite anchor. It's cached and only recalculated after the layout's
+     * topology changes (see MultiSplitterLayout::anchorGraphGeneration()).
+     */
+    const List &oppositeAnchors(Side side) const;
+
     /**
      * @brief Makes this separator follow another one. This one will be made invisible.
      * Used when the item in the layout is just a placeholder remembering a previous dock widget position.
@@ -244,7 +300,7 @@ public:
     /**
      * @brief Returns the list of anchors following this one.
      */
-    const List followers() const;
+    const List &followers() const;
 
     /**
      * @brief Returns the last followee in the chain.
@@ -272,7 +328,6 @@ public:
 
     static int thickness(bool staticAnchor);
     static Anchor::Side oppositeSide(Side side);
-    void onFolloweePositionChanged(int pos);
     bool isFollowing() const { return m_followee != nullptr; }
 
     void onMousePress();
@@ -280,6 +335,14 @@ public:
     void onMouseMoved(QPoint pt);
     void onWidgetMoved(int p);
 
+    /**
+     * @brief Drags this anchor programmatically, without mouse events. For tests and benchmarks.
+     *
+     * Goes through the same steps as a mouse drag, honouring the resize policy, moving to each
+     * of @p positions (in the layout's coordinates) before releasing.
+     */
+    void simulateDrag(const QVector<int> &positions);
+
 
     ///@brief Returns whether we're dragging a separator. Can be useful for the app to stop other work while we're not in the final size
     static bool isResizing();
@@ -296,9 +359,34 @@ private:
     };
     CumulativeMin cumulativeMinLength_recursive(Anchor::Side side) const;
 
+    // Instantiated once per orientation, see OrientationTraits in Anchor.cpp
+    template <Qt::Orientation>
+    void updateItemSizes_impl();
+    template <Qt::Orientation>
+    int smallestAvailableItemSqueeze_impl(Anchor::Side) const;
+
+    struct OppositeAnchorsCache {
+        List anchors;
+        int generation = -1;
+    };
+
+    struct CumulativeMinCache {
+        CumulativeMin value = { 0, 0 };
+        int generation = -1;
+    };
+
+    struct NonPlaceholderCountCache {
+        int count = 0;
+        int generation = -1;
+    };
+
     void setThickness();
     void setLazyPosition(int);
 
+    ///@brief Used by MultiSplitterLayout::ResizePolicy_Throttled
+    void setThrottledPosition(int);
+    void applyThrottledPosition();
+
 Q_SIGNALS:
     void positionChanged(int pos);
     void itemsChanged(Anchor::Side);
@@ -310,19 +398,27 @@ Q_SIGNALS:
 
 public:
     int position(QPoint) const;
+
+    ///@brief The mouse move part of a drag, once the mouse buttons were checked
+    void dragTo(int position);
+
     void updateSize();
     void updateItemSizes();
+    ///@brief Notifies the debug tools that the item names need to be fetched again
     void debug_updateItemNames();
+
+    ///@brief Returns the names of the items at each side, for GammaRay. Computed on each call.
     QString debug_side1ItemNames() const;
     QString debug_side2ItemNames() const;
     void setGeometry(QRect);
     QRect geometry() const { return m_geometry; }
 
     const Qt::Orientation m_orientation;
-    ItemList m_side1Items;
-    ItemList m_side2Items;
-    QPointer<Anchor> m_from;// QPointer just so we can assert. They should never be null.
-    QPointer<Anchor> m_to;
+    AnchorItems m_side1Items;
+    AnchorItems m_side2Items;
+    // They should never be null. If they're deleted first, ~Anchor nulls them through m_dependents, so we can assert
+    Anchor *m_from = nullptr;
+    Anchor *m_to = nullptr;
     const Type m_type;
     qreal m_positionPercentage = 0.0; // Should be between 0 and 1
 
@@ -339,15 +435,27 @@ public:
     // For when being animated. They are not displayed at their pos, but with an offset.
     int m_positionOffset = 0;
 
-    QString m_debug_side1ItemNames;
-    QString m_debug_side2ItemNames;
     Separator *const m_separatorWidget;
     QRect m_geometry;
     Anchor *m_followee = nullptr;
-    QMetaObject::Connection m_followeeDestroyedConnection;
-    const bool m_lazyResize;
+    List m_followers; // The anchors whose followee is this one
+    List m_dependents; // The perpendicular anchors whose from or to is this one, resized when we move
+    int m_id = -1; // Set by MultiSplitterLayout::insertAnchor()
+
+    // The layout's resize policy when the mouse was pressed, see MultiSplitterLayout::setResizePolicy()
+    bool m_lazyResizeInProgress = false;
+    bool m_throttledResizeInProgress = false;
     int m_lazyPosition = 0;
-    QRubberBand *const m_lazyResizeRubberBand;
+
+    // These are created on the first press that needs them. QPointer, as they're owned by the MultiSplitter widget too
+    QPointer<QRubberBand> m_lazyResizeRubberBand;
+    QPointer<LazyResizePreview> m_lazyResizePreview;
+    QTimer *m_throttledResizeTimer = nullptr;
+    QElapsedTimer m_lastThrottledResize;
+    std::unique_ptr<InteractiveOperation> m_interactiveOperation; // While being dragged by mouse
+    mutable OppositeAnchorsCache m_oppositeAnchorsCache[2];
+    mutable CumulativeMinCache m_cumulativeMinCache[2];
+    mutable NonPlaceholderCountCache m_nonPlaceholderCountCache[2];
 };
 
 }
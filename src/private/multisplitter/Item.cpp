@@ -22,8 +22,11 @@
 #include "MultiSplitterLayout_p.h"
 #include "MultiSplitter_p.h"
 #include "Logging_p.h"
+#include "Stats_p.h"
+#include "EventLog_p.h"
 #include "AnchorGroup_p.h"
 #include "Frame_p.h"
+#include "LastPosition_p.h"
 #include "DockWidgetBase.h"
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
@@ -33,6 +36,10 @@
 
 using namespace KDDockWidgets;
 
+static quint64 s_lastPlaceholderSerial = 0;
+
+Sizable::~Sizable() = default;
+
 class Item::Private {
 public:
 
@@ -55,18 +62,33 @@ public:
     {
     }
 
+    ///@brief the Item only talks to its frame through the Sizable interface, when laying it out
+    Sizable *sizable() const
+    {
+        return m_frame;
+    }
+
     QSize frameMinSize() const
     {
-        return QSize(widgetMinLength(m_frame, Qt::Vertical),
-                     widgetMinLength(m_frame, Qt::Horizontal));
+        return sizable()->minSize();
     }
 
     void setFrame(Frame *frame);
     void turnIntoPlaceholder();
+
+    ///@brief called when our frame got a new parent. If it left our layout it was floated, so we become a placeholder
+    void onFrameReparented();
     void setIsPlaceholder(bool);
 
     void updateObjectName();
     void setMinimumSize(QSize);
+
+    void setFrameGeometry(QRect geo)
+    {
+        KDDW_STATS_INCREMENT(frameGeometryPushes);
+        sizable()->setGeometry(geo);
+    }
+
     Item *const q;
     AnchorGroup m_anchorGroup;
     Frame *m_frame = nullptr;
@@ -76,8 +98,11 @@ public:
     QSize m_minSize;
     bool m_destroying = false;
     int m_refCount = 0;
+    ItemRef *m_firstItemRef = nullptr; // Intrusive list, see addItemRef()
+    quint64 m_placeholderSerial = 0;
     bool m_blockPropagateGeo = false;
     QMetaObject::Connection m_onFrameLayoutRequest_connection;
+    QMetaObject::Connection m_onFrameReparented_connection;
     QMetaObject::Connection m_onFrameDestroyed_connection;
     QMetaObject::Connection m_onFrameObjectNameChanged_connection;
 };
@@ -110,6 +135,14 @@ Item::~Item()
     if (d->m_layout) {
         d->m_layout->removeItem(this);
     }
+
+    // Tell the LastPositions still referencing us to forget us
+    while (ItemRef *ref = d->m_firstItemRef) {
+        removeItemRef(ref);
+        ref->itemDestroyed = true;
+        ref->owner->removePlaceholder(this);
+    }
+
     delete d;
 }
 
@@ -152,17 +185,18 @@ int Item::height() const
 bool Item::isVisible() const
 {
     Q_ASSERT(d->m_frame);
-    return d->m_frame->isVisible();
+    return d->sizable()->isVisible();
 }
 
 void Item::setVisible(bool v)
 {
     Q_ASSERT(d->m_frame);
-    d->m_frame->setVisible(v);
+    d->sizable()->setVisible(v);
 }
 
 void Item::setGeometry(QRect geo)
 {
+    KDDW_STATS_INCREMENT(itemSetGeometryCalls);
     Q_ASSERT(d->m_frame || isPlaceholder());
 
     if (geo != d->m_geometry) {
@@ -175,12 +209,21 @@ void Item::setGeometry(QRect geo)
                  << "; window=" << parentWidget()->window()
                  << "this=" << this;*/
         d->m_geometry = geo;
+        if (d->m_layout)
+            d->m_layout->markForSanityCheck(this);
         Q_EMIT geometryChanged();
 
-        if (!isPlaceholder())
-            d->m_frame->setGeometry(geo);
+        // When inside a layout transaction the frame geometry is only set at the end.
+        const bool inTransaction = d->m_layout && d->m_layout->isInTransaction();
 
-        if (!d->m_blockPropagateGeo && d->m_anchorGroup.isValid() && geoDiff.onlyOneSideChanged) {
+        if (!isPlaceholder() && !inTransaction) {
+            if (d->m_layout && d->m_layout->isBatchingFrameGeometry())
+                d->m_layout->queueFrameGeometry(this); // Resized once, when the batch ends
+            else
+                d->setFrameGeometry(geo);
+        }
+
+        if (!d->m_blockPropagateGeo && !inTransaction && d->m_anchorGroup.isValid() && geoDiff.onlyOneSideChanged) {
             // If we're being squeezed to the point where it reaches less then our min size, then we drag the opposite separator, to preserve size
             Anchor *anchorThatMoved = anchor(geoDiff);
             Q_ASSERT(anchorThatMoved);
@@ -270,21 +313,16 @@ QRect Item::geometry() const
     return d->m_geometry;
 }
 
-bool Item::eventFilter(QObject *o, QEvent *e)
+void Item::Private::onFrameReparented()
 {
-    if (!d->m_layout)
-        return false;
+    if (!m_layout || m_layout->m_beingMergedIntoAnotherMultiSplitter)
+        return;
 
-    if (e->type() == QEvent::ParentChange && !d->m_layout->m_beingMergedIntoAnotherMultiSplitter) {
-        if (o->parent() != d->m_layout->multiSplitter()) {
-            // Frame was detached into a floating window
-            Q_ASSERT(!isPlaceholder());
-            d->turnIntoPlaceholder();
-        }
-    } else if (e->type() == QEvent::Show || e->type() == QEvent::Hide) {
-        //d->m_layout->emitVisibleWidgetCountChanged(); REMOVE
+    if (m_frame->parent() != m_layout->multiSplitter()) {
+        // Frame was detached into a floating window
+        Q_ASSERT(!q->isPlaceholder());
+        turnIntoPlaceholder();
     }
-    return false;
 }
 
 Frame *Item::frame() const
@@ -403,9 +441,10 @@ bool Item::isInMainWindow() const
 void Item::restorePlaceholder(DockWidgetBase *dockWidget, int tabIndex)
 {
     qCDebug(placeholder) << Q_FUNC_INFO << "Restoring to window=" << window();
+    KDDW_LOG_EVENT(LogEvent::PlaceholderRestored, this);
     if (d->m_isPlaceholder) {
         d->setFrame(Config::self().frameworkWidgetFactory()->createFrame(layout()->multiSplitter()));
-        d->m_frame->setGeometry(d->m_geometry);
+        d->setFrameGeometry(d->m_geometry);
     }
 
     if (tabIndex != -1 && d->m_frame->dockWidgetCount() >= tabIndex) {
@@ -429,7 +468,7 @@ void Item::restorePlaceholder(Frame *frame)
 
     frame->setParent(layout()->multiSplitter());
     d->setFrame(frame);
-    d->m_frame->setGeometry(d->m_geometry);
+    d->setFrameGeometry(d->m_geometry);
     d->m_layout->restorePlaceholder(this);
     d->m_frame->setVisible(true);
     d->setIsPlaceholder(false);
@@ -443,10 +482,10 @@ void Item::onLayoutRequest() const
     if (LayoutSaver::restoreInProgress())
         return; // we don't even have the anchors yet, nothing to do
 
-    if (d->m_frame->geometry() != geometry()) {
+    if (d->sizable()->geometry() != geometry()) {
         // The frame is controlled by the layout, it can't change its geometry on its own.
         // Put it back.
-        d->m_frame->setGeometry(geometry());
+        d->setFrameGeometry(geometry());
     }
 
     if (d->m_layout->isAddingItem())
@@ -491,6 +530,10 @@ void Item::Private::setMinimumSize(QSize sz)
 {
     if (sz != m_minSize) {
         m_minSize = sz;
+        if (m_layout) {
+            m_layout->invalidateSizeConstraints();
+            m_layout->markForSanityCheck(q);
+        }
         Q_EMIT q->minimumSizeChanged();
     }
 }
@@ -498,9 +541,11 @@ void Item::Private::setMinimumSize(QSize sz)
 void Item::restoreSizes(QSize minSize, QRect geometry)
 {
     d->m_minSize = minSize;
+    if (d->m_layout)
+        d->m_layout->invalidateSizeConstraints();
     d->m_geometry = geometry;
     if (d->m_frame)
-        d->m_frame->setGeometry(geometry);
+        d->setFrameGeometry(geometry);
 }
 
 void Item::Private::setFrame(Frame *frame)
@@ -508,7 +553,7 @@ void Item::Private::setFrame(Frame *frame)
     Q_ASSERT((m_frame && !frame) || (!m_frame && frame));
 
     if (m_frame) {
-        m_frame->removeEventFilter(q);
+        QObject::disconnect(m_onFrameReparented_connection);
         QObject::disconnect(m_onFrameDestroyed_connection);
         QObject::disconnect(m_onFrameLayoutRequest_connection);
         QObject::disconnect(m_onFrameObjectNameChanged_connection);
@@ -520,7 +565,7 @@ void Item::Private::setFrame(Frame *frame)
     if (frame) {
         q->onLayoutRequest();
         frame->setLayoutItem(q);
-        frame->installEventFilter(q);
+        m_onFrameReparented_connection = connect(frame, &Frame::reparented, q, [this] { onFrameReparented(); });
         // auto destruction
         m_onFrameDestroyed_connection = q->connect(frame, &QObject::destroyed, q, [this] {
             if (!m_layout) {
@@ -578,6 +623,34 @@ int Item::refCount() const
     return d->m_refCount;
 }
 
+void Item::addItemRef(ItemRef *ref)
+{
+    ref->prevRef = nullptr;
+    ref->nextRef = d->m_firstItemRef;
+    if (d->m_firstItemRef)
+        d->m_firstItemRef->prevRef = ref;
+    d->m_firstItemRef = ref;
+}
+
+void Item::removeItemRef(ItemRef *ref)
+{
+    if (ref->prevRef)
+        ref->prevRef->nextRef = ref->nextRef;
+    else if (d->m_firstItemRef == ref)
+        d->m_firstItemRef = ref->nextRef;
+
+    if (ref->nextRef)
+        ref->nextRef->prevRef = ref->prevRef;
+
+    ref->prevRef = nullptr;
+    ref->nextRef = nullptr;
+}
+
+quint64 Item::placeholderSerial() const
+{
+    return d->m_placeholderSerial;
+}
+
 void Item::Private::turnIntoPlaceholder()
 {
     qCDebug(placeholder) << Q_FUNC_INFO << this;
@@ -587,10 +660,13 @@ void Item::Private::turnIntoPlaceholder()
     setFrame(nullptr);
     setIsPlaceholder(true);
 
-    m_layout->clearAnchorsFollowing();
+    auto layout = m_layout; // copy it, since we're deleting 'q', which deletes 'this'
+    if (layout->isBeingCleared())
+        return; // The layout is about to delete us anyway
+
+    layout->clearAnchorsFollowing();
 
     AnchorGroup anchorGroup = q->anchorGroup();
-    auto layout = m_layout; // copy it, since we're deleting 'q', which deletes 'this'
     if (anchorGroup.isValid()) {
         layout->emitVisibleWidgetCountChanged();
     } else {
@@ -605,6 +681,12 @@ void Item::Private::setIsPlaceholder(bool is)
 {
     if (is != m_isPlaceholder) {
         m_isPlaceholder = is;
+        if (is)
+            m_placeholderSerial = ++s_lastPlaceholderSerial;
+        if (m_layout) {
+            m_layout->invalidateSizeConstraints();
+            m_layout->markForSanityCheck(q);
+        }
         Q_EMIT q->isPlaceholderChanged();
     }
 }
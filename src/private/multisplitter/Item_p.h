@@ -40,6 +40,7 @@ class MultiSplitterLayout;
 class Frame;
 class DockWidgetBase;
 class TestDocks;
+struct ItemRef;
 
 struct GeometryDiff
 {
@@ -130,7 +131,6 @@ public:
     void endBlockPropagateGeo();
 
     QRect geometry() const;
-    bool eventFilter(QObject *, QEvent *) override;
 
     Frame* frame() const;
     QWidgetOrQuick *window() const;
@@ -150,6 +150,7 @@ public:
     AnchorGroup& anchorGroup();
     const AnchorGroup& anchorGroup() const;
 
+    ///@brief Returns the frame's min size as of the last onLayoutRequest(). See Frame::invalidateMinSize().
     QSize minimumSize() const;
 
     bool isPlaceholder() const;
@@ -169,12 +170,25 @@ public:
     /**
      * @brief Checks if the minSize is correct.
      * The parent widget got a QEvent::LayoutRequest, so the Frame might have changed its constraints.
+     * Called when the frame emits Frame::layoutInvalidated(), which is deferred, so call it directly
+     * if the layout's constraints must be current before the next event loop iteration.
      */
     void onLayoutRequest() const;
 
     void ref();
     void unref();
     int refCount() const; // for tests
+
+    ///@internal
+    ///@brief Links or unlinks the LastPosition reference @p ref, which the item notifies when destroyed
+    void addItemRef(ItemRef *ref);
+    void removeItemRef(ItemRef *ref);
+
+    /**
+     * @brief Returns a number that grows each time an item turns into a placeholder.
+     * So the older placeholders have the smaller ones. Used by Config::setMaxPlaceholdersPerLayout().
+     */
+    quint64 placeholderSerial() const;
 Q_SIGNALS:
     void frameChanged();
     void geometryChanged();
@@ -33,6 +33,7 @@
 #include "MainWindowBase.h"
 #include "FloatingWindow_p.h"
 #include "LayoutSaver.h"
+#include "Config.h"
 
 #include <QScopedValueRollback>
 
@@ -52,6 +53,11 @@ MultiSplitter::MultiSplitter(QWidgetOrQuick *parent)
     });
 
     setMinimumSize(m_layout->minimumSize());
+
+    m_resizeThrottleTimer.setSingleShot(true);
+    connect(&m_resizeThrottleTimer, &QTimer::timeout, this, [this] {
+        applyResize(size());
+    });
 }
 
 MultiSplitter::~MultiSplitter()
@@ -73,16 +79,36 @@ bool MultiSplitter::onResize(QSize newSize)
     qCDebug(sizing) << Q_FUNC_INFO << "; new=" << newSize
                     << "; window=" << window();
 
-    QScopedValueRollback<bool>(m_inResizeEvent, true); // to avoid re-entrancy
-
     if (!LayoutSaver::restoreInProgress()) {
         // don't resize anything while we're restoring the layout
-        m_layout->setSize(newSize);
+        const int interval = Config::self().windowResizeThrottleInterval();
+        const qint64 elapsed = m_lastResize.isValid() ? m_lastResize.elapsed() : interval;
+        if (elapsed >= interval) {
+            applyResize(newSize);
+        } else if (!m_resizeThrottleTimer.isActive()) {
+            // Only the latest size matters, the timer will use whatever size we have by then
+            m_resizeThrottleTimer.start(interval - int(elapsed));
+        }
     }
 
     return false; // So QWidget::resizeEvent is called
 }
 
+void MultiSplitter::applyPendingResize()
+{
+    if (m_resizeThrottleTimer.isActive())
+        applyResize(size());
+}
+
+void MultiSplitter::applyResize(QSize newSize)
+{
+    m_resizeThrottleTimer.stop();
+    m_lastResize.start();
+
+    QScopedValueRollback<bool> inResizeEvent(m_inResizeEvent, true);
+    m_layout->setSize(newSize);
+}
+
 
 bool MultiSplitter::isInMainWindow() const
 {
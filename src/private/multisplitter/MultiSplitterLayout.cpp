@@ -20,6 +20,9 @@
 
 #include "MultiSplitterLayout_p.h"
 #include "Logging_p.h"
+#include "Stats_p.h"
+#include "Tracing_p.h"
+#include "EventLog_p.h"
 #include "MultiSplitter_p.h"
 #include "Frame_p.h"
 #include "FloatingWindow_p.h"
@@ -35,6 +38,10 @@
 #include <QEvent>
 #include <QtMath>
 #include <QScopedValueRollback>
+#include <QSet>
+
+#include <algorithm>
+#include <functional>
 
 #define INDICATOR_MINIMUM_LENGTH 100
 #define KDDOCKWIDGETS_MIN_WIDTH 80
@@ -63,6 +70,12 @@ MultiSplitterLayout::MultiSplitterLayout(MultiSplitter *parent)
 
     DockRegistry::self()->registerLayout(this);
 
+    const auto flags = Config::self().flags();
+    if (flags & Config::Flag_LazyResizeLivePreview)
+        m_resizePolicy = ResizePolicy_LazyLivePreview;
+    else if (flags & Config::Flag_LazyResize)
+        m_resizePolicy = ResizePolicy_Lazy;
+
     setSize(parent->size());
 
     qCDebug(multisplittercreation()) << "MultiSplitter";
@@ -224,6 +237,8 @@ std::pair<int,int> MultiSplitterLayout::boundInterval(int newPos1, Anchor* ancho
 
 void MultiSplitterLayout::addWidget(QWidgetOrQuick *w, Location location, Frame *relativeToWidget, AddingOption option)
 {
+    KDDW_TRACE_SCOPE("MultiSplitterLayout::addWidget");
+    KDDW_STATS_TIME_SCOPE(lastAddWidgetUSecs);
     auto frame = qobject_cast<Frame*>(w);
     qCDebug(addwidget) << Q_FUNC_INFO << w
                        << "; location=" << locationStr(location)
@@ -233,6 +248,7 @@ void MultiSplitterLayout::addWidget(QWidgetOrQuick *w, Location location, Frame
                        << "; w.min=" << KDDockWidgets::widgetMinLength(w, anchorOrientationForLocation(location))
                        << "; frame=" << frame
                        << "; option=" << option;
+    KDDW_LOG_EVENT(LogEvent::WidgetAdded, this, location, option);
 
     if (itemForFrame(frame) != nullptr) {
         // Item already exists, remove it.
@@ -390,7 +406,7 @@ void MultiSplitterLayout::addWidget(QWidgetOrQuick *w, Location location, Frame
         Q_ASSERT(frame);
         auto item = new Item(frame, this);
         targetAnchorGroup.addItem(item);
-        addItems_internal(ItemList{ item });
+        addItems_internal(item);
     }
 
     updateAnchorFollowing();
@@ -405,19 +421,38 @@ void MultiSplitterLayout::addItems_internal(const ItemList &items, bool updateCo
     if (updateConstraints)
         updateSizeConstraints();
 
-    for (auto item : items) {
-        item->setLayout(this);
-        if (item->frame()) {
-            item->setVisible(true);
-            item->frame()->installEventFilter(this);
-            Q_EMIT widgetAdded(item);
-        }
-    }
+    invalidateItemGrid();
+    for (auto item : items)
+        setupAddedItem(item);
+
+    if (emitSignal)
+        Q_EMIT widgetCountChanged(m_items.size());
+}
+
+void MultiSplitterLayout::addItems_internal(Item *item, bool updateConstraints, bool emitSignal)
+{
+    m_items.push_back(item);
+    if (updateConstraints)
+        updateSizeConstraints();
+
+    invalidateItemGrid();
+    setupAddedItem(item);
 
     if (emitSignal)
         Q_EMIT widgetCountChanged(m_items.size());
 }
 
+void MultiSplitterLayout::setupAddedItem(Item *item)
+{
+    item->setLayout(this);
+    markForSanityCheck(item);
+    connect(item, &Item::geometryChanged, this, &MultiSplitterLayout::invalidateItemGrid, Qt::UniqueConnection);
+    if (item->frame()) {
+        item->setVisible(true);
+        Q_EMIT widgetAdded(item);
+    }
+}
+
 void MultiSplitterLayout::addAsPlaceholder(DockWidgetBase *dockWidget, Location location, Item *relativeTo)
 {
     if (!dockWidget) {
@@ -434,7 +469,7 @@ void MultiSplitterLayout::addAsPlaceholder(DockWidgetBase *dockWidget, Location
     auto item = new Item(frame, this);
 
     targetAnchorGroup.addItem(item);
-    addItems_internal(ItemList{ item }, false);
+    addItems_internal(item, false);
 
     dockWidget->addPlaceholderItem(item);
     delete frame;
@@ -508,15 +543,21 @@ void MultiSplitterLayout::propagateResize(int delta, Anchor *fromAnchor, Anchor:
     if (delta <= 0 || fromAnchor->isStatic())
         return;
 
+    if (Config::self().flags() & Config::Flag_LinearLayoutSolver) {
+        propagateResize_linear(delta, fromAnchor, direction);
+        return;
+    }
+
     QVector<Anchor::List> paths;
     collectPaths(paths, fromAnchor, direction);
+    KDDW_STATS_ADD(collectedPaths, paths.size());
 
     for (const Anchor::List &path : qAsConst(paths)) {
         qCDebug(sizing) << Q_FUNC_INFO << path;
     }
 
-    Anchor::List anchorsThatAlreadyContributed;
-    anchorsThatAlreadyContributed.push_back(fromAnchor);
+    std::vector<bool> anchorsThatAlreadyContributed(size_t(anchorIdBound()), false); // Indexed by Anchor::id()
+    anchorsThatAlreadyContributed[size_t(fromAnchor->id())] = true;
 
     while (!paths.isEmpty()) {
         // Get smallest path:
@@ -539,7 +580,7 @@ void MultiSplitterLayout::propagateResize(int delta, Anchor *fromAnchor, Anchor:
         // Now make those anchors contribute, skipping the first
         for (int i = 1, end = smallestPath.size(); i < end; ++i) {
             Anchor *a = smallestPath.at(i);
-            if (!anchorsThatAlreadyContributed.contains(a)) {
+            if (!anchorsThatAlreadyContributed[size_t(a->id())]) {
                 // When moving anchors don't allow widgets to go bellow their min size
                 const int bound = boundPositionForAnchor(a, direction);
                 int newPosition = a->position() + contributionPerAnchor;
@@ -550,7 +591,7 @@ void MultiSplitterLayout::propagateResize(int delta, Anchor *fromAnchor, Anchor:
 
                 if (a->position() != newPosition) {
                     a->setPosition(newPosition);
-                    anchorsThatAlreadyContributed.push_back(a);
+                    anchorsThatAlreadyContributed[size_t(a->id())] = true;
                 }
             }
         }
@@ -571,9 +612,9 @@ void MultiSplitterLayout::collectPaths(QVector<Anchor::List> &paths, Anchor *fro
 
     paths[currentPathIndex].push_back(fromAnchor);
 
-    const ItemList items = fromAnchor->items(direction);
-    for (int i = 0, end = items.size(); i < end; ++i) {
-        Anchor *nextAnchor = items[i]->anchorAtSide(direction, fromAnchor->orientation());
+    const Anchor::List &nextAnchors = fromAnchor->oppositeAnchors(direction);
+    for (int i = 0, end = nextAnchors.size(); i < end; ++i) {
+        Anchor *nextAnchor = nextAnchors.at(i);
         if (i > 0) {
             Anchor::List newPath = paths[currentPathIndex];
             paths.push_back(newPath);
@@ -582,18 +623,152 @@ void MultiSplitterLayout::collectPaths(QVector<Anchor::List> &paths, Anchor *fro
     }
 }
 
-void MultiSplitterLayout::resizeItem(Frame *frame, int newSize, Qt::Orientation orientation)
+void MultiSplitterLayout::propagateResize_linear(int delta, Anchor *fromAnchor, Anchor::Side direction)
+{
+    // The anchors reachable from fromAnchor, in the specified direction, form a DAG. For each anchor
+    // we compute:
+    //   - distanceFromStart: the number of anchors in the shortest path from fromAnchor to it (exclusive)
+    //   - distanceToEnd: the number of non-static anchors in the shortest path from it to a static anchor (inclusive)
+    // The smallest path containing an anchor therefore has distanceFromStart + distanceToEnd anchors,
+    // which is what removeSmallestPath() would have given us.
+    //
+    // An anchor only contributes if delta / (pathSize - 1) reaches the 5px cutoff, so anchors more
+    // than maxHops away from fromAnchor never move. We stop the walk there, which keeps the cost
+    // proportional to the neighbourhood of fromAnchor instead of to the whole layout.
+
+    const int maxHops = delta / 5;
+    if (maxHops == 0)
+        return;
+
+    const bool towardsSide1 = direction == Anchor::Side1;
+    const AnchorGraph &graph = anchorGraph();
+    const int start = graph.indexOf(fromAnchor);
+    if (start == -1) {
+        qWarning() << Q_FUNC_INFO << "Anchor not in this layout" << fromAnchor;
+        return;
+    }
+
+    auto forEachSuccessor = [&graph, direction] (int node, const std::function<void(int)> &func) {
+        graph.forEachNonStaticSuccessor(node, direction, func);
+    };
+
+    // Breadth-first, so the first time we see an anchor is through its shortest path.
+    // graph.localIndexes maps the visited nodes into the vectors below, and is reset before returning.
+    std::vector<int> &localIndexes = graph.localIndexes;
+    std::vector<int> reachable = { start };
+    std::vector<int> distanceFromStart = { 0 };
+    localIndexes[size_t(start)] = 0;
+    for (size_t i = 0; i < reachable.size(); ++i) {
+        const int distance = distanceFromStart[i] + 1;
+        if (distance > maxHops)
+            continue; // Successors of the frontier can't contribute
+
+        forEachSuccessor(reachable[i], [&reachable, &distanceFromStart, &localIndexes, distance] (int successor) {
+            if (localIndexes[size_t(successor)] == -1) {
+                localIndexes[size_t(successor)] = int(reachable.size());
+                reachable.push_back(successor);
+                distanceFromStart.push_back(distance);
+            }
+        });
+    }
+
+    // Anchor positions are monotonic in the direction we're walking, so sorting by position gives
+    // us a topological order.
+    std::vector<int> order(reachable.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = int(i);
+    std::stable_sort(order.begin(), order.end(), [&graph, &reachable, towardsSide1] (int i1, int i2) {
+        const int pos1 = graph.nodes[size_t(reachable[size_t(i1)])].anchor->position();
+        const int pos2 = graph.nodes[size_t(reachable[size_t(i2)])].anchor->position();
+        return towardsSide1 ? pos1 > pos2 : pos1 < pos2;
+    });
+
+    // Paths leaving the visited region are longer than maxHops + 1 anchors, any value making them
+    // miss the cutoff is as good as the real one.
+    const int tooFar = maxHops + 2;
+    std::vector<int> distanceToEnd(reachable.size(), 1);
+    for (auto it = order.crbegin(); it != order.crend(); ++it) {
+        int shortest = -1;
+        forEachSuccessor(reachable[size_t(*it)], [&distanceToEnd, &localIndexes, &shortest, tooFar] (int successor) {
+            const int local = localIndexes[size_t(successor)];
+            const int d = local == -1 ? tooFar : distanceToEnd[size_t(local)];
+            shortest = shortest == -1 ? d : qMin(shortest, d);
+        });
+        distanceToEnd[size_t(*it)] = qMax(0, shortest) + 1;
+    }
+
+    for (int node : reachable)
+        localIndexes[size_t(node)] = -1;
+
+    const int sign = towardsSide1 ? -1 : 1;
+    for (int i : order) {
+        if (i == 0) // fromAnchor was already adjusted in addWidget()
+            continue;
+
+        const int pathSize = distanceFromStart[size_t(i)] + distanceToEnd[size_t(i)];
+        if (pathSize <= 1)
+            continue;
+
+        const int contribution = (delta / (pathSize - 1)) * sign; // n-1 because the initial anchor already contributed
+        if (qAbs(contribution) < 5) {
+            // Too small, don't bother
+            continue;
+        }
+
+        // When moving anchors don't allow widgets to go bellow their min size
+        Anchor *a = graph.nodes[size_t(reachable[size_t(i)])].anchor;
+        const int bound = boundPositionForAnchor(a, direction);
+        int newPosition = a->position() + contribution;
+        if ((towardsSide1 && newPosition < bound) || (!towardsSide1 && newPosition > bound))
+            newPosition = bound;
+
+        if (a->position() != newPosition)
+            a->setPosition(newPosition);
+    }
+}
+
+// Moves the anchor by delta, or less if its bounds don't allow it. Returns the part of delta that wasn't honoured.
+static int moveAnchorBounded(const MultiSplitterLayout *layout, Anchor *anchor, int delta)
+{
+    if (!anchor || anchor->isStatic() || delta == 0)
+        return delta;
+
+    if (anchor->isFollowing())
+        anchor = anchor->endFollowee();
+
+    const QPair<int, int> bounds = layout->boundPositionsForAnchor(anchor);
+    const int oldPosition = anchor->position();
+    const int newPosition = qBound(bounds.first, oldPosition + delta, bounds.second);
+    if (newPosition != oldPosition)
+        anchor->setPosition(newPosition);
+
+    return delta - (newPosition - oldPosition);
+}
+
+bool MultiSplitterLayout::resizeItem(Frame *frame, int newSize, Qt::Orientation orientation)
 {
-    // Used for unit-tests only
     Item *item = itemForFrame(frame);
-    Q_ASSERT(item);
-    Anchor *a = item->anchorAtSide(Anchor::Side2, orientation);
-    Q_ASSERT(!a->isStatic());
-    const int widgLength = item->length(orientation);
-    const int delta = newSize - widgLength;
-    qCDebug(::anchors) << Q_FUNC_INFO << "Old position:" << a->position() << "; old w.geo=" << item->geometry();
-    a->setPosition(a->position() + delta);
-    qCDebug(::anchors) << Q_FUNC_INFO << "New position:" << a->position() << "; new w.geo=" << item->geometry();
+    if (!item || item->isPlaceholder()) {
+        qWarning() << Q_FUNC_INFO << "Frame isn't visible in this layout" << frame;
+        return false;
+    }
+
+    newSize = qMax(newSize, item->minLength(orientation));
+    int delta = newSize - item->length(orientation);
+    if (delta == 0)
+        return true;
+
+    qCDebug(::anchors) << Q_FUNC_INFO << "Old w.geo=" << item->geometry() << "; newSize=" << newSize;
+
+    {
+        // Both anchors are moved in a single batch, so each affected frame is resized only once
+        FrameGeometryBatch batch(this);
+        delta = moveAnchorBounded(this, item->anchorAtSide(Anchor::Side2, orientation), delta);
+        delta = -moveAnchorBounded(this, item->anchorAtSide(Anchor::Side1, orientation), -delta);
+    }
+
+    qCDebug(::anchors) << Q_FUNC_INFO << "New w.geo=" << item->geometry();
+    return delta == 0;
 }
 
 void MultiSplitterLayout::ensureItemsMinSize()
@@ -621,6 +796,7 @@ void MultiSplitterLayout::addMultiSplitter(MultiSplitter *sourceMultiSplitter,
                                            Location location,
                                            Frame *relativeTo)
 {
+    KDDW_TRACE_SCOPE("MultiSplitterLayout::addMultiSplitter");
     qCDebug(addwidget) << Q_FUNC_INFO << sourceMultiSplitter << location << relativeTo;
     addWidget(sourceMultiSplitter, location, relativeTo);
 }
@@ -630,13 +806,21 @@ void MultiSplitterLayout::removeItem(Item *item)
     if (!item || m_inDestructor || !m_items.contains(item))
         return;
 
-    maybeCheckSanity();
+    if (!m_beingCleared)
+        maybeCheckSanity();
 
-    if (!item->isPlaceholder())
-        item->frame()->removeEventFilter(this);
     AnchorGroup anchorGroup = item->anchorGroup();
     anchorGroup.removeItem(item);
     m_items.removeOne(item);
+    m_itemsToCheck.remove(item);
+    m_itemsWithPendingFrameGeometry.removeOne(item);
+    disconnect(item, &Item::geometryChanged, this, &MultiSplitterLayout::invalidateItemGrid);
+    invalidateItemGrid();
+
+    if (m_beingCleared) {
+        // The anchors are about to be deleted anyway, and clear() emits the count change once
+        return;
+    }
 
     updateAnchorFollowing();
 
@@ -656,7 +840,14 @@ bool MultiSplitterLayout::contains(const Frame *frame) const
 
 Item *MultiSplitterLayout::itemAt(QPoint p) const
 {
-    for (Item *item : m_items) {
+    if (m_itemGridDirty)
+        rebuildItemGrid();
+
+    const int index = itemGridCellIndex(p);
+    if (index == -1)
+        return nullptr;
+
+    for (Item *item : m_itemGrid.at(index)) {
         if (!item->isPlaceholder() && item->geometry().contains(p))
             return item;
     }
@@ -664,13 +855,65 @@ Item *MultiSplitterLayout::itemAt(QPoint p) const
     return nullptr;
 }
 
+void MultiSplitterLayout::invalidateItemGrid()
+{
+    m_itemGridDirty = true;
+}
+
+void MultiSplitterLayout::rebuildItemGrid() const
+{
+    // Aim for at most 16x16 cells, but don't make them too small for small layouts
+    const int maxCellsPerSide = 16;
+    m_itemGridCellSize = qMax(32, qMax(width(), height()) / maxCellsPerSide + 1);
+    m_itemGridDimensions = QSize(width() / m_itemGridCellSize + 1, height() / m_itemGridCellSize + 1);
+
+    m_itemGrid.clear();
+    m_itemGrid.resize(m_itemGridDimensions.width() * m_itemGridDimensions.height());
+
+    for (Item *item : m_items) {
+        const QRect geo = item->geometry();
+        if (!geo.isValid())
+            continue;
+
+        const int firstColumn = qMax(0, geo.left() / m_itemGridCellSize);
+        const int lastColumn = qMin(m_itemGridDimensions.width() - 1, geo.right() / m_itemGridCellSize);
+        const int firstRow = qMax(0, geo.top() / m_itemGridCellSize);
+        const int lastRow = qMin(m_itemGridDimensions.height() - 1, geo.bottom() / m_itemGridCellSize);
+
+        for (int row = firstRow; row <= lastRow; ++row) {
+            for (int column = firstColumn; column <= lastColumn; ++column)
+                m_itemGrid[row * m_itemGridDimensions.width() + column].push_back(item);
+        }
+    }
+
+    m_itemGridDirty = false;
+}
+
+int MultiSplitterLayout::itemGridCellIndex(QPoint p) const
+{
+    if (p.x() < 0 || p.y() < 0)
+        return -1;
+
+    const int column = p.x() / m_itemGridCellSize;
+    const int row = p.y() / m_itemGridCellSize;
+    if (column >= m_itemGridDimensions.width() || row >= m_itemGridDimensions.height())
+        return -1;
+
+    return row * m_itemGridDimensions.width() + column;
+}
+
 void MultiSplitterLayout::clear(bool alsoDeleteStaticAnchors)
 {
-    const int oldCount = count();
-    const int oldVisibleCount = visibleCount();
+    const int oldCount = m_beingCleared ? m_countBeforeBulkClear : count();
+    const int oldVisibleCount = m_beingCleared ? m_visibleCountBeforeBulkClear : visibleCount();
     const auto items = m_items;
     m_items.clear(); // Clear the item list first, do avoid ~Item() triggering a removal from the list
     qDeleteAll(items);
+    invalidateItemGrid();
+    m_itemsToCheck.clear();
+    m_itemsWithPendingFrameGeometry.clear();
+    m_anchorsToCheck.clear();
+    m_fullSanityCheckNeeded = true;
 
     const auto anchors = m_anchors;
     m_anchors.clear();
@@ -696,6 +939,8 @@ void MultiSplitterLayout::clear(bool alsoDeleteStaticAnchors)
         m_anchors = { m_topAnchor, m_bottomAnchor, m_leftAnchor, m_rightAnchor };
     }
 
+    invalidateAnchorGraph();
+
     if (oldCount > 0)
         Q_EMIT widgetCountChanged(0);
     if (oldVisibleCount > 0)
@@ -703,6 +948,27 @@ void MultiSplitterLayout::clear(bool alsoDeleteStaticAnchors)
 
 }
 
+void MultiSplitterLayout::beginBulkClear()
+{
+    if (m_beingCleared)
+        return;
+
+    m_countBeforeBulkClear = count();
+    m_visibleCountBeforeBulkClear = visibleCount();
+    m_beingCleared = true;
+}
+
+void MultiSplitterLayout::endBulkClear(bool alsoDeleteStaticAnchors)
+{
+    if (!m_beingCleared) {
+        qWarning() << Q_FUNC_INFO << "beginBulkClear() wasn't called";
+        return;
+    }
+
+    clear(alsoDeleteStaticAnchors);
+    m_beingCleared = false;
+}
+
 int MultiSplitterLayout::visibleCount() const
 {
     int count = 0;
@@ -719,8 +985,74 @@ int MultiSplitterLayout::placeholderCount() const
 
 void MultiSplitterLayout::removeAnchor(Anchor *anchor)
 {
-    if (!m_inDestructor)
+    m_anchorsToCheck.remove(anchor);
+    if (anchor->m_id != -1) {
+        // Its id can be reused by an anchor queued in the same batch
+        if (size_t(anchor->m_id) < m_anchorHasPendingPositionChanged.size())
+            m_anchorHasPendingPositionChanged[size_t(anchor->m_id)] = false;
+        m_freeAnchorIds.push_back(anchor->m_id);
+        anchor->m_id = -1;
+    }
+
+    if (!m_inDestructor) {
         m_anchors.removeOne(anchor);
+        disconnect(anchor, &Anchor::itemsChanged, this, &MultiSplitterLayout::invalidateAnchorGraph);
+        invalidateAnchorGraph();
+    }
+}
+
+void MultiSplitterLayout::invalidateAnchorGraph()
+{
+    m_anchorGraphGeneration++;
+    DockRegistry::bumpLayoutGeneration();
+    invalidateSizeConstraints();
+}
+
+const MultiSplitterLayout::AnchorGraph &MultiSplitterLayout::anchorGraph() const
+{
+    AnchorGraph &graph = m_anchorGraph;
+    if (graph.generation == m_anchorGraphGeneration)
+        return graph;
+
+    graph.nodes.clear();
+    graph.successors.clear();
+    graph.nodeIndexes.assign(size_t(m_anchorIdBound), -1);
+    graph.nodes.reserve(size_t(m_anchors.size()));
+
+    for (int i = 0, end = m_anchors.size(); i < end; ++i) {
+        Anchor *anchor = m_anchors.at(i);
+        AnchorGraph::Node node;
+        node.anchor = anchor;
+        node.isStatic = anchor->isStatic();
+        node.successorsBegin[0] = node.successorsBegin[1] = 0;
+        node.successorsEnd[0] = node.successorsEnd[1] = 0;
+        graph.nodes.push_back(node);
+        graph.nodeIndexes[size_t(anchor->id())] = i;
+    }
+
+    for (AnchorGraph::Node &node : graph.nodes) {
+        for (Anchor::Side side : { Anchor::Side1, Anchor::Side2 }) {
+            const int s = AnchorGraph::sideIndex(side);
+            node.successorsBegin[s] = int(graph.successors.size());
+            for (Anchor *opposite : node.anchor->oppositeAnchors(side)) {
+                const int index = graph.indexOf(opposite);
+                if (index == -1) {
+                    qWarning() << Q_FUNC_INFO << "Anchor not in this layout" << opposite << node.anchor;
+                    continue;
+                }
+
+                // Several items usually share the same opposite anchor
+                const auto begin = graph.successors.cbegin() + node.successorsBegin[s];
+                if (std::find(begin, graph.successors.cend(), index) == graph.successors.cend())
+                    graph.successors.push_back(index);
+            }
+            node.successorsEnd[s] = int(graph.successors.size());
+        }
+    }
+
+    graph.localIndexes.assign(graph.nodes.size(), -1);
+    graph.generation = m_anchorGraphGeneration;
+    return graph;
 }
 
 QPair<int, int> MultiSplitterLayout::boundPositionsForAnchor(Anchor *anchor) const
@@ -754,8 +1086,8 @@ QPair<int, int> MultiSplitterLayout::boundPositionsForAnchor(Anchor *anchor) con
                    << "; orientation=" << anchor->orientation()
                    << "; minSide1Length=" << minSide1Length
                    << "; minSide2Length=" << minSide2Length
-                   << "; side1=" << anchor->side1Items()
-                   << "; side2=" << anchor->side2Items()
+                   << "; side1=" << anchor->debug_side1Items()
+                   << "; side2=" << anchor->debug_side2Items()
                    << "; followee=" << anchor->followee()
                    << "; thickness=" << anchor->thickness();
     }
@@ -763,11 +1095,42 @@ QPair<int, int> MultiSplitterLayout::boundPositionsForAnchor(Anchor *anchor) con
     return { bound1, bound2 };
 }
 
-QHash<Anchor *, QPair<int, int> > MultiSplitterLayout::boundPositionsForAllAnchors() const
+QVector<QPair<int, int>> MultiSplitterLayout::boundPositionsForAllAnchors() const
 {
-    QHash<Anchor *, QPair<int, int> > result;
-    for (Anchor *anchor : m_anchors)
-        result.insert(anchor, boundPositionsForAnchor(anchor));
+    const AnchorGraph &graph = anchorGraph();
+    const size_t numNodes = graph.nodes.size();
+
+    // An anchor's cumulative min-length at one side depends on the anchors at that side, so visit
+    // those first. Each anchor's result is then computed from its neighbours' cached results, which
+    // boundPositionsForAnchor() below just reads.
+    for (Anchor::Side side : { Anchor::Side1, Anchor::Side2 }) {
+        const int s = AnchorGraph::sideIndex(side);
+        const int opposite = AnchorGraph::sideIndex(Anchor::oppositeSide(side));
+
+        std::vector<int> pending(numNodes, 0);
+        std::vector<int> ready;
+        ready.reserve(numNodes);
+        for (size_t i = 0; i < numNodes; ++i) {
+            const AnchorGraph::Node &node = graph.nodes[i];
+            pending[i] = node.successorsEnd[s] - node.successorsBegin[s];
+            if (pending[i] == 0)
+                ready.push_back(int(i));
+        }
+
+        for (size_t i = 0; i < ready.size(); ++i) {
+            const AnchorGraph::Node &node = graph.nodes[size_t(ready[i])];
+            node.anchor->cumulativeMinLength(side);
+            for (int j = node.successorsBegin[opposite]; j < node.successorsEnd[opposite]; ++j) {
+                const int next = graph.successors[size_t(j)];
+                if (--pending[size_t(next)] == 0)
+                    ready.push_back(next);
+            }
+        }
+    }
+
+    QVector<QPair<int, int>> result(m_anchorIdBound);
+    for (const AnchorGraph::Node &node : graph.nodes)
+        result[node.anchor->id()] = boundPositionsForAnchor(node.anchor);
 
     return result;
 }
@@ -961,19 +1324,28 @@ void MultiSplitterLayout::setAnchorBeingDragged(Anchor *anchor)
     m_anchorBeingDragged = anchor;
 }
 
+void MultiSplitterLayout::setResizePolicy(ResizePolicy policy)
+{
+    m_resizePolicy = policy;
+}
+
+void MultiSplitterLayout::setResizeThrottleRate(int hz)
+{
+    if (hz <= 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid rate" << hz;
+        return;
+    }
+
+    m_resizeThrottleRate = hz;
+}
+
 Anchor::List MultiSplitterLayout::anchorsFollowing(Anchor *followee) const
 {
     if (!followee)
         return {};
 
-    Anchor::List followers;
-
-    for (Anchor *a : m_anchors) {
-        if (a->followee() == followee)
-            followers.push_back(a);
-    }
-
-    return followers;
+    // Followers are always in the same layout as their followee
+    return followee->followers();
 }
 
 int MultiSplitterLayout::numAchorsFollowing() const
@@ -991,7 +1363,7 @@ int MultiSplitterLayout::numVisibleAnchors() const
 {
     int count = 0;
     for (Anchor *a : m_anchors) {
-        if (a->separatorWidget()->isVisible())
+        if (a->separatorWidget()->isShown())
             count++;
     }
 
@@ -1056,17 +1428,18 @@ void MultiSplitterLayout::dumpDebug() const
      }
 
     qDebug() << "Anchors:";
+    const QVector<QPair<int, int>> allBounds = boundPositionsForAllAnchors();
     for (Anchor *anchor : m_anchors) {
-        auto side1Widgets = anchor->items(Anchor::Side1);
-        auto side2Widgets = anchor->items(Anchor::Side2);
-        auto bounds = anchor->isStatic() ? QPair<int, int>() : boundPositionsForAnchor(anchor);
+        const ItemList side1Widgets = anchor->debug_side1Items();
+        const ItemList side2Widgets = anchor->debug_side2Items();
+        auto bounds = anchor->isStatic() ? QPair<int, int>() : allBounds.value(anchor->id());
         qDebug() << "\n    " << anchor
                  << "; side1=" << side1Widgets
                  << "; side2=" << side2Widgets
                  << "; pos=" << anchor->position()
                  << "; sepWidget.pos=" << (anchor->isVertical() ? anchor->separatorWidget()->x()
                                                                 : anchor->separatorWidget()->y())
-                 << "; sepWidget.visible=" << anchor->separatorWidget()->isVisible()
+                 << "; sepWidget.visible=" << anchor->separatorWidget()->isShown()
                  << "; geo=" << anchor->geometry()
                  << "; sep.geo=" << anchor->separatorWidget()->geometry()
                  << "; bounds=" << bounds
@@ -1093,9 +1466,10 @@ void MultiSplitterLayout::positionStaticAnchors()
 
 void MultiSplitterLayout::redistributeSpace()
 {
+    KDDW_TRACE_SCOPE("MultiSplitterLayout::redistributeSpace");
     positionStaticAnchors();
-    redistributeSpace_recursive(m_leftAnchor, 0);
-    redistributeSpace_recursive(m_topAnchor, 0);
+    redistributeSpaceFrom(m_leftAnchor);
+    redistributeSpaceFrom(m_topAnchor);
 }
 
 void MultiSplitterLayout::redistributeSpace(QSize oldSize, QSize newSize)
@@ -1110,15 +1484,24 @@ void MultiSplitterLayout::redistributeSpace(QSize oldSize, QSize newSize)
     const bool heightChanged = oldSize.height() != newSize.height();
 
     if (widthChanged)
-        redistributeSpace_recursive(m_leftAnchor, 0);
+        redistributeSpaceFrom(m_leftAnchor);
     if (heightChanged)
-        redistributeSpace_recursive(m_topAnchor, 0);
+        redistributeSpaceFrom(m_topAnchor);
+}
+
+void MultiSplitterLayout::redistributeSpaceFrom(Anchor *staticAnchor)
+{
+    if (Config::self().flags() & Config::Flag_LinearLayoutSolver)
+        redistributeSpace_linear(staticAnchor);
+    else
+        redistributeSpace_recursive(staticAnchor, 0);
 }
 
 void MultiSplitterLayout::redistributeSpace_recursive(Anchor *fromAnchor, int minAnchorPos)
 {
-    for (Item *item : fromAnchor->items(Anchor::Side2)) {
-        Anchor *nextAnchor = item->anchorAtSide(Anchor::Side2, fromAnchor->orientation());
+    KDDW_STATS_TRACK_DEPTH(maxRedistributeSpaceDepth);
+    const Anchor::List nextAnchors = fromAnchor->oppositeAnchors(Anchor::Side2);
+    for (Anchor *nextAnchor : nextAnchors) {
         if (nextAnchor->isStatic())
             continue;
 
@@ -1151,6 +1534,77 @@ void MultiSplitterLayout::redistributeSpace_recursive(Anchor *fromAnchor, int mi
     }
 }
 
+void MultiSplitterLayout::redistributeSpace_linear(Anchor *fromAnchor)
+{
+    // redistributeSpace_recursive() visits each anchor once per path from fromAnchor, and the last
+    // visit wins, which happens once all anchors before it are in their final position. Here we
+    // visit the anchors directly in that order, using Kahn's algorithm.
+    // The bounds come from Anchor::cumulativeMinLength(), which caches each anchor's prefix and
+    // suffix min-lengths, so they're computed in a single sweep and then looked up.
+
+    const AnchorGraph &graph = anchorGraph();
+    const int start = graph.indexOf(fromAnchor);
+    if (start == -1) {
+        qWarning() << Q_FUNC_INFO << "Anchor not in this layout" << fromAnchor;
+        return;
+    }
+
+    const size_t numNodes = graph.nodes.size();
+
+    // The number of not yet positioned side1 neighbours, of each anchor reachable from fromAnchor
+    std::vector<int> inDegree(numNodes, 0);
+    std::vector<bool> seen(numNodes, false);
+    std::vector<int> reachable = { start };
+    seen[size_t(start)] = true;
+    for (size_t i = 0; i < reachable.size(); ++i) {
+        graph.forEachNonStaticSuccessor(reachable[i], Anchor::Side2, [&reachable, &seen, &inDegree] (int successor) {
+            inDegree[size_t(successor)]++;
+            if (!seen[size_t(successor)]) {
+                seen[size_t(successor)] = true;
+                reachable.push_back(successor);
+            }
+        });
+    }
+
+    // Where each anchor wants to be, before bounding. It only depends on the anchor's percentage,
+    // not on where its neighbours end up, so it's computed in a single pass up front.
+    // All anchors reachable from fromAnchor have its orientation.
+    const int layoutLength = length(fromAnchor->orientation());
+    std::vector<int> targetPositions(numNodes, 0);
+    for (int node : reachable)
+        targetPositions[size_t(node)] = int(graph.nodes[size_t(node)].anchor->positionPercentage() * layoutLength);
+
+    // Same meaning as the minAnchorPos argument of redistributeSpace_recursive(). An anchor
+    // reached through several paths uses the most restrictive one.
+    std::vector<int> minAnchorPositions(numNodes, 0);
+
+    std::vector<int> order = { start };
+    order.reserve(reachable.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        const int node = order[i];
+        Anchor *anchor = graph.nodes[size_t(node)].anchor;
+        int minAnchorPos = minAnchorPositions[size_t(node)];
+
+        if (node != start) {
+            if (anchor->hasNonPlaceholderItems(Anchor::Side1))
+                minAnchorPos = anchor->minPosition();
+
+            if (anchor->hasNonPlaceholderItems(Anchor::Side2) && !anchor->isFollowing()) {
+                const QPair<int, int> bounds = boundPositionsForAnchor(anchor);
+                const int newPositionBounded = qMax(bounds.first, qBound(minAnchorPos, targetPositions[size_t(node)], bounds.second));
+                anchor->setPosition(newPositionBounded, Anchor::SetPositionOption_DontRecalculatePercentage);
+            }
+        }
+
+        graph.forEachNonStaticSuccessor(node, Anchor::Side2, [&order, &inDegree, &minAnchorPositions, minAnchorPos] (int successor) {
+            int &successorMin = minAnchorPositions[size_t(successor)];
+            successorMin = qMax(successorMin, minAnchorPos);
+            if (--inDegree[size_t(successor)] == 0)
+                order.push_back(successor);
+        });
+    }
+}
+
 void MultiSplitterLayout::updateSizeConstraints()
 {
     const int minH = m_topAnchor->cumulativeMinLength(Anchor::Side2);
@@ -1232,7 +1686,7 @@ Anchor *MultiSplitterLayout::newAnchor(AnchorGroup &group, Location location)
 
     qCDebug(::anchors()) << newAnchor->hasNonPlaceholderItems(Anchor::Side1)
                          << newAnchor->hasNonPlaceholderItems(Anchor::Side2)
-                         << newAnchor->side1Items() << newAnchor->side2Items()
+                         << newAnchor->debug_side1Items() << newAnchor->debug_side2Items()
                          << "; donor" << donor
                          << "; follows=" << newAnchor->followee();
     return newAnchor;
@@ -1248,9 +1702,94 @@ void MultiSplitterLayout::blockItemPropagateGeo(bool block)
     }
 }
 
+void MultiSplitterLayout::beginTransaction()
+{
+    m_transactionDepth++;
+}
+
+void MultiSplitterLayout::endTransaction()
+{
+    Q_ASSERT(m_transactionDepth > 0);
+    if (--m_transactionDepth > 0)
+        return;
+
+    // One solve, then one geometry push per frame
+    updateSizeConstraints();
+    ensureAnchorsBounded();
+
+    for (Item *item : qAsConst(m_items)) {
+        if (!item->isPlaceholder()) {
+            KDDW_STATS_INCREMENT(frameGeometryPushes);
+            item->frame()->setGeometry(item->geometry());
+        }
+    }
+
+    maybeCheckSanity();
+}
+
+void MultiSplitterLayout::beginFrameGeometryBatch()
+{
+    m_frameGeometryBatchDepth++;
+}
+
+void MultiSplitterLayout::endFrameGeometryBatch()
+{
+    Q_ASSERT(m_frameGeometryBatchDepth > 0);
+    if (--m_frameGeometryBatchDepth > 0)
+        return;
+
+    // Swap first, as resizing a frame might trigger another batch
+    ItemList items;
+    items.swap(m_itemsWithPendingFrameGeometry);
+
+    for (Item *item : qAsConst(items)) {
+        if (!item->isPlaceholder() && item->frame()) {
+            KDDW_STATS_INCREMENT(frameGeometryPushes);
+            item->frame()->setGeometry(item->geometry());
+        }
+    }
+
+    QVector<QPointer<Anchor>> anchors;
+    anchors.swap(m_anchorsWithPendingPositionChanged);
+    for (Anchor *anchor : qAsConst(anchors)) {
+        if (anchor && anchor->id() != -1) // Removed ones were already cleared by removeAnchor()
+            m_anchorHasPendingPositionChanged[size_t(anchor->id())] = false;
+    }
+
+    for (Anchor *anchor : qAsConst(anchors)) {
+        if (anchor)
+            Q_EMIT anchor->positionChanged(anchor->position());
+    }
+}
+
+void MultiSplitterLayout::queueFrameGeometry(Item *item)
+{
+    Q_ASSERT(isBatchingFrameGeometry());
+    if (!m_itemsWithPendingFrameGeometry.contains(item))
+        m_itemsWithPendingFrameGeometry.push_back(item);
+}
+
+void MultiSplitterLayout::queuePositionChanged(Anchor *anchor)
+{
+    if (!isBatchingFrameGeometry() || anchor->id() == -1) { // -1 if already removed, it has no slot in the bitset
+        Q_EMIT anchor->positionChanged(anchor->position());
+        return;
+    }
+
+    // A drag moves the same few anchors over and over, so don't search the queue
+    const size_t id = size_t(anchor->id());
+    if (id >= m_anchorHasPendingPositionChanged.size())
+        m_anchorHasPendingPositionChanged.resize(size_t(m_anchorIdBound), false);
+
+    if (!m_anchorHasPendingPositionChanged[id]) {
+        m_anchorHasPendingPositionChanged[id] = true;
+        m_anchorsWithPendingPositionChanged.push_back(anchor);
+    }
+}
+
 void MultiSplitterLayout::emitVisibleWidgetCountChanged()
 {
-    if (!m_inDestructor)
+    if (!m_inDestructor && !m_beingCleared)
         Q_EMIT visibleWidgetCountChanged(visibleCount());
 }
 
@@ -1280,11 +1819,8 @@ Frame::List MultiSplitterLayout::framesFrom(QWidgetOrQuick *frameOrMultiSplitter
 Frame::List MultiSplitterLayout::frames() const
 {
     Frame::List result;
-
-    for (Item *item : m_items) {
-        if (Frame *f = item->frame())
-            result.push_back(f);
-    }
+    result.reserve(m_items.size());
+    forEachFrame([&result] (Frame *f) { result.push_back(f); });
 
     return result;
 }
@@ -1292,10 +1828,7 @@ Frame::List MultiSplitterLayout::frames() const
 QVector<DockWidgetBase *> MultiSplitterLayout::dockWidgets() const
 {
     DockWidgetBase::List result;
-    const Frame::List frames = this->frames();
-
-    for (Frame *frame : frames)
-        result << frame->dockWidgets();
+    forEachFrame([&result] (Frame *frame) { result << frame->dockWidgets(); });
 
     return result;
 }
@@ -1328,52 +1861,84 @@ QPair<AnchorGroup,Anchor*> MultiSplitterLayout::createTargetAnchorGroup(KDDockWi
 
 bool MultiSplitterLayout::checkSanity(AnchorSanityOption options) const
 {
+    KDDW_STATS_INCREMENT(checkSanityCalls);
     if (m_inCtor || LayoutSaver::restoreInProgress())
         return true;
 
-    auto check = [this, options] (Item *item, Qt::Orientation orientation) {
-        int numSide1 = 0;
-        int numSide2 = 0;
-        const auto &anchors = this->anchors(orientation, /*includeStatic=*/ true);
-        for (Anchor *anchor : anchors) {
-            if (anchor->containsItem(item, Anchor::Side1))
-                numSide1++;
-            if (anchor->containsItem(item, Anchor::Side2))
-                numSide2++;
-        }
+    if (!checkStaticAnchorsSanity())
+        return false;
 
-        if (numSide1 != 1 || numSide2 != 1) {
-            dumpDebug();
-            qWarning() << "MultiSplitterLayout::checkSanity:" << "Problem detected! while processing"
-                       << orientation << "anchors"
-                       << "; numSide1=" << numSide1
-                       << "; numSide2=" << numSide2;
-            for (Anchor *anchor : anchors) {
-                if (anchor->containsItem(item, Anchor::Side1))
-                    qDebug() << "Anchor" << anchor << "contains said widget on side1";
-                if (anchor->containsItem(item, Anchor::Side2))
-                    qDebug() << "Anchor" << anchor << "contains said widget on side2";
-            }
-            qWarning() << "MultiSplitterLayout::checkSanity:" << numSide1 << numSide2 << item
-                       << "\n" << m_topAnchor->items(Anchor::Side2)
-                       << "\n" << m_bottomAnchor->items(Anchor::Side1)
-                       << "\n" << m_leftAnchor->items(Anchor::Side2)
-                       << "\n" << m_rightAnchor->items(Anchor::Side1);
+    // Intersections are checked from the item side, no need to do it twice
+    const auto anchorOptions = AnchorSanityOption(options & ~AnchorSanity_Intersections);
+    for (Anchor *anchor : qAsConst(m_anchors)) {
+        if (!checkAnchorSanity(anchor, anchorOptions))
             return false;
-        }
+    }
 
-        if ((options & AnchorSanity_WidgetInvalidSizes) && !item->isPlaceholder()) {
-            if (item->width() <= 0 || item->height() <= 0) {
-                dumpDebug();
-                qWarning() << "Invalid size for widget" << item << item->size() << "; isPlaceholder=" << item->isPlaceholder()
-                           << "; minSize=" << item->minimumSize();
-                return false;
-            }
-        }
+    for (Item *item : qAsConst(m_items)) {
+        if (!checkItemSanity(item, options))
+            return false;
+    }
+
+    if (!checkToggleActionsSanity())
+        return false;
+
+/* TODO: uncomment when all tests pass
+    if (m_topAnchor->position() != 0 || m_leftAnchor->position() != 0) {
+        qWarning() << Q_FUNC_INFO << "Invalid top or left anchor position"
+                   << m_topAnchor->position() << m_leftAnchor->position();
+        return false;
+    }
 
+    if (m_rightAnchor->position() != m_size.width() - 1 || m_bottomAnchor->position() != m_size.height() - 1) {
+        qWarning() << Q_FUNC_INFO << "Invalid right or bottom anchor position"
+                   << m_rightAnchor->position() << m_bottomAnchor->position()
+                   << "; m_size=" << m_size;
+        return false;
+    }
+*/
+    return true;
+}
+
+bool MultiSplitterLayout::checkSanityIncremental(AnchorSanityOption options)
+{
+    if (m_inCtor || LayoutSaver::restoreInProgress())
         return true;
-    };
 
+    // If most of the layout changed then it's cheaper to check everything
+    const bool fullCheck = m_fullSanityCheckNeeded
+            || m_anchorsToCheck.size() > m_anchors.size() / 2
+            || m_itemsToCheck.size() > m_items.size() / 2;
+
+    const auto anchorsToCheck = m_anchorsToCheck;
+    const auto itemsToCheck = m_itemsToCheck;
+    m_anchorsToCheck.clear();
+    m_itemsToCheck.clear();
+    m_fullSanityCheckNeeded = false;
+
+    if (fullCheck)
+        return checkSanity(options);
+
+    KDDW_STATS_INCREMENT(checkSanityCalls);
+    if (!checkStaticAnchorsSanity())
+        return false;
+
+    for (Anchor *anchor : anchorsToCheck) {
+        // It might have been transferred to another layout meanwhile
+        if (m_anchors.contains(anchor) && !checkAnchorSanity(anchor, options))
+            return false;
+    }
+
+    for (Item *item : itemsToCheck) {
+        if (contains(item) && !checkItemSanity(item, options))
+            return false;
+    }
+
+    return checkToggleActionsSanity();
+}
+
+bool MultiSplitterLayout::checkStaticAnchorsSanity() const
+{
     if (!m_topAnchor || !m_leftAnchor || !m_rightAnchor || !m_bottomAnchor) {
         qWarning() << Q_FUNC_INFO << "Invalid static anchors"
                    << m_leftAnchor << m_topAnchor << m_rightAnchor << m_bottomAnchor;
@@ -1393,158 +1958,192 @@ bool MultiSplitterLayout::checkSanity(AnchorSanityOption options) const
         return false;
     }
 
+    return true;
+}
 
-    for (Anchor *anchor : qAsConst(m_anchors)) {
-        if (!anchor->isValid()) {
-            dumpDebug();
-            qWarning() << "invalid anchor" << anchor;
-            return false;
-        }
+bool MultiSplitterLayout::checkAnchorSanity(Anchor *anchor, AnchorSanityOption options) const
+{
+    if (!anchor->isValid()) {
+        dumpDebug();
+        qWarning() << "invalid anchor" << anchor;
+        return false;
+    }
 
-        auto checkSides = [this, anchor] (Anchor::Side side) {
-            for (Item *item : anchor->items(side)) {
-                if (!contains(item)) {
-                    dumpDebug();
-                    qWarning() << "MultiSplitterLayout::checkSanity: Anchor has" << item << "but multi splitter does not";
-                    return false;
-                }
+    auto checkSides = [this, anchor] (Anchor::Side side) {
+        for (Item *item : anchor->items(side)) {
+            if (!contains(item)) {
+                dumpDebug();
+                qWarning() << "MultiSplitterLayout::checkSanity: Anchor has" << item << "but multi splitter does not";
+                return false;
             }
-            return true;
-        };
-
-        if (!checkSides(Anchor::Side1) || !checkSides(Anchor::Side2))
-            return false;
-
-        if (anchor->isFollowing() && !qobject_cast<Anchor*>(anchor->followee())) {
-            qWarning() << "Anchor is following but followee was deleted already";
-            return false;
         }
+        return true;
+    };
 
-        if (options & AnchorSanity_Followers) {
-            const bool hasItemsOnBothSides = anchor->hasNonPlaceholderItems(Anchor::Side1) && anchor->hasNonPlaceholderItems(Anchor::Side2);
-            if (!anchor->isStatic() && !anchor->isFollowing() && !hasItemsOnBothSides && anchorsFollowing(anchor).isEmpty()) {
-                qWarning() << "Non static anchor should have items on both sides unless it's following or being followed" << anchor;
-            }
-        }
+    if (!checkSides(Anchor::Side1) || !checkSides(Anchor::Side2))
+        return false;
 
-        if (!anchor->isFollowing() &&anchor->geometry() != anchor->separatorWidget()->geometry()) {
-            qWarning() << Q_FUNC_INFO << anchor << anchor->separatorWidget()
-                       << "Inconsistent anchor geometry" << anchor->geometry() << "; " << anchor->separatorWidget()->geometry();
-            return false;
-        }
+    if (anchor->isFollowing() && !qobject_cast<Anchor*>(anchor->followee())) {
+        qWarning() << "Anchor is following but followee was deleted already";
+        return false;
+    }
 
-        if (options & AnchorSanity_Visibility) {
-            if (multiSplitter()->isVisible() && !anchor->isFollowing() && !anchor->separatorWidget()->isVisible()) {
-                qWarning() << Q_FUNC_INFO << "Anchor should be visible" << anchor;
-                return false;
-            }
+    if (options & AnchorSanity_Followers) {
+        const bool hasItemsOnBothSides = anchor->hasNonPlaceholderItems(Anchor::Side1) && anchor->hasNonPlaceholderItems(Anchor::Side2);
+        if (!anchor->isStatic() && !anchor->isFollowing() && !hasItemsOnBothSides && anchorsFollowing(anchor).isEmpty()) {
+            qWarning() << "Non static anchor should have items on both sides unless it's following or being followed" << anchor;
         }
     }
 
-    for (Item *item : qAsConst(m_items)) {
-        if (!check(item, Qt::Vertical))
-            return false;
+    if (!anchor->isFollowing() &&anchor->geometry() != anchor->separatorWidget()->geometry()) {
+        qWarning() << Q_FUNC_INFO << anchor << anchor->separatorWidget()
+                   << "Inconsistent anchor geometry" << anchor->geometry() << "; " << anchor->separatorWidget()->geometry();
+        return false;
+    }
 
-        if (!check(item, Qt::Horizontal))
+    if (options & AnchorSanity_Visibility) {
+        if (multiSplitter()->isVisible() && !anchor->isFollowing() && !anchor->separatorWidget()->isShown()) {
+            qWarning() << Q_FUNC_INFO << "Anchor should be visible" << anchor;
             return false;
+        }
     }
 
-    // Check that no widget intersects with an anchor
+    // Check that no widget intersects with this anchor
     if (options & AnchorSanity_Intersections) {
-        for (Item *item: items()) {
-            for (Anchor *a : anchors()) {
-                if (!item->isPlaceholder() && item->geometry().intersects(a->geometry())) {
-                    dumpDebug();
-                    qWarning() << "MultiSplitterLayout::checkSanity: Widget" << item << "with rect" << item->geometry()
-                               << "Intersects anchor" << a << "with rect" << a->geometry()
-                               << "; a.visible|following|valid|unneeded=" << a->separatorWidget()->isVisible()<< a->isFollowing() << a->isValid() << a->isUnneeded();
-                    return false;
-                }
+        for (Item *item : qAsConst(m_items)) {
+            if (!item->isPlaceholder() && item->geometry().intersects(anchor->geometry())) {
+                dumpDebug();
+                qWarning() << "MultiSplitterLayout::checkSanity: Widget" << item << "with rect" << item->geometry()
+                           << "Intersects anchor" << anchor << "with rect" << anchor->geometry()
+                           << "; a.visible|following|valid|unneeded=" << anchor->separatorWidget()->isShown()<< anchor->isFollowing() << anchor->isValid() << anchor->isUnneeded();
+                return false;
             }
         }
     }
 
-    if (options & AnchorSanity_WidgetGeometry) {
-        for (Item *item: items()) {
+    return true;
+}
 
-            if (!item->isPlaceholder() && item->geometry() != item->frame()->geometry()) {
-                qWarning() << Q_FUNC_INFO << "Invalid geometry for item" << item << item->geometry() << item->frame()->geometry();
-                return false;
+bool MultiSplitterLayout::checkItemSanity(Item *item, AnchorSanityOption options) const
+{
+    for (Qt::Orientation orientation : { Qt::Vertical, Qt::Horizontal }) {
+        int numSide1 = 0;
+        int numSide2 = 0;
+        const auto &anchors = this->anchors(orientation, /*includeStatic=*/ true);
+        for (Anchor *anchor : anchors) {
+            if (anchor->containsItem(item, Anchor::Side1))
+                numSide1++;
+            if (anchor->containsItem(item, Anchor::Side2))
+                numSide2++;
+        }
+
+        if (numSide1 != 1 || numSide2 != 1) {
+            dumpDebug();
+            qWarning() << "MultiSplitterLayout::checkSanity:" << "Problem detected! while processing"
+                       << orientation << "anchors"
+                       << "; numSide1=" << numSide1
+                       << "; numSide2=" << numSide2;
+            for (Anchor *anchor : anchors) {
+                if (anchor->containsItem(item, Anchor::Side1))
+                    qDebug() << "Anchor" << anchor << "contains said widget on side1";
+                if (anchor->containsItem(item, Anchor::Side2))
+                    qDebug() << "Anchor" << anchor << "contains said widget on side2";
             }
+            qWarning() << "MultiSplitterLayout::checkSanity:" << numSide1 << numSide2 << item
+                       << "\n" << m_topAnchor->debug_side2Items()
+                       << "\n" << m_bottomAnchor->debug_side1Items()
+                       << "\n" << m_leftAnchor->debug_side2Items()
+                       << "\n" << m_rightAnchor->debug_side1Items();
+            return false;
+        }
 
-            if (!item->anchorGroup().isValid()) {
-                qWarning() << Q_FUNC_INFO << "Invalid item group for item" << item->anchorGroup();
+        if ((options & AnchorSanity_WidgetInvalidSizes) && !item->isPlaceholder()) {
+            if (item->width() <= 0 || item->height() <= 0) {
+                dumpDebug();
+                qWarning() << "Invalid size for widget" << item << item->size() << "; isPlaceholder=" << item->isPlaceholder()
+                           << "; minSize=" << item->minimumSize();
                 return false;
             }
+        }
+    }
 
-            if (!item->isPlaceholder() && item->anchorGroup().itemSize() != item->size()) {
-                qWarning() << Q_FUNC_INFO << "Invaild item size="
-                           << item->size()
-                           << "group size="
-                           << item->anchorGroup().itemSize();
+    // Check that the widget doesn't intersect with any anchor
+    if ((options & AnchorSanity_Intersections) && !item->isPlaceholder()) {
+        for (Anchor *a : qAsConst(m_anchors)) {
+            if (item->geometry().intersects(a->geometry())) {
+                dumpDebug();
+                qWarning() << "MultiSplitterLayout::checkSanity: Widget" << item << "with rect" << item->geometry()
+                           << "Intersects anchor" << a << "with rect" << a->geometry()
+                           << "; a.visible|following|valid|unneeded=" << a->separatorWidget()->isShown()<< a->isFollowing() << a->isValid() << a->isUnneeded();
                 return false;
             }
         }
     }
 
-    if (options & AnchorSanity_WidgetMinSizes) {
-        for (Item *item : items()) {
+    if (options & AnchorSanity_WidgetGeometry) {
+        if (!item->isPlaceholder() && item->geometry() != item->frame()->geometry()) {
+            qWarning() << Q_FUNC_INFO << "Invalid geometry for item" << item << item->geometry() << item->frame()->geometry();
+            return false;
+        }
 
-            if (item->isPlaceholder())
-                continue;
+        if (!item->anchorGroup().isValid()) {
+            qWarning() << Q_FUNC_INFO << "Invalid item group for item" << item->anchorGroup();
+            return false;
+        }
 
-            const int minWidth = item->minLength(Qt::Vertical);
-            const int minHeight = item->minLength(Qt::Horizontal);
+        if (!item->isPlaceholder() && item->anchorGroup().itemSize() != item->size()) {
+            qWarning() << Q_FUNC_INFO << "Invaild item size="
+                       << item->size()
+                       << "group size="
+                       << item->anchorGroup().itemSize();
+            return false;
+        }
+    }
 
-            if (item->width() < minWidth) {
-                qWarning() << "MultiSplitterLayout::checkSanity: Widget has width=" << item->width()
-                           << "but minimum is" << minWidth
-                           << item;
-                return false;
-            }
+    if ((options & AnchorSanity_WidgetMinSizes) && !item->isPlaceholder()) {
+        const int minWidth = item->minLength(Qt::Vertical);
+        const int minHeight = item->minLength(Qt::Horizontal);
 
-            if (item->height() < minHeight) {
-                qWarning() << "MultiSplitterLayout::checkSanity: Widget has height=" << item->height()
-                           << "but minimum is" << minHeight
-                           << item;
-                return false;
-            }
+        if (item->width() < minWidth) {
+            qWarning() << "MultiSplitterLayout::checkSanity: Widget has width=" << item->width()
+                       << "but minimum is" << minWidth
+                       << item;
+            return false;
+        }
+
+        if (item->height() < minHeight) {
+            qWarning() << "MultiSplitterLayout::checkSanity: Widget has height=" << item->height()
+                       << "but minimum is" << minHeight
+                       << item;
+            return false;
         }
     }
 
+    return true;
+}
+
+bool MultiSplitterLayout::checkToggleActionsSanity() const
+{
     for (DockWidgetBase *dw : DockRegistry::self()->dockwidgets()) {
         Frame *frame = dw->frame();
         auto tabWidgetParent = frame ? frame->tabWidget() : nullptr;
         const bool shouldBeChecked = dw->isVisible() || tabWidgetParent;
 
-        if (shouldBeChecked != dw->toggleAction()->isChecked()) {
+        // isOpen() is what the toggle action is checked with, without creating it
+        if (shouldBeChecked != dw->isOpen()) {
             qWarning() << Q_FUNC_INFO << "Invalid state for DockWidgetBase::toggleAction()"
-                       << dw->toggleAction()->isChecked();
+                       << dw->isOpen();
             return false;
         }
     }
 
-/* TODO: uncomment when all tests pass
-    if (m_topAnchor->position() != 0 || m_leftAnchor->position() != 0) {
-        qWarning() << Q_FUNC_INFO << "Invalid top or left anchor position"
-                   << m_topAnchor->position() << m_leftAnchor->position();
-        return false;
-    }
-
-    if (m_rightAnchor->position() != m_size.width() - 1 || m_bottomAnchor->position() != m_size.height() - 1) {
-        qWarning() << Q_FUNC_INFO << "Invalid right or bottom anchor position"
-                   << m_rightAnchor->position() << m_bottomAnchor->position()
-                   << "; m_size=" << m_size;
-        return false;
-    }
-*/
     return true;
 }
 
 void MultiSplitterLayout::maybeCheckSanity()
 {
 #if defined(DOCKS_DEVELOPER_MODE)
-    if (!isRestoringPlaceholder() && !checkSanity(AnchorSanityOption(AnchorSanity_All & ~AnchorSanity_Visibility)))
+    if (!isRestoringPlaceholder() && !isInTransaction() && !checkSanityIncremental(AnchorSanityOption(AnchorSanity_All & ~AnchorSanity_Visibility)))
         qWarning() << Q_FUNC_INFO << "Sanity check failed";
 #endif
 }
@@ -1567,6 +2166,7 @@ void MultiSplitterLayout::ensureHasAvailableSize(QSize needed)
 
 void MultiSplitterLayout::restorePlaceholder(Item *item)
 {
+    KDDW_TRACE_SCOPE("MultiSplitterLayout::restorePlaceholder");
     QScopedValueRollback<bool> restoring(m_restoringPlaceholder, true);
 
     AnchorGroup anchorGroup = item->anchorGroup();
@@ -1574,8 +2174,7 @@ void MultiSplitterLayout::restorePlaceholder(Item *item)
     const QSize availableSize = this->availableSize();
     const QSize hardcodedMinSize = MultiSplitterLayout::hardcodedMinimumSize();
 
-    const QSize widgetMinSize = { qMax(hardcodedMinSize.width(), KDDockWidgets::widgetMinLength(item->frame(), Qt::Vertical)),
-                                  qMax(hardcodedMinSize.height(), KDDockWidgets::widgetMinLength(item->frame(), Qt::Horizontal)) };
+    const QSize widgetMinSize = item->frame()->minSize().expandedTo(hardcodedMinSize);
 
     const QSize newSize = {qMax(qMin(item->length(Qt::Vertical), availableSize.width()), widgetMinSize.width()),
                            qMax(qMin(item->length(Qt::Horizontal), availableSize.height()), widgetMinSize.height()) };
@@ -1587,7 +2186,7 @@ void MultiSplitterLayout::restorePlaceholder(Item *item)
     item->beginBlockPropagateGeo();
     updateSizeConstraints();
 
-    Anchor::List anchorsFollowing = anchorGroup.anchorsFollowingInwards();
+    const AnchorGroup::AnchorArray anchorsFollowing = anchorGroup.anchorsFollowingInwards();
     if (anchorsFollowing.isEmpty()) {
         // There's no separator to move, it means it's a static anchor group (layout is empty, so the anchors
         // are the actual borders of the window
@@ -1600,7 +2199,7 @@ void MultiSplitterLayout::restorePlaceholder(Item *item)
     }
 
     clearAnchorsFollowing();
-    QHash<Anchor*,Anchor*> anchorsThatWillFollowOthers = anchorsShouldFollow();
+    const std::vector<Anchor *> anchorsThatWillFollowOthers = anchorsShouldFollow();
 
     if (!anchorsFollowing.contains(anchorGroup.top) && !anchorsFollowing.contains(anchorGroup.bottom)) {
         anchorGroup.top->updateItemSizes();
@@ -1617,14 +2216,12 @@ void MultiSplitterLayout::restorePlaceholder(Item *item)
         Anchor *side1Anchor = anchorGroup.anchorAtSide(Anchor::Side1, orientation); // returns the left if vertical, otherwise top
         Anchor *side2Anchor = anchorGroup.anchorAtSide(Anchor::Side2, orientation); // returns the right if vertical, otherwise bottom
 
-        if (anchorsThatWillFollowOthers.contains(side1Anchor)) {
-            Anchor *followee = anchorsThatWillFollowOthers.value(side1Anchor);
+        if (Anchor *followee = anchorsThatWillFollowOthers[size_t(side1Anchor->id())]) {
             side1Anchor->setFollowee(followee);
             side1Anchor = followee;
         }
 
-        if (anchorsThatWillFollowOthers.contains(side2Anchor)) {
-            Anchor *followee = anchorsThatWillFollowOthers.value(side2Anchor);
+        if (Anchor *followee = anchorsThatWillFollowOthers[size_t(side2Anchor->id())]) {
             side2Anchor->setFollowee(followee);
             side2Anchor = followee;
         }
@@ -1702,11 +2299,48 @@ void MultiSplitterLayout::unrefOldPlaceholders(const Frame::List &framesBeingAdd
             }
         }
     }
+
+    collectPlaceholderGarbage();
+}
+
+void MultiSplitterLayout::collectPlaceholderGarbage() const
+{
+    const int maxPlaceholders = Config::self().maxPlaceholdersPerLayout();
+    if (maxPlaceholders <= 0)
+        return;
+
+    ItemList placeholders;
+    for (Item *item : m_items) {
+        if (item->isPlaceholder())
+            placeholders.push_back(item);
+    }
+
+    if (placeholders.size() <= maxPlaceholders)
+        return;
+
+    std::sort(placeholders.begin(), placeholders.end(), [] (Item *item1, Item *item2) {
+        return item1->placeholderSerial() < item2->placeholderSerial();
+    });
+
+    // QPointer, as releasing a placeholder deletes it, and removing it from the layout might delete others
+    QVector<QPointer<Item>> oldest;
+    for (int i = 0, end = placeholders.size() - maxPlaceholders; i < end; ++i)
+        oldest.push_back(placeholders.at(i));
+
+    qCDebug(placeholder) << Q_FUNC_INFO << "Dropping" << oldest.size() << "placeholders";
+    KDDW_LOG_EVENT(LogEvent::PlaceholdersDropped, this, oldest.size());
+    for (const QPointer<Item> &item : qAsConst(oldest)) {
+        if (item)
+            DockRegistry::self()->releasePlaceholder(item);
+    }
 }
 
 void MultiSplitterLayout::setSize(QSize size)
 {
     if (size != m_size) {
+        KDDW_STATS_TIME_SCOPE(lastResizeUSecs);
+        KDDW_LOG_EVENT(LogEvent::LayoutResized, this, size.width(), size.height());
+        FrameGeometryBatch batch(this);
         m_resizing = true;
         QSize oldSize = m_size;
 
@@ -1725,6 +2359,7 @@ void MultiSplitterLayout::setSize(QSize size)
 #endif
 
         m_size = size;
+        invalidateItemGrid(); // The cells depend on the size
         Q_EMIT sizeChanged(size);
 
         redistributeSpace(oldSize, size);
@@ -1765,8 +2400,10 @@ void MultiSplitterLayout::setMinimumSize(QSize sz)
 
 void MultiSplitterLayout::updateAnchorsFromTo(Anchor *oldAnchor, Anchor *newAnchor)
 {
-    // Update the from/to of other anchors
-    for (Anchor *other : qAsConst(m_anchors)) {
+    // Update the from/to of other anchors. Only the ones depending on oldAnchor can have it as from/to.
+    // Copied, as setTo() and setFrom() change it
+    const Anchor::List dependents = oldAnchor->m_dependents;
+    for (Anchor *other : dependents) {
         Q_ASSERT(other);
         Q_ASSERT(other->isValid());
         if (!other->isStatic() && other->orientation() != newAnchor->orientation()) {
@@ -1798,7 +2435,18 @@ void MultiSplitterLayout::updateAnchorFollowing(const AnchorGroup &groupBeingRem
 {
     clearAnchorsFollowing();
 
-    QHash<Anchor *, int> newPositionsWhenGroupRemoved;
+    // The anchors to shift, with their new position. Each anchor only appears once, see newPositionIndexes
+    QVector<QPair<Anchor *, int>> newPositionsWhenGroupRemoved;
+    std::vector<int> newPositionIndexes(size_t(anchorIdBound()), -1); // Indexed by Anchor::id()
+    auto setNewPosition = [&newPositionsWhenGroupRemoved, &newPositionIndexes] (Anchor *anchor, int position) {
+        int &index = newPositionIndexes[size_t(anchor->id())];
+        if (index == -1) {
+            index = newPositionsWhenGroupRemoved.size();
+            newPositionsWhenGroupRemoved.push_back({ anchor, position });
+        } else {
+            newPositionsWhenGroupRemoved[index].second = position;
+        }
+    };
 
     for (Anchor *anchor : qAsConst(m_anchors)) {
         if (anchor->isStatic())
@@ -1813,7 +2461,7 @@ void MultiSplitterLayout::updateAnchorFollowing(const AnchorGroup &groupBeingRem
                         const int delta = toFollow->position() - anchor->position() - anchor->thickness();
                         const int halfDelta = int(delta / 2.0);
                         if (halfDelta > 0) {
-                            newPositionsWhenGroupRemoved.insert(toFollow, toFollow->position() - halfDelta);
+                            setNewPosition(toFollow, toFollow->position() - halfDelta);
                         }
                     }
                 }
@@ -1830,7 +2478,7 @@ void MultiSplitterLayout::updateAnchorFollowing(const AnchorGroup &groupBeingRem
                         const int delta = anchor->position() - toFollow->position() - toFollow->thickness();
                         const int halfDelta = int(delta / 2.0);
                         if (halfDelta > 0) {
-                            newPositionsWhenGroupRemoved.insert(toFollow, toFollow->position() + halfDelta);
+                            setNewPosition(toFollow, toFollow->position() + halfDelta);
                         }
                     }
                 }
@@ -1841,9 +2489,9 @@ void MultiSplitterLayout::updateAnchorFollowing(const AnchorGroup &groupBeingRem
     }
 
 
-    for (auto it = newPositionsWhenGroupRemoved.begin(), end = newPositionsWhenGroupRemoved.end(); it != end; ++it) {
-        Anchor *anchorToShift = it.key();
-        const int newPosition = it.value();
+    for (const QPair<Anchor *, int> &newPositionWhenGroupRemoved : qAsConst(newPositionsWhenGroupRemoved)) {
+        Anchor *anchorToShift = newPositionWhenGroupRemoved.first;
+        const int newPosition = newPositionWhenGroupRemoved.second;
         const Anchor::Side sideToShiftTo = newPosition < anchorToShift->position() ? Anchor::Side1
                                                                                    : Anchor::Side2;
         bool doShift = true;
@@ -1862,9 +2510,9 @@ void MultiSplitterLayout::updateAnchorFollowing(const AnchorGroup &groupBeingRem
     ensureAnchorsBounded();
 }
 
-QHash<Anchor*, Anchor*> MultiSplitterLayout::anchorsShouldFollow() const
+std::vector<Anchor *> MultiSplitterLayout::anchorsShouldFollow() const
 {
-    QHash<Anchor*, Anchor*> followers;
+    std::vector<Anchor *> followers(size_t(anchorIdBound()), nullptr);
 
     for (Anchor *anchor : m_anchors) {
         if (anchor->isStatic())
@@ -1872,12 +2520,12 @@ QHash<Anchor*, Anchor*> MultiSplitterLayout::anchorsShouldFollow() const
 
         if (anchor->onlyHasPlaceholderItems(Anchor::Side2)) {
             Anchor *toFollow = anchor->findNearestAnchorWithItems(Anchor::Side2);
-            if (followers.value(toFollow) != anchor)
-                followers.insert(anchor, toFollow);
+            if (followers[size_t(toFollow->id())] != anchor)
+                followers[size_t(anchor->id())] = toFollow;
         } else if (anchor->onlyHasPlaceholderItems(Anchor::Side1)) {
             Anchor *toFollow = anchor->findNearestAnchorWithItems(Anchor::Side1);
-            if (followers.value(toFollow) != anchor)
-                followers.insert(anchor, toFollow);
+            if (followers[size_t(toFollow->id())] != anchor)
+                followers[size_t(anchor->id())] = toFollow;
         }
     }
 
@@ -1886,37 +2534,33 @@ QHash<Anchor*, Anchor*> MultiSplitterLayout::anchorsShouldFollow() const
 
 void MultiSplitterLayout::insertAnchor(Anchor *anchor)
 {
+    if (m_freeAnchorIds.empty()) {
+        anchor->m_id = m_anchorIdBound++;
+    } else {
+        anchor->m_id = m_freeAnchorIds.back();
+        m_freeAnchorIds.pop_back();
+    }
+
     m_anchors.append(anchor);
+    connect(anchor, &Anchor::itemsChanged, this, &MultiSplitterLayout::invalidateAnchorGraph);
+    invalidateAnchorGraph();
+    markForSanityCheck(anchor);
 }
 
-const ItemList MultiSplitterLayout::items() const
+const ItemList &MultiSplitterLayout::items() const
 {
     return m_items;
 }
 
-bool MultiSplitterLayout::eventFilter(QObject *o, QEvent *e)
-{
-    if (m_inDestructor || e->spontaneous() || !m_multiSplitter)
-        return false;
-
-    if (!m_multiSplitter->isVisible()) {
-        // The whole MultiSplitter isn't visible, don't bother. It probably even is being hidden by ~QMainWindow().
-        return false;
-    }
-
-    QWidget *w = qobject_cast<QWidget*>(o);
-    if (!w || !w->testAttribute(Qt::WA_WState_ExplicitShowHide)) {
-        // We only care about explicit show/hide by the developer
-        return false;
-    }
-
-    return false;
-}
-
 bool MultiSplitterLayout::deserialize(const LayoutSaver::MultiSplitterLayout &msl)
 {
     clear(true);
 
+    // The saved geometry was already scaled to this window, see LayoutSaver::Layout::scaleSizes().
+    // Frames only get it once everything is in place, in a single pass, instead of being
+    // resized progressively while the anchors are restored and setSize() adjusts them.
+    FrameGeometryBatch frameGeometryBatch(this);
+
     ItemList items;
     items.reserve(msl.items.size());
     for (const auto &i : qAsConst(msl.items)) {
@@ -1970,6 +2614,7 @@ bool MultiSplitterLayout::deserialize(const LayoutSaver::MultiSplitterLayout &ms
 
     m_size = msl.size;
     m_minSize = msl.minSize;
+    invalidateItemGrid();
 
     // Now that the anchors were created we can add them to the items
     for (Item *item : qAsConst(m_items)) {
@@ -1991,6 +2636,10 @@ bool MultiSplitterLayout::deserialize(const LayoutSaver::MultiSplitterLayout &ms
         item->setProperty("bottomIndex", QVariant());
     }
 
+    // Anchors and items were connected directly, without going through Anchor::addItem()
+    invalidateAnchorGraph();
+    m_fullSanityCheckNeeded = true;
+
     if (!m_items.isEmpty())
         Q_EMIT widgetCountChanged(m_items.size());
 
@@ -2007,6 +2656,33 @@ bool MultiSplitterLayout::deserialize(const LayoutSaver::MultiSplitterLayout &ms
     return true;
 }
 
+void MultiSplitterLayout::restoreAnchorPositions(const LayoutSaver::MultiSplitterLayout &saved)
+{
+    if (saved.anchors.size() != m_anchors.size()) {
+        qWarning() << Q_FUNC_INFO << "Different anchors" << saved.anchors.size() << m_anchors.size();
+        return;
+    }
+
+    // m_size and the static anchors stay as they are. If we were resized since the layout was saved,
+    // the positions are scaled to our size, and ensureAnchorsBounded() fixes what breaks min sizes.
+    beginTransaction();
+    for (int i = 0; i < m_anchors.size(); ++i) {
+        Anchor *anchor = m_anchors.at(i);
+        if (anchor->isStatic())
+            continue;
+
+        const LayoutSaver::Anchor &a = saved.anchors.at(i);
+        const int savedPosition = a.isVertical() ? a.geometry.x() : a.geometry.y();
+        const int savedLength = a.isVertical() ? saved.size.width() : saved.size.height();
+        const int currentLength = length(anchor->orientation());
+        if (savedLength == currentLength || savedLength <= 0)
+            anchor->setPosition(savedPosition);
+        else
+            anchor->setPosition(int(double(savedPosition) * currentLength / savedLength));
+    }
+    endTransaction();
+}
+
 LayoutSaver::MultiSplitterLayout MultiSplitterLayout::serialize() const
 {
     LayoutSaver::MultiSplitterLayout l;
@@ -41,6 +41,9 @@
 #include "LayoutSaver_p.h"
 
 #include <QPointer>
+#include <QSet>
+
+#include <vector>
 
 namespace KDDockWidgets {
 
@@ -171,6 +174,9 @@ public:
 
     /**
      * @brief Returns the visible Item at pos @p p.
+     *
+     * Uses a uniform grid over the layout, so it doesn't need to test every item.
+     * The grid is rebuilt lazily after any item changes geometry.
      */
     Item *itemAt(QPoint p) const;
 
@@ -180,6 +186,21 @@ public:
      */
     void clear(bool alsoDeleteStaticAnchors = false);
 
+    /**
+     * @brief Marks the layout as about to be cleared.
+     *
+     * Until @ref endBulkClear(), removing items doesn't consume anchors, doesn't update anchor
+     * following and doesn't emit the count signals. Used by DockRegistry::clear(), which closes
+     * every dock widget before clearing the layout, so that work would be thrown away anyway.
+     */
+    void beginBulkClear();
+
+    ///@brief Clears the layout, like @ref clear(), and leaves the bulk-clear mode started with @ref beginBulkClear()
+    void endBulkClear(bool alsoDeleteStaticAnchors);
+
+    ///@brief returns whether we're between beginBulkClear() and endBulkClear()
+    bool isBeingCleared() const { return m_beingCleared; }
+
     /**
      * @brief Returns the number of Item objects in this layout.
      * This includes non-visible (placeholder) Items too.
@@ -218,8 +239,9 @@ public:
 
     /**
      * @brief The list of items in this layout.
+     * Returned by reference, copy it before iterating if the loop adds or removes items.
      */
-    const ItemList items() const;
+    const ItemList &items() const;
 
     /**
      * Called by the indicators, so they draw the drop rubber band at the correct place.
@@ -232,12 +254,141 @@ public:
     bool deserialize(const LayoutSaver::MultiSplitterLayout &);
     LayoutSaver::MultiSplitterLayout serialize() const;
 
+    /**
+     * @brief Moves the separators to their positions in @p saved, which has the same anchors and items as we do.
+     *
+     * For restoring sizes without rebuilding the layout. Our size isn't changed: if it's different from
+     * the saved one, the positions are scaled proportionally. Frames are resized once, at the end.
+     */
+    void restoreAnchorPositions(const LayoutSaver::MultiSplitterLayout &saved);
+
+    /**
+     * @brief Resizes the item of @p frame so its width (if @p orientation is Qt::Vertical) or height
+     * becomes @p newSize.
+     *
+     * The bottom or right anchor is moved first, the top or left one takes whatever is left. Each
+     * anchor is moved once, directly to its final position, and bounded by the neighbours' minimum
+     * sizes. Returns false if @p frame isn't in this layout or the size couldn't be fully honoured.
+     * @sa MainWindowBase::resizeDockWidget()
+     */
+    bool resizeItem(Frame *frame, int newSize, Qt::Orientation);
+
     void setAnchorBeingDragged(Anchor *);
     Anchor *anchorBeingDragged() const { return m_anchorBeingDragged; }
     bool anchorIsBeingDragged() const { return m_anchorBeingDragged != nullptr; }
 
-    ///@brief returns list of separators
-    const Anchor::List anchors() const { return m_anchors; }
+    ///@brief How the frames are resized while a separator is dragged with the mouse
+    enum ResizePolicy {
+        ResizePolicy_Immediate = 0, ///< Every mouse move resizes the frames
+        ResizePolicy_Lazy, ///< A rubber band follows the mouse, the frames are only resized on release
+        ResizePolicy_LazyLivePreview, ///< Like ResizePolicy_Lazy, but shows scaled snapshots of the frames instead of a rubber band
+        ResizePolicy_Throttled ///< The frames are resized at most @ref resizeThrottleRate() times per second
+    };
+    Q_ENUM(ResizePolicy)
+
+    /**
+     * @brief Sets how dragging this layout's separators resizes its frames.
+     * The default comes from Config::Flag_LazyResize and Config::Flag_LazyResizeLivePreview.
+     * Takes effect on the next separator drag.
+     */
+    void setResizePolicy(ResizePolicy);
+    ResizePolicy resizePolicy() const { return m_resizePolicy; }
+
+    ///@brief Sets how many times per second the frames are resized, with ResizePolicy_Throttled. Defaults to 30.
+    void setResizeThrottleRate(int hz);
+    int resizeThrottleRate() const { return m_resizeThrottleRate; }
+
+    ///@brief returns list of separators. Copy it before iterating if the loop adds or removes anchors.
+    const Anchor::List &anchors() const { return m_anchors; }
+
+    /**
+     * @brief Starts a batch of layout changes.
+     *
+     * Until the matching @ref endTransaction(), Items only record their geometry, the Frames
+     * aren't resized and min-size propagation is suspended. Calls can be nested.
+     * @sa MainWindowBase::LayoutTransaction
+     */
+    void beginTransaction();
+
+    /**
+     * @brief Ends a batch of layout changes started with @ref beginTransaction().
+     * When the outer-most transaction ends, the anchors are bounded once and the geometry of all
+     * items is pushed to their frames.
+     */
+    void endTransaction();
+
+    ///@brief returns whether we're inside a @ref beginTransaction() / @ref endTransaction() pair
+    bool isInTransaction() const { return m_transactionDepth > 0; }
+
+    /**
+     * @brief Starts collecting frame geometry changes instead of applying them right away.
+     *
+     * Moving a single anchor can cascade into moving other anchors, which would resize the same
+     * Frame several times. While batching, Items only queue themselves and each queued Frame is
+     * resized once, to its final geometry, when the outer-most batch ends. Unlike transactions,
+     * min-size propagation still happens. Calls can be nested.
+     * @sa FrameGeometryBatch
+     */
+    void beginFrameGeometryBatch();
+
+    ///@brief Ends a batch started with @ref beginFrameGeometryBatch(), flushing the queued frames if it's the outer-most one
+    void endFrameGeometryBatch();
+
+    ///@brief returns whether we're inside a @ref beginFrameGeometryBatch() / @ref endFrameGeometryBatch() pair
+    bool isBatchingFrameGeometry() const { return m_frameGeometryBatchDepth > 0; }
+
+    ///@brief Queues @p item so its Frame gets resized when the current batch ends
+    void queueFrameGeometry(Item *item);
+
+    ///@brief Queues @p anchor so it emits Anchor::positionChanged() once, when the current batch ends
+    void queuePositionChanged(Anchor *anchor);
+
+    ///@brief RAII helper for @ref beginFrameGeometryBatch() and @ref endFrameGeometryBatch()
+    class FrameGeometryBatch
+    {
+    public:
+        explicit FrameGeometryBatch(MultiSplitterLayout *layout)
+            : m_layout(layout)
+        {
+            m_layout->beginFrameGeometryBatch();
+        }
+
+        ~FrameGeometryBatch()
+        {
+            if (m_layout)
+                m_layout->endFrameGeometryBatch();
+        }
+    private:
+        Q_DISABLE_COPY(FrameGeometryBatch)
+        QPointer<MultiSplitterLayout> m_layout;
+    };
+
+    /**
+     * @brief Returns a number that changes whenever the anchor graph changes.
+     *
+     * The anchor graph changes when anchors are added or removed, or when items are added to
+     * or removed from an anchor. Used to invalidate the caches that depend on it, like
+     * Anchor::oppositeAnchors()
+     */
+    int anchorGraphGeneration() const { return m_anchorGraphGeneration; }
+
+    ///@brief Returns one past the biggest Anchor::id() in use, the size for arrays indexed by anchor id
+    int anchorIdBound() const { return m_anchorIdBound; }
+
+    /**
+     * @brief Returns a number that changes whenever the anchor graph changes or an item's
+     * minimum size or placeholder state changes. Used to invalidate Anchor::cumulativeMinLength()'s cache.
+     */
+    int sizeConstraintsGeneration() const { return m_sizeConstraintsGeneration; }
+
+    ///@brief Called by Item when its minimum size, or whether it's a placeholder, changes
+    void invalidateSizeConstraints() { m_sizeConstraintsGeneration++; }
+
+    ///@brief Returns a number that changes whenever one of this layout's anchors moves
+    int anchorPositionsGeneration() const { return m_anchorPositionsGeneration; }
+
+    ///@brief Called by Anchor::setPosition()
+    void invalidateAnchorPositions() { m_anchorPositionsGeneration++; }
 
     /**
      * @brief Returns the list of anchors that are following @p followee
@@ -260,6 +411,12 @@ public:
     ///have a central place that we know will be called
     void addItems_internal(const ItemList &, bool updateConstraints = true, bool emitSignal = true);
 
+    ///@brief overload for the common case of adding a single item, without building a temporary ItemList
+    void addItems_internal(Item *, bool updateConstraints = true, bool emitSignal = true);
+
+    ///@brief the per-item part of addItems_internal(), called once the items are in m_items
+    void setupAddedItem(Item *);
+
     /**
      * @brief Updates the min size of this layout.
      */
@@ -324,8 +481,34 @@ public:
     Q_ENUM(AnchorSanityOption)
 
     bool checkSanity(AnchorSanityOption o = AnchorSanity_All) const;
+
+    /**
+     * @brief Like checkSanity(), but only checks the anchors and items which changed since the
+     * previous call. Falls back to checkSanity() if most of the layout changed.
+     * Changes are only tracked if DOCKS_DEVELOPER_MODE is defined.
+     */
+    bool checkSanityIncremental(AnchorSanityOption o = AnchorSanity_All);
     void maybeCheckSanity();
 
+    ///@brief Called by Anchor and Item when they change, so the next checkSanityIncremental() checks them
+    void markForSanityCheck(Anchor *anchor)
+    {
+#if defined(DOCKS_DEVELOPER_MODE)
+        m_anchorsToCheck.insert(anchor);
+#else
+        Q_UNUSED(anchor);
+#endif
+    }
+
+    void markForSanityCheck(Item *item)
+    {
+#if defined(DOCKS_DEVELOPER_MODE)
+        m_itemsToCheck.insert(item);
+#else
+        Q_UNUSED(item);
+#endif
+    }
+
     void restorePlaceholder(Item *item);
 
     /**
@@ -338,6 +521,9 @@ public:
      */
     void unrefOldPlaceholders(const Frame::List &framesBeingAdded) const;
 
+    ///@brief Drops the oldest placeholders if there's more than Config::maxPlaceholdersPerLayout()
+    void collectPlaceholderGarbage() const;
+
     // For debug
     void dumpDebug() const;
     /**
@@ -354,14 +540,36 @@ public:
 
     /**
      * @brief Returns a list of Frame objects contained in this layout
+     * @sa forEachFrame(), to iterate without building the list
      */
     Frame::List frames() const;
 
     /**
      * @brief Returns a list of DockWidget objects contained in this layout
+     * @sa forEachDockWidget(), to iterate without building the list
      */
     QVector<DockWidgetBase*> dockWidgets() const;
 
+    ///@brief Calls @p func with each Frame of this layout, in item order. Placeholders are skipped.
+    template <typename Func>
+    void forEachFrame(Func func) const
+    {
+        for (Item *item : m_items) {
+            if (Frame *frame = item->frame())
+                func(frame);
+        }
+    }
+
+    ///@brief Calls @p func with each DockWidget of this layout, in the same order as dockWidgets()
+    template <typename Func>
+    void forEachDockWidget(Func func) const
+    {
+        forEachFrame([&func] (Frame *frame) {
+            for (DockWidgetBase *dw : frame->dockWidgets())
+                func(dw);
+        });
+    }
+
     /**
      * @brief Creates an AnchorGroup suited for adding a dockwidget to @location relative to @relativeToItem
      *
@@ -428,7 +636,6 @@ Q_SIGNALS:
     void minimumSizeChanged(QSize);
 
 public:
-    bool eventFilter(QObject *o, QEvent *e) override;
     AnchorGroup anchorsForPos(QPoint pos) const;
     AnchorGroup staticAnchorGroup() const;
     Anchor::List anchors(Qt::Orientation, bool includeStatic = false, bool includePlaceholders = true) const;
@@ -487,6 +694,64 @@ private:
 
     void insertAnchor(Anchor *);
     void removeAnchor(Anchor *);
+    void invalidateAnchorGraph();
+
+    /**
+     * @brief A plain-data copy of the anchor graph, so the solver doesn't have to go through the Anchor QObjects.
+     *
+     * Nodes are indexed like m_anchors. The successors of a node at a given side are the anchors at the
+     * other end of its items, without duplicates, stored contiguously in @ref successors.
+     */
+    struct AnchorGraph
+    {
+        struct Node
+        {
+            Anchor *anchor;
+            bool isStatic;
+            int successorsBegin[2]; // Indexed by sideIndex()
+            int successorsEnd[2];
+        };
+
+        static int sideIndex(Anchor::Side side) { return side == Anchor::Side1 ? 0 : 1; }
+        int indexOf(const Anchor *anchor) const
+        {
+            const int id = anchor ? anchor->id() : -1;
+            return id >= 0 && size_t(id) < nodeIndexes.size() ? nodeIndexes[size_t(id)] : -1;
+        }
+
+        ///@brief Calls func for each non-static successor of node, in the specified direction
+        template <typename Func>
+        void forEachNonStaticSuccessor(int node, Anchor::Side side, Func func) const
+        {
+            const int s = sideIndex(side);
+            const Node &n = nodes[size_t(node)];
+            for (int i = n.successorsBegin[s]; i < n.successorsEnd[s]; ++i) {
+                const int successor = successors[size_t(i)];
+                if (!nodes[size_t(successor)].isStatic)
+                    func(successor);
+            }
+        }
+
+        std::vector<Node> nodes;
+        std::vector<int> successors;
+        std::vector<int> nodeIndexes; // Indexed by Anchor::id()
+        mutable std::vector<int> localIndexes; // Indexed by node, scratch space for propagateResize_linear(). All -1 between uses.
+        int generation = -1;
+    };
+
+    ///@brief Returns the anchor graph, rebuilding it if anchorGraphGeneration() changed since last time
+    const AnchorGraph &anchorGraph() const;
+
+    // The pieces of checkSanity(), so checkSanityIncremental() can run them for a single anchor or item
+    bool checkStaticAnchorsSanity() const;
+    bool checkAnchorSanity(Anchor *anchor, AnchorSanityOption options) const;
+    bool checkItemSanity(Item *item, AnchorSanityOption options) const;
+    bool checkToggleActionsSanity() const;
+
+    ///@brief Marks the grid used by @ref itemAt() as dirty
+    void invalidateItemGrid();
+    void rebuildItemGrid() const;
+    int itemGridCellIndex(QPoint p) const;
 
     /**
      * Returns the min or max position that an anchor can go to (due to minimum size restriction on the widgets).
@@ -503,8 +768,12 @@ private:
 
     /**
      * @brief similar to @ref boundPositionsForAnchor but returns for all anchors
+     *
+     * The result is indexed by Anchor::id().
+     * The cumulative min-lengths are computed in one sweep from each side of the layout, instead of
+     * recursing from every anchor.
      */
-    QHash<Anchor*, QPair<int,int>> boundPositionsForAllAnchors() const;
+    QVector<QPair<int,int>> boundPositionsForAllAnchors() const;
 
     /** Returns how much is available for the new drop. It already counts with the space for new anchor that will be created.
      * So it returns this layout's width() (or height), minus the minimum-sizes of all widgets, minus the thickness of all anchors
@@ -538,7 +807,9 @@ private:
 
     void clearAnchorsFollowing();
     void updateAnchorFollowing(const AnchorGroup &groupBeingRemoved = {});
-    QHash<Anchor *, Anchor *> anchorsShouldFollow() const;
+
+    ///@brief Returns, indexed by Anchor::id(), the anchor each anchor should follow, or nullptr
+    std::vector<Anchor *> anchorsShouldFollow() const;
 
     /**
      * Positions the static anchors at their correct places. Called when the MultiSplitter is resized.
@@ -553,8 +824,19 @@ private:
      **/
     void redistributeSpace();
     void redistributeSpace(QSize oldSize, QSize newSize);
+
+    ///@brief Redistributes the space across the anchors after @p staticAnchor, with the recursive or the linear algorithm
+    void redistributeSpaceFrom(Anchor *staticAnchor);
     void redistributeSpace_recursive(Anchor *fromAnchor, int minAnchorPos);
 
+    /**
+     * @brief Same result as redistributeSpace_recursive(), but visits each anchor once instead of once per path.
+     *
+     * Anchors are positioned in topological order, so all anchors on their side1 were already moved.
+     * Used with Config::Flag_LinearLayoutSolver.
+     */
+    void redistributeSpace_linear(Anchor *fromAnchor);
+
     /**
      * Returns the width (if orientation = Horizontal), or height that is occupied by anchors.
      * For example, an horizontal anchor has 2 or 3 px of width, so that's space that can't be
@@ -577,9 +859,16 @@ private:
     // Helper function for propagateResize()
     void collectPaths(QVector<Anchor::List> &paths, Anchor *fromAnchor, Anchor::Side direction);
 
-    // convenience for the unit-tests
-    // Moves the widget's bottom or right anchor, to resize it.
-    void resizeItem(Frame *frame, int newSize, Qt::Orientation);
+    /**
+     * @brief Alternative to @ref propagateResize, used when Config::Flag_LinearLayoutSolver is set.
+     *
+     * Instead of enumerating every path from @p fromAnchor to the static anchor, it walks the anchor
+     * graph once, computing for each anchor the length of the shortest path going through it.
+     * Each anchor then contributes delta / (shortestPathLength - 1), bounded by its minimum sizes.
+     * This gives the same distribution as propagateResize(), but the cost is linear with the number
+     * of anchors instead of the number of paths.
+     */
+    void propagateResize_linear(int delta, Anchor *fromAnchor, Anchor::Side direction);
 
     void ensureItemsMinSize();
 
@@ -592,6 +881,24 @@ private:
 
     MultiSplitter *const m_multiSplitter;
     Anchor::List m_anchors;
+    int m_anchorGraphGeneration = 0;
+    int m_anchorIdBound = 0;
+    std::vector<int> m_freeAnchorIds;
+    int m_sizeConstraintsGeneration = 0;
+    int m_anchorPositionsGeneration = 0;
+    int m_transactionDepth = 0;
+    int m_frameGeometryBatchDepth = 0;
+    ItemList m_itemsWithPendingFrameGeometry;
+    QVector<QPointer<Anchor>> m_anchorsWithPendingPositionChanged;
+    std::vector<bool> m_anchorHasPendingPositionChanged; // Indexed by Anchor::id(), whether it's in the list above
+
+    // Spatial index for itemAt(). Each cell has the items that intersect it.
+    mutable QVector<ItemList> m_itemGrid;
+    mutable QSize m_itemGridDimensions;
+    mutable int m_itemGridCellSize = 0;
+    mutable bool m_itemGridDirty = true;
+
+    mutable AnchorGraph m_anchorGraph;
 
     Anchor *m_leftAnchor = nullptr;
     Anchor *m_topAnchor = nullptr;
@@ -605,11 +912,23 @@ private:
     bool m_restoringPlaceholder = false;
     bool m_resizing = false;
     bool m_addingItem = false;
+    bool m_beingCleared = false;
+
+    // The counts when beginBulkClear() was called, since the count signals are only emitted at the end
+    int m_countBeforeBulkClear = 0;
+    int m_visibleCountBeforeBulkClear = 0;
 
     QSize m_minSize = QSize(0, 0);
     AnchorGroup m_staticAnchorGroup;
     QPointer<Anchor> m_anchorBeingDragged;
     QSize m_size;
+    ResizePolicy m_resizePolicy = ResizePolicy_Immediate;
+    int m_resizeThrottleRate = 30;
+
+    // What changed since the last checkSanityIncremental()
+    QSet<Anchor*> m_anchorsToCheck;
+    QSet<Item*> m_itemsToCheck;
+    bool m_fullSanityCheckNeeded = true;
 };
 
 inline QDebug operator<<(QDebug d, const AnchorGroup &group) {
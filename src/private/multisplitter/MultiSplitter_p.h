@@ -32,6 +32,9 @@
 #include "docks_export.h"
 #include "QWidgetAdapter.h"
 
+#include <QElapsedTimer>
+#include <QTimer>
+
 namespace KDDockWidgets {
 
 class MultiSplitterLayout;
@@ -55,12 +58,23 @@ public:
     bool isInMainWindow() const;
     MainWindowBase* mainWindow() const;
     FloatingWindow* floatingWindow() const;
+
+    /**
+     * @brief Applies the latest size to the layout now, if a resize is being throttled.
+     * Called when an interactive resize ends. See Config::setWindowResizeThrottleInterval().
+     */
+    void applyPendingResize();
 protected:
     void onLayoutRequest() override;
     bool onResize(QSize newSize) override;
     MultiSplitterLayout *const m_layout;
 private:
+    void applyResize(QSize);
     bool m_inResizeEvent = false;
+
+    // For Config::windowResizeThrottleInterval()
+    QElapsedTimer m_lastResize;
+    QTimer m_resizeThrottleTimer;
 };
 
 }
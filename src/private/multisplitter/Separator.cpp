@@ -74,9 +74,21 @@ void Separator::onMouseRelease()
 
 void Separator::move(int p)
 {
+    const QRect oldGeometry = geometry();
     if (isVertical()) {
         QWidgetAdapter::move(p, y());
     } else {
         QWidgetAdapter::move(x(), p);
     }
+
+    if (geometry() != oldGeometry)
+        onGeometryChanged(oldGeometry);
+}
+
+void Separator::setGeometry(QRect r)
+{
+    const QRect oldGeometry = geometry();
+    QWidgetAdapter::setGeometry(r);
+    if (r != oldGeometry)
+        onGeometryChanged(oldGeometry);
 }
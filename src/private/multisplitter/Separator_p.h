@@ -24,8 +24,6 @@
 #include "docks_export.h"
 #include "QWidgetAdapter.h"
 
-#include <QPointer>
-
 namespace KDDockWidgets {
 class Anchor;
 
@@ -41,15 +39,29 @@ public:
     bool isStatic() const;
     int position() const;
     void move(int p);
-    const QPointer<Anchor> anchor() const { return m_anchor; }
+
+    ///@brief Hides QWidgetAdapter::setGeometry(), so subclasses get onGeometryChanged()
+    void setGeometry(QRect);
+
+    ///@brief Returns whether the separator is shown. Like isVisible(), unless something else paints it, see SeparatorOverlay
+    virtual bool isShown() const { return isVisible(); }
+
+    Anchor *anchor() const { return m_anchor; }
+
+    ///@internal
+    ///@brief Called by ~Anchor, as the separator is only deleted later
+    void clearAnchor() { m_anchor = nullptr; }
 
 protected:
+    ///@brief Called after move() or setGeometry() changed the geometry
+    virtual void onGeometryChanged(QRect oldGeometry) { Q_UNUSED(oldGeometry); }
+
     void onMousePress() override;
     void onMouseMove(QPoint globalPos) override;
     void onMouseRelease() override;
 
 private:
-    const QPointer<Anchor> m_anchor; // QPointer so we don't dereference invalid point in paintEvent() when Anchor is deleted.
+    Anchor *m_anchor; // Nulled by clearAnchor(), so we don't dereference an invalid pointer in paintEvent() when Anchor is deleted.
 };
 
 }
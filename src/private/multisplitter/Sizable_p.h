@@ -0,0 +1,61 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief The interface the layout engine uses to size what it lays out.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_MULTISPLITTER_SIZABLE_P_H
+#define KD_MULTISPLITTER_SIZABLE_P_H
+
+#include "docks_export.h"
+
+#include <QRect>
+#include <QSize>
+
+namespace KDDockWidgets {
+
+/**
+ * @brief What an Item needs from the thing it lays out.
+ *
+ * The layout engine only pushes geometry and visibility and queries the min size, it doesn't care
+ * whether it's a QWidget or a QQuickItem. Frame implements it for both frontends.
+ */
+class DOCKS_EXPORT_FOR_UNIT_TESTS Sizable
+{
+public:
+    virtual ~Sizable();
+
+    virtual QRect geometry() const = 0;
+    virtual void setGeometry(QRect) = 0;
+
+    ///@brief the minimum size, already including MultiSplitterLayout::hardcodedMinimumSize()
+    virtual QSize minSize() const = 0;
+
+    virtual bool isVisible() const = 0;
+    virtual void setVisible(bool) = 0;
+};
+
+}
+
+#endif
@@ -27,20 +27,77 @@
 
 #include "FrameQuick_p.h"
 #include "Config.h"
+#include "FrameworkWidgetFactory.h"
 
+#include <QQmlComponent>
 #include <QDebug>
 
 using namespace KDDockWidgets;
 
+class FrameQuick::Incubator : public QQmlIncubator
+{
+public:
+    explicit Incubator(FrameQuick *frame)
+        : QQmlIncubator(QQmlIncubator::Asynchronous)
+        , m_frame(frame)
+    {
+    }
+
+protected:
+    void setInitialState(QObject *object) override
+    {
+        // Before bindings are evaluated, so "anchors.fill: parent" works right away
+        auto item = static_cast<QQuickItem*>(object);
+        item->setProperty("frameCpp", QVariant::fromValue(m_frame));
+        item->setParentItem(m_frame);
+        item->setParent(m_frame);
+    }
+
+    void statusChanged(Status status) override
+    {
+        m_frame->onIncubatorStatusChanged(status);
+    }
+
+private:
+    FrameQuick *const m_frame;
+};
+
 FrameQuick::FrameQuick(QWidgetAdapter *parent, Options options)
     : Frame(parent, options)
+    , m_component(Config::self().frameworkWidgetFactory()->qmlComponent(
+                      QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Frame.qml"))))
+    , m_incubator(new Incubator(this))
 {
     qDebug() << Q_FUNC_INFO << "Created frame";
-    auto component = new QQmlComponent(Config::self().qmlEngine(),
-                                       QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Frame.qml")));
 
-    auto item = static_cast<QQuickItem*>(component->create());
-    item->setProperty("frameCpp", QVariant::fromValue(this));
-    item->setParentItem(this);
-    item->setParent(this);
+    // Without an incubation controller on the engine this still completes synchronously
+    if (m_component)
+        m_component->create(*m_incubator);
+}
+
+FrameQuick::~FrameQuick()
+{
+    // Deleting the incubator cancels any incubation still in progress
+    m_incubator.reset();
+}
+
+QQuickItem *FrameQuick::visualItem() const
+{
+    return m_visualItem;
+}
+
+void FrameQuick::onIncubatorStatusChanged(QQmlIncubator::Status status)
+{
+    switch (status) {
+    case QQmlIncubator::Ready:
+        m_visualItem = static_cast<QQuickItem*>(m_incubator->object());
+        Q_EMIT visualItemCreated();
+        break;
+    case QQmlIncubator::Error:
+        qWarning() << Q_FUNC_INFO << "Failed to create Frame.qml" << m_incubator->errors();
+        break;
+    case QQmlIncubator::Null:
+    case QQmlIncubator::Loading:
+        break;
+    }
 }
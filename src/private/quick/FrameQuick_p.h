@@ -24,17 +24,43 @@
 
 #include "Frame_p.h"
 
+#include <QQmlIncubator>
+#include <QScopedPointer>
+
+QT_BEGIN_NAMESPACE
+class QQmlComponent;
+QT_END_NAMESPACE
+
 namespace KDDockWidgets {
 
 /**
  * @brief The GUI counterpart of Frame.
+ *
+ * Frame.qml is incubated asynchronously, so restoring a big layout doesn't block the UI thread.
+ * Until it's ready the frame is an empty item, which the layout already sizes and positions
+ * like any other frame, the QML item just fills it once created.
  */
 class DOCKS_EXPORT FrameQuick : public Frame
 {
     Q_OBJECT
 public:
     explicit FrameQuick(QWidgetAdapter *parent = nullptr, Options = Option_None);
+    ~FrameQuick() override;
+
+    ///@brief returns the item created from Frame.qml, or nullptr if it's still being incubated
+    QQuickItem *visualItem() const;
+
+Q_SIGNALS:
+    ///@brief emitted when Frame.qml finished incubating and visualItem() is available
+    void visualItemCreated();
+
+private:
+    class Incubator;
+    void onIncubatorStatusChanged(QQmlIncubator::Status);
 
+    QQmlComponent *const m_component; // Shared, see FrameworkWidgetFactory::qmlComponent()
+    QScopedPointer<Incubator> m_incubator;
+    QQuickItem *m_visualItem = nullptr;
 };
 
 }
@@ -44,12 +44,15 @@ QWidgetAdapter::QWidgetAdapter(QQuickItem *parent, Qt::WindowFlags)
 {
     this->setParent(parent); // also set parentItem
 
+    // updatePolish() calls onResize() itself, once, instead of once per dimension
     connect(this, &QQuickItem::widthChanged, this, [this] {
-        onResize(size());
+        if (!m_applyingGeometry)
+            onResize(size());
     });
 
     connect(this, &QQuickItem::heightChanged, this, [this] {
-        onResize(size());
+        if (!m_applyingGeometry)
+            onResize(size());
     });
 }
 
@@ -78,14 +81,15 @@ FloatingWindow * QWidgetAdapter::floatingWindow() const
 
 QRect QWidgetAdapter::geometry() const
 {
-    QRect r = rect();
-    r.moveTopLeft(QPointF(x(), y()).toPoint());
-    return r;
+    if (m_hasPendingGeometry)
+        return m_pendingGeometry;
+
+    return QRectF(QQuickItem::position(), QQuickItem::size()).toRect();
 }
 
 QRect QWidgetAdapter::rect() const
 {
-    return QRectF(0, 0, width(), height()).toRect();
+    return QRect(QPoint(0, 0), size());
 }
 
 void QWidgetAdapter::show()
@@ -96,22 +100,45 @@ void QWidgetAdapter::show()
 void QWidgetAdapter::setFixedHeight(int height)
 {
     qDebug() << Q_FUNC_INFO << height << this;
-    setHeight(height);
+    QRect r = geometry();
+    r.setHeight(height);
+    setGeometry(r);
 }
 
 void QWidgetAdapter::setFixedWidth(int width)
 {
     qDebug() << Q_FUNC_INFO << width << this;
-    setWidth(width);
+    QRect r = geometry();
+    r.setWidth(width);
+    setGeometry(r);
 }
 
 void QWidgetAdapter::setGeometry(QRect rect)
 {
     qDebug() << Q_FUNC_INFO << rect << this;
-    setWidth(rect.width());
-    setHeight(rect.height());
-    setX(rect.x());
-    setY(rect.y());
+    m_pendingGeometry = rect;
+    if (!m_hasPendingGeometry) {
+        m_hasPendingGeometry = true;
+        polish();
+    }
+}
+
+void QWidgetAdapter::updatePolish()
+{
+    if (!m_hasPendingGeometry)
+        return;
+
+    const QRect rect = m_pendingGeometry;
+    const QSize oldSize = QQuickItem::size().toSize();
+    m_hasPendingGeometry = false;
+
+    m_applyingGeometry = true;
+    setPosition(rect.topLeft());
+    setSize(rect.size());
+    m_applyingGeometry = false;
+
+    if (oldSize != rect.size())
+        onResize(rect.size());
 }
 
 void QWidgetAdapter::grabMouse() {}
@@ -124,8 +151,7 @@ void QWidgetAdapter::setMinimumSize(QSize sz)
 void QWidgetAdapter::resize(QSize sz)
 {
     qDebug() << Q_FUNC_INFO << sz << this;
-    setWidth(sz.width());
-    setHeight(sz.height());
+    setGeometry(QRect(geometry().topLeft(), sz));
 }
 
 QWindow *QWidgetAdapter::windowHandle() const { return nullptr; }
@@ -133,8 +159,7 @@ QWindow *QWidgetAdapter::windowHandle() const { return nullptr; }
 void QWidgetAdapter::move(int x, int y)
 {
     qDebug() << Q_FUNC_INFO << x << y << this;
-    setX(x);
-    setY(y);
+    setGeometry(QRect(QPoint(x, y), geometry().size()));
 }
 
 void QWidgetAdapter::setParent(QQuickItem *p)
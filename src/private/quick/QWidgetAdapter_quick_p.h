@@ -76,11 +76,18 @@ public:
 
     void setFlag(Qt::WindowType, bool on = true);
 
-    int x() const { return int(QQuickItem::x()); }
-    int y() const { return int(QQuickItem::y()); }
-    int width() const { return int(QQuickItem::width()); }
-    int height() const { return int(QQuickItem::height()); }
-
+    int x() const { return geometry().x(); }
+    int y() const { return geometry().y(); }
+    int width() const { return geometry().width(); }
+    int height() const { return geometry().height(); }
+
+    /**
+     * @brief Sets the geometry, which is only applied to the QQuickItem in the next polish pass.
+     *
+     * A layout operation moves many frames and separators, applying each x/y/width/height change
+     * right away would re-evaluate their bindings every time. Instead they're applied together
+     * in updatePolish(), before the scene graph sync. geometry() returns the pending one meanwhile.
+     */
     void setGeometry(QRect);
     QRect geometry() const;
     QRect rect() const;
@@ -91,7 +98,7 @@ public:
     void raise();
     void update() {}
 
-    QSize size() const { return QQuickItem::size().toSize(); }
+    QSize size() const { return geometry().size(); }
     QSize minimumSizeHint() const { return m_minimumSize; }
     QSize minimumSize() const { return m_minimumSize; }
     int minimumHeight() const { return m_minimumSize.height(); }
@@ -120,6 +127,7 @@ public:
 
 protected:
     void raiseAndActivate();
+    void updatePolish() override;
 
     virtual bool onResize(QSize newSize);
     virtual void onLayoutRequest();
@@ -129,6 +137,9 @@ protected:
     virtual void onCloseEvent(QCloseEvent *);
 private:
     QSize m_minimumSize = {0, 0};
+    QRect m_pendingGeometry; // See setGeometry()
+    bool m_hasPendingGeometry = false;
+    bool m_applyingGeometry = false;
 };
 
 }
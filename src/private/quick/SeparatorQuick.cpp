@@ -23,19 +23,53 @@
 #include "multisplitter/Anchor_p.h"
 #include "Logging_p.h"
 #include "Config.h"
+#include "FrameworkWidgetFactory.h"
+#include "SeparatorRendererQuick_p.h"
 
 #include <QQmlComponent>
+#include <QDebug>
 
 using namespace KDDockWidgets;
 
 SeparatorQuick::SeparatorQuick(KDDockWidgets::Anchor *anchor, QWidgetAdapter *parent)
     : Separator(anchor, parent)
 {
-    auto component = new QQmlComponent(Config::self().qmlEngine(),
-                                       QUrl(QStringLiteral("qrc:/kddockwidgets/quick/qml/Separator.qml")));
+    const QUrl customQml = Config::self().separatorQmlUrl();
+    if (customQml.isEmpty()) {
+        updateRenderer();
+        connect(this, &QQuickItem::parentChanged, this, &SeparatorQuick::updateRenderer);
+        return;
+    }
 
+    QQmlComponent *component = Config::self().frameworkWidgetFactory()->qmlComponent(customQml);
+    auto separatorItem = component ? static_cast<QQuickItem*>(component->create()) : nullptr;
+    if (!separatorItem) {
+        qWarning() << Q_FUNC_INFO << "Failed to create separator" << customQml;
+        return;
+    }
 
-    auto separatorItem = static_cast<QQuickItem*>(component->create());
+    separatorItem->setProperty("separatorCpp", QVariant::fromValue(this));
     separatorItem->setParentItem(this);
     separatorItem->setParent(this);
 }
+
+SeparatorQuick::~SeparatorQuick()
+{
+    if (m_renderer)
+        m_renderer->removeSeparator(this);
+}
+
+void SeparatorQuick::updateRenderer()
+{
+    SeparatorRendererQuick *renderer = SeparatorRendererQuick::rendererFor(parentItem());
+    if (renderer == m_renderer)
+        return;
+
+    if (m_renderer)
+        m_renderer->removeSeparator(this);
+
+    m_renderer = renderer;
+
+    if (m_renderer)
+        m_renderer->addSeparator(this);
+}
@@ -23,19 +23,34 @@
 
 #include "multisplitter/Separator_p.h"
 
+#include <QPointer>
+
 
 namespace KDDockWidgets {
 
+class SeparatorRendererQuick;
+
+/**
+ * @brief The QtQuick Separator.
+ *
+ * Doesn't paint itself, unless Config::separatorQmlUrl() is set. SeparatorRendererQuick paints and
+ * hit-tests all separators of the MultiSplitter at once.
+ */
 class DOCKS_EXPORT SeparatorQuick : public Separator
 {
     Q_OBJECT
 public:
     explicit SeparatorQuick(Anchor *anchor, QWidgetAdapter *parent = nullptr);
+    ~SeparatorQuick() override;
 
 protected:
 /*    void paintEvent(QPaintEvent *) override;
     void enterEvent(QEvent *) override;
     void leaveEvent(QEvent *) override;*/
+private:
+    ///@brief registers with the renderer of our current MultiSplitter, as we might have been reparented
+    void updateRenderer();
+    QPointer<SeparatorRendererQuick> m_renderer;
 };
 
 }
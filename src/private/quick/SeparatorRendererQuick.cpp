@@ -0,0 +1,219 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Paints all separators of a MultiSplitter with a single scene graph node.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#include "SeparatorRendererQuick_p.h"
+#include "SeparatorQuick_p.h"
+#include "multisplitter/Anchor_p.h"
+
+#include <QSGGeometryNode>
+#include <QSGFlatColorMaterial>
+#include <QCursor>
+
+using namespace KDDockWidgets;
+
+SeparatorRendererQuick::SeparatorRendererQuick(QQuickItem *multiSplitter)
+    : QQuickItem(multiSplitter)
+{
+    setObjectName(QStringLiteral("_kddw_SeparatorRenderer"));
+    setFlag(ItemHasContents);
+    setAcceptedMouseButtons(Qt::LeftButton);
+    setAcceptHoverEvents(true);
+    setZ(1000); // Above the frames
+
+    connect(multiSplitter, &QQuickItem::widthChanged, this, &SeparatorRendererQuick::updateSize);
+    connect(multiSplitter, &QQuickItem::heightChanged, this, &SeparatorRendererQuick::updateSize);
+    updateSize();
+}
+
+SeparatorRendererQuick *SeparatorRendererQuick::rendererFor(QQuickItem *multiSplitter)
+{
+    if (!multiSplitter)
+        return nullptr;
+
+    const auto children = multiSplitter->childItems();
+    for (QQuickItem *child : children) {
+        if (auto renderer = qobject_cast<SeparatorRendererQuick *>(child))
+            return renderer;
+    }
+
+    return new SeparatorRendererQuick(multiSplitter);
+}
+
+void SeparatorRendererQuick::addSeparator(SeparatorQuick *separator)
+{
+    if (m_separators.contains(separator))
+        return;
+
+    m_separators.push_back(separator);
+
+    // One repaint per frame, however many separators moved
+    connect(separator, &QQuickItem::xChanged, this, &QQuickItem::update);
+    connect(separator, &QQuickItem::yChanged, this, &QQuickItem::update);
+    connect(separator, &QQuickItem::widthChanged, this, &QQuickItem::update);
+    connect(separator, &QQuickItem::heightChanged, this, &QQuickItem::update);
+    connect(separator, &QQuickItem::visibleChanged, this, &QQuickItem::update);
+    update();
+}
+
+void SeparatorRendererQuick::removeSeparator(SeparatorQuick *separator)
+{
+    if (!m_separators.removeOne(separator))
+        return;
+
+    disconnect(separator, nullptr, this, nullptr);
+    update();
+}
+
+SeparatorQuick *SeparatorRendererQuick::separatorAt(QPointF pos) const
+{
+    const QPointF p = mapToItem(parentItem(), pos);
+    for (SeparatorQuick *separator : m_separators) {
+        if (!separator->isVisible() || separator->isStatic())
+            continue;
+
+        Anchor *anchor = separator->anchor();
+        if (!anchor || anchor->isFollowing())
+            continue;
+
+        if (QRectF(separator->geometry()).contains(p))
+            return separator;
+    }
+
+    return nullptr;
+}
+
+void SeparatorRendererQuick::setColor(QColor color)
+{
+    if (color != m_color) {
+        m_color = color;
+        update();
+    }
+}
+
+QSGNode *SeparatorRendererQuick::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    auto node = static_cast<QSGGeometryNode *>(oldNode);
+    if (!node) {
+        node = new QSGGeometryNode();
+        auto geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        node->setGeometry(geometry);
+        node->setFlag(QSGNode::OwnsGeometry);
+        node->setMaterial(new QSGFlatColorMaterial());
+        node->setFlag(QSGNode::OwnsMaterial);
+    }
+
+    int numVisible = 0;
+    for (SeparatorQuick *separator : qAsConst(m_separators)) {
+        if (separator->isVisible())
+            numVisible++;
+    }
+
+    // Two triangles per separator, all in a single draw call
+    QSGGeometry *geometry = node->geometry();
+    geometry->allocate(numVisible * 6);
+    QSGGeometry::Point2D *v = geometry->vertexDataAsPoint2D();
+    for (SeparatorQuick *separator : qAsConst(m_separators)) {
+        if (!separator->isVisible())
+            continue;
+
+        const QRectF r = mapRectFromItem(parentItem(), QRectF(separator->geometry()));
+        const auto left = float(r.left());
+        const auto top = float(r.top());
+        const auto right = float(r.right());
+        const auto bottom = float(r.bottom());
+        v[0].set(left, top);
+        v[1].set(right, top);
+        v[2].set(left, bottom);
+        v[3].set(right, top);
+        v[4].set(right, bottom);
+        v[5].set(left, bottom);
+        v += 6;
+    }
+    node->markDirty(QSGNode::DirtyGeometry);
+
+    auto material = static_cast<QSGFlatColorMaterial *>(node->material());
+    if (material->color() != m_color) {
+        material->setColor(m_color);
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+
+    return node;
+}
+
+void SeparatorRendererQuick::mousePressEvent(QMouseEvent *ev)
+{
+    SeparatorQuick *separator = separatorAt(ev->localPos());
+    if (!separator) {
+        // Not ours, let the frames below have it
+        ev->ignore();
+        return;
+    }
+
+    m_pressedSeparator = separator;
+    separator->anchor()->onMousePress();
+    ev->accept();
+}
+
+void SeparatorRendererQuick::mouseMoveEvent(QMouseEvent *ev)
+{
+    if (!m_pressedSeparator || !m_pressedSeparator->anchor())
+        return;
+
+    m_pressedSeparator->anchor()->onMouseMoved(toMultiSplitter(ev->localPos()));
+}
+
+void SeparatorRendererQuick::mouseReleaseEvent(QMouseEvent *)
+{
+    if (!m_pressedSeparator)
+        return;
+
+    if (Anchor *anchor = m_pressedSeparator->anchor())
+        anchor->onMouseReleased();
+    m_pressedSeparator.clear();
+}
+
+void SeparatorRendererQuick::hoverMoveEvent(QHoverEvent *ev)
+{
+    SeparatorQuick *separator = m_pressedSeparator ? m_pressedSeparator.data()
+                                                   : separatorAt(ev->posF());
+    if (separator) {
+        setCursor(QCursor(separator->isVertical() ? Qt::SizeHorCursor : Qt::SizeVerCursor));
+    } else {
+        unsetCursor();
+    }
+}
+
+void SeparatorRendererQuick::updateSize()
+{
+    setSize(parentItem()->size());
+}
+
+QPoint SeparatorRendererQuick::toMultiSplitter(QPointF pos) const
+{
+    return mapToItem(parentItem(), pos).toPoint();
+}
@@ -0,0 +1,85 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Paints all separators of a MultiSplitter with a single scene graph node.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+#ifndef KD_MULTISPLITTER_SEPARATORRENDERERQUICK_P_H
+#define KD_MULTISPLITTER_SEPARATORRENDERERQUICK_P_H
+
+#include <QQuickItem>
+#include <QColor>
+#include <QPointer>
+#include <QVector>
+
+namespace KDDockWidgets {
+
+class SeparatorQuick;
+
+/**
+ * @brief Renders every separator of a MultiSplitter through one QSGGeometryNode and does their hit-testing.
+ *
+ * The separators themselves are plain QQuickItems without contents, they only hold the geometry.
+ * This saves instantiating a QML component, with its bindings and MouseArea, per Anchor.
+ *
+ * The renderer is a child of the MultiSplitter, filling it and stacked above the frames.
+ * Mouse presses not on a separator are ignored, so they reach the items below.
+ */
+class SeparatorRendererQuick : public QQuickItem
+{
+    Q_OBJECT
+public:
+    ///@brief returns the renderer for the MultiSplitter @p multiSplitter, creating it if needed
+    static SeparatorRendererQuick *rendererFor(QQuickItem *multiSplitter);
+
+    void addSeparator(SeparatorQuick *);
+    void removeSeparator(SeparatorQuick *);
+
+    ///@brief returns the visible, draggable separator at @p pos, in our coordinates
+    SeparatorQuick *separatorAt(QPointF pos) const;
+
+    ///@brief the color the separators are painted with
+    void setColor(QColor);
+    QColor color() const { return m_color; }
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *, UpdatePaintNodeData *) override;
+    void mousePressEvent(QMouseEvent *) override;
+    void mouseMoveEvent(QMouseEvent *) override;
+    void mouseReleaseEvent(QMouseEvent *) override;
+    void hoverMoveEvent(QHoverEvent *) override;
+
+private:
+    explicit SeparatorRendererQuick(QQuickItem *multiSplitter);
+    void updateSize();
+    QPoint toMultiSplitter(QPointF pos) const;
+
+    QVector<SeparatorQuick *> m_separators;
+    QPointer<SeparatorQuick> m_pressedSeparator;
+    QColor m_color = Qt::lightGray;
+};
+
+}
+
+#endif
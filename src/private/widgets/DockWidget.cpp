@@ -42,7 +42,43 @@ public:
         layout->setContentsMargins(0, 0, 0, 0);
     }
 
+    ///@brief Puts @p guest in nativeHost, creating the host and its container the first time
+    void setNativeGuest(QWidget *guest, DockWidget *q)
+    {
+        if (!nativeHost) {
+            // A window, but owned by the dock widget. Only the dock widget is ever reparented.
+            nativeHost = new QWidget(q, Qt::Window | Qt::FramelessWindowHint);
+            nativeHost->setObjectName(QStringLiteral("_docks_NativeHost"));
+            auto hostLayout = new QVBoxLayout(nativeHost);
+            hostLayout->setSpacing(0);
+            hostLayout->setContentsMargins(0, 0, 0, 0);
+            nativeHost->winId(); // Forces the native window, the container embeds it
+            nativeContainer = QWidget::createWindowContainer(nativeHost->windowHandle(), q);
+            layout->addWidget(nativeContainer);
+        }
+
+        // The previous guest, if it wasn't deleted, goes back to the dock widget like a non-native one
+        QLayout *hostLayout = nativeHost->layout();
+        while (QLayoutItem *item = hostLayout->takeAt(0)) {
+            QWidget *previous = item->widget();
+            if (previous && previous != guest) {
+                previous->hide();
+                previous->setParent(q);
+            }
+            delete item;
+        }
+
+        hostLayout->addWidget(guest);
+        nativeContainer->setMinimumSize(guest->minimumSizeHint().expandedTo(guest->minimumSize()));
+        nativeHost->show(); // Shown inside the container, it never has a window of its own on screen
+    }
+
     QVBoxLayout *const layout;
+
+    // Only used with Option_PersistentNativeContainer. The host is never reparented, it's the
+    // guest's window during the dock widget's whole life.
+    QWidget *nativeHost = nullptr;
+    QWidget *nativeContainer = nullptr;
 };
 
 DockWidget::DockWidget(const QString &name, Options options)
@@ -50,12 +86,21 @@ DockWidget::DockWidget(const QString &name, Options options)
     , d(new Private(this))
 {
     connect(this, &DockWidgetBase::widgetChanged, this, [this] (QWidget *w) {
-        d->layout->addWidget(w);
+        if (!w)
+            return; // Hibernated, the guest deleted itself from the layout
+
+        if (options() & Option_PersistentNativeContainer)
+            d->setNativeGuest(w, this);
+        else
+            d->layout->addWidget(w);
     });
 }
 
 DockWidget::~DockWidget()
 {
+    // The container would delete the host's QWindow, which belongs to the host. Delete the host
+    // first, the container only tracks the window weakly.
+    delete d->nativeHost;
     delete d;
 }
 
@@ -23,6 +23,7 @@
 #include "Utils_p.h"
 #include "DropArea_p.h"
 #include "TitleBar_p.h"
+#include "DockRegistry_p.h"
 
 #include <QApplication>
 #include <QPainter>
@@ -54,8 +55,19 @@ void FloatingWindowWidget::paintEvent(QPaintEvent *)
 
 bool FloatingWindowWidget::event(QEvent *ev)
 {
-    if (ev->type() == QEvent::WindowStateChange)
+    switch (ev->type()) {
+    case QEvent::WindowStateChange:
+        DockRegistry::bumpLayoutGeneration();
         Q_EMIT windowStateChanged(static_cast<QWindowStateChangeEvent*>(ev));
+        break;
+    case QEvent::Move:
+    case QEvent::Resize:
+        // The geometry is saved by LayoutSaver
+        DockRegistry::bumpLayoutGeneration();
+        break;
+    default:
+        break;
+    }
 
     return FloatingWindow::event(ev);
 }
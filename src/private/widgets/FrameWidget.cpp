@@ -31,12 +31,13 @@
 
 #include <QVBoxLayout>
 #include <QPainter>
+#include <QPaintEvent>
 #include <QTableWidget>
 #include <QTabBar>
 
 using namespace KDDockWidgets;
 
-///@brieg a QVBoxLayout that emits layoutInvalidated so that Item can detect minSize changes
+///@brieg a QVBoxLayout that invalidates the Frame's min size so that Item can detect minSize changes
 class VBoxLayout : public QVBoxLayout
 {
 public:
@@ -48,7 +49,7 @@ public:
     void invalidate() override
     {
         QVBoxLayout::invalidate();
-        m_frameWidget->layoutInvalidated();
+        m_frameWidget->invalidateMinSize();
     }
 
     FrameWidget *const m_frameWidget;
@@ -62,13 +63,23 @@ FrameWidget::FrameWidget(QWidget *parent, FrameOptions options)
     auto vlayout = new VBoxLayout(this);
     vlayout->setContentsMargins(0, 0, 0, 0);
     vlayout->setSpacing(0);
-    vlayout->addWidget(titleBar());
     vlayout->addWidget(tabWidget()->asWidget());
 }
 
-void FrameWidget::paintEvent(QPaintEvent *)
+void FrameWidget::onTitleBarCreated(TitleBar *tb)
+{
+    // The title bar goes above the tab widget
+    static_cast<QVBoxLayout*>(layout())->insertWidget(0, tb);
+}
+
+void FrameWidget::paintEvent(QPaintEvent *ev)
 {
     if (!isFloating()) {
+        // Children repainting make us repaint their area too, but only the 1px border is ours
+        const QRect interior = rect().adjusted(2, 2, -2, -2);
+        if (interior.contains(ev->rect()))
+            return;
+
         QPainter p(this);
         QPen pen(QColor(184, 184, 184, 184));
         p.setPen(pen);
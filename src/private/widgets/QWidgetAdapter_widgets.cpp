@@ -32,6 +32,7 @@
 
 #include "QWidgetAdapter_widgets_p.h"
 #include "FloatingWindow_p.h"
+#include "DockRegistry_p.h"
 
 #include <QResizeEvent>
 #include <QMouseEvent>
@@ -57,8 +58,7 @@ FloatingWindow *QWidgetAdapter::floatingWindow() const
 
 void QWidgetAdapter::raiseAndActivate()
 {
-    window()->raise();
-    window()->activateWindow();
+    DockRegistry::self()->raiseAndActivateLater(window());
 }
 
 bool QWidgetAdapter::event(QEvent *e)
@@ -0,0 +1,210 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SeparatorOverlay_p.h"
+#include "multisplitter/Anchor_p.h"
+#include "Logging_p.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+
+using namespace KDDockWidgets;
+
+SeparatorOverlay *SeparatorOverlay::overlayFor(QWidget *multiSplitter)
+{
+    if (!multiSplitter)
+        return nullptr;
+
+    if (auto overlay = multiSplitter->findChild<SeparatorOverlay *>(QString(), Qt::FindDirectChildrenOnly))
+        return overlay;
+
+    return new SeparatorOverlay(multiSplitter);
+}
+
+SeparatorOverlay::SeparatorOverlay(QWidget *multiSplitter)
+    : QWidget(multiSplitter)
+{
+    setObjectName(QStringLiteral("SeparatorOverlay"));
+    setMouseTracking(true);
+    setGeometry(multiSplitter->rect());
+    multiSplitter->installEventFilter(this);
+
+    // Below the frames, so it only gets mouse events from the gaps between them, which is where separators are
+    lower();
+    show();
+}
+
+void SeparatorOverlay::addSeparator(OverlaidSeparatorWidget *separator)
+{
+    if (!m_separators.contains(separator)) {
+        m_separators.push_back(separator);
+        update(separator->geometry());
+    }
+}
+
+void SeparatorOverlay::removeSeparator(OverlaidSeparatorWidget *separator)
+{
+    if (m_separators.removeOne(separator))
+        update(separator->geometry());
+}
+
+OverlaidSeparatorWidget *SeparatorOverlay::separatorAt(QPoint pos) const
+{
+    for (OverlaidSeparatorWidget *separator : m_separators) {
+        Anchor *anchor = separator->anchor();
+        if (!anchor || !separator->isShown() || anchor->isStatic() || anchor->isFollowing())
+            continue;
+
+        if (separator->geometry().contains(pos))
+            return separator;
+    }
+
+    return nullptr;
+}
+
+bool SeparatorOverlay::eventFilter(QObject *o, QEvent *ev)
+{
+    if (o == parentWidget() && ev->type() == QEvent::Resize)
+        setGeometry(parentWidget()->rect());
+
+    return QWidget::eventFilter(o, ev);
+}
+
+void SeparatorOverlay::paintEvent(QPaintEvent *ev)
+{
+    QPainter p(this);
+    for (OverlaidSeparatorWidget *separator : qAsConst(m_separators)) {
+        if (!separator->anchor() || !separator->isShown())
+            continue;
+
+        const QRect r = separator->geometry();
+        if (ev->rect().intersects(r))
+            SeparatorWidget::paintSeparator(&p, separator, r, this);
+    }
+}
+
+void SeparatorOverlay::mousePressEvent(QMouseEvent *ev)
+{
+    m_pressedSeparator = separatorAt(ev->pos());
+    if (!m_pressedSeparator) {
+        ev->ignore();
+        return;
+    }
+
+    m_pressedSeparator->anchor()->onMousePress();
+}
+
+void SeparatorOverlay::mouseMoveEvent(QMouseEvent *ev)
+{
+    if (m_pressedSeparator && m_pressedSeparator->anchor()) {
+        m_pressedSeparator->anchor()->onMouseMoved(mapToParent(ev->pos()));
+    } else {
+        updateCursor(ev->pos());
+    }
+}
+
+void SeparatorOverlay::mouseReleaseEvent(QMouseEvent *ev)
+{
+    if (m_pressedSeparator && m_pressedSeparator->anchor())
+        m_pressedSeparator->anchor()->onMouseReleased();
+
+    m_pressedSeparator = nullptr;
+    updateCursor(ev->pos());
+}
+
+void SeparatorOverlay::leaveEvent(QEvent *)
+{
+    if (!m_pressedSeparator)
+        unsetCursor();
+}
+
+void SeparatorOverlay::updateCursor(QPoint pos)
+{
+    if (OverlaidSeparatorWidget *separator = separatorAt(pos)) {
+        setCursor(separator->isVertical() ? Qt::SizeHorCursor : Qt::SizeVerCursor);
+    } else {
+        unsetCursor();
+    }
+}
+
+OverlaidSeparatorWidget::OverlaidSeparatorWidget(Anchor *anchor, QWidgetAdapter *parent)
+    : SeparatorWidget(anchor, parent)
+{
+    // The native widget stays hidden, m_shown is what the layout sees
+    QWidget::setVisible(false);
+    setOverlay(SeparatorOverlay::overlayFor(parentWidget()));
+
+    connect(anchor, &Anchor::thicknessChanged, this, [this] {
+        updateOverlay(geometry());
+    });
+}
+
+OverlaidSeparatorWidget::~OverlaidSeparatorWidget()
+{
+    setOverlay(nullptr);
+}
+
+void OverlaidSeparatorWidget::setVisible(bool visible)
+{
+    if (visible == m_shown)
+        return;
+
+    m_shown = visible;
+    updateOverlay(geometry());
+}
+
+bool OverlaidSeparatorWidget::isShown() const
+{
+    return m_shown && parentWidget() && parentWidget()->isVisible();
+}
+
+void OverlaidSeparatorWidget::onGeometryChanged(QRect oldGeometry)
+{
+    updateOverlay(oldGeometry | geometry());
+}
+
+bool OverlaidSeparatorWidget::event(QEvent *ev)
+{
+    if (ev->type() == QEvent::ParentChange)
+        setOverlay(SeparatorOverlay::overlayFor(parentWidget()));
+
+    return SeparatorWidget::event(ev);
+}
+
+void OverlaidSeparatorWidget::setOverlay(SeparatorOverlay *overlay)
+{
+    if (overlay == m_overlay)
+        return;
+
+    if (m_overlay)
+        m_overlay->removeSeparator(this);
+
+    m_overlay = overlay;
+
+    if (m_overlay)
+        m_overlay->addSeparator(this);
+}
+
+void OverlaidSeparatorWidget::updateOverlay(QRect rect)
+{
+    if (m_overlay)
+        m_overlay->update(rect);
+}
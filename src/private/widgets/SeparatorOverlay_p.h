@@ -0,0 +1,96 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KD_MULTISPLITTER_SEPARATOROVERLAY_P_H
+#define KD_MULTISPLITTER_SEPARATOROVERLAY_P_H
+
+#include "SeparatorWidget_p.h"
+
+#include <QWidget>
+#include <QVector>
+#include <QPointer>
+
+namespace KDDockWidgets {
+
+class OverlaidSeparatorWidget;
+
+/**
+ * @brief A transparent child of the MultiSplitter which paints and hit-tests all its separators.
+ *
+ * Used when Config::Flag_SeparatorOverlay is set. The separators still
+ * exist as OverlaidSeparatorWidget, for their geometry, but their native widget is never shown.
+ * Moving a separator just repaints two thin strips of the overlay instead of moving a child widget.
+ */
+class DOCKS_EXPORT SeparatorOverlay : public QWidget
+{
+    Q_OBJECT
+public:
+    ///@brief Returns the overlay of @p multiSplitter, creating it if needed
+    static SeparatorOverlay *overlayFor(QWidget *multiSplitter);
+
+    void addSeparator(OverlaidSeparatorWidget *);
+    void removeSeparator(OverlaidSeparatorWidget *);
+
+    ///@brief Returns the shown, non-static, separator at @p pos, or nullptr
+    OverlaidSeparatorWidget *separatorAt(QPoint pos) const;
+
+protected:
+    bool eventFilter(QObject *, QEvent *) override;
+    void paintEvent(QPaintEvent *) override;
+    void mousePressEvent(QMouseEvent *) override;
+    void mouseMoveEvent(QMouseEvent *) override;
+    void mouseReleaseEvent(QMouseEvent *) override;
+    void leaveEvent(QEvent *) override;
+
+private:
+    explicit SeparatorOverlay(QWidget *multiSplitter);
+    void updateCursor(QPoint pos);
+    QVector<OverlaidSeparatorWidget *> m_separators;
+    QPointer<OverlaidSeparatorWidget> m_pressedSeparator;
+};
+
+/**
+ * @brief A Separator which isn't a visible widget. Its SeparatorOverlay does the painting and event handling.
+ */
+class DOCKS_EXPORT OverlaidSeparatorWidget : public SeparatorWidget
+{
+    Q_OBJECT
+public:
+    explicit OverlaidSeparatorWidget(Anchor *anchor, QWidgetAdapter *parent = nullptr);
+    ~OverlaidSeparatorWidget() override;
+
+    void setVisible(bool) override;
+    bool isShown() const override;
+
+protected:
+    void onGeometryChanged(QRect oldGeometry) override;
+    bool event(QEvent *) override;
+
+private:
+    friend class SeparatorOverlay;
+    void setOverlay(SeparatorOverlay *);
+    void updateOverlay(QRect rect);
+    QPointer<SeparatorOverlay> m_overlay;
+    bool m_shown = true;
+};
+
+}
+
+#endif
@@ -40,18 +40,22 @@ void SeparatorWidget::paintEvent(QPaintEvent *)
         return;
 
     QPainter p(this);
+    paintSeparator(&p, this, rect(), this);
+}
 
+void SeparatorWidget::paintSeparator(QPainter *p, const Separator *separator, QRect rect, const QWidget *widget)
+{
     QStyleOption opt;
-    opt.palette = palette();
-    opt.rect = rect();
+    opt.palette = widget->palette();
+    opt.rect = rect;
     opt.state = QStyle::State_None;
-    if (isVertical())
+    if (separator->isVertical())
         opt.state |= QStyle::State_Horizontal;
 
-    if (isEnabled())
+    if (separator->isEnabled())
         opt.state |= QStyle::State_Enabled;
 
-    parentWidget()->style()->drawControl(QStyle::CE_Splitter, &opt, &p, this);
+    separator->parentWidget()->style()->drawControl(QStyle::CE_Splitter, &opt, p, widget);
 }
 
 void SeparatorWidget::enterEvent(QEvent *)
@@ -25,6 +25,7 @@
 
 QT_BEGIN_NAMESPACE
 class QPaintEvent;
+class QPainter;
 QT_END_NAMESPACE
 
 namespace KDDockWidgets {
@@ -35,6 +36,9 @@ class DOCKS_EXPORT SeparatorWidget : public Separator
 public:
     explicit SeparatorWidget(Anchor *anchor, QWidgetAdapter *parent = nullptr);
 
+    ///@brief Paints @p separator into @p rect, with @p widget's style. Shared with SeparatorOverlay
+    static void paintSeparator(QPainter *, const Separator *separator, QRect rect, const QWidget *widget);
+
 protected:
     void paintEvent(QPaintEvent *) override;
     void enterEvent(QEvent *) override;
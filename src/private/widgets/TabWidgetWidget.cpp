@@ -30,6 +30,10 @@
 #include "Config.h"
 #include "FrameworkWidgetFactory.h"
 
+#include <QMenu>
+#include <QToolButton>
+#include <QStackedWidget>
+
 using namespace KDDockWidgets;
 
 TabWidgetWidget::TabWidgetWidget(Frame *parent)
@@ -37,9 +41,21 @@ TabWidgetWidget::TabWidgetWidget(Frame *parent)
     , TabWidget(this, parent)
     , m_tabBar(Config::self().frameworkWidgetFactory()->createTabBar(this))
 {
-    setTabBar(static_cast<QTabBar*>(m_tabBar->asWidget()));
+    auto tabBar = static_cast<QTabBar*>(m_tabBar->asWidget());
+    setTabBar(tabBar);
     setTabsClosable(Config::self().flags() & Config::Flag_TabsHaveCloseButton);
 
+    if (Config::self().flags() & Config::Flag_AllowReorderTabs) {
+        // QTabWidget moves the page out of the stack and back in, which shows a neighbour page, and hides
+        // and shows the moved one. Only replace it if we could disconnect it, moving twice would be worse.
+        if (disconnect(tabBar, SIGNAL(tabMoved(int,int)), this, SLOT(_q_tabMoved(int,int)))) {
+            connect(tabBar, &QTabBar::tabMoved, this, [this] (int from, int to) {
+                moveStackedWidget(from, to);
+                onTabMoved(from, to);
+            });
+        }
+    }
+
     // In case tabs closable is set by the factory, a tabClosedRequested() is emitted when the user presses [x]
     connect(this, &QTabWidget::tabCloseRequested, this, [this] (int index) {
         if (DockWidgetBase *dw = dockwidgetAt(index)) {
@@ -53,6 +69,79 @@ TabWidgetWidget::TabWidgetWidget(Frame *parent)
         }
     });
 
+    if (Config::self().flags() & Config::Flag_TabOverflowMenu) {
+        setUsesScrollButtons(true);
+        setElideMode(Qt::ElideRight);
+        // The button itself is only created once there's a second tab, see updateOverflowButton()
+    }
+}
+
+void TabWidgetWidget::setupOverflowMenu()
+{
+    m_overflowButton = new QToolButton(this);
+    m_overflowButton->setObjectName(QStringLiteral("_kddw_TabOverflowButton"));
+    m_overflowButton->setAutoRaise(true);
+    m_overflowButton->setArrowType(Qt::DownArrow);
+    m_overflowButton->setPopupMode(QToolButton::InstantPopup);
+
+    // Filled only when shown, so adding tabs doesn't pay for it
+    auto menu = new QMenu(m_overflowButton);
+    connect(menu, &QMenu::aboutToShow, this, [this, menu] {
+        populateOverflowMenu(menu);
+    });
+    m_overflowButton->setMenu(menu);
+
+    setCornerWidget(m_overflowButton, Qt::TopRightCorner);
+}
+
+void TabWidgetWidget::populateOverflowMenu(QMenu *menu)
+{
+    menu->clear();
+    const int current = QTabWidget::currentIndex();
+    for (int i = 0, num = count(); i < num; ++i) {
+        QAction *action = menu->addAction(tabIcon(i), tabText(i));
+        action->setCheckable(true);
+        action->setChecked(i == current);
+        connect(action, &QAction::triggered, this, [this, i] {
+            setCurrentIndex(i);
+        });
+    }
+}
+
+void TabWidgetWidget::updateOverflowButton()
+{
+    const bool needsButton = count() > 1;
+    if (needsButton && !m_overflowButton && (Config::self().flags() & Config::Flag_TabOverflowMenu))
+        setupOverflowMenu();
+
+    if (m_overflowButton)
+        m_overflowButton->setVisible(needsButton);
+}
+
+void TabWidgetWidget::moveStackedWidget(int from, int to)
+{
+    auto stack = findChild<QStackedWidget*>(QStringLiteral("qt_tabwidget_stackedwidget"), Qt::FindDirectChildrenOnly);
+    if (!stack || from == to)
+        return;
+
+    const QSignalBlocker blocker(stack);
+    QWidget *moved = stack->widget(from);
+    if (moved != stack->currentWidget()) {
+        // Hidden pages stay hidden when removed and inserted again
+        stack->removeWidget(moved);
+        stack->insertWidget(to, moved);
+        return;
+    }
+
+    // Taking the current page out would make the stack show another one.
+    // Instead move the pages in between, which are all hidden, to the other side of it, one by one.
+    for (int pos = from; pos != to;) {
+        const int neighbour = from < to ? pos + 1 : pos - 1;
+        QWidget *w = stack->widget(neighbour);
+        stack->removeWidget(w);
+        stack->insertWidget(pos, w);
+        pos = neighbour;
+    }
 }
 
 TabBar *TabWidgetWidget::tabBar() const
@@ -85,11 +174,13 @@ void TabWidgetWidget::paintEvent(QPaintEvent *p)
 
 void TabWidgetWidget::tabInserted(int)
 {
+    updateOverflowButton();
     onTabInserted();
 }
 
 void TabWidgetWidget::tabRemoved(int)
 {
+    updateOverflowButton();
     onTabRemoved();
 }
 
@@ -31,6 +31,11 @@
 #include "../TabWidget_p.h"
 #include <QTabWidget>
 
+QT_BEGIN_NAMESPACE
+class QMenu;
+class QToolButton;
+QT_END_NAMESPACE
+
 namespace KDDockWidgets {
 
 class Frame;
@@ -63,7 +68,15 @@ protected:
 
 private:
     Q_DISABLE_COPY(TabWidgetWidget)
+    void setupOverflowMenu();
+    void populateOverflowMenu(QMenu *);
+    void updateOverflowButton();
+
+    ///@brief Moves the dock widget in the stacked widget, without hiding or showing any. Replaces QTabWidget's own handling
+    void moveStackedWidget(int from, int to);
+
     TabBar *const m_tabBar;
+    QToolButton *m_overflowButton = nullptr; // Only with Config::Flag_TabOverflowMenu, once there's a second tab
 };
 }
 
@@ -25,6 +25,7 @@
 #include "Logging_p.h"
 #include "WindowBeingDragged_p.h"
 #include "Utils_p.h"
+#include "Stats_p.h"
 
 #include <QHBoxLayout>
 #include <QLabel>
@@ -73,19 +74,24 @@ void TitleBarWidget::init()
     updateFloatButton();
     updateMaximizeButton();
 
-    connect(this, &TitleBar::titleChanged, this, [this] {
-        update();
-    });
-
-    connect(this, &TitleBar::iconChanged, this, [this] {
-        if (icon().isNull()) {
-            m_dockWidgetIcon->setPixmap(QPixmap());
-        } else {
-            const QPixmap pix = icon().pixmap(QSize(28,28));
-            m_dockWidgetIcon->setPixmap(pix);
-        }
-        update();
-    });
+    // No need to connect to titleChanged(), the title is painted and TitleBar::setTitle() already
+    // schedules a repaint. update() coalesces bursts of title changes into a single paint.
+
+    connect(this, &TitleBar::iconChanged, this, &TitleBarWidget::updateIconPixmap);
+}
+
+void TitleBarWidget::updateIconPixmap()
+{
+    const QIcon icon = this->icon();
+    const qint64 cacheKey = icon.cacheKey();
+    const qreal dpr = devicePixelRatioF();
+    if (cacheKey == m_iconPixmapCacheKey && qFuzzyCompare(dpr, m_iconPixmapDpr))
+        return;
+
+    m_iconPixmapCacheKey = cacheKey;
+    m_iconPixmapDpr = dpr;
+    m_dockWidgetIcon->setPixmap(icon.isNull() ? QPixmap() : icon.pixmap(QSize(28, 28)));
+    update();
 }
 
 QRect TitleBarWidget::iconRect() const
@@ -127,14 +133,48 @@ QWidget *TitleBarWidget::closeButton() const
 
 void TitleBarWidget::paintEvent(QPaintEvent *)
 {
-    QPainter p(this);
-
     QStyleOptionDockWidget titleOpt;
     titleOpt.title = title();
     titleOpt.rect = iconRect().isEmpty() ? rect().adjusted(2, 0, -buttonAreaWidth(), 0)
                                          : rect().adjusted(iconRect().right(), 0, -buttonAreaWidth(), 0);
 
-    style()->drawControl(QStyle::CE_DockWidgetTitle, &titleOpt, &p, this);
+    const qreal dpr = devicePixelRatioF();
+    if (m_chromePixmap.isNull() || m_chromePixmap.size() != size() * dpr ||
+        !qFuzzyCompare(m_chromePixmap.devicePixelRatio(), dpr) ||
+        m_chromeTitle != titleOpt.title || m_chromeTitleRect != titleOpt.rect) {
+        KDDW_STATS_INCREMENT(titleBarChromeRenders);
+        m_chromeTitle = titleOpt.title;
+        m_chromeTitleRect = titleOpt.rect;
+        m_chromePixmap = QPixmap(size() * dpr);
+        m_chromePixmap.setDevicePixelRatio(dpr);
+        m_chromePixmap.fill(Qt::transparent);
+
+        // Same font and pen a painter on the widget would start with
+        QPainter pixmapPainter(&m_chromePixmap);
+        pixmapPainter.setFont(font());
+        pixmapPainter.setPen(palette().color(foregroundRole()));
+        style()->drawControl(QStyle::CE_DockWidgetTitle, &titleOpt, &pixmapPainter, this);
+    }
+
+    QPainter p(this);
+    p.drawPixmap(0, 0, m_chromePixmap);
+}
+
+void TitleBarWidget::changeEvent(QEvent *ev)
+{
+    switch (ev->type()) {
+    case QEvent::StyleChange:
+    case QEvent::PaletteChange:
+    case QEvent::FontChange:
+    case QEvent::EnabledChange:
+        m_chromePixmap = QPixmap();
+        update();
+        break;
+    default:
+        break;
+    }
+
+    TitleBar::changeEvent(ev);
 }
 
 void TitleBarWidget::updateFloatButton()
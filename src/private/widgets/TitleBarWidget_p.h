@@ -54,8 +54,13 @@ public:
 
     static QAbstractButton* createButton(QWidget *parent, const QIcon &icon);
 
+    ///@brief Renders the icon into the label, unless the same icon was rendered for the same device pixel ratio
+    ///Called by DockRegistry when the screen's devicePixelRatio changes
+    void updateIconPixmap();
+
 protected:
     void paintEvent(QPaintEvent *) override;
+    void changeEvent(QEvent *) override;
     void mouseDoubleClickEvent(QMouseEvent *) override;
     void updateFloatButton() override;
     void updateCloseButton() override;
@@ -78,6 +83,13 @@ private:
     QAbstractButton *m_floatButton = nullptr;
     QAbstractButton *m_maximizeButton = nullptr;
     QLabel *m_dockWidgetIcon = nullptr;
+    qint64 m_iconPixmapCacheKey = QIcon().cacheKey();
+    qreal m_iconPixmapDpr = 1.0;
+
+    // The background and title, as QStyle last drew them. Neighbours being resized repaint us a lot, usually unchanged
+    QPixmap m_chromePixmap;
+    QString m_chromeTitle;
+    QRect m_chromeTitleRect;
 };
 
 class Button : public QToolButton
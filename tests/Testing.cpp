@@ -26,6 +26,10 @@
 #include <QApplication>
 #include <QTest>
 #include <QLoggingCategory>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <functional>
 
 using namespace KDDockWidgets;
 using namespace KDDockWidgets::Testing;
@@ -92,19 +96,41 @@ static void fatalWarningsMessageHandler(QtMsgType t, const QMessageLogContext &c
     }
 }
 
-bool Testing::waitForEvent(QWidget *w, QEvent::Type type, int timeout)
+void Testing::processPendingEvents()
+{
+    QCoreApplication::processEvents();
+
+    // Not delivered by processEvents() when called from a nested event loop
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+
+// Processes events until the condition is true. Returns as soon as it is, instead of sleeping for a fixed
+// amount of time, so tests run as fast as the platform delivers events (for example with -platform offscreen)
+static bool processEventsUntil(const std::function<bool()> &condition, int timeout)
 {
-    EventFilter filter(type);
-    w->installEventFilter(&filter);
     QElapsedTimer time;
     time.start();
 
-    while (!filter.m_got && time.elapsed() < timeout) {
-        qApp->processEvents();
-        QTest::qWait(50);
+    // Wakes up the WaitForMoreEvents below if nothing else arrives
+    QTimer timeoutTimer;
+    timeoutTimer.setSingleShot(true);
+    timeoutTimer.start(timeout);
+
+    Testing::processPendingEvents();
+    while (!condition() && time.elapsed() < timeout) {
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
     }
 
-    return filter.m_got;
+    return condition();
+}
+
+bool Testing::waitForEvent(QWidget *w, QEvent::Type type, int timeout)
+{
+    EventFilter filter(type);
+    w->installEventFilter(&filter);
+
+    return processEventsUntil([&filter] { return filter.m_got; }, timeout);
 }
 
 bool Testing::waitForDeleted(QObject *o, int timeout)
@@ -113,16 +139,7 @@ bool Testing::waitForDeleted(QObject *o, int timeout)
         return true;
 
     QPointer<QObject> ptr = o;
-    QElapsedTimer time;
-    time.start();
-
-    while (ptr && time.elapsed() < timeout) {
-        qApp->processEvents();
-        QTest::qWait(50);
-    }
-
-    const bool wasDeleted = !ptr;
-    return wasDeleted;
+    return processEventsUntil([&ptr] { return ptr.isNull(); }, timeout);
 }
 
 bool Testing::waitForResize(QWidget *w, int timeout)
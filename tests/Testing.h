@@ -112,6 +112,9 @@ namespace Testing {
     void installFatalMessageHandler();
     void setExpectedWarning(const QString &);
 
+    ///@brief Delivers the events that are already pending, including deferred deletes. Doesn't wait for new ones
+    void processPendingEvents();
+
     bool waitForEvent(QWidget *w, QEvent::Type type, int timeout = 2000);
     bool waitForDeleted(QObject *o, int timeout = 2000);
     bool waitForResize(QWidget *w, int timeout = 2000);
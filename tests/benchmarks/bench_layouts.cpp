@@ -0,0 +1,327 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Benchmarks for the layout engine and LayoutSaver.
+ *
+ * Run with "-o results.xml,xml" (or "-csv") to get machine readable results.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates,qstring-allocations
+
+#include "DockWidgetBase.h"
+#include "MainWindow.h"
+#include "DockRegistry_p.h"
+#include "DragController_p.h"
+#include "FloatingWindow_p.h"
+#include "TitleBar_p.h"
+#include "Frame_p.h"
+#include "LayoutSaver.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/Item_p.h"
+#include "multisplitter/Anchor_p.h"
+#include "../utils.h"
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QStyleFactory>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Tests;
+
+// Big enough that none of the benchmarks run out of space
+static const QSize s_mainWindowSize(4000, 4000);
+
+static std::vector<DockWidgetBase*> createDockWidgets(int count)
+{
+    static int s_count = 0;
+    s_count++;
+
+    std::vector<DockWidgetBase*> docks;
+    docks.reserve(size_t(count));
+    for (int i = 0; i < count; ++i) {
+        const QString name = QStringLiteral("bench-%1-%2").arg(s_count).arg(i);
+        docks.push_back(createDockWidget(name, new QWidget(), {}, /*show=*/false));
+    }
+
+    return docks;
+}
+
+static void deleteDockWidgets(const std::vector<DockWidgetBase*> &docks)
+{
+    for (DockWidgetBase *dw : docks)
+        delete dw;
+}
+
+///@brief Returns a main window with @p numDocks dock widgets side by side
+static std::unique_ptr<MainWindow> createMainWindowWithDocks(int numDocks, std::vector<DockWidgetBase*> &docks)
+{
+    auto m = createMainWindow(s_mainWindowSize, MainWindowOption_None);
+    docks = createDockWidgets(numDocks);
+    for (DockWidgetBase *dw : docks)
+        m->addDockWidget(dw, Location_OnRight);
+
+    return m;
+}
+
+class BenchLayouts : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        qputenv("KDDOCKWIDGETS_SHOW_DEBUG_WINDOW", "");
+        qApp->setStyle(QStyleFactory::create(QStringLiteral("fusion")));
+    }
+
+    void bench_addDockWidget_data();
+    void bench_addDockWidget();
+    void bench_resizeMainWindow_data();
+    void bench_resizeMainWindow();
+    void bench_dragSeparator_data();
+    void bench_dragSeparator();
+    void bench_serializeLayout_data();
+    void bench_serializeLayout();
+    void bench_restoreLayout_data();
+    void bench_restoreLayout();
+    void bench_itemAt_data();
+    void bench_itemAt();
+    void bench_dragHover_data();
+    void bench_dragHover();
+};
+
+void BenchLayouts::bench_addDockWidget_data()
+{
+    QTest::addColumn<int>("location");
+    QTest::addColumn<int>("numDocks");
+
+    const QVector<Location> locations = { Location_OnLeft, Location_OnTop, Location_OnRight, Location_OnBottom };
+    for (Location loc : locations) {
+        for (int numDocks : { 4, 16, 32 }) {
+            const QByteArray name = QByteArray::number(loc) + "-" + QByteArray::number(numDocks);
+            QTest::newRow(name.constData()) << int(loc) << numDocks;
+        }
+    }
+}
+
+void BenchLayouts::bench_addDockWidget()
+{
+    QFETCH(int, location);
+    QFETCH(int, numDocks);
+
+    auto m = createMainWindow(s_mainWindowSize, MainWindowOption_None);
+    std::vector<DockWidgetBase*> docks;
+
+    QBENCHMARK {
+        docks = createDockWidgets(numDocks);
+        for (DockWidgetBase *dw : docks)
+            m->addDockWidget(dw, Location(location));
+
+        deleteDockWidgets(docks);
+    }
+
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+}
+
+void BenchLayouts::bench_resizeMainWindow_data()
+{
+    QTest::addColumn<int>("numDocks");
+    QTest::newRow("4") << 4;
+    QTest::newRow("16") << 16;
+    QTest::newRow("32") << 32;
+}
+
+void BenchLayouts::bench_resizeMainWindow()
+{
+    QFETCH(int, numDocks);
+
+    std::vector<DockWidgetBase*> docks;
+    auto m = createMainWindowWithDocks(numDocks, docks);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    const QSize size = layout->size();
+    const QSize biggerSize = size + QSize(500, 500);
+
+    // Resizes the layout directly, so we don't measure the window manager
+    QBENCHMARK {
+        layout->setSize(biggerSize);
+        layout->setSize(size);
+    }
+
+    QVERIFY(layout->checkSanity());
+    deleteDockWidgets(docks);
+}
+
+void BenchLayouts::bench_dragSeparator_data()
+{
+    bench_resizeMainWindow_data();
+}
+
+void BenchLayouts::bench_dragSeparator()
+{
+    QFETCH(int, numDocks);
+
+    std::vector<DockWidgetBase*> docks;
+    auto m = createMainWindowWithDocks(numDocks, docks);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+
+    // The separator on the right of the first dock, moving it right pushes all the others
+    Anchor *anchor = layout->itemForFrame(docks.front()->frame())->anchorGroup().right;
+    const int originalPos = anchor->position();
+    const int maxPos = originalPos + 100;
+
+    QBENCHMARK {
+        for (int pos = originalPos; pos <= maxPos; pos += 5)
+            anchor->setPosition(pos);
+        for (int pos = maxPos; pos >= originalPos; pos -= 5)
+            anchor->setPosition(pos);
+    }
+
+    QVERIFY(layout->checkSanity());
+    deleteDockWidgets(docks);
+}
+
+void BenchLayouts::bench_serializeLayout_data()
+{
+    QTest::addColumn<int>("numDocks");
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+///@brief Creates a layout with @p numDocks dock widgets, tabbed into at most 10 frames
+static std::unique_ptr<MainWindow> createTabbedLayout(int numDocks, std::vector<DockWidgetBase*> &docks)
+{
+    auto m = createMainWindow(s_mainWindowSize, MainWindowOption_None);
+    docks = createDockWidgets(numDocks);
+    const int numFrames = qMin(numDocks, 10);
+    for (int i = 0; i < numDocks; ++i) {
+        if (i < numFrames)
+            m->addDockWidget(docks.at(size_t(i)), Location_OnRight);
+        else
+            docks.at(size_t(i % numFrames))->addDockWidgetAsTab(docks.at(size_t(i)));
+    }
+
+    return m;
+}
+
+void BenchLayouts::bench_serializeLayout()
+{
+    QFETCH(int, numDocks);
+
+    std::vector<DockWidgetBase*> docks;
+    auto m = createTabbedLayout(numDocks, docks);
+    LayoutSaver saver;
+
+    QByteArray data;
+    QBENCHMARK {
+        data = saver.serializeLayout();
+    }
+
+    QVERIFY(!data.isEmpty());
+    deleteDockWidgets(docks);
+}
+
+void BenchLayouts::bench_restoreLayout_data()
+{
+    bench_serializeLayout_data();
+}
+
+void BenchLayouts::bench_restoreLayout()
+{
+    QFETCH(int, numDocks);
+
+    std::vector<DockWidgetBase*> docks;
+    auto m = createTabbedLayout(numDocks, docks);
+    LayoutSaver saver;
+    const QByteArray data = saver.serializeLayout();
+
+    QBENCHMARK {
+        QVERIFY(saver.restoreLayout(data));
+    }
+
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+    deleteDockWidgets(docks);
+}
+
+void BenchLayouts::bench_itemAt_data()
+{
+    bench_resizeMainWindow_data();
+}
+
+void BenchLayouts::bench_itemAt()
+{
+    QFETCH(int, numDocks);
+
+    std::vector<DockWidgetBase*> docks;
+    auto m = createMainWindowWithDocks(numDocks, docks);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    const QSize size = layout->size();
+
+    int numHits = 0;
+    QBENCHMARK {
+        numHits = 0;
+        for (int x = 0; x < size.width(); x += 20) {
+            for (int y = 0; y < size.height(); y += 20) {
+                if (layout->itemAt(QPoint(x, y)))
+                    numHits++;
+            }
+        }
+    }
+
+    QVERIFY(numHits > 0);
+    deleteDockWidgets(docks);
+}
+
+void BenchLayouts::bench_dragHover_data()
+{
+    bench_resizeMainWindow_data();
+}
+
+void BenchLayouts::bench_dragHover()
+{
+    QFETCH(int, numDocks);
+
+    std::vector<DockWidgetBase*> docks;
+    auto m = createMainWindowWithDocks(numDocks, docks);
+    auto floatingDock = createDockWidget(QStringLiteral("bench-floating"), new QWidget());
+    FloatingWindow *fw = floatingDock->floatingWindow();
+    QVERIFY(fw);
+
+    // Hovers diagonally over the whole main window, then releases outside of it, so it stays floating
+    QVector<QPoint> path;
+    const QRect geo = m->geometry();
+    for (int i = 0; i <= 100; ++i)
+        path.push_back(geo.topLeft() + QPoint(geo.width() * i / 100, geo.height() * i / 100));
+    path.push_back(geo.bottomRight() + QPoint(100, 100));
+
+    QBENCHMARK {
+        QVERIFY(!DragController::instance()->simulateDrag(fw->titleBar(), QPoint(10, 10), path));
+    }
+
+    QVERIFY(floatingDock->isFloating());
+    delete floatingDock->window();
+    deleteDockWidgets(docks);
+}
+
+QTEST_MAIN(BenchLayouts)
+#include "bench_layouts.moc"
@@ -0,0 +1,303 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Measures the time from process start to a fully painted MainWindow with a restored layout.
+ *
+ * Run without arguments: for each layout size it generates a layout file, then measures it in fresh
+ * processes, as what matters is a cold start. Prints the median of each phase, in milliseconds
+ * since main() was entered.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+// clazy:excludeall=qstring-allocations,range-loop,missing-qobject-macro
+
+#include "DockWidget.h"
+#include "MainWindow.h"
+#include "LayoutSaver.h"
+#include "DockRegistry_p.h"
+#include "FloatingWindow_p.h"
+#include "Frame_p.h"
+
+#include <QApplication>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QHash>
+#include <QProcess>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace KDDockWidgets;
+
+static const int s_runsPerLayout = 5;
+static const int s_layoutSizes[] = { 10, 50, 200 };
+static const char *const s_phaseNames[] = { "QApplication", "MainWindow", "DockWidgets", "restoreFromFile", "show", "first paint" };
+static const int s_numPhases = int(sizeof(s_phaseNames) / sizeof(s_phaseNames[0]));
+
+static QString dockName(int index)
+{
+    return QStringLiteral("dock-%1").arg(index);
+}
+
+static QVector<DockWidgetBase *> createDockWidgets(int numDocks)
+{
+    QVector<DockWidgetBase *> docks;
+    docks.reserve(numDocks);
+    for (int i = 0; i < numDocks; ++i) {
+        auto dw = new DockWidget(dockName(i));
+        dw->setWidget(new QWidget());
+        docks.push_back(dw);
+    }
+
+    return docks;
+}
+
+///@brief Lays out @p numDocks dock widgets in up to 8 frames, with every 10th one floating, and saves it
+static int generateLayout(int argc, char **argv, int numDocks, const QString &filename)
+{
+    QApplication app(argc, argv);
+    MainWindow m(QStringLiteral("bench-main"));
+    m.resize(1600, 1000);
+    m.show();
+
+    const QVector<DockWidgetBase *> docks = createDockWidgets(numDocks);
+    const Location locations[] = { Location_OnLeft, Location_OnRight, Location_OnBottom, Location_OnTop };
+    const int numFrames = qMin(numDocks, 8);
+    for (int i = 0; i < numDocks; ++i) {
+        DockWidgetBase *dw = docks.at(i);
+        if (i % 10 == 9) {
+            dw->show();
+        } else if (i < numFrames) {
+            m.addDockWidget(dw, locations[i % 4]);
+        } else {
+            docks.at(i % numFrames)->addDockWidgetAsTab(dw);
+        }
+    }
+
+    app.processEvents();
+
+    LayoutSaver saver;
+    if (!saver.saveToFile(filename)) {
+        qWarning() << "Failed to write" << filename;
+        return 1;
+    }
+
+    qDeleteAll(docks);
+    return 0;
+}
+
+///@brief Records when every watched Frame and FloatingWindow got its first paint event
+class PaintWatcher : public QObject
+{
+public:
+    explicit PaintWatcher(const QElapsedTimer &timer)
+        : m_timer(timer)
+    {
+        qApp->installEventFilter(this);
+    }
+
+    ///@brief Waits for @p o to be painted, unless it already was, for example while restoring
+    void watch(QObject *o)
+    {
+        auto it = m_paintedAt.constFind(o);
+        if (it == m_paintedAt.cend())
+            m_pending.insert(o);
+        else
+            m_lastPaintUSecs = qMax(m_lastPaintUSecs, it.value());
+    }
+
+    bool isDone() const
+    {
+        return m_pending.isEmpty();
+    }
+
+    qint64 lastPaintUSecs() const
+    {
+        return m_lastPaintUSecs;
+    }
+
+    bool eventFilter(QObject *o, QEvent *ev) override
+    {
+        if (ev->type() == QEvent::Paint && !m_paintedAt.contains(o)) {
+            const qint64 usecs = m_timer.nsecsElapsed() / 1000;
+            m_paintedAt.insert(o, usecs);
+            if (!m_pending.remove(o))
+                return false;
+
+            m_lastPaintUSecs = qMax(m_lastPaintUSecs, usecs);
+            if (m_pending.isEmpty())
+                QTimer::singleShot(0, qApp, &QCoreApplication::quit); // Let this paint finish first
+        }
+
+        return false;
+    }
+
+private:
+    const QElapsedTimer &m_timer;
+    QSet<QObject *> m_pending;
+    QHash<QObject *, qint64> m_paintedAt;
+    qint64 m_lastPaintUSecs = 0;
+};
+
+///@brief Does what an application does at startup, and prints the elapsed time of each phase to stdout
+static int measureStartup(int argc, char **argv, int numDocks, const QString &filename, const QElapsedTimer &timer)
+{
+    QVector<qint64> phases;
+    QApplication app(argc, argv);
+    phases.push_back(timer.nsecsElapsed() / 1000);
+
+    MainWindow m(QStringLiteral("bench-main"));
+    m.resize(1600, 1000);
+    phases.push_back(timer.nsecsElapsed() / 1000);
+
+    const QVector<DockWidgetBase *> docks = createDockWidgets(numDocks);
+    phases.push_back(timer.nsecsElapsed() / 1000);
+
+    PaintWatcher watcher(timer);
+    LayoutSaver saver;
+    if (!saver.restoreFromFile(filename)) {
+        qWarning() << "Failed to restore" << filename;
+        return 1;
+    }
+    phases.push_back(timer.nsecsElapsed() / 1000);
+
+    m.show();
+    phases.push_back(timer.nsecsElapsed() / 1000);
+
+    for (Frame *frame : DockRegistry::self()->frames()) {
+        if (frame->isVisible())
+            watcher.watch(frame);
+    }
+
+    for (FloatingWindow *fw : DockRegistry::self()->nestedwindows()) {
+        if (fw->isVisible())
+            watcher.watch(fw);
+    }
+
+    // In case a window manager never exposes something, don't hang forever
+    QTimer::singleShot(30000, &app, &QCoreApplication::quit);
+    if (!watcher.isDone())
+        app.exec();
+
+    if (!watcher.isDone()) {
+        qWarning() << "Not everything was painted";
+        return 1;
+    }
+
+    phases.push_back(watcher.lastPaintUSecs());
+
+    QStringList fields;
+    for (qint64 usecs : qAsConst(phases))
+        fields << QString::number(usecs);
+    std::printf("%s\n", qPrintable(fields.join(QLatin1Char(','))));
+
+    qDeleteAll(docks);
+    return 0;
+}
+
+///@brief Runs this executable with @p arguments and returns what it printed, or an empty string on failure
+static QString runChild(const QStringList &arguments)
+{
+    QProcess process;
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.start(QCoreApplication::applicationFilePath(), arguments);
+    if (!process.waitForFinished(60000) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+        return QString();
+
+    return QString::fromLocal8Bit(process.readAllStandardOutput()).trimmed();
+}
+
+static int runBenchmark(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        qWarning() << "Failed to create a temporary directory";
+        return 1;
+    }
+
+    std::printf("%-10s", "numDocks");
+    for (const char *name : s_phaseNames)
+        std::printf("%18s", name);
+    std::printf("\n");
+
+    for (int numDocks : s_layoutSizes) {
+        const QString filename = QDir(dir.path()).filePath(QStringLiteral("layout-%1.json").arg(numDocks));
+        const QString docksArg = QString::number(numDocks);
+        if (runChild({ QStringLiteral("--generate"), docksArg, filename }).isNull()) {
+            qWarning() << "Failed to generate the layout with" << numDocks << "dock widgets";
+            return 1;
+        }
+
+        QVector<QVector<qint64>> samples(s_numPhases);
+        for (int run = 0; run < s_runsPerLayout; ++run) {
+            const QStringList fields = runChild({ QStringLiteral("--measure"), docksArg, filename }).split(QLatin1Char(','));
+            if (fields.size() != s_numPhases) {
+                qWarning() << "Measuring the layout with" << numDocks << "dock widgets failed";
+                return 1;
+            }
+
+            for (int i = 0; i < s_numPhases; ++i)
+                samples[i].push_back(fields.at(i).toLongLong());
+        }
+
+        std::printf("%-10d", numDocks);
+        for (QVector<qint64> &phaseSamples : samples) {
+            std::sort(phaseSamples.begin(), phaseSamples.end());
+            std::printf("%18.2f", double(phaseSamples.at(phaseSamples.size() / 2)) / 1000.0);
+        }
+        std::printf("\n");
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    // Started before anything else, so QApplication's construction is included too
+    QElapsedTimer timer;
+    timer.start();
+
+    if (argc == 4) {
+        const QByteArray mode = argv[1];
+        const int numDocks = QByteArray(argv[2]).toInt();
+        const QString filename = QString::fromLocal8Bit(argv[3]);
+        if (mode == "--generate")
+            return generateLayout(argc, argv, numDocks, filename);
+        if (mode == "--measure")
+            return measureStartup(argc, argv, numDocks, filename, timer);
+    }
+
+    if (argc != 1) {
+        std::fprintf(stderr, "Usage: %s [--generate|--measure <numDocks> <layout file>]\n", argv[0]);
+        return 1;
+    }
+
+    return runBenchmark(argc, argv);
+}
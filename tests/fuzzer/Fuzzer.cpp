@@ -25,18 +25,45 @@
 #include "DockRegistry_p.h"
 #include "DockWidget.h"
 #include "MainWindow.h"
+#include "Frame_p.h"
+#include "multisplitter/Separator_p.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
 
 #include <QJsonDocument>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QApplication>
+#include <QFileInfo>
+#include <QDir>
 
 #include <QString>
 #include <QTest>
 
+#include <algorithm>
+
 using namespace KDDockWidgets;
 using namespace KDDockWidgets::Testing;
 using namespace KDDockWidgets::Testing::Operations;
 
 #define OPERATIONS_PER_TEST 200
 
+// The performance oracle needs this many samples of an operation type before judging it
+#define COST_MODEL_WARMUP_SAMPLES 10
+
+// An operation is an outlier if its cost per item is this many times the mean of its type...
+#define COST_MODEL_OUTLIER_FACTOR 10
+
+// ... and if it took at least this long, so we ignore noise in fast operations
+#define COST_MODEL_MIN_OUTLIER_USECS 20000
+
+static int numVisibleItems()
+{
+    int count = 0;
+    for (MultiSplitterLayout *layout : DockRegistry::self()->layouts())
+        count += layout->visibleCount();
+    return count;
+}
+
 static MainWindow* createMainWindow(const Fuzzer::MainWindowDescriptor &mwd)
 {
     auto mainWindow = new MainWindow(mwd.name, mwd.mainWindowOption);
@@ -76,7 +103,9 @@ static void createLayout(const Fuzzer::Layout &layout)
 void Fuzzer::runTest(const Test &test)
 {
     m_lastSavedLayout.clear();
+    m_operationStats.clear();
     m_currentTest = test;
+    m_currentOperationIndex = -1;
 
     if (!DockRegistry::self()->isEmpty())
         qFatal("There's dock widgets and the start runTest");
@@ -90,15 +119,22 @@ void Fuzzer::runTest(const Test &test)
     if (skipsLast)
         operations.removeLast();
 
+    if (isBenchmarking())
+        qApp->installEventFilter(this);
+
     for (const auto &op : operations) {
+        m_currentOperationIndex = index;
         index++;
-        op->execute();
-        if (op->hasParams())
-            qDebug() << "Ran" << op->description();
-        QTest::qWait(m_operationDelayMS);
+        m_numOperationsRun++;
+        runOperation(op);
         DockRegistry::self()->checkSanityAll();
     }
 
+    if (isBenchmarking()) {
+        qApp->removeEventFilter(this);
+        printBenchmarkResults();
+    }
+
     if (skipsLast)
         qDebug() << "Skipped" << last->toString() << "\n";
 
@@ -118,6 +154,130 @@ void Fuzzer::runTest(const Test &test)
     }
 }
 
+void Fuzzer::runOperation(const OperationBase::Ptr &op)
+{
+    const bool usesOracle = m_options & Option_PerformanceOracle;
+    const int numItems = usesOracle ? numVisibleItems() : 0;
+
+    if (!isBenchmarking()) {
+        QElapsedTimer timer;
+        timer.start();
+        op->execute();
+        const qint64 usecs = timer.nsecsElapsed() / 1000;
+        if (op->hasParams())
+            qDebug() << "Ran" << op->description();
+        if (usesOracle)
+            checkOperationCost(op, usecs, numItems);
+        QTest::qWait(m_operationDelayMS);
+        return;
+    }
+
+    m_separatorGeometryChanges = 0;
+    m_frameGeometryChanges = 0;
+    const quint64 allocationsBefore = allocationCount();
+    QElapsedTimer timer;
+    timer.start();
+
+    // The event processing is measured too, as that's where deferred layouting and deletion happen
+    op->execute();
+    QTest::qWait(m_operationDelayMS);
+
+    OperationStats stats;
+    stats.nsecs = timer.nsecsElapsed();
+    stats.allocations = allocationCount() - allocationsBefore;
+    stats.separatorGeometryChanges = m_separatorGeometryChanges;
+    stats.frameGeometryChanges = m_frameGeometryChanges;
+    stats.description = op->hasParams() ? op->description() : op->toString();
+    m_operationStats.push_back(stats);
+
+    if (m_slowOperationThresholdMS > 0 && stats.nsecs > qint64(m_slowOperationThresholdMS) * 1000000) {
+        qDebug() << "Slow operation:" << stats.description;
+        m_foundSlowOperation = true;
+    }
+
+    if (usesOracle)
+        checkOperationCost(op, stats.nsecs / 1000, numItems);
+}
+
+void Fuzzer::checkOperationCost(const OperationBase::Ptr &op, qint64 usecs, int numItems)
+{
+    // The model: an operation's cost should grow linearly with the number of visible items.
+    // Anything much worse than the average of its type hints at a combinatorial blowup.
+    CostModel &model = m_costModels[op->type()];
+    const double usecsPerItem = double(usecs) / qMax(1, numItems);
+
+    const bool isOutlier = model.numSamples >= COST_MODEL_WARMUP_SAMPLES
+            && usecs >= COST_MODEL_MIN_OUTLIER_USECS
+            && usecsPerItem > COST_MODEL_OUTLIER_FACTOR * model.meanUSecsPerItem;
+
+    if (!isOutlier) {
+        // Outliers are left out, so they don't make later ones look normal
+        model.numSamples++;
+        model.meanUSecsPerItem += (usecsPerItem - model.meanUSecsPerItem) / model.numSamples;
+        return;
+    }
+
+    // Save the test up to the slow operation, for replaying with --fail-slower-than
+    m_numSlowTestsSaved++;
+    const QFileInfo dumpInfo(m_dumpJsonFileName);
+    const QString filename = dumpInfo.absoluteDir().filePath(QStringLiteral("%1_slow_%2.json")
+                                                             .arg(dumpInfo.completeBaseName())
+                                                             .arg(m_numSlowTestsSaved));
+    Test test = m_currentTest;
+    test.operations = test.operations.mid(0, m_currentOperationIndex + 1);
+    test.dumpToJsonFile(filename);
+
+    qDebug().noquote() << "Operation took" << usecs << "us for" << numItems << "items, expected about"
+                       << qRound(model.meanUSecsPerItem * qMax(1, numItems)) << "us:"
+                       << (op->hasParams() ? op->description() : op->toString())
+                       << "\n    Saved to" << filename;
+}
+
+void Fuzzer::printBenchmarkResults() const
+{
+    QTextStream out(stdout);
+
+    auto printStats = [&out] (const OperationStats &stats) {
+        out << QString::number(double(stats.nsecs) / 1000000.0, 'f', 3).rightJustified(12) << " ms"
+            << QString::number(stats.allocations).rightJustified(10) << " allocs"
+            << QString::number(stats.separatorGeometryChanges).rightJustified(8) << " separator"
+            << QString::number(stats.frameGeometryChanges).rightJustified(8) << " frame"
+            << "    " << stats.description << "\n";
+    };
+
+    qint64 totalNsecs = 0;
+    out << "\nPer operation:\n";
+    for (const OperationStats &stats : m_operationStats) {
+        printStats(stats);
+        totalNsecs += stats.nsecs;
+    }
+
+    QVector<OperationStats> slowest = m_operationStats;
+    std::sort(slowest.begin(), slowest.end(), [] (const OperationStats &s1, const OperationStats &s2) {
+        return s1.nsecs > s2.nsecs;
+    });
+    slowest.resize(qMin(slowest.size(), 10));
+
+    out << "\nSlowest operations:\n";
+    for (const OperationStats &stats : qAsConst(slowest))
+        printStats(stats);
+
+    out << "\n" << m_operationStats.size() << " operations took "
+        << QString::number(double(totalNsecs) / 1000000.0, 'f', 3) << " ms\n";
+}
+
+bool Fuzzer::eventFilter(QObject *o, QEvent *ev)
+{
+    if (ev->type() == QEvent::Move || ev->type() == QEvent::Resize) {
+        if (qobject_cast<Separator*>(o))
+            m_separatorGeometryChanges++;
+        else if (qobject_cast<Frame*>(o))
+            m_frameGeometryChanges++;
+    }
+
+    return false;
+}
+
 Fuzzer::Fuzzer(bool dumpJsonOnFailure, Options options, QObject *parent)
     : QObject(parent)
     , m_randomEngine(m_randomDevice())
@@ -189,6 +349,12 @@ bool Fuzzer::getRandomBool(int truePercentage)
     return distrib(m_randomEngine) < truePercentage;
 }
 
+int Fuzzer::getRandomInt(int min, int max)
+{
+    std::uniform_int_distribution<> distrib(min, max);
+    return distrib(m_randomEngine);
+}
+
 Testing::AddDockWidgetParams Fuzzer::getRandomAddDockWidgetParams()
 {
     AddDockWidgetParams params;
@@ -358,7 +524,7 @@ void Fuzzer::onFatal()
 {
     if (m_dumpJsonOnFailure) {
         // Tests failed! Let's dump
-        m_currentTest.dumpToJsonFile("fuzzer_dump.json");
+        m_currentTest.dumpToJsonFile(m_dumpJsonFileName);
     }
 
     if (!m_currentJsonFile.isEmpty()) {
@@ -371,6 +537,36 @@ void Fuzzer::setDelayBetweenOperations(int delay)
     m_operationDelayMS = delay;
 }
 
+void Fuzzer::setSeed(quint32 seed)
+{
+    m_randomEngine.seed(seed);
+}
+
+void Fuzzer::setDumpJsonFileName(const QString &filename)
+{
+    m_dumpJsonFileName = filename;
+}
+
+int Fuzzer::numOperationsRun() const
+{
+    return m_numOperationsRun;
+}
+
+void Fuzzer::setSlowOperationThreshold(int ms)
+{
+    m_slowOperationThresholdMS = ms;
+}
+
+bool Fuzzer::foundSlowOperation() const
+{
+    return m_foundSlowOperation;
+}
+
+bool Fuzzer::isBenchmarking() const
+{
+    return m_options & Option_Benchmark;
+}
+
 QByteArray Fuzzer::lastSavedLayout() const
 {
     return m_lastSavedLayout;
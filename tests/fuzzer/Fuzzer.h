@@ -30,6 +30,7 @@
 
 #include <QJsonDocument>
 #include <QVector>
+#include <QHash>
 
 #include <random>
 
@@ -73,10 +74,27 @@ public:
     enum Option {
         Option_None = 0,
         Option_NoQuit = 1, ///< Don't quit when the tests finish. So we can debug in gammaray
-        Option_SkipLast = 2 ///< Don't execute the last test. Useful when the last one is the failing one and we want to inspect the state prior to crash
+        Option_SkipLast = 2, ///< Don't execute the last test. Useful when the last one is the failing one and we want to inspect the state prior to crash
+        Option_Benchmark = 4, ///< Replays without delays and reports how long each operation took
+        Option_PerformanceOracle = 8 ///< Saves tests with operations much slower than expected for the layout size
     };
     Q_DECLARE_FLAGS(Options, Option)
 
+    ///@brief What was measured while running a single operation, in benchmark mode
+    struct OperationStats {
+        QString description;
+        qint64 nsecs = 0;
+        quint64 allocations = 0;
+        int separatorGeometryChanges = 0; // Each Anchor::setPosition() moves its separator
+        int frameGeometryChanges = 0; // Each Item::setGeometry() resizes or moves its frame
+    };
+
+    ///@brief The expected cost of an operation type, per visible item, as learned while the tests run
+    struct CostModel {
+        int numSamples = 0;
+        double meanUSecsPerItem = 0;
+    };
+
     struct FuzzerConfig
     {
         int numTests;
@@ -242,6 +260,9 @@ public:
 
     bool getRandomBool(int truePercentage = 50);
 
+    ///@brief Returns a random number between @p min and @p max, inclusive
+    int getRandomInt(int min, int max);
+
     Testing::AddDockWidgetParams getRandomAddDockWidgetParams();
 
     KDDockWidgets::MainWindowBase* getRandomMainWindow();
@@ -267,20 +288,56 @@ public:
     void onFatal() override;
     void setDelayBetweenOperations(int delay);
 
+    ///@brief Seeds the random engine, so a run can be reproduced. By default a random seed is used
+    void setSeed(quint32 seed);
+
+    ///@brief Sets the file the current test is dumped to when a test fails. Defaults to "fuzzer_dump.json"
+    void setDumpJsonFileName(const QString &filename);
+
+    ///@brief Returns the number of operations executed so far, by all tests
+    int numOperationsRun() const;
+
+    ///@brief In benchmark mode, operations taking longer than @p ms are reported as slow. 0 disables it
+    void setSlowOperationThreshold(int ms);
+
+    ///@brief Returns whether any operation took longer than the slow operation threshold
+    bool foundSlowOperation() const;
+
     QByteArray lastSavedLayout() const;
     void setLastSavedLayout(const QByteArray &serialized);
 
+    bool isBenchmarking() const;
+
+protected:
+    bool eventFilter(QObject *, QEvent *) override;
+
 private:
+    void runOperation(const Operations::OperationBase::Ptr &);
+    void checkOperationCost(const Operations::OperationBase::Ptr &, qint64 usecs, int numItems);
+    void printBenchmarkResults() const;
     std::random_device m_randomDevice;
     std::mt19937 m_randomEngine;
     Fuzzer::Test m_currentTest;
     QString m_currentJsonFile;
+    QString m_dumpJsonFileName = QStringLiteral("fuzzer_dump.json");
     const bool m_dumpJsonOnFailure;
+    int m_numOperationsRun = 0;
+    int m_slowOperationThresholdMS = 0;
+    bool m_foundSlowOperation = false;
+    QHash<int, CostModel> m_costModels; // Keyed by OperationType
+    int m_currentOperationIndex = -1;
+    int m_numSlowTestsSaved = 0;
     int m_operationDelayMS = 50;
     const Options m_options;
     QByteArray m_lastSavedLayout;
+    QVector<OperationStats> m_operationStats;
+    int m_separatorGeometryChanges = 0;
+    int m_frameGeometryChanges = 0;
 };
 
+///@brief Number of calls to operator new so far. Implemented in main.cpp
+quint64 allocationCount();
+
 }
 }
 
@@ -0,0 +1,179 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// We don't care about performance related checks in the tests
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates,qstring-allocations
+
+#include "Minimizer.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QFile>
+#include <QDebug>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Testing;
+
+static QVariantList sliceOperations(const QVariantList &operations, int from, int to)
+{
+    return operations.mid(from, to - from);
+}
+
+Minimizer::Minimizer(Mode mode, int slowThresholdMS)
+    : m_mode(mode)
+    , m_slowThresholdMS(slowThresholdMS)
+{
+}
+
+bool Minimizer::minimize(const QString &jsonFile, const QString &outputFile)
+{
+    QFile file(jsonFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open file" << jsonFile;
+        return false;
+    }
+
+    const QVariantMap map = QJsonDocument::fromJson(file.readAll()).toVariant().toMap();
+    m_initialLayout = map.value(QStringLiteral("initialLayout")).toMap();
+    const QVariantList operations = map.value(QStringLiteral("operations")).toList();
+
+    const Outcome original = run(operations);
+    if (!original.reproduces) {
+        qDebug() << Q_FUNC_INFO << "Test doesn't fail, nothing to minimize" << jsonFile;
+        return false;
+    }
+
+    m_signature = original.signature;
+    qDebug() << "Minimizing" << operations.size() << "operations. Failure:" << m_signature;
+
+    const QVariantList minimized = minimizeOperations(operations);
+    qDebug() << "Minimized to" << minimized.size() << "operations, after" << m_numRuns << "runs";
+
+    return writeTest(outputFile, minimized);
+}
+
+QVariantList Minimizer::minimizeOperations(QVariantList operations)
+{
+    // The ddmin algorithm. Tries ever smaller chunks, and their complements, until no single operation can be removed.
+    int numChunks = 2;
+    while (operations.size() >= 2) {
+        const int size = operations.size();
+        const int chunkSize = (size + numChunks - 1) / numChunks;
+        bool reduced = false;
+
+        for (int start = 0; start < size && !reduced; start += chunkSize) {
+            const QVariantList chunk = sliceOperations(operations, start, qMin(start + chunkSize, size));
+            if (reproduces(chunk)) {
+                operations = chunk;
+                numChunks = 2;
+                reduced = true;
+            }
+        }
+
+        for (int start = 0; start < size && !reduced; start += chunkSize) {
+            const QVariantList complement = sliceOperations(operations, 0, start)
+                    + sliceOperations(operations, qMin(start + chunkSize, size), size);
+            if (reproduces(complement)) {
+                operations = complement;
+                numChunks = qMax(numChunks - 1, 2);
+                reduced = true;
+            }
+        }
+
+        if (!reduced) {
+            if (numChunks >= size)
+                break;
+
+            numChunks = qMin(numChunks * 2, size);
+        }
+    }
+
+    return operations;
+}
+
+bool Minimizer::reproduces(const QVariantList &operations)
+{
+    const Outcome outcome = run(operations);
+    return outcome.reproduces && (m_mode == Mode_Slow || outcome.signature == m_signature);
+}
+
+Minimizer::Outcome Minimizer::run(const QVariantList &operations)
+{
+    m_numRuns++;
+    const QString filename = m_tempDir.filePath(QStringLiteral("candidate.json"));
+    if (!writeTest(filename, operations))
+        return {};
+
+    QStringList args = { filename };
+    if (m_mode == Mode_Slow)
+        args << QStringLiteral("--fail-slower-than") << QString::number(m_slowThresholdMS);
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("QT_QPA_PLATFORM"), QStringLiteral("offscreen"));
+    env.insert(QStringLiteral("QT_MESSAGE_PATTERN"), QStringLiteral("%{type}: %{message}"));
+
+    QProcess process;
+    process.setProcessEnvironment(env);
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(QCoreApplication::applicationFilePath(), args);
+    process.waitForFinished(-1);
+
+    Outcome outcome;
+    if (m_mode == Mode_Slow) {
+        outcome.reproduces = process.exitStatus() == QProcess::NormalExit && process.exitCode() == SlowOperationExitCode;
+        return outcome;
+    }
+
+    outcome.reproduces = process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0;
+    if (outcome.reproduces) {
+        // The fatal message handler aborts on the first warning, so it's the one that matters
+        const QList<QByteArray> lines = process.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith("warning: ")) {
+                outcome.signature = QString::fromUtf8(line.mid(9));
+                break;
+            }
+        }
+
+        // Pointers change between runs
+        static const QRegularExpression pointerRegExp(QStringLiteral("0x[0-9a-fA-F]+"));
+        outcome.signature.replace(pointerRegExp, QStringLiteral("0x"));
+    }
+
+    return outcome;
+}
+
+bool Minimizer::writeTest(const QString &filename, const QVariantList &operations) const
+{
+    QVariantMap map;
+    map[QStringLiteral("initialLayout")] = m_initialLayout;
+    map[QStringLiteral("operations")] = operations;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open file" << filename;
+        return false;
+    }
+
+    file.write(QJsonDocument::fromVariant(map).toJson());
+    return true;
+}
@@ -0,0 +1,80 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2019-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// We don't care about performance related checks in the tests
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates,qstring-allocations
+
+#ifndef KDDOCKWIDGETS_FUZZER_MINIMIZER_H
+#define KDDOCKWIDGETS_FUZZER_MINIMIZER_H
+
+#include <QString>
+#include <QVariantMap>
+#include <QTemporaryDir>
+
+namespace KDDockWidgets {
+namespace Testing {
+
+/**
+ * @brief Shrinks a failing fuzzer test to a small sequence of operations that still fails.
+ *
+ * Uses delta debugging: subsets of the recorded operations are replayed, each in a new fuzzer process,
+ * since failures abort. A subset is kept if it fails the same way as the original test, that is, with
+ * the same warning. In Mode_Slow a subset is kept if any of its operations is still slower than the threshold.
+ */
+class Minimizer
+{
+public:
+    enum Mode {
+        Mode_Failure = 0, ///< Minimizes a test which crashes or warns
+        Mode_Slow ///< Minimizes a test which has an operation slower than a threshold
+    };
+
+    ///@brief The exit code of a fuzzer run with --fail-slower-than, when an operation was too slow
+    static const int SlowOperationExitCode = 2;
+
+    explicit Minimizer(Mode mode, int slowThresholdMS = 0);
+
+    ///@brief Minimizes the test in @p jsonFile and writes the result to @p outputFile
+    ///Returns false if the test doesn't fail to begin with
+    bool minimize(const QString &jsonFile, const QString &outputFile);
+
+private:
+    struct Outcome {
+        bool reproduces = false;
+        QString signature; // The warning which made it fail, if any
+    };
+
+    Outcome run(const QVariantList &operations);
+    bool reproduces(const QVariantList &operations);
+    QVariantList minimizeOperations(QVariantList operations);
+    bool writeTest(const QString &filename, const QVariantList &operations) const;
+
+    const Mode m_mode;
+    const int m_slowThresholdMS;
+    QVariantMap m_initialLayout;
+    QString m_signature;
+    QTemporaryDir m_tempDir;
+    int m_numRuns = 0;
+};
+
+}
+}
+
+#endif
@@ -24,20 +24,66 @@
 #include "Operations.h"
 #include "DockWidgetBase.h"
 #include "DockRegistry_p.h"
+#include "DragController_p.h"
+#include "DropAreaWithCentralFrame_p.h"
+#include "FloatingWindow_p.h"
+#include "Frame_p.h"
+#include "TabWidget_p.h"
+#include "TitleBar_p.h"
+#include "multisplitter/Anchor_p.h"
+#include "multisplitter/AnchorGroup_p.h"
+#include "multisplitter/Item_p.h"
 #include "Fuzzer.h"
 #include "../Testing.h"
 
 #include <QTest>
+#include <QTabBar>
+#include <QApplication>
+#include <QMouseEvent>
+#include <QPointer>
 
 using namespace KDDockWidgets;
 using namespace KDDockWidgets::Testing;
 using namespace KDDockWidgets::Testing::Operations;
 
+// The number of mouse moves of each simulated drag
+#define DRAG_STEPS 20
+
 static QString operationTypeStr(OperationType ot)
 {
     return QMetaEnum::fromType<OperationType>().valueToKey(ot);
 }
 
+///@brief Returns the positions a mouse drag from @p from to @p to goes through, excluding @p from
+static QVector<QPoint> dragPath(QPoint from, QPoint to)
+{
+    QVector<QPoint> path;
+    path.reserve(DRAG_STEPS);
+    for (int i = 1; i <= DRAG_STEPS; ++i)
+        path.push_back(from + (to - from) * i / DRAG_STEPS);
+
+    return path;
+}
+
+///@brief Sends @p receiver a left button press, moves along dragPath() and a release at @p to.
+/// For the widgets handling the drag themselves, the others go through DragController::simulateDrag()
+static void sendMouseDrag(QWidget *receiver, QPoint from, QPoint to)
+{
+    QPointer<QWidget> receiverP = receiver;
+    auto send = [&receiverP] (QEvent::Type type, QPoint globalPos, Qt::MouseButtons buttons) {
+        if (!receiverP)
+            return;
+        QMouseEvent ev(type, receiverP->mapFromGlobal(globalPos), receiverP->window()->mapFromGlobal(globalPos),
+                       globalPos, Qt::LeftButton, buttons, Qt::NoModifier);
+        qApp->sendEvent(receiverP, &ev);
+    };
+
+    send(QEvent::MouseButtonPress, from, Qt::LeftButton);
+    for (QPoint pos : dragPath(from, to))
+        send(QEvent::MouseMove, pos, Qt::LeftButton);
+    send(QEvent::MouseButtonRelease, to, Qt::NoButton);
+}
+
 OperationBase::OperationBase(KDDockWidgets::Testing::Operations::OperationType type, Fuzzer *fuzzer)
     : m_operationType(type)
     , m_fuzzer(fuzzer)
@@ -58,7 +104,7 @@ void OperationBase::execute()
         updateDescription();
         execute_impl();
 
-        if (m_sleepMS > 0)
+        if (m_sleepMS > 0 && !m_fuzzer->isBenchmarking())
             QTest::qWait(m_sleepMS);
     }
 }
@@ -135,6 +181,21 @@ OperationBase::Ptr OperationBase::newOperation(Fuzzer *fuzzer, OperationType typ
     case OperationType_RestoreLayout:
         ptr = OperationBase::Ptr(new RestoreLayout(fuzzer));
         break;
+    case OperationType_DragSeparator:
+        ptr = OperationBase::Ptr(new DragSeparator(fuzzer));
+        break;
+    case OperationType_ResizeWindow:
+        ptr = OperationBase::Ptr(new ResizeWindow(fuzzer));
+        break;
+    case OperationType_FloatViaDrag:
+        ptr = OperationBase::Ptr(new FloatViaDrag(fuzzer));
+        break;
+    case OperationType_RedockViaDrag:
+        ptr = OperationBase::Ptr(new RedockViaDrag(fuzzer));
+        break;
+    case OperationType_ReorderTab:
+        ptr = OperationBase::Ptr(new ReorderTab(fuzzer));
+        break;
     }
 
     return ptr;
@@ -485,3 +546,423 @@ QVariantMap RestoreLayout::paramsToVariantMap() const
 void RestoreLayout::fillParamsFromVariantMap(const QVariantMap &)
 {
 }
+
+DragSeparator::DragSeparator(Fuzzer *fuzzer)
+    : OperationBase(OperationType_DragSeparator, fuzzer)
+{
+}
+
+static Anchor *anchorForDragSeparator(DockWidgetBase *dw, KDDockWidgets::Location side)
+{
+    Frame *frame = dw ? dw->frame() : nullptr;
+    Item *item = frame ? frame->layoutItem() : nullptr;
+    if (!item || !dw->isVisible())
+        return nullptr;
+
+    Anchor *anchor = item->anchorGroup().anchor(side);
+    if (!anchor || anchor->isStatic() || anchor->isFollowing())
+        return nullptr;
+
+    return anchor;
+}
+
+void DragSeparator::generateRandomParams()
+{
+    DockWidgetBase *dw = m_fuzzer->getRandomDockWidget();
+    const KDDockWidgets::Location side = m_fuzzer->getRandomLocation();
+    if (!anchorForDragSeparator(dw, side))
+        return;
+
+    int delta = m_fuzzer->getRandomInt(-100, 99);
+    if (delta >= 0)
+        delta++; // Never 0
+
+    m_dockWidgetName = dw->uniqueName();
+    m_side = side;
+    m_delta = delta;
+}
+
+bool DragSeparator::hasParams() const
+{
+    return !m_dockWidgetName.isEmpty();
+}
+
+void DragSeparator::updateDescription()
+{
+    m_description = QStringLiteral("DragSeparator at %1 of %2 by %3").arg(KDDockWidgets::locationStr(m_side)).arg(dockStr(m_dockWidgetName)).arg(m_delta);
+}
+
+void DragSeparator::execute_impl()
+{
+    Anchor *anchor = anchorForDragSeparator(dockByName(m_dockWidgetName), m_side);
+    if (!anchor) {
+        qDebug() << "Skipping, separator not found";
+        return;
+    }
+
+    // Dragging further than the bounds is fine, like with a mouse, the separator just stops
+    const int position = anchor->position();
+    QVector<int> positions;
+    positions.reserve(DRAG_STEPS);
+    for (int i = 1; i <= DRAG_STEPS; ++i)
+        positions.push_back(position + m_delta * i / DRAG_STEPS);
+
+    anchor->simulateDrag(positions);
+}
+
+QVariantMap DragSeparator::paramsToVariantMap() const
+{
+    QVariantMap map;
+
+    if (hasParams()) {
+        map["dockWidgetName"] = m_dockWidgetName;
+        map["side"] = m_side;
+        map["delta"] = m_delta;
+    }
+
+    return map;
+}
+
+void DragSeparator::fillParamsFromVariantMap(const QVariantMap &map)
+{
+    m_dockWidgetName = map["dockWidgetName"].toString();
+    m_side = KDDockWidgets::Location(map["side"].toInt());
+    m_delta = map["delta"].toInt();
+}
+
+ResizeWindow::ResizeWindow(Fuzzer *fuzzer)
+    : OperationBase(OperationType_ResizeWindow, fuzzer)
+{
+}
+
+QWidget *ResizeWindow::window() const
+{
+    if (!m_mainWindowName.isEmpty())
+        return mainWindowByName(m_mainWindowName);
+
+    DockWidgetBase *dw = dockByName(m_dockWidgetName);
+    return dw ? dw->floatingWindow() : nullptr;
+}
+
+void ResizeWindow::generateRandomParams()
+{
+    QWidget *window = nullptr;
+    if (m_fuzzer->getRandomBool()) {
+        if (MainWindowBase *mw = m_fuzzer->getRandomMainWindow()) {
+            m_mainWindowName = mw->uniqueName();
+            window = mw;
+        }
+    } else if (DockWidgetBase *dw = m_fuzzer->getRandomDockWidget()) {
+        if (FloatingWindow *fw = dw->floatingWindow()) {
+            m_dockWidgetName = dw->uniqueName();
+            window = fw;
+        }
+    }
+
+    if (!window || !window->isVisible()) {
+        m_mainWindowName.clear();
+        m_dockWidgetName.clear();
+        return;
+    }
+
+    const QSize delta(m_fuzzer->getRandomInt(-150, 150), m_fuzzer->getRandomInt(-150, 150));
+    m_size = (window->size() + delta).expandedTo(window->minimumSize());
+}
+
+bool ResizeWindow::hasParams() const
+{
+    return !m_mainWindowName.isEmpty() || !m_dockWidgetName.isEmpty();
+}
+
+void ResizeWindow::updateDescription()
+{
+    const QString windowStr = m_mainWindowName.isEmpty() ? QStringLiteral("window of %1").arg(dockStr(m_dockWidgetName))
+                                                         : m_mainWindowName;
+    m_description = QStringLiteral("ResizeWindow %1 to %2x%3").arg(windowStr).arg(m_size.width()).arg(m_size.height());
+}
+
+void ResizeWindow::execute_impl()
+{
+    QWidget *w = window();
+    if (!w || !w->isVisible()) {
+        qDebug() << "Skipping, window not found";
+        return;
+    }
+
+    auto fw = qobject_cast<FloatingWindow*>(w);
+    if (!fw) {
+        // Main windows are resized by the window manager, there's no handler to drive
+        w->resize(m_size);
+        return;
+    }
+
+    // Drags the bottom-right corner, so it goes through WidgetResizeHandler like a user's resize
+    const QSize oldSize = fw->size();
+    const QPoint from = fw->mapToGlobal(QPoint(oldSize.width() - 1, oldSize.height() - 1));
+    const QPoint to = fw->mapToGlobal(QPoint(m_size.width() - 1, m_size.height() - 1));
+    sendMouseDrag(fw, from, to);
+
+    if (fw->size() == oldSize && m_size != oldSize) {
+        // No WidgetResizeHandler, the platform resizes it natively
+        fw->resize(m_size);
+    }
+}
+
+QVariantMap ResizeWindow::paramsToVariantMap() const
+{
+    QVariantMap map;
+
+    if (hasParams()) {
+        if (!m_mainWindowName.isEmpty())
+            map["mainWindowName"] = m_mainWindowName;
+        else
+            map["dockWidgetName"] = m_dockWidgetName;
+        map["size"] = sizeToVariantMap(m_size);
+    }
+
+    return map;
+}
+
+void ResizeWindow::fillParamsFromVariantMap(const QVariantMap &map)
+{
+    m_mainWindowName = map["mainWindowName"].toString();
+    m_dockWidgetName = map["dockWidgetName"].toString();
+    m_size = sizeFromVariantMap(map["size"].toMap());
+}
+
+FloatViaDrag::FloatViaDrag(Fuzzer *fuzzer)
+    : OperationBase(OperationType_FloatViaDrag, fuzzer)
+{
+}
+
+static TitleBar *titleBarForFloatViaDrag(DockWidgetBase *dw)
+{
+    Frame *frame = dw ? dw->frame() : nullptr;
+    if (!frame || !frame->isInMainWindow() || !dw->isVisible())
+        return nullptr;
+
+    TitleBar *titleBar = frame->titleBar();
+    return titleBar->isVisible() ? titleBar : nullptr;
+}
+
+void FloatViaDrag::generateRandomParams()
+{
+    DockWidgetBase *dw = m_fuzzer->getRandomDockWidget();
+    if (!titleBarForFloatViaDrag(dw))
+        return;
+
+    // Somewhere to the right of the main window, so it's not dropped back into it
+    m_dockWidgetName = dw->uniqueName();
+    m_destination = dw->window()->geometry().topRight() + QPoint(50, 0) + m_fuzzer->getRandomPos();
+}
+
+bool FloatViaDrag::hasParams() const
+{
+    return !m_dockWidgetName.isEmpty();
+}
+
+void FloatViaDrag::updateDescription()
+{
+    m_description = QStringLiteral("FloatViaDrag %1 to %2,%3").arg(dockStr(m_dockWidgetName)).arg(m_destination.x()).arg(m_destination.y());
+}
+
+void FloatViaDrag::execute_impl()
+{
+    TitleBar *titleBar = titleBarForFloatViaDrag(dockByName(m_dockWidgetName));
+    if (!titleBar) {
+        qDebug() << "Skipping, title bar not found";
+        return;
+    }
+
+    const QPoint pressPos(10, 10);
+    DragController::instance()->simulateDrag(titleBar, pressPos,
+                                             dragPath(titleBar->mapToGlobal(pressPos), m_destination));
+}
+
+QVariantMap FloatViaDrag::paramsToVariantMap() const
+{
+    QVariantMap map;
+
+    if (hasParams()) {
+        map["dockWidgetName"] = m_dockWidgetName;
+        map["x"] = m_destination.x();
+        map["y"] = m_destination.y();
+    }
+
+    return map;
+}
+
+void FloatViaDrag::fillParamsFromVariantMap(const QVariantMap &map)
+{
+    m_dockWidgetName = map["dockWidgetName"].toString();
+    m_destination = { map["x"].toInt(), map["y"].toInt() };
+}
+
+RedockViaDrag::RedockViaDrag(Fuzzer *fuzzer)
+    : OperationBase(OperationType_RedockViaDrag, fuzzer)
+{
+}
+
+void RedockViaDrag::generateRandomParams()
+{
+    DockWidgetBase *dw = m_fuzzer->getRandomDockWidget();
+    FloatingWindow *fw = dw ? dw->floatingWindow() : nullptr;
+    if (!fw || !fw->isVisible())
+        return;
+
+    MainWindowBase *mw = m_fuzzer->getRandomMainWindow();
+    if (!mw || !mw->isVisible())
+        return;
+
+    m_dockWidgetName = dw->uniqueName();
+    m_mainWindowName = mw->uniqueName();
+    m_dropLocation = m_fuzzer->getRandomInt(DropIndicatorOverlayInterface::DropLocation_Left,
+                                            DropIndicatorOverlayInterface::DropLocation_OutterBottom);
+}
+
+bool RedockViaDrag::hasParams() const
+{
+    return !m_dockWidgetName.isEmpty() && !m_mainWindowName.isEmpty();
+}
+
+void RedockViaDrag::updateDescription()
+{
+    m_description = QStringLiteral("RedockViaDrag %1 onto %2, drop location %3").arg(dockStr(m_dockWidgetName), m_mainWindowName).arg(m_dropLocation);
+}
+
+void RedockViaDrag::execute_impl()
+{
+    DockWidgetBase *dw = dockByName(m_dockWidgetName);
+    QPointer<FloatingWindow> fw = dw ? dw->floatingWindow() : nullptr;
+    MainWindowBase *mw = mainWindowByName(m_mainWindowName);
+    if (!fw || !fw->isVisible() || !mw || !mw->isVisible()) {
+        qDebug() << "Skipping, windows not found";
+        return;
+    }
+
+    DragController *dc = DragController::instance();
+    TitleBar *titleBar = fw->titleBar();
+    const QPoint pressPos(10, 10);
+    if (!dc->beginSimulatedDrag(titleBar, pressPos)) {
+        qDebug() << "Skipping, can't drag" << fw;
+        return;
+    }
+
+    // Hovering the drop area shows its drop indicators, only then we know where to release
+    DropArea *dropArea = mw->dropArea();
+    const QPoint hoverPos = dropArea->mapToGlobal(dropArea->rect().center());
+    for (QPoint pos : dragPath(titleBar->mapToGlobal(pressPos), hoverPos))
+        dc->simulateMouseMove(pos);
+
+    const auto location = DropIndicatorOverlayInterface::DropLocation(m_dropLocation);
+    QPoint dropPos = dropArea->dropIndicatorOverlay()->posForIndicator(location);
+    if (dropPos.isNull()) // Not all indicator types support it
+        dropPos = hoverPos;
+    else
+        dc->simulateMouseMove(dropPos);
+
+    dc->endSimulatedDrag(dropPos);
+    if (fw && fw->beingDeleted())
+        Testing::waitForDeleted(fw);
+}
+
+QVariantMap RedockViaDrag::paramsToVariantMap() const
+{
+    QVariantMap map;
+
+    if (hasParams()) {
+        map["dockWidgetName"] = m_dockWidgetName;
+        map["mainWindowName"] = m_mainWindowName;
+        map["dropLocation"] = m_dropLocation;
+    }
+
+    return map;
+}
+
+void RedockViaDrag::fillParamsFromVariantMap(const QVariantMap &map)
+{
+    m_dockWidgetName = map["dockWidgetName"].toString();
+    m_mainWindowName = map["mainWindowName"].toString();
+    m_dropLocation = map["dropLocation"].toInt();
+}
+
+ReorderTab::ReorderTab(Fuzzer *fuzzer)
+    : OperationBase(OperationType_ReorderTab, fuzzer)
+{
+}
+
+static QTabBar *tabBarForReorderTab(DockWidgetBase *dw)
+{
+    Frame *frame = dw ? dw->frame() : nullptr;
+    if (!frame || frame->dockWidgetCount() < 2)
+        return nullptr;
+
+    return qobject_cast<QTabBar*>(frame->tabWidget()->tabBar()->asWidget());
+}
+
+void ReorderTab::generateRandomParams()
+{
+    DockWidgetBase *dw = m_fuzzer->getRandomDockWidget();
+    QTabBar *tabBar = tabBarForReorderTab(dw);
+    if (!tabBar)
+        return;
+
+    const int from = dw->frame()->tabWidget()->indexOfDockWidget(dw);
+    int to = m_fuzzer->getRandomInt(0, tabBar->count() - 2);
+    if (to >= from)
+        to++; // Never the same index
+
+    m_dockWidgetName = dw->uniqueName();
+    m_from = from;
+    m_to = to;
+}
+
+bool ReorderTab::hasParams() const
+{
+    return !m_dockWidgetName.isEmpty();
+}
+
+void ReorderTab::updateDescription()
+{
+    m_description = QStringLiteral("ReorderTab in frame of %1, from %2 to %3").arg(dockStr(m_dockWidgetName)).arg(m_from).arg(m_to);
+}
+
+void ReorderTab::execute_impl()
+{
+    QTabBar *tabBar = tabBarForReorderTab(dockByName(m_dockWidgetName));
+    if (!tabBar || m_from < 0 || m_to < 0 || m_from >= tabBar->count() || m_to >= tabBar->count()) {
+        qDebug() << "Skipping, tab not found";
+        return;
+    }
+
+    if (!tabBar->isMovable()) {
+        // Without Config::Flag_AllowReorderTabs a horizontal drag doesn't reorder, only the API does
+        tabBar->moveTab(m_from, m_to);
+        return;
+    }
+
+    // Drags the tab over the destination, QTabBar does the reorder
+    const QPoint from = tabBar->mapToGlobal(tabBar->tabRect(m_from).center());
+    const QPoint to = tabBar->mapToGlobal(tabBar->tabRect(m_to).center());
+    sendMouseDrag(tabBar, from, to);
+}
+
+QVariantMap ReorderTab::paramsToVariantMap() const
+{
+    QVariantMap map;
+
+    if (hasParams()) {
+        map["dockWidgetName"] = m_dockWidgetName;
+        map["from"] = m_from;
+        map["to"] = m_to;
+    }
+
+    return map;
+}
+
+void ReorderTab::fillParamsFromVariantMap(const QVariantMap &map)
+{
+    m_dockWidgetName = map["dockWidgetName"].toString();
+    m_from = map["from"].toInt();
+    m_to = map["to"].toInt();
+}
@@ -30,6 +30,8 @@
 #include <QObject>
 #include <QVector>
 #include <QMetaEnum>
+#include <QPoint>
+#include <QSize>
 
 #include <memory>
 
@@ -53,6 +55,11 @@ enum OperationType {
     OperationType_AddDockWidgetAsTab,    ///< DockWidget::addDockWidgetAsTab()
     OperationType_SaveLayout, ///< LayoutSaver::saveLayout()
     OperationType_RestoreLayout, ///< LayoutSaver::restoreLayout()
+    OperationType_DragSeparator, ///< Dragging a separator, see Anchor::simulateDrag()
+    OperationType_ResizeWindow, ///< Resizing a main window, or dragging the corner of a floating window
+    OperationType_FloatViaDrag, ///< Dragging a docked title bar out of the main window, see DragController::simulateDrag()
+    OperationType_RedockViaDrag, ///< Dragging a floating window onto a main window's drop indicator
+    OperationType_ReorderTab, ///< Dragging a tab over another one, QTabBar::moveTab() if tabs aren't movable
     OperationType_Count /// Keep at end
 };
 Q_ENUM_NS(OperationType)
@@ -203,6 +210,97 @@ protected:
     void fillParamsFromVariantMap(const QVariantMap &) override;
 };
 
+class DragSeparator : public OperationBase
+{
+public:
+    explicit DragSeparator(Fuzzer *);
+
+protected:
+    void generateRandomParams() override;
+    bool hasParams() const override;
+    void updateDescription() override;
+    void execute_impl() override;
+    QVariantMap paramsToVariantMap() const override;
+    void fillParamsFromVariantMap(const QVariantMap &) override;
+private:
+    QString m_dockWidgetName; // The separator is one of the borders of this dock widget's frame
+    KDDockWidgets::Location m_side = KDDockWidgets::Location_None;
+    int m_delta = 0;
+};
+
+class ResizeWindow : public OperationBase
+{
+public:
+    explicit ResizeWindow(Fuzzer *);
+
+protected:
+    void generateRandomParams() override;
+    bool hasParams() const override;
+    void updateDescription() override;
+    void execute_impl() override;
+    QVariantMap paramsToVariantMap() const override;
+    void fillParamsFromVariantMap(const QVariantMap &) override;
+private:
+    QWidget *window() const;
+    // Only one of them is set. Floating windows are referenced through one of their dock widgets
+    QString m_mainWindowName;
+    QString m_dockWidgetName;
+    QSize m_size;
+};
+
+class FloatViaDrag : public OperationBase
+{
+public:
+    explicit FloatViaDrag(Fuzzer *);
+
+protected:
+    void generateRandomParams() override;
+    bool hasParams() const override;
+    void updateDescription() override;
+    void execute_impl() override;
+    QVariantMap paramsToVariantMap() const override;
+    void fillParamsFromVariantMap(const QVariantMap &) override;
+private:
+    QString m_dockWidgetName;
+    QPoint m_destination; // In global coordinates
+};
+
+class RedockViaDrag : public OperationBase
+{
+public:
+    explicit RedockViaDrag(Fuzzer *);
+
+protected:
+    void generateRandomParams() override;
+    bool hasParams() const override;
+    void updateDescription() override;
+    void execute_impl() override;
+    QVariantMap paramsToVariantMap() const override;
+    void fillParamsFromVariantMap(const QVariantMap &) override;
+private:
+    QString m_dockWidgetName;
+    QString m_mainWindowName;
+    int m_dropLocation = 0; // A DropIndicatorOverlayInterface::DropLocation
+};
+
+class ReorderTab : public OperationBase
+{
+public:
+    explicit ReorderTab(Fuzzer *);
+
+protected:
+    void generateRandomParams() override;
+    bool hasParams() const override;
+    void updateDescription() override;
+    void execute_impl() override;
+    QVariantMap paramsToVariantMap() const override;
+    void fillParamsFromVariantMap(const QVariantMap &) override;
+private:
+    QString m_dockWidgetName; // The tab is moved within this dock widget's frame
+    int m_from = -1;
+    int m_to = -1;
+};
+
 }
 }
 }
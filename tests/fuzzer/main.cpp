@@ -22,6 +22,7 @@
 // clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,missing-typeinfo,detaching-member,function-args-by-ref,non-pod-global-static,reserve-candidates,qstring-allocations
 
 #include "Fuzzer.h"
+#include "Minimizer.h"
 #include "DockRegistry_p.h"
 
 #include <QCommandLineParser>
@@ -29,11 +30,161 @@
 #include <QTimer>
 #include <QDebug>
 #include <QFile>
+#include <QDir>
+#include <QProcess>
+#include <QElapsedTimer>
+#include <QTextStream>
 #include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 
 using namespace KDDockWidgets;
 using namespace KDDockWidgets::Testing;
 
+static std::atomic<quint64> s_allocationCount(0);
+
+quint64 KDDockWidgets::Testing::allocationCount()
+{
+    return s_allocationCount.load();
+}
+
+// Counts allocations, for the benchmark mode
+void *operator new(std::size_t size)
+{
+    s_allocationCount++;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+struct WorkerResult {
+    quint32 seed = 0;
+    bool failed = false;
+    int numOperations = 0;
+    QString dumpFile;
+    QString logFile;
+};
+
+static const char s_statsPrefix[] = "fuzzer-stats:";
+
+// Each worker is dumped to its own file, named after its seed, so they don't clash
+static QString dumpFileForSeed(const QString &outputDir, quint32 seed)
+{
+    return QDir(outputDir).filePath(QStringLiteral("fuzzer_dump_%1.json").arg(seed));
+}
+
+// Launches one fuzzer process per job, each with a different seed, and waits for all of them
+// Returns the name of the minimized version of a testcase, foo.json -> foo_min.json
+static QString minimizedFileName(const QString &jsonFile)
+{
+    QString name = jsonFile;
+    if (name.endsWith(QLatin1String(".json")))
+        name.chop(5);
+    return name + QStringLiteral("_min.json");
+}
+
+static int runWorkers(int numJobs, quint32 firstSeed, int numTests, const QString &outputDir, bool minimize,
+                      const QStringList &workerArgs)
+{
+    QDir().mkpath(outputDir);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<QProcess*> processes;
+    QVector<WorkerResult> results;
+    processes.reserve(numJobs);
+    results.reserve(numJobs);
+
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("QT_QPA_PLATFORM"), QStringLiteral("offscreen"));
+
+    for (int i = 0; i < numJobs; ++i) {
+        WorkerResult result;
+        result.seed = firstSeed + quint32(i);
+        result.dumpFile = dumpFileForSeed(outputDir, result.seed);
+        result.logFile = QDir(outputDir).filePath(QStringLiteral("fuzzer_worker_%1.log").arg(result.seed));
+
+        auto process = new QProcess();
+        process->setProcessEnvironment(env);
+        process->setStandardErrorFile(result.logFile); // The qDebug() output of each operation
+        process->start(QCoreApplication::applicationFilePath(),
+                       { QStringLiteral("--worker"),
+                         QStringLiteral("--seed"), QString::number(result.seed),
+                         QStringLiteral("--tests"), QString::number(numTests),
+                         QStringLiteral("--output"), outputDir } + workerArgs);
+
+        processes.push_back(process);
+        results.push_back(result);
+    }
+
+    int numFailed = 0;
+    int totalOperations = 0;
+    for (int i = 0; i < numJobs; ++i) {
+        QProcess *process = processes.at(i);
+        WorkerResult &result = results[i];
+        process->waitForFinished(-1);
+
+        const QList<QByteArray> lines = process->readAllStandardOutput().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith(s_statsPrefix))
+                result.numOperations = line.mid(int(qstrlen(s_statsPrefix))).trimmed().toInt();
+        }
+
+        result.failed = process->exitStatus() != QProcess::NormalExit || process->exitCode() != 0;
+        if (result.failed) {
+            numFailed++;
+        } else {
+            // Only failures are interesting
+            QFile::remove(result.logFile);
+        }
+
+        totalOperations += result.numOperations;
+        delete process;
+    }
+
+    const double secs = double(timer.elapsed()) / 1000.0;
+
+    QTextStream out(stdout);
+    out << "\n" << numJobs << " workers ran " << totalOperations << " operations in "
+        << QString::number(secs, 'f', 1) << " s ("
+        << QString::number(secs > 0 ? totalOperations / secs : 0, 'f', 1) << " ops/s)\n";
+
+    for (const WorkerResult &result : qAsConst(results)) {
+        if (!result.failed)
+            continue;
+
+        out << "Worker with seed " << result.seed << " failed. ";
+        if (QFile::exists(result.dumpFile)) {
+            out << "Testcase: " << result.dumpFile << "; ";
+            if (minimize) {
+                out.flush();
+                const QString minimizedFile = minimizedFileName(result.dumpFile);
+                Minimizer minimizer(Minimizer::Mode_Failure);
+                if (minimizer.minimize(result.dumpFile, minimizedFile))
+                    out << "Minimized: " << minimizedFile << "; ";
+            }
+        }
+        out << "Log: " << result.logFile << "\n";
+    }
+
+    out << numFailed << " of " << numJobs << " workers failed\n";
+
+    return numFailed == 0 ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
     QApplication app(argc, argv);
@@ -54,9 +205,37 @@ int main(int argc, char **argv)
     QCommandLineOption skipLastOption("a", QCoreApplication::translate("main", "Skips the last test (presumably failing)"));
     parser.addOption(skipLastOption);
 
+    QCommandLineOption benchmarkOption(QStringList() << "b" << "benchmark", QCoreApplication::translate("main", "Benchmark mode. Replays without delays and reports the time, allocations and geometry changes of each operation"));
+    parser.addOption(benchmarkOption);
+
     QCommandLineOption noQuitOption("n", QCoreApplication::translate("main", "Don't quit at the end, keep event loop running for debugging"));
     parser.addOption(noQuitOption);
 
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", QCoreApplication::translate("main", "Runs <jobs> fuzzer processes in parallel, each with a different seed, with the offscreen platform"), "jobs");
+    parser.addOption(jobsOption);
+
+    QCommandLineOption seedOption("seed", QCoreApplication::translate("main", "Seeds the random generator, for reproducible runs. With -j, it's the seed of the first worker"), "seed");
+    parser.addOption(seedOption);
+
+    QCommandLineOption testsOption("tests", QCoreApplication::translate("main", "The number of random tests to run. Defaults to 1"), "tests", "1");
+    parser.addOption(testsOption);
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output", QCoreApplication::translate("main", "Directory where failing tests are dumped to"), "dir", ".");
+    parser.addOption(outputOption);
+
+    QCommandLineOption minimizeOption("minimize", QCoreApplication::translate("main", "Minimizes the failing json file to the smallest sequence of operations that still fails, saved as <file>_min.json. With -j, minimizes the tests of failed workers"));
+    parser.addOption(minimizeOption);
+
+    QCommandLineOption slowerThanOption("fail-slower-than", QCoreApplication::translate("main", "Fails with exit code 2 if an operation takes longer than <ms>. Implies -b. With --minimize, minimizes the slow test instead of a failing one"), "ms");
+    parser.addOption(slowerThanOption);
+
+    QCommandLineOption oracleOption("perf-oracle", QCoreApplication::translate("main", "Saves tests where an operation is much slower than expected for the number of visible items, as <dump>_slow_<n>.json"));
+    parser.addOption(oracleOption);
+
+    QCommandLineOption workerOption("worker", QCoreApplication::translate("main", "Internal, used by -j"));
+    workerOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOption(workerOption);
+
     parser.addHelpOption();
     parser.process(app);
 
@@ -74,12 +253,60 @@ int main(int argc, char **argv)
     if (parser.isSet(noQuitOption))
         options |= Fuzzer::Option_NoQuit;
 
+    const int slowThresholdMS = parser.value(slowerThanOption).toInt();
+    const bool benchmark = parser.isSet(benchmarkOption) || slowThresholdMS > 0;
+    if (benchmark)
+        options |= Fuzzer::Option_Benchmark;
+
+    if (parser.isSet(oracleOption))
+        options |= Fuzzer::Option_PerformanceOracle;
+
     const bool loops = parser.isSet(loopOption);
+    const bool isWorker = parser.isSet(workerOption);
+    const int numTests = qMax(1, parser.value(testsOption).toInt());
+    const QString outputDir = parser.value(outputOption);
+
+    const bool hasSeed = parser.isSet(seedOption);
+    const quint32 seed = hasSeed ? parser.value(seedOption).toUInt()
+                                 : quint32(std::random_device()());
+
+    if (parser.isSet(jobsOption)) {
+        const int numJobs = parser.value(jobsOption).toInt();
+        if (numJobs < 1 || !filesToLoad.isEmpty()) {
+            std::cerr << "\n-j requires a positive number of jobs and no json files\n";
+            return 1;
+        }
+
+        QStringList workerArgs;
+        if (parser.isSet(oracleOption))
+            workerArgs << QStringLiteral("--perf-oracle");
+
+        return runWorkers(numJobs, seed, numTests, outputDir, parser.isSet(minimizeOption), workerArgs);
+    }
+
+    if (parser.isSet(minimizeOption)) {
+        if (filesToLoad.size() != 1) {
+            std::cerr << "\n--minimize requires a single json file\n";
+            return 1;
+        }
+
+        Minimizer minimizer(slowThresholdMS > 0 ? Minimizer::Mode_Slow : Minimizer::Mode_Failure, slowThresholdMS);
+        return minimizer.minimize(filesToLoad.first(), minimizedFileName(filesToLoad.first())) ? 0 : 1;
+    }
 
     Fuzzer fuzzer(dumpToJsonOnFatal, options);
-    if (slowDown)
+    if (benchmark || isWorker)
+        fuzzer.setDelayBetweenOperations(0);
+    else if (slowDown)
         fuzzer.setDelayBetweenOperations(1000);
 
+    fuzzer.setSlowOperationThreshold(slowThresholdMS);
+
+    if (hasSeed || isWorker) {
+        fuzzer.setSeed(seed);
+        fuzzer.setDumpJsonFileName(dumpFileForSeed(outputDir, seed));
+    }
+
     for (const QString &file : filesToLoad) {
         if (!QFile::exists(file)) {
             std::cerr << "\nFile doesn't exist: " << file.toStdString() << "\n";
@@ -87,18 +314,21 @@ int main(int argc, char **argv)
         }
     }
 
-    QTimer::singleShot(0, &fuzzer, [&app, &fuzzer, filesToLoad, loops, options] {
+    QTimer::singleShot(0, &fuzzer, [&app, &fuzzer, filesToLoad, loops, options, numTests, isWorker] {
         if (filesToLoad.isEmpty()) {
             do {
-                fuzzer.fuzz({ 1, 10, true });
+                fuzzer.fuzz({ numTests, 10, true });
             } while(loops);
         } else {
             fuzzer.fuzz(filesToLoad);
         }
 
+        if (isWorker) // Reported back to runWorkers()
+            std::cout << s_statsPrefix << " " << fuzzer.numOperationsRun() << std::endl;
+
         if (!(options & Fuzzer::Option_NoQuit)) {
             // if noQuit is true we keep the app running so it can be debugged
-            app.quit();
+            app.exit(fuzzer.foundSlowOperation() ? Minimizer::SlowOperationExitCode : 0);
         }
     });
 
@@ -0,0 +1,407 @@
+/*
+  This file is part of KDDockWidgets.
+
+  Copyright (C) 2018-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Sérgio Martins <sergio.martins@kdab.com>
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file
+ * @brief Fails when canonical operations allocate more than their recorded budget.
+ *
+ * Budgets live in allocation_budgets.txt. Run with KDDOCKWIDGETS_RECORD_ALLOCATION_BUDGETS=1 to
+ * rewrite it with the current counts, after a deliberate change. Counts depend on the Qt version
+ * and platform, so 10% plus a few allocations of slack are tolerated. An operation without a budget
+ * fails, so new operations must be recorded too.
+ *
+ * @author Sérgio Martins \<sergio.martins@kdab.com\>
+ */
+
+// clazy:excludeall=ctor-missing-parent-argument,missing-qobject-macro,range-loop,non-pod-global-static,qstring-allocations
+
+#include "DockWidgetBase.h"
+#include "MainWindow.h"
+#include "DockRegistry_p.h"
+#include "Frame_p.h"
+#include "LayoutSaver.h"
+#include "multisplitter/MultiSplitterLayout_p.h"
+#include "multisplitter/Item_p.h"
+#include "multisplitter/Anchor_p.h"
+#include "utils.h"
+#include "Testing.h"
+
+#include <QtTest/QtTest>
+#include <QApplication>
+#include <QFile>
+#include <QMap>
+#include <QStyleFactory>
+
+#include <cstdlib>
+#include <new>
+
+using namespace KDDockWidgets;
+using namespace KDDockWidgets::Tests;
+
+// Only allocations made by the thread that's counting are counted, Qt might have others
+static thread_local bool t_countAllocations = false;
+static quint64 s_allocationCount = 0;
+
+// With glibc malloc() itself is replaced too, as Qt's containers don't go through operator new.
+// Not with the sanitizers though, they replace malloc() themselves. __THROW matches glibc's declarations.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+# define KDDW_HOOK_MALLOC
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void __libc_free(void *);
+
+extern "C" void *malloc(size_t size) __THROW
+{
+    if (t_countAllocations)
+        ++s_allocationCount;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) __THROW
+{
+    if (t_countAllocations)
+        ++s_allocationCount;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) __THROW
+{
+    if (t_countAllocations)
+        ++s_allocationCount; // Might just grow in place, but it's an allocation from the caller's point of view
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr) __THROW
+{
+    __libc_free(ptr);
+}
+#endif
+
+void *operator new(std::size_t size)
+{
+#ifndef KDDW_HOOK_MALLOC // Otherwise malloc() counts it
+    if (t_countAllocations)
+        ++s_allocationCount;
+#endif
+
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+///@brief Counts the allocations done by the current thread during its lifetime
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+        : m_start(s_allocationCount)
+    {
+        t_countAllocations = true;
+    }
+
+    ~AllocationCounter()
+    {
+        t_countAllocations = false;
+    }
+
+    quint64 count() const
+    {
+        return s_allocationCount - m_start;
+    }
+
+private:
+    Q_DISABLE_COPY(AllocationCounter)
+    const quint64 m_start;
+};
+
+static QString budgetsFilename()
+{
+    return QStringLiteral(KDDW_ALLOCATION_BUDGETS_FILE);
+}
+
+static bool isRecording()
+{
+    return qEnvironmentVariableIntValue("KDDOCKWIDGETS_RECORD_ALLOCATION_BUDGETS") == 1;
+}
+
+///@brief Reads "<name> <count>" lines, ignoring empty ones and # comments
+static QMap<QString, quint64> readBudgets()
+{
+    QMap<QString, quint64> budgets;
+    QFile file(budgetsFilename());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return budgets; // Every test fails for lack of a budget, unless they're being recorded
+
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+            continue;
+
+        const QList<QByteArray> fields = line.split(' ');
+        bool ok = false;
+        const quint64 count = fields.size() == 2 ? fields.at(1).toULongLong(&ok) : 0;
+        if (ok)
+            budgets.insert(QString::fromLatin1(fields.at(0)), count);
+        else
+            qWarning() << Q_FUNC_INFO << "Invalid line" << line;
+    }
+
+    return budgets;
+}
+
+static bool writeBudgets(const QMap<QString, quint64> &budgets)
+{
+    QFile file(budgetsFilename());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << Q_FUNC_INFO << "Failed to open" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QByteArray data = "# Heap allocations per operation, see tst_allocations.cpp. Rewritten by\n"
+                      "# running tst_allocations with KDDOCKWIDGETS_RECORD_ALLOCATION_BUDGETS=1\n";
+    for (auto it = budgets.cbegin(), end = budgets.cend(); it != end; ++it)
+        data += it.key().toLatin1() + ' ' + QByteArray::number(it.value()) + '\n';
+
+    return file.write(data) == data.size();
+}
+
+static const int s_numFrames = 20;
+
+///@brief Returns a main window with s_numFrames frames side by side, with two tabs in the first one
+static std::unique_ptr<MainWindow> createLayout(std::vector<DockWidgetBase *> &docks)
+{
+    auto m = createMainWindow(QSize(4000, 1000), MainWindowOption_None);
+    for (int i = 0; i < s_numFrames; ++i) {
+        auto dw = createDockWidget(QStringLiteral("dock-%1").arg(i), new QWidget(), {}, /*show=*/false);
+        m->addDockWidget(dw, Location_OnRight);
+        docks.push_back(dw);
+    }
+
+    auto tabbed = createDockWidget(QStringLiteral("tabbed"), new QWidget(), {}, /*show=*/false);
+    docks.front()->addDockWidgetAsTab(tabbed);
+    docks.push_back(tabbed);
+    Testing::processPendingEvents();
+
+    return m;
+}
+
+class TestAllocations : public QObject
+{
+    Q_OBJECT
+public:
+    ///@brief Fails if @p count is over the budget of the current test function
+    void checkBudget(quint64 count);
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        qputenv("KDDOCKWIDGETS_SHOW_DEBUG_WINDOW", "");
+        qApp->setStyle(QStyleFactory::create(QStringLiteral("fusion")));
+        Testing::installFatalMessageHandler();
+        m_budgets = readBudgets();
+    }
+
+    void cleanupTestCase()
+    {
+        if (isRecording())
+            QVERIFY(writeBudgets(m_budgets));
+    }
+
+    void tst_addDockWidget();
+    void tst_dragSeparator();
+    void tst_switchTab();
+    void tst_floatAndRedock();
+    void tst_serializeLayout();
+
+private:
+    QMap<QString, quint64> m_budgets;
+};
+
+void TestAllocations::checkBudget(quint64 count)
+{
+    const QString name = QString::fromLatin1(QTest::currentTestFunction());
+    if (isRecording()) {
+        m_budgets.insert(name, count);
+        return;
+    }
+
+    // Otherwise a missing budget would silently turn the test into a no-op
+    auto it = m_budgets.constFind(name);
+    if (it == m_budgets.cend()) {
+        const QString message = QStringLiteral("%1 has no recorded budget, it allocated %2 times. Record it with KDDOCKWIDGETS_RECORD_ALLOCATION_BUDGETS=1")
+                                    .arg(name).arg(count);
+        QFAIL(qPrintable(message));
+    }
+
+    // Not a qWarning(), the fatal message handler would abort instead of failing this one test
+    const quint64 allowed = it.value() + it.value() / 10 + 5;
+    const QString message = QStringLiteral("%1 allocated %2 times, the budget is %3").arg(name).arg(count).arg(it.value());
+    QVERIFY2(count <= allowed, qPrintable(message));
+}
+
+void TestAllocations::tst_addDockWidget()
+{
+    std::vector<DockWidgetBase *> docks;
+    auto m = createLayout(docks);
+    auto dw = createDockWidget(QStringLiteral("added"), new QWidget(), {}, /*show=*/false);
+
+    quint64 count = 0;
+    {
+        AllocationCounter counter;
+        m->addDockWidget(dw, Location_OnBottom);
+        count = counter.count();
+    }
+
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+    checkBudget(count);
+}
+
+void TestAllocations::tst_dragSeparator()
+{
+    std::vector<DockWidgetBase *> docks;
+    auto m = createLayout(docks);
+    Anchor *anchor = m->multiSplitterLayout()->itemForFrame(docks.front()->frame())->anchorGroup().right;
+    const int originalPos = anchor->position();
+
+    // 100 px, in mouse move sized steps. Then back, so the first move's lazy initializations aren't counted
+    for (int pos = originalPos + 10; pos <= originalPos + 100; pos += 10)
+        anchor->setPosition(pos);
+
+    quint64 count = 0;
+    {
+        AllocationCounter counter;
+        for (int pos = originalPos + 90; pos >= originalPos; pos -= 10)
+            anchor->setPosition(pos);
+        count = counter.count();
+    }
+
+    QCOMPARE(anchor->position(), originalPos);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+    checkBudget(count);
+}
+
+void TestAllocations::tst_switchTab()
+{
+    std::vector<DockWidgetBase *> docks;
+    auto m = createLayout(docks);
+    Frame *frame = docks.front()->frame();
+    QCOMPARE(frame->dockWidgetCount(), 2);
+    frame->setCurrentTabIndex(1);
+    frame->setCurrentTabIndex(0);
+
+    quint64 count = 0;
+    {
+        AllocationCounter counter;
+        frame->setCurrentTabIndex(1);
+        count = counter.count();
+    }
+
+    QCOMPARE(frame->currentTabIndex(), 1);
+    checkBudget(count);
+}
+
+void TestAllocations::tst_floatAndRedock()
+{
+    std::vector<DockWidgetBase *> docks;
+    auto m = createLayout(docks);
+    DockWidgetBase *dw = docks.at(s_numFrames / 2);
+
+    quint64 count = 0;
+    {
+        AllocationCounter counter;
+        dw->setFloating(true);
+        dw->setFloating(false);
+        count = counter.count();
+    }
+
+    QVERIFY(!dw->isFloating());
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+    Testing::processPendingEvents();
+    checkBudget(count);
+}
+
+void TestAllocations::tst_serializeLayout()
+{
+    std::vector<DockWidgetBase *> docks;
+    auto m = createLayout(docks);
+    LayoutSaver saver;
+    saver.serializeLayout();
+
+    QByteArray data;
+    quint64 count = 0;
+    {
+        AllocationCounter counter;
+        data = saver.serializeLayout();
+        count = counter.count();
+    }
+
+    QVERIFY(!data.isEmpty());
+    checkBudget(count);
+}
+
+QTEST_MAIN(TestAllocations)
+#include "tst_allocations.moc"
@@ -30,15 +30,24 @@
 #include "DropArea_p.h"
 #include "TitleBar_p.h"
 #include "WindowBeingDragged_p.h"
+#include "DragController_p.h"
 #include "Utils_p.h"
 #include "LayoutSaver.h"
 #include "LayoutSaver_p.h"
+#include "AsyncLayoutSaver.h"
+#include "AsyncLayoutRestorer.h"
+#include "LayoutHistory.h"
+#include "LayoutSnapshot.h"
+#include "Stats.h"
+#include "EventLog.h"
 #include "TabWidget_p.h"
 #include "multisplitter/MultiSplitter_p.h"
 #include "LastPosition_p.h"
 #include "utils.h"
 #include "FrameworkWidgetFactory.h"
 #include "DropAreaWithCentralFrame_p.h"
+#include "private/widgets/SeparatorOverlay_p.h"
+#include "indicators/AnimatedIndicators_p.h"
 #include "Testing.h"
 
 #include <QtTest/QtTest>
@@ -51,7 +60,14 @@
 #include <QTextEdit>
 #include <QVBoxLayout>
 #include <QToolButton>
+#include <QMenu>
 #include <QStyleFactory>
+#include <QTemporaryDir>
+#include <QScreen>
+#include <QtMath>
+
+#include <algorithm>
+#include <thread>
 
 #ifdef Q_OS_WIN
 # include <Windows.h>
@@ -191,11 +207,27 @@ struct EnsureTopLevelsDeleted
         : m_originalFlags(Config::self().flags())
         , m_originalStaticAnchorThickness(Config::self().separatorThickness(true))
         , m_originalAnchorThickness(Config::self().separatorThickness(false))
+        , m_originalFloatingWindowPoolSize(Config::self().floatingWindowPoolSize())
+        , m_originalDragMouseMoveInterval(Config::self().dragMouseMoveInterval())
+        , m_originalLazyResizeIdleInterval(Config::self().lazyResizeIdleInterval())
+        , m_originalMaxPlaceholdersPerLayout(Config::self().maxPlaceholdersPerLayout())
+        , m_originalWindowResizeThrottleInterval(Config::self().windowResizeThrottleInterval())
+        , m_originalDropIndicatorType(DefaultWidgetFactory::s_dropIndicatorType)
     {
     }
 
     ~EnsureTopLevelsDeleted()
     {
+        // Closed dock widgets are hidden top-levels, tests don't need to delete them themselves
+        QVector<QPointer<DockWidgetBase>> closedDockWidgets;
+        for (QWidget *w : qApp->topLevelWidgets()) {
+            auto dw = qobject_cast<DockWidgetBase*>(w);
+            if (dw && !dw->isVisible())
+                closedDockWidgets.push_back(dw);
+        }
+        for (const QPointer<DockWidgetBase> &dw : qAsConst(closedDockWidgets))
+            delete dw.data();
+
         if (topLevels().size() != 0) {
             qWarning() << "There's still top-level widgets present!" << topLevels();
         }
@@ -205,6 +237,12 @@ struct EnsureTopLevelsDeleted
         Config::self().setFlags(m_originalFlags);
         Config::self().setSeparatorThickness(m_originalStaticAnchorThickness, true);
         Config::self().setSeparatorThickness(m_originalAnchorThickness, false);
+        Config::self().setFloatingWindowPoolSize(m_originalFloatingWindowPoolSize);
+        Config::self().setDragMouseMoveInterval(m_originalDragMouseMoveInterval);
+        Config::self().setLazyResizeIdleInterval(m_originalLazyResizeIdleInterval);
+        Config::self().setMaxPlaceholdersPerLayout(m_originalMaxPlaceholdersPerLayout);
+        Config::self().setWindowResizeThrottleInterval(m_originalWindowResizeThrottleInterval);
+        DefaultWidgetFactory::s_dropIndicatorType = m_originalDropIndicatorType;
     }
 
     QWidgetList topLevels() const
@@ -222,6 +260,12 @@ struct EnsureTopLevelsDeleted
     const Config::Flags m_originalFlags;
     const int m_originalStaticAnchorThickness;
     const int m_originalAnchorThickness;
+    const int m_originalFloatingWindowPoolSize;
+    const int m_originalDragMouseMoveInterval;
+    const int m_originalLazyResizeIdleInterval;
+    const int m_originalMaxPlaceholdersPerLayout;
+    const int m_originalWindowResizeThrottleInterval;
+    const DefaultWidgetFactory::DropIndicatorType m_originalDropIndicatorType;
 };
 
 class TestDocks : public QObject
@@ -247,6 +291,23 @@ private Q_SLOTS:
     void tst_shutdown();
     void tst_mainWindowAlwaysHasCentralWidget();
     void tst_createFloatingWindow();
+    void tst_topLevels();
+    void tst_registryLookups();
+    void tst_floatingWindowPool();
+    void tst_warmUpWindows();
+    void tst_appEventFilter();
+    void tst_stats();
+    void tst_titleBarChromeCache();
+    void tst_eventLog();
+    void tst_frameGeometryBatch();
+    void tst_restoreFrameGeometryOnce();
+    void tst_bulkClear();
+    void tst_scheduleDelete();
+    void tst_layoutMinimumSize();
+    void tst_coalesceLayoutInvalidated();
+    void tst_tabOverflowMenu();
+    void tst_reorderTabs();
+    void tst_windowResizeThrottle();
     void tst_dock2FloatingWidgetsTabbed();
     void tst_close();
     void tst_doubleClose();
@@ -255,8 +316,12 @@ private Q_SLOTS:
     void tst_dockDockWidgetNested();
     void tst_dockFloatingWindowNested();
     void tst_anchorsFromTo();
+    void tst_itemAt();
     void tst_dockWindowWithTwoSideBySideFramesIntoCenter();
     void tst_dockWindowWithTwoSideBySideFramesIntoLeft();
+    void tst_overlayIndicators();
+    void tst_animationClock();
+    void tst_separatorOverlay();
     void tst_dockWindowWithTwoSideBySideFramesIntoRight();
     void tst_posAfterLeftDetach();
     void tst_propagateMinSize();
@@ -264,6 +329,7 @@ private Q_SLOTS:
     void tst_propagateSizeHonoursMinSize();
 
     void tst_addDockWidgetAsTabToDockWidget();
+    void tst_addDockWidgetsAsTab();
     void tst_addDockWidgetToMainWindow(); // Tests MainWindow::addDockWidget();
     void tst_addDockWidgetToContainingWindow();
     void tst_addToSmallMainWindow();
@@ -271,6 +337,16 @@ private Q_SLOTS:
     void tst_notClosable();
     void tst_maximizeAndRestore();
     void tst_propagateResize2();
+    void tst_linearLayoutSolver();
+    void tst_linearRedistributeSpace();
+    void tst_boundPositionsForAllAnchors();
+    void tst_resizePolicy();
+    void tst_lazyResizeLivePreview();
+    void tst_resizeDockWidget();
+    void tst_showDockWidgets();
+    void tst_floatDockWidgets();
+    void tst_checkSanityIncremental();
+    void tst_layoutTransaction();
 
     void tst_availableLengthForDrop_data();
     void tst_availableLengthForDrop();
@@ -284,6 +360,7 @@ private Q_SLOTS:
     void tst_crash(); // tests some crash I got
     void tst_crash2_data();
     void tst_crash2();
+    void tst_cumulativeMinLengthCache();
     void tst_setFloatingWhenWasTabbed();
     void tst_setFloatingWhenSideBySide();
     void tst_setFloatingAfterDraggedFromTabToSideBySide();
@@ -292,6 +369,7 @@ private Q_SLOTS:
     void tst_refUnrefItem();
     void tst_addAndReadd();
     void tst_placeholderCount();
+    void tst_maxPlaceholdersPerLayout();
     void tst_availableLengthForOrientation();
     void tst_setAstCurrentTab();
     void tst_closeShowWhenNoCentralFrame();
@@ -327,6 +405,33 @@ private Q_SLOTS:
     void tst_positionWhenShown();
     void tst_restoreEmpty();
     void tst_restoreSimple();
+    void tst_restoreFromDirectory();
+    void tst_restoreFromMappedFile();
+    void tst_restoreBinary();
+    void tst_restoreCompressedAndDelta();
+    void tst_restoreReport();
+    void tst_restoreRelativeToMainWindow();
+    void tst_restoreOnResizedScreen();
+    void tst_restoreLazyClosedDockWidgets();
+    void tst_lazyWidgetCreation();
+    void tst_hibernation();
+    void tst_persistentNativeContainer();
+    void tst_sideBar();
+    void tst_asyncSaveLayout();
+    void tst_asyncRestoreLayout();
+    void tst_restoreDuringAsyncRestore();
+    void tst_layoutGeneration();
+    void tst_layoutStructuralHash();
+    void tst_streamingJsonReader();
+    void tst_readOldPlaceholderFormat();
+    void tst_restoreIncremental();
+    void tst_restoreIncrementalSizesOnly();
+    void tst_restoreCoalescesVisibilitySignals();
+    void tst_layoutChangeNotifications();
+    void tst_layoutSnapshot();
+    void tst_interactiveOperationSignals();
+    void tst_effectiveVisibility();
+    void tst_layoutHistory();
     void tst_restoreNestedAndTabbed();
     void tst_restoreCentralFrame();
     void tst_restoreCrash();
@@ -336,21 +441,30 @@ private Q_SLOTS:
     void tst_restoreWithNonClosableWidget();
     void tst_restoreAfterResize();
     void tst_restoreWithAffinity();
+    void tst_restoreSkipsOtherAffinities();
+    void tst_restoreStateOnly();
     void tst_marginsAfterRestore();
     void tst_restoreEmbeddedMainWindow();
     void tst_restoreWithDockFactory();
+    void tst_restoreRejectsInconsistentLayout();
 
     void tst_resizeWindow_data();
     void tst_resizeWindow();
     void tst_resizeWindow2();
     void tst_rectForDropCrash();
+    void tst_dropRectCache();
 
     void tst_tabBarWithHiddenTitleBar_data();
     void tst_tabBarWithHiddenTitleBar();
     void tst_toggleDockWidgetWithHiddenTitleBar();
+    void tst_lazyTitleBar();
     void tst_dragByTabBar_data();
     void tst_dragByTabBar();
     void tst_dragBySingleTab();
+    void tst_ghostTabDrag();
+    void tst_ghostTabDragOntoItself();
+    void tst_deleteDraggedWindowWithPendingMove();
+    void tst_simulatedDrag();
 
     void tst_addToHiddenMainWindow();
     void tst_minSizeChanges();
@@ -360,12 +474,15 @@ private Q_SLOTS:
     void tst_staticAnchorThickness();
     void tst_honourGeometryOfHiddenWindow();
     void tst_registry();
+    void tst_findDockWidgets();
+    void tst_memoryReport();
     void tst_dockNotFillingSpace();
     void tst_floatingLastPosAfterDoubleClose();
     void tst_addingOptionHiddenTabbed();
     void tst_flagDoubleClick();
     void tst_floatingWindowDeleted();
     void tst_raise();
+    void tst_raiseCoalesced();
     void tst_floatingAction();
 
 private:
@@ -458,6 +575,538 @@ void TestDocks::tst_createFloatingWindow()
     QVERIFY(!window);
 }
 
+void TestDocks::tst_registryLookups()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None, "tst_registryLookups");
+    auto guest1 = new QPushButton("1");
+    auto dock1 = createDockWidget("1", guest1);
+    auto dock2 = new DockWidget(QStringLiteral("2"));
+    dock2->setWidgetCreator([] (DockWidgetBase *dw) -> QWidget* {
+        return new QPushButton(dw->uniqueName());
+    });
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    DockRegistry *dr = DockRegistry::self();
+    QCOMPARE(dr->dockByName(QStringLiteral("1")), dock1);
+    QCOMPARE(dr->dockByName(QStringLiteral("2")), dock2);
+    QVERIFY(!dr->dockByName(QStringLiteral("3")));
+    QCOMPARE(dr->mainWindowByName(QStringLiteral("tst_registryLookups")), m.get());
+    QVERIFY(!dr->mainWindowByName(QStringLiteral("other")));
+    QCOMPARE(dr->dockWidgetForGuest(guest1), dock1);
+    QVERIFY(!dr->dockWidgetForGuest(m.get()));
+
+    // Guests created later are indexed too
+    QVERIFY(!dock2->widget());
+    m->addDockWidget(dock2, Location_OnRight);
+    QVERIFY(dock2->widget());
+    QCOMPARE(dr->dockWidgetForGuest(dock2->widget()), dock2);
+
+    // With duplicate names the first one wins, until it's deleted
+    DockWidgetBase *duplicate = nullptr;
+    {
+        SetExpectedWarning expectedWarning("already exists");
+        duplicate = createDockWidget("1", new QPushButton("duplicate"), {}, /*show=*/false);
+    }
+    QCOMPARE(dr->dockByName(QStringLiteral("1")), dock1);
+    delete dock1;
+    QCOMPARE(dr->dockByName(QStringLiteral("1")), duplicate);
+    QVERIFY(!dr->dockWidgetForGuest(guest1));
+
+    delete duplicate;
+    QVERIFY(!dr->dockByName(QStringLiteral("1")));
+    delete dock2;
+}
+
+void TestDocks::tst_topLevels()
+{
+    EnsureTopLevelsDeleted e;
+
+    auto m = createMainWindow();
+    auto fw = createFloatingWindow();
+    auto registry = DockRegistry::self();
+
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ fw, m.get() }));
+    QCOMPARE(registry->topLevels(/*excludeFloatingDocks=*/true), QVector<QWidget*>({ m.get() }));
+
+    // The cached list follows visibility changes
+    fw->hide();
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ m.get() }));
+    fw->show();
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ fw, m.get() }));
+
+    m->hide();
+    QCOMPARE(registry->topLevels(), QVector<QWidget*>({ fw }));
+    QVERIFY(registry->topLevels(true).isEmpty());
+
+    delete fw;
+    QVERIFY(registry->topLevels().isEmpty());
+}
+
+void TestDocks::tst_floatingWindowPool()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFloatingWindowPoolSize(1);
+
+    auto m = createMainWindow();
+    auto dock = createDockWidget("doc1", Qt::green);
+    QPointer<FloatingWindow> window = dock->floatingWindow();
+    QVERIFY(window);
+
+    // Docking empties the floating window, which goes into the pool instead of being deleted
+    window->setGeometry(QRect(QPoint(200, 200), QSize(500, 400)));
+    m->addDockWidget(dock, Location_OnLeft);
+    QVERIFY(!dock->isFloating());
+    QTRY_VERIFY(!window->isVisible());
+    QVERIFY(window);
+    QVERIFY(!DockRegistry::self()->isPendingDelete(window));
+    QVERIFY(!DockRegistry::self()->nestedwindows().contains(window));
+
+    // Floating again reuses it
+    dock->setFloating(true);
+    QCOMPARE(dock->floatingWindow(), window.data());
+    QVERIFY(window->isVisible());
+    QVERIFY(DockRegistry::self()->nestedwindows().contains(window));
+    QVERIFY(!window->beingDeleted());
+
+    // A recycled window doesn't keep the previous user's geometry or title
+    m->addDockWidget(dock, Location_OnLeft);
+    QTRY_VERIFY(!window->isVisible());
+    QCOMPARE(FloatingWindow::takeRecycled(m.get()), window.data());
+    QVERIFY(!window->testAttribute(Qt::WA_Moved));
+    QVERIFY(!window->testAttribute(Qt::WA_Resized));
+    QVERIFY(window->titleBar()->title().isEmpty());
+    QVERIFY(window->windowTitle().isEmpty());
+    delete window;
+
+    // Pooled windows without a parent are deleted together with the registry
+    delete dock;
+    m.reset();
+    auto dock2 = createDockWidget("doc2", Qt::green);
+    window = dock2->floatingWindow();
+    QVERIFY(window);
+    QVERIFY(!window->parentWidget());
+    dock2->close();
+    QTRY_VERIFY(!window->isVisible());
+    QVERIFY(window);
+    delete dock2;
+    QVERIFY(!window);
+}
+
+void TestDocks::tst_warmUpWindows()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_WarmUpWindows);
+    QCOMPARE(Config::self().floatingWindowPoolSize(), 0);
+
+    // Once shown and idle, the main window gets a hidden floating window with its native window already created
+    auto m = createMainWindow();
+    QTRY_COMPARE(m->findChildren<FloatingWindow *>().size(), 1);
+    QPointer<FloatingWindow> warmedUp = m->findChildren<FloatingWindow *>().constFirst();
+    QVERIFY(!warmedUp->isVisible());
+    QVERIFY(warmedUp->testAttribute(Qt::WA_WState_Created));
+    QVERIFY(!DockRegistry::self()->nestedwindows().contains(warmedUp));
+
+    // Showing it again doesn't warm up a second one
+    m->hide();
+    m->show();
+    QCOMPARE(m->findChildren<FloatingWindow *>().size(), 1);
+
+    // The first tear-off uses it
+    auto dock = createDockWidget("dock1", new QPushButton("one"), {}, /*show=*/false);
+    m->addDockWidget(dock, Location_OnLeft);
+    dock->setFloating(true);
+    QCOMPARE(dock->floatingWindow(), warmedUp.data());
+    QVERIFY(warmedUp->isVisible());
+}
+
+void TestDocks::tst_appEventFilter()
+{
+    // Tests that the qApp event filter follows the settings that need QEvent::Quit
+    EnsureTopLevelsDeleted e;
+    const Config::Flags originalFlags = Config::self().flags();
+    DockRegistry *registry = DockRegistry::self();
+    QVERIFY(!registry->hasAppEventFilter());
+
+    Config::self().setFloatingWindowPoolSize(2);
+    QVERIFY(registry->hasAppEventFilter());
+    Config::self().setFloatingWindowPoolSize(0);
+    QVERIFY(!registry->hasAppEventFilter());
+
+    Config::self().setFlags(originalFlags | Config::Flag_WarmUpWindows);
+    QVERIFY(registry->hasAppEventFilter());
+    Config::self().setFlags(originalFlags);
+    QVERIFY(!registry->hasAppEventFilter());
+
+    // The main window keeps the registry alive once the dock widget is gone
+    auto m = createMainWindow();
+    QCOMPARE(DockRegistry::self(), registry);
+    auto dock = createDockWidget("dock1", new QPushButton("one"), DockWidgetBase::Option_NotClosable, /*show=*/false);
+    QVERIFY(registry->hasAppEventFilter());
+    delete dock;
+    QVERIFY(!registry->hasAppEventFilter());
+}
+
+void TestDocks::tst_stats()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    Stats::reset();
+
+    auto dock1 = createDockWidget("1", new QPushButton("1"), {}, /*show=*/false);
+    auto dock2 = createDockWidget("2", new QPushButton("2"), {}, /*show=*/false);
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    const Stats stats = Stats::snapshot();
+    if (Stats::isEnabled()) {
+        QVERIFY(stats.anchorSetPositionCalls > 0);
+        QVERIFY(stats.itemSetGeometryCalls > 0);
+        QVERIFY(stats.frameGeometryPushes > 0);
+
+        Stats::reset();
+        QCOMPARE(Stats::snapshot().itemSetGeometryCalls, quint64(0));
+    } else {
+        QCOMPARE(stats.anchorSetPositionCalls, quint64(0));
+        QCOMPARE(stats.itemSetGeometryCalls, quint64(0));
+    }
+}
+
+void TestDocks::tst_titleBarChromeCache()
+{
+    EnsureTopLevelsDeleted e;
+    if (!Stats::isEnabled())
+        QSKIP("Needs OPTION_STATS");
+
+    auto dock = createDockWidget("1", new QPushButton("1"));
+    auto fw = qobject_cast<FloatingWindow *>(dock->window());
+    QVERIFY(fw);
+    TitleBar *titleBar = fw->titleBar();
+
+    titleBar->grab();
+    Stats::reset();
+
+    // Repainting the same title doesn't redraw it with QStyle
+    titleBar->grab();
+    QCOMPARE(Stats::snapshot().titleBarChromeRenders, quint64(0));
+
+    dock->setTitle(QStringLiteral("other"));
+    titleBar->grab();
+    QCOMPARE(Stats::snapshot().titleBarChromeRenders, quint64(1));
+
+    delete fw;
+}
+
+void TestDocks::tst_eventLog()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    const int capacity = 8;
+    EventLog::start(capacity);
+    QVERIFY(EventLog::isRecording());
+    QCOMPARE(EventLog::eventCount(), 0);
+
+    auto dock1 = createDockWidget("1", new QPushButton("1"), {}, /*show=*/false);
+    auto dock2 = createDockWidget("2", new QPushButton("2"), {}, /*show=*/false);
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->multiSplitterLayout()->setSize(m->multiSplitterLayout()->size() + QSize(100, 0));
+    EventLog::stop();
+    QVERIFY(!EventLog::isRecording());
+
+    // The ring wrapped around, only the newest events are kept
+    QCOMPARE(EventLog::eventCount(), capacity);
+
+    QTemporaryDir dir;
+    const QString filename = dir.filePath(QStringLiteral("events.bin"));
+    QVERIFY(EventLog::dump(filename));
+    QFile file(filename);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    QVERIFY(data.startsWith("KDDWELOG"));
+
+    // The event count precedes the events, which are 32 bytes each
+    const int eventsSize = capacity * 32;
+    QVERIFY(data.size() > eventsSize + 4);
+    quint32 count = 0;
+    memcpy(&count, data.constData() + data.size() - eventsSize - 4, sizeof(count));
+    QCOMPARE(count, quint32(capacity));
+}
+
+void TestDocks::tst_frameGeometryBatch()
+{
+    // Resizing the layout moves every anchor, but each frame should only be resized once
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"), {}, /*show=*/false);
+    auto dock2 = createDockWidget("2", new QPushButton("2"), {}, /*show=*/false);
+    auto dock3 = createDockWidget("3", new QPushButton("3"), {}, /*show=*/false);
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnRight);
+
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    Stats::reset();
+    layout->setSize(layout->size() + QSize(300, 0));
+    QVERIFY(!layout->isBatchingFrameGeometry());
+
+    if (Stats::isEnabled())
+        QVERIFY(Stats::snapshot().frameGeometryPushes <= quint64(layout->count()));
+
+    // The frames ended up with the final geometry of their items
+    for (Item *item : layout->items())
+        QCOMPARE(item->frame()->geometry(), item->geometry());
+
+    // Each anchor notifies its position once per batch, however often it moved
+    Anchor *anchor = layout->itemForFrame(dock1->frame())->anchorGroup().right;
+    QVERIFY(!anchor->isStatic());
+    const int originalPosition = anchor->position();
+    QSignalSpy spy(anchor, &Anchor::positionChanged);
+    for (int delta : { 10, -10 }) {
+        spy.clear();
+        {
+            MultiSplitterLayout::FrameGeometryBatch batch(layout);
+            anchor->setPosition(anchor->position() + delta / 2);
+            anchor->setPosition(anchor->position() + delta / 2);
+            QCOMPARE(spy.count(), 0);
+        }
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.at(0).at(0).toInt(), anchor->position());
+    }
+    QCOMPARE(anchor->position(), originalPosition);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_restoreFrameGeometryOnce()
+{
+    // Restoring a layout shouldn't resize the frames progressively, only to their final geometry
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    m->resize(m->size() + QSize(200, 100));
+
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    Stats::reset();
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(!layout->isBatchingFrameGeometry());
+
+    for (Item *item : layout->items())
+        QCOMPARE(item->frame()->geometry(), item->geometry());
+    QVERIFY(layout->checkSanity());
+
+    if (!Stats::isEnabled())
+        QSKIP("Counting the geometry pushes needs OPTION_STATS");
+
+    QVERIFY(Stats::snapshot().frameGeometryPushes <= quint64(layout->count()));
+}
+
+void TestDocks::tst_bulkClear()
+{
+    // Clearing shouldn't re-propagate the layout after each dock widget closes
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    auto dock4 = createDockWidget("4", new QPushButton("4"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom);
+    QPointer<FloatingWindow> fw = dock4->morphIntoFloatingWindow();
+
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    QSignalSpy countSpy(layout, &MultiSplitterLayout::widgetCountChanged);
+    QSignalSpy removedSpy(layout, &MultiSplitterLayout::widgetRemoved);
+
+    DockRegistry::self()->clear();
+    QVERIFY(!layout->isBeingCleared());
+    QCOMPARE(layout->count(), 0);
+    QCOMPARE(countSpy.count(), 1);
+    QCOMPARE(removedSpy.count(), 0);
+    QVERIFY(layout->checkSanity());
+
+    Testing::waitForDeleted(fw);
+    QVERIFY(!fw);
+
+    QVERIFY(!dock1->isVisible());
+    QVERIFY(!dock4->isVisible());
+    delete dock1;
+    delete dock2;
+    delete dock3;
+    delete dock4;
+}
+
+void TestDocks::tst_scheduleDelete()
+{
+    // Closing a floating window's dock widgets deletes the window and its frames in one pass
+    EnsureTopLevelsDeleted e;
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    QPointer<FloatingWindow> fw = dock1->morphIntoFloatingWindow();
+    nestDockWidget(dock2, fw->dropArea(), nullptr, KDDockWidgets::Location_OnTop);
+    QPointer<Frame> frame1 = dock1->frame();
+    QPointer<Frame> frame2 = dock2->frame();
+    QVERIFY(frame1 && frame2 && frame1 != frame2);
+
+    dock1->close();
+    dock2->close();
+    QVERIFY(frame1->beingDeletedLater());
+    QVERIFY(DockRegistry::self()->isPendingDelete(frame1));
+    QVERIFY(DockRegistry::self()->isPendingDelete(frame2));
+
+    Testing::waitForDeleted(fw);
+    QVERIFY(!fw);
+    QVERIFY(!frame1);
+    QVERIFY(!frame2);
+
+    delete dock1;
+    delete dock2;
+}
+
+void TestDocks::tst_layoutMinimumSize()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    Frame *frame = dock1->frame();
+    Item *item = frame->layoutItem();
+    const QSize queriedMinSize = frame->minSize();
+    QCOMPARE(item->minimumSize(), queriedMinSize);
+
+    // A declared min size replaces the query, and the layout picks it up
+    QSignalSpy spy(item, &Item::minimumSizeChanged);
+    const QSize declaredMinSize = queriedMinSize + QSize(50, 30);
+    dock1->setLayoutMinimumSize(declaredMinSize);
+    QCOMPARE(frame->minSize(), declaredMinSize);
+    QVERIFY(spy.wait());
+    QCOMPARE(item->minimumSize(), declaredMinSize);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    dock1->setLayoutMinimumSize(QSize());
+    QCOMPARE(frame->minSize(), queriedMinSize);
+    QVERIFY(spy.wait());
+    QCOMPARE(item->minimumSize(), queriedMinSize);
+}
+
+void TestDocks::tst_coalesceLayoutInvalidated()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    Frame *frame = dock1->frame();
+    Testing::processPendingEvents(); // Let what's pending from the insertion settle
+
+    // A burst of tab insertions only notifies the layout once
+    QSignalSpy spy(frame, &Frame::layoutInvalidated);
+    for (int i = 2; i <= 11; ++i)
+        dock1->addDockWidgetAsTab(createDockWidget(QString::number(i), new QPushButton(QString::number(i)), {}, /*show=*/false));
+    QCOMPARE(spy.count(), 0);
+    QTRY_COMPARE(spy.count(), 1);
+    Testing::processPendingEvents();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(frame->dockWidgetCount(), 11);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+}
+
+void TestDocks::tst_tabOverflowMenu()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::Flag_TabOverflowMenu);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    auto tabWidget = static_cast<QTabWidget *>(dock1->frame()->tabWidget()->asWidget());
+    QVERIFY(!tabWidget->cornerWidget(Qt::TopRightCorner)); // No overflow with a single tab, not even created
+
+    for (int i = 2; i <= 5; ++i)
+        dock1->addDockWidgetAsTab(createDockWidget(QString::number(i), new QPushButton(QString::number(i))));
+    auto button = qobject_cast<QToolButton *>(tabWidget->cornerWidget(Qt::TopRightCorner));
+    QVERIFY(button);
+    QVERIFY(!button->isHidden());
+    QVERIFY(tabWidget->usesScrollButtons());
+
+    // The menu lists every tab and switches to the chosen one
+    QMenu *menu = button->menu();
+    QVERIFY(menu->actions().isEmpty()); // Populated lazily
+    Q_EMIT menu->aboutToShow();
+    QCOMPARE(menu->actions().size(), 5);
+    menu->actions().at(1)->trigger();
+    QCOMPARE(tabWidget->currentIndex(), 1);
+}
+
+void TestDocks::tst_reorderTabs()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::Flag_AllowReorderTabs);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    dock1->addDockWidgetAsTab(dock2);
+    dock1->addDockWidgetAsTab(dock3);
+    dock1->setAsCurrentTab();
+
+    Frame *frame = dock1->frame();
+    auto tabWidget = static_cast<QTabWidget *>(frame->tabWidget()->asWidget());
+    QSignalSpy tabMovedSpy(frame, &Frame::tabMoved);
+    int visibilityChanges = 0;
+    for (DockWidgetBase *dw : { dock1, dock2, dock3 }) {
+        connect(dw, &DockWidgetBase::shown, dw, [&visibilityChanges] { visibilityChanges++; });
+        connect(dw, &DockWidgetBase::hidden, dw, [&visibilityChanges] { visibilityChanges++; });
+    }
+
+    // Moving the current tab doesn't hide it, nor shows a neighbour
+    tabWidget->tabBar()->moveTab(0, 2);
+    QCOMPARE(tabMovedSpy.count(), 1);
+    QCOMPARE(visibilityChanges, 0);
+    QCOMPARE(frame->dockWidgets(), QVector<DockWidgetBase *>({ dock2, dock3, dock1 }));
+    QCOMPARE(tabWidget->currentWidget(), dock1);
+    QVERIFY(dock1->isVisible());
+    QVERIFY(!dock2->isVisible());
+
+    // And back, then a tab which isn't current
+    tabWidget->tabBar()->moveTab(2, 0);
+    tabWidget->tabBar()->moveTab(1, 2);
+    QCOMPARE(tabMovedSpy.count(), 3);
+    QCOMPARE(visibilityChanges, 0);
+    QCOMPARE(frame->dockWidgets(), QVector<DockWidgetBase *>({ dock1, dock3, dock2 }));
+    QCOMPARE(tabWidget->currentWidget(), dock1);
+}
+
+void TestDocks::tst_windowResizeThrottle()
+{
+    EnsureTopLevelsDeleted e;
+    Config::self().setWindowResizeThrottleInterval(10000);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    DropArea *dropArea = m->dropArea();
+    MultiSplitterLayout *layout = dropArea->multiSplitterLayout();
+
+    // Two resizes in a row, the second one is within the interval and is coalesced
+    dropArea->resize(dropArea->size() + QSize(50, 0));
+    dropArea->resize(dropArea->size() + QSize(50, 0));
+    QVERIFY(layout->size() != dropArea->size());
+
+    // Ending the resize applies the latest size
+    dropArea->applyPendingResize();
+    QCOMPARE(layout->size(), dropArea->size());
+    QVERIFY(layout->checkSanity());
+}
+
 void TestDocks::nestDockWidget(DockWidgetBase *dock, DropArea *dropArea, Frame *relativeTo, KDDockWidgets::Location location)
 {
     auto frame = Config::self().frameworkWidgetFactory()->createFrame();
@@ -820,6 +1469,42 @@ void TestDocks::tst_dockFloatingWindowNested()
     // TODO
 }
 
+void TestDocks::tst_itemAt()
+{
+    // Tests that MultiSplitterLayout::itemAt()'s grid follows the layout
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom);
+    auto layout = m->multiSplitterLayout();
+
+    Item *item1 = layout->itemForFrame(dock1->frame());
+    Item *item2 = layout->itemForFrame(dock2->frame());
+    Item *item3 = layout->itemForFrame(dock3->frame());
+    QCOMPARE(layout->itemAt(item1->geometry().center()), item1);
+    QCOMPARE(layout->itemAt(item2->geometry().center()), item2);
+    QCOMPARE(layout->itemAt(item3->geometry().center()), item3);
+    QVERIFY(!layout->itemAt(QPoint(-10, -10)));
+    QVERIFY(!layout->itemAt(QPoint(layout->width() + 10, 10)));
+
+    // Moving a separator moves the items' cells
+    Anchor *anchor = item1->anchorGroup().right;
+    const QPoint pos(anchor->position() + anchor->thickness() + 5, item1->geometry().center().y());
+    QCOMPARE(layout->itemAt(pos), item2);
+    anchor->setPosition(anchor->position() + 50);
+    QCOMPARE(layout->itemAt(pos), item1);
+
+    // Placeholders aren't found
+    const QPoint pos2 = item2->geometry().center();
+    dock2->close();
+    QVERIFY(item2->isPlaceholder());
+    QVERIFY(layout->itemAt(pos2) != item2);
+}
+
 void TestDocks::tst_anchorsFromTo()
 {
     EnsureTopLevelsDeleted e;
@@ -933,11 +1618,115 @@ void TestDocks::tst_dockWindowWithTwoSideBySideFramesIntoCenter()
     delete fw2;
 }
 
-void TestDocks::tst_dockWindowWithTwoSideBySideFramesIntoLeft()
+void TestDocks::tst_animationClock()
 {
+    // Tests that AnimatedIndicators' rubber bands are animated by a single AnimationClock
     EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    AnimatedIndicators indicators(m->dropArea());
+    AnimationClock *clock = indicators.animationClock();
+
+    AnimatedRubberBand::List bands;
+    for (AnimatedRubberBand *band : indicators.findChildren<AnimatedRubberBand *>()) {
+        if (band->dropLocation == DropIndicatorOverlayInterface::DropLocation_Center ||
+            band->dropLocation == DropIndicatorOverlayInterface::DropLocation_OutterLeft)
+            bands.push_back(band);
+    }
+    QCOMPARE(bands.size(), 2);
+    AnimatedRubberBand *center = bands.at(0)->dropLocation == DropIndicatorOverlayInterface::DropLocation_Center
+                                 ? bands.at(0) : bands.at(1);
+    AnimatedRubberBand *outter = center == bands.at(0) ? bands.at(1) : bands.at(0);
+    QSignalSpy centerSpy(center, &AnimatedRubberBand::animationFinished);
+    QSignalSpy outterSpy(outter, &AnimatedRubberBand::animationFinished);
+
+    // Starting again replaces the running animation, which only finishes once, at the latest end value
+    clock->start(center, QSize(100, 100));
+    clock->start(center, QSize(50, 50));
+    clock->start(outter, 40);
+    QVERIFY(clock->isAnimating(center));
+    QVERIFY(clock->isAnimating(outter));
+    QTRY_VERIFY(!clock->isAnimating(center) && !clock->isAnimating(outter));
+    QCOMPARE(centerSpy.count(), 1);
+    QCOMPARE(outterSpy.count(), 1);
+    QCOMPARE(center->length().toSize(), QSize(50, 50));
+    QCOMPARE(outter->length().toInt(), 40);
+
+    // finish() jumps to the end, and still notifies
+    clock->start(center, QSize(80, 80));
+    clock->finish(center);
+    QVERIFY(!clock->isAnimating(center));
+    QCOMPARE(centerSpy.count(), 2);
+    QCOMPARE(center->length().toSize(), QSize(80, 80));
 
-    auto fw = createFloatingWindow();
+    {
+        SetExpectedWarning expectedWarning("Invalid value");
+        clock->setMaxFps(0);
+    }
+    QCOMPARE(clock->maxFps(), 60);
+}
+
+void TestDocks::tst_overlayIndicators()
+{
+    EnsureTopLevelsDeleted e;
+    DefaultWidgetFactory::s_dropIndicatorType = DefaultWidgetFactory::DropIndicatorType::Overlay;
+
+    auto fw = createFloatingWindow();
+    auto fw2 = createFloatingWindow();
+    fw2->move(fw->x() + fw->width() + 100, fw->y());
+    QCOMPARE(fw2->dropArea()->dropIndicatorOverlay()->indicatorType(), DropIndicatorOverlayInterface::TypeOverlay);
+
+    dragFloatingWindowTo(fw, fw2->dropArea(), DropIndicatorOverlayInterface::DropLocation_Left);
+    QCOMPARE(fw2->frames().size(), 2);
+    QVERIFY(fw2->dropArea()->checkSanity());
+
+    QVERIFY(Testing::waitForDeleted(fw));
+    delete fw2;
+}
+
+void TestDocks::tst_separatorOverlay()
+{
+    EnsureTopLevelsDeleted e; // Restores the flags
+    Config::self().setFlags(Config::self().flags() | Config::Flag_SeparatorOverlay);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    QVERIFY(layout->checkSanity());
+
+    Anchor *anchor = layout->anchors().last();
+    QVERIFY(!anchor->isStatic());
+    auto separator = qobject_cast<OverlaidSeparatorWidget *>(anchor->separatorWidget());
+    QVERIFY(separator);
+    QVERIFY(!separator->isVisible()); // The native widget is never shown
+    QVERIFY(separator->isShown());
+
+    auto overlay = SeparatorOverlay::overlayFor(separator->parentWidget());
+    QCOMPARE(overlay->geometry(), separator->parentWidget()->rect());
+    const QPoint pressPos = separator->geometry().center();
+    QCOMPARE(overlay->separatorAt(pressPos), separator);
+    QVERIFY(!overlay->separatorAt(dock1->frame()->geometry().center()));
+
+    // Dragging on the overlay moves the separator
+    const int oldPosition = anchor->position();
+    const QPoint movePos = pressPos + QPoint(50, 0);
+    QMouseEvent press(QEvent::MouseButtonPress, pressPos, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QMouseEvent move(QEvent::MouseMove, movePos, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+    QMouseEvent release(QEvent::MouseButtonRelease, movePos, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+    qApp->sendEvent(overlay, &press);
+    qApp->sendEvent(overlay, &move);
+    qApp->sendEvent(overlay, &release);
+    QVERIFY(anchor->position() > oldPosition);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_dockWindowWithTwoSideBySideFramesIntoLeft()
+{
+    EnsureTopLevelsDeleted e;
+
+    auto fw = createFloatingWindow();
     fw->setObjectName("fw1");
     auto dock2 = createDockWidget("doc2", Qt::red);
     nestDockWidget(dock2, fw->dropArea(), nullptr, KDDockWidgets::Location_OnLeft);
@@ -1313,17 +2102,1337 @@ void TestDocks::tst_restoreSimple()
     QVERIFY(dock2->isFloating());
     QVERIFY(dock2->isVisible());
 
-    QVERIFY(!dock3->isVisible()); // Remains closed
-    QVERIFY(dock3->parentWidget() == nullptr);
+    QVERIFY(!dock3->isVisible()); // Remains closed
+    QVERIFY(dock3->parentWidget() == nullptr);
+
+    dock3->show();
+    dock3->morphIntoFloatingWindow(); // as it would take 1 event loop. Do it now so we can compare already.
+
+    QCOMPARE(dock3->window()->pos(), dock3FloatingPoint);
+
+    // Cleanup
+    dock3->deleteLater();
+    QVERIFY(Testing::waitForDeleted(dock3));
+}
+
+void TestDocks::tst_restoreFromDirectory()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString key = LayoutSaver::screenConfigurationKey();
+    QVERIFY(!key.isEmpty());
+    QCOMPARE(key, LayoutSaver::screenConfigurationKey());
+
+    LayoutSaver saver;
+    QVERIFY(saver.saveToDirectory(dir.path()));
+    const QString exactMatch = QDir(dir.path()).filePath(key + QStringLiteral(".layout"));
+    QVERIFY(QFile::exists(exactMatch));
+
+    dock2->close();
+    QVERIFY(saver.restoreFromDirectory(dir.path()));
+    QVERIFY(dock2->isVisible());
+
+    // An unknown screen configuration restores the layout saved last
+    QVERIFY(QFile::rename(exactMatch, QDir(dir.path()).filePath(QStringLiteral("other.layout"))));
+    dock2->close();
+    QVERIFY(saver.restoreFromDirectory(dir.path()));
+    QVERIFY(dock2->isVisible());
+}
+
+void TestDocks::tst_restoreFromMappedFile()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString filename = QDir(dir.path()).filePath(QStringLiteral("layout.bin"));
+    auto writeFile = [&filename] (const QByteArray &data) {
+        QFile f(filename);
+        return f.open(QIODevice::WriteOnly | QIODevice::Truncate) && f.write(data) == data.size();
+    };
+
+    LayoutSaver saver;
+    for (SerializationFormat format : { SerializationFormat_Json, SerializationFormat_Binary, SerializationFormat_CompressedBinary }) {
+        QVERIFY(writeFile(saver.serializeLayout(format)));
+        dock2->close();
+        QVERIFY(saver.restoreFromFile(filename));
+        QVERIFY(dock2->isVisible());
+        QCOMPARE(dock2->window(), m.get());
+        m->multiSplitterLayout()->checkSanity();
+    }
+
+    // The parser stops at the end of the mapping, it doesn't rely on a null terminator
+    const QByteArray json = saver.serializeLayout();
+    QVERIFY(writeFile(json.left(json.size() / 2)));
+    {
+        SetExpectedWarning expectedWarning("Failed to parse");
+        QVERIFY(!saver.restoreFromFile(filename));
+    }
+
+    // Empty files can't be mapped, and go through QFile::readAll()
+    QVERIFY(writeFile(QByteArray()));
+    {
+        SetExpectedWarning expectedWarning("Failed to parse");
+        QVERIFY(!saver.restoreFromFile(filename));
+    }
+
+    // The mapping was released, so the file can be replaced
+    QVERIFY(QFile::remove(filename));
+    QVERIFY(writeFile(json));
+    QVERIFY(saver.restoreFromFile(filename));
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+}
+
+void TestDocks::tst_asyncSaveLayout()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+
+    AsyncLayoutSaver asyncSaver;
+    QSignalSpy spy(&asyncSaver, &AsyncLayoutSaver::saved);
+    QVERIFY(!asyncSaver.isSaving());
+
+    // The 2nd and 3rd requests arrive while the 1st is in flight, so they're coalesced
+    asyncSaver.saveToFile(QStringLiteral("layout.json"));
+    asyncSaver.saveToFile(QStringLiteral("layout.json"));
+    asyncSaver.saveToFile(QStringLiteral("layout.json"));
+    QVERIFY(asyncSaver.isSaving());
+    asyncSaver.waitForFinished();
+    QVERIFY(!asyncSaver.isSaving());
+    QCOMPARE(spy.count(), 2);
+    QVERIFY(spy.at(0).at(1).toBool());
+    QVERIFY(spy.at(1).at(1).toBool());
+
+    // Nothing changed, so it must match a synchronous save
+    QFile f(QStringLiteral("layout.json"));
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    LayoutSaver saver;
+    QCOMPARE(f.readAll(), saver.serializeLayout());
+    f.close();
+
+    // The queued notifications for the writes waitForFinished() already handled are ignored
+    QTest::qWait(100);
+    QCOMPARE(spy.count(), 2);
+
+    QVERIFY(saver.restoreFromFile(QStringLiteral("layout.json")));
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+}
+
+void TestDocks::tst_asyncRestoreLayout()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+    // dock3 stays floating
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    const QRect dock3Geo = dock3->window()->geometry();
+
+    dock1->close();
+    dock2->setFloating(true);
+    dock3->close();
+
+    AsyncLayoutRestorer restorer;
+    restorer.setTimeSlice(0); // One step per slice
+    restorer.setHideWindowsUntilFinished(true);
+    QSignalSpy progressSpy(&restorer, &AsyncLayoutRestorer::progress);
+    QSignalSpy finishedSpy(&restorer, &AsyncLayoutRestorer::finished);
+
+    QVERIFY(restorer.restoreLayout(saved));
+    QVERIFY(restorer.isRestoring());
+    QVERIFY(LayoutSaver::restoreInProgress());
+    QVERIFY(!m->isVisible()); // Until it's finished
+
+    {
+        SetExpectedWarning sew("Another restore is in progress");
+        QVERIFY(!saver.restoreLayout(saved));
+    }
+
+    QVERIFY(finishedSpy.wait());
+    QVERIFY(finishedSpy.at(0).at(0).toBool());
+    QVERIFY(!restorer.isRestoring());
+    QVERIFY(!LayoutSaver::restoreInProgress());
+    QVERIFY(restorer.restoreReport().success);
+
+    // It was sliced, and the last progress is the total
+    QVERIFY(progressSpy.count() > 2);
+    const int stepCount = progressSpy.last().at(1).toInt();
+    QCOMPARE(progressSpy.last().at(0).toInt(), stepCount);
+
+    QVERIFY(m->isVisible());
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+    QCOMPARE(dock1->window(), m.get());
+    QCOMPARE(dock2->window(), m.get());
+    QVERIFY(dock3->isFloating());
+    QCOMPARE(dock3->window()->geometry(), dock3Geo);
+
+    // Cancelling leaves the partial layout, but the restore is over
+    QVERIFY(restorer.restoreLayout(saved));
+    restorer.cancel();
+    QCOMPARE(finishedSpy.count(), 2);
+    QVERIFY(!finishedSpy.at(1).at(0).toBool());
+    QVERIFY(!LayoutSaver::restoreInProgress());
+    QVERIFY(m->isVisible());
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(dock3->isFloating());
+
+    delete dock3->window();
+}
+
+void TestDocks::tst_restoreDuringAsyncRestore()
+{
+    // Tests that a restore refused because another one is running doesn't disturb either of them
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(saver.restoreReport().success);
+
+    dock1->close();
+    dock2->close();
+
+    AsyncLayoutRestorer restorer;
+    restorer.setTimeSlice(0); // One step per slice
+    QSignalSpy finishedSpy(&restorer, &AsyncLayoutRestorer::finished);
+
+    // After the main window's step, its dock widgets are already marked as restored
+    bool refused = false;
+    connect(&restorer, &AsyncLayoutRestorer::progress, this, [&] (int stepsDone) {
+        if (stepsDone != 1)
+            return;
+        SetExpectedWarning sew("Another restore is in progress");
+        refused = !saver.restoreLayout(saved);
+    });
+
+    QVERIFY(restorer.restoreLayout(saved));
+    QVERIFY(finishedSpy.wait());
+    QVERIFY(finishedSpy.at(0).at(0).toBool());
+    QVERIFY(refused);
+
+    QVERIFY(saver.restoreReport().success); // Still the report of its own restore
+    QVERIFY(restorer.restoreReport().success);
+    const QVector<DockWidgetBase *> restored = saver.restoredDockWidgets();
+    QVERIFY(restored.contains(dock1));
+    QVERIFY(restored.contains(dock2));
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+}
+
+void TestDocks::tst_layoutGeneration()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    QTest::qWait(100); // Let it settle
+
+    AsyncLayoutSaver asyncSaver;
+    QVERIFY(asyncSaver.saveToFileIfChanged(QStringLiteral("layout.json")));
+    asyncSaver.waitForFinished();
+    QCOMPARE(asyncSaver.savedLayoutGeneration(), LayoutSaver::layoutGeneration());
+
+    // Nothing changed
+    QVERIFY(!asyncSaver.saveToFileIfChanged(QStringLiteral("layout.json")));
+
+    // Moving a separator
+    quint64 generation = LayoutSaver::layoutGeneration();
+    Anchor *anchor = m->multiSplitterLayout()->itemForFrame(dock1->frame())->anchorGroup().right;
+    anchor->setPosition(anchor->position() + 10);
+    QVERIFY(LayoutSaver::layoutGeneration() > generation);
+    QVERIFY(asyncSaver.saveToFileIfChanged(QStringLiteral("layout.json")));
+    asyncSaver.waitForFinished();
+
+    // Closing a dock widget
+    generation = LayoutSaver::layoutGeneration();
+    dock2->close();
+    QVERIFY(LayoutSaver::layoutGeneration() > generation);
+
+    // Moving a floating window
+    generation = LayoutSaver::layoutGeneration();
+    dock3->window()->move(dock3->window()->pos() + QPoint(20, 20));
+    QTRY_VERIFY(LayoutSaver::layoutGeneration() > generation);
+}
+
+void TestDocks::tst_layoutStructuralHash()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    LayoutSaver saver;
+    auto hashes = [&saver] {
+        LayoutSaver::Layout layout;
+        if (!layout.fromJson(saver.serializeLayout()))
+            return qMakePair(quint64(0), quint64(0));
+        return qMakePair(layout.structuralHash(), layout.structuralHash(/*includeGeometry=*/true));
+    };
+
+    const auto initial = hashes();
+    QVERIFY(initial.first != initial.second);
+    QCOMPARE(hashes(), initial);
+
+    // Moving a separator only changes the geometry
+    Anchor *anchor = m->multiSplitterLayout()->itemForFrame(dock1->frame())->anchorGroup().right;
+    anchor->setPosition(anchor->position() + 10);
+    const auto moved = hashes();
+    QCOMPARE(moved.first, initial.first);
+    QVERIFY(moved.second != initial.second);
+
+    // Closing a dock widget changes the structure
+    dock2->close();
+    QVERIFY(hashes().first != initial.first);
+}
+
+void TestDocks::tst_restoreLazyClosedDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    dock2->close();
+    QCOMPARE(layout->placeholderCount(), 1);
+
+    LayoutSaver saver(RestoreOption_LazyClosedDockWidgets);
+    const QByteArray saved = saver.serializeLayout();
+    delete dock2;
+    QCOMPARE(layout->placeholderCount(), 0);
+
+    DockWidgetFactoryFunc func = [] (const QString &name) {
+        return createDockWidget(name, new QPushButton(name), {}, /*show=*/ false);
+    };
+    Config::self().setDockWidgetFactoryFunc(func);
+
+    // dock2 is closed, so it's not created
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(!DockRegistry::self()->dockByName(QStringLiteral("2")));
+    QCOMPARE(LayoutSaver::lazyDockWidgetNames(), QStringList() << QStringLiteral("2"));
+    QCOMPARE(layout->placeholderCount(), 1);
+    QVERIFY(layout->checkSanity());
+
+    // Saving again must not lose it
+    LayoutSaver::Layout savedLayout;
+    QVERIFY(savedLayout.fromJson(saver.serializeLayout()));
+    QCOMPARE(savedLayout.closedDockWidgets.size(), 1);
+    QCOMPARE(savedLayout.closedDockWidgets.at(0)->uniqueName, QStringLiteral("2"));
+
+    // Created on demand, and shown at its previous position
+    dock2 = LayoutSaver::dockWidgetByName(QStringLiteral("2"));
+    QVERIFY(dock2);
+    QVERIFY(!dock2->isVisible());
+    QVERIFY(LayoutSaver::lazyDockWidgetNames().isEmpty());
+    QCOMPARE(LayoutSaver::dockWidgetByName(QStringLiteral("2")), dock2);
+
+    dock2->show();
+    QVERIFY(!dock2->isFloating());
+    QCOMPARE(dock2->window(), m.get());
+    QCOMPARE(layout->placeholderCount(), 0);
+    QCOMPARE(layout->visibleCount(), 2);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_lazyWidgetCreation()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock1->addDockWidgetAsTab(dock2);
+    dock1->addDockWidgetAsTab(dock3);
+    QCOMPARE(dock1->frame()->currentDockWidget(), dock3);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    delete dock2;
+    delete dock3;
+
+    static int s_numCreated = 0;
+    s_numCreated = 0;
+    DockWidgetFactoryFunc func = [] (const QString &name) -> DockWidgetBase* {
+        auto dw = new DockWidget(name);
+        dw->setWidgetCreator([] (DockWidgetBase *dock) -> QWidget* {
+            s_numCreated++;
+            return new QPushButton(dock->uniqueName());
+        });
+        return dw;
+    };
+    Config::self().setDockWidgetFactoryFunc(func);
+
+    // Only the current tab needs its widget
+    QVERIFY(saver.restoreLayout(saved));
+    dock2 = DockRegistry::self()->dockByName(QStringLiteral("2"));
+    dock3 = DockRegistry::self()->dockByName(QStringLiteral("3"));
+    QVERIFY(dock2);
+    QVERIFY(dock3);
+    QCOMPARE(dock1->frame()->currentDockWidget(), dock3);
+    QCOMPARE(s_numCreated, 1);
+    QVERIFY(!dock2->widget());
+    QVERIFY(dock3->widget());
+
+    // Switching to it creates it
+    Frame *frame = dock1->frame();
+    frame->setCurrentTabIndex(frame->dockWidgets().indexOf(dock2));
+    QCOMPARE(s_numCreated, 2);
+    QVERIFY(dock2->widget());
+
+    // Already created, nothing happens
+    dock2->ensureWidgetCreated();
+    QCOMPARE(s_numCreated, 2);
+}
+
+void TestDocks::tst_hibernation()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    m->addDockWidget(dock1, Location_OnLeft);
+
+    static int s_numCreated = 0;
+    s_numCreated = 0;
+    auto dock2 = new DockWidget(QStringLiteral("2"));
+    dock2->setWidgetCreator([] (DockWidgetBase *dock) -> QWidget* {
+        s_numCreated++;
+        return new QPushButton(dock->uniqueName());
+    });
+    m->addDockWidget(dock2, Location_OnRight);
+    QCOMPARE(s_numCreated, 1);
+    QWidget *const firstGuest = dock2->widget();
+    QPointer<QWidget> guest = firstGuest;
+    QVERIFY(guest);
+
+    // Guests set with setWidget() can't be recreated, so they're never hibernated
+    dock1->close();
+    QVERIFY(!dock1->hibernate());
+    QVERIFY(dock1->widget());
+
+    // Open dock widgets aren't hibernated either
+    QVERIFY(!dock2->hibernate());
+
+    QWidget *hibernatedGuest = nullptr;
+    connect(dock2, &DockWidgetBase::aboutToHibernate, dock2, [&hibernatedGuest] (QWidget *w) {
+        hibernatedGuest = w;
+    });
+
+    dock2->setHibernationTimeout(50);
+    QCOMPARE(dock2->hibernationTimeout(), 50);
+    dock2->close();
+    QVERIFY(Testing::waitForDeleted(guest));
+    QCOMPARE(hibernatedGuest, firstGuest);
+    QVERIFY(!dock2->widget());
+
+    // Showing it again recreates the guest
+    dock2->show();
+    QCOMPARE(s_numCreated, 2);
+    QVERIFY(dock2->widget());
+    QCOMPARE(DockRegistry::self()->dockWidgetForGuest(dock2->widget()), dock2);
+
+    delete dock1;
+}
+
+void TestDocks::tst_persistentNativeContainer()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock = new DockWidget(QStringLiteral("1"), DockWidgetBase::Option_PersistentNativeContainer);
+    dock->setWidgetCreator([] (DockWidgetBase *dw) -> QWidget* {
+        return new QPushButton(dw->uniqueName());
+    });
+    m->addDockWidget(dock, Location_OnLeft);
+
+    // The guest lives in a host window owned by the dock widget
+    QWidget *guest = dock->widget();
+    QVERIFY(guest);
+    QPointer<QWidget> host = guest->window();
+    QVERIFY(host != m.get());
+    QCOMPARE(host->parentWidget(), dock);
+    QCOMPARE(dock->layout()->count(), 1);
+
+    // Floating doesn't change the guest's window
+    dock->setFloating(true);
+    QCOMPARE(guest->window(), host.data());
+
+    // A new guest replaces the old one in the host, the container is reused
+    dock->close();
+    QVERIFY(dock->hibernate());
+    dock->show();
+    QVERIFY(dock->widget());
+    QCOMPARE(dock->widget()->window(), host.data());
+    QCOMPARE(host->layout()->count(), 1);
+    QCOMPARE(dock->layout()->count(), 1);
+
+    dock->setFloating(false);
+    QCOMPARE(dock->window(), m.get());
+    QCOMPARE(dock->widget()->window(), host.data());
+    delete dock;
+    QVERIFY(!host);
+}
+
+void TestDocks::tst_sideBar()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    int numChanges = 0;
+    connect(m.get(), &MainWindowBase::sideBarChanged, m.get(), [&numChanges] { numChanges++; });
+
+    // Only dock widgets docked in this main window can be minimized
+    {
+        SetExpectedWarning sew("Dock widget isn't docked in this main window");
+        QVERIFY(!m->moveToSideBar(dock3));
+    }
+
+    QVERIFY(m->moveToSideBar(dock1));
+    QVERIFY(!dock1->isOpen());
+    QCOMPARE(m->sideBarDockWidgets(), QVector<DockWidgetBase*>{ dock1 });
+    QCOMPARE(layout->visibleCount(), 1);
+    QCOMPARE(numChanges, 1);
+    QVERIFY(layout->checkSanity());
+
+    // Goes back where it was
+    QVERIFY(m->restoreFromSideBar(dock1));
+    QVERIFY(dock1->isOpen());
+    QVERIFY(m->sideBarDockWidgets().isEmpty());
+    QCOMPARE(layout->visibleCount(), 2);
+    QVERIFY(dock1->frame()->x() < dock2->frame()->x());
+    QCOMPARE(numChanges, 2);
+
+    {
+        SetExpectedWarning sew("Dock widget isn't in the side bar");
+        QVERIFY(!m->restoreFromSideBar(dock1));
+    }
+
+    // Showing it through the toggle action also takes it out of the side bar
+    QVERIFY(m->moveToSideBar(dock2));
+    dock2->toggleAction()->trigger();
+    QVERIFY(dock2->isOpen());
+    QVERIFY(m->sideBarDockWidgets().isEmpty());
+    QCOMPARE(numChanges, 4);
+
+    // Deleted dock widgets leave the side bar
+    QVERIFY(m->moveToSideBar(dock2));
+    delete dock2;
+    QVERIFY(m->sideBarDockWidgets().isEmpty());
+    QVERIFY(layout->checkSanity());
+
+    delete dock3;
+}
+
+void TestDocks::tst_restoreRelativeToMainWindow()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 800), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+
+    // Enough dock widgets that Layout::scaleSizes() runs in parallel
+    DockWidgetBase::List docks;
+    for (int i = 0; i < 120; ++i) {
+        auto dw = createDockWidget(QStringLiteral("dock%1").arg(i), new QPushButton(), {}, /*show=*/false);
+        if (i < 2)
+            m->addDockWidget(dw, Location_OnRight);
+        else
+            docks.at(i % 2)->addDockWidgetAsTab(dw);
+        docks << dw;
+    }
+
+    const double ratio = double(docks.at(0)->frame()->width()) / layout->size().width();
+
+    LayoutSaver saver(RestoreOption_RelativeToMainWindow);
+    const QByteArray saved = saver.serializeLayout();
+
+    m->resize(QSize(600, 800));
+    QTest::qWait(200);
+    const QSize newSize = m->size();
+
+    QVERIFY(saver.restoreLayout(saved));
+    layout->checkSanity();
+    QCOMPARE(m->size(), newSize); // The main window geometry isn't restored
+    QCOMPARE(docks.at(0)->frame()->dockWidgetCount(), 60);
+
+    const double newRatio = double(docks.at(0)->frame()->width()) / layout->size().width();
+    QVERIFY(qAbs(ratio - newRatio) < 0.05);
+}
+
+void TestDocks::tst_restoreOnResizedScreen()
+{
+    EnsureTopLevelsDeleted e;
+
+    // Created before the main window, so its floating window has no parent to be relative to
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    QVERIFY(!dock1->window()->parentWidget());
+
+    const QRect screenGeo = QGuiApplication::primaryScreen()->geometry();
+    dock1->window()->setGeometry(QRect(screenGeo.topLeft() + QPoint(200, 150), QSize(400, 300)));
+
+    LayoutSaver saver(RestoreOption_RelativeToMainWindow);
+    LayoutSaver::Layout layout;
+    QVERIFY(layout.fromJson(saver.serializeLayout()));
+    QCOMPARE(layout.floatingWindows.size(), 1);
+    LayoutSaver::FloatingWindow &fw = layout.floatingWindows[0];
+    QCOMPARE(fw.parentIndex, -1);
+
+    // An unchanged screen leaves the floating window alone
+    const QRect savedGeo = fw.geometry;
+    const QSize savedLayoutSize = fw.multiSplitterLayout.size;
+    layout.scaleSizes();
+    QCOMPARE(fw.geometry, savedGeo);
+
+    // Pretend it was saved on a screen twice as big, and with another origin
+    auto it = std::find_if(layout.screenInfo.begin(), layout.screenInfo.end(), [&fw] (const LayoutSaver::ScreenInfo &info) {
+        return info.index == fw.screenIndex;
+    });
+    QVERIFY(it != layout.screenInfo.end());
+    const QRect currentScreenGeo = it->geometry;
+    const QPoint savedScreenOrigin = currentScreenGeo.topLeft() + QPoint(100, 50);
+    it->geometry = QRect(savedScreenOrigin, currentScreenGeo.size() * 2);
+
+    layout.scaleSizes();
+
+    const double widthFactor = double(currentScreenGeo.width()) / it->geometry.width();
+    const double heightFactor = double(currentScreenGeo.height()) / it->geometry.height();
+    const QRect relativeGeo = savedGeo.translated(-savedScreenOrigin);
+    const QRect expectedGeo(QPoint(qCeil(relativeGeo.x() * widthFactor), qCeil(relativeGeo.y() * heightFactor)) + currentScreenGeo.topLeft(),
+                            QSize(int(widthFactor * relativeGeo.width()), int(heightFactor * relativeGeo.height())));
+    QCOMPARE(fw.geometry, expectedGeo);
+    QCOMPARE(fw.multiSplitterLayout.size, QSize(int(widthFactor * savedLayoutSize.width()),
+                                                int(heightFactor * savedLayoutSize.height())));
+}
+
+void TestDocks::tst_restoreReport()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    Q_UNUSED(dock3); // Stays floating
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    QVERIFY(saver.restoreLayout(saved));
+
+    const LayoutSaver::RestoreReport &report = saver.restoreReport();
+    QVERIFY(report.success);
+    QCOMPARE(report.mainWindows.size(), 1);
+    QCOMPARE(report.mainWindows.at(0).name, m->uniqueName());
+    QCOMPARE(report.floatingWindows.size(), 1);
+    QCOMPARE(report.numFrames, 3);
+    QCOMPARE(report.numItems, 3);
+    QVERIFY(report.numAnchors > 0);
+    QVERIFY(report.totalUSecs >= report.parseUSecs + report.clearUSecs + report.placeholdersUSecs);
+
+    const QVariantMap map = report.toVariantMap();
+    QCOMPARE(map.value(QStringLiteral("numFrames")).toInt(), 3);
+    QCOMPARE(map.value(QStringLiteral("mainWindows")).toList().size(), 1);
+
+    // Failures are reported too
+    {
+        SetExpectedWarning expectedWarning("Failed to parse");
+        QVERIFY(!saver.restoreLayout("garbage"));
+    }
+    QVERIFY(!saver.restoreReport().success);
+    QVERIFY(saver.restoreReport().mainWindows.isEmpty());
+}
+
+void TestDocks::tst_restoreBinary()
+{
+    EnsureTopLevelsDeleted e;
+    // Tests that a layout saved in binary format restores like the JSON one
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+
+    const QPoint dock2FloatingPoint = QPoint(150, 150);
+    dock2->window()->move(dock2FloatingPoint);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout(SerializationFormat_Binary);
+    QVERIFY(LayoutSaver::Layout::isBinary(saved));
+    QVERIFY(!LayoutSaver::Layout::isBinary(saver.serializeLayout()));
+
+    auto f1 = dock1->frame();
+    dock1->close();
+    dock2->close();
+    QVERIFY(Testing::waitForDeleted(f1));
+    QCOMPARE(layout->placeholderCount(), 1);
+
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(layout->count(), 1);
+    QCOMPARE(layout->placeholderCount(), 0);
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isFloating());
+    QCOMPARE(dock2->window()->pos(), dock2FloatingPoint);
+    layout->checkSanity();
+
+    // Garbage after the magic marker is refused
+    const QByteArray corrupt = saved.left(int(qstrlen(LAYOUT_BINARY_MAGIC_MARKER)) + 2);
+    SetExpectedWarning expectedWarning("Failed to parse");
+    QVERIFY(!saver.restoreLayout(corrupt));
+}
+
+void TestDocks::tst_restoreCompressedAndDelta()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    dock2->window()->move(QPoint(150, 150));
+
+    LayoutSaver saver;
+    const QByteArray compressed = saver.serializeLayout(SerializationFormat_CompressedBinary);
+    QVERIFY(LayoutSaver::Layout::isCompressed(compressed));
+    QVERIFY(!LayoutSaver::Layout::isBinary(compressed));
+
+    // The base, and a similar layout where only the floating window moved
+    const QByteArray base = saver.serializeLayout();
+    const QPoint dock2FloatingPoint = QPoint(200, 200);
+    dock2->window()->move(dock2FloatingPoint);
+    const QByteArray delta = saver.serializeLayoutDelta(base);
+    QVERIFY(LayoutSaver::Layout::isDelta(delta));
+    QVERIFY(delta.size() < saver.serializeLayout(SerializationFormat_Binary).size());
+
+    const QByteArray resolved = LayoutSaver::resolveLayoutDelta(base, delta);
+    QVERIFY(LayoutSaver::Layout::isBinary(resolved));
+
+    auto f1 = dock1->frame();
+    dock1->close();
+    dock2->close();
+    QVERIFY(Testing::waitForDeleted(f1));
+
+    QVERIFY(saver.restoreLayout(compressed));
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isFloating());
+    QCOMPARE(dock2->window()->pos(), QPoint(150, 150));
+    layout->checkSanity();
+
+    QVERIFY(saver.restoreLayout(resolved));
+    QVERIFY(dock2->isFloating());
+    QCOMPARE(dock2->window()->pos(), dock2FloatingPoint);
+    layout->checkSanity();
+
+    {
+        // A delta needs its base
+        SetExpectedWarning expectedWarning("Can't restore a layout delta");
+        QVERIFY(!saver.restoreLayout(delta));
+    }
+
+    {
+        SetExpectedWarning expectedWarning("Delta doesn't match the base layout");
+        QVERIFY(LayoutSaver::resolveLayoutDelta(resolved, delta).isEmpty());
+    }
+}
+
+void TestDocks::tst_streamingJsonReader()
+{
+    EnsureTopLevelsDeleted e;
+    // Tests that Layout::fromJson(), which tokenizes on the fly, reads the same as going through QJsonDocument.
+    // And that Layout::toJson() writes it back the same.
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget(QStringLiteral("one \"quoted\" \u00e9"), new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+    dock1->addDockWidgetAsTab(dock3);
+    dock2->close();
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+
+    LayoutSaver::Layout streamed;
+    QVERIFY(streamed.fromJson(saved));
+    const QVariantMap expected = QJsonDocument::fromJson(saved).toVariant().toMap();
+    const QByteArray rewritten = streamed.toJson();
+    QJsonParseError error;
+    const QJsonDocument rewrittenDoc = QJsonDocument::fromJson(rewritten, &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QCOMPARE(rewrittenDoc.toVariant().toMap(), expected);
+    QCOMPARE(rewritten, saved);
+
+    // Byte for byte what QJsonDocument writes, including the empty containers, there's no floating window
+    QVERIFY(saved.contains("\"floatingWindows\": [\n    ]"));
+    QCOMPARE(saved, QJsonDocument::fromJson(saved).toJson(QJsonDocument::Indented));
+
+    // Malformed input is refused
+    LayoutSaver::Layout malformed;
+    QVERIFY(!malformed.fromJson(saved.left(saved.size() / 2)));
+    QVERIFY(!malformed.fromJson(saved + "}"));
+
+    // Unknown values nested too deep are refused instead of overflowing the stack
+    const int depth = 100000;
+    QByteArray deep = saved;
+    deep.chop(deep.size() - deep.lastIndexOf('}'));
+    deep += ",\"unknownKey\":" + QByteArray(depth, '[') + QByteArray(depth, ']') + "}";
+    QVERIFY(!malformed.fromJson(deep));
+}
+
+void TestDocks::tst_readOldPlaceholderFormat()
+{
+    EnsureTopLevelsDeleted e;
+    // Tests that layouts saved before placeholders were written in columns still read the same
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+    dock2->close();
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+
+    // Convert it to the version 2 format, with one object per placeholder
+    QVariantMap map = QJsonDocument::fromJson(saved).toVariant().toMap();
+    QVariantList dockWidgets = map.value(QStringLiteral("allDockWidgets")).toList();
+    int numPlaceholders = 0;
+    for (QVariant &dw : dockWidgets) {
+        QVariantMap dwMap = dw.toMap();
+        QVariantMap lastPosition = dwMap.value(QStringLiteral("lastPosition")).toMap();
+        const QVariantList floatingWindows = lastPosition.take(QStringLiteral("placeholderFloatingWindows")).toList();
+        const QVariantList itemIndexes = lastPosition.take(QStringLiteral("placeholderItemIndexes")).toList();
+        const QVariantList mainWindows = lastPosition.take(QStringLiteral("placeholderMainWindows")).toList();
+        QCOMPARE(floatingWindows.size(), itemIndexes.size());
+
+        QVariantList placeholders;
+        int mainWindowIndex = 0;
+        for (int i = 0; i < itemIndexes.size(); ++i) {
+            QVariantMap placeholder;
+            const bool isFloatingWindow = floatingWindows.at(i).toInt() != -1;
+            placeholder.insert(QStringLiteral("isFloatingWindow"), isFloatingWindow);
+            placeholder.insert(QStringLiteral("itemIndex"), itemIndexes.at(i));
+            if (isFloatingWindow)
+                placeholder.insert(QStringLiteral("indexOfFloatingWindow"), floatingWindows.at(i));
+            else
+                placeholder.insert(QStringLiteral("mainWindowUniqueName"), mainWindows.at(mainWindowIndex++));
+            placeholders.push_back(placeholder);
+        }
+
+        numPlaceholders += placeholders.size();
+        lastPosition.insert(QStringLiteral("placeholders"), placeholders);
+        dwMap.insert(QStringLiteral("lastPosition"), lastPosition);
+        dw = dwMap;
+    }
+    QVERIFY(numPlaceholders > 0);
+    map.insert(QStringLiteral("allDockWidgets"), dockWidgets);
+    map.insert(QStringLiteral("serializationVersion"), 2);
+
+    LayoutSaver::Layout oldLayout;
+    QVERIFY(oldLayout.fromJson(QJsonDocument::fromVariant(map).toJson()));
+    QCOMPARE(oldLayout.serializationVersion, 2);
+    oldLayout.serializationVersion = KDDOCKWIDGETS_SERIALIZATION_VERSION;
+    QCOMPARE(oldLayout.toJson(), saved);
+}
+
+void TestDocks::tst_restoreIncremental()
+{
+    EnsureTopLevelsDeleted e;
+    // Tests that RestoreOption_Incremental leaves unchanged main windows alone
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+
+    LayoutSaver saver(RestoreOption_Incremental);
+    const QByteArray saved = saver.serializeLayout();
+
+    QPointer<Frame> frame1 = dock1->frame();
+    QPointer<Anchor> anchor = layout->anchors().last();
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(dock1->frame(), frame1.data());
+    QVERIFY(anchor);
+    QCOMPARE(saver.restoredDockWidgets().size(), 2);
+    layout->checkSanity();
+
+    // A main window that changed is rebuilt
+    dock2->close();
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(dock2->isVisible());
+    QCOMPARE(layout->count(), 2);
+    QCOMPARE(layout->placeholderCount(), 0);
+    layout->checkSanity();
+}
+
+void TestDocks::tst_restoreIncrementalSizesOnly()
+{
+    EnsureTopLevelsDeleted e;
+    // Tests that RestoreOption_Incremental just moves the separators back if only sizes changed
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+
+    LayoutSaver saver(RestoreOption_Incremental);
+    const QByteArray saved = saver.serializeLayout();
+
+    QPointer<Frame> frame1 = dock1->frame();
+    QPointer<Frame> frame2 = dock2->frame();
+    Anchor *anchor = layout->anchors().last();
+    QVERIFY(!anchor->isStatic());
+    const int savedPosition = anchor->position();
+    const QRect savedGeometry1 = frame1->geometry();
+
+    anchor->setPosition(savedPosition + 10);
+    QVERIFY(frame1->geometry() != savedGeometry1);
+
+    QVERIFY(saver.restoreLayout(saved));
+    QCOMPARE(dock1->frame(), frame1.data());
+    QCOMPARE(dock2->frame(), frame2.data());
+    QCOMPARE(anchor->position(), savedPosition);
+    QCOMPARE(frame1->geometry(), savedGeometry1);
+    layout->checkSanity();
+
+    // The layout was resized after the snapshot. The positions are scaled, the size is kept
+    const LayoutSaver::MultiSplitterLayout snapshot = layout->serialize();
+    m->resize(QSize(800, 700));
+    Testing::processPendingEvents();
+    const QSize newSize = layout->size();
+    QVERIFY(newSize.height() > snapshot.size.height());
+
+    anchor->setPosition(anchor->position() + 10);
+    layout->restoreAnchorPositions(snapshot);
+    QCOMPARE(layout->size(), newSize);
+    QCOMPARE(anchor->position(), int(double(savedPosition) * newSize.height() / snapshot.size.height()));
+    layout->checkSanity();
+
+    // Same through restoreLayout(), where the main window isn't resized back
+    const double ratio = double(savedPosition) / snapshot.size.height();
+    anchor->setPosition(anchor->position() + 10);
+    LayoutSaver relativeSaver(RestoreOptions(RestoreOption_Incremental) | RestoreOption_RelativeToMainWindow);
+    QVERIFY(relativeSaver.restoreLayout(saved));
+    QCOMPARE(dock1->frame(), frame1.data());
+    QCOMPARE(dock2->frame(), frame2.data());
+    QCOMPARE(layout->size(), newSize);
+    QVERIFY(qAbs(double(anchor->position()) / newSize.height() - ratio) < 0.05);
+    layout->checkSanity();
+}
+
+void TestDocks::tst_restoreCoalescesVisibilitySignals()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+    m->addDockWidget(dock3, Location_OnBottom);
+    dock3->close();
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    dock2->close();
+    dock3->show();
+
+    QSignalSpy shown1(dock1, &DockWidgetBase::shown);
+    QSignalSpy hidden1(dock1, &DockWidgetBase::hidden);
+    QSignalSpy shown2(dock2, &DockWidgetBase::shown);
+    QSignalSpy hidden3(dock3, &DockWidgetBase::hidden);
+
+    // The restore closes and reopens everything, but only the final state is notified
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+    QVERIFY(!dock3->isVisible());
+    QCOMPARE(shown1.count(), 0);
+    QCOMPARE(hidden1.count(), 0);
+    QCOMPARE(shown2.count(), 1);
+    QCOMPARE(hidden3.count(), 1);
+    QVERIFY(dock2->toggleAction()->isChecked());
+    QVERIFY(!dock3->toggleAction()->isChecked());
+
+    // Inside a batch the actions follow right away, only the signals wait
+    {
+        DockRegistry::VisibilityNotificationBatch batch;
+        dock1->close();
+        QVERIFY(!dock1->toggleAction()->isChecked());
+        QCOMPARE(hidden1.count(), 0);
+    }
+    QCOMPARE(hidden1.count(), 1);
+
+    // Same for an incremental restore which leaves another main window untouched
+    dock1->show();
+    m->addDockWidget(dock1, Location_OnTop);
+    auto m2 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m2");
+    auto dock4 = createDockWidget("four", new QTextEdit());
+    m2->addDockWidget(dock4, Location_OnTop);
+    LayoutSaver incrementalSaver(RestoreOption_Incremental);
+    const QByteArray incrementalSaved = incrementalSaver.serializeLayout();
+    dock2->close();
+
+    shown1.clear();
+    hidden1.clear();
+    shown2.clear();
+    QSignalSpy shown4(dock4, &DockWidgetBase::shown);
+    QSignalSpy hidden4(dock4, &DockWidgetBase::hidden);
+    QVERIFY(incrementalSaver.restoreLayout(incrementalSaved));
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+    QCOMPARE(shown1.count(), 0);
+    QCOMPARE(hidden1.count(), 0);
+    QCOMPARE(shown2.count(), 1);
+    QCOMPARE(shown4.count(), 0);
+    QCOMPARE(hidden4.count(), 0);
+
+    delete dock3;
+}
+
+void TestDocks::tst_layoutChangeNotifications()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    Testing::processPendingEvents();
+
+    using LayoutChange = DockRegistry::LayoutChange;
+    QVector<LayoutChange::List> batches;
+    const QMetaObject::Connection connection = connect(DockRegistry::self(), &DockRegistry::layoutChanged,
+                                                       this, [&batches] (const LayoutChange::List &changes) {
+        batches.push_back(changes);
+    });
+
+    auto countOf = [&batches] (LayoutChange::Type type, const QString &dockWidgetName = QString()) {
+        int count = 0;
+        for (const LayoutChange::List &changes : qAsConst(batches)) {
+            for (const LayoutChange &change : changes) {
+                if (change.type == type && (dockWidgetName.isEmpty() || change.dockWidgetName == dockWidgetName))
+                    count++;
+            }
+        }
+        return count;
+    };
+
+    // Only changes made after connecting are reported. dock2 was already open and floating.
+    m->addDockWidget(dock2, Location_OnBottom);
+    QTRY_COMPARE(countOf(LayoutChange::DockWidgetDocked, "two"), 1);
+    QCOMPARE(countOf(LayoutChange::DockWidgetOpened), 0);
+    Testing::processPendingEvents();
+
+    // Several moves of the same anchor are coalesced into one record, emitted in the next iteration
+    batches.clear();
+    Anchor *anchor = layout->anchors().last();
+    QVERIFY(!anchor->isStatic());
+    anchor->setPosition(anchor->position() + 10);
+    anchor->setPosition(anchor->position() + 10);
+    QVERIFY(batches.isEmpty());
+    QTRY_COMPARE(batches.size(), 1);
+    QCOMPARE(countOf(LayoutChange::AnchorMoved), 1);
+    QCOMPARE(batches.first().first().objectId, quintptr(anchor));
+    QCOMPARE(batches.first().first().position, anchor->position());
+
+    // Tabbing
+    batches.clear();
+    dock1->addDockWidgetAsTab(dock3);
+    QTRY_COMPARE(countOf(LayoutChange::DockWidgetDocked, "three"), 1);
+    Testing::processPendingEvents();
+    batches.clear();
+    dock1->frame()->tabWidget()->setCurrentDockWidget(0);
+    QTRY_COMPARE(countOf(LayoutChange::CurrentTabChanged, "one"), 1);
+    QCOMPARE(batches.first().first().objectId, quintptr(dock1->frame()));
+
+    batches.clear();
+    dock2->close();
+    QTRY_COMPARE(countOf(LayoutChange::DockWidgetClosed, "two"), 1);
+    Testing::processPendingEvents();
+
+    // Reopening and closing again in the same iteration isn't a dock widget change
+    batches.clear();
+    dock2->show();
+    dock2->close();
+    Testing::processPendingEvents();
+    QCOMPARE(countOf(LayoutChange::DockWidgetOpened), 0);
+    QCOMPARE(countOf(LayoutChange::DockWidgetClosed), 0);
+
+    // Frames are reported when created and when deleted
+    batches.clear();
+    Frame *frame = Config::self().frameworkWidgetFactory()->createFrame();
+    QTRY_COMPARE(countOf(LayoutChange::FrameAdded), 1);
+    QCOMPARE(batches.first().first().objectId, quintptr(frame));
+    batches.clear();
+    delete frame;
+    QTRY_COMPARE(countOf(LayoutChange::FrameRemoved), 1);
+    QCOMPARE(batches.first().first().objectId, quintptr(frame));
+
+    // A frame created and deleted in the same iteration is never reported
+    batches.clear();
+    delete Config::self().frameworkWidgetFactory()->createFrame();
+    Testing::processPendingEvents();
+    QCOMPARE(countOf(LayoutChange::FrameAdded), 0);
+    QCOMPARE(countOf(LayoutChange::FrameRemoved), 0);
+
+    // Neither is an anchor moved and then deleted in the same iteration, its address might be reused
+    auto m2 = createMainWindow(QSize(800, 500), MainWindowOption_None, "m2");
+    auto dock4 = createDockWidget("four", new QTextEdit());
+    auto dock5 = createDockWidget("five", new QTextEdit());
+    m2->addDockWidget(dock4, Location_OnTop);
+    m2->addDockWidget(dock5, Location_OnBottom);
+    Testing::processPendingEvents();
+    batches.clear();
+    Anchor *anchor2 = m2->multiSplitterLayout()->anchors().last();
+    QVERIFY(!anchor2->isStatic());
+    anchor2->setPosition(anchor2->position() + 10);
+    m2.reset();
+    Testing::processPendingEvents();
+    QCOMPARE(countOf(LayoutChange::AnchorMoved), 0);
+
+    // Nothing is recorded once disconnected
+    disconnect(connection);
+    QVERIFY(!DockRegistry::self()->isObservingLayoutChanges());
+}
+
+void TestDocks::tst_layoutSnapshot()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+
+    // Enabling publishes right away
+    LayoutSnapshot::setPublishingEnabled(true);
+    LayoutSnapshot::Ptr snapshot = LayoutSnapshot::current();
+    QVERIFY(snapshot);
+    const quint64 version = snapshot->version();
+    QVERIFY(version > 0);
+    QCOMPARE(snapshot->dockWidgets().size(), 2);
+    const LayoutSnapshot::DockWidget *one = snapshot->dockWidget("one");
+    QVERIFY(one);
+    QVERIFY(one->isVisible);
+    QVERIFY(!one->isFloating);
+    QCOMPARE(one->frameId, quintptr(dock1->frame()));
+    QCOMPARE(one->globalGeometry, QRect(dock1->mapToGlobal(QPoint(0, 0)), dock1->size()));
+    QVERIFY(snapshot->dockWidget("two")->isFloating);
+    QVERIFY(!snapshot->dockWidget("three"));
+
+    // A change publishes a new snapshot, the old one stays as it was
+    m->addDockWidget(dock2, Location_OnBottom);
+    QTRY_VERIFY(LayoutSnapshot::current()->version() > version);
+    QVERIFY(!LayoutSnapshot::current()->dockWidget("two")->isFloating);
+    QVERIFY(snapshot->dockWidget("two")->isFloating);
+    QVERIFY(LayoutSnapshot::current()->dockWidget("one")->globalGeometry.height() < one->globalGeometry.height());
+
+    // Readable from other threads
+    quint64 versionInThread = 0;
+    std::thread thread([&versionInThread] {
+        versionInThread = LayoutSnapshot::current()->version();
+    });
+    thread.join();
+    QCOMPARE(versionInThread, LayoutSnapshot::current()->version());
+
+    LayoutSnapshot::setPublishingEnabled(false);
+    QVERIFY(!LayoutSnapshot::isPublishingEnabled());
+    QVERIFY(!DockRegistry::self()->isObservingLayoutChanges());
+}
+
+void TestDocks::tst_interactiveOperationSignals()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+
+    QSignalSpy startedSpy(dock1, &DockWidgetBase::interactiveOperationStarted);
+    QSignalSpy finishedSpy(dock1, &DockWidgetBase::interactiveOperationFinished);
+    bool wasInOperation = false;
+    connect(dock1, &DockWidgetBase::interactiveOperationStarted, dock1, [dock1, &wasInOperation] {
+        wasInOperation = dock1->isInInteractiveOperation();
+    });
+
+    // Dragging a separator, the final size is reported once it's applied
+    Anchor *anchor = m->multiSplitterLayout()->itemForFrame(dock1->frame())->anchorGroup().bottom;
+    const int oldHeight = dock1->height();
+    anchor->simulateDrag({ anchor->position() + 10, anchor->position() + 20 });
+    QCOMPARE(startedSpy.count(), 1);
+    QCOMPARE(finishedSpy.count(), 1);
+    QVERIFY(wasInOperation);
+    QVERIFY(!dock1->isInInteractiveOperation());
+    QCOMPARE(dock1->height(), oldHeight + 20);
+    QCOMPARE(finishedSpy.at(0).at(0).toSize(), dock1->size());
+
+    // Overlapping operations only emit for the outermost one
+    {
+        InteractiveOperation op({ dock1 });
+        QCOMPARE(startedSpy.count(), 2);
+        anchor->simulateDrag({ anchor->position() - 10 });
+        QCOMPARE(startedSpy.count(), 2);
+        QCOMPARE(finishedSpy.count(), 1);
+        QVERIFY(dock1->isInInteractiveOperation());
+    }
+    QCOMPARE(finishedSpy.count(), 2);
+
+    // Dragging a floating window
+    QSignalSpy floatingStartedSpy(dock3, &DockWidgetBase::interactiveOperationStarted);
+    QSignalSpy floatingFinishedSpy(dock3, &DockWidgetBase::interactiveOperationFinished);
+    auto fw = dock3->floatingWindow();
+    QVERIFY(fw);
+    dragFloatingWindowTo(fw, fw->geometry().center() + QPoint(50, 50));
+    QCOMPARE(floatingStartedSpy.count(), 1);
+    QTRY_COMPARE(floatingFinishedSpy.count(), 1);
+    QVERIFY(!dock3->isInInteractiveOperation());
+    QCOMPARE(startedSpy.count(), 2);
+}
+
+void TestDocks::tst_effectiveVisibility()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    auto dock3 = createDockWidget("three", new QTextEdit());
+    auto dock4 = createDockWidget("four", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+    QVERIFY(dock1->isEffectivelyVisible());
+    QVERIFY(dock2->isEffectivelyVisible());
+    QVERIFY(dock4->isEffectivelyVisible());
+
+    // Only the current tab is visible
+    QSignalSpy spy1(dock1, &DockWidgetBase::effectiveVisibilityChanged);
+    dock1->addDockWidgetAsTab(dock3);
+    QVERIFY(!dock1->isEffectivelyVisible());
+    QVERIFY(dock3->isEffectivelyVisible());
+    QCOMPARE(spy1.count(), 1);
+    QCOMPARE(spy1.at(0).at(0).toBool(), false);
+
+    dock1->raise();
+    QVERIFY(dock1->isEffectivelyVisible());
+    QVERIFY(!dock3->isEffectivelyVisible());
+    QCOMPARE(spy1.count(), 2);
+
+    // Collapsed below the threshold
+    Anchor *anchor = m->multiSplitterLayout()->itemForFrame(dock2->frame())->anchorGroup().top;
+    Config::self().setCollapseThreshold(dock2->height());
+    anchor->setPosition(anchor->position() + 10);
+    QVERIFY(!dock2->isEffectivelyVisible());
+    Config::self().setCollapseThreshold(10);
+    anchor->setPosition(anchor->position() - 10);
+    QVERIFY(dock2->isEffectivelyVisible());
+
+    // Minimized floating windows
+    QSignalSpy spy4(dock4, &DockWidgetBase::effectiveVisibilityChanged);
+    dock4->window()->showMinimized();
+    QTRY_VERIFY(!dock4->isEffectivelyVisible());
+    dock4->window()->showNormal();
+    QTRY_VERIFY(dock4->isEffectivelyVisible());
+    QCOMPARE(spy4.count(), 2);
+
+    // Closing
+    dock1->close();
+    QVERIFY(!dock1->isEffectivelyVisible());
+    QCOMPARE(spy1.count(), 3);
+}
+
+void TestDocks::tst_layoutHistory()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("one", new QTextEdit());
+    auto dock2 = createDockWidget("two", new QTextEdit());
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+
+    LayoutHistory history;
+    QCOMPARE(history.count(), 1);
+    QVERIFY(!history.canUndo());
+    QVERIFY(!history.canRedo());
+
+    dock2->close();
+    QTRY_COMPARE(history.count(), 2);
+    QVERIFY(history.canUndo());
+
+    QVERIFY(history.undo());
+    QVERIFY(dock2->isVisible());
+    QCOMPARE(layout->count(), 2);
+    QCOMPARE(layout->placeholderCount(), 0);
+    QVERIFY(history.canRedo());
+    layout->checkSanity();
 
-    dock3->show();
-    dock3->morphIntoFloatingWindow(); // as it would take 1 event loop. Do it now so we can compare already.
+    QVERIFY(history.redo());
+    QVERIFY(!dock2->isVisible());
+    QVERIFY(!history.canRedo());
 
-    QCOMPARE(dock3->window()->pos(), dock3FloatingPoint);
+    // A new operation after undoing discards what could be redone
+    QVERIFY(history.undo());
+    dock1->setFloating(true);
+    QTRY_VERIFY(!history.canRedo());
+    QCOMPARE(history.count(), 2);
 
-    // Cleanup
-    dock3->deleteLater();
-    QVERIFY(Testing::waitForDeleted(dock3));
+    // Bounded
+    LayoutHistory shortHistory(2);
+    dock1->setFloating(false);
+    QTRY_COMPARE(shortHistory.count(), 2);
+    dock2->close();
+    QVERIFY(!dock2->isVisible());
+    QTest::qWait(10); // Let the capture run
+    QCOMPARE(shortHistory.count(), 2);
 }
 
 void TestDocks::tst_restoreNestedAndTabbed()
@@ -1647,6 +3756,88 @@ void TestDocks::tst_restoreWithAffinity()
     delete dock2->window();
 }
 
+void TestDocks::tst_restoreSkipsOtherAffinities()
+{
+    // One layout shared by several affinities. Restoring one doesn't even parse the others.
+    EnsureTopLevelsDeleted e;
+
+    auto m1 = createMainWindow(QSize(500, 500), {}, "m1");
+    m1->setAffinityName("a1");
+    auto m2 = createMainWindow(QSize(500, 500), {}, "m2");
+    m2->setAffinityName("a2");
+
+    auto dock1 = createDockWidget("1", new QPushButton("1"), {}, true, "a1");
+    m1->addDockWidget(dock1, Location_OnLeft);
+    auto dock2 = createDockWidget("2", new QPushButton("2"), {}, true, "a2");
+    m2->addDockWidget(dock2, Location_OnLeft);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+    const QByteArray savedBinary = saver.serializeLayout(SerializationFormat_Binary);
+
+    for (const QByteArray &data : { saved, savedBinary }) {
+        LayoutSaver::Layout layout;
+        layout.affinityNames = QStringList { QStringLiteral("a1") };
+        QVERIFY(LayoutSaver::Layout::isBinary(data) ? layout.fromBinary(data) : layout.fromJson(data));
+        QCOMPARE(layout.mainWindows.size(), 2);
+        for (const LayoutSaver::MainWindow &mw : qAsConst(layout.mainWindows)) {
+            QCOMPARE(mw.skippedByAffinity, mw.affinityName == QLatin1String("a2"));
+            QCOMPARE(mw.multiSplitterLayout.items.isEmpty(), mw.skippedByAffinity);
+        }
+    }
+
+    // The a2 main window doesn't need to exist
+    delete dock2;
+    m2.reset();
+
+    LayoutSaver saverA1;
+    saverA1.setAffinityNames({"a1"});
+    dock1->close();
+    QVERIFY(saverA1.restoreLayout(saved));
+    QVERIFY(dock1->isVisible());
+    QCOMPARE(dock1->window(), m1.get());
+}
+
+void TestDocks::tst_restoreStateOnly()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    auto dock4 = createDockWidget("4", new QPushButton("4"), {}, /*show=*/false);
+    m->addDockWidget(dock1, Location_OnLeft);
+    dock1->addDockWidgetAsTab(dock2);
+    dock1->setAsCurrentTab();
+    QVERIFY(dock3->isFloating());
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+
+    dock2->setAsCurrentTab();
+    dock3->close();
+    dock4->show();
+    QPointer<Frame> frame1 = dock1->frame();
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    const int numAnchors = layout->anchors().size();
+
+    LayoutSaver stateSaver(RestoreOption_StateOnly);
+    QVERIFY(stateSaver.restoreLayout(saved));
+
+    // The main window's layout wasn't rebuilt
+    QCOMPARE(dock1->frame(), frame1.data());
+    QCOMPARE(layout->anchors().size(), numAnchors);
+
+    QVERIFY(dock1->isCurrentTab());
+    QVERIFY(dock3->isOpen());
+    QVERIFY(dock3->isFloating());
+    QVERIFY(!dock4->isOpen());
+    QCOMPARE(stateSaver.restoredDockWidgets().size(), 3);
+
+    delete dock3->window();
+    delete dock4;
+}
+
 void TestDocks::tst_marginsAfterRestore()
 {
     EnsureTopLevelsDeleted e;
@@ -1674,6 +3865,33 @@ void TestDocks::tst_marginsAfterRestore()
     }
 }
 
+void TestDocks::tst_addDockWidgetsAsTab()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_HasCentralFrame);
+    auto centralFrame = static_cast<Frame*>(m->dropArea()->centralFrame()->frame());
+
+    QVector<DockWidgetBase *> docks;
+    for (int i = 0; i < 20; ++i)
+        docks << createDockWidget(QStringLiteral("doc%1").arg(i), new QTextEdit(), {}, /*show=*/false);
+
+    int currentChanges = 0;
+    connect(centralFrame, &Frame::currentDockWidgetChanged, centralFrame, [&currentChanges] {
+        currentChanges++;
+    });
+
+    m->addDockWidgetsAsTab(docks);
+    QVERIFY(!centralFrame->isInBatchInsert());
+    QCOMPARE(centralFrame->dockWidgetCount(), docks.size());
+
+    // Only the last one became current, the others' widgets weren't shown
+    QCOMPARE(centralFrame->currentDockWidget(), docks.last());
+    QVERIFY(docks.last()->isVisible());
+    QVERIFY(!docks.first()->isVisible());
+    QVERIFY(currentChanges <= 2);
+    QVERIFY(m->dropArea()->checkSanity());
+}
+
 void TestDocks::tst_addDockWidgetAsTabToDockWidget()
 {
     EnsureTopLevelsDeleted e;
@@ -2032,60 +4250,405 @@ void TestDocks::tst_notClosable()
         TitleBar *titlebarFW = fw->titleBar();
         TitleBar *titleBarFrame = fw->frames().at(0)->titleBar();
 
-        QVERIFY(titlebarFW->isCloseButtonVisible());
-        QVERIFY(!titleBarFrame->isCloseButtonVisible());
-        QVERIFY(!titleBarFrame->isCloseButtonEnabled());
+        QVERIFY(titlebarFW->isCloseButtonVisible());
+        QVERIFY(!titleBarFrame->isCloseButtonVisible());
+        QVERIFY(!titleBarFrame->isCloseButtonEnabled());
+
+        auto window = dock2->window();
+        window->deleteLater();
+        Testing::waitForDeleted(window);
+    }
+}
+
+void TestDocks::tst_maximizeAndRestore()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow();
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+
+    m->addDockWidget(dock1, KDDockWidgets::Location_OnLeft);
+    m->addDockWidget(dock2, KDDockWidgets::Location_OnRight);
+
+    auto dropArea = m->dropArea();
+    QVERIFY(dropArea->checkSanity());
+
+    m->showMaximized();
+    Testing::waitForResize(m.get());
+
+    QVERIFY(dropArea->checkSanity());
+    qDebug() << "About to show normal";
+    m->showNormal();
+    Testing::waitForResize(m.get());
+
+    QVERIFY(dropArea->checkSanity());
+}
+
+void TestDocks::tst_propagateResize2()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow();
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, KDDockWidgets::Location_OnTop);
+    m->addDockWidget(dock2, KDDockWidgets::Location_OnRight, dock1);
+
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+
+    m->addDockWidget(dock3, KDDockWidgets::Location_OnBottom);
+    m->addDockWidget(dock4, KDDockWidgets::Location_OnRight, dock3);
+
+    auto dock5 = createDockWidget("dock5", new QPushButton("five"));
+    m->addDockWidget(dock5, KDDockWidgets::Location_OnLeft);
+
+    auto dropArea = m->dropArea();
+    dropArea->checkSanity();
+}
+
+void TestDocks::tst_linearLayoutSolver()
+{
+    // Like tst_propagateResize2, but with Flag_LinearLayoutSolver, and with enough frames to have many paths
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::self().flags() | Config::Flag_LinearLayoutSolver);
+
+    auto m = createMainWindow(QSize(1000, 1000), MainWindowOption_None);
+    auto dropArea = m->dropArea();
+    MultiSplitterLayout *layout = dropArea->multiSplitterLayout();
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, KDDockWidgets::Location_OnTop);
+    m->addDockWidget(dock2, KDDockWidgets::Location_OnRight, dock1);
+
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    m->addDockWidget(dock3, KDDockWidgets::Location_OnBottom);
+    m->addDockWidget(dock4, KDDockWidgets::Location_OnRight, dock3);
+
+    for (int i = 0; i < 6; ++i) {
+        auto dock = createDockWidget(QStringLiteral("dock_linear%1").arg(i), new QPushButton("foo"));
+        m->addDockWidget(dock, i % 2 ? KDDockWidgets::Location_OnLeft : KDDockWidgets::Location_OnBottom, i % 3 ? dock1 : dock4);
+        QVERIFY(layout->checkSanity());
+    }
+
+    auto dock5 = createDockWidget("dock5", new QPushButton("five"));
+    m->addDockWidget(dock5, KDDockWidgets::Location_OnLeft);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_linearRedistributeSpace()
+{
+    // Resizing the window with Flag_LinearLayoutSolver should give the same result as without
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 1000), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, KDDockWidgets::Location_OnTop);
+    m->addDockWidget(dock2, KDDockWidgets::Location_OnRight, dock1);
+    for (int i = 0; i < 6; ++i) {
+        auto dock = createDockWidget(QStringLiteral("dock_redistribute%1").arg(i), new QPushButton("foo"));
+        m->addDockWidget(dock, i % 2 ? KDDockWidgets::Location_OnLeft : KDDockWidgets::Location_OnBottom, i % 3 ? dock1 : dock2);
+    }
+
+    const QSize originalSize = layout->size();
+    auto positionsAfterResize = [layout, originalSize] (QSize newSize) {
+        layout->setSize(originalSize);
+        layout->setSize(newSize);
+        QHash<Anchor*, int> positions;
+        for (Anchor *anchor : layout->anchors(Qt::Vertical, false))
+            positions.insert(anchor, anchor->position());
+        for (Anchor *anchor : layout->anchors(Qt::Horizontal, false))
+            positions.insert(anchor, anchor->position());
+        return positions;
+    };
+
+    for (QSize newSize : { originalSize + QSize(300, 200), originalSize - QSize(200, 300) }) {
+        Config::self().setFlags(Config::self().flags() & ~Config::Flag_LinearLayoutSolver);
+        const QHash<Anchor*, int> expected = positionsAfterResize(newSize);
+        QVERIFY(layout->checkSanity());
+
+        Config::self().setFlags(Config::self().flags() | Config::Flag_LinearLayoutSolver);
+        QCOMPARE(positionsAfterResize(newSize), expected);
+        QVERIFY(layout->checkSanity());
+    }
+}
+
+void TestDocks::tst_boundPositionsForAllAnchors()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 1000), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    m->addDockWidget(dock1, KDDockWidgets::Location_OnTop);
+    for (int i = 0; i < 6; ++i) {
+        auto dock = createDockWidget(QStringLiteral("dock_bounds%1").arg(i), new QPushButton("foo"));
+        m->addDockWidget(dock, i % 2 ? KDDockWidgets::Location_OnRight : KDDockWidgets::Location_OnBottom, i % 3 ? dock1 : nullptr);
+    }
+
+    // Also have a placeholder, so there are followers
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock2, KDDockWidgets::Location_OnLeft, dock1);
+    dock2->close();
+
+    const QVector<QPair<int, int>> allBounds = layout->boundPositionsForAllAnchors();
+    QCOMPARE(allBounds.size(), layout->anchorIdBound());
+    for (Anchor *anchor : layout->anchors(Qt::Vertical, true) + layout->anchors(Qt::Horizontal, true))
+        QCOMPARE(allBounds.at(anchor->id()), layout->boundPositionsForAnchor(anchor));
+}
+
+void TestDocks::tst_lazyResizeLivePreview()
+{
+    // Tests that with the live preview the frames are only resized once, on release
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::Flag_LazyResizeLivePreview);
+    auto m = createMainWindow(QSize(1000, 500), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    QCOMPARE(layout->resizePolicy(), MultiSplitterLayout::ResizePolicy_LazyLivePreview);
+
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    Item *item1 = layout->itemForFrame(dock1->frame());
+    Anchor *anchor = item1->anchorGroup().right;
+    const int oldWidth = dock1->frame()->width();
+
+    QSignalSpy geometrySpy(item1, &Item::geometryChanged);
+    const int pos = anchor->position();
+    anchor->simulateDrag({ pos + 10, pos + 20, pos + 30 });
+    QCOMPARE(geometrySpy.count(), 1);
+    QCOMPARE(anchor->position(), pos + 30);
+    QCOMPARE(dock1->frame()->width(), oldWidth + 30);
+    QCOMPARE(dock1->frame()->geometry(), item1->geometry());
+
+    // While an immediate resize follows every move
+    layout->setResizePolicy(MultiSplitterLayout::ResizePolicy_Immediate);
+    geometrySpy.clear();
+    anchor->simulateDrag({ pos + 10, pos });
+    QCOMPARE(geometrySpy.count(), 2);
+    QCOMPARE(dock1->frame()->width(), oldWidth);
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_resizePolicy()
+{
+    EnsureTopLevelsDeleted e;
+
+    // Flag_AllowReorderTabs used to share its value with Flag_LazyResize
+    Config::self().setFlags(Config::Flag_AllowReorderTabs);
+    QVERIFY(!(Config::self().flags() & Config::Flag_LazyResize));
+    {
+        auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+        QCOMPARE(m->multiSplitterLayout()->resizePolicy(), MultiSplitterLayout::ResizePolicy_Immediate);
+    }
+
+    Config::self().setFlags(Config::Flag_LazyResize);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    QCOMPARE(layout->resizePolicy(), MultiSplitterLayout::ResizePolicy_Lazy);
+
+    // The policy is per layout
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto fw = dock1->morphIntoFloatingWindow();
+    fw->multiSplitterLayout()->setResizePolicy(MultiSplitterLayout::ResizePolicy_Throttled);
+    QCOMPARE(fw->multiSplitterLayout()->resizePolicy(), MultiSplitterLayout::ResizePolicy_Throttled);
+    QCOMPARE(layout->resizePolicy(), MultiSplitterLayout::ResizePolicy_Lazy);
+
+    fw->multiSplitterLayout()->setResizeThrottleRate(10);
+    QCOMPARE(fw->multiSplitterLayout()->resizeThrottleRate(), 10);
+
+    delete fw;
+}
+
+void TestDocks::tst_resizeDockWidget()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 800), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom);
+
+    QVERIFY(m->resizeDockWidget(dock1, QSize(300, 0)));
+    QCOMPARE(dock1->width(), 300);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    // dock2 is on the right edge, so its left separator is moved instead
+    QVERIFY(m->resizeDockWidget(dock2, QSize(200, 0)));
+    QCOMPARE(dock2->width(), 200);
+
+    // The other docks get the remaining height
+    const int dock1Height = dock1->height();
+    const int dock3Height = dock3->height();
+    QVERIFY(m->resizeDockWidget(dock3, QSize(-1, 150)));
+    QCOMPARE(dock3->height(), 150);
+    QCOMPARE(dock1->height(), dock1Height + dock3Height - 150);
+
+    // Can't make it bigger than the window, but gets as close as the other docks' min sizes allow
+    QVERIFY(!m->resizeDockWidget(dock1, QSize(5000, 0)));
+    QVERIFY(dock1->width() > 300);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+}
+
+void TestDocks::tst_showDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 800), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnBottom);
+
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+    dock2->close();
+    dock3->close();
+    QCOMPARE(layout->placeholderCount(), 2);
+
+    // dock1 is already open, it's just left alone
+    DockWidgetBase::showDockWidgets({ dock1, dock2, dock3 });
+    QVERIFY(!layout->isInTransaction());
+    QCOMPARE(layout->placeholderCount(), 0);
+    QCOMPARE(layout->visibleCount(), 3);
+    for (DockWidgetBase *dw : { dock1, dock2, dock3 }) {
+        QVERIFY(dw->isOpen());
+        QCOMPARE(dw->frame()->geometry(), dw->frame()->layoutItem()->geometry());
+    }
+
+    QVERIFY(layout->checkSanity());
+}
+
+void TestDocks::tst_floatDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 800), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    dock2->addDockWidgetAsTab(dock3);
+
+    auto fw = qobject_cast<FloatingWindow *>(DockWidgetBase::floatDockWidgets({ dock1, dock2, dock3 }));
+    QVERIFY(fw);
+    QVERIFY(fw->dropArea()->checkSanity());
+    QCOMPARE(fw->frames().size(), 2);
+    QCOMPARE(dock1->window(), fw);
+
+    // The tabbed ones stay tabbed, and to the right of dock1
+    QCOMPARE(dock2->frame(), dock3->frame());
+    QVERIFY(dock1->frame()->x() < dock2->frame()->x());
 
-        auto window = dock2->window();
-        window->deleteLater();
-        Testing::waitForDeleted(window);
-    }
+    // The main window keeps placeholders to restore them
+    QCOMPARE(m->multiSplitterLayout()->placeholderCount(), 2);
+    QVERIFY(m->multiSplitterLayout()->checkSanity());
+
+    delete fw;
 }
 
-void TestDocks::tst_maximizeAndRestore()
+void TestDocks::tst_checkSanityIncremental()
 {
     EnsureTopLevelsDeleted e;
-    auto m = createMainWindow();
-    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
-    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto m = createMainWindow(QSize(1000, 1000), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
 
-    m->addDockWidget(dock1, KDDockWidgets::Location_OnLeft);
-    m->addDockWidget(dock2, KDDockWidgets::Location_OnRight);
+    std::vector<DockWidgetBase*> docks;
+    for (int i = 0; i < 6; ++i) {
+        auto dock = createDockWidget(QStringLiteral("dock%1").arg(i), new QPushButton("foo"));
+        m->addDockWidget(dock, i % 2 ? Location_OnRight : Location_OnBottom);
+        docks.push_back(dock);
+        QVERIFY(layout->checkSanityIncremental());
+    }
 
-    auto dropArea = m->dropArea();
-    QVERIFY(dropArea->checkSanity());
+    // Nothing changed, nothing to check
+    QVERIFY(layout->checkSanityIncremental());
 
-    m->showMaximized();
-    Testing::waitForResize(m.get());
+    // Only the separator and its neighbours changed
+    Anchor *anchor = layout->itemForFrame(docks.back()->frame())->anchorGroup().left;
+    anchor->setPosition(anchor->position() - 10);
+    QVERIFY(layout->checkSanityIncremental());
+    QVERIFY(layout->checkSanity());
 
-    QVERIFY(dropArea->checkSanity());
-    qDebug() << "About to show normal";
-    m->showNormal();
-    Testing::waitForResize(m.get());
+#if defined(DOCKS_DEVELOPER_MODE)
+    // Removing an item from an anchor marks the item, its neighbours and its other anchors, but not the rest.
+    // dockA is left of dockB and dockC, which are stacked, and the other docks are rows below them.
+    auto m2 = createMainWindow(QSize(1000, 1000), MainWindowOption_None, "m2");
+    MultiSplitterLayout *layout2 = m2->multiSplitterLayout();
+    auto dockA = createDockWidget("dockA", new QPushButton("A"));
+    auto dockB = createDockWidget("dockB", new QPushButton("B"));
+    auto dockC = createDockWidget("dockC", new QPushButton("C"));
+    m2->addDockWidget(dockA, Location_OnLeft);
+    m2->addDockWidget(dockB, Location_OnRight);
+    m2->addDockWidget(dockC, Location_OnBottom, dockB);
+    for (int i = 0; i < 4; ++i)
+        m2->addDockWidget(createDockWidget(QStringLiteral("row%1").arg(i), new QPushButton("row")), Location_OnBottom);
+    QVERIFY(layout2->checkSanityIncremental());
+
+    Item *itemA = layout2->itemForFrame(dockA->frame());
+    Item *itemB = layout2->itemForFrame(dockB->frame());
+    Item *itemC = layout2->itemForFrame(dockC->frame());
+    anchor = itemC->anchorGroup().left;
+    QVERIFY(anchor->containsItem(itemA, Anchor::Side1));
+    QVERIFY(anchor->containsItem(itemB, Anchor::Side2));
+    anchor->removeItem(itemC);
+    QVERIFY(layout2->m_itemsToCheck.contains(itemA));
+    QVERIFY(layout2->m_itemsToCheck.contains(itemB));
+    QVERIFY(layout2->m_itemsToCheck.contains(itemC));
+    QVERIFY(layout2->m_anchorsToCheck.contains(itemC->anchorGroup().top));
+    QVERIFY(layout2->m_anchorsToCheck.contains(itemC->anchorGroup().bottom));
+    QVERIFY(layout2->m_itemsToCheck.size() <= layout2->count() / 2); // So it's not a full check
 
-    QVERIFY(dropArea->checkSanity());
+    {
+        // itemC isn't on a left anchor anymore, the incremental check must notice
+        SetExpectedWarning expectedWarning("MultiSplitterLayout::checkSanity:");
+        QVERIFY(!layout2->checkSanityIncremental());
+    }
+
+    anchor->addItem(itemC, Anchor::Side2);
+    QVERIFY(layout2->checkSanity());
+#endif
 }
 
-void TestDocks::tst_propagateResize2()
+void TestDocks::tst_layoutTransaction()
 {
     EnsureTopLevelsDeleted e;
-    auto m = createMainWindow();
+    auto m = createMainWindow(QSize(1000, 1000), MainWindowOption_None);
+    MultiSplitterLayout *layout = m->multiSplitterLayout();
+
     auto dock1 = createDockWidget("dock1", new QPushButton("one"));
-    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
     m->addDockWidget(dock1, KDDockWidgets::Location_OnTop);
-    m->addDockWidget(dock2, KDDockWidgets::Location_OnRight, dock1);
+    Frame *frame1 = dock1->frame();
+    const QRect frame1Geo = frame1->geometry();
 
-    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
-    auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+    {
+        MainWindowBase::LayoutTransaction transaction(m.get());
+        {
+            MainWindowBase::LayoutTransaction nested(m.get());
+            auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+            m->addDockWidget(dock2, KDDockWidgets::Location_OnRight, dock1);
+        }
+        QVERIFY(layout->isInTransaction());
 
-    m->addDockWidget(dock3, KDDockWidgets::Location_OnBottom);
-    m->addDockWidget(dock4, KDDockWidgets::Location_OnRight, dock3);
+        auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+        auto dock4 = createDockWidget("dock4", new QPushButton("four"));
+        m->addDockWidget(dock3, KDDockWidgets::Location_OnBottom);
+        m->addDockWidget(dock4, KDDockWidgets::Location_OnRight, dock3);
 
-    auto dock5 = createDockWidget("dock5", new QPushButton("five"));
-    m->addDockWidget(dock5, KDDockWidgets::Location_OnLeft);
+        // The frame wasn't resized yet, only its Item
+        QCOMPARE(frame1->geometry(), frame1Geo);
+        QVERIFY(layout->itemForFrame(frame1)->geometry() != frame1Geo);
+    }
 
-    auto dropArea = m->dropArea();
-    dropArea->checkSanity();
+    QVERIFY(!layout->isInTransaction());
+    QCOMPARE(frame1->geometry(), layout->itemForFrame(frame1)->geometry());
+    QVERIFY(layout->checkSanity());
 }
 
 std::unique_ptr<MultiSplitter> TestDocks::createMultiSplitterFromSetup(MultiSplitterSetup setup, QHash<QWidget*, Frame*> &frameMap) const
@@ -2611,6 +5174,48 @@ void TestDocks::tst_crash2()
 
 }
 
+void TestDocks::tst_cumulativeMinLengthCache()
+{
+    // Tests that the cached Anchor::cumulativeMinLength() is refreshed when the size constraints change
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("dock1", createWidget(100));
+    auto dock2 = createDockWidget("dock2", createWidget(100));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    Anchor *leftAnchor = layout->m_leftAnchor;
+    auto uncachedMinLength = [layout, leftAnchor] {
+        layout->invalidateSizeConstraints();
+        return leftAnchor->cumulativeMinLength(Anchor::Side2);
+    };
+
+    const int initialMin = leftAnchor->cumulativeMinLength(Anchor::Side2);
+    QCOMPARE(initialMin, uncachedMinLength());
+
+    // Asking again doesn't invalidate anything
+    const int generation = layout->sizeConstraintsGeneration();
+    QCOMPARE(leftAnchor->cumulativeMinLength(Anchor::Side2), initialMin);
+    QCOMPARE(layout->sizeConstraintsGeneration(), generation);
+
+    // A bigger minimum size
+    dock2->widget()->setMinimumSize(QSize(400, 100));
+    QTRY_VERIFY(layout->sizeConstraintsGeneration() != generation);
+    const int grownMin = leftAnchor->cumulativeMinLength(Anchor::Side2);
+    QVERIFY(grownMin > initialMin);
+    QCOMPARE(grownMin, uncachedMinLength());
+
+    // Placeholders don't need any space
+    dock2->close();
+    const int shrunkMin = leftAnchor->cumulativeMinLength(Anchor::Side2);
+    QVERIFY(shrunkMin < grownMin);
+    QCOMPARE(shrunkMin, uncachedMinLength());
+    QVERIFY(layout->checkSanity());
+
+    delete dock2;
+}
+
 void TestDocks::tst_setFloatingWhenWasTabbed()
 {
     // Tests DockWidget::isTabbed() and DockWidget::setFloating(false|true) when tabbed (it should redock)
@@ -3084,6 +5689,45 @@ void TestDocks::tst_placeholderCount()
     Testing::waitForDeleted(fw);
 }
 
+void TestDocks::tst_maxPlaceholdersPerLayout()
+{
+    EnsureTopLevelsDeleted e;
+    // Tests that the oldest placeholders are dropped once there's more than Config::maxPlaceholdersPerLayout()
+    Config::self().setMaxPlaceholdersPerLayout(1);
+
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    auto dock3 = createDockWidget("3", new QPushButton("3"));
+    auto dock4 = createDockWidget("4", new QPushButton("4"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    m->addDockWidget(dock3, Location_OnRight);
+
+    dock1->close();
+    dock2->close();
+    dock3->close();
+    QCOMPARE(layout->placeholderCount(), 3);
+
+    // The budget is only enforced when adding
+    m->addDockWidget(dock4, Location_OnRight);
+    QCOMPARE(layout->placeholderCount(), 1);
+    QVERIFY(!dock1->lastPosition()->isValid());
+    QVERIFY(!dock2->lastPosition()->isValid());
+    QVERIFY(dock3->lastPosition()->isValid());
+    QVERIFY(layout->checkSanity());
+
+    // The most recent one still restores to the main window
+    dock3->show();
+    QVERIFY(!dock3->isFloating());
+    QCOMPARE(dock3->window(), m.get());
+    QVERIFY(layout->checkSanity());
+
+    delete dock1;
+    delete dock2;
+}
+
 void TestDocks::tst_availableLengthForOrientation()
 {
     EnsureTopLevelsDeleted e;
@@ -4144,6 +6788,33 @@ void TestDocks::tst_toggleDockWidgetWithHiddenTitleBar()
     QVERIFY(!d1->frame()->titleBar()->isVisible());
 }
 
+void TestDocks::tst_lazyTitleBar()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_HasCentralFrame);
+
+    // The central frame never shows a title bar, so it doesn't create one
+    Frame *central = m->dropArea()->centralFrame()->frame();
+    QVERIFY(!central->m_titleBar);
+
+    auto d1 = createDockWidget("1", new QPushButton("1"));
+    m->addDockWidget(d1, Location_OnLeft);
+    QVERIFY(d1->frame()->m_titleBar);
+    QVERIFY(d1->frame()->titleBar()->isVisible());
+
+    // A single frame in a floating window uses the floating window's title bar
+    auto d2 = createDockWidget("2", new QPushButton("2"));
+    QVERIFY(d2->isFloating());
+    QVERIFY(!d2->frame()->m_titleBar);
+    QCOMPARE(d2->frame()->title(), QStringLiteral("2"));
+
+    // Created on demand, with the visibility it should have
+    QVERIFY(!central->titleBar()->isVisible());
+    QVERIFY(central->m_titleBar);
+
+    delete d2->window();
+}
+
 void TestDocks::tst_dragByTabBar_data()
 {
     QTest::addColumn<bool>("documentMode");
@@ -4209,6 +6880,154 @@ void TestDocks::tst_dragBySingleTab()
     Testing::waitForDeleted(frame1);
 }
 
+void TestDocks::tst_ghostTabDrag()
+{
+    // Tests that with Flag_GhostTabDrag the tab is only detached once it lands on empty space
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::Flag_GhostTabDrag);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new MyWidget2(QSize(200, 200)));
+    auto dock2 = createDockWidget("dock2", new MyWidget2(QSize(200, 200)));
+    m->addDockWidget(dock1, Location_OnTop);
+    dock1->addDockWidgetAsTab(dock2);
+
+    auto frame = dock1->frame();
+    QCOMPARE(dock2->frame(), frame);
+    QTabBar *tabBar = static_cast<FrameWidget*>(frame)->tabBar();
+    const QPoint globalPressPos = dragPointForWidget(frame, 1);
+    const QPoint emptySpace = m->geometry().bottomRight() + QPoint(100, 100);
+
+    drag(tabBar, globalPressPos, emptySpace, ButtonAction_Press);
+    QCOMPARE(dock2->frame(), frame); // Still in its tab
+    QVERIFY(DockRegistry::self()->nestedwindows().isEmpty());
+
+    drag(tabBar, QPoint(), emptySpace, ButtonAction_Release);
+    QVERIFY(dock2->isFloating());
+    QCOMPARE(DockRegistry::self()->nestedwindows().size(), 1);
+    QCOMPARE(frame->dockWidgetCount(), 1);
+
+    // Now over the main window, it's docked without a floating window being created
+    delete dock2->window();
+    dock2 = createDockWidget("dock2", new MyWidget2(QSize(200, 200)));
+    dock1->addDockWidgetAsTab(dock2);
+    drag(tabBar, dragPointForWidget(frame, 1), m->dropArea()->mapToGlobal(QPoint(50, 50)), ButtonAction_Press);
+    const QPoint dropPoint = m->dropArea()->dropIndicatorOverlay()->posForIndicator(DropIndicatorOverlayInterface::DropLocation_OutterBottom);
+    drag(tabBar, QPoint(), dropPoint, ButtonAction_Release);
+    QVERIFY(!dock2->isFloating());
+    QVERIFY(dock2->frame() != frame);
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+    QVERIFY(DockRegistry::self()->nestedwindows().isEmpty());
+    m->multiSplitterLayout()->checkSanity();
+}
+
+void TestDocks::tst_ghostTabDragOntoItself()
+{
+    // Tests that a ghost whose tab became the only one can't be docked relative to itself
+    EnsureTopLevelsDeleted e;
+    Config::self().setFlags(Config::Flag_GhostTabDrag | Config::Flag_AlwaysShowTabs);
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new MyWidget2(QSize(200, 200)));
+    auto dock2 = createDockWidget("dock2", new MyWidget2(QSize(200, 200)));
+    auto dock3 = createDockWidget("dock3", new MyWidget2(QSize(200, 200)));
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock3, Location_OnBottom);
+    dock1->addDockWidgetAsTab(dock2);
+
+    Frame *frame = dock2->frame();
+    QTabBar *tabBar = static_cast<FrameWidget*>(frame)->tabBar();
+    drag(tabBar, dragPointForWidget(frame, 1), frame->mapToGlobal(frame->rect().center()), ButtonAction_Press);
+    dock1->close();
+    QCOMPARE(frame->dockWidgetCount(), 1);
+
+    DropIndicatorOverlayInterface *overlay = m->dropArea()->dropIndicatorOverlay();
+    drag(tabBar, QPoint(), overlay->posForIndicator(DropIndicatorOverlayInterface::DropLocation_Bottom), ButtonAction_Release);
+    QCOMPARE(dock2->frame(), frame);
+    QVERIFY(!dock2->isFloating());
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+    QVERIFY(DockRegistry::self()->nestedwindows().isEmpty());
+    m->multiSplitterLayout()->checkSanity();
+
+    // Same, onto the edge of the floating window it's alone in
+    dock2->setFloating(true);
+    dock2->addDockWidgetAsTab(dock1);
+    auto floatingWindow = dock2->floatingWindow();
+    QVERIFY(floatingWindow);
+    frame = dock2->frame();
+    tabBar = static_cast<FrameWidget*>(frame)->tabBar();
+    drag(tabBar, dragPointForWidget(frame, 0), floatingWindow->dropArea()->mapToGlobal(QPoint(50, 50)), ButtonAction_Press);
+    dock1->close();
+    QCOMPARE(frame->dockWidgetCount(), 1);
+
+    overlay = floatingWindow->dropArea()->dropIndicatorOverlay();
+    drag(tabBar, QPoint(), overlay->posForIndicator(DropIndicatorOverlayInterface::DropLocation_OutterBottom), ButtonAction_Release);
+    QCOMPARE(dock2->frame(), frame);
+    QCOMPARE(dock2->floatingWindow(), floatingWindow);
+    QCOMPARE(DockRegistry::self()->nestedwindows().size(), 1);
+    QVERIFY(floatingWindow->dropArea()->checkSanity());
+
+    delete dock1;
+}
+
+void TestDocks::tst_deleteDraggedWindowWithPendingMove()
+{
+    // Tests that releasing doesn't crash if the coalesced move it flushes cancels the drag
+    EnsureTopLevelsDeleted e;
+    Config::self().setDragMouseMoveInterval(100000); // Only the first move is processed right away
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new MyWidget2(QSize(200, 200)));
+    auto dock2 = createDockWidget("dock2", new MyWidget2(QSize(200, 200)));
+    m->addDockWidget(dock1, Location_OnTop);
+
+    QPointer<FloatingWindow> fw = dock2->floatingWindow();
+    QVERIFY(fw);
+    const QPoint dest = m->dropArea()->mapToGlobal(QPoint(50, 50));
+    dragFloatingWindowTo(fw, dest, ButtonAction_Press);
+    QVERIFY(DragController::instance()->isDragging());
+
+    delete fw;
+    QVERIFY(!fw);
+
+    releaseOn(dest, m.get());
+    QVERIFY(!DragController::instance()->isDragging());
+    QCOMPARE(m->multiSplitterLayout()->count(), 1);
+    QVERIFY(DockRegistry::self()->nestedwindows().isEmpty());
+}
+
+void TestDocks::tst_simulatedDrag()
+{
+    // Tests that DragController can be driven without mouse events
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("dock1", new MyWidget2(QSize(200, 200)));
+    auto dock2 = createDockWidget("dock2", new MyWidget2(QSize(200, 200)));
+    m->addDockWidget(dock1, Location_OnTop);
+
+    auto fw = dock2->floatingWindow();
+    QVERIFY(fw);
+    DragController *dc = DragController::instance();
+
+    // Released outside of any drop area, it stays floating
+    const QPoint emptySpace = m->geometry().bottomRight() + QPoint(100, 100);
+    QVERIFY(!dc->simulateDrag(fw->titleBar(), QPoint(10, 10), { emptySpace }));
+    QVERIFY(!dc->isDragging());
+    QVERIFY(dock2->isFloating());
+
+    // Now dropped onto the main window's left indicator
+    QVERIFY(dc->beginSimulatedDrag(fw->titleBar(), QPoint(10, 10)));
+    const QPoint hoverPoint = m->dropArea()->mapToGlobal(QPoint(50, 50));
+    dc->simulateMouseMove(hoverPoint); // Starts the drag
+    QVERIFY(dc->isDragging());
+    dc->simulateMouseMove(hoverPoint); // Hovers, showing the drop indicators
+    const QPoint dropPoint = m->dropArea()->dropIndicatorOverlay()->posForIndicator(DropIndicatorOverlayInterface::DropLocation_OutterLeft);
+    dc->simulateMouseMove(dropPoint);
+    QVERIFY(dc->endSimulatedDrag(dropPoint));
+    QVERIFY(!dc->isDragging());
+    QVERIFY(!dock2->isFloating());
+    QCOMPARE(m->multiSplitterLayout()->count(), 2);
+    QVERIFY(Testing::waitForDeleted(fw));
+    m->multiSplitterLayout()->checkSanity();
+}
+
 void TestDocks::tst_addToHiddenMainWindow()
 {
     EnsureTopLevelsDeleted e;
@@ -4441,6 +7260,77 @@ void TestDocks::tst_registry()
     delete dw;
 }
 
+void TestDocks::tst_findDockWidgets()
+{
+    EnsureTopLevelsDeleted e;
+    auto dr = DockRegistry::self();
+
+    auto console = new DockWidget(QStringLiteral("console"));
+    auto output = new DockWidget(QStringLiteral("output"));
+    output->setTitle(QStringLiteral("Build Output"));
+    auto outline = new DockWidget(QStringLiteral("outline"));
+
+    QVERIFY(dr->findDockWidgets(QString()).isEmpty());
+    QVERIFY(dr->findDockWidgets(QStringLiteral("nothing")).isEmpty());
+
+    // Short queries aren't indexed, but still work
+    QCOMPARE(dr->findDockWidgets(QStringLiteral("ou")), DockWidgetBase::List({ outline, output }));
+
+    // Matches the title too, case insensitively. Prefix matches come first
+    QCOMPARE(dr->findDockWidgets(QStringLiteral("BUILD")), DockWidgetBase::List({ output }));
+    QCOMPARE(dr->findDockWidgets(QStringLiteral("out")), DockWidgetBase::List({ outline, output }));
+    QCOMPARE(dr->findDockWidgets(QStringLiteral("ole")), DockWidgetBase::List({ console }));
+    QCOMPARE(dr->findDockWidgets(QStringLiteral("o"), 1).size(), 1);
+
+    // The index follows title changes
+    output->setTitle(QStringLiteral("Compiler"));
+    QVERIFY(dr->findDockWidgets(QStringLiteral("build")).isEmpty());
+    QCOMPARE(dr->findDockWidgets(QStringLiteral("compi")), DockWidgetBase::List({ output }));
+
+    // And deletions
+    delete outline;
+    QCOMPARE(dr->findDockWidgets(QStringLiteral("out")), DockWidgetBase::List({ output }));
+
+    delete console;
+    delete output;
+}
+
+void TestDocks::tst_memoryReport()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None);
+    auto dock1 = createDockWidget("1", new QPushButton("1"), {}, /*show=*/false);
+    auto dock2 = createDockWidget("2", new QPushButton("2"), {}, /*show=*/false);
+    auto dock3 = new DockWidget(QStringLiteral("3")); // Without guest widget
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+
+    DockRegistry::MemoryReport report = DockRegistry::self()->memoryReport();
+    QCOMPARE(report.dockWidgets.count, 3);
+    QCOMPARE(report.guestWidgets, 2);
+    QCOMPARE(report.frames.count, 2);
+    QCOMPARE(report.tabWidgets.count, 2);
+    QCOMPARE(report.floatingWindows.count, 0);
+    QCOMPARE(report.layouts.size(), 1);
+    QVERIFY(report.layouts.at(0).isInMainWindow);
+    QCOMPARE(report.layouts.at(0).items.count, 2);
+    QCOMPARE(report.layouts.at(0).placeholders.count, 0);
+    QVERIFY(report.layouts.at(0).anchors.count >= 4); // The static ones, plus one between the docks
+    QVERIFY(report.totalBytes() > 0);
+
+    // Closing leaves a placeholder, that the dock widget's LastPosition references
+    const int refsBefore = report.placeholderRefs.count;
+    dock2->close();
+    report = DockRegistry::self()->memoryReport();
+    QCOMPARE(report.layouts.at(0).items.count, 2);
+    QCOMPARE(report.layouts.at(0).placeholders.count, 1);
+    QVERIFY(report.placeholderRefs.count >= refsBefore);
+    QVERIFY(report.placeholderRefs.count >= 1);
+
+    delete dock2;
+    delete dock3;
+}
+
 void TestDocks::tst_dockNotFillingSpace()
 {
      EnsureTopLevelsDeleted e;
@@ -4508,6 +7398,42 @@ void TestDocks::tst_rectForDropCrash()
     delete m->window();
 }
 
+void TestDocks::tst_dropRectCache()
+{
+    // Tests that the drop indicators' memoized drop rects follow the separators
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(1000, 500), MainWindowOption_None);
+    auto layout = m->multiSplitterLayout();
+    auto dock1 = createDockWidget("dock1", new QPushButton("one"));
+    auto dock2 = createDockWidget("dock2", new QPushButton("two"));
+    auto dock3 = createDockWidget("dock3", new QPushButton("three"));
+    m->addDockWidget(dock1, Location_OnLeft);
+    m->addDockWidget(dock2, Location_OnRight);
+    auto fw = dock3->floatingWindow();
+    QVERIFY(fw);
+
+    DropIndicatorOverlayInterface *overlay = m->dropArea()->dropIndicatorOverlay();
+    overlay->setWindowBeingDragged(fw);
+    Frame *frame1 = dock1->frame();
+    Item *item1 = layout->itemForFrame(frame1);
+    const QRect initialRect = overlay->rectForDrop(Location_OnRight, frame1);
+    QCOMPARE(initialRect, layout->rectForDrop(fw, Location_OnRight, item1));
+    QCOMPARE(overlay->rectForDrop(Location_OnRight, frame1), initialRect);
+
+    // Moving the separator next to the hovered frame
+    Anchor *anchor = item1->anchorGroup().right;
+    anchor->setPosition(anchor->position() + 50);
+    const QRect movedRect = overlay->rectForDrop(Location_OnRight, frame1);
+    QVERIFY(movedRect != initialRect);
+    QCOMPARE(movedRect, layout->rectForDrop(fw, Location_OnRight, item1));
+
+    // Moving the dragged window doesn't need a recomputation, but mustn't break anything either
+    fw->move(fw->pos() + QPoint(10, 10));
+    QCOMPARE(overlay->rectForDrop(Location_OnRight, frame1), movedRect);
+
+    overlay->setWindowBeingDragged(nullptr);
+}
+
 void TestDocks::tst_availableSizeWithPlaceholders()
 {
     // Tests MultiSplitterLayout::available() with and without placeholders. The result should be the same.
@@ -5312,6 +8238,85 @@ void TestDocks::tst_restoreEmbeddedMainWindow()
     delete window;
 }
 
+void TestDocks::tst_restoreRejectsInconsistentLayout()
+{
+    EnsureTopLevelsDeleted e;
+    auto m = createMainWindow(QSize(800, 500), MainWindowOption_None, "tst_restoreRejectsInconsistentLayout");
+    auto dock1 = createDockWidget("1", new QPushButton("1"));
+    auto dock2 = createDockWidget("2", new QPushButton("2"));
+    m->addDockWidget(dock1, Location_OnTop);
+    m->addDockWidget(dock2, Location_OnBottom);
+
+    LayoutSaver saver;
+    const QByteArray saved = saver.serializeLayout();
+
+    // Changes the first item of the main window's layout
+    auto corrupted = [&saved] (const QString &key, const QVariant &value) {
+        QVariantMap map = QJsonDocument::fromJson(saved).toVariant().toMap();
+        QVariantList mainWindows = map.value(QStringLiteral("mainWindows")).toList();
+        QVariantMap mainWindow = mainWindows.at(0).toMap();
+        QVariantMap layout = mainWindow.value(QStringLiteral("multiSplitterLayout")).toMap();
+        QVariantList items = layout.value(QStringLiteral("items")).toList();
+        QVariantMap item = items.at(0).toMap();
+        item.insert(key, value);
+        items[0] = item;
+        layout.insert(QStringLiteral("items"), items);
+        mainWindow.insert(QStringLiteral("multiSplitterLayout"), layout);
+        mainWindows[0] = mainWindow;
+        map.insert(QStringLiteral("mainWindows"), mainWindows);
+        return QJsonDocument::fromVariant(map).toJson();
+    };
+
+    Frame *frame1 = dock1->frame();
+    const int numAnchors = m->multiSplitterLayout()->anchors().size();
+    {
+        SetExpectedWarning expectedWarning("Invalid anchor indexes");
+        QVERIFY(!saver.restoreLayout(corrupted(QStringLiteral("indexOfLeftAnchor"), 99)));
+        QVERIFY(!saver.restoreLayout(corrupted(QStringLiteral("indexOfTopAnchor"), -1)));
+    }
+
+    // Replaces dock1's placeholders with a single one, in the floating window or main window passed
+    auto withPlaceholder = [&saved] (int indexOfFloatingWindow, const QString &mainWindowName) {
+        QVariantMap map = QJsonDocument::fromJson(saved).toVariant().toMap();
+        QVariantList dockWidgets = map.value(QStringLiteral("allDockWidgets")).toList();
+        for (int i = 0; i < dockWidgets.size(); ++i) {
+            QVariantMap dockWidget = dockWidgets.at(i).toMap();
+            if (dockWidget.value(QStringLiteral("uniqueName")).toString() != QLatin1String("1"))
+                continue;
+
+            QVariantMap lastPosition = dockWidget.value(QStringLiteral("lastPosition")).toMap();
+            lastPosition.insert(QStringLiteral("placeholderFloatingWindows"), QVariantList { indexOfFloatingWindow });
+            lastPosition.insert(QStringLiteral("placeholderItemIndexes"), QVariantList { 0 });
+            lastPosition.insert(QStringLiteral("placeholderMainWindows"),
+                                indexOfFloatingWindow == -1 ? QVariantList { mainWindowName } : QVariantList());
+            dockWidget.insert(QStringLiteral("lastPosition"), lastPosition);
+            dockWidgets[i] = dockWidget;
+        }
+        map.insert(QStringLiteral("allDockWidgets"), dockWidgets);
+        return QJsonDocument::fromVariant(map).toJson();
+    };
+
+    {
+        // There's no floating window in the layout, nor a main window with that name
+        SetExpectedWarning expectedWarning("Invalid placeholder");
+        QVERIFY(!saver.restoreLayout(withPlaceholder(0, QString())));
+        QVERIFY(!saver.restoreLayout(withPlaceholder(-1, QStringLiteral("unknown"))));
+    }
+
+    // The current layout wasn't touched
+    QCOMPARE(dock1->frame(), frame1);
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+    QCOMPARE(m->multiSplitterLayout()->anchors().size(), numAnchors);
+
+    // The original is still fine, and so is a placeholder in the saved main window
+    QVERIFY(saver.restoreLayout(saved));
+    QVERIFY(dock1->isVisible());
+    QVERIFY(dock2->isVisible());
+    QVERIFY(saver.restoreLayout(withPlaceholder(-1, m->uniqueName())));
+    QVERIFY(dock1->isVisible());
+}
+
 void TestDocks::tst_restoreWithDockFactory()
 {
     // Tests that restore the layout with a missing dock widget will recreate the dock widget using a factory
@@ -5557,13 +8562,45 @@ void TestDocks::tst_raise()
         QCOMPARE(qApp->widgetAt(dock3->window()->geometry().topLeft() + QPoint(50, 50))->window(), dock3->window());
         dock1->raise();
         QVERIFY(dock1->isCurrentTab());
-        QCOMPARE(qApp->widgetAt(dock3->window()->geometry().topLeft() + QPoint(50, 50))->window(), dock1->window());
+        // Raising is coalesced, it happens in the next event loop iteration
+        QTRY_COMPARE(qApp->widgetAt(dock3->window()->geometry().topLeft() + QPoint(50, 50))->window(), dock1->window());
     }
 
     delete fw2;
     delete dock1->window();
 }
 
+void TestDocks::tst_raiseCoalesced()
+{
+    // Tests that raising several floating windows in a row only activates the last one
+    EnsureTopLevelsDeleted e;
+    auto dock1 = createDockWidget("1", new QWidget());
+    auto dock2 = createDockWidget("2", new QWidget());
+    auto dock3 = createDockWidget("3", new QWidget());
+
+    dock1->window()->activateWindow();
+    if (!QTest::qWaitForWindowActive(dock1->window()))
+        QSKIP("Window activation isn't supported by this platform");
+
+    QSignalSpy spy(qApp, &QGuiApplication::focusWindowChanged);
+    dock2->raise();
+    dock3->raise();
+    dock2->raise();
+    dock3->raise();
+    QCOMPARE(qApp->activeWindow(), dock1->window()); // Nothing happens until the next iteration
+
+    QTRY_COMPARE(qApp->activeWindow(), dock3->window());
+    Testing::processPendingEvents();
+    QCOMPARE(qApp->activeWindow(), dock3->window());
+    QVERIFY(spy.count() > 0);
+    for (const QList<QVariant> &args : qAsConst(spy))
+        QCOMPARE(args.at(0).value<QWindow *>(), dock3->window()->windowHandle());
+
+    delete dock1->window();
+    delete dock2->window();
+    delete dock3->window();
+}
+
 void TestDocks::tst_floatingAction()
 {
     // Tests DockWidget::floatAction()
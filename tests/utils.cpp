@@ -19,6 +19,7 @@
 */
 
 #include "utils.h"
+#include "Testing.h"
 #include "DropArea_p.h"
 #include "Config.h"
 #include "private/widgets/TabWidgetWidget_p.h"
@@ -238,7 +239,7 @@ void KDDockWidgets::Tests::moveMouseTo(QPoint globalDest, QWidget *receiver)
         }
 
         qApp->sendEvent(receiver, &ev);
-        QTest::qWait(2);
+        Testing::processPendingEvents();
     }
 }
 